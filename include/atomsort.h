@@ -0,0 +1,95 @@
+/*
+ * 
+ *                This source code is part of
+ * 
+ *                 G   R   O   M   A   C   S
+ * 
+ *          GROningen MAchine for Chemical Simulations
+ * 
+ *                        VERSION 3.2.0
+ * Written by David van der Spoel, Erik Lindahl, Berk Hess, and others.
+ * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
+ * Copyright (c) 2001-2004, The GROMACS development team,
+ * check out http://www.gromacs.org for more information.
+
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * If you want to redistribute modifications, please consider that
+ * scientific software is very special. Version control is crucial -
+ * bugs must be traceable. We will be happy to consider code for
+ * inclusion in the official distribution, but derived work must not
+ * be called official GROMACS. Details are found in the README & COPYING
+ * files - if they are missing, get the official version at www.gromacs.org.
+ * 
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the papers on the package - you can find them in the top README file.
+ * 
+ * For more info, check our website at http://www.gromacs.org
+ * 
+ * And Hey:
+ * Gromacs Runs On Most of All Computer Systems
+ */
+
+#ifndef _atomsort_h
+#define _atomsort_h
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "typedefs.h"
+#include "vsite.h"
+
+/* Spatial sorting of the atoms for runs without domain decomposition.
+ * At neighbor search steps the charge groups are ordered along the
+ * ns grid cells, as dd_sort_state does for the home charge groups with
+ * domain decomposition. The state, topology and mdatoms are then in
+ * local (sorted) order, index maps to the global order are maintained.
+ */
+
+extern gmx_atomsort_t init_atomsort(FILE *fplog,t_inputrec *ir,
+				    gmx_mtop_t *mtop,gmx_localtop_t *top_gl,
+				    t_forcerec *fr);
+/* Sets up atom sorting for the topology top_gl in global atom order.
+ * Returns NULL, with a note in fplog, when the system contains
+ * features that depend on the global atom order.
+ */
+
+extern gmx_localtop_t *atomsort_init_local_top(gmx_atomsort_t as);
+/* Returns a local topology to be filled by atomsort_partition_system */
+
+extern void atomsort_init_local_state(gmx_atomsort_t as,
+				      t_state *state_global,
+				      t_state *state_local);
+/* Copies state_global to state_local, the local state gets its own
+ * x, v, sd_X and cg_p arrays, all other arrays are shared.
+ */
+
+extern void atomsort_partition_system(FILE *fplog,gmx_step_t step,
+				      gmx_atomsort_t as,
+				      t_inputrec *ir,gmx_mtop_t *mtop,
+				      t_state *state,t_forcerec *fr,
+				      t_mdatoms *mdatoms,gmx_localtop_t *top,
+				      gmx_vsite_t *vsite,gmx_constr_t constr,
+				      t_graph **graph);
+/* Sorts the charge groups in state on their ns grid cell and
+ * sets the local topology, fr->cginfo, mdatoms, the virtual sites,
+ * the constraints and the graph (when present) for the new order.
+ */
+
+extern int *atomsort_gatindex(gmx_atomsort_t as);
+/* Returns the global atom index for each local atom */
+
+extern void atomsort_collect_vec(gmx_atomsort_t as,rvec *lv,rvec *v);
+/* Copies the local vector lv to v in global atom order */
+
+extern void atomsort_collect_state(gmx_atomsort_t as,
+				   t_state *state_local,t_state *state);
+/* Copies the atom vectors in state_local to state in global atom order,
+ * the non-atom entries are copied by write_traj.
+ */
+
+#endif	/* _atomsort_h */
@@ -0,0 +1,55 @@
+/*
+ * 
+ *                This source code is part of
+ * 
+ *                 G   R   O   M   A   C   S
+ * 
+ *          GROningen MAchine for Chemical Simulations
+ * 
+ * Written by David van der Spoel, Erik Lindahl, Berk Hess, and others.
+ * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
+ * Copyright (c) 2001-2008, The GROMACS development team,
+ * check out http://www.gromacs.org for more information.
+ 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * If you want to redistribute modifications, please consider that
+ * scientific software is very special. Version control is crucial -
+ * bugs must be traceable. We will be happy to consider code for
+ * inclusion in the official distribution, but derived work must not
+ * be called official GROMACS. Details are found in the README & COPYING
+ * files - if they are missing, get the official version at www.gromacs.org.
+ * 
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the papers on the package - you can find them in the top README file.
+ * 
+ * For more info, check our website at http://www.gromacs.org
+ * 
+ * And Hey:
+ * Gromacs Runs On Most of All Computer Systems
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifndef _calc_verletbuf_h
+#define _calc_verletbuf_h
+
+#include "typedefs.h"
+
+extern real calc_verlet_buffer_size(const gmx_mtop_t *mtop,real boxvol,
+				    const t_inputrec *ir,int nstlist,
+				    real drift_target);
+/* Returns the pair-list cut-off for a list that is used for nstlist steps,
+ * such that the estimated energy drift due to atom pairs that move from
+ * outside the list to within the interaction cut-off is below drift_target
+ * (kJ/mol/ps per atom). The displacements are estimated for free motion,
+ * or diffusion with BD, at the highest reference temperature.
+ * Returns -1 when there is no reference temperature.
+ */
+
+#endif	/* _calc_verletbuf_h */
@@ -56,6 +56,43 @@ extern real do_ewald(FILE *log,       bool bVerbose,
 		     matrix lrvir,   real ewaldcoeff,
 		     real lambda,    real *dvdlambda);
 /* Do an Ewald calculation for the long range electrostatics. */
+
+typedef struct gmx_ewald_sfac *gmx_ewald_sfac_t;
+/* Abstract type for the Ewald structure factors used with MC */
+
+extern gmx_ewald_sfac_t init_ewald_sfac(t_inputrec *ir,real ewaldcoeff,
+				       int ntrial);
+/* Sets up the Ewald sum over the k-vectors with |k| below the cut-off
+ * implied by ir->ewald_rtol, for PME limited to the k-vectors resolved
+ * by the PME grid. Up to ntrial trial structure factors can be kept
+ * at the same time.
+ */
+
+extern real ewald_sfac_reset(gmx_ewald_sfac_t sfac,real epsilon_r,rvec box,
+			     int natoms,rvec x[],real charge[]);
+/* Computes the structure factors of all atoms from scratch
+ * and returns the reciprocal space energy.
+ * The cost is proportional to the number of k-vectors times natoms.
+ */
+
+extern void ewald_sfac_undo(gmx_ewald_sfac_t sfac);
+/* Restores the structure factors from before the last ewald_sfac_reset */
+
+extern real ewald_sfac_energy(gmx_ewald_sfac_t sfac);
+/* Returns the reciprocal space energy of the accepted structure factors */
+
+extern real ewald_sfac_delta(gmx_ewald_sfac_t sfac,int trial,int natoms,
+			     rvec xold[],rvec xnew[],real charge[]);
+/* Computes the structure factors of trial when natoms atoms move from
+ * xold to xnew and returns the change in reciprocal space energy.
+ * The cost is proportional to the number of k-vectors times natoms.
+ * The trial is only used after calling ewald_sfac_commit,
+ * a rejected trial requires no action. Different trials can be
+ * computed concurrently.
+ */
+
+extern void ewald_sfac_commit(gmx_ewald_sfac_t sfac,int trial);
+/* Makes the structure factors of trial the accepted ones */
  
 extern real ewald_LRcorrection(FILE *fp,
 			       int start,int end,
@@ -66,6 +66,10 @@ extern real dd_cutoff_mbody(gmx_domdec_t *dd);
 
 extern real dd_cutoff_twobody(gmx_domdec_t *dd);
 
+extern void dd_get_cell_bounds(gmx_domdec_t *dd,rvec cell_x0,rvec cell_x1,
+                               rvec cellsize_min);
+/* Returns the boundaries of the home cell and the minimum cell sizes */
+
 extern bool gmx_pmeonlynode(t_commrec *cr,int nodeid);
 /* Return if nodeid in cr->mpi_comm_mysim is a PME-only node */
 
@@ -45,6 +45,7 @@
 #include "gmxcomplex.h"
 #include "network.h"
 #include "gmx_fft.h"
+#include "gmx_thread_pool.h"
 
 #ifdef GMX_MPI
 #include "gmx_parallel_3dfft.h"
@@ -57,6 +58,9 @@
 typedef struct {
   int local_nx,local_x_start,local_ny_after_transpose;
   int local_y_start_after_transpose;
+  /* Only with pencil decomposition y and the complex z are distributed */
+  int local_ny,local_y_start;
+  int local_nzc_after_transpose,local_zc_start_after_transpose;
 } t_parfft;
 
 typedef struct {
@@ -92,12 +96,35 @@ extern t_fftgrid *mk_fftgrid(int          nx,
  * could affect reproducibility of simulations.
  */
 
+#ifdef GMX_MPI
+extern t_fftgrid *mk_fftgrid_pencil(int          nx,
+                                    int          ny,
+                                    int          nz,
+                                    int          *slab2grid_x,
+                                    int          *slab2grid_y,
+                                    MPI_Comm     comm_x,
+                                    MPI_Comm     comm_y,
+                                    bool         bReproducible);
+/* Create a parallel FFT grid with pencil decomposition: the real grid
+ * is distributed in x over comm_x and in y over comm_y, the complex grid
+ * in y over comm_x and in z over comm_y. The grid is indexed with
+ * global indices in the same way as for mk_fftgrid.
+ */
+#endif
+
 extern void pr_fftgrid(FILE *fp,char *title,t_fftgrid *grid);
 /* Dump a grid to a file */
 
 extern void done_fftgrid(t_fftgrid *grid);
 /* And throw it away again */
 
+extern void set_fftgrid_threads(t_fftgrid *grid,gmx_thread_pool_t pool,
+                                bool bReproducible);
+/* Let the FFTs of grid use the threads of pool. In parallel the local
+ * transforms are divided over the threads, on a single node a threaded
+ * FFT library setup is used when the library supports it.
+ */
+
 extern void gmxfft3D(t_fftgrid *grid,enum gmx_fft_direction dir,t_commrec *cr);
 /* Do the FFT, direction may be either 
  * FFTW_FORWARD (sign -1) for real -> complex transform 
@@ -121,9 +121,125 @@ forcerec_set_ranges(t_forcerec *fr,
 		    int natoms_force,int natoms_f_novirsum);
 /* Set the number of cg's and atoms for the force calculation */
 
-extern void init_enerd_mc(gmx_mc_move *mc_move,gmx_localtop_t *top,int homenr);
-extern real delta_enerd_mc(gmx_enerdata_t *enerd,gmx_enerdata_t *enerd_prev,gmx_localtop_t *top,gmx_mc_move *mc_move,t_idef *idef,t_forcerec *fr,int homenr);
-extern void clean_enerd_mc(gmx_mc_move *mc_move,gmx_localtop_t *top,t_forcerec *fr,int homenr,bool copy);
+extern void init_enerd_mc(FILE *fplog,gmx_mc_move *mc_move,
+                          t_inputrec *ir,t_forcerec *fr,
+                          gmx_localtop_t *top,t_mdatoms *md,matrix box);
+/* Initializes the data for incremental MC energy evaluation */
+
+extern bool enerd_mc_incremental(gmx_mc_move *mc_move);
+/* Returns if single molecule MC moves can be evaluated incrementally */
+
+extern void set_enerd_mc_top(gmx_mc_move *mc_move,t_forcerec *fr,
+                             gmx_localtop_t *top,t_mdatoms *md,
+                             matrix box,rvec x[]);
+/* Reallocates the incremental MC data for a new local topology,
+ * after domain decomposition repartitioning, and calls reset_enerd_mc.
+ * x should contain the coordinates of the communicated atoms as well.
+ */
+
+extern void reset_enerd_mc(gmx_mc_move *mc_move,t_forcerec *fr,
+                           gmx_localtop_t *top,t_mdatoms *md,
+                           matrix box,rvec x[]);
+/* Stores x as the accepted MC configuration,
+ * should be called after every full energy evaluation that is accepted.
+ */
+
+extern real delta_enerd_mc(gmx_enerdata_t *enerd,gmx_enerdata_t *enerd_prev,
+                           gmx_mc_move *mc_move,t_forcerec *fr,
+                           gmx_localtop_t *top,t_mdatoms *md,t_fcdata *fcd,
+                           matrix box,rvec xprev[],rvec x[],real lambda);
+/* Computes the energy of the trial configuration x, in which only
+ * atoms mc_move->start to mc_move->end moved with respect to xprev,
+ * using only the interactions involving the moved atoms.
+ * enerd is set to enerd_prev plus the change per energy term,
+ * the change in the potential energy is returned.
+ */
+
+extern real trial_epot_mc(gmx_mc_move *mc_move,int trial,t_forcerec *fr,
+                          gmx_localtop_t *top,t_mdatoms *md,t_fcdata *fcd,
+                          matrix box,rvec xprev[],rvec x[],real lambda);
+/* As delta_enerd_mc, but only returns the change in the potential energy
+ * and keeps the changes per term with work data set trial, which should
+ * be smaller than max(1,ir->mc_ntrial,ir->mc_regrow_ntrial), or than
+ * the number of MC threads with checkerboard sweeps. Different trials can be computed
+ * concurrently; x only needs to be set for the moved atoms.
+ */
+
+extern void trial_epot_mc_batch(gmx_mc_move *mc_move,int k0,int k1,int skip,
+                                t_forcerec *fr,gmx_localtop_t *top,
+                                t_mdatoms *md,t_fcdata *fcd,matrix box,
+                                rvec xprev[],rvec *xt[],real lambda,
+                                double dU[]);
+/* As trial_epot_mc for trials k0 to k1, except skip, with work data set k
+ * and the moved atom coordinates xt[k] starting at mc_move->start,
+ * returns the energy changes in dU[k]. The non-bonded interactions
+ * with the other charge groups are computed for all trials and
+ * the current configuration in one pass of the batch kernel.
+ */
+
+extern void set_enerd_mc(gmx_enerdata_t *enerd,gmx_enerdata_t *enerd_prev,
+                         gmx_mc_move *mc_move,int trial);
+/* Sets enerd to enerd_prev plus the changes of trial and selects trial
+ * for commit_enerd_mc.
+ */
+
+extern void commit_enerd_mc(gmx_mc_move *mc_move,gmx_localtop_t *top);
+/* Accepts the trial configuration last passed to delta_enerd_mc
+ * or set_enerd_mc.
+ */
+
+extern void reject_enerd_mc(gmx_mc_move *mc_move);
+/* Should be called when the configuration of a full energy evaluation
+ * is rejected, restores the accepted Ewald structure factors.
+ */
+
+extern void set_trial_halo_mc(gmx_mc_move *mc_move,int trial,
+                              int nhalo,int *halo);
+/* Restricts the non-bonded interactions of trial to the nhalo charge
+ * groups in halo, which should stay valid while it is in use,
+ * with halo=NULL all charge groups are considered again.
+ * Can not be used with Ewald summation.
+ */
+
+extern rvec *get_cg_cm_mc(gmx_mc_move *mc_move,int *ncg);
+/* Returns the charge-group centers of the accepted configuration
+ * and their number in ncg. They change when trials are committed.
+ */
+
+extern void commit_trial_mc(gmx_mc_move *mc_move,int trial,
+                            gmx_localtop_t *top,double dener[]);
+/* Accepts the configuration last passed to trial_epot_mc for trial
+ * and adds its energy changes per term to dener. Trials of moves that
+ * do not interact can be committed concurrently; the MC cell lists
+ * are not updated, call reset_grid_mc afterwards.
+ */
+
+extern void add_enerd_mc(gmx_enerdata_t *enerd,double dener[]);
+/* Adds the energy changes dener to enerd and updates the total */
+
+extern void reset_grid_mc(gmx_mc_move *mc_move,matrix box);
+/* Rebuilds the MC cell lists from the accepted configuration */
+
+extern bool volume_enerd_mc_supported(gmx_mc_move *mc_move,t_forcerec *fr,
+                                      matrix box);
+/* Returns if MC volume moves can be evaluated with delta_volume_enerd_mc */
+
+extern real delta_volume_enerd_mc(gmx_enerdata_t *enerd,
+                                  gmx_enerdata_t *enerd_prev,
+                                  gmx_mc_move *mc_move,t_forcerec *fr,
+                                  gmx_localtop_t *top,t_mdatoms *md,
+                                  t_block *mols,matrix box_prev,matrix box,
+                                  rvec x[]);
+/* As delta_enerd_mc, for an isotropic MC volume move from box_prev to box
+ * that displaced the molecules rigidly. Only the intermolecular
+ * non-bonded energy is recomputed, over a buffered charge-group pair
+ * list in scaled coordinates that is only rebuilt when the displacements
+ * since the last build exceed the buffer. When no molecule has
+ * non-excluded internal pairs, the energy of the accepted state is taken
+ * from enerd_prev, otherwise pairs of single-atom molecules that stay
+ * within the cut-off are evaluated once as r^-12, r^-6 and r^-1 components.
+ * The MC cell lists are not changed, after acceptance call reset_enerd_mc.
+ */
 
 extern void init_forcerec(FILE       *fplog,     
 			  t_forcerec *fr,   
@@ -243,33 +359,6 @@ void sum_enerdata(gmx_enerdata_t *enerd1,gmx_enerdata_t *enerd2,gmx_enerdata_t *
 
 void sub_enerdata(gmx_enerdata_t *enerd1,gmx_enerdata_t *enerd2,gmx_enerdata_t *enerd3);
 
-extern void do_recip_mc(FILE         *fplog,  
-			      gmx_step_t   step,
-			      t_forcerec   *fr,
-			      t_inputrec   *ir,
-			      t_idef       *idef,
-			      t_commrec    *cr,
-			      t_nrnb       *nrnb,
-			      gmx_wallcycle_t wcycle,
-			      t_mdatoms    *md,
-			      t_grpopts    *opts,
-			      rvec         x[],
-			      history_t    *hist,
-			      rvec         f[],    
-			      gmx_enerdata_t *enerd,
-			      t_fcdata     *fcd,
-			      gmx_genborn_t *born,
-			      t_atomtypes  *atype,
-			      bool         bBornRadii,
-			      matrix       box,
-			      real         lambda,
-			      t_graph      *graph,
-			      t_blocka     *excl,
-			      rvec         mu_tot[2],
-			      int          flags,
-			      float        *cycles_pme,
-                              gmx_mc_move  *mc_move);
-
 extern void do_force_lowlevel(FILE         *fplog,  
 			      gmx_step_t   step,
 			      t_forcerec   *fr,
@@ -425,6 +425,21 @@ void
 gmx_fft_destroy          (gmx_fft_t                 setup);
 
 
+/*! \brief Set the number of threads for subsequent FFT setups
+ *
+ *  Setups initialized after this call will use up to nthreads threads
+ *  within a single transform. This is only supported with FFTW3 built
+ *  with thread support; for other libraries this call has no effect.
+ *  Call it again with nthreads=1 to return to single-threaded setups.
+ *
+ *  \param nthreads  Number of threads to use
+ *
+ *  \return The number of threads that will actually be used.
+ */
+int
+gmx_fft_init_threads     (int                       nthreads);
+
+
 /*! \brief Transpose 2d complex matrix, in-place or out-of-place.
  * 
  * This routines works when the matrix is non-square, i.e. nx!=ny too, 
@@ -28,6 +28,7 @@
 #include "types/simple.h"
 #include "gmxcomplex.h"
 #include "gmx_fft.h"
+#include "gmx_thread_pool.h"
 
 /* We NEED MPI here. */
 #ifdef GMX_LIB_MPI
@@ -76,6 +77,42 @@ gmx_parallel_3dfft_init   (gmx_parallel_3dfft_t *    pfft_setup,
 						   int                       *slab2grid_x,
                            MPI_Comm                  comm,
                            bool                      bReproducible);
+
+
+
+/*! \brief Initialize parallel MPI-based 3D-FFT with pencil decomposition.
+ *  As gmx_parallel_3dfft_init(), but the direct space grid is decomposed
+ *  over a 2D node grid in x and y, with z kept local ("z-pencils").
+ *  The forward transform performs the z FFTs, an all-to-all transpose
+ *  over comm_y, the y FFTs, an all-to-all transpose over comm_x and
+ *  finally the x FFTs. The complex output is stored in the same transposed
+ *  YXZ order as with slab decomposition, but with ky distributed over
+ *  comm_x and kz distributed over comm_y.
+ *  This allows for more nodes than grid lines in x.
+ *  \param pfft_setup     Pointer to parallel 3dfft setup structure.
+ *  \param ngridx         Global number of grid cells in the x direction.
+ *  \param ngridy         Global number of grid cells in the y direction.
+ *  \param ngridz         Global number of grid cells in the z direction.
+ *  \param slab2grid_x    Node index in comm_x to grid_x array, can be NULL.
+ *  \param slab2grid_y    Node index in comm_y to grid_y array, can be NULL.
+ *  \param comm_x         Communicator over the nodes along x, i.e. all nodes
+ *                        in comm_x have the same y-range.
+ *  \param comm_y         Communicator over the nodes along y, i.e. all nodes
+ *                        in comm_y have the same x-range.
+ *  \param bReproducible  Avoid FFT timing optimizations.
+ *
+ *  \return 0 or a standard error code.
+ */
+int
+gmx_parallel_3dfft_init_pencil(gmx_parallel_3dfft_t *    pfft_setup,
+                               int                       ngridx,
+                               int                       ngridy,
+                               int                       ngridz,
+                               int                       *slab2grid_x,
+                               int                       *slab2grid_y,
+                               MPI_Comm                  comm_x,
+                               MPI_Comm                  comm_y,
+                               bool                      bReproducible);
                            
 
 
@@ -99,6 +136,37 @@ gmx_parallel_3dfft_limits(gmx_parallel_3dfft_t      pfft_setup,
                           int *                     local_ny);
 
 
+/*! \brief Get the direct space y and reciprocal space z index limits
+ *  Only with pencil decomposition the direct space y dimension and
+ *  the complex z dimension (size ngridz/2+1) are distributed,
+ *  otherwise the full ranges are returned.
+ */
+int
+gmx_parallel_3dfft_limits_yz(gmx_parallel_3dfft_t   pfft_setup,
+                             int *                  local_y_start,
+                             int *                  local_ny,
+                             int *                  local_zc_start,
+                             int *                  local_nzc);
+
+
+/*! \brief Distribute the local transforms over a pool of threads.
+ *
+ *  The local 1D and 2D transforms of gmx_parallel_3dfft() are divided
+ *  over the threads in pool, each thread using its own FFT setups.
+ *  The communication is still done by the calling thread only.
+ *
+ *  \param pfft_setup     Parallel 3dfft setup.
+ *  \param pool           Thread pool, must stay alive as long as pfft_setup.
+ *  \param bReproducible  As for gmx_parallel_3dfft_init().
+ *
+ *  \return 0 or a standard error code.
+ */
+int
+gmx_parallel_3dfft_init_threads(gmx_parallel_3dfft_t    pfft_setup,
+                                gmx_thread_pool_t       pool,
+                                bool                    bReproducible);
+
+
 int
 gmx_parallel_transpose(t_complex *   data,
                        t_complex *   work,
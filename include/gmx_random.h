@@ -262,5 +262,134 @@ real
 gmx_rng_gaussian_table(gmx_rng_t rng);
 
 
+/*! \brief Streams of the counter-based random number generator
+ *
+ * Different uses of the counter-based generator with the same seed
+ * should use different domains, such that their numbers are independent.
+ */
+enum {
+  erngcbSD, erngcbSD2, erngcbBD, erngcbHMC, erngcbHMCACCEPT,
+  erngcbMC, erngcbMCACCEPT, erngcbMCTRIAL, erngcbMCSWEEP, erngcbMCGRID,
+  erngcbMCHYBRID, erngcbNR
+};
+
+
+/*! \brief Counter-based random number generator
+ *
+ * The Threefry-4x32 generator with 20 rounds of Salmon et al. (SC11)
+ * is a keyed bijection on a 128-bit counter: the numbers only depend on
+ * the key and the counter, not on a state built up by earlier calls.
+ * The key is formed by the seed and a domain, the counter by the step,
+ * an index (usually the global atom number) and a sub-counter.
+ * Every (step, index) pair thus has its own stream and the numbers
+ * drawn for an atom do not depend on the parallel decomposition,
+ * the number of threads or the order in which the atoms are processed.
+ *
+ * Unlike gmx_rng_t, this is a small struct without allocated data
+ * that can be declared on the stack, the functions below are threadsafe
+ * as long as different threads use different structs.
+ */
+typedef struct {
+  unsigned int key[4];
+  unsigned int ctr[4];
+  unsigned int buf[4];
+  int          nbuf;     /* The number of unused entries in buf */
+} gmx_rng_cb_t;
+
+
+/*! \brief Encrypts a counter with a key
+ *
+ *  The basic Threefry-4x32-20 operation, out is a random function
+ *  of key and ctr.
+ */
+void
+gmx_rng_cb_block(const unsigned int key[4],const unsigned int ctr[4],
+                 unsigned int out[4]);
+
+
+/*! \brief Sets the key of a counter-based RNG
+ *
+ *  \param rng    The counter-based RNG
+ *  \param seed   Random seed, usually ir->ld_seed
+ *  \param domain The stream domain, one of erngcbNR
+ */
+void
+gmx_rng_cb_init(gmx_rng_cb_t *rng,unsigned int seed,int domain);
+
+
+/*! \brief Starts the stream of a counter-based RNG for step and index
+ *
+ *  Has to be called at least once after gmx_rng_cb_init(). Restarting
+ *  with the same step and index returns the same numbers.
+ */
+void
+gmx_rng_cb_restart(gmx_rng_cb_t *rng,gmx_step_t step,unsigned int index);
+
+
+/*! \brief Random 32-bit integer from the stream of a counter-based RNG */
+unsigned int
+gmx_rng_cb_uint32(gmx_rng_cb_t *rng);
+
+
+/*! \brief Random real 0<=x<1 from the stream of a counter-based RNG */
+real
+gmx_rng_cb_uniform_real(gmx_rng_cb_t *rng);
+
+
+/*! \brief Random integer 0<=i<max from the stream of a counter-based RNG
+ *
+ *  The counter-based version of uniform_int().
+ */
+int
+gmx_rng_cb_uniform_int(gmx_rng_cb_t *rng,int max);
+
+
+/*! \brief Gaussian random real from the stream of a counter-based RNG
+ *
+ *  Uses the Box-Muller algorithm as gmx_rng_gaussian_real(),
+ *  but does not save the second number, so the numbers drawn
+ *  after a restart do not depend on earlier draws.
+ */
+real
+gmx_rng_cb_gaussian_real(gmx_rng_cb_t *rng);
+
+
+/*! \brief Tabulated gaussian random real from a counter-based RNG
+ *
+ *  Uses the same table as gmx_rng_gaussian_table(), one 32-bit integer
+ *  of the stream is used per number.
+ */
+real
+gmx_rng_cb_gaussian_table(gmx_rng_cb_t *rng);
+
+
+/*! \brief Fills an array with tabulated gaussians from a counter-based RNG
+ *
+ *  For n streams of step, g[i*nper+k] for k<nper is set to the k-th number
+ *  that gmx_rng_cb_gaussian_table() returns after a restart with index[i],
+ *  or offset+i when index=NULL. Only the key of rng is used. With SSE2
+ *  four streams are generated at once, the numbers are the same.
+ *
+ *  \threadsafe Yes.
+ */
+void
+gmx_rng_cb_gaussian_table_batch(const gmx_rng_cb_t *rng,gmx_step_t step,
+                                int n,const int *index,int offset,
+                                int nper,real *g);
+
+
+/*! \brief Fills an array with uniform reals from a counter-based RNG
+ *
+ *  As gmx_rng_cb_gaussian_table_batch(), but u[i*nper+k] is set to the
+ *  k-th number that gmx_rng_cb_uniform_real() returns after a restart.
+ *
+ *  \threadsafe Yes.
+ */
+void
+gmx_rng_cb_uniform_real_batch(const gmx_rng_cb_t *rng,gmx_step_t step,
+                              int n,const int *index,int offset,
+                              int nper,real *u);
+
+
 #endif /* _GMX_RANDOM_H_ */
 
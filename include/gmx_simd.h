@@ -0,0 +1,609 @@
+/* -*- mode: c; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4; c-file-style: "stroustrup"; -*-
+ *
+ *
+ *                This source code is part of
+ *
+ *                 G   R   O   M   A   C   S
+ *
+ *          GROningen MAchine for Chemical Simulations
+ *
+ *                        VERSION 3.2.0
+ * Written by David van der Spoel, Erik Lindahl, Berk Hess, and others.
+ * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
+ * Copyright (c) 2001-2004, The GROMACS development team,
+ * check out http://www.gromacs.org for more information.
+
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * If you want to redistribute modifications, please consider that
+ * scientific software is very special. Version control is crucial -
+ * bugs must be traceable. We will be happy to consider code for
+ * inclusion in the official distribution, but derived work must not
+ * be called official GROMACS. Details are found in the README & COPYING
+ * files - if they are missing, get the official version at www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the papers on the package - you can find them in the top README file.
+ *
+ * For more info, check our website at http://www.gromacs.org
+ *
+ * And Hey:
+ * Gromacs Runs On Most of All Computer Systems
+ */
+#ifndef _gmx_simd_h
+#define _gmx_simd_h
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+#include "types/simple.h"
+
+/* A width-agnostic SIMD layer for real-valued kernels.
+ *
+ * Code written against this header handles GMX_SIMD_WIDTH reals at
+ * a time in a gmx_simd_real_t and never refers to the underlying
+ * instruction set, so the same source can be compiled for AVX (256-bit),
+ * SSE2 (128-bit) or, without either, as plain scalar C with width 1.
+ * The nonbonded kernels in src/gmxlib/nonbonded/nb_kernel_simd are
+ * generated by mknb -simd and only use the operations below.
+ *
+ * Besides the arithmetic, the layer provides the memory operations the
+ * kernels need: gathers from index lists, scatter-decrement of forces,
+ * cubic spline table loads and the j-index/mask setup for a chunk
+ * of a neighborlist. Masks have all bits set in valid lanes and are
+ * applied with gmx_simd_and(). The functions exp and erfc, needed for
+ * Buckingham and Ewald without tables, are computed from polynomials.
+ */
+
+#define GMX_SIMD_CONCAT2(a,b)   a##_##b
+#define GMX_SIMD_CONCAT(a,b)    GMX_SIMD_CONCAT2(a,b)
+/* Appends the target suffix (e.g. _sse2_single) to a function name */
+#define GMX_SIMD_NAME(name)     GMX_SIMD_CONCAT(name,GMX_SIMD_SUFFIX)
+
+
+#if defined(GMX_AVX)
+
+#include <immintrin.h>
+
+#ifndef GMX_DOUBLE
+
+#define GMX_SIMD_WIDTH          8
+#define GMX_SIMD_SUFFIX         avx_single
+typedef __m256                  gmx_simd_real_t;
+
+#define gmx_simd_setzero        _mm256_setzero_ps
+#define gmx_simd_set1           _mm256_set1_ps
+#define gmx_simd_storeu         _mm256_storeu_ps
+#define gmx_simd_add            _mm256_add_ps
+#define gmx_simd_sub            _mm256_sub_ps
+#define gmx_simd_mul            _mm256_mul_ps
+#define gmx_simd_div            _mm256_div_ps
+#define gmx_simd_sqrt           _mm256_sqrt_ps
+#define gmx_simd_max            _mm256_max_ps
+#define gmx_simd_min            _mm256_min_ps
+#define gmx_simd_and            _mm256_and_ps
+#define gmx_simd_cmplt(a,b)     _mm256_cmp_ps(a,b,_CMP_LT_OQ)
+#define gmx_simd_trunc(a)       _mm256_round_ps(a,_MM_FROUND_TO_ZERO)
+#define gmx_simd_round(a)       _mm256_round_ps(a,_MM_FROUND_TO_NEAREST_INT)
+#define gmx_simd_lane_offsets() _mm256_setr_ps(0,1,2,3,4,5,6,7)
+
+static inline gmx_simd_real_t
+gmx_simd_gather(const real *base,const int *idx)
+{
+    return _mm256_setr_ps(base[idx[0]],base[idx[1]],base[idx[2]],base[idx[3]],
+                          base[idx[4]],base[idx[5]],base[idx[6]],base[idx[7]]);
+}
+
+static inline gmx_simd_real_t
+gmx_simd_invsqrt(gmx_simd_real_t x)
+{
+    const __m256 half  = _mm256_set1_ps(0.5);
+    const __m256 three = _mm256_set1_ps(3.0);
+    __m256 lu;
+
+    lu = _mm256_rsqrt_ps(x);
+    return _mm256_mul_ps(_mm256_mul_ps(half,lu),
+                         _mm256_sub_ps(three,_mm256_mul_ps(_mm256_mul_ps(lu,lu),x)));
+}
+
+static inline gmx_simd_real_t
+gmx_simd_inv(gmx_simd_real_t x)
+{
+    const __m256 two = _mm256_set1_ps(2.0);
+    __m256 lu;
+
+    lu = _mm256_rcp_ps(x);
+    return _mm256_mul_ps(lu,_mm256_sub_ps(two,_mm256_mul_ps(lu,x)));
+}
+
+/* 2^n for integer-valued n. AVX has no 256-bit integer operations,
+ * so the exponent is built separately in the two 128-bit halves.
+ */
+static inline gmx_simd_real_t
+gmx_simd_pow2n(gmx_simd_real_t n)
+{
+    const __m128i bias = _mm_set1_epi32(127);
+    __m128i lo,hi;
+
+    lo = _mm_cvtps_epi32(_mm256_castps256_ps128(n));
+    hi = _mm_cvtps_epi32(_mm256_extractf128_ps(n,1));
+    lo = _mm_slli_epi32(_mm_add_epi32(lo,bias),23);
+    hi = _mm_slli_epi32(_mm_add_epi32(hi,bias),23);
+
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_castsi128_ps(lo)),
+                                _mm_castsi128_ps(hi),1);
+}
+
+#else /* GMX_DOUBLE */
+
+#define GMX_SIMD_WIDTH          4
+#define GMX_SIMD_SUFFIX         avx_double
+typedef __m256d                 gmx_simd_real_t;
+
+#define gmx_simd_setzero        _mm256_setzero_pd
+#define gmx_simd_set1           _mm256_set1_pd
+#define gmx_simd_storeu         _mm256_storeu_pd
+#define gmx_simd_add            _mm256_add_pd
+#define gmx_simd_sub            _mm256_sub_pd
+#define gmx_simd_mul            _mm256_mul_pd
+#define gmx_simd_div            _mm256_div_pd
+#define gmx_simd_sqrt           _mm256_sqrt_pd
+#define gmx_simd_max            _mm256_max_pd
+#define gmx_simd_min            _mm256_min_pd
+#define gmx_simd_and            _mm256_and_pd
+#define gmx_simd_cmplt(a,b)     _mm256_cmp_pd(a,b,_CMP_LT_OQ)
+#define gmx_simd_trunc(a)       _mm256_round_pd(a,_MM_FROUND_TO_ZERO)
+#define gmx_simd_round(a)       _mm256_round_pd(a,_MM_FROUND_TO_NEAREST_INT)
+#define gmx_simd_lane_offsets() _mm256_setr_pd(0,1,2,3)
+
+static inline gmx_simd_real_t
+gmx_simd_gather(const real *base,const int *idx)
+{
+    return _mm256_setr_pd(base[idx[0]],base[idx[1]],base[idx[2]],base[idx[3]]);
+}
+
+/* Single precision lookup followed by two Newton-Raphson iterations */
+static inline gmx_simd_real_t
+gmx_simd_invsqrt(gmx_simd_real_t x)
+{
+    const __m256d half  = _mm256_set1_pd(0.5);
+    const __m256d three = _mm256_set1_pd(3.0);
+    __m256d lu;
+
+    lu = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(x)));
+    lu = _mm256_mul_pd(_mm256_mul_pd(half,lu),
+                       _mm256_sub_pd(three,_mm256_mul_pd(_mm256_mul_pd(lu,lu),x)));
+    return _mm256_mul_pd(_mm256_mul_pd(half,lu),
+                         _mm256_sub_pd(three,_mm256_mul_pd(_mm256_mul_pd(lu,lu),x)));
+}
+
+static inline gmx_simd_real_t
+gmx_simd_inv(gmx_simd_real_t x)
+{
+    return _mm256_div_pd(_mm256_set1_pd(1.0),x);
+}
+
+static inline gmx_simd_real_t
+gmx_simd_pow2n(gmx_simd_real_t n)
+{
+    const __m128i bias = _mm_set1_epi32(1023);
+    __m128i ni,lo,hi;
+
+    ni = _mm_add_epi32(_mm256_cvtpd_epi32(n),bias);
+    lo = _mm_slli_epi64(_mm_unpacklo_epi32(ni,_mm_setzero_si128()),52);
+    hi = _mm_slli_epi64(_mm_unpackhi_epi32(ni,_mm_setzero_si128()),52);
+
+    return _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_castsi128_pd(lo)),
+                                _mm_castsi128_pd(hi),1);
+}
+
+#endif /* GMX_DOUBLE */
+
+#elif defined(GMX_SSE2)
+
+#include <emmintrin.h>
+
+#ifndef GMX_DOUBLE
+
+#define GMX_SIMD_WIDTH          4
+#define GMX_SIMD_SUFFIX         sse2_single
+typedef __m128                  gmx_simd_real_t;
+
+#define gmx_simd_setzero        _mm_setzero_ps
+#define gmx_simd_set1           _mm_set1_ps
+#define gmx_simd_storeu         _mm_storeu_ps
+#define gmx_simd_add            _mm_add_ps
+#define gmx_simd_sub            _mm_sub_ps
+#define gmx_simd_mul            _mm_mul_ps
+#define gmx_simd_div            _mm_div_ps
+#define gmx_simd_sqrt           _mm_sqrt_ps
+#define gmx_simd_max            _mm_max_ps
+#define gmx_simd_min            _mm_min_ps
+#define gmx_simd_and            _mm_and_ps
+#define gmx_simd_cmplt          _mm_cmplt_ps
+#define gmx_simd_trunc(a)       _mm_cvtepi32_ps(_mm_cvttps_epi32(a))
+#define gmx_simd_round(a)       _mm_cvtepi32_ps(_mm_cvtps_epi32(a))
+#define gmx_simd_lane_offsets() _mm_setr_ps(0,1,2,3)
+
+static inline gmx_simd_real_t
+gmx_simd_gather(const real *base,const int *idx)
+{
+    return _mm_setr_ps(base[idx[0]],base[idx[1]],base[idx[2]],base[idx[3]]);
+}
+
+static inline gmx_simd_real_t
+gmx_simd_invsqrt(gmx_simd_real_t x)
+{
+    const __m128 half  = _mm_set1_ps(0.5);
+    const __m128 three = _mm_set1_ps(3.0);
+    __m128 lu;
+
+    lu = _mm_rsqrt_ps(x);
+    return _mm_mul_ps(_mm_mul_ps(half,lu),
+                      _mm_sub_ps(three,_mm_mul_ps(_mm_mul_ps(lu,lu),x)));
+}
+
+static inline gmx_simd_real_t
+gmx_simd_inv(gmx_simd_real_t x)
+{
+    const __m128 two = _mm_set1_ps(2.0);
+    __m128 lu;
+
+    lu = _mm_rcp_ps(x);
+    return _mm_mul_ps(lu,_mm_sub_ps(two,_mm_mul_ps(lu,x)));
+}
+
+static inline gmx_simd_real_t
+gmx_simd_pow2n(gmx_simd_real_t n)
+{
+    __m128i ni;
+
+    ni = _mm_add_epi32(_mm_cvtps_epi32(n),_mm_set1_epi32(127));
+    return _mm_castsi128_ps(_mm_slli_epi32(ni,23));
+}
+
+/* A table point is four consecutive floats, so load each lane
+ * with one unaligned load and transpose.
+ */
+#define GMX_SIMD_HAVE_TABLE_LOAD
+static inline void
+gmx_simd_table_load(const real *tab,const int *idx,
+                    gmx_simd_real_t *Y,gmx_simd_real_t *F,
+                    gmx_simd_real_t *G,gmx_simd_real_t *H)
+{
+    __m128 t0,t1,t2,t3;
+
+    t0 = _mm_loadu_ps(tab+idx[0]);
+    t1 = _mm_loadu_ps(tab+idx[1]);
+    t2 = _mm_loadu_ps(tab+idx[2]);
+    t3 = _mm_loadu_ps(tab+idx[3]);
+    _MM_TRANSPOSE4_PS(t0,t1,t2,t3);
+    *Y = t0;
+    *F = t1;
+    *G = t2;
+    *H = t3;
+}
+
+#else /* GMX_DOUBLE */
+
+#define GMX_SIMD_WIDTH          2
+#define GMX_SIMD_SUFFIX         sse2_double
+typedef __m128d                 gmx_simd_real_t;
+
+#define gmx_simd_setzero        _mm_setzero_pd
+#define gmx_simd_set1           _mm_set1_pd
+#define gmx_simd_storeu         _mm_storeu_pd
+#define gmx_simd_add            _mm_add_pd
+#define gmx_simd_sub            _mm_sub_pd
+#define gmx_simd_mul            _mm_mul_pd
+#define gmx_simd_div            _mm_div_pd
+#define gmx_simd_sqrt           _mm_sqrt_pd
+#define gmx_simd_max            _mm_max_pd
+#define gmx_simd_min            _mm_min_pd
+#define gmx_simd_and            _mm_and_pd
+#define gmx_simd_cmplt          _mm_cmplt_pd
+#define gmx_simd_trunc(a)       _mm_cvtepi32_pd(_mm_cvttpd_epi32(a))
+#define gmx_simd_round(a)       _mm_cvtepi32_pd(_mm_cvtpd_epi32(a))
+#define gmx_simd_lane_offsets() _mm_setr_pd(0,1)
+
+static inline gmx_simd_real_t
+gmx_simd_gather(const real *base,const int *idx)
+{
+    return _mm_setr_pd(base[idx[0]],base[idx[1]]);
+}
+
+static inline gmx_simd_real_t
+gmx_simd_invsqrt(gmx_simd_real_t x)
+{
+    const __m128d half  = _mm_set1_pd(0.5);
+    const __m128d three = _mm_set1_pd(3.0);
+    __m128d lu;
+
+    lu = _mm_cvtps_pd(_mm_rsqrt_ps(_mm_cvtpd_ps(x)));
+    lu = _mm_mul_pd(_mm_mul_pd(half,lu),
+                    _mm_sub_pd(three,_mm_mul_pd(_mm_mul_pd(lu,lu),x)));
+    return _mm_mul_pd(_mm_mul_pd(half,lu),
+                      _mm_sub_pd(three,_mm_mul_pd(_mm_mul_pd(lu,lu),x)));
+}
+
+static inline gmx_simd_real_t
+gmx_simd_inv(gmx_simd_real_t x)
+{
+    return _mm_div_pd(_mm_set1_pd(1.0),x);
+}
+
+static inline gmx_simd_real_t
+gmx_simd_pow2n(gmx_simd_real_t n)
+{
+    __m128i ni;
+
+    ni = _mm_add_epi32(_mm_cvtpd_epi32(n),_mm_set1_epi32(1023));
+    ni = _mm_unpacklo_epi32(ni,_mm_setzero_si128());
+    return _mm_castsi128_pd(_mm_slli_epi64(ni,52));
+}
+
+#endif /* GMX_DOUBLE */
+
+#else /* No SIMD instructions, plain C with width 1 */
+
+#define GMX_SIMD_WIDTH          1
+#ifdef GMX_DOUBLE
+#define GMX_SIMD_SUFFIX         ref_double
+#else
+#define GMX_SIMD_SUFFIX         ref_single
+#endif
+typedef real                    gmx_simd_real_t;
+
+#define gmx_simd_setzero()      ((real)0)
+#define gmx_simd_set1(a)        ((real)(a))
+#define gmx_simd_storeu(p,a)    (*(p) = (a))
+#define gmx_simd_add(a,b)       ((a)+(b))
+#define gmx_simd_sub(a,b)       ((a)-(b))
+#define gmx_simd_mul(a,b)       ((a)*(b))
+#define gmx_simd_div(a,b)       ((a)/(b))
+#define gmx_simd_sqrt(a)        sqrt(a)
+#define gmx_simd_max(a,b)       ((a) > (b) ? (a) : (b))
+#define gmx_simd_min(a,b)       ((a) < (b) ? (a) : (b))
+/* With a single lane the mask is 1 for a valid and 0 for an invalid lane */
+#define gmx_simd_and(a,b)       ((a)*(b))
+#define gmx_simd_cmplt(a,b)     ((a) < (b) ? (real)1 : (real)0)
+#define gmx_simd_trunc(a)       ((real)(int)(a))
+#define gmx_simd_round(a)       ((real)floor((a)+0.5))
+#define gmx_simd_lane_offsets() ((real)0)
+#define gmx_simd_gather(b,i)    ((b)[(i)[0]])
+#define gmx_simd_invsqrt(a)     (1.0/sqrt(a))
+#define gmx_simd_inv(a)         (1.0/(a))
+#define gmx_simd_pow2n(a)       ((real)ldexp(1.0,(int)(a)))
+
+#endif
+
+
+/* Generic operations in terms of the target-specific ones above */
+
+
+/* Sets up the j-atom indices for (at most) the next GMX_SIMD_WIDTH
+ * entries of the neighborlist jjnr, where nleft is the number of entries
+ * remaining. Lanes beyond the end of the list repeat the first j atom,
+ * so all loads stay valid; they are cleared in *mask.
+ * Also sets j3 to three times the indices and returns the number of
+ * valid lanes.
+ */
+static inline int
+gmx_simd_load_jindex(const int *jjnr,int nleft,int *jnr,int *j3,
+                     gmx_simd_real_t *mask)
+{
+    int l,n;
+
+    n = (nleft < GMX_SIMD_WIDTH) ? nleft : GMX_SIMD_WIDTH;
+    for(l=0; l<n; l++)
+    {
+        jnr[l] = jjnr[l];
+        j3[l]  = 3*jnr[l];
+    }
+    for(; l<GMX_SIMD_WIDTH; l++)
+    {
+        jnr[l] = jnr[0];
+        j3[l]  = j3[0];
+    }
+    *mask = gmx_simd_cmplt(gmx_simd_lane_offsets(),gmx_simd_set1(n));
+
+    return n;
+}
+
+/* Sets idx to the offsets of the VdW parameters of i-atom type offset
+ * nti with the types of the j atoms.
+ */
+static inline void
+gmx_simd_vdw_index(int *idx,int nti,int nparam,const int *type,const int *jnr)
+{
+    int l;
+
+    for(l=0; l<GMX_SIMD_WIDTH; l++)
+    {
+        idx[l] = nti + nparam*type[jnr[l]];
+    }
+}
+
+/* Returns rt truncated to an integer value and sets idx to stride
+ * times that integer, for looking up rt in a cubic spline table.
+ * rt should be non-negative.
+ */
+static inline gmx_simd_real_t
+gmx_simd_table_index(gmx_simd_real_t rt,int stride,int *idx)
+{
+    gmx_simd_real_t n0;
+    real            buf[GMX_SIMD_WIDTH];
+    int             l;
+
+    n0 = gmx_simd_trunc(rt);
+    gmx_simd_storeu(buf,n0);
+    for(l=0; l<GMX_SIMD_WIDTH; l++)
+    {
+        idx[l] = stride*(int)buf[l];
+    }
+
+    return n0;
+}
+
+#ifndef GMX_SIMD_HAVE_TABLE_LOAD
+static inline void
+gmx_simd_table_load(const real *tab,const int *idx,
+                    gmx_simd_real_t *Y,gmx_simd_real_t *F,
+                    gmx_simd_real_t *G,gmx_simd_real_t *H)
+{
+    *Y = gmx_simd_gather(tab,  idx);
+    *F = gmx_simd_gather(tab+1,idx);
+    *G = gmx_simd_gather(tab+2,idx);
+    *H = gmx_simd_gather(tab+3,idx);
+}
+#endif
+
+/* Loads the coordinates at base+idx[l] of each lane */
+static inline void
+gmx_simd_gather_rvec(const real *base,const int *idx,
+                     gmx_simd_real_t *x,gmx_simd_real_t *y,gmx_simd_real_t *z)
+{
+    *x = gmx_simd_gather(base,  idx);
+    *y = gmx_simd_gather(base+1,idx);
+    *z = gmx_simd_gather(base+2,idx);
+}
+
+/* Subtracts the first n lanes of x,y,z from the rvecs at base+idx[l].
+ * Lanes are processed in order, so indices may not repeat within
+ * the first n lanes.
+ */
+static inline void
+gmx_simd_decrement_rvec(real *base,const int *idx,int n,
+                        gmx_simd_real_t x,gmx_simd_real_t y,gmx_simd_real_t z)
+{
+    real bx[GMX_SIMD_WIDTH],by[GMX_SIMD_WIDTH],bz[GMX_SIMD_WIDTH];
+    int  l;
+
+    gmx_simd_storeu(bx,x);
+    gmx_simd_storeu(by,y);
+    gmx_simd_storeu(bz,z);
+    for(l=0; l<n; l++)
+    {
+        base[idx[l]]   -= bx[l];
+        base[idx[l]+1] -= by[l];
+        base[idx[l]+2] -= bz[l];
+    }
+}
+
+/* Returns the sum of all lanes */
+static inline real
+gmx_simd_reduce(gmx_simd_real_t a)
+{
+    real buf[GMX_SIMD_WIDTH],sum;
+    int  l;
+
+    gmx_simd_storeu(buf,a);
+    sum = 0;
+    for(l=0; l<GMX_SIMD_WIDTH; l++)
+    {
+        sum += buf[l];
+    }
+
+    return sum;
+}
+
+/* exp(x) from a polynomial after range reduction to |r| <= ln(2)/2,
+ * accurate to about one unit in the last place. Arguments are clamped
+ * to the range where the result is a normal number.
+ */
+static inline gmx_simd_real_t
+gmx_simd_exp(gmx_simd_real_t x)
+{
+#ifdef GMX_DOUBLE
+    const real maxarg  = 708.0;
+    const real ln2_hi  = 6.93145751953125e-1;
+    const real ln2_lo  = 1.42860682030941723212e-6;
+    const int  ncoeff  = 12;
+#else
+    const real maxarg  = 87.0;
+    const real ln2_hi  = 6.93359375e-1;
+    const real ln2_lo  = -2.12194440e-4;
+    const int  ncoeff  = 7;
+#endif
+    gmx_simd_real_t n,r,p;
+    int             i;
+
+    x = gmx_simd_min(gmx_simd_max(x,gmx_simd_set1(-maxarg)),gmx_simd_set1(maxarg));
+    n = gmx_simd_round(gmx_simd_mul(x,gmx_simd_set1(1.44269504088896341)));
+    r = gmx_simd_sub(gmx_simd_sub(x,gmx_simd_mul(n,gmx_simd_set1(ln2_hi))),
+                     gmx_simd_mul(n,gmx_simd_set1(ln2_lo)));
+
+    /* Taylor series in Horner form: 1 + r(1 + r/2(1 + r/3(...))) */
+    p = gmx_simd_set1(1.0);
+    for(i=ncoeff; i>=1; i--)
+    {
+        p = gmx_simd_add(gmx_simd_set1(1.0),
+                         gmx_simd_mul(gmx_simd_mul(r,gmx_simd_set1(1.0/i)),p));
+    }
+
+    return gmx_simd_mul(p,gmx_simd_pow2n(n));
+}
+
+/* The scaled complementary error function erfcx(x) = exp(x^2) erfc(x)
+ * for x >= 0, as t P(t) with t = 1/(1 + x/2.5) and P a Chebyshev fit
+ * converted to monomial form. The maximum relative error is 7e-8 in
+ * single precision for x <= 4.5 and 4e-15 in double precision for
+ * x <= 6. Larger arguments are clamped; erfc itself is then below
+ * the precision anyway. Together with gmx_simd_exp this gives erfc
+ * without tables, with the exp(-x^2) factor shared with the force.
+ */
+static inline gmx_simd_real_t
+gmx_simd_erfcx(gmx_simd_real_t x)
+{
+#ifdef GMX_DOUBLE
+    static const real coeff[] = {
+        0.2256759041566698,     0.22567472254774648,
+        0.2076196641458796,     0.17171878653043024,
+        0.11910268496458311,    0.08524890452026057,
+        -0.0713766865527802,    0.30118343004414516,
+        -0.8539363629234147,    1.6376849362700197,
+        -2.479925019846904,     2.77508837209897,
+        -2.1808058928592775,    1.1709358791872682,
+        -0.41178950115385443,   0.08604262470077673,
+        -0.008142445830519311 };
+    const real maxarg = 6.0;
+#else
+    static const real coeff[] = {
+        0.2246854224119535,     0.23945167271028672,
+        0.12536384115552604,    0.44562730887183033,
+        -0.4298309855968242,    0.7343448118479062,
+        -0.4189810724807056,    0.07933900120210606 };
+    const real maxarg = 4.5;
+#endif
+    const int       ncoeff = sizeof(coeff)/sizeof(coeff[0]);
+    gmx_simd_real_t t,p;
+    int             i;
+
+    x = gmx_simd_min(x,gmx_simd_set1(maxarg));
+    t = gmx_simd_inv(gmx_simd_add(gmx_simd_set1(1.0),
+                                  gmx_simd_mul(x,gmx_simd_set1(0.4))));
+
+    p = gmx_simd_set1(coeff[ncoeff-1]);
+    for(i=ncoeff-2; i>=0; i--)
+    {
+        p = gmx_simd_add(gmx_simd_set1(coeff[i]),gmx_simd_mul(p,t));
+    }
+
+    return gmx_simd_mul(p,t);
+}
+
+/* erfc(x) for x >= 0 */
+static inline gmx_simd_real_t
+gmx_simd_erfc(gmx_simd_real_t x)
+{
+    return gmx_simd_mul(gmx_simd_erfcx(x),
+                        gmx_simd_exp(gmx_simd_sub(gmx_simd_setzero(),
+                                                  gmx_simd_mul(x,x))));
+}
+
+#endif /* _gmx_simd_h */
@@ -0,0 +1,70 @@
+/*
+ * 
+ *                This source code is part of
+ * 
+ *                 G   R   O   M   A   C   S
+ * 
+ *          GROningen MAchine for Chemical Simulations
+ * 
+ *                        VERSION 3.2.0
+ * Written by David van der Spoel, Erik Lindahl, Berk Hess, and others.
+ * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
+ * Copyright (c) 2001-2004, The GROMACS development team,
+ * check out http://www.gromacs.org for more information.
+
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * If you want to redistribute modifications, please consider that
+ * scientific software is very special. Version control is crucial -
+ * bugs must be traceable. We will be happy to consider code for
+ * inclusion in the official distribution, but derived work must not
+ * be called official GROMACS. Details are found in the README & COPYING
+ * files - if they are missing, get the official version at www.gromacs.org.
+ * 
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the papers on the package - you can find them in the top README file.
+ * 
+ * For more info, check our website at http://www.gromacs.org
+ * 
+ * And Hey:
+ * Gromacs Runs On Most of All Computer Systems
+ */
+
+#ifndef _gmx_thread_pool_h
+#define _gmx_thread_pool_h
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+typedef struct gmx_thread_pool *gmx_thread_pool_t;
+/* Abstract type for a pool of worker threads that stay alive between
+ * calls, so short parallel tasks do not pay for thread creation.
+ */
+
+typedef void (*gmx_thread_pool_func_t)(void *data,int task,int thread);
+/* Function executed for each task, thread is the index of the thread
+ * (0 is the calling thread) running it, smaller than the pool size.
+ */
+
+extern gmx_thread_pool_t gmx_thread_pool_init(int nthreads);
+/* Starts a pool of nthreads threads, including the calling thread.
+ * Without thread support the pool always has a single thread.
+ */
+
+extern int gmx_thread_pool_nthreads(gmx_thread_pool_t pool);
+/* Returns the number of threads in the pool */
+
+extern void gmx_thread_pool_run(gmx_thread_pool_t pool,int ntask,
+				gmx_thread_pool_func_t func,void *data);
+/* Runs func for tasks 0 to ntask-1 and returns when all are done.
+ * Task t is always executed by thread t % nthreads.
+ */
+
+extern void gmx_thread_pool_done(gmx_thread_pool_t pool);
+/* Stops the worker threads and frees the pool */
+
+#endif	/* _gmx_thread_pool_h */
@@ -39,7 +39,7 @@
 #include <stdio.h>
 #include "typedefs.h"
 
-enum { ewcRUN, ewcSTEP, ewcPPDURINGPME, ewcDOMDEC, ewcDDCOMMLOAD, ewcDDCOMMBOUND, ewcVSITECONSTR, ewcPP_PMESENDX, ewcMOVEX, ewcNS, ewcFORCE, ewcMOVEF, ewcPMEMESH, ewcPMEMESH_SEP, ewcPMEWAITCOMM, ewcPP_PMEWAITRECVF, ewcVSITESPREAD, ewcTRAJ, ewcUPDATE, ewcCONSTR, ewcMoveE, ewcTEST, ewcGB, ewcNR };
+enum { ewcRUN, ewcSTEP, ewcPPDURINGPME, ewcDOMDEC, ewcDDCOMMLOAD, ewcDDCOMMBOUND, ewcVSITECONSTR, ewcPP_PMESENDX, ewcMOVEX, ewcNS, ewcFORCE, ewcMOVEF, ewcPMEMESH, ewcPMEMESH_SEP, ewcPMEWAITCOMM, ewcPP_PMEWAITRECVF, ewcVSITESPREAD, ewcTRAJ, ewcUPDATE, ewcCONSTR, ewcMoveE, ewcTEST, ewcGB, ewcMC_MOVE, ewcMC_NS, ewcMC_ENER, ewcMC_ACCEPT, ewcMC_SWEEP, ewcNR };
 
 extern bool wallcycle_have_counter(void);
 /* Returns if cycle counting is supported */
@@ -65,6 +65,15 @@ extern void wallcycle_print(FILE *fplog, int nnodes, int npme, double realtime,
 			    gmx_wallcycle_t wc, double cycles[]);
 /* Print the cycle and time accounting */
 
+extern void wallcycle_mc_group(gmx_wallcycle_t wc, int mvgroup);
+/* Charge the counters stopped from now on also to MC move group mvgroup,
+ * MC_NR is the volume move, -1 stops the per move group accounting.
+ */
+
+extern void wallcycle_mc_count(gmx_wallcycle_t wc, int mvgroup,
+			       int nac, int ntot);
+/* Add nac accepted out of ntot MC moves of move group mvgroup */
+
 extern gmx_step_t wcycle_get_reset_counters(gmx_wallcycle_t wc);
 /* Return reset_counters from wc struct */
 
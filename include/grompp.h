@@ -98,6 +98,7 @@ typedef struct {
   t_ilist       mc_angles;
   t_ilist       mc_dihedrals;
   t_ilist       mc_cra;
+  t_ilist       mc_regrow;
 } t_molinfo;
 
 typedef struct {
@@ -169,6 +170,7 @@ typedef enum {
   d_mcangles,
   d_mcdihedrals,
   d_mccra,
+  d_mcregrow,
   d_maxdir,
   d_invalid,
   d_none
@@ -217,6 +219,7 @@ static const char *ds[d_maxdir+1] = {
   "MC_angles",
   "MC_dihedrals",
   "MC_CRA",
+  "MC_regrow",
   "invalid"
   };
 
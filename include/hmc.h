@@ -0,0 +1,89 @@
+/*
+ * 
+ *                This source code is part of
+ * 
+ *                 G   R   O   M   A   C   S
+ * 
+ *          GROningen MAchine for Chemical Simulations
+ * 
+ *                        VERSION 3.2.0
+ * Written by David van der Spoel, Erik Lindahl, Berk Hess, and others.
+ * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
+ * Copyright (c) 2001-2004, The GROMACS development team,
+ * check out http://www.gromacs.org for more information.
+
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * If you want to redistribute modifications, please consider that
+ * scientific software is very special. Version control is crucial -
+ * bugs must be traceable. We will be happy to consider code for
+ * inclusion in the official distribution, but derived work must not
+ * be called official GROMACS. Details are found in the README & COPYING
+ * files - if they are missing, get the official version at www.gromacs.org.
+ * 
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the papers on the package - you can find them in the top README file.
+ * 
+ * For more info, check our website at http://www.gromacs.org
+ * 
+ * And Hey:
+ * Gromacs Runs On Most of All Computer Systems
+ */
+
+#ifndef _hmc_h
+#define _hmc_h
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "typedefs.h"
+
+typedef struct gmx_hmc *gmx_hmc_t;
+/* Abstract type for hybrid Monte Carlo trajectories */
+
+extern gmx_hmc_t init_hmc(FILE *fplog,t_commrec *cr,t_inputrec *ir,
+			  int natoms);
+/* Sets up hybrid Monte Carlo with trajectories of ir->hmc_nsteps MD steps
+ * at temperature ref_t[0], returns NULL when ir->eI is not eiHMC.
+ * natoms is the total number of atoms, needed for the rollback with DD.
+ */
+
+extern void hmc_start(gmx_hmc_t hmc,t_commrec *cr,t_inputrec *ir,
+		      gmx_step_t step,t_mdatoms *md,gmx_constr_t constr,
+		      t_idef *idef,t_state *state,rvec f[],
+		      gmx_enerdata_t *enerd,tensor force_vir,t_nrnb *nrnb);
+/* Starts a trajectory from the current configuration, f and enerd should
+ * be the forces and energies for it. Velocities are drawn from the Maxwell
+ * distribution and projected on the constraints. The configuration is
+ * stored for a rollback and v is set half a step back, such that
+ * the leap-frog update integrates the trajectory as velocity Verlet.
+ */
+
+extern real hmc_end(gmx_hmc_t hmc,t_commrec *cr,t_inputrec *ir,
+		    gmx_step_t step,t_mdatoms *md,gmx_constr_t constr,
+		    t_idef *idef,t_state *state,rvec f[],
+		    gmx_enerdata_t *enerd,t_nrnb *nrnb,real *bolt);
+/* Ends the trajectory at the current configuration, f and enerd should
+ * be the forces and energies for it. Returns the global change in total
+ * energy, bolt returns a uniform random number for the step,
+ * to be used for the acceptance with accept_mc.
+ */
+
+extern void hmc_finish(gmx_hmc_t hmc,t_commrec *cr,bool bAccept,
+		       t_mdatoms *md,t_state *state,rvec f[],
+		       gmx_enerdata_t *enerd,tensor force_vir,
+		       t_state *state_global);
+/* Counts the trajectory and on rejection restores the configuration,
+ * forces and energies of the start. With domain decomposition only
+ * the coordinates are restored, in state_global on the master,
+ * the system should then be repartitioned and the forces recomputed.
+ */
+
+extern void done_hmc(FILE *fplog,gmx_hmc_t hmc);
+/* Prints the acceptance ratio and frees the hybrid Monte Carlo data */
+
+#endif	/* _hmc_h */
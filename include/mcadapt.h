@@ -0,0 +1,84 @@
+/*
+ * 
+ *                This source code is part of
+ * 
+ *                 G   R   O   M   A   C   S
+ * 
+ *          GROningen MAchine for Chemical Simulations
+ * 
+ *                        VERSION 3.2.0
+ * Written by David van der Spoel, Erik Lindahl, Berk Hess, and others.
+ * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
+ * Copyright (c) 2001-2004, The GROMACS development team,
+ * check out http://www.gromacs.org for more information.
+
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * If you want to redistribute modifications, please consider that
+ * scientific software is very special. Version control is crucial -
+ * bugs must be traceable. We will be happy to consider code for
+ * inclusion in the official distribution, but derived work must not
+ * be called official GROMACS. Details are found in the README & COPYING
+ * files - if they are missing, get the official version at www.gromacs.org.
+ * 
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the papers on the package - you can find them in the top README file.
+ * 
+ * For more info, check our website at http://www.gromacs.org
+ * 
+ * And Hey:
+ * Gromacs Runs On Most of All Computer Systems
+ */
+
+#ifndef _mcadapt_h
+#define _mcadapt_h
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include "typedefs.h"
+#include "gmx_random.h"
+
+/* Online tuning of the MC move set during equilibration.
+ * Every mc_adapt_nst steps up to mc_adapt_steps, the step size of each
+ * move group is scaled towards the acceptance ratio mc_accept_target,
+ * and the move groups are selected with probabilities inversely
+ * proportional to their measured cost per move. The tuned values are
+ * stored in state->mc_delta and state->mc_prob, which are checkpointed,
+ * and are copied to the MC step size fields of the inputrec, which are
+ * used by all move generators.
+ */
+
+typedef struct gmx_mc_adapt *gmx_mc_adapt_t;
+/* Abstract type for the MC move set tuning */
+
+extern void init_mc_adapt_state(t_state *state,t_inputrec *ir);
+/* Sets the MC step sizes in state from ir and uniform move probabilities */
+
+extern gmx_mc_adapt_t init_mc_adapt(FILE *fplog,t_inputrec *ir,
+				    t_state *state);
+/* Returns NULL when mc_adapt_steps is 0. Otherwise the step sizes in
+ * state, which might have been read from a checkpoint, are copied to ir.
+ */
+
+extern int mc_adapt_select(gmx_mc_adapt_t adapt,t_state *state,
+			   gmx_rng_cb_t *rng);
+/* Returns a move group drawn with the probabilities in state */
+
+extern void mc_adapt_step(FILE *fplog,gmx_mc_adapt_t adapt,t_inputrec *ir,
+			  t_state *state,gmx_step_t step,int mvgroup);
+/* Should be called after each MC step with the group of the move that
+ * was done, MC_NR for a volume move. Charges the time since the previous
+ * call to the group and updates the step sizes and probabilities at
+ * tuning steps.
+ */
+
+extern void done_mc_adapt(gmx_mc_adapt_t adapt);
+/* Frees the tuning data */
+
+#endif	/* _mcadapt_h */
@@ -0,0 +1,223 @@
+/*
+ * 
+ *                This source code is part of
+ * 
+ *                 G   R   O   M   A   C   S
+ * 
+ *          GROningen MAchine for Chemical Simulations
+ * 
+ *                        VERSION 3.2.0
+ * Written by David van der Spoel, Erik Lindahl, Berk Hess, and others.
+ * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
+ * Copyright (c) 2001-2004, The GROMACS development team,
+ * check out http://www.gromacs.org for more information.
+
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * If you want to redistribute modifications, please consider that
+ * scientific software is very special. Version control is crucial -
+ * bugs must be traceable. We will be happy to consider code for
+ * inclusion in the official distribution, but derived work must not
+ * be called official GROMACS. Details are found in the README & COPYING
+ * files - if they are missing, get the official version at www.gromacs.org.
+ * 
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the papers on the package - you can find them in the top README file.
+ * 
+ * For more info, check our website at http://www.gromacs.org
+ * 
+ * And Hey:
+ * Gromacs Runs On Most of All Computer Systems
+ */
+
+#ifndef _mctrial_h
+#define _mctrial_h
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "typedefs.h"
+#include "gmx_random.h"
+
+extern int mc_nthreads(t_inputrec *ir,const t_commrec *cr);
+/* Returns the number of threads per process for MC trials and sweeps:
+ * the number of CPUs divided by the number of processes on the node,
+ * limited to the largest of mc_ntrial and mc_regrow_ntrial without
+ * checkerboard sweeps. Should be called by all processes of cr.
+ * Can be set with the environment variable GMX_MC_NTHREADS.
+ * The result should be stored in mc_move->nthreads before calling
+ * init_enerd_mc and the init_mc_ functions below.
+ */
+
+typedef struct gmx_mc_trials *gmx_mc_trials_t;
+/* Abstract type for multiple-trial MC moves */
+
+extern gmx_mc_trials_t init_mc_trials(FILE *fplog,t_inputrec *ir,
+				      gmx_mc_move *mc_move);
+/* Sets up ir->mc_ntrial trials per rigid molecule move, evaluated
+ * by a pool of threads, the trial moves are keyed by the step and
+ * the trial number. Returns NULL when mc_ntrial is 1 or the MC energies
+ * can not be computed incrementally (see init_enerd_mc).
+ */
+
+extern bool mc_trials_applicable(gmx_mc_trials_t trials,gmx_mc_move *mc_move);
+/* Returns if the pending move of mc_move should be done with trials */
+
+extern real do_mc_trials(gmx_mc_trials_t trials,
+			 gmx_enerdata_t *enerd,gmx_enerdata_t *enerd_prev,
+			 gmx_mc_move *mc_move,t_inputrec *ir,t_forcerec *fr,
+			 gmx_localtop_t *top,t_mdatoms *md,t_fcdata *fcd,
+			 gmx_step_t step,matrix box,rvec xprev[],rvec x[],
+			 real lambda);
+/* Multiple-try Metropolis for the molecule move set up in mc_move,
+ * x should contain the molecule moved from xprev as the first trial.
+ * ir->mc_ntrial trials from xprev are generated and evaluated,
+ * one is selected by Boltzmann weight and put in x, enerd is set
+ * as with delta_enerd_mc. Returns the energy change that gives
+ * the multiple-try acceptance probability with accept_mc.
+ */
+
+extern void done_mc_trials(gmx_mc_trials_t trials);
+/* Stops the threads and frees the trial data */
+
+typedef struct gmx_mc_dd *gmx_mc_dd_t;
+/* Abstract type for MC moves with domain decomposition */
+
+extern gmx_mc_dd_t init_mc_dd(FILE *fplog,t_commrec *cr,t_inputrec *ir,
+			      gmx_mtop_t *mtop,matrix box);
+/* Sets up MC moves with domain decomposition, returns NULL without.
+ * Only the molecules with all atoms at home and with their center
+ * of mass far enough from the cell boundaries to not interact with
+ * molecules moved on other nodes are moved.
+ * Requires pbc = xyz and a rectangular box.
+ */
+
+extern void mc_dd_shift(gmx_mc_dd_t mdd,gmx_step_t step,int homenr,rvec x[]);
+/* Shifts the home atoms by a random vector along the decomposed
+ * dimensions, drawn for step and the same on all nodes. Repartitioning
+ * afterwards moves the cell boundaries with respect to the molecules.
+ */
+
+extern void mc_dd_unshift(gmx_mc_dd_t mdd,int homenr,rvec x[]);
+/* Undoes the last mc_dd_shift on the, possibly new, home atoms */
+
+extern void mc_dd_set_local(gmx_mc_dd_t mdd,gmx_mc_move *mc_move,
+			    t_forcerec *fr,gmx_localtop_t *top,
+			    t_mdatoms *md,matrix box,rvec x[]);
+/* Sets up the moves after repartitioning and dd_move_x: determines
+ * the complete home molecules and makes them whole, copies x to the
+ * buffer returned by mc_dd_xprev and calls set_enerd_mc_top for mc_move.
+ */
+
+extern t_block *mc_dd_mols(gmx_mc_dd_t mdd);
+/* Returns the complete home molecules in local atom indices */
+
+extern rvec *mc_dd_xprev(gmx_mc_dd_t mdd);
+/* Returns the copy of the local coordinates made by mc_dd_set_local */
+
+extern void done_mc_dd(gmx_mc_dd_t mdd);
+/* Frees the domain decomposition MC data */
+
+typedef struct gmx_mc_sweep *gmx_mc_sweep_t;
+/* Abstract type for checkerboard MC sweeps */
+
+extern gmx_mc_sweep_t init_mc_sweep(FILE *fplog,t_inputrec *ir,
+				    gmx_mc_move *mc_move,t_block *mols,
+				    gmx_mc_dd_t mdd);
+/* Sets up checkerboard sweeps when ir->bMCCheckerboard is set,
+ * returns NULL otherwise. With mdd != NULL each node sweeps its home
+ * molecules.
+ */
+
+extern bool mc_sweep_applicable(gmx_mc_sweep_t sweep,gmx_mc_move *mc_move);
+/* Returns if the pending move of mc_move should be replaced by a sweep */
+
+extern void do_mc_sweep(gmx_mc_sweep_t sweep,
+			gmx_enerdata_t *enerd,gmx_enerdata_t *enerd_prev,
+			gmx_mc_move *mc_move,t_inputrec *ir,t_forcerec *fr,
+			gmx_localtop_t *top,t_block *mols,t_mdatoms *md,
+			t_fcdata *fcd,gmx_step_t step,matrix box,
+			rvec xprev[],rvec x[],real lambda,
+			int step_ac[],int step_tot[]);
+/* Does one checkerboard sweep of rigid moves over all colors, the cells
+ * of one color are swept by different threads. Each molecule in a cell
+ * gets one move, with random numbers keyed by the step and its global
+ * index, so the result does not depend on the threads or nodes
+ * as far as the cells do not. x and xprev should be
+ * equal on entry and are equal on return. The energy changes of the
+ * accepted moves are added to enerd and enerd_prev and the moves are
+ * counted in step_ac and step_tot. With domain decomposition mols
+ * and xprev should be those of mc_dd_mols and mc_dd_xprev, the energy
+ * changes and counts are summed over the nodes.
+ */
+
+extern void done_mc_sweep(gmx_mc_sweep_t sweep);
+/* Stops the threads and frees the sweep data */
+
+typedef struct gmx_mc_regrow *gmx_mc_regrow_t;
+/* Abstract type for configurational-bias regrowth moves */
+
+extern gmx_mc_regrow_t init_mc_regrow(FILE *fplog,t_inputrec *ir,
+				      gmx_mc_move *mc_move);
+/* Sets up regrowth with ir->mc_regrow_ntrial trial torsions per bond
+ * for the MC_regrow entries of mc_move. Returns NULL when there are
+ * no entries, regrowth is disabled or the MC energies can not be
+ * computed incrementally.
+ */
+
+extern bool mc_regrow_applicable(gmx_mc_regrow_t regrow,gmx_mc_move *mc_move);
+/* Returns if the pending move of mc_move is a regrowth move */
+
+extern real do_mc_regrow(gmx_mc_regrow_t regrow,
+			 gmx_enerdata_t *enerd,gmx_enerdata_t *enerd_prev,
+			 gmx_mc_move *mc_move,t_inputrec *ir,t_forcerec *fr,
+			 gmx_localtop_t *top,t_mdatoms *md,t_fcdata *fcd,
+			 t_graph *graph,gmx_step_t step,matrix box,
+			 rvec xprev[],rvec x[],real lambda);
+/* Regrows the tail of the molecule in mc_move from the entry selected
+ * in mc_move->group[MC_REGROW], using Rosenbluth weights of the trial
+ * torsions. The new configuration is put in x and enerd is set as with
+ * delta_enerd_mc. Returns the energy change that gives the configurational-
+ * bias acceptance probability with accept_mc.
+ */
+
+extern void done_mc_regrow(gmx_mc_regrow_t regrow);
+/* Stops the threads and frees the regrowth data */
+
+typedef struct gmx_mc_hybrid *gmx_mc_hybrid_t;
+/* Abstract type for MC sweeps in MD runs */
+
+extern gmx_mc_hybrid_t init_mc_hybrid(FILE *fplog,t_commrec *cr,
+				      t_inputrec *ir,t_forcerec *fr,
+				      gmx_mtop_t *mtop,gmx_localtop_t *top,
+				      t_mdatoms *md,matrix box,bool bConstr,
+				      gmx_mc_dd_t mdd);
+/* Sets up hybrid MD/MC sweeps of ir->mc_nmoves moves when ir->nstmc > 0,
+ * returns NULL otherwise. With bConstr no bond or angle moves are done.
+ * Requires incremental MC energies. In parallel domain decomposition
+ * is required and mdd should be set up with init_mc_dd, then only
+ * rigid molecule moves are done.
+ */
+
+extern real do_mc_hybrid(gmx_mc_hybrid_t hyb,FILE *fplog,t_inputrec *ir,
+			 t_forcerec *fr,gmx_localtop_t *top,t_block *mols,
+			 t_mdatoms *md,t_fcdata *fcd,t_graph *graph,
+			 gmx_step_t step,matrix box,rvec x[],rvec v[],
+			 real lambda);
+/* Does one sweep of single molecule MC moves on the MD configuration x,
+ * the velocities v of rotated molecules are rotated along. The random
+ * numbers of each molecule are keyed by step and its global index.
+ * Returns the potential energy change of the accepted moves.
+ * With domain decomposition mols is ignored and the movable home
+ * molecules are used, the energy change is summed over the nodes.
+ * The neighbor list should be rebuilt afterwards.
+ */
+
+extern void done_mc_hybrid(FILE *fplog,gmx_mc_hybrid_t hyb);
+/* Prints the acceptance ratios and frees the hybrid MD/MC data */
+
+#endif	/* _mctrial_h */
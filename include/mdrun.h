@@ -70,6 +70,7 @@
 #define MD_APPENDFILES  (1<<16)
 #define MD_READ_EKIN    (1<<17)
 #define MD_STARTFROMCPT (1<<18)
+#define MD_SORTATOMS    (1<<19)
 
 
 enum {
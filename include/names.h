@@ -53,6 +53,7 @@ extern const char *epcoupl_names[epcNR+1];
 extern const char *epcoupltype_names[epctNR+1];
 extern const char *erefscaling_names[erscNR+1];
 extern const char *ens_names[ensNR+1];
+extern const char *ecutscheme_names[ecutsNR+1];
 extern const char *ei_names[eiNR+1];
 extern const char *yesno_names[BOOL_NR+1];
 extern const char *bool_names[BOOL_NR+1];
@@ -89,6 +90,7 @@ extern const char *eMultentOpt_names[eMultentOptNR+1];
 
 #define BOOL(e)        ENUM_NAME(e,BOOL_NR,bool_names)
 #define ENS(e)         ENUM_NAME(e,ensNR,ens_names)
+#define ECUTSCHEME(e)  ENUM_NAME(e,ecutsNR,ecutscheme_names)
 #define EI(e)          ENUM_NAME(e,eiNR,ei_names)
 #define EPBC(e)        ENUM_NAME(e,epbcNR,epbc_names)
 #define ETCOUPLTYPE(e) ENUM_NAME(e,etcNR,etcoupl_names)
@@ -0,0 +1,83 @@
+/*
+ * 
+ *                This source code is part of
+ * 
+ *                 G   R   O   M   A   C   S
+ * 
+ *          GROningen MAchine for Chemical Simulations
+ * 
+ *                        VERSION 3.2.0
+ * Written by David van der Spoel, Erik Lindahl, Berk Hess, and others.
+ * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
+ * Copyright (c) 2001-2004, The GROMACS development team,
+ * check out http://www.gromacs.org for more information.
+
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * If you want to redistribute modifications, please consider that
+ * scientific software is very special. Version control is crucial -
+ * bugs must be traceable. We will be happy to consider code for
+ * inclusion in the official distribution, but derived work must not
+ * be called official GROMACS. Details are found in the README & COPYING
+ * files - if they are missing, get the official version at www.gromacs.org.
+ * 
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the papers on the package - you can find them in the top README file.
+ * 
+ * For more info, check our website at http://www.gromacs.org
+ * 
+ * And Hey:
+ * Gromacs Runs On Most of All Computer Systems
+ */
+
+#ifndef _nbnxn_h
+#define _nbnxn_h
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "typedefs.h"
+
+extern gmx_nbnxn_t init_nbnxn(FILE *fplog,const t_commrec *cr,
+			      const t_inputrec *ir,const t_forcerec *fr,
+			      const gmx_mtop_t *mtop,matrix box);
+/* Sets up the cluster-pair lists and kernels of the Verlet cut-off scheme.
+ * The SSE2 kernels are used when available, unless GMX_NBNXN_NOSSE is set.
+ * With ir->nstprune > 0 the list is pruned every nstprune steps to a
+ * shorter cut-off estimated from ir->verletbuf_drift.
+ */
+
+extern void nbnxn_search(gmx_nbnxn_t nbv,rvec *shift_vec,
+			 int natoms,rvec x[],const t_mdatoms *md,
+			 const t_blocka *excl,t_nrnb *nrnb);
+/* Puts the atoms on the cluster grid and makes the cluster-pair list
+ * with all pairs within rlist. The atoms should be in the box.
+ * With pruning this list is kept as the outer list.
+ */
+
+extern void nbnxn_do_nonbonded(gmx_nbnxn_t nbv,rvec x[],rvec f[],
+			       rvec fshift[],rvec *shift_vec,
+			       real *Vc,real *Vvdw,t_nrnb *nrnb);
+/* Computes the non-bonded forces and energies with the current list,
+ * the forces are added to f and the i-forces to fshift.
+ * With pruning, the outer list is pruned first every nstprune calls.
+ */
+
+/* The kernels, the forces are accumulated in nbat->f */
+
+extern void nbnxn_kernel_ref(const nbnxn_pairlist_t *nbl,
+			     nbnxn_atomdata_t *nbat,const nbnxn_param_t *p,
+			     rvec *shift_vec,rvec fshift[],
+			     real *Vc,real *Vvdw);
+
+extern void nbnxn_kernel_sse2(const nbnxn_pairlist_t *nbl,
+			      nbnxn_atomdata_t *nbat,const nbnxn_param_t *p,
+			      rvec *shift_vec,rvec fshift[],
+			      real *Vc,real *Vvdw);
+/* Only available with GMX_SSE2 in single precision */
+
+#endif	/* _nbnxn_h */
@@ -70,6 +70,11 @@ extern int gmx_node_rank(void);
 extern void gmx_setup_nodecomm(FILE *fplog,t_commrec *cr);
 /* Sets up fast global communication for clusters with multi-core nodes */
 
+extern int gmx_node_nranks(const t_commrec *cr);
+/* Returns the number of processes of cr->mpi_comm_mygroup on the same
+ * physical node as this process, should be called by all of them.
+ */
+
 extern bool gmx_mpi_initialized(void);
 /* return TRUE when MPI_Init has been called.
  * return FALSE when MPI_Init has not been called OR
@@ -45,6 +45,21 @@
 void
 gmx_setup_kernels(FILE *fplog);
 
+/* Sets up threaded execution of the group scheme kernels in do_nonbonded
+ * when the environment variable GMX_NB_NTHREADS is larger than 1,
+ * returns NULL otherwise. ngener is the number of energy groups.
+ */
+gmx_nonbonded_threads_t
+gmx_nonbonded_init_threads(FILE *fplog,int ngener);
+
+/* Sets fr->bEwaldAnalytical when the environment variable
+ * GMX_NB_EWALD_ANALYTICAL is set and the Ewald real-space kernels
+ * with analytical erfc are available and, compared to the Coulomb
+ * table in nblists, accurate enough. The result is printed to fplog.
+ */
+void
+gmx_nonbonded_setup_ewald(FILE *fplog,t_forcerec *fr,t_nblists *nblists);
+
 #define GMX_DONB_LR             (1<<0)
 #define GMX_DONB_FORCES         (1<<1)
 #define GMX_DONB_FOREIGNLAMBDA  (1<<2)
@@ -56,6 +71,39 @@ do_nonbonded(t_commrec *cr,t_forcerec *fr,
              t_nrnb *nrnb,real lambda,real *dvdlambda,
              int nls,int eNL,int flags,gmx_mc_move *mc_move);
 
+/* Calculate the short-range energies of nbatch trial configurations
+ * of atoms a0 to a0+na-1, which should be the only i-particles in the
+ * current pair lists, in one pass over the lists.
+ * xb contains na coordinates for each configuration. The energies are
+ * returned in Vc and Vvdw, with nener energy group pair terms for
+ * each configuration. Returns FALSE, without computing energies,
+ * when the lists contain interactions that can not be batched.
+ */
+bool
+do_nonbonded_batch(t_forcerec *fr,rvec x[],t_mdatoms *md,
+                   int a0,int na,int nbatch,rvec xb[],
+                   int nener,real Vc[],real Vvdw[]);
+
+/* Returns nbatch rounded up to the number of configurations
+ * the batch kernels handle per instruction.
+ */
+int
+nb_batch_padded(int nbatch);
+
+/* Adds the short-range energies of i-particle ii, at the nbatch
+ * positions sx, sy, sz, with the nja j-particles ja to ja+nja-1 at xj
+ * to Vc and Vvdw, without cut-off and exclusion checks. icoul and ivdw
+ * are the interaction types as for the nblists, nblists gives the tables.
+ * sx, sy, sz, Vc and Vvdw should have nb_batch_padded(nbatch) elements,
+ * rsq, rinv, eps and nnn are work arrays of nbatch elements.
+ */
+void
+do_nonbonded_batch_cg(t_forcerec *fr,t_nblists *nblists,int icoul,int ivdw,
+                      t_mdatoms *md,int ii,int ja,int nja,rvec xj[],
+                      int nbatch,real sx[],real sy[],real sz[],
+                      real rsq[],real rinv[],real eps[],int nnn[],
+                      real Vc[],real Vvdw[]);
+
 /* Calculate VdW/charge pair interactions (usually 1-4 interactions).
  * global_atom_index is only passed for printing error messages.
  */
@@ -104,4 +104,18 @@ extern void print_grid(FILE *log,t_grid *grid);
 extern void mv_grid(t_commrec *cr,t_grid *grid);
 /* Move the grid over processors */
 
+extern void grid_mc_fill(t_grid *grid,matrix box,int ncg,rvec cg_cm[]);
+/* Puts charge groups 0 to ncg-1 on the linked MC cell lists, using
+ * the cell layout of the last grid search. The box should be rectangular.
+ */
+
+extern void grid_mc_move(t_grid *grid,int cg,rvec cg_cm);
+/* Moves charge group cg to the MC cell of its new center cg_cm */
+
+extern int grid_mc_neighbors(t_grid *grid,rvec x,real rc,
+                             int *nalloc,int **jcg);
+/* Stores the charge groups in the MC cells within distance rc of x
+ * in *jcg, which is reallocated when needed, and returns their number.
+ */
+
 
@@ -64,6 +64,8 @@ extern int gmx_pme_init(gmx_pme_t *pmedata,t_commrec *cr,int nnodes_major,
 extern int gmx_pme_destroy(FILE *log,gmx_pme_t *pmedata);
 /* Initialize and destroy the pme data structures resepectively.
  * Return value 0 indicates all well, non zero is an error code.
+ * Nodes that only do PME use the number of threads given by
+ * the environment variable GMX_PME_NTHREADS.
  */
 
 #define GMX_PME_SPREAD_Q      (1<<0)
@@ -99,18 +99,22 @@ enum {
 };
 
 enum {
-  eiMD, eiSteep, eiCG, eiBD, eiSD2, eiNM, eiLBFGS, eiTPI, eiTPIC, eiSD1, eiMC, eiNR
+  ecutsGROUP, ecutsVERLET, ecutsNR
+};
+
+enum {
+  eiMD, eiSteep, eiCG, eiBD, eiSD2, eiNM, eiLBFGS, eiTPI, eiTPIC, eiSD1, eiMC, eiHMC, eiNR
 };
 
 #define EI_SD(e) ((e) == eiSD1 || (e) == eiSD2)
 #define EI_RANDOM(e) (EI_SD(e) || (e) == eiBD)
 /*above integrators may not conserve momenta*/
-#define EI_DYNAMICS(e) ((e) == eiMD || EI_SD(e) || (e) == eiBD || (e) == eiMC)
+#define EI_DYNAMICS(e) ((e) == eiMD || EI_SD(e) || (e) == eiBD || (e) == eiMC || (e) == eiHMC)
 #define EI_ENERGY_MINIMIZATION(e) ((e) == eiSteep || (e) == eiCG || (e) == eiLBFGS)
 #define EI_TPI(e) ((e) == eiTPI || (e) == eiTPIC)
 #define EI_MC(e) ((e) == eiMC)
 
-#define EI_STATE_VELOCITY(e) ((e) == eiMD || EI_SD(e))
+#define EI_STATE_VELOCITY(e) ((e) == eiMD || EI_SD(e) || (e) == eiHMC)
 
 enum {
   econtLINCS, econtSHAKE, econtNR
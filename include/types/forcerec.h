@@ -37,12 +37,19 @@
 #endif
 
 #include "ns.h"
+#include "nbnxn.h"
 #include "genborn.h"
 #include "qmmmrec.h"
 
 /* Abstract type for PME that is defined only in the routine that use them. */
 typedef struct gmx_pme *gmx_pme_t;
 
+/* Abstract type for spatial atom sorting, defined in atomsort.c */
+typedef struct gmx_atomsort *gmx_atomsort_t;
+
+/* Abstract type for threaded nonbonded kernels, defined in nonbonded.c */
+typedef struct gmx_nonbonded_threads *gmx_nonbonded_threads_t;
+
 typedef struct {
   real r;         /* range of the table */
   int  n;         /* n+1 is the number of points */
@@ -211,7 +218,6 @@ typedef struct {
   int  nnblists;
   int  *gid2nblists;
   t_nblists *nblists;
-  t_nblists **nblists_mc;
 
   /* The wall tables (if used) */
   int  nwall;
@@ -328,6 +334,23 @@ typedef struct {
   /* Neighbor searching stuff */
   gmx_ns_t ns;
 
+  /* The cut-off scheme, ecutsGROUP or ecutsVERLET, with the Verlet scheme
+   * the non-bonded interactions are computed with cluster-pair lists */
+  int         cutoff_scheme;
+  gmx_nbnxn_t nbv;
+
+  /* Threads and thread output buffers for the group scheme kernels,
+   * NULL when these run on a single thread */
+  gmx_nonbonded_threads_t nbthreads;
+
+  /* Compute Ewald real-space Coulomb in the kernels with an analytical
+   * erfc instead of the table of nblists[0] */
+  bool bEwaldAnalytical;
+
+  /* Spatial sorting of the atoms without domain decomposition, NULL when
+   * the atoms are in global order */
+  gmx_atomsort_t atomsort;
+
   /* QMMM stuff */
   bool         bQMMM;
   t_QMMMrec    *qr;
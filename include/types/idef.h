@@ -138,6 +138,7 @@ MC_BONDS,
 MC_ANGLES,
 MC_DIHEDRALS,
 MC_CRA,
+MC_REGROW,
 MC_NR
 };
 
@@ -145,6 +145,9 @@ typedef struct {
   int  simulation_part; /* Used in checkpointing to separate chunks */
   gmx_step_t init_step;	/* start at a stepcount >0 (used w. tpbconv)    */
   int  nstcalcenergy;	/* fequency of energy calc. and T/P coupl. upd.	*/
+  int  cutoff_scheme;   /* group or Verlet cut-off scheme               */
+  real verletbuf_drift; /* Max. drift (kJ/mol/ps/atom) for Verlet buffer */
+  int  nstprune;        /* Verlet list pruning frequency, 0 is no pruning */
   int  ns_type;		/* which ns method should we use?               */
   int  nstlist;		/* number of steps before pairlist is generated	*/
   int  ndelta;		/* number of cells per rlong			*/
@@ -188,6 +191,19 @@ typedef struct {
                         /* bonds in MC sims                             */        
   real bond_stretch;
   real angle_bend;
+  int  mc_ntrial;        /* Number of trial moves per MC step, with more */
+                        /* than one multiple-try Metropolis is used     */
+  bool bMCCheckerboard; /* Sweep over a checkerboard of MC cells        */
+  int  mc_regrow_ntrial; /* Trial torsions per bond for CBMC regrowth,  */
+                        /* 0 disables regrowth moves                    */
+  int  mc_adapt_steps;  /* Tune the MC step sizes up to this step       */
+  int  mc_adapt_nst;    /* Number of steps between step size updates    */
+  real mc_accept_target; /* Target acceptance ratio for the tuning      */
+  bool bMCVolumeFast;   /* Evaluate volume moves from the intermolecular */
+                        /* pair energies instead of a full force call   */
+  int  nstmc;           /* MD steps between hybrid MC sweeps, 0 is none  */
+  int  mc_nmoves;       /* MC moves per hybrid sweep, 0 is one per mol. */
+  int  hmc_nsteps;      /* MD steps per hybrid MC trajectory            */
 
   int  refcoord_scaling;/* How to scale absolute reference coordinates  */
   rvec posres_com;      /* The COM of the posres atoms                  */
@@ -0,0 +1,126 @@
+/*
+ * 
+ *                This source code is part of
+ * 
+ *                 G   R   O   M   A   C   S
+ * 
+ *          GROningen MAchine for Chemical Simulations
+ * 
+ *                        VERSION 3.2.0
+ * Written by David van der Spoel, Erik Lindahl, Berk Hess, and others.
+ * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
+ * Copyright (c) 2001-2004, The GROMACS development team,
+ * check out http://www.gromacs.org for more information.
+
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * If you want to redistribute modifications, please consider that
+ * scientific software is very special. Version control is crucial -
+ * bugs must be traceable. We will be happy to consider code for
+ * inclusion in the official distribution, but derived work must not
+ * be called official GROMACS. Details are found in the README & COPYING
+ * files - if they are missing, get the official version at www.gromacs.org.
+ * 
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the papers on the package - you can find them in the top README file.
+ * 
+ * For more info, check our website at http://www.gromacs.org
+ * 
+ * And Hey:
+ * GRoups of Organic Molecules in ACtion for Science
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+/* The cluster-pair neighbor list of the Verlet cut-off scheme.
+ * Atoms are put on a grid of columns along x and y and each column
+ * is sorted along z and cut into clusters of NBNXN_CLUSTER_SIZE atoms,
+ * columns are padded with filler atoms. The list contains pairs
+ * of an i-cluster with j-clusters, all cluster pairs within rlist
+ * are present, the kernels check the cut-off for each atom pair.
+ */
+
+#define NBNXN_CLUSTER_SIZE  4
+/* The interaction mask of a cluster pair has bit i*NBNXN_CLUSTER_SIZE+j
+ * set when atom pair i,j interacts.
+ */
+#define NBNXN_INT_MASK_ALL  0xffff
+
+enum {
+  enbnxnkREF, enbnxnkSSE2, enbnxnkNR
+};
+
+enum {
+  enbnxnelRF, enbnxnelTAB, enbnxnelNR
+};
+
+typedef struct {
+  int          cj;      /* The j-cluster                              */
+  unsigned int excl;    /* The interaction mask                       */
+} nbnxn_cj_t;
+
+typedef struct {
+  int ci;               /* The i-cluster                              */
+  int shift;            /* The shift vector index of the i-cluster    */
+  int cj_ind_start;     /* Start index into cj                        */
+  int cj_ind_end;       /* End index into cj                          */
+} nbnxn_ci_t;
+
+typedef struct {
+  real       rlist;     /* The cut-off distance of the list           */
+  int        nci;       /* The number of i-cluster entries            */
+  int        ci_nalloc;
+  nbnxn_ci_t *ci;
+  int        ncj;       /* The number of j-cluster entries            */
+  int        cj_nalloc;
+  nbnxn_cj_t *cj;
+} nbnxn_pairlist_t;
+
+typedef struct {
+  rvec c0;              /* The lower corner of the grid               */
+  rvec c1;              /* The upper corner of the grid               */
+  int  ncx,ncy;         /* The number of columns along x and y        */
+  real sx,sy;           /* The column size along x and y              */
+  real inv_sx,inv_sy;
+  int  *cxy_na;         /* The number of atoms in each column         */
+  int  *cxy_ind;        /* The first cluster of each column, ncx*ncy+1 */
+  int  cxy_nalloc;
+  int  nc;              /* The number of clusters                     */
+  int  nc_nalloc;
+  real *bb;             /* The bounding box of each cluster,
+                         * lower and upper corner                     */
+  int  *a;              /* The atom in each cluster slot, -1 is filler */
+  int  *cell;           /* The cluster slot of each atom              */
+  int  cell_nalloc;
+} nbnxn_grid_t;
+
+typedef struct {
+  int  ntype;           /* The number of atom types, the last one
+                         * is the filler type without interactions    */
+  real *nbfp;           /* c6 and c12 for each type pair              */
+  int  *type;           /* The type of each cluster slot              */
+  real *xq;             /* Per cluster the x, y, z and q of its atoms,
+                         * each as NBNXN_CLUSTER_SIZE values          */
+  real *f;              /* Per cluster the x, y and z force           */
+  int  nalloc;          /* The allocated number of clusters           */
+  void *xq_alloc;       /* The unaligned allocations of xq and f      */
+  void *f_alloc;
+} nbnxn_atomdata_t;
+
+typedef struct {
+  int  eeltype;         /* The Coulomb type, enbnxnel                 */
+  real rcut2;           /* The interaction cut-off squared            */
+  real epsfac;          /* Coulomb prefactor, included in nbat->xq    */
+  real k_rf,c_rf;       /* Reaction-field constants, 0 for cut-off    */
+  real tabscale;        /* The Coulomb table scale                    */
+  real *tab;            /* The Coulomb table, Y, F, G, H per point    */
+} nbnxn_param_t;
+
+/* Abstract type for the Verlet cut-off scheme data,
+ * defined in the routines that use it.
+ */
+typedef struct gmx_nbnxn *gmx_nbnxn_t;
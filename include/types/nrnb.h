@@ -84,6 +84,7 @@ enum
     eNR_NBKERNEL_NR,
     eNR_NBKERNEL_FREE_ENERGY = eNR_NBKERNEL_NR,
     eNR_NBKERNEL_OUTER,
+    eNR_NBNXN_RF,             eNR_NBNXN_TAB,            eNR_NBNXN_PRUNE,
     eNR_NB14,
     eNR_WEIGHTS,              eNR_SPREADQ,              eNR_SPREADQBSP,
     eNR_GATHERF,              eNR_GATHERFBSP,           eNR_FFT,
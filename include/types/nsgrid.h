@@ -65,6 +65,17 @@ typedef struct {
   real   *dcy2;         /* Squared distance from atom to j-cell */
   real   *dcz2;         /* Squared distance from atom to j-cell */
   int    dc_nalloc;     /* Allocation size of dcx2, dyc2, dcz2  */
+  /* Linked cell lists for incremental MC updates, these use the cell
+   * layout of the last search, but are only updated for moved cg's.
+   */
+  ivec   mc_n;          /* The dimension of the MC grid         */
+  rvec   mc_box;        /* The rectangular box of the MC grid   */
+  rvec   mc_inv_size;   /* The inverse MC cell size             */
+  int    *mc_head;      /* The first cg in each MC cell         */
+  int    mc_cells_nalloc; /* Allocation size of mc_head         */
+  int    *mc_cell;      /* The MC cell of each cg               */
+  int    *mc_next;      /* The next cg in the same MC cell      */
+  int    mc_nalloc;     /* Allocation size of mc_cell, mc_next  */
 } t_grid;
 
 #endif
@@ -54,6 +54,8 @@ enum { estLAMBDA,
        estX,   estV,       estSDX,  estCGP,       estLD_RNG, estLD_RNGI,
        estDISRE_INITF, estDISRE_RM3TAV,
        estORIRE_INITF, estORIRE_DTAV,
+       estMC_DELTA, estMC_PROB,
+       estMC_RNG, estMC_RNGI, estMC_RNGG, estMC_COUNTS, estMC_ENER,
        estNR };
 
 /* The names of the state entries, defined in src/gmxib/checkpoint.c */
@@ -97,6 +99,9 @@ typedef struct
 }
 energyhistory_t;
 
+/* Abstract type for incremental MC energy evaluation, defined in force.c */
+typedef struct gmx_mc_ener *gmx_mc_ener_t;
+
 typedef struct
 {
  int ai;
@@ -108,6 +113,16 @@ typedef struct
  real value;
 } gmx_mc_movegroup;
 
+typedef struct
+{
+ int    start;  /* First atom changed since the last accepted state   */
+ int    end;    /* One past the last changed atom                     */
+ bool   bBox;   /* The box was changed since the last accepted state  */
+ matrix box;    /* Box of the last accepted state                     */
+ tensor vir;    /* Force virial of the last accepted state            */
+ bool   bShifted; /* x was shifted with the graph in the last force call */
+} gmx_mc_journal;
+
 typedef struct
 {
  int start;
@@ -132,6 +147,9 @@ typedef struct
  rvec *xcm;
  real **enerd;
  real **enerd_prev;
+ gmx_mc_ener_t ener;
+ int nthreads;           /* Threads for trials and sweeps, mc_nthreads */
+ gmx_mc_journal journal; /* Undo log, xprev holds the accepted coordinates */
  real bias;
  real gauss; //teste
  real d2; //teste
@@ -175,6 +193,11 @@ typedef struct
   int           step_tot[MC_NR];
   int           vol_ac;
   int           vol_tot;
+  real          mc_delta[MC_NR+1]; /* MC step size per move group, the   */
+                                   /* last entry is for the volume      */
+  real          mc_prob[MC_NR];    /* MC move group selection probability */
+  real          mc_ener[F_NRE]; /* The energy terms of the accepted     */
+                                /* configuration                        */
 } t_state;
 
 #endif /* _state_h_ */
@@ -91,14 +91,15 @@ extern void update(FILE         *fplog,
 		   tensor       vir_part,
 		   bool         bNEMD,
 		   bool         bInitStep,
-                   gmx_rng_t    rng,
-                   gmx_rng_t    rng2,
+                   gmx_rng_cb_t *rng,
                    gmx_mc_move  *mc_move);
-/* Return TRUE if OK, FALSE in case of Shake Error */
+/* Return TRUE if OK, FALSE in case of Shake Error.
+ * rng is the stream of MC move generation, only used with mc_move.
+ */
      
 void bond_rot(t_graph *graph,int ai,int aj,int *list,int *nr,int afix);
 
-void set_mcmove(gmx_mc_movegroup *group,gmx_rng_t rng,real fac,int delta,int start,int eI);
+void set_mcmove(gmx_mc_movegroup *group,gmx_rng_cb_t *rng,real fac,int delta,int start,int eI);
 
 extern void calc_ke_part(t_state *state,t_grpopts *opts,t_mdatoms *md,
 			 gmx_ekindata_t *ekind,t_nrnb *nrnb);
@@ -185,6 +186,20 @@ extern void mc_pscale(t_inputrec *ir,matrix mu,
 			     rvec x[],unsigned short cFREEZE[],
 			     t_nrnb *nrnb,t_block *mols,rvec *xcm,t_graph *graph);
 
+extern void update_mc_rigid(int nr,rvec x[],real mass[],int mvgroup,
+                            rvec delta_x,rvec delta_phi);
+/* Applies the translation delta_x or the rotation delta_phi around
+ * the center of mass of MC move group mvgroup to the nr atoms in x.
+ */
+
+extern void update_mc_move(rvec x[],matrix box,real mass[],
+                           gmx_mc_move *mc_move,t_graph *graph,
+                           gmx_rng_cb_t *rng,int homenr);
+/* Applies the MC move set up in mc_move to the molecule from
+ * mc_move->start to mc_move->end in x, internal moves need whole
+ * molecules and the graph.
+ */
+
 extern void correct_ekin(FILE *log,int start,int end,rvec v[],
 			 rvec vcm,real mass[],real tmass,tensor ekin);
 /* Correct ekin for vcm */
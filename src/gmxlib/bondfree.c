@@ -362,7 +362,7 @@ real bonds(int nbonds,
     vtot  += vbond;/* 1*/
     //if(ai==92 && aj == 95)
      //printf("vbond %f dr %f %d %d %f %f %f\n",vbond,dr,ai,aj,x[ai][2],x[aj][2],x[ai][2]-x[aj][2]);
-    if(mc_move)
+    if(mc_move && mc_move->enerd[ftype])
     {
      mc_move->enerd[ftype][k] = vbond;
     }
@@ -687,7 +687,7 @@ real angles(int nbonds,
 			   forceparams[type].harmonic.rB*DEG2RAD,
 			   theta,lambda,&va,&dVdt);  /*  21  */
     vtot += va;
-    if(mc_move)
+    if(mc_move && mc_move->enerd[ftype])
     {
      mc_move->enerd[ftype][k] = va;
     }
@@ -1512,7 +1512,7 @@ real rbdihs(int nbonds,
     do_dih_fup(ai,aj,ak,al,ddphi,r_ij,r_kj,r_kl,m,n,
 	       f,fshift,pbc,g,x,t1,t2,t3);		/* 112		*/
     vtot += v;
-    if(mc_move)
+    if(mc_move && mc_move->enerd[ftype])
     {
      mc_move->enerd[ftype][k] = v;
     }
@@ -63,6 +63,8 @@ const char *est_names[estNR]=
     "x", "v", "SDx", "CGp", "LD-rng", "LD-rng-i",
     "disre_initf", "disre_rm3tav",
     "orire_initf", "orire_Dtav",
+    "MC-step-sizes", "MC-move-probabilities",
+    "MC-rng", "MC-rng-i", "MC-rng-gauss", "MC-move-counts", "MC-energies"
 };
 
 enum { eeksEKINH_N, eeksEKINH, eeksDEKINDL, eeksMVCOS, eeksNR };
@@ -399,7 +401,7 @@ static int do_cpte_doubles(XDR *xd,int cptp,int ecpt,int sflags,
     {
         return -1;
     }
-    if (list == NULL && nf != n)
+    if (list == NULL && v != NULL && nf != n)
     {
         gmx_fatal(FARGS,"Count mismatch for state entry %s, code count is %d, file count is %d\n",st_names(cptp,ecpt),n,nf);
     }
@@ -414,7 +416,7 @@ static int do_cpte_doubles(XDR *xd,int cptp,int ecpt,int sflags,
         gmx_fatal(FARGS,"Precision mismatch for state entry %s, code precision is %s, file precision is %s\n",
                   st_names(cptp,ecpt),ecpdt_names[dtc],ecpdt_names[dt]);
     }
-    if (list || !(sflags & (1<<ecpt)))
+    if (list || !(sflags & (1<<ecpt)) || v == NULL)
     {
         snew(va,nf);
         vp = va;
@@ -659,6 +661,8 @@ static int do_cpt_state(XDR *xd,bool bRead,
 {
     int  sflags;
     int  **rng_p,**rngi_p;
+    real *mc_delta,*mc_prob,*mc_ener;
+    int  mc_counts[2*MC_NR+2],*mc_counts_p;
     int  i;
     int  ret;
     
@@ -676,6 +680,20 @@ static int do_cpt_state(XDR *xd,bool bRead,
         rngi_p = NULL;
     }
 
+    mc_delta = state->mc_delta;
+    mc_prob  = state->mc_prob;
+    mc_ener  = state->mc_ener;
+
+    /* The MC move counts are stored as one entry */
+    for(i=0; i<MC_NR; i++)
+    {
+        mc_counts[i]       = state->step_ac[i];
+        mc_counts[MC_NR+i] = state->step_tot[i];
+    }
+    mc_counts[2*MC_NR]   = state->vol_ac;
+    mc_counts[2*MC_NR+1] = state->vol_tot;
+    mc_counts_p = mc_counts;
+
     sflags = state->flags;
     for(i=0; (i<estNR && ret == 0); i++)
     {
@@ -699,12 +717,33 @@ static int do_cpt_state(XDR *xd,bool bRead,
             case estDISRE_RM3TAV: ret = do_cpte_reals(xd,0,i,sflags,state->hist.ndisrepairs,&state->hist.disre_rm3tav,list); break;
             case estORIRE_INITF:  ret = do_cpte_real (xd,0,i,sflags,&state->hist.orire_initf,list); break;
             case estORIRE_DTAV:   ret = do_cpte_reals(xd,0,i,sflags,state->hist.norire_Dtav,&state->hist.orire_Dtav,list); break;
+            case estMC_DELTA: ret = do_cpte_reals(xd,0,i,sflags,MC_NR+1,&mc_delta,list); break;
+            case estMC_PROB:  ret = do_cpte_reals(xd,0,i,sflags,MC_NR,&mc_prob,list); break;
+            /* The MC streams are counter-based now, the entries of
+             * older checkpoints are read and discarded.
+             */
+            case estMC_RNG:   ret = do_cpte_ints(xd,0,i,sflags,0,NULL,list); break;
+            case estMC_RNGI:  ret = do_cpte_ints(xd,0,i,sflags,0,NULL,list); break;
+            case estMC_RNGG:  ret = do_cpte_doubles(xd,0,i,sflags,0,NULL,list); break;
+            case estMC_COUNTS: ret = do_cpte_ints(xd,0,i,sflags,2*MC_NR+2,&mc_counts_p,list); break;
+            case estMC_ENER:  ret = do_cpte_reals(xd,0,i,sflags,F_NRE,&mc_ener,list); break;
             default:
                 gmx_fatal(FARGS,"Unknown state entry %d\n"
                           "You are probably reading a new checkpoint file with old code",i);
             }
         }
     }
+
+    if (bRead && (fflags & sflags & (1<<estMC_COUNTS)))
+    {
+        for(i=0; i<MC_NR; i++)
+        {
+            state->step_ac[i]  = mc_counts[i];
+            state->step_tot[i] = mc_counts[MC_NR+i];
+        }
+        state->vol_ac  = mc_counts[2*MC_NR];
+        state->vol_tot = mc_counts[2*MC_NR+1];
+    }
     
     return ret;
 }
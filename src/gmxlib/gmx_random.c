@@ -18,6 +18,11 @@
 #include "maths.h"
 #include "gmx_random_gausstable.h"
 
+#if ( defined(GMX_IA32_SSE2) || defined(GMX_X86_64_SSE2) || defined(GMX_SSE2) )
+#define GMX_RNG_CB_SSE2
+#include <emmintrin.h>
+#endif
+
 #define RNG_N 624
 #define RNG_M 397
 #define RNG_MATRIX_A 0x9908b0dfUL   /* constant vector a */
@@ -325,6 +330,268 @@ gmx_rng_gaussian_table(gmx_rng_t rng)
 }
 
 
+/* Threefry-4x32-20, see Salmon et al., "Parallel random numbers:
+ * as easy as 1, 2, 3", SC11. The rotation constants and key schedule
+ * parity are those of the reference implementation. The 20 rounds
+ * are written out as 5 groups of 4, with a key injection after each.
+ */
+#define RNG_CB_PARITY 0x1BD11BDA
+#define RNG_CB_ROTL(x,r) (((x) << (r)) | ((x) >> (32 - (r))))
+#define RNG_CB_MIX(a,b,r) a += b; b = RNG_CB_ROTL(b,r); b ^= a;
+#define RNG_CB_ROUNDS4(r0,r1,r2,r3,r4,r5,r6,r7) \
+  RNG_CB_MIX(x0,x1,r0); RNG_CB_MIX(x2,x3,r1); \
+  RNG_CB_MIX(x0,x3,r2); RNG_CB_MIX(x2,x1,r3); \
+  RNG_CB_MIX(x0,x1,r4); RNG_CB_MIX(x2,x3,r5); \
+  RNG_CB_MIX(x0,x3,r6); RNG_CB_MIX(x2,x1,r7);
+#define RNG_CB_INJECT(s) \
+  x0 += ks[(s) % 5]; x1 += ks[((s) + 1) % 5]; \
+  x2 += ks[((s) + 2) % 5]; x3 += ks[((s) + 3) % 5] + (s);
+#define RNG_CB_ROUNDS4_A RNG_CB_ROUNDS4(10,26,11,21,13,27,23, 5)
+#define RNG_CB_ROUNDS4_B RNG_CB_ROUNDS4( 6,20,17,11,25,10,18,20)
+
+void
+gmx_rng_cb_block(const unsigned int key[4],const unsigned int ctr[4],
+                 unsigned int out[4])
+{
+  unsigned int ks[5],x0,x1,x2,x3;
+  int i;
+
+  ks[4] = RNG_CB_PARITY;
+  for(i=0; i<4; i++) {
+    ks[i]  = key[i];
+    ks[4] ^= key[i];
+  }
+  x0 = ctr[0] + ks[0];
+  x1 = ctr[1] + ks[1];
+  x2 = ctr[2] + ks[2];
+  x3 = ctr[3] + ks[3];
+  RNG_CB_ROUNDS4_A; RNG_CB_INJECT(1);
+  RNG_CB_ROUNDS4_B; RNG_CB_INJECT(2);
+  RNG_CB_ROUNDS4_A; RNG_CB_INJECT(3);
+  RNG_CB_ROUNDS4_B; RNG_CB_INJECT(4);
+  RNG_CB_ROUNDS4_A; RNG_CB_INJECT(5);
+  out[0] = x0;
+  out[1] = x1;
+  out[2] = x2;
+  out[3] = x3;
+}
+
+
+void
+gmx_rng_cb_init(gmx_rng_cb_t *rng,unsigned int seed,int domain)
+{
+  rng->key[0] = seed;
+  rng->key[1] = domain;
+  rng->key[2] = 0;
+  rng->key[3] = 0;
+  rng->ctr[0] = 0;
+  rng->ctr[1] = 0;
+  rng->ctr[2] = 0;
+  rng->ctr[3] = 0;
+  rng->nbuf   = 0;
+}
+
+
+void
+gmx_rng_cb_restart(gmx_rng_cb_t *rng,gmx_step_t step,unsigned int index)
+{
+  rng->ctr[0] = (unsigned int)step;
+  rng->ctr[1] = (unsigned int)(sizeof(gmx_step_t) > 4 ? step >> 16 >> 16 : 0);
+  rng->ctr[2] = index;
+  rng->ctr[3] = 0;
+  rng->nbuf   = 0;
+}
+
+
+unsigned int
+gmx_rng_cb_uint32(gmx_rng_cb_t *rng)
+{
+  if (rng->nbuf == 0) {
+    gmx_rng_cb_block(rng->key,rng->ctr,rng->buf);
+    rng->ctr[3]++;
+    rng->nbuf = 4;
+  }
+
+  return rng->buf[4 - rng->nbuf--];
+}
+
+
+real
+gmx_rng_cb_uniform_real(gmx_rng_cb_t *rng)
+{
+  /* See gmx_rng_uniform_real for the factors */
+  if(sizeof(real)==sizeof(double))
+    return ((double)gmx_rng_cb_uint32(rng))*(1.0/4294967296.0); 
+  else
+    return ((float)gmx_rng_cb_uint32(rng))*(1.0/4294967423.0); 
+}
+
+
+real
+gmx_rng_cb_gaussian_real(gmx_rng_cb_t *rng)
+{
+  real x,y,r;
+
+  do {
+    x=2.0*gmx_rng_cb_uniform_real(rng)-1.0;
+    y=2.0*gmx_rng_cb_uniform_real(rng)-1.0;
+    r=x*x+y*y;
+  } while(r>1.0 || r==0.0);
+
+  return x*sqrt(-2.0*log(r)/r);
+}
+
+
+real
+gmx_rng_cb_gaussian_table(gmx_rng_cb_t *rng)
+{
+  return gaussian_table[gmx_rng_cb_uint32(rng) >> GAUSS_SHIFT];
+}
+
+
+#ifdef GMX_RNG_CB_SSE2
+/* Threefry-4x32-20 on four counters at once, lane j of x[i] holds
+ * word i of counter j. The same operations as gmx_rng_cb_block(),
+ * the macros are redefined for SSE2 registers.
+ */
+#undef RNG_CB_MIX
+#undef RNG_CB_INJECT
+#define RNG_CB_MIX(a,b,r) \
+  a = _mm_add_epi32(a,b); \
+  b = _mm_or_si128(_mm_slli_epi32(b,r),_mm_srli_epi32(b,32 - (r))); \
+  b = _mm_xor_si128(b,a);
+#define RNG_CB_INJECT(s) \
+  x0 = _mm_add_epi32(x0,ks[(s) % 5]); \
+  x1 = _mm_add_epi32(x1,ks[((s) + 1) % 5]); \
+  x2 = _mm_add_epi32(x2,ks[((s) + 2) % 5]); \
+  x3 = _mm_add_epi32(x3,_mm_add_epi32(ks[((s) + 3) % 5],_mm_set1_epi32(s)));
+
+static void
+rng_cb_block4_sse2(const unsigned int key[4],__m128i x[4])
+{
+  unsigned int k4;
+  __m128i ks[5],x0,x1,x2,x3;
+  int i;
+
+  k4 = RNG_CB_PARITY;
+  for(i=0; i<4; i++) {
+    ks[i] = _mm_set1_epi32(key[i]);
+    k4   ^= key[i];
+  }
+  ks[4] = _mm_set1_epi32(k4);
+  x0 = _mm_add_epi32(x[0],ks[0]);
+  x1 = _mm_add_epi32(x[1],ks[1]);
+  x2 = _mm_add_epi32(x[2],ks[2]);
+  x3 = _mm_add_epi32(x[3],ks[3]);
+  RNG_CB_ROUNDS4_A; RNG_CB_INJECT(1);
+  RNG_CB_ROUNDS4_B; RNG_CB_INJECT(2);
+  RNG_CB_ROUNDS4_A; RNG_CB_INJECT(3);
+  RNG_CB_ROUNDS4_B; RNG_CB_INJECT(4);
+  RNG_CB_ROUNDS4_A; RNG_CB_INJECT(5);
+  x[0] = x0;
+  x[1] = x1;
+  x[2] = x2;
+  x[3] = x3;
+}
+#endif
+
+
+int
+gmx_rng_cb_uniform_int(gmx_rng_cb_t *rng,int max)
+{
+  int i;
+
+  do {
+    i = (int)(gmx_rng_cb_uniform_real(rng)*max);
+  } while(i >= max);
+
+  return i;
+}
+
+
+/* Converts a 32-bit random integer to a tabulated gaussian or,
+ * as gmx_rng_cb_uniform_real(), to a uniform real.
+ */
+static real
+rng_cb_real(unsigned int u,bool bGauss)
+{
+  if (bGauss)
+    return gaussian_table[u >> GAUSS_SHIFT];
+  else if(sizeof(real)==sizeof(double))
+    return ((double)u)*(1.0/4294967296.0);
+  else
+    return ((float)u)*(1.0/4294967423.0);
+}
+
+
+static void
+rng_cb_batch(const gmx_rng_cb_t *rng,gmx_step_t step,
+             int n,const int *index,int offset,int nper,
+             bool bGauss,real *r)
+{
+  unsigned int ctr[4],out[4];
+  int i,b,k,nk;
+#ifdef GMX_RNG_CB_SSE2
+  __m128i x[4];
+  unsigned int out4[4][4];
+  int j;
+#endif
+
+  ctr[0] = (unsigned int)step;
+  ctr[1] = (unsigned int)(sizeof(gmx_step_t) > 4 ? step >> 16 >> 16 : 0);
+
+  i = 0;
+#ifdef GMX_RNG_CB_SSE2
+  for(; i+4<=n; i+=4) {
+    for(b=0; 4*b<nper; b++) {
+      x[0] = _mm_set1_epi32(ctr[0]);
+      x[1] = _mm_set1_epi32(ctr[1]);
+      if (index)
+        x[2] = _mm_setr_epi32(index[i],index[i+1],index[i+2],index[i+3]);
+      else
+        x[2] = _mm_setr_epi32(offset+i,offset+i+1,offset+i+2,offset+i+3);
+      x[3] = _mm_set1_epi32(b);
+      rng_cb_block4_sse2(rng->key,x);
+      for(k=0; k<4; k++)
+        _mm_storeu_si128((__m128i *)out4[k],x[k]);
+      nk = (nper - 4*b < 4 ? nper - 4*b : 4);
+      for(j=0; j<4; j++)
+        for(k=0; k<nk; k++)
+          r[(i+j)*nper + 4*b + k] = rng_cb_real(out4[k][j],bGauss);
+    }
+  }
+#endif
+  for(; i<n; i++) {
+    ctr[2] = (index ? index[i] : offset+i);
+    for(b=0; 4*b<nper; b++) {
+      ctr[3] = b;
+      gmx_rng_cb_block(rng->key,ctr,out);
+      nk = (nper - 4*b < 4 ? nper - 4*b : 4);
+      for(k=0; k<nk; k++)
+        r[i*nper + 4*b + k] = rng_cb_real(out[k],bGauss);
+    }
+  }
+}
+
+
+void
+gmx_rng_cb_gaussian_table_batch(const gmx_rng_cb_t *rng,gmx_step_t step,
+                                int n,const int *index,int offset,
+                                int nper,real *g)
+{
+  rng_cb_batch(rng,step,n,index,offset,nper,TRUE,g);
+}
+
+
+void
+gmx_rng_cb_uniform_real_batch(const gmx_rng_cb_t *rng,gmx_step_t step,
+                              int n,const int *index,int offset,
+                              int nper,real *u)
+{
+  rng_cb_batch(rng,step,n,index,offset,nper,FALSE,u);
+}
+
+
 /*
  * Print a lookup table for Gaussian numbers with 4 entries on each
  * line, formatted for inclusion in this file. Size is 2^bits.
@@ -0,0 +1,193 @@
+/*
+ * 
+ *                This source code is part of
+ * 
+ *                 G   R   O   M   A   C   S
+ * 
+ *          GROningen MAchine for Chemical Simulations
+ * 
+ *                        VERSION 3.2.0
+ * Written by David van der Spoel, Erik Lindahl, Berk Hess, and others.
+ * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
+ * Copyright (c) 2001-2004, The GROMACS development team,
+ * check out http://www.gromacs.org for more information.
+
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * If you want to redistribute modifications, please consider that
+ * scientific software is very special. Version control is crucial -
+ * bugs must be traceable. We will be happy to consider code for
+ * inclusion in the official distribution, but derived work must not
+ * be called official GROMACS. Details are found in the README & COPYING
+ * files - if they are missing, get the official version at www.gromacs.org.
+ * 
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the papers on the package - you can find them in the top README file.
+ * 
+ * For more info, check our website at http://www.gromacs.org
+ * 
+ * And Hey:
+ * Gromacs Runs On Most of All Computer Systems
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef GMX_THREAD_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "typedefs.h"
+#include "smalloc.h"
+#include "macros.h"
+#include "gmx_fatal.h"
+#include "gmx_thread_pool.h"
+
+typedef struct gmx_thread_pool_arg {
+  struct gmx_thread_pool *pool;
+  int                    thread;
+} t_pool_arg;
+
+struct gmx_thread_pool {
+  int                    nthreads;
+#ifdef GMX_THREAD_PTHREADS
+  pthread_t              *thread;
+  t_pool_arg             *arg;
+  pthread_mutex_t        mutex;
+  pthread_cond_t         cond_start;
+  pthread_cond_t         cond_done;
+  /* Incremented for each run, workers wait for it to change */
+  int                    generation;
+  int                    nbusy;
+  bool                   bStop;
+  int                    ntask;
+  gmx_thread_pool_func_t func;
+  void                   *data;
+#endif
+};
+
+static void pool_run_tasks(int ntask,int nthreads,int thread,
+			   gmx_thread_pool_func_t func,void *data)
+{
+  int t;
+
+  for(t=thread; t<ntask; t+=nthreads)
+    func(data,t,thread);
+}
+
+#ifdef GMX_THREAD_PTHREADS
+static void *pool_worker(void *p)
+{
+  t_pool_arg             *arg=(t_pool_arg *)p;
+  struct gmx_thread_pool *pool=arg->pool;
+  int                    gen,ntask;
+  gmx_thread_pool_func_t func;
+  void                   *data;
+
+  gen = 0;
+  pthread_mutex_lock(&pool->mutex);
+  for(;;) {
+    while (pool->generation == gen && !pool->bStop)
+      pthread_cond_wait(&pool->cond_start,&pool->mutex);
+    if (pool->bStop)
+      break;
+    gen   = pool->generation;
+    ntask = pool->ntask;
+    func  = pool->func;
+    data  = pool->data;
+    pthread_mutex_unlock(&pool->mutex);
+
+    pool_run_tasks(ntask,pool->nthreads,arg->thread,func,data);
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->nbusy--;
+    if (pool->nbusy == 0)
+      pthread_cond_signal(&pool->cond_done);
+  }
+  pthread_mutex_unlock(&pool->mutex);
+
+  return NULL;
+}
+#endif
+
+gmx_thread_pool_t gmx_thread_pool_init(int nthreads)
+{
+  struct gmx_thread_pool *pool;
+#ifdef GMX_THREAD_PTHREADS
+  int th;
+#endif
+
+  snew(pool,1);
+#ifdef GMX_THREAD_PTHREADS
+  pool->nthreads = max(1,nthreads);
+  pthread_mutex_init(&pool->mutex,NULL);
+  pthread_cond_init(&pool->cond_start,NULL);
+  pthread_cond_init(&pool->cond_done,NULL);
+  snew(pool->thread,pool->nthreads);
+  snew(pool->arg,pool->nthreads);
+  for(th=1; th<pool->nthreads; th++) {
+    pool->arg[th].pool   = pool;
+    pool->arg[th].thread = th;
+    if (pthread_create(&pool->thread[th],NULL,pool_worker,&pool->arg[th]))
+      gmx_fatal(FARGS,"Could not start thread %d of the thread pool",th);
+  }
+#else
+  pool->nthreads = 1;
+#endif
+
+  return pool;
+}
+
+int gmx_thread_pool_nthreads(gmx_thread_pool_t pool)
+{
+  return pool->nthreads;
+}
+
+void gmx_thread_pool_run(gmx_thread_pool_t pool,int ntask,
+			 gmx_thread_pool_func_t func,void *data)
+{
+  if (pool->nthreads == 1 || ntask <= 1) {
+    pool_run_tasks(ntask,1,0,func,data);
+    return;
+  }
+#ifdef GMX_THREAD_PTHREADS
+  pthread_mutex_lock(&pool->mutex);
+  pool->ntask = ntask;
+  pool->func  = func;
+  pool->data  = data;
+  pool->nbusy = pool->nthreads - 1;
+  pool->generation++;
+  pthread_cond_broadcast(&pool->cond_start);
+  pthread_mutex_unlock(&pool->mutex);
+
+  pool_run_tasks(ntask,pool->nthreads,0,func,data);
+
+  pthread_mutex_lock(&pool->mutex);
+  while (pool->nbusy > 0)
+    pthread_cond_wait(&pool->cond_done,&pool->mutex);
+  pthread_mutex_unlock(&pool->mutex);
+#endif
+}
+
+void gmx_thread_pool_done(gmx_thread_pool_t pool)
+{
+#ifdef GMX_THREAD_PTHREADS
+  int th;
+
+  pthread_mutex_lock(&pool->mutex);
+  pool->bStop = TRUE;
+  pthread_cond_broadcast(&pool->cond_start);
+  pthread_mutex_unlock(&pool->mutex);
+  for(th=1; th<pool->nthreads; th++)
+    pthread_join(pool->thread[th],NULL);
+  pthread_cond_destroy(&pool->cond_start);
+  pthread_cond_destroy(&pool->cond_done);
+  pthread_mutex_destroy(&pool->mutex);
+  sfree(pool->thread);
+  sfree(pool->arg);
+#endif
+  sfree(pool);
+}
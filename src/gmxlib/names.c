@@ -51,9 +51,14 @@ const char *ens_names[ensNR+1]=
   "Grid","Simple", NULL
 };
 
+const char *ecutscheme_names[ecutsNR+1]=
+{
+  "Group","Verlet", NULL
+};
+
 const char *ei_names[eiNR+1]=
 {
-  "md", "steep", "cg", "bd", "sd", "nm", "l-bfgs", "tpi", "tpic", "sd1", "mc", NULL 
+  "md", "steep", "cg", "bd", "sd", "nm", "l-bfgs", "tpi", "tpic", "sd1", "mc", "hmc", NULL 
 };
 
 const char *bool_names[BOOL_NR+1]=
@@ -246,6 +246,38 @@ int gmx_node_rank(void)
 #endif
 }
 
+int gmx_node_nranks(const t_commrec *cr)
+{
+#ifndef GMX_MPI
+  return 1;
+#else
+  char name[MPI_MAX_PROCESSOR_NAME],*names;
+  int  n,i,resultlen,nranks;
+
+  if (!PAR(cr))
+    return 1;
+
+  /* Compare the full host names, not only their trailing numbers
+   * as in gmx_setup_nodecomm, since this is only called at startup.
+   */
+  memset(name,0,MPI_MAX_PROCESSOR_NAME);
+  MPI_Get_processor_name(name,&resultlen);
+  MPI_Comm_size(cr->mpi_comm_mygroup,&n);
+  snew(names,n*MPI_MAX_PROCESSOR_NAME);
+  MPI_Allgather(name,MPI_MAX_PROCESSOR_NAME,MPI_CHAR,
+		names,MPI_MAX_PROCESSOR_NAME,MPI_CHAR,cr->mpi_comm_mygroup);
+  nranks = 0;
+  for(i=0; i<n; i++) {
+    if (strncmp(names+i*MPI_MAX_PROCESSOR_NAME,name,
+		MPI_MAX_PROCESSOR_NAME) == 0)
+      nranks++;
+  }
+  sfree(names);
+
+  return nranks;
+#endif
+}
+
 void gmx_setup_nodecomm(FILE *fplog,t_commrec *cr)
 {
   gmx_nodecomm_t *nc;
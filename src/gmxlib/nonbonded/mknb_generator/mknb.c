@@ -37,6 +37,10 @@
  * special functions (free energy, generalized-born interactions) are
  * written outside this generator.
  *
+ * With -simd the C kernels are instead written in terms of the
+ * width-agnostic SIMD layer in include/gmx_simd.h, so the same source
+ * compiles to SSE2, AVX or plain C kernels depending on the target.
+ *
  * C is somewhat more portable, but Fortran is faster on some machines.
  * There are also a lot of special options like prefetching, the software
  * version of 1/sqrt(x), thread synchronization, etc. In C we could handle
@@ -61,7 +65,8 @@ mknb_write_function(void)
 			mknb_func.coul,mknb_func.vdw,mknb_func.water,
 			mknb_func.do_force ? "" : "nf");
 #else
-	sprintf(funcname,"nb_kernel%d%d%d%s",
+	/* SIMD kernels get the suffix of the target they are compiled for */
+	sprintf(funcname,mknb_simd ? "GMX_SIMD_NAME(nb_kernel%d%d%d%s)" : "nb_kernel%d%d%d%s",
 			mknb_func.coul,mknb_func.vdw,mknb_func.water,
 			mknb_func.do_force ? "" : "nf");
 #endif
@@ -184,14 +189,15 @@ mknb_write_file_header(void)
 				" * by the program mknb in the Gromacs distribution.\n"
 				" *\n"
 				" * Options used when generation this file:\n"
-				" * Language:         c\n"
+				" * Language:         %s\n"
 				" * Precision:        %s\n"
 				" * Threads:          %s\n"
 				" * Software invsqrt: %s\n"
 				" * PowerPC invsqrt:  %s\n"
 				" * Prefetch forces:  %s\n"
 				" * Comments:         %s\n */\n",
-				mknb_double ? "double" : "single",
+				mknb_simd ? "c, SIMD (gmx_simd.h)" : "c",
+				mknb_simd ? "any" : (mknb_double ? "double" : "single"),
 				mknb_options.threads ? "yes" : "no",
 				mknb_options.software_invsqrt ? "yes" : "no",
 				mknb_options.ppc_invsqrt ? "yes" : "no",
@@ -206,6 +212,9 @@ mknb_write_file_header(void)
 
 		fprintf(mknb_output,"#include<math.h>\n");
 
+		if(mknb_simd)
+			fprintf(mknb_output,"#include<types/simple.h>\n#include<gmx_simd.h>\n");
+
 		if(mknb_options.software_invsqrt)
 			fprintf(mknb_output,"#include<vec.h>\n");
 
@@ -269,6 +278,7 @@ main(int argc,char *argv[])
 	mknb_options.software_invsqrt = 0; /* global variable in mknb.c */
 	mknb_options.ppc_invsqrt      = 0; /* global variable in mknb.c */
 	mknb_options.prefetch_forces  = 0; /* global variable in mknb.c */
+	mknb_simd                     = 0; /* global variable in mknb_metacode.c */
 
 	fprintf(stderr,">>> Gromacs nonbonded kernel generator (-h for help)\n");
 
@@ -282,6 +292,8 @@ main(int argc,char *argv[])
 			mknb_double                   = 1;
 		else if(argv[i][1]=='t') /* t as in threads */
 			mknb_options.threads          = 1;
+		else if(argv[i][1]=='s' && argv[i][2]=='i') /* si as in simd */
+			mknb_simd                     = 1;
 		else if(argv[i][1]=='s') /* s as in software_invsqrt */
 			mknb_options.software_invsqrt = 1;
 		else if(argv[i][1]=='p' && argv[i][2]=='p') /* pp as in ppc_invsqrt */
@@ -306,6 +318,9 @@ main(int argc,char *argv[])
 					" -fortran           Write Fortran77 code instead of C\n"
 					" -double            Use double precision iso. single\n"
 					" -threads           Write kernels with thread support\n"
+					" -simd              Write C kernels using the SIMD layer\n"
+					"                    in gmx_simd.h (no Generalized-Born,\n"
+					"                    additional analytical Ewald kernels)\n"
 					" -software_invsqrt  Use Gromacs software for 1/sqrt(x)\n"
 					" -ppc_invsqrt       Use PowerPC intrinsics for 1/sqrt(x)\n"
 					"                    (even better: -ppc_invsqrt=1 for pwr4/ppc440/450)\n"
@@ -316,10 +331,23 @@ main(int argc,char *argv[])
 	}
 
 
-	fprintf(stderr,">>> Generating %s%s precision functions in %s.\n",
-			(mknb_options.threads==1) ? "multithreaded " : "",
-			(mknb_double) ? "double" : "single",
-			(mknb_fortran) ? "Fortran77" : "C");
+	if(mknb_simd) {
+		/* The SIMD layer provides 1/sqrt(x), and loads forces itself */
+		if(mknb_fortran) {
+			fprintf(stderr,"Error: SIMD kernels can only be written in C.\n");
+			exit(1);
+		}
+		mknb_options.software_invsqrt = 0;
+		mknb_options.ppc_invsqrt      = 0;
+		mknb_options.prefetch_forces  = 0;
+		fprintf(stderr,">>> Generating %sSIMD functions in C.\n",
+				(mknb_options.threads==1) ? "multithreaded " : "");
+	} else {
+		fprintf(stderr,">>> Generating %s%s precision functions in %s.\n",
+				(mknb_options.threads==1) ? "multithreaded " : "",
+				(mknb_double) ? "double" : "single",
+				(mknb_fortran) ? "Fortran77" : "C");
+	}
 	if(mknb_options.software_invsqrt)
 		fprintf(stderr,">>> Using Gromacs software version of 1/sqrt(x).\n");
 
@@ -375,6 +403,20 @@ main(int argc,char *argv[])
 				if(mknb_func.coul==MKNB_COUL_GB && 
 				   mknb_func.water!=MKNB_WATER_NO)
 					continue;
+
+				/* The Generalized-Born kernels accumulate the
+				 * polarization energy through the work array,
+				 * which is not supported by the SIMD kernels.
+				 */
+				if(mknb_simd && mknb_func.coul==MKNB_COUL_GB)
+					continue;
+
+				/* The analytical Ewald kernels need the erfc
+				 * approximation of the SIMD layer, the other
+				 * languages use the tabulated kernels.
+				 */
+				if(!mknb_simd && mknb_func.coul==MKNB_COUL_EWALD)
+					continue;
 	
 				/* Open a new file for this function type */
 #ifdef IBM_FORTRAN_CPP
@@ -383,7 +425,7 @@ main(int argc,char *argv[])
 #else
 				sprintf(filename,"nb_kernel%d%d%d_%s.%s",
 						mknb_func.coul,mknb_func.vdw,mknb_func.water,
-						(mknb_fortran) ? "f" : "c",
+						(mknb_fortran) ? "f" : (mknb_simd ? "simd" : "c"),
 						(mknb_fortran) ? "f" : "c");
 #endif
 			
@@ -410,8 +452,11 @@ main(int argc,char *argv[])
 				/* Wrote one more without crashing - be happy! */
 				nfiles++;
 
-				/* Apparently we have 67 files in total now... */
-				fprintf(stderr,"\rProgress: %2d%%",100*nfiles/67);
+				/* Apparently we have 67 files in total now,
+				 * or 83 for SIMD without Generalized-Born
+				 * but with analytical Ewald...
+				 */
+				fprintf(stderr,"\rProgress: %2d%%",100*nfiles/(mknb_simd ? 83 : 67));
 			}
 		}
 	}
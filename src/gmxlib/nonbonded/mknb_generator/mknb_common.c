@@ -36,7 +36,8 @@ mknb_coul_names[MKNB_COUL_NR] = {
 	"Normal Coulomb",
 	"Reaction field",
 	"Tabulated",
-	"Generalized-Born"
+	"Generalized-Born",
+	"Ewald real-space, analytical"
 };
 
 
@@ -86,6 +86,7 @@ enum mknb_coul {
 	MKNB_COUL_RF,        /*!< Reaction-Field Coulomb           */
 	MKNB_COUL_TAB,       /*!< Tabulated Coulomb                */
 	MKNB_COUL_GB,        /*!< Generalized Born Coulomb         */
+	MKNB_COUL_EWALD,     /*!< Ewald real-space, analytical erfc */
 	MKNB_COUL_NR         /*!< Number of choices for Coulomb    */
 };
 
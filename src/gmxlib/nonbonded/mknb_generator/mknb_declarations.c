@@ -39,7 +39,7 @@ mknb_function_header(char *funcname)
 	 */
 	if(!mknb_fortran) {
 
-#define C_REAL  (mknb_double ? "double *" : "float *")
+#define C_REAL  (mknb_simd ? "real *" : (mknb_double ? "double *" : "float *"))
 
 		fprintf(mknb_output,"void %s(\n",funcname); 
 		fprintf(mknb_output,"%19s %-8s %6s p_nri,\n",       "", "int *",  "");
@@ -63,6 +63,19 @@ mknb_function_header(char *funcname)
 		fprintf(mknb_output,"%19s %-8s %6s Vvdw,\n",       "", C_REAL,    "");
 		fprintf(mknb_output,"%19s %-8s %6s p_tabscale,\n",  "", C_REAL,   "");
 		fprintf(mknb_output,"%19s %-8s %6s VFtab,\n",      "", C_REAL,    "");
+		if(mknb_simd) {
+			/* The pair energies for MC moves are not supported by
+			 * the SIMD kernels, but they have the full call sequence.
+			 */
+			fprintf(mknb_output,"%19s %-8s %6s enerd1,\n",   "", C_REAL,    "");
+			fprintf(mknb_output,"%19s %-8s %6s enerd2,\n",   "", C_REAL,    "");
+			fprintf(mknb_output,"%19s %-8s %6s enerd3,\n",   "", C_REAL,    "");
+			fprintf(mknb_output,"%19s %-8s %6s enerd4,\n",   "", C_REAL,    "");
+			fprintf(mknb_output,"%19s %-8s %6s start,\n",    "", "int *",   "");
+			fprintf(mknb_output,"%19s %-8s %6s end,\n",      "", "int *",   "");
+			fprintf(mknb_output,"%19s %-8s %6s homenr,\n",   "", "int *",   "");
+			fprintf(mknb_output,"%19s %-8s %6s nbsum,\n",    "", "int *",   "");
+		}
 		fprintf(mknb_output,"%19s %-8s %6s invsqrta,\n",   "", C_REAL,    "");
 		fprintf(mknb_output,"%19s %-8s %6s dvda,\n",       "", C_REAL,    "");
 		fprintf(mknb_output,"%19s %-8s %6s p_gbtabscale,\n","", C_REAL,   "");
@@ -157,6 +170,164 @@ mknb_finish_function()
 }
   
 
+/* Declarations for the SIMD kernels. The loop bookkeeping, i-atom data
+ * and energy/force sums stay scalar; everything computed per j atom is
+ * a gmx_simd_real_t, as are the broadcast copies of the i-atom data and
+ * of the constants used in the inner loop.
+ */
+static void
+mknb_declare_simd_variables()
+{
+	int i,j,firsti,firstj;
+	char buf[255],buf2[255];
+
+	mknb_declare_int("nri,ntype,nthreads");
+	mknb_declare_real("facel,krf,crf,tabscale,gbtabscale");
+
+	mknb_declare_int("n,ii,is3,ii3,k,nj0,nj1,ggid,nvalid");
+	mknb_declare_int("jnr[GMX_SIMD_WIDTH],j3[GMX_SIMD_WIDTH]");
+	if(mknb_options.threads)
+		mknb_declare_int("nn0,nn1,nouter,ninner");
+	mknb_declare_real("shX,shY,shZ");
+	mknb_declare_simd("mask");
+
+	if(mknb_func.do_force)             
+		mknb_declare_simd("fscal,tx,ty,tz");
+               
+	if((mknb_func.do_force && 
+		(mknb_func.coul==MKNB_COUL_NORMAL || mknb_func.coul==MKNB_COUL_RF ||
+		 mknb_func.coul==MKNB_COUL_EWALD)) ||
+	   mknb_func.vdw==MKNB_VDW_LJ || mknb_func.vdw==MKNB_VDW_BHAM) 
+		mknb_declare_simd("rinvsq");  
+
+	if(mknb_func.coul) {
+		mknb_declare_real("vctot");
+		switch(mknb_func.water) {
+		case MKNB_WATER_NO:
+			mknb_declare_real("iq");
+			mknb_declare_simd("iq");
+			break;
+		case MKNB_WATER_SPC_SINGLE:
+			mknb_declare_real("qO,qH");
+			mknb_declare_simd("qO,qH,jq");
+			break;
+		case MKNB_WATER_TIP4P_SINGLE:
+			mknb_declare_real("qH,qM");
+			mknb_declare_simd("qH,qM,jq");
+			break;
+		case MKNB_WATER_SPC_PAIR:
+			mknb_declare_real("qO,qH,qqOO,qqOH,qqHH");
+			mknb_declare_simd("qqOO,qqOH,qqHH");
+			break;
+		case MKNB_WATER_TIP4P_PAIR:
+			mknb_declare_real("qH,qM,qqMM,qqMH,qqHH");
+			mknb_declare_simd("qqMM,qqMH,qqHH");
+			break;
+		default:
+			break;
+		}
+		mknb_declare_simd("qq,vcoul,vctot");
+	}
+	if(mknb_func.coul==MKNB_COUL_RF)
+		mknb_declare_simd("krf,crf,krsq");
+	if(mknb_func.coul==MKNB_COUL_EWALD) {
+		mknb_declare_real("ewc");
+		mknb_declare_simd("ewc,ewr,ewexp");
+		if(mknb_func.do_force) {
+			mknb_declare_real("ewc_2sqrtpi");
+			mknb_declare_simd("ewc_2sqrtpi");
+		}
+	}
+
+	if(mknb_func.vdw) {
+		mknb_declare_real("Vvdwtot");
+		if(mknb_func.water==MKNB_WATER_SPC_PAIR ||
+		   mknb_func.water==MKNB_WATER_TIP4P_PAIR) {
+			/* Constant parameters, set up outside the loops */
+			mknb_declare_int("tj");
+			if(mknb_func.vdw==MKNB_VDW_BHAM)
+				mknb_declare_real("c6,cexp1,cexp2");
+			else
+				mknb_declare_real("c6,c12");
+		} else {
+			mknb_declare_int("nti");
+			mknb_declare_int("tj[GMX_SIMD_WIDTH]");
+		}
+		if(mknb_func.vdw==MKNB_VDW_BHAM)
+			mknb_declare_simd("c6,cexp1,cexp2,Vvdwexp,br");
+		else
+			mknb_declare_simd("c6,c12,Vvdw12");
+		if(mknb_func.vdw!=MKNB_VDW_TAB)
+			mknb_declare_simd("rinvsix");
+		mknb_declare_simd("Vvdw6,Vvdwtot");
+	}
+
+	if(mknb_func.coul==MKNB_COUL_TAB || mknb_func.vdw==MKNB_VDW_TAB) {
+		mknb_declare_int("nnn[GMX_SIMD_WIDTH]");
+		mknb_declare_simd("tabscale,r,rt,n0,eps,eps2");
+		mknb_declare_simd("Y,F,G,H,Geps,Heps2,Fp,VV");
+		if(mknb_func.do_force) {
+			mknb_declare_simd("FF");
+			if(mknb_func.coul==MKNB_COUL_TAB)
+				mknb_declare_simd("fijC");
+			if(mknb_func.vdw==MKNB_VDW_TAB)
+				mknb_declare_simd("fijD,fijR");
+		}
+	}
+
+	/* TIP4P water doesnt have any coulomb interaction
+	 * on atom 1, so we skip it if we dont do LJ
+	 */
+	firsti = ((mknb_func.vdw==MKNB_VDW_NO) &&
+			  (mknb_func.water==MKNB_WATER_TIP4P_SINGLE || 
+			   mknb_func.water==MKNB_WATER_TIP4P_PAIR)) ? 2 : 1;
+	firstj = ((mknb_func.vdw==MKNB_VDW_NO) && 
+			  (mknb_func.water==MKNB_WATER_TIP4P_PAIR)) ? 2 : 1;
+
+	/* i coordinates and forces, both as scalars and vectors */
+	for(i=firsti;i<=mknb_func.ni;i++) {
+		sprintf(buf,"ix%d,iy%d,iz%d",i,i,i);
+		if(mknb_func.do_force) {
+			sprintf(buf2,",fix%d,fiy%d,fiz%d",i,i,i);
+			strcat(buf,buf2);
+		}
+		mknb_declare_real(buf);
+		mknb_declare_simd(buf);
+	}
+	/* j coordinates, and force sums for j atoms that
+	 * interact with more than one i atom.
+	 */
+	for(j=firstj;j<=mknb_func.nj;j++) {
+		sprintf(buf,"jx%d,jy%d,jz%d",j,j,j);
+		if(mknb_func.do_force && mknb_func.water &&
+		   !(mknb_func.water==MKNB_WATER_TIP4P_PAIR && j==1)) {
+			sprintf(buf2,",fjx%d,fjy%d,fjz%d",j,j,j);
+			strcat(buf,buf2);
+		}
+		mknb_declare_simd(buf);
+	}
+	for(i=firsti;i<=mknb_func.ni;i++) {
+		for(j=firstj;j<=mknb_func.nj;j++) {
+			if(mknb_func.water==MKNB_WATER_TIP4P_PAIR && 
+			   ((i==1 && j>1) || (j==1 && i>1)))
+				continue;
+			sprintf(buf,"dx%d%d,dy%d%d,dz%d%d,rsq%d%d",
+					i,j,i,j,i,j,i,j);
+			if(mknb_func.coul || mknb_func.vdw!=MKNB_VDW_LJ) {
+				if(!((mknb_func.water==MKNB_WATER_TIP4P_SINGLE || 
+					  mknb_func.water==MKNB_WATER_TIP4P_PAIR) && 
+					 i==1 && j==1 && mknb_func.vdw==MKNB_VDW_LJ)) {
+					sprintf(buf2,",rinv%d%d",i,j);
+					strcat(buf,buf2);
+				}
+			}
+			mknb_declare_simd(buf);
+		}
+	}
+	fprintf(mknb_output,"\n");
+}
+
+
 void
 mknb_declare_variables()
 {
@@ -170,6 +341,11 @@ mknb_declare_variables()
 	 * declare what we need to make the generated code prettier.
 	 */
 
+	if(mknb_simd) {
+		mknb_declare_simd_variables();
+		return;
+	}
+
 	/* Scalar versions of arguments passed by reference */
 	if(!mknb_fortran) {
 		mknb_declare_int("nri,ntype,nthreads");
@@ -358,6 +534,13 @@ mknb_initialize_data(void)
 		}
 	}	   
 
+	/* The Ewald kernels get the Ewald coefficient in the krf argument */
+	if(mknb_func.coul==MKNB_COUL_EWALD) {
+		mknb_assign("ewc","krf");
+		if(mknb_func.do_force)
+			mknb_assign("ewc_2sqrtpi","ewc*1.12837916709551257");
+	}
+
 	/* assign the charge combinations for OO,OH and HH, 
      * or HH/HL/LL for TIP4P/TIP5P 
 	 */
@@ -422,6 +605,52 @@ mknb_initialize_data(void)
 		fprintf(mknb_output,"\n");
 	}
 
+	if(mknb_simd) {
+		/* Constants used in the vectorized inner loop */
+		if(mknb_func.coul==MKNB_COUL_RF) {
+			mknb_simd_broadcast("krf");
+			mknb_simd_broadcast("crf");
+		}
+		if(mknb_func.coul==MKNB_COUL_TAB || mknb_func.vdw==MKNB_VDW_TAB)
+			mknb_simd_broadcast("tabscale");
+		if(mknb_func.coul==MKNB_COUL_EWALD) {
+			mknb_simd_broadcast("ewc");
+			if(mknb_func.do_force)
+				mknb_simd_broadcast("ewc_2sqrtpi");
+		}
+		switch(mknb_func.water) {
+		case MKNB_WATER_SPC_SINGLE:
+			mknb_simd_broadcast("qO");
+			mknb_simd_broadcast("qH");
+			break;
+		case MKNB_WATER_TIP4P_SINGLE:
+			mknb_simd_broadcast("qH");
+			mknb_simd_broadcast("qM");
+			break;
+		case MKNB_WATER_SPC_PAIR:
+			mknb_simd_broadcast("qqOO");
+			mknb_simd_broadcast("qqOH");
+			mknb_simd_broadcast("qqHH");
+			break;
+		case MKNB_WATER_TIP4P_PAIR:
+			mknb_simd_broadcast("qqMM");
+			mknb_simd_broadcast("qqMH");
+			mknb_simd_broadcast("qqHH");
+			break;
+		default:
+			break;
+		}
+		if((mknb_func.water==MKNB_WATER_SPC_PAIR || 
+			mknb_func.water==MKNB_WATER_TIP4P_PAIR) && mknb_func.vdw) {
+			mknb_simd_broadcast("c6");
+			if(mknb_func.vdw==MKNB_VDW_BHAM) {
+				mknb_simd_broadcast("cexp1");
+				mknb_simd_broadcast("cexp2");
+			} else
+				mknb_simd_broadcast("c12");
+		}
+	}
+
 	mknb_comment("Reset outer and inner iteration counters");
 
 	if(mknb_options.threads)
@@ -118,6 +118,12 @@ mknb_load_inner_coordinates()
 			  (mknb_func.water==MKNB_WATER_TIP4P_PAIR)) ? 2 : 1;
   
 	mknb_comment("load j atom coordinates");
+	if(mknb_simd) {
+		for(j=firstj;j<=mknb_func.nj;j++)
+			mknb_code("gmx_simd_gather_rvec(pos+%d,j3,&jx%d_S,&jy%d_S,&jz%d_S);",
+					  3*(j-1),j,j,j);
+		return 0;
+	}
 	for(j=firstj;j<=mknb_func.nj;j++) {
 		sprintf(tmp,"j3+%d",3*(j-1));
 		mknb_assign("jx%d","%s",j,mknb_array("pos",tmp));
@@ -209,7 +215,22 @@ mknb_load_inner_parameters(int i,int j)
   
 	/* Coulomb parameters */
 	if(mknb_func.coul) {
-		if(mknb_func.water==MKNB_WATER_NO) {
+		if(mknb_simd && mknb_func.water==MKNB_WATER_NO) {
+			mknb_assign_verbatim("qq_S","gmx_simd_mul(iq_S,gmx_simd_gather(charge,jnr))");
+			nflops++;
+		} else if(mknb_simd && (mknb_func.water==MKNB_WATER_SPC_SINGLE ||
+								mknb_func.water==MKNB_WATER_TIP4P_SINGLE)) {
+			/* Gather the charge for the first i atom that needs it */
+			if(i==((mknb_func.water==MKNB_WATER_SPC_SINGLE) ? 1 : 2))
+				mknb_assign_verbatim("jq_S","gmx_simd_gather(charge+%d,jnr)",j-1);
+			if(mknb_func.water==MKNB_WATER_SPC_SINGLE && (i==1 || i==2)) {
+				mknb_assign("qq","%s*jq", (i==1) ? "qO" : "qH");
+				nflops++;
+			} else if(mknb_func.water==MKNB_WATER_TIP4P_SINGLE && (i==2 || i==4)) {
+				mknb_assign("qq","%s*jq", (i==4) ? "qM" : "qH");
+				nflops++;
+			}
+		} else if(mknb_func.water==MKNB_WATER_NO) {
 			if(mknb_func.coul==MKNB_COUL_GB) {
 				/* Generalized born: load 1/sqrt(a) */
 				mknb_assign("isaj",mknb_array("invsqrta","jnr"));
@@ -272,6 +293,19 @@ mknb_load_inner_parameters(int i,int j)
 		   ((mknb_func.water==MKNB_WATER_SPC_SINGLE || 
 			 mknb_func.water==MKNB_WATER_TIP4P_SINGLE) && (i==1))) {
 
+			if(mknb_simd) {
+				mknb_code("gmx_simd_vdw_index(tj,nti,%d,type,jnr);",
+						  mknb_func.nvdw_parameters);
+				mknb_assign_verbatim("c6_S","gmx_simd_gather(vdwparam,tj)");
+				if(mknb_func.vdw==MKNB_VDW_BHAM) {
+					mknb_assign_verbatim("cexp1_S","gmx_simd_gather(vdwparam+1,tj)");
+					mknb_assign_verbatim("cexp2_S","gmx_simd_gather(vdwparam+2,tj)");
+				} else {
+					mknb_assign_verbatim("c12_S","gmx_simd_gather(vdwparam+1,tj)");
+				}
+				return nflops;
+			}
+
 			mknb_assign("tj","nti+%d*%s%s",mknb_func.nvdw_parameters,
 						mknb_array("type","jnr"), (mknb_fortran) ? "+1" : "");
 
@@ -346,6 +380,50 @@ mknb_calc_square_root()
 	return nflops;
 }
 
+/* Update the j forces in the SIMD kernels. The j force is kept
+ * in fjx etc. when several i atoms act on the same j atom, and is
+ * subtracted from memory for the valid elements with the last i atom.
+ */
+static void
+mknb_innerloop_simd_jforce(int i,int j)
+{
+	int read_from_mem,write_to_mem;
+
+	/* Same conditions as in the scalar code below */
+	read_from_mem = 
+		(mknb_func.water==MKNB_WATER_NO) ||
+		(mknb_func.water==MKNB_WATER_SPC_SINGLE && i==1) ||
+		(mknb_func.water==MKNB_WATER_TIP4P_SINGLE && 
+		 (i==1 || (i==2 && mknb_func.vdw==MKNB_VDW_NO))) ||
+		(mknb_func.water==MKNB_WATER_SPC_PAIR && i==1) ||
+		(mknb_func.water==MKNB_WATER_TIP4P_PAIR && (i==1 || i==2));
+	write_to_mem =
+		(mknb_func.water==MKNB_WATER_NO) ||
+		(mknb_func.water==MKNB_WATER_SPC_SINGLE && i==3) ||
+		(mknb_func.water==MKNB_WATER_TIP4P_SINGLE && i==4) ||
+		(mknb_func.water==MKNB_WATER_SPC_PAIR && i==3) ||
+		(mknb_func.water==MKNB_WATER_TIP4P_PAIR && (i==1 || i==4));
+
+	if(read_from_mem && write_to_mem) {
+		mknb_code("gmx_simd_decrement_rvec(faction+%d,j3,nvalid,tx_S,ty_S,tz_S);",
+				  3*(j-1));
+		return;
+	}
+	if(read_from_mem) {
+		mknb_assign("fjx%d","tx",j);
+		mknb_assign("fjy%d","ty",j);
+		mknb_assign("fjz%d","tz",j);
+	} else {
+		mknb_assign("fjx%d","fjx%d + tx",j,j);
+		mknb_assign("fjy%d","fjy%d + ty",j,j);
+		mknb_assign("fjz%d","fjz%d + tz",j,j);
+	}
+	if(write_to_mem) 
+		mknb_code("gmx_simd_decrement_rvec(faction+%d,j3,nvalid,fjx%d_S,fjy%d_S,fjz%d_S);",
+				  3*(j-1),j,j,j);
+}
+
+
 void mknb_innerloop()
 {
 	int i,j,firsti,firstj;
@@ -354,16 +432,30 @@ void mknb_innerloop()
 	char tmp[255],mem[255],var[255],rsq[255],rinv[255];
 
 	
-	mknb_start_loop("k", "nj0" ,"nj1");
+	if(mknb_simd) {
+		/* Handle GMX_SIMD_WIDTH j atoms per iteration */
+		mknb_code("");
+		mknb_code("for(k=nj0; (k<nj1); k+=GMX_SIMD_WIDTH)");
+		mknb_code("{");
+		mknb_indent_level++;
+
+		mknb_comment("Get j neighbor indices, coordinate indices and mask");
+		mknb_assign("nvalid","gmx_simd_load_jindex(jjnr+k,nj1-k,jnr,j3,&mask_S)");
+	} else {
+		mknb_start_loop("k", "nj0" ,"nj1");
 
-	mknb_comment("Get j neighbor index, and coordinate index");
-	mknb_assign("jnr", "%s%s", mknb_array("jjnr","k"), 
-				(mknb_fortran) ? "+1" : "");
-	mknb_assign("j3","3*jnr%s", (mknb_fortran) ? "-2" : "");
+		mknb_comment("Get j neighbor index, and coordinate index");
+		mknb_assign("jnr", "%s%s", mknb_array("jjnr","k"), 
+					(mknb_fortran) ? "+1" : "");
+		mknb_assign("j3","3*jnr%s", (mknb_fortran) ? "-2" : "");
+	}
   
 	/* Load j particle coordinates */
 	nflops += mknb_load_inner_coordinates();
 
+	/* All arithmetic below is vectorized in SIMD kernels */
+	mknb_simd_vectorize = mknb_simd;
+
 	nflops += mknb_calc_distance();
   
 	/* calculate inverse square root, except when we only do LJ coulomb -
@@ -440,6 +532,12 @@ void mknb_innerloop()
 				 * The last time the result is stored to memory.
 				 */
 				mknb_comment("Decrement j atom force");
+
+				if(mknb_simd) {
+					nflops += 3;
+					mknb_innerloop_simd_jforce(i,j);
+					continue;
+				}
 				/* Read from memory if we did not prefetch, if one of this is true:
 				 * Non-water
 				 * SPC_SINGLE, and i==1
@@ -494,6 +592,8 @@ void mknb_innerloop()
 			}
 		}
 	}
+	mknb_simd_vectorize = 0;
+
 	sprintf(tmp,"Inner loop uses %d flops/iteration",nflops);
 	mknb_comment(tmp);
 	
@@ -42,6 +42,26 @@ static char
 fs_rinvsq[1024];             
 
 
+/* Offset of the current table in the SIMD kernels, which keep
+ * the table index nnn for all tables and add this when loading.
+ */
+static int
+simd_table_offset;
+
+
+
+/* In SIMD kernels, clear a variable in the elements beyond the
+ * end of the neighborlist. Only the energies and the scalar force
+ * need this, everything else is derived from them.
+ */
+static void
+mknb_simd_mask(char *var)
+{
+  if(mknb_simd)
+    mknb_assign(var,"%s&mask",var);
+}
+
+
 
 
 /* UTILITY ROUTINES FOR TABLE INTERACTIONS: */
@@ -57,14 +77,21 @@ mknb_calc_table_index(char *r)
   nflops++;
   
   /* Truncate rt to an integer. */
-  mknb_assign("n0","rt");
+  if(mknb_simd) {
+    mknb_assign_verbatim("n0_S","gmx_simd_table_index(rt_S,%d,nnn)",
+                         mknb_func.table_element_size);
+    simd_table_offset = 0;
+  } else {
+    mknb_assign("n0","rt");
+  }
 
   mknb_assign("eps","rt-n0");
   mknb_assign("eps2","eps*eps");
   nflops += 2;
 
-  mknb_assign("nnn","%d*n0%s",mknb_func.table_element_size, 
-	      (mknb_fortran) ? "+1" : "");
+  if(!mknb_simd)
+    mknb_assign("nnn","%d*n0%s",mknb_func.table_element_size, 
+	        (mknb_fortran) ? "+1" : "");
 
   return nflops;
 
@@ -100,10 +127,17 @@ mknb_read_table(char *tabname)
   int nflops = 0;
 
   /* See the Gromacs manual for details on cubic spline table interpolation */
-  mknb_assign("Y",mknb_array(tabname,"nnn"));
-  mknb_assign("F",mknb_array(tabname,"nnn+1"));
-  mknb_assign("Geps","eps*%s",mknb_array(tabname,"nnn+2"));
-  mknb_assign("Heps2","eps2*%s",mknb_array(tabname,"nnn+3"));
+  if(mknb_simd) {
+    mknb_code("gmx_simd_table_load(%s+%d,nnn,&Y_S,&F_S,&G_S,&H_S);",
+              tabname,simd_table_offset);
+    mknb_assign("Geps","eps*G");
+    mknb_assign("Heps2","eps2*H");
+  } else {
+    mknb_assign("Y",mknb_array(tabname,"nnn"));
+    mknb_assign("F",mknb_array(tabname,"nnn+1"));
+    mknb_assign("Geps","eps*%s",mknb_array(tabname,"nnn+2"));
+    mknb_assign("Heps2","eps2*%s",mknb_array(tabname,"nnn+3"));
+  }
   
   mknb_assign("Fp","F+Geps+Heps2");
   mknb_assign("VV","Y+eps*Fp");
@@ -134,6 +168,7 @@ mknb_coul_normal(char *rinv)
     sprintf(fs_rinvsq,"vcoul");
 
   /* Update total Coulomb energy */
+  mknb_simd_mask("vcoul");
   mknb_assign("vctot","vctot+vcoul");
   /* Done. 2 flops */
   return 2;
@@ -150,6 +185,7 @@ mknb_coul_rf(char *rsq,char *rinv)
   if(mknb_func.do_force)
     sprintf(fs_rinvsq,"qq*(%s-2.0*krsq)",rinv);
 
+  mknb_simd_mask("vcoul");
   mknb_assign("vctot","vctot+vcoul");
   /* Done. 8 flops with force, 5 for energy only */
   return mknb_func.do_force ? 8 : 5;
@@ -174,6 +210,7 @@ mknb_coul_tab(char *rsq, char *rinv)
     /* fs_minusrinv is empty */
     sprintf(fs_minus_tabscale_rinv,"fijC");
   }
+  mknb_simd_mask("vcoul");
   mknb_assign("vctot","vctot + vcoul");
   nflops++;
   
@@ -181,6 +218,29 @@ mknb_coul_tab(char *rsq, char *rinv)
 }
   
 
+int
+mknb_coul_ewald(char *rsq, char *rinv)
+{
+  mknb_comment("Ewald real-space coulomb interaction without tables");
+
+  /* erfc(ewc*r) = erfcx(ewc*r)*exp(-(ewc*r)^2), where the scaled function
+   * erfcx is a polynomial in gmx_simd.h. The Gaussian factor is shared
+   * with the force, which is qq*(erfc(ewc*r)/r + 2 ewc/sqrt(pi) exp(-(ewc*r)^2))/r^2.
+   */
+  mknb_assign("ewr","ewc*%s*%s",rsq,rinv);
+  mknb_assign("ewexp","exp(-ewr*ewr)");
+  mknb_assign("vcoul","qq*erfcx(ewr)*ewexp*%s",rinv);
+
+  if(mknb_func.do_force)
+    sprintf(fs_rinvsq,"vcoul+qq*ewc_2sqrtpi*ewexp");
+
+  mknb_simd_mask("vcoul");
+  mknb_assign("vctot","vctot+vcoul");
+  /* The exponential and the erfcx polynomial are about 20 flops each */
+  return mknb_func.do_force ? 48 : 45;
+}
+
+
 int
 mknb_coul_gb(char *rsq, char *rinv)
 {
@@ -233,6 +293,8 @@ mknb_vdw_lj(char *rsq, char *rinv)
       strcat(fs_rinvsq,"+12.0*Vvdw12-6.0*Vvdw6");
   }
 
+  mknb_simd_mask("Vvdw6");
+  mknb_simd_mask("Vvdw12");
   mknb_assign("Vvdwtot","Vvdwtot+Vvdw12-Vvdw6");
   /* Done. 11 flops with force, 7 for energy only */
   return mknb_func.do_force ? 11 : 7;
@@ -256,6 +318,8 @@ mknb_vdw_bham(char *rsq, char *rinv)
       strcat(fs_rinvsq,"+br*Vvdwexp-6.0*Vvdw6");
   }
 
+  mknb_simd_mask("Vvdw6");
+  mknb_simd_mask("Vvdwexp");
   mknb_assign("Vvdwtot","Vvdwtot+Vvdwexp-Vvdw6");
   /* exp() is expensive, 25 flops is a low estimate.
    * This gives about 37 flops , 34 for energy only
@@ -277,7 +341,10 @@ mknb_vdw_tab(char *rsq, char *rinv)
      */
     if(mknb_func.table_element_size==12) 
     {
-        mknb_assign("nnn","nnn+4");
+        if(mknb_simd)
+            simd_table_offset += 4;
+        else
+            mknb_assign("nnn","nnn+4");
     }
     /* Without coulomb, dispersion is first element - nothing to do */
    
@@ -299,7 +366,10 @@ mknb_vdw_tab(char *rsq, char *rinv)
     }
 
     mknb_comment("Tabulated VdW interaction - repulsion");
-    mknb_assign("nnn", "nnn+4");
+    if(mknb_simd)
+        simd_table_offset += 4;
+    else
+        mknb_assign("nnn", "nnn+4");
     nflops += mknb_read_table("VFtab");
     mknb_assign("Vvdw12","c12*VV");
     
@@ -312,6 +382,8 @@ mknb_vdw_tab(char *rsq, char *rinv)
         strcat(fs_minus_tabscale_rinv,"+fijR");
         nflops++;
     }
+    mknb_simd_mask("Vvdw6");
+    mknb_simd_mask("Vvdw12");
     mknb_assign("Vvdwtot","Vvdwtot+ Vvdw6 + Vvdw12");
     nflops += 2;
     
@@ -371,7 +443,8 @@ mknb_calculate_interaction(char *rsq, char *rinv)
    * All coulomb calculations except tabulated ones need rinvsq for force.
    * All vdw calculations except tabulated ones need it (even for energy).
    */
-  if(((mknb_func.coul==MKNB_COUL_NORMAL || mknb_func.coul==MKNB_COUL_RF) && mknb_func.do_force) ||
+  if(((mknb_func.coul==MKNB_COUL_NORMAL || mknb_func.coul==MKNB_COUL_RF ||
+        mknb_func.coul==MKNB_COUL_EWALD) && mknb_func.do_force) ||
      (mknb_func.vdw==MKNB_VDW_LJ && mknb_func.coul) || mknb_func.vdw==MKNB_VDW_BHAM) {
     mknb_assign("rinvsq","%s*%s",rinv,rinv);
     nflops++;
@@ -405,6 +478,9 @@ mknb_calculate_interaction(char *rsq, char *rinv)
   case MKNB_COUL_GB:
     nflops += mknb_coul_gb(rsq,rinv);
     break;
+  case MKNB_COUL_EWALD:
+    nflops += mknb_coul_ewald(rsq,rinv);
+    break;
   default:
     fprintf(stderr,"Error: Coulomb type %d undefined (mknb_interactions.c)\n",mknb_func.coul);
     exit(0);    
@@ -456,6 +532,8 @@ mknb_calculate_interaction(char *rsq, char *rinv)
 	  mknb_assign("fscal","-(%s)*%s",fs_minus_rinv,rinv);
 	  nflops += 2;
   }
+  if(mknb_func.do_force)
+	  mknb_simd_mask("fscal");
 	
   return nflops;
 }
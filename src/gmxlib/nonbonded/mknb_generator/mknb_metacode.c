@@ -20,6 +20,7 @@
 #include <string.h>
 #include <stdarg.h>
 #include <ctype.h>
+#include <stdlib.h>
 
 #include <mknb_metacode.h>
 
@@ -33,6 +34,8 @@
 int                   mknb_fortran=0;  /* 1 if fortran is used  */
 int                   mknb_double=0;   /* 1 if double precision */
 int                   mknb_keep_comments=0;
+int                   mknb_simd=0;     /* 1 for SIMD C code     */
+int                   mknb_simd_vectorize=0;
 int                   mknb_indent_level=0;
 FILE *                mknb_output=NULL;
 
@@ -104,6 +107,8 @@ mknb_declare_real(char *name)
 	  sprintf(type_name, "%-13s", mknb_double ? "real*8" : "real*4");
 #endif
   }
+  else if(mknb_simd)
+    sprintf(type_name, "%-13s", "real");
   else
     sprintf(type_name, "%-13s", mknb_double ? "double" : "float");
 
@@ -138,8 +143,8 @@ mknb_declare_const_real(char *name, double value)
 	  mknb_code("%s %s",type_name,name);
       mknb_code("    parameter (%s = %f)",name,value);
   } else {
-    sprintf(type_name, "%-13s",
-	mknb_double ? "const double" : "const float");
+    sprintf(type_name, "%-13s", mknb_simd ? "const real" :
+	(mknb_double ? "const double" : "const float"));
     mknb_code("%s %s = %.16f;",type_name,name,value);
   }
 }
@@ -194,6 +199,36 @@ mknb_declare_other(char *type_name,char *name)
 }
 
 
+/* SIMD variables, name_S for each name in the comma-separated list */
+void
+mknb_declare_simd(char *names)
+{
+  char buf[1024];
+  char *p;
+  int  i;
+
+  i = 0;
+  for(p=names; *p; p++) {
+    if(*p==',') {
+      i += sprintf(buf+i,"_S,");
+    } else {
+      buf[i++] = *p;
+    }
+  }
+  sprintf(buf+i,"_S");
+
+  mknb_declare_other("gmx_simd_real_t",buf);
+}
+
+
+/* Copy a scalar into all elements of a SIMD variable */
+void
+mknb_simd_broadcast(char *name)
+{
+  mknb_assign_verbatim("%s_S","gmx_simd_set1(%s)",name,name);
+}
+
+
 /* Reference an element in a list */
 char *
 mknb_array(char *a, char *idx)
@@ -315,6 +350,189 @@ mknb_code(char *format, ...)
   
 
 
+/* Translation of the infix expressions in assignments to SIMD code.
+ * This is a small recursive-descent parser for the expressions the
+ * generator writes: variables, numbers, parentheses, unary minus, the
+ * binary operators + - * / and & (bitwise and, i.e. masking), and the
+ * functions sqrt(), exp() and erfcx(). Each level writes its translation to out.
+ */
+#define MKNB_SIMD_BUFLEN 4096
+
+static char *mknb_simd_expr;  /* Expression being translated */
+static char *mknb_simd_pos;   /* Current parse position      */
+
+static void mknb_simd_and(char *out);
+
+
+static void
+mknb_simd_error(char *msg)
+{
+  fprintf(stderr,"Error: %s when vectorizing expression:\n%s\n",
+          msg,mknb_simd_expr);
+  exit(1);
+}
+
+
+static void
+mknb_simd_skip_space(void)
+{
+  while(*mknb_simd_pos==' ')
+    mknb_simd_pos++;
+}
+
+
+/* Variable, number, function call or parenthesized expression */
+static void
+mknb_simd_primary(char *out)
+{
+  char name[255],arg[MKNB_SIMD_BUFLEN];
+  int  i;
+
+  mknb_simd_skip_space();
+  
+  i = 0;
+  if(*mknb_simd_pos=='(') {
+    mknb_simd_pos++;
+    mknb_simd_and(out);
+    mknb_simd_skip_space();
+    if(*mknb_simd_pos!=')')
+      mknb_simd_error("missing ')'");
+    mknb_simd_pos++;
+  } else if(isdigit(*mknb_simd_pos) || *mknb_simd_pos=='.') {
+    while(isdigit(*mknb_simd_pos) || *mknb_simd_pos=='.' || 
+          *mknb_simd_pos=='e' || *mknb_simd_pos=='E' ||
+          ((*mknb_simd_pos=='-' || *mknb_simd_pos=='+') && 
+           (mknb_simd_pos[-1]=='e' || mknb_simd_pos[-1]=='E')))
+      name[i++] = *(mknb_simd_pos++);
+    name[i] = '\0';
+    sprintf(out,"gmx_simd_set1(%s)",name);
+  } else if(isalpha(*mknb_simd_pos) || *mknb_simd_pos=='_') {
+    while(isalnum(*mknb_simd_pos) || *mknb_simd_pos=='_')
+      name[i++] = *(mknb_simd_pos++);
+    name[i] = '\0';
+    mknb_simd_skip_space();
+    if(*mknb_simd_pos=='(') {
+      /* Function call */
+      mknb_simd_pos++;
+      mknb_simd_and(arg);
+      mknb_simd_skip_space();
+      if(*mknb_simd_pos!=')')
+        mknb_simd_error("missing ')'");
+      mknb_simd_pos++;
+      if(!strcmp(name,"sqrt") || !strcmp(name,"exp") || !strcmp(name,"erfcx"))
+        sprintf(out,"gmx_simd_%s(%s)",name,arg);
+      else
+        mknb_simd_error("unsupported function");
+    } else {
+      sprintf(out,"%s_S",name);
+    }
+  } else {
+    mknb_simd_error("unexpected character");
+  }
+}
+
+
+static void
+mknb_simd_unary(char *out)
+{
+  char arg[MKNB_SIMD_BUFLEN];
+
+  mknb_simd_skip_space();
+  if(*mknb_simd_pos=='-') {
+    mknb_simd_pos++;
+    mknb_simd_unary(arg);
+    /* Negative constants are broadcast directly */
+    if(!strncmp(arg,"gmx_simd_set1(",14))
+      sprintf(out,"gmx_simd_set1(-%s",arg+14);
+    else
+      sprintf(out,"gmx_simd_sub(gmx_simd_setzero(),%s)",arg);
+  } else {
+    mknb_simd_primary(out);
+  }
+}
+
+
+static void
+mknb_simd_product(char *out)
+{
+  char left[MKNB_SIMD_BUFLEN],right[MKNB_SIMD_BUFLEN];
+  char op;
+
+  mknb_simd_unary(out);
+  mknb_simd_skip_space();
+  while(*mknb_simd_pos=='*' || *mknb_simd_pos=='/') {
+    op = *(mknb_simd_pos++);
+    strcpy(left,out);
+    mknb_simd_unary(right);
+    if(op=='*') {
+      sprintf(out,"gmx_simd_mul(%s,%s)",left,right);
+    } else if(!strcmp(left,"gmx_simd_set1(1.0)")) {
+      /* Reciprocals use the fast approximate instructions */
+      if(!strncmp(right,"gmx_simd_sqrt(",14)) {
+        right[strlen(right)-1] = '\0';
+        sprintf(out,"gmx_simd_invsqrt(%s)",right+14);
+      } else {
+        sprintf(out,"gmx_simd_inv(%s)",right);
+      }
+    } else {
+      sprintf(out,"gmx_simd_div(%s,%s)",left,right);
+    }
+    mknb_simd_skip_space();
+  }
+}
+
+
+static void
+mknb_simd_sum(char *out)
+{
+  char left[MKNB_SIMD_BUFLEN],right[MKNB_SIMD_BUFLEN];
+  char op;
+
+  mknb_simd_product(out);
+  mknb_simd_skip_space();
+  while(*mknb_simd_pos=='+' || *mknb_simd_pos=='-') {
+    op = *(mknb_simd_pos++);
+    strcpy(left,out);
+    mknb_simd_product(right);
+    sprintf(out,"gmx_simd_%s(%s,%s)",(op=='+') ? "add" : "sub",left,right);
+    mknb_simd_skip_space();
+  }
+}
+
+
+static void
+mknb_simd_and(char *out)
+{
+  char left[MKNB_SIMD_BUFLEN],right[MKNB_SIMD_BUFLEN];
+
+  mknb_simd_sum(out);
+  mknb_simd_skip_space();
+  while(*mknb_simd_pos=='&') {
+    mknb_simd_pos++;
+    strcpy(left,out);
+    mknb_simd_sum(right);
+    sprintf(out,"gmx_simd_and(%s,%s)",left,right);
+    mknb_simd_skip_space();
+  }
+}
+
+
+/* Translate the expression in buf to SIMD code, in place */
+static void
+mknb_simd_translate(char *buf)
+{
+  char out[MKNB_SIMD_BUFLEN];
+
+  mknb_simd_expr = buf;
+  mknb_simd_pos  = buf;
+  mknb_simd_and(out);
+  mknb_simd_skip_space();
+  if(*mknb_simd_pos!='\0')
+    mknb_simd_error("trailing characters");
+  strcpy(buf,out);
+}
+
+
 /* Prints an assignment.
  * This routine does proper indentation, and also supports the
  * same type of variable-argument lists as printf (both in
@@ -328,15 +546,15 @@ mknb_code(char *format, ...)
  * In contrast to mknb_code(), mknb_assign() appends a semicolon when the
  * language is not set to fortran.
  * 
+ * When vectorize is set, both sides are translated to SIMD code.
  */
-void
-mknb_assign(char *left, char *right, ...)
+static void
+mknb_write_assign(int vectorize, char *left, char *right, va_list ap)
 {
   int i;
   char *format;
-  char buf[4096],tmp[4096];
-  char outbuf[4096];
-  va_list ap;
+  char buf[MKNB_SIMD_BUFLEN],tmp[MKNB_SIMD_BUFLEN];
+  char outbuf[2*MKNB_SIMD_BUFLEN];
   int d;
   double f;
   char *s;
@@ -344,8 +562,6 @@ mknb_assign(char *left, char *right, ...)
   
   sprintf(outbuf,"%s",mknb_indent());
  
-  va_start(ap,right); 
- 
   for(i=0;i<=1;i++) {
     /* first we do the left buffer, then repeat everything for the right. */
     if(i==0)
@@ -382,6 +598,12 @@ mknb_assign(char *left, char *right, ...)
       strcat(buf,tmp);
       format++;
     }
+    if(vectorize) {
+      if(i==0) 
+        strcat(buf,"_S");
+      else
+        mknb_simd_translate(buf);
+    }
     if(i==1 && !mknb_fortran)
       strcat(buf,";");
     
@@ -391,7 +613,6 @@ mknb_assign(char *left, char *right, ...)
     if(i==0)
       strcat(outbuf," = ");
   }
-  va_end(ap);
 
   if(mknb_fortran)
     mknb_fortran_splitline(outbuf);
@@ -400,9 +621,29 @@ mknb_assign(char *left, char *right, ...)
   
   fprintf(mknb_output,"\n");
 }
-  
 
 
+void
+mknb_assign(char *left, char *right, ...)
+{
+  va_list ap;
+
+  va_start(ap,right);
+  mknb_write_assign(mknb_simd_vectorize,left,right,ap);
+  va_end(ap);
+}
+
+
+void
+mknb_assign_verbatim(char *left, char *right, ...)
+{
+  va_list ap;
+
+  va_start(ap,right);
+  mknb_write_assign(0,left,right,ap);
+  va_end(ap);
+}
+  
 /* Start a for loop and increase indentation.*/
 void
 mknb_start_loop(char *lvar,char *from,char *to)
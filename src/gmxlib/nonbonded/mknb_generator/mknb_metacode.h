@@ -101,6 +101,49 @@ mknb_keep_comments;
 
 
 
+/*! \brief Kernel generator (only for compile): Generate SIMD code
+ *  
+ *  \internal
+ *
+ * <b>Only defined/used in the nonbonded kernel generator 
+ * program mknb. This program is run once at compile
+ * time to create the inner loops, and then discarded.
+ * This source is NOT linked into any Gromacs library.</b>
+ *
+ *  Global variable, 1 if C code using the width-agnostic SIMD layer
+ *  in include/gmx_simd.h is generated. Floating-point variables are
+ *  then declared as 'real', since the same source is compiled for
+ *  each precision and SIMD target.
+ */
+extern int                 
+mknb_simd;    
+
+
+
+
+/*! \brief Kernel generator (only for compile): Vectorize assignments
+ *  
+ *  \internal
+ *
+ * <b>Only defined/used in the nonbonded kernel generator 
+ * program mknb. This program is run once at compile
+ * time to create the inner loops, and then discarded.
+ * This source is NOT linked into any Gromacs library.</b>
+ *
+ *  While this is 1, mknb_assign() writes SIMD code: the variable
+ *  'name' on either side becomes the vector 'name_S', numbers are
+ *  broadcast, and the operators +,-,*,/ and & as well as sqrt() and 
+ *  exp() become the corresponding gmx_simd_ calls. 1.0/x and 
+ *  1.0/sqrt(x) are mapped to the approximate reciprocal (square root)
+ *  operations. This way the interaction code in mknb_interactions.c
+ *  is shared between the scalar and SIMD kernels.
+ */
+extern int                 
+mknb_simd_vectorize;    
+
+
+
+
 /*! \brief Kernel generator (only for compile): Current indentation level
  * 
  * \internal
@@ -308,6 +351,45 @@ mknb_declare_other          (char *     type_name,
 
 
 
+/*! \brief Kernel generator (only for compile): Declare SIMD variables
+ *
+ *  \internal
+ *
+ *  <b>Only defined/used in the nonbonded kernel generator 
+ *  program mknb. This program is run once at compile
+ *  time to create the inner loops, and then discarded.
+ *  This source is NOT linked into any Gromacs library.</b>
+ *
+ *  Declares a gmx_simd_real_t variable name_S for each name in 
+ *  the comma-separated list, i.e. the names vectorized assignments use.
+ *
+ *  \param names     Comma-separated list of variable names
+ */
+void
+mknb_declare_simd           (char *     names);
+
+
+
+
+/*! \brief Kernel generator (only for compile): Broadcast scalar to SIMD
+ *
+ *  \internal
+ *
+ *  <b>Only defined/used in the nonbonded kernel generator 
+ *  program mknb. This program is run once at compile
+ *  time to create the inner loops, and then discarded.
+ *  This source is NOT linked into any Gromacs library.</b>
+ *
+ *  Writes <tt>name_S = gmx_simd_set1(name);</tt>
+ *
+ *  \param name      Name of the scalar variable
+ */
+void
+mknb_simd_broadcast         (char *     name);
+
+
+
+
 
 /*! \brief Kernel generator (only for compile): Reference element in a vector
  *
@@ -392,6 +474,28 @@ mknb_assign                  (char *     left,
 
 
 
+
+/*! \brief Kernel generator (only for compile): Verbatim assignment a=b
+ *
+ *  \internal
+ *
+ *  <b>Only defined/used in the nonbonded kernel generator 
+ *  program mknb. This program is run once at compile
+ *  time to create the inner loops, and then discarded.
+ *  This source is NOT linked into any Gromacs library.</b>
+ *
+ * Same as mknb_assign(), but never vectorized. Used for the SIMD
+ * statements that are already written in terms of gmx_simd.h calls,
+ * e.g. loads and gathers.
+ */
+void
+mknb_assign_verbatim         (char *     left,
+							  char *     right, 
+							  ...);
+
+
+
+
 /*! \brief Kernel generator (only for compile): Start for loop block
  *
  *  \internal 
@@ -48,6 +48,14 @@ int
 mknb_zero_outer_potential()
 {
 	mknb_comment("Zero the potential energy for this list");
+	if(mknb_simd) {
+		/* The SIMD kernels sum in vectors and reduce after the inner loop */
+		if(mknb_func.coul)
+			mknb_assign_verbatim("vctot_S","gmx_simd_setzero()");
+		if(mknb_func.vdw)
+			mknb_assign_verbatim("Vvdwtot_S","gmx_simd_setzero()");
+		return 0;
+	}
 	if(mknb_func.coul)
 		mknb_assign("vctot","0"); /* zero local potentials */
 	if(mknb_func.vdw)
@@ -83,6 +91,16 @@ mknb_load_outer_coordinates()
 		mknb_assign("iz%d","shZ + %s",i,mknb_array("pos",tmp));
 		nflops += 3; /* three additions per iteration */
 	}
+	if(mknb_simd) {
+		for(i=firsti;i<=mknb_func.ni;i++) {
+			sprintf(tmp,"ix%d",i);
+			mknb_simd_broadcast(tmp);
+			sprintf(tmp,"iy%d",i);
+			mknb_simd_broadcast(tmp);
+			sprintf(tmp,"iz%d",i);
+			mknb_simd_broadcast(tmp);
+		}
+	}
 	return nflops;
 }
 
@@ -100,7 +118,13 @@ mknb_zero_outer_forces()
 			   mknb_func.water==MKNB_WATER_TIP4P_PAIR)) ? 2 : 1;
 
 	mknb_comment("Clear i atom forces");
-	if(mknb_func.do_force)
+	if(mknb_func.do_force && mknb_simd) {
+		for(i=firsti;i<=mknb_func.ni;i++) {
+			mknb_assign_verbatim("fix%d_S","gmx_simd_setzero()",i);
+			mknb_assign_verbatim("fiy%d_S","gmx_simd_setzero()",i);
+			mknb_assign_verbatim("fiz%d_S","gmx_simd_setzero()",i);
+		}
+	} else if(mknb_func.do_force)
 		for(i=firsti;i<=mknb_func.ni;i++) {
 			mknb_assign("fix%d","0",i);
 			mknb_assign("fiy%d","0",i);
@@ -134,6 +158,8 @@ mknb_load_outer_parameters()
 		if(mknb_func.coul) {
 			mknb_assign("iq","facel*%s",mknb_array("charge","ii"));
 			nflops++;
+			if(mknb_simd)
+				mknb_simd_broadcast("iq");
 		}
     
 		/* GB parameters - inverse sqrt of born radius */
@@ -152,6 +178,36 @@ mknb_load_outer_parameters()
 
 
 
+/* Sum the SIMD force and energy accumulators over their elements,
+ * so the scalar code below can update memory.
+ */
+int
+mknb_reduce_outer_simd()
+{
+	int i,firsti;
+
+	firsti = ((mknb_func.vdw==MKNB_VDW_NO) &&
+			  (mknb_func.water==MKNB_WATER_TIP4P_SINGLE || 
+			   mknb_func.water==MKNB_WATER_TIP4P_PAIR)) ? 2 : 1;
+
+	mknb_comment("Reduce SIMD force and energy sums");
+	if(mknb_func.do_force) {
+		for(i=firsti;i<=mknb_func.ni;i++) {
+			mknb_assign_verbatim("fix%d","gmx_simd_reduce(fix%d_S)",i,i);
+			mknb_assign_verbatim("fiy%d","gmx_simd_reduce(fiy%d_S)",i,i);
+			mknb_assign_verbatim("fiz%d","gmx_simd_reduce(fiz%d_S)",i,i);
+		}
+	}
+	if(mknb_func.coul)
+		mknb_assign_verbatim("vctot","gmx_simd_reduce(vctot_S)");
+	if(mknb_func.vdw)
+		mknb_assign_verbatim("Vvdwtot","gmx_simd_reduce(Vvdwtot_S)");
+
+	/* Reductions are not counted as flops */
+	return 0;
+}
+
+
 int
 mknb_update_outer_forces()
 {
@@ -271,6 +327,8 @@ mknb_outerloop(void) {
 			mknb_code("do");
 			mknb_code("{");
 			mknb_indent_level++;
+			/* Without thread support the kernel does all lists at once */
+			fprintf(mknb_output,"#ifdef GMX_THREADS\n");
 			mknb_code("gmx_thread_mutex_lock((gmx_thread_mutex_t *)mtx);");
 			mknb_assign("nn0","*count");
 			mknb_comment("Take successively smaller chunks (at least 10 lists)");
@@ -279,6 +337,10 @@ mknb_outerloop(void) {
 			mknb_assign("*count","nn1");
 			mknb_code("gmx_thread_mutex_unlock((gmx_thread_mutex_t *)mtx);");
 			mknb_code("if(nn1>nri) nn1=nri;");
+			fprintf(mknb_output,"#else\n");
+			mknb_assign("nn0","0");
+			mknb_assign("nn1","nri");
+			fprintf(mknb_output,"#endif\n");
 			mknb_comment("Start outer loop over neighborlists");
 			mknb_start_loop("n", "nn0", "nn1");
 		}
@@ -312,6 +374,8 @@ mknb_outerloop(void) {
 
 	/* do the inner loop ( separate nflops, so no return value) */
 	mknb_innerloop();
+	if(mknb_simd)
+		nflops += mknb_reduce_outer_simd();
 	nflops += mknb_update_outer_forces();
 	nflops += mknb_update_outer_potential();
 
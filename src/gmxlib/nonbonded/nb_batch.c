@@ -0,0 +1,553 @@
+/*
+ * 
+ *                This source code is part of
+ * 
+ *                 G   R   O   M   A   C   S
+ * 
+ *          GROningen MAchine for Chemical Simulations
+ * 
+ *                        VERSION 3.2.0
+ * Written by David van der Spoel, Erik Lindahl, Berk Hess, and others.
+ * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
+ * Copyright (c) 2001-2004, The GROMACS development team,
+ * check out http://www.gromacs.org for more information.
+
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * If you want to redistribute modifications, please consider that
+ * scientific software is very special. Version control is crucial -
+ * bugs must be traceable. We will be happy to consider code for
+ * inclusion in the official distribution, but derived work must not
+ * be called official GROMACS. Details are found in the README & COPYING
+ * files - if they are missing, get the official version at www.gromacs.org.
+ * 
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the papers on the package - you can find them in the top README file.
+ * 
+ * For more info, check our website at http://www.gromacs.org
+ * 
+ * And Hey:
+ * GROningen Mixture of Alchemy and Childrens' Stories
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+
+#include "types/simple.h"
+#include "vec.h"
+#include "typedefs.h"
+#include "smalloc.h"
+#include "nonbonded.h"
+
+#if defined GMX_SSE2 && !defined GMX_DOUBLE
+#define GMX_NB_BATCH_SSE
+#include "nb_kernel_sse2_single/sse_common_single.h"
+#endif
+
+/* The batch kernels evaluate the energy of many trial configurations
+ * of the i-particles of a pair list in one pass: each j-particle is
+ * loaded once and interacts with the i-particle in all configurations.
+ * The trial coordinates are stored per i-particle as nbp consecutive
+ * values (nbp is nbatch rounded up to the SSE width), so the SSE kernel
+ * handles four configurations per instruction.
+ * The functional forms are identical to those of the generic kernel.
+ * Water lists are expanded to atom pairs, which gives the same energies
+ * since the water kernels only skip pairs without parameters.
+ */
+#define NB_BATCH_WIDTH 4
+
+int
+nb_batch_padded(int nbatch)
+{
+    return ((nbatch + NB_BATCH_WIDTH - 1)/NB_BATCH_WIDTH)*NB_BATCH_WIDTH;
+}
+
+/* Number of atoms per i- and j-unit for each list type */
+static const int nb_batch_nia[enlistNR] = { 1, 3, 3, 4, 4, 0 };
+static const int nb_batch_nja[enlistNR] = { 1, 1, 3, 1, 4, 0 };
+
+#ifdef GMX_NB_BATCH_SSE
+static inline __m128
+nb_batch_table_ps(const float *VFtab,const int *nnn,int off,
+                  __m128 eps,__m128 eps2)
+{
+    __m128 Y,F,G,H;
+
+    Y = _mm_setr_ps(VFtab[nnn[0]+off  ],VFtab[nnn[1]+off  ],
+                    VFtab[nnn[2]+off  ],VFtab[nnn[3]+off  ]);
+    F = _mm_setr_ps(VFtab[nnn[0]+off+1],VFtab[nnn[1]+off+1],
+                    VFtab[nnn[2]+off+1],VFtab[nnn[3]+off+1]);
+    G = _mm_setr_ps(VFtab[nnn[0]+off+2],VFtab[nnn[1]+off+2],
+                    VFtab[nnn[2]+off+2],VFtab[nnn[3]+off+2]);
+    H = _mm_setr_ps(VFtab[nnn[0]+off+3],VFtab[nnn[1]+off+3],
+                    VFtab[nnn[2]+off+3],VFtab[nnn[3]+off+3]);
+
+    /* VV = Y + eps*(F + eps*G + eps2*H) */
+    F = _mm_add_ps(F,_mm_add_ps(_mm_mul_ps(eps,G),_mm_mul_ps(eps2,H)));
+
+    return _mm_add_ps(Y,_mm_mul_ps(eps,F));
+}
+
+static void
+nb_batch_kernel_sse(int icoul,int ivdw,int nvdwparam,int table_nelements,
+                    real iq,int nti,
+                    int nj0,int nj1,int *jjnr,int nja,rvec x[],
+                    real *charge,int *type,real *vdwparam,
+                    real k_rf,real c_rf,real tabscale,real *VFtab,
+                    int nbp,real *sx,real *sy,real *sz,
+                    real *vctot,real *vvdwtot)
+{
+    int    k,jo,b,jnr,tj,l;
+    int    n0[NB_BATCH_WIDTH],nnn[NB_BATCH_WIDTH];
+    __m128 jx,jy,jz,dx,dy,dz,rsq,rinv,rinvsq,rinvsix,r,rt,eps,eps2;
+    __m128 qq,c6,c12,vc,vvdw,krf,crf,tsc;
+    __m128i n0i;
+
+    krf = _mm_set1_ps(k_rf);
+    crf = _mm_set1_ps(c_rf);
+    tsc = _mm_set1_ps(tabscale);
+    eps = eps2 = _mm_setzero_ps();
+    c6  = c12  = _mm_setzero_ps();
+
+    for(k=nj0; k<nj1; k++)
+    {
+        for(jo=0; jo<nja; jo++)
+        {
+            jnr = jjnr[k] + jo;
+            jx  = _mm_set1_ps(x[jnr][XX]);
+            jy  = _mm_set1_ps(x[jnr][YY]);
+            jz  = _mm_set1_ps(x[jnr][ZZ]);
+            qq  = _mm_set1_ps(iq*charge[jnr]);
+            if (ivdw > 0)
+            {
+                tj  = nti + nvdwparam*type[jnr];
+                c6  = _mm_set1_ps(vdwparam[tj]);
+                c12 = _mm_set1_ps(vdwparam[tj+1]);
+            }
+
+            for(b=0; b<nbp; b+=NB_BATCH_WIDTH)
+            {
+                dx   = _mm_sub_ps(_mm_loadu_ps(sx+b),jx);
+                dy   = _mm_sub_ps(_mm_loadu_ps(sy+b),jy);
+                dz   = _mm_sub_ps(_mm_loadu_ps(sz+b),jz);
+                rsq  = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx,dx),_mm_mul_ps(dy,dy)),
+                                  _mm_mul_ps(dz,dz));
+                rinv = gmx_mm_invsqrt_ps(rsq);
+
+                if (icoul == 3 || ivdw == 3)
+                {
+                    r    = _mm_mul_ps(rsq,rinv);
+                    rt   = _mm_mul_ps(r,tsc);
+                    n0i  = _mm_cvttps_epi32(rt);
+                    eps  = _mm_sub_ps(rt,_mm_cvtepi32_ps(n0i));
+                    eps2 = _mm_mul_ps(eps,eps);
+                    _mm_storeu_si128((__m128i *)n0,n0i);
+                    for(l=0; l<NB_BATCH_WIDTH; l++)
+                    {
+                        nnn[l] = table_nelements*n0[l];
+                    }
+                }
+
+                switch (icoul)
+                {
+                case 1:
+                    vc = _mm_mul_ps(qq,rinv);
+                    break;
+                case 2:
+                    vc = _mm_mul_ps(qq,_mm_sub_ps(_mm_add_ps(rinv,_mm_mul_ps(krf,rsq)),crf));
+                    break;
+                case 3:
+                    vc = _mm_mul_ps(qq,nb_batch_table_ps(VFtab,nnn,0,eps,eps2));
+                    break;
+                default:
+                    vc = _mm_setzero_ps();
+                }
+                _mm_storeu_ps(vctot+b,_mm_add_ps(_mm_loadu_ps(vctot+b),vc));
+
+                switch (ivdw)
+                {
+                case 1:
+                    rinvsq  = _mm_mul_ps(rinv,rinv);
+                    rinvsix = _mm_mul_ps(_mm_mul_ps(rinvsq,rinvsq),rinvsq);
+                    vvdw    = _mm_sub_ps(_mm_mul_ps(c12,_mm_mul_ps(rinvsix,rinvsix)),
+                                         _mm_mul_ps(c6,rinvsix));
+                    break;
+                case 3:
+                    l       = (icoul == 3 ? 4 : 0);
+                    vvdw    = _mm_add_ps(_mm_mul_ps(c6,nb_batch_table_ps(VFtab,nnn,l,eps,eps2)),
+                                         _mm_mul_ps(c12,nb_batch_table_ps(VFtab,nnn,l+4,eps,eps2)));
+                    break;
+                default:
+                    vvdw    = _mm_setzero_ps();
+                }
+                _mm_storeu_ps(vvdwtot+b,_mm_add_ps(_mm_loadu_ps(vvdwtot+b),vvdw));
+            }
+        }
+    }
+}
+#endif
+
+static void
+nb_batch_kernel_c(int icoul,int ivdw,int nvdwparam,int table_nelements,
+                  real iq,int nti,
+                  int nj0,int nj1,int *jjnr,int nja,rvec x[],
+                  real *charge,int *type,real *vdwparam,
+                  real k_rf,real c_rf,real tabscale,real *VFtab,
+                  int nbatch,real *sx,real *sy,real *sz,
+                  real *rsq,real *rinv,real *eps,int *nnn,
+                  real *vctot,real *vvdwtot)
+{
+    int  k,jo,b,jnr,tj,n0,off;
+    real jx,jy,jz,dx,dy,dz,rinvsq,rinvsix,rt,e,e2;
+    real qq,c6,c12,cexp1,cexp2,br;
+
+    c6 = c12 = cexp1 = cexp2 = 0;
+    off = (icoul == 3 ? 4 : 0);
+
+    /* The interaction type switches are outside the loops over
+     * the configurations, so these loops are simple enough
+     * for the compiler to optimize.
+     */
+    for(k=nj0; k<nj1; k++)
+    {
+        for(jo=0; jo<nja; jo++)
+        {
+            jnr = jjnr[k] + jo;
+            jx  = x[jnr][XX];
+            jy  = x[jnr][YY];
+            jz  = x[jnr][ZZ];
+            qq  = iq*charge[jnr];
+            if (ivdw > 0)
+            {
+                tj  = nti + nvdwparam*type[jnr];
+                c6  = vdwparam[tj];
+                c12 = vdwparam[tj+1];
+                if (ivdw == 2)
+                {
+                    cexp1 = vdwparam[tj+1];
+                    cexp2 = vdwparam[tj+2];
+                }
+            }
+
+            for(b=0; b<nbatch; b++)
+            {
+                dx     = sx[b] - jx;
+                dy     = sy[b] - jy;
+                dz     = sz[b] - jz;
+                rsq[b] = dx*dx + dy*dy + dz*dz;
+            }
+            for(b=0; b<nbatch; b++)
+            {
+                rinv[b] = invsqrt(rsq[b]);
+            }
+            if (icoul == 3 || ivdw == 3)
+            {
+                for(b=0; b<nbatch; b++)
+                {
+                    rt     = rsq[b]*rinv[b]*tabscale;
+                    n0     = rt;
+                    eps[b] = rt - n0;
+                    nnn[b] = table_nelements*n0;
+                }
+            }
+
+            switch (icoul)
+            {
+            case 1:
+                for(b=0; b<nbatch; b++)
+                {
+                    vctot[b] += qq*rinv[b];
+                }
+                break;
+            case 2:
+                for(b=0; b<nbatch; b++)
+                {
+                    vctot[b] += qq*(rinv[b] + k_rf*rsq[b] - c_rf);
+                }
+                break;
+            case 3:
+                for(b=0; b<nbatch; b++)
+                {
+                    e  = eps[b];
+                    e2 = e*e;
+                    vctot[b] += qq*(VFtab[nnn[b]] +
+                                    e*(VFtab[nnn[b]+1] + e*VFtab[nnn[b]+2] +
+                                       e2*VFtab[nnn[b]+3]));
+                }
+                break;
+            }
+
+            switch (ivdw)
+            {
+            case 1:
+                for(b=0; b<nbatch; b++)
+                {
+                    rinvsq      = rinv[b]*rinv[b];
+                    rinvsix     = rinvsq*rinvsq*rinvsq;
+                    vvdwtot[b] += c12*rinvsix*rinvsix - c6*rinvsix;
+                }
+                break;
+            case 2:
+                for(b=0; b<nbatch; b++)
+                {
+                    rinvsq      = rinv[b]*rinv[b];
+                    rinvsix     = rinvsq*rinvsq*rinvsq;
+                    br          = cexp2*rsq[b]*rinv[b];
+                    vvdwtot[b] += cexp1*exp(-br) - c6*rinvsix;
+                }
+                break;
+            case 3:
+                for(b=0; b<nbatch; b++)
+                {
+                    e  = eps[b];
+                    e2 = e*e;
+                    n0 = nnn[b] + off;
+                    vvdwtot[b] +=
+                        c6*(VFtab[n0] +
+                            e*(VFtab[n0+1] + e*VFtab[n0+2] + e2*VFtab[n0+3])) +
+                        c12*(VFtab[n0+4] +
+                             e*(VFtab[n0+5] + e*VFtab[n0+6] + e2*VFtab[n0+7]));
+                }
+                break;
+            }
+        }
+    }
+}
+
+/* Sets the table and parameter layout for interaction types icoul, ivdw */
+static void
+nb_batch_tables(t_nblists *nblists,int icoul,int ivdw,
+                real **VFtab,int *nvdwparam,int *table_nelements)
+{
+    if (icoul == 3 && ivdw == 3)
+    {
+        *VFtab = nblists->tab.tab;
+    }
+    else if (icoul == 3)
+    {
+        *VFtab = nblists->coultab;
+    }
+    else if (ivdw == 3)
+    {
+        *VFtab = nblists->vdwtab;
+    }
+    else
+    {
+        *VFtab = NULL;
+    }
+    *nvdwparam       = (ivdw == 2) ? 3 : 2;
+    *table_nelements = (icoul == 3) ? 4 : 0;
+    *table_nelements += (ivdw == 3) ? 8 : 0;
+}
+
+/* Adds the energies of i-particle ii, at the nbp (padded) positions
+ * sx, sy, sz, with the j-particles of jjnr[nj0..nj1) to vctot and vvdwtot.
+ */
+static void
+nb_batch_i(t_forcerec *fr,t_nblists *nblists,int icoul,int ivdw,
+           t_mdatoms *md,int ii,int nj0,int nj1,int *jjnr,int nja,rvec x[],
+           int nbatch,int nbp,real *sx,real *sy,real *sz,
+           real *rsq,real *rinv,real *eps,int *nnn,
+           real *vctot,real *vvdwtot)
+{
+    real *VFtab,iq;
+    int  nvdwparam,table_nelements,nti;
+
+    nb_batch_tables(nblists,icoul,ivdw,&VFtab,&nvdwparam,&table_nelements);
+    iq  = fr->epsfac*md->chargeA[ii];
+    nti = nvdwparam*fr->ntype*md->typeA[ii];
+
+#ifdef GMX_NB_BATCH_SSE
+    if (ivdw != 2)
+    {
+        nb_batch_kernel_sse(icoul,ivdw,nvdwparam,table_nelements,iq,nti,
+                            nj0,nj1,jjnr,nja,x,md->chargeA,md->typeA,
+                            fr->nbfp,fr->k_rf,fr->c_rf,
+                            nblists->tab.scale,VFtab,
+                            nbp,sx,sy,sz,vctot,vvdwtot);
+    }
+    else
+#endif
+    {
+        nb_batch_kernel_c(icoul,ivdw,nvdwparam,table_nelements,iq,nti,
+                          nj0,nj1,jjnr,nja,x,md->chargeA,md->typeA,
+                          fr->nbfp,fr->k_rf,fr->c_rf,
+                          nblists->tab.scale,VFtab,
+                          nbatch,sx,sy,sz,rsq,rinv,eps,nnn,
+                          vctot,vvdwtot);
+    }
+}
+
+static bool
+nb_batch_supported(t_forcerec *fr,int a0,int na)
+{
+    t_nblist *nlist;
+    int      n,i,k;
+
+    for(n=0; n<fr->nnblists; n++)
+    {
+        for(i=0; i<eNL_NR; i++)
+        {
+            if (fr->nblists[n].nlist_lr[i].nri > 0)
+            {
+                return FALSE;
+            }
+            nlist = &fr->nblists[n].nlist_sr[i];
+            if (nlist->nri <= 0)
+            {
+                continue;
+            }
+            if (nlist->free_energy || nlist->enlist == enlistCG_CG ||
+                nlist->icoul > 3 || nlist->ivdw > 3)
+            {
+                return FALSE;
+            }
+            for(k=0; k<nlist->nri; k++)
+            {
+                if (nlist->iinr[k] < a0 ||
+                    nlist->iinr[k] + nb_batch_nia[nlist->enlist] > a0 + na)
+                {
+                    return FALSE;
+                }
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+bool
+do_nonbonded_batch(t_forcerec *fr,rvec x[],t_mdatoms *md,
+                   int a0,int na,int nbatch,rvec xb[],
+                   int nener,real Vc[],real Vvdw[])
+{
+    t_nblists *nblists;
+    t_nblist  *nlist;
+    real      *bx,*by,*bz,*sx,*sy,*sz,*vctot,*vvdwtot,*shiftvec;
+    real      *rsq,*rinv,*eps;
+    int       *nnn;
+    int       nbp,a,b,c,n,i,m,io,ii,ia,is3,ggid;
+
+    if (!nb_batch_supported(fr,a0,na))
+    {
+        return FALSE;
+    }
+
+    nbp = nb_batch_padded(nbatch);
+
+    snew(bx,na*nbp);
+    snew(by,na*nbp);
+    snew(bz,na*nbp);
+    snew(sx,nbp);
+    snew(sy,nbp);
+    snew(sz,nbp);
+    snew(vctot,nbp);
+    snew(vvdwtot,nbp);
+    snew(rsq,nbp);
+    snew(rinv,nbp);
+    snew(eps,nbp);
+    snew(nnn,nbp);
+
+    /* Store the configurations per atom, pad with copies of the first one */
+    for(a=0; a<na; a++)
+    {
+        for(b=0; b<nbp; b++)
+        {
+            c = (b < nbatch ? b : 0);
+            bx[a*nbp+b] = xb[c*na+a][XX];
+            by[a*nbp+b] = xb[c*na+a][YY];
+            bz[a*nbp+b] = xb[c*na+a][ZZ];
+        }
+    }
+
+    for(i=0; i<nbatch*nener; i++)
+    {
+        Vc[i]   = 0;
+        Vvdw[i] = 0;
+    }
+
+    shiftvec = fr->shift_vec[0];
+
+    for(n=0; n<fr->nnblists; n++)
+    {
+        nblists = &fr->nblists[n];
+        for(i=0; i<eNL_NR; i++)
+        {
+            nlist = &nblists->nlist_sr[i];
+            if (nlist->nri <= 0)
+            {
+                continue;
+            }
+
+            for(m=0; m<nlist->nri; m++)
+            {
+                is3  = 3*nlist->shift[m];
+                ggid = nlist->gid[m];
+                for(b=0; b<nbp; b++)
+                {
+                    vctot[b]   = 0;
+                    vvdwtot[b] = 0;
+                }
+
+                for(io=0; io<nb_batch_nia[nlist->enlist]; io++)
+                {
+                    ii  = nlist->iinr[m] + io;
+                    ia  = (ii - a0)*nbp;
+                    for(b=0; b<nbp; b++)
+                    {
+                        sx[b] = bx[ia+b] + shiftvec[is3+XX];
+                        sy[b] = by[ia+b] + shiftvec[is3+YY];
+                        sz[b] = bz[ia+b] + shiftvec[is3+ZZ];
+                    }
+
+                    nb_batch_i(fr,nblists,nlist->icoul,nlist->ivdw,md,ii,
+                               nlist->jindex[m],nlist->jindex[m+1],
+                               nlist->jjnr,nb_batch_nja[nlist->enlist],x,
+                               nbatch,nbp,sx,sy,sz,rsq,rinv,eps,nnn,
+                               vctot,vvdwtot);
+                }
+
+                for(b=0; b<nbatch; b++)
+                {
+                    Vc[b*nener+ggid]   += vctot[b];
+                    Vvdw[b*nener+ggid] += vvdwtot[b];
+                }
+            }
+        }
+    }
+
+    sfree(bx);
+    sfree(by);
+    sfree(bz);
+    sfree(sx);
+    sfree(sy);
+    sfree(sz);
+    sfree(vctot);
+    sfree(vvdwtot);
+    sfree(rsq);
+    sfree(rinv);
+    sfree(eps);
+    sfree(nnn);
+
+    return TRUE;
+}
+
+void
+do_nonbonded_batch_cg(t_forcerec *fr,t_nblists *nblists,int icoul,int ivdw,
+                      t_mdatoms *md,int ii,int ja,int nja,rvec xj[],
+                      int nbatch,real sx[],real sy[],real sz[],
+                      real rsq[],real rinv[],real eps[],int nnn[],
+                      real Vc[],real Vvdw[])
+{
+    int jjnr[1];
+
+    jjnr[0] = ja;
+    nb_batch_i(fr,nblists,icoul,ivdw,md,ii,0,1,jjnr,nja,xj,
+               nbatch,nb_batch_padded(nbatch),sx,sy,sz,rsq,rinv,eps,nnn,
+               Vc,Vvdw);
+}
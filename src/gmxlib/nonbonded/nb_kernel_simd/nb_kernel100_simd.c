@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) Erik Lindahl, David van der Spoel 2003
+ * 
+ * This file is generated automatically at compile time
+ * by the program mknb in the Gromacs distribution.
+ *
+ * Options used when generation this file:
+ * Language:         c, SIMD (gmx_simd.h)
+ * Precision:        any
+ * Threads:          yes
+ * Software invsqrt: no
+ * PowerPC invsqrt:  no
+ * Prefetch forces:  no
+ * Comments:         no
+ */
+#ifdef HAVE_CONFIG_H
+#include<config.h>
+#endif
+#include<gmx_thread.h>
+#include<math.h>
+#include<types/simple.h>
+#include<gmx_simd.h>
+
+
+
+/*
+ * Gromacs nonbonded kernel GMX_SIMD_NAME(nb_kernel100)
+ * Coulomb interaction:     Normal Coulomb
+ * VdW interaction:         Not calculated
+ * water optimization:      No
+ * Calculate forces:        yes
+ */
+void GMX_SIMD_NAME(nb_kernel100)(
+                    int *           p_nri,
+                    int *           iinr,
+                    int *           jindex,
+                    int *           jjnr,
+                    int *           shift,
+                    real *          shiftvec,
+                    real *          fshift,
+                    int *           gid,
+                    real *          pos,
+                    real *          faction,
+                    real *          charge,
+                    real *          p_facel,
+                    real *          p_krf,
+                    real *          p_crf,
+                    real *          Vc,
+                    int *           type,
+                    int *           p_ntype,
+                    real *          vdwparam,
+                    real *          Vvdw,
+                    real *          p_tabscale,
+                    real *          VFtab,
+                    real *          enerd1,
+                    real *          enerd2,
+                    real *          enerd3,
+                    real *          enerd4,
+                    int *           start,
+                    int *           end,
+                    int *           homenr,
+                    int *           nbsum,
+                    real *          invsqrta,
+                    real *          dvda,
+                    real *          p_gbtabscale,
+                    real *          GBtab,
+                    int *           p_nthreads,
+                    int *           count,
+                    void *          mtx,
+                    int *           outeriter,
+                    int *           inneriter,
+                    real *          work)
+{
+    int           nri,ntype,nthreads;
+    real          facel,krf,crf,tabscale,gbtabscale;
+    int           n,ii,is3,ii3,k,nj0,nj1,ggid,nvalid;
+    int           jnr[GMX_SIMD_WIDTH],j3[GMX_SIMD_WIDTH];
+    int           nn0,nn1,nouter,ninner;
+    real          shX,shY,shZ;
+    gmx_simd_real_t mask_S;
+    gmx_simd_real_t fscal_S,tx_S,ty_S,tz_S;
+    gmx_simd_real_t rinvsq_S;
+    real          vctot;
+    real          iq;
+    gmx_simd_real_t iq_S;
+    gmx_simd_real_t qq_S,vcoul_S,vctot_S;
+    real          ix1,iy1,iz1,fix1,fiy1,fiz1;
+    gmx_simd_real_t ix1_S,iy1_S,iz1_S,fix1_S,fiy1_S,fiz1_S;
+    gmx_simd_real_t jx1_S,jy1_S,jz1_S;
+    gmx_simd_real_t dx11_S,dy11_S,dz11_S,rsq11_S,rinv11_S;
+
+    nri              = *p_nri;         
+    ntype            = *p_ntype;       
+    nthreads         = *p_nthreads;    
+    facel            = *p_facel;       
+    krf              = *p_krf;         
+    crf              = *p_crf;         
+    tabscale         = *p_tabscale;    
+    nouter           = 0;              
+    ninner           = 0;              
+    
+    do
+    {
+#ifdef GMX_THREADS
+        gmx_thread_mutex_lock((gmx_thread_mutex_t *)mtx);
+        nn0              = *count;         
+        nn1              = nn0+(nri-nn0)/(2*nthreads)+10;
+        *count           = nn1;            
+        gmx_thread_mutex_unlock((gmx_thread_mutex_t *)mtx);
+        if(nn1>nri) nn1=nri;
+#else
+        nn0              = 0;              
+        nn1              = nri;            
+#endif
+        
+        for(n=nn0; (n<nn1); n++)
+        {
+            is3              = 3*shift[n];     
+            shX              = shiftvec[is3];  
+            shY              = shiftvec[is3+1];
+            shZ              = shiftvec[is3+2];
+            nj0              = jindex[n];      
+            nj1              = jindex[n+1];    
+            ii               = iinr[n];        
+            ii3              = 3*ii;           
+            ix1              = shX + pos[ii3+0];
+            iy1              = shY + pos[ii3+1];
+            iz1              = shZ + pos[ii3+2];
+            ix1_S            = gmx_simd_set1(ix1);
+            iy1_S            = gmx_simd_set1(iy1);
+            iz1_S            = gmx_simd_set1(iz1);
+            iq               = facel*charge[ii];
+            iq_S             = gmx_simd_set1(iq);
+            vctot_S          = gmx_simd_setzero();
+            fix1_S           = gmx_simd_setzero();
+            fiy1_S           = gmx_simd_setzero();
+            fiz1_S           = gmx_simd_setzero();
+            
+            for(k=nj0; (k<nj1); k+=GMX_SIMD_WIDTH)
+            {
+                nvalid           = gmx_simd_load_jindex(jjnr+k,nj1-k,jnr,j3,&mask_S);
+                gmx_simd_gather_rvec(pos+0,j3,&jx1_S,&jy1_S,&jz1_S);
+                dx11_S           = gmx_simd_sub(ix1_S,jx1_S);
+                dy11_S           = gmx_simd_sub(iy1_S,jy1_S);
+                dz11_S           = gmx_simd_sub(iz1_S,jz1_S);
+                rsq11_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx11_S,dx11_S),gmx_simd_mul(dy11_S,dy11_S)),gmx_simd_mul(dz11_S,dz11_S));
+                rinv11_S         = gmx_simd_invsqrt(rsq11_S);
+                qq_S             = gmx_simd_mul(iq_S,gmx_simd_gather(charge,jnr));
+                rinvsq_S         = gmx_simd_mul(rinv11_S,rinv11_S);
+                vcoul_S          = gmx_simd_mul(qq_S,rinv11_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                fscal_S          = gmx_simd_mul(vcoul_S,rinvsq_S);
+                fscal_S          = gmx_simd_and(fscal_S,mask_S);
+                tx_S             = gmx_simd_mul(fscal_S,dx11_S);
+                ty_S             = gmx_simd_mul(fscal_S,dy11_S);
+                tz_S             = gmx_simd_mul(fscal_S,dz11_S);
+                fix1_S           = gmx_simd_add(fix1_S,tx_S);
+                fiy1_S           = gmx_simd_add(fiy1_S,ty_S);
+                fiz1_S           = gmx_simd_add(fiz1_S,tz_S);
+                gmx_simd_decrement_rvec(faction+0,j3,nvalid,tx_S,ty_S,tz_S);
+            }
+            
+            fix1             = gmx_simd_reduce(fix1_S);
+            fiy1             = gmx_simd_reduce(fiy1_S);
+            fiz1             = gmx_simd_reduce(fiz1_S);
+            vctot            = gmx_simd_reduce(vctot_S);
+            faction[ii3+0]   = faction[ii3+0] + fix1;
+            faction[ii3+1]   = faction[ii3+1] + fiy1;
+            faction[ii3+2]   = faction[ii3+2] + fiz1;
+            fshift[is3]      = fshift[is3]+fix1;
+            fshift[is3+1]    = fshift[is3+1]+fiy1;
+            fshift[is3+2]    = fshift[is3+2]+fiz1;
+            ggid             = gid[n];         
+            Vc[ggid]         = Vc[ggid] + vctot;
+            ninner           = ninner + nj1 - nj0;
+        }
+        
+        nouter           = nouter + nn1 - nn0;
+    }
+    while (nn1<nri);
+    
+    *outeriter       = nouter;         
+    *inneriter       = ninner;         
+}
+
+
+
+
+
+/*
+ * Gromacs nonbonded kernel GMX_SIMD_NAME(nb_kernel100nf)
+ * Coulomb interaction:     Normal Coulomb
+ * VdW interaction:         Not calculated
+ * water optimization:      No
+ * Calculate forces:        no
+ */
+void GMX_SIMD_NAME(nb_kernel100nf)(
+                    int *           p_nri,
+                    int *           iinr,
+                    int *           jindex,
+                    int *           jjnr,
+                    int *           shift,
+                    real *          shiftvec,
+                    real *          fshift,
+                    int *           gid,
+                    real *          pos,
+                    real *          faction,
+                    real *          charge,
+                    real *          p_facel,
+                    real *          p_krf,
+                    real *          p_crf,
+                    real *          Vc,
+                    int *           type,
+                    int *           p_ntype,
+                    real *          vdwparam,
+                    real *          Vvdw,
+                    real *          p_tabscale,
+                    real *          VFtab,
+                    real *          enerd1,
+                    real *          enerd2,
+                    real *          enerd3,
+                    real *          enerd4,
+                    int *           start,
+                    int *           end,
+                    int *           homenr,
+                    int *           nbsum,
+                    real *          invsqrta,
+                    real *          dvda,
+                    real *          p_gbtabscale,
+                    real *          GBtab,
+                    int *           p_nthreads,
+                    int *           count,
+                    void *          mtx,
+                    int *           outeriter,
+                    int *           inneriter,
+                    real *          work)
+{
+    int           nri,ntype,nthreads;
+    real          facel,krf,crf,tabscale,gbtabscale;
+    int           n,ii,is3,ii3,k,nj0,nj1,ggid,nvalid;
+    int           jnr[GMX_SIMD_WIDTH],j3[GMX_SIMD_WIDTH];
+    int           nn0,nn1,nouter,ninner;
+    real          shX,shY,shZ;
+    gmx_simd_real_t mask_S;
+    real          vctot;
+    real          iq;
+    gmx_simd_real_t iq_S;
+    gmx_simd_real_t qq_S,vcoul_S,vctot_S;
+    real          ix1,iy1,iz1;
+    gmx_simd_real_t ix1_S,iy1_S,iz1_S;
+    gmx_simd_real_t jx1_S,jy1_S,jz1_S;
+    gmx_simd_real_t dx11_S,dy11_S,dz11_S,rsq11_S,rinv11_S;
+
+    nri              = *p_nri;         
+    ntype            = *p_ntype;       
+    nthreads         = *p_nthreads;    
+    facel            = *p_facel;       
+    krf              = *p_krf;         
+    crf              = *p_crf;         
+    tabscale         = *p_tabscale;    
+    nouter           = 0;              
+    ninner           = 0;              
+    
+    do
+    {
+#ifdef GMX_THREADS
+        gmx_thread_mutex_lock((gmx_thread_mutex_t *)mtx);
+        nn0              = *count;         
+        nn1              = nn0+(nri-nn0)/(2*nthreads)+10;
+        *count           = nn1;            
+        gmx_thread_mutex_unlock((gmx_thread_mutex_t *)mtx);
+        if(nn1>nri) nn1=nri;
+#else
+        nn0              = 0;              
+        nn1              = nri;            
+#endif
+        
+        for(n=nn0; (n<nn1); n++)
+        {
+            is3              = 3*shift[n];     
+            shX              = shiftvec[is3];  
+            shY              = shiftvec[is3+1];
+            shZ              = shiftvec[is3+2];
+            nj0              = jindex[n];      
+            nj1              = jindex[n+1];    
+            ii               = iinr[n];        
+            ii3              = 3*ii;           
+            ix1              = shX + pos[ii3+0];
+            iy1              = shY + pos[ii3+1];
+            iz1              = shZ + pos[ii3+2];
+            ix1_S            = gmx_simd_set1(ix1);
+            iy1_S            = gmx_simd_set1(iy1);
+            iz1_S            = gmx_simd_set1(iz1);
+            iq               = facel*charge[ii];
+            iq_S             = gmx_simd_set1(iq);
+            vctot_S          = gmx_simd_setzero();
+            
+            for(k=nj0; (k<nj1); k+=GMX_SIMD_WIDTH)
+            {
+                nvalid           = gmx_simd_load_jindex(jjnr+k,nj1-k,jnr,j3,&mask_S);
+                gmx_simd_gather_rvec(pos+0,j3,&jx1_S,&jy1_S,&jz1_S);
+                dx11_S           = gmx_simd_sub(ix1_S,jx1_S);
+                dy11_S           = gmx_simd_sub(iy1_S,jy1_S);
+                dz11_S           = gmx_simd_sub(iz1_S,jz1_S);
+                rsq11_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx11_S,dx11_S),gmx_simd_mul(dy11_S,dy11_S)),gmx_simd_mul(dz11_S,dz11_S));
+                rinv11_S         = gmx_simd_invsqrt(rsq11_S);
+                qq_S             = gmx_simd_mul(iq_S,gmx_simd_gather(charge,jnr));
+                vcoul_S          = gmx_simd_mul(qq_S,rinv11_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+            }
+            
+            vctot            = gmx_simd_reduce(vctot_S);
+            ggid             = gid[n];         
+            Vc[ggid]         = Vc[ggid] + vctot;
+            ninner           = ninner + nj1 - nj0;
+        }
+        
+        nouter           = nouter + nn1 - nn0;
+    }
+    while (nn1<nri);
+    
+    *outeriter       = nouter;         
+    *inneriter       = ninner;         
+}
+
+
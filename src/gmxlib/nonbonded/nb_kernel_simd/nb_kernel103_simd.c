@@ -0,0 +1,453 @@
+/*
+ * Copyright (c) Erik Lindahl, David van der Spoel 2003
+ * 
+ * This file is generated automatically at compile time
+ * by the program mknb in the Gromacs distribution.
+ *
+ * Options used when generation this file:
+ * Language:         c, SIMD (gmx_simd.h)
+ * Precision:        any
+ * Threads:          yes
+ * Software invsqrt: no
+ * PowerPC invsqrt:  no
+ * Prefetch forces:  no
+ * Comments:         no
+ */
+#ifdef HAVE_CONFIG_H
+#include<config.h>
+#endif
+#include<gmx_thread.h>
+#include<math.h>
+#include<types/simple.h>
+#include<gmx_simd.h>
+
+
+
+/*
+ * Gromacs nonbonded kernel GMX_SIMD_NAME(nb_kernel103)
+ * Coulomb interaction:     Normal Coulomb
+ * VdW interaction:         Not calculated
+ * water optimization:      TIP4P - other atoms
+ * Calculate forces:        yes
+ */
+void GMX_SIMD_NAME(nb_kernel103)(
+                    int *           p_nri,
+                    int *           iinr,
+                    int *           jindex,
+                    int *           jjnr,
+                    int *           shift,
+                    real *          shiftvec,
+                    real *          fshift,
+                    int *           gid,
+                    real *          pos,
+                    real *          faction,
+                    real *          charge,
+                    real *          p_facel,
+                    real *          p_krf,
+                    real *          p_crf,
+                    real *          Vc,
+                    int *           type,
+                    int *           p_ntype,
+                    real *          vdwparam,
+                    real *          Vvdw,
+                    real *          p_tabscale,
+                    real *          VFtab,
+                    real *          enerd1,
+                    real *          enerd2,
+                    real *          enerd3,
+                    real *          enerd4,
+                    int *           start,
+                    int *           end,
+                    int *           homenr,
+                    int *           nbsum,
+                    real *          invsqrta,
+                    real *          dvda,
+                    real *          p_gbtabscale,
+                    real *          GBtab,
+                    int *           p_nthreads,
+                    int *           count,
+                    void *          mtx,
+                    int *           outeriter,
+                    int *           inneriter,
+                    real *          work)
+{
+    int           nri,ntype,nthreads;
+    real          facel,krf,crf,tabscale,gbtabscale;
+    int           n,ii,is3,ii3,k,nj0,nj1,ggid,nvalid;
+    int           jnr[GMX_SIMD_WIDTH],j3[GMX_SIMD_WIDTH];
+    int           nn0,nn1,nouter,ninner;
+    real          shX,shY,shZ;
+    gmx_simd_real_t mask_S;
+    gmx_simd_real_t fscal_S,tx_S,ty_S,tz_S;
+    gmx_simd_real_t rinvsq_S;
+    real          vctot;
+    real          qH,qM;
+    gmx_simd_real_t qH_S,qM_S,jq_S;
+    gmx_simd_real_t qq_S,vcoul_S,vctot_S;
+    real          ix2,iy2,iz2,fix2,fiy2,fiz2;
+    gmx_simd_real_t ix2_S,iy2_S,iz2_S,fix2_S,fiy2_S,fiz2_S;
+    real          ix3,iy3,iz3,fix3,fiy3,fiz3;
+    gmx_simd_real_t ix3_S,iy3_S,iz3_S,fix3_S,fiy3_S,fiz3_S;
+    real          ix4,iy4,iz4,fix4,fiy4,fiz4;
+    gmx_simd_real_t ix4_S,iy4_S,iz4_S,fix4_S,fiy4_S,fiz4_S;
+    gmx_simd_real_t jx1_S,jy1_S,jz1_S,fjx1_S,fjy1_S,fjz1_S;
+    gmx_simd_real_t dx21_S,dy21_S,dz21_S,rsq21_S,rinv21_S;
+    gmx_simd_real_t dx31_S,dy31_S,dz31_S,rsq31_S,rinv31_S;
+    gmx_simd_real_t dx41_S,dy41_S,dz41_S,rsq41_S,rinv41_S;
+
+    nri              = *p_nri;         
+    ntype            = *p_ntype;       
+    nthreads         = *p_nthreads;    
+    facel            = *p_facel;       
+    krf              = *p_krf;         
+    crf              = *p_crf;         
+    tabscale         = *p_tabscale;    
+    ii               = iinr[0];        
+    qH               = facel*charge[ii+1];
+    qM               = facel*charge[ii+3];
+
+    qH_S             = gmx_simd_set1(qH);
+    qM_S             = gmx_simd_set1(qM);
+    nouter           = 0;              
+    ninner           = 0;              
+    
+    do
+    {
+#ifdef GMX_THREADS
+        gmx_thread_mutex_lock((gmx_thread_mutex_t *)mtx);
+        nn0              = *count;         
+        nn1              = nn0+(nri-nn0)/(2*nthreads)+10;
+        *count           = nn1;            
+        gmx_thread_mutex_unlock((gmx_thread_mutex_t *)mtx);
+        if(nn1>nri) nn1=nri;
+#else
+        nn0              = 0;              
+        nn1              = nri;            
+#endif
+        
+        for(n=nn0; (n<nn1); n++)
+        {
+            is3              = 3*shift[n];     
+            shX              = shiftvec[is3];  
+            shY              = shiftvec[is3+1];
+            shZ              = shiftvec[is3+2];
+            nj0              = jindex[n];      
+            nj1              = jindex[n+1];    
+            ii               = iinr[n];        
+            ii3              = 3*ii;           
+            ix2              = shX + pos[ii3+3];
+            iy2              = shY + pos[ii3+4];
+            iz2              = shZ + pos[ii3+5];
+            ix3              = shX + pos[ii3+6];
+            iy3              = shY + pos[ii3+7];
+            iz3              = shZ + pos[ii3+8];
+            ix4              = shX + pos[ii3+9];
+            iy4              = shY + pos[ii3+10];
+            iz4              = shZ + pos[ii3+11];
+            ix2_S            = gmx_simd_set1(ix2);
+            iy2_S            = gmx_simd_set1(iy2);
+            iz2_S            = gmx_simd_set1(iz2);
+            ix3_S            = gmx_simd_set1(ix3);
+            iy3_S            = gmx_simd_set1(iy3);
+            iz3_S            = gmx_simd_set1(iz3);
+            ix4_S            = gmx_simd_set1(ix4);
+            iy4_S            = gmx_simd_set1(iy4);
+            iz4_S            = gmx_simd_set1(iz4);
+            vctot_S          = gmx_simd_setzero();
+            fix2_S           = gmx_simd_setzero();
+            fiy2_S           = gmx_simd_setzero();
+            fiz2_S           = gmx_simd_setzero();
+            fix3_S           = gmx_simd_setzero();
+            fiy3_S           = gmx_simd_setzero();
+            fiz3_S           = gmx_simd_setzero();
+            fix4_S           = gmx_simd_setzero();
+            fiy4_S           = gmx_simd_setzero();
+            fiz4_S           = gmx_simd_setzero();
+            
+            for(k=nj0; (k<nj1); k+=GMX_SIMD_WIDTH)
+            {
+                nvalid           = gmx_simd_load_jindex(jjnr+k,nj1-k,jnr,j3,&mask_S);
+                gmx_simd_gather_rvec(pos+0,j3,&jx1_S,&jy1_S,&jz1_S);
+                dx21_S           = gmx_simd_sub(ix2_S,jx1_S);
+                dy21_S           = gmx_simd_sub(iy2_S,jy1_S);
+                dz21_S           = gmx_simd_sub(iz2_S,jz1_S);
+                rsq21_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx21_S,dx21_S),gmx_simd_mul(dy21_S,dy21_S)),gmx_simd_mul(dz21_S,dz21_S));
+                dx31_S           = gmx_simd_sub(ix3_S,jx1_S);
+                dy31_S           = gmx_simd_sub(iy3_S,jy1_S);
+                dz31_S           = gmx_simd_sub(iz3_S,jz1_S);
+                rsq31_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx31_S,dx31_S),gmx_simd_mul(dy31_S,dy31_S)),gmx_simd_mul(dz31_S,dz31_S));
+                dx41_S           = gmx_simd_sub(ix4_S,jx1_S);
+                dy41_S           = gmx_simd_sub(iy4_S,jy1_S);
+                dz41_S           = gmx_simd_sub(iz4_S,jz1_S);
+                rsq41_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx41_S,dx41_S),gmx_simd_mul(dy41_S,dy41_S)),gmx_simd_mul(dz41_S,dz41_S));
+                rinv21_S         = gmx_simd_invsqrt(rsq21_S);
+                rinv31_S         = gmx_simd_invsqrt(rsq31_S);
+                rinv41_S         = gmx_simd_invsqrt(rsq41_S);
+                jq_S             = gmx_simd_gather(charge+0,jnr);
+                qq_S             = gmx_simd_mul(qH_S,jq_S);
+                rinvsq_S         = gmx_simd_mul(rinv21_S,rinv21_S);
+                vcoul_S          = gmx_simd_mul(qq_S,rinv21_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                fscal_S          = gmx_simd_mul(vcoul_S,rinvsq_S);
+                fscal_S          = gmx_simd_and(fscal_S,mask_S);
+                tx_S             = gmx_simd_mul(fscal_S,dx21_S);
+                ty_S             = gmx_simd_mul(fscal_S,dy21_S);
+                tz_S             = gmx_simd_mul(fscal_S,dz21_S);
+                fix2_S           = gmx_simd_add(fix2_S,tx_S);
+                fiy2_S           = gmx_simd_add(fiy2_S,ty_S);
+                fiz2_S           = gmx_simd_add(fiz2_S,tz_S);
+                fjx1_S           = tx_S;           
+                fjy1_S           = ty_S;           
+                fjz1_S           = tz_S;           
+                rinvsq_S         = gmx_simd_mul(rinv31_S,rinv31_S);
+                vcoul_S          = gmx_simd_mul(qq_S,rinv31_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                fscal_S          = gmx_simd_mul(vcoul_S,rinvsq_S);
+                fscal_S          = gmx_simd_and(fscal_S,mask_S);
+                tx_S             = gmx_simd_mul(fscal_S,dx31_S);
+                ty_S             = gmx_simd_mul(fscal_S,dy31_S);
+                tz_S             = gmx_simd_mul(fscal_S,dz31_S);
+                fix3_S           = gmx_simd_add(fix3_S,tx_S);
+                fiy3_S           = gmx_simd_add(fiy3_S,ty_S);
+                fiz3_S           = gmx_simd_add(fiz3_S,tz_S);
+                fjx1_S           = gmx_simd_add(fjx1_S,tx_S);
+                fjy1_S           = gmx_simd_add(fjy1_S,ty_S);
+                fjz1_S           = gmx_simd_add(fjz1_S,tz_S);
+                qq_S             = gmx_simd_mul(qM_S,jq_S);
+                rinvsq_S         = gmx_simd_mul(rinv41_S,rinv41_S);
+                vcoul_S          = gmx_simd_mul(qq_S,rinv41_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                fscal_S          = gmx_simd_mul(vcoul_S,rinvsq_S);
+                fscal_S          = gmx_simd_and(fscal_S,mask_S);
+                tx_S             = gmx_simd_mul(fscal_S,dx41_S);
+                ty_S             = gmx_simd_mul(fscal_S,dy41_S);
+                tz_S             = gmx_simd_mul(fscal_S,dz41_S);
+                fix4_S           = gmx_simd_add(fix4_S,tx_S);
+                fiy4_S           = gmx_simd_add(fiy4_S,ty_S);
+                fiz4_S           = gmx_simd_add(fiz4_S,tz_S);
+                fjx1_S           = gmx_simd_add(fjx1_S,tx_S);
+                fjy1_S           = gmx_simd_add(fjy1_S,ty_S);
+                fjz1_S           = gmx_simd_add(fjz1_S,tz_S);
+                gmx_simd_decrement_rvec(faction+0,j3,nvalid,fjx1_S,fjy1_S,fjz1_S);
+            }
+            
+            fix2             = gmx_simd_reduce(fix2_S);
+            fiy2             = gmx_simd_reduce(fiy2_S);
+            fiz2             = gmx_simd_reduce(fiz2_S);
+            fix3             = gmx_simd_reduce(fix3_S);
+            fiy3             = gmx_simd_reduce(fiy3_S);
+            fiz3             = gmx_simd_reduce(fiz3_S);
+            fix4             = gmx_simd_reduce(fix4_S);
+            fiy4             = gmx_simd_reduce(fiy4_S);
+            fiz4             = gmx_simd_reduce(fiz4_S);
+            vctot            = gmx_simd_reduce(vctot_S);
+            faction[ii3+3]   = faction[ii3+3] + fix2;
+            faction[ii3+4]   = faction[ii3+4] + fiy2;
+            faction[ii3+5]   = faction[ii3+5] + fiz2;
+            faction[ii3+6]   = faction[ii3+6] + fix3;
+            faction[ii3+7]   = faction[ii3+7] + fiy3;
+            faction[ii3+8]   = faction[ii3+8] + fiz3;
+            faction[ii3+9]   = faction[ii3+9] + fix4;
+            faction[ii3+10]  = faction[ii3+10] + fiy4;
+            faction[ii3+11]  = faction[ii3+11] + fiz4;
+            fshift[is3]      = fshift[is3]+fix2+fix3+fix4;
+            fshift[is3+1]    = fshift[is3+1]+fiy2+fiy3+fiy4;
+            fshift[is3+2]    = fshift[is3+2]+fiz2+fiz3+fiz4;
+            ggid             = gid[n];         
+            Vc[ggid]         = Vc[ggid] + vctot;
+            ninner           = ninner + nj1 - nj0;
+        }
+        
+        nouter           = nouter + nn1 - nn0;
+    }
+    while (nn1<nri);
+    
+    *outeriter       = nouter;         
+    *inneriter       = ninner;         
+}
+
+
+
+
+
+/*
+ * Gromacs nonbonded kernel GMX_SIMD_NAME(nb_kernel103nf)
+ * Coulomb interaction:     Normal Coulomb
+ * VdW interaction:         Not calculated
+ * water optimization:      TIP4P - other atoms
+ * Calculate forces:        no
+ */
+void GMX_SIMD_NAME(nb_kernel103nf)(
+                    int *           p_nri,
+                    int *           iinr,
+                    int *           jindex,
+                    int *           jjnr,
+                    int *           shift,
+                    real *          shiftvec,
+                    real *          fshift,
+                    int *           gid,
+                    real *          pos,
+                    real *          faction,
+                    real *          charge,
+                    real *          p_facel,
+                    real *          p_krf,
+                    real *          p_crf,
+                    real *          Vc,
+                    int *           type,
+                    int *           p_ntype,
+                    real *          vdwparam,
+                    real *          Vvdw,
+                    real *          p_tabscale,
+                    real *          VFtab,
+                    real *          enerd1,
+                    real *          enerd2,
+                    real *          enerd3,
+                    real *          enerd4,
+                    int *           start,
+                    int *           end,
+                    int *           homenr,
+                    int *           nbsum,
+                    real *          invsqrta,
+                    real *          dvda,
+                    real *          p_gbtabscale,
+                    real *          GBtab,
+                    int *           p_nthreads,
+                    int *           count,
+                    void *          mtx,
+                    int *           outeriter,
+                    int *           inneriter,
+                    real *          work)
+{
+    int           nri,ntype,nthreads;
+    real          facel,krf,crf,tabscale,gbtabscale;
+    int           n,ii,is3,ii3,k,nj0,nj1,ggid,nvalid;
+    int           jnr[GMX_SIMD_WIDTH],j3[GMX_SIMD_WIDTH];
+    int           nn0,nn1,nouter,ninner;
+    real          shX,shY,shZ;
+    gmx_simd_real_t mask_S;
+    real          vctot;
+    real          qH,qM;
+    gmx_simd_real_t qH_S,qM_S,jq_S;
+    gmx_simd_real_t qq_S,vcoul_S,vctot_S;
+    real          ix2,iy2,iz2;
+    gmx_simd_real_t ix2_S,iy2_S,iz2_S;
+    real          ix3,iy3,iz3;
+    gmx_simd_real_t ix3_S,iy3_S,iz3_S;
+    real          ix4,iy4,iz4;
+    gmx_simd_real_t ix4_S,iy4_S,iz4_S;
+    gmx_simd_real_t jx1_S,jy1_S,jz1_S;
+    gmx_simd_real_t dx21_S,dy21_S,dz21_S,rsq21_S,rinv21_S;
+    gmx_simd_real_t dx31_S,dy31_S,dz31_S,rsq31_S,rinv31_S;
+    gmx_simd_real_t dx41_S,dy41_S,dz41_S,rsq41_S,rinv41_S;
+
+    nri              = *p_nri;         
+    ntype            = *p_ntype;       
+    nthreads         = *p_nthreads;    
+    facel            = *p_facel;       
+    krf              = *p_krf;         
+    crf              = *p_crf;         
+    tabscale         = *p_tabscale;    
+    ii               = iinr[0];        
+    qH               = facel*charge[ii+1];
+    qM               = facel*charge[ii+3];
+
+    qH_S             = gmx_simd_set1(qH);
+    qM_S             = gmx_simd_set1(qM);
+    nouter           = 0;              
+    ninner           = 0;              
+    
+    do
+    {
+#ifdef GMX_THREADS
+        gmx_thread_mutex_lock((gmx_thread_mutex_t *)mtx);
+        nn0              = *count;         
+        nn1              = nn0+(nri-nn0)/(2*nthreads)+10;
+        *count           = nn1;            
+        gmx_thread_mutex_unlock((gmx_thread_mutex_t *)mtx);
+        if(nn1>nri) nn1=nri;
+#else
+        nn0              = 0;              
+        nn1              = nri;            
+#endif
+        
+        for(n=nn0; (n<nn1); n++)
+        {
+            is3              = 3*shift[n];     
+            shX              = shiftvec[is3];  
+            shY              = shiftvec[is3+1];
+            shZ              = shiftvec[is3+2];
+            nj0              = jindex[n];      
+            nj1              = jindex[n+1];    
+            ii               = iinr[n];        
+            ii3              = 3*ii;           
+            ix2              = shX + pos[ii3+3];
+            iy2              = shY + pos[ii3+4];
+            iz2              = shZ + pos[ii3+5];
+            ix3              = shX + pos[ii3+6];
+            iy3              = shY + pos[ii3+7];
+            iz3              = shZ + pos[ii3+8];
+            ix4              = shX + pos[ii3+9];
+            iy4              = shY + pos[ii3+10];
+            iz4              = shZ + pos[ii3+11];
+            ix2_S            = gmx_simd_set1(ix2);
+            iy2_S            = gmx_simd_set1(iy2);
+            iz2_S            = gmx_simd_set1(iz2);
+            ix3_S            = gmx_simd_set1(ix3);
+            iy3_S            = gmx_simd_set1(iy3);
+            iz3_S            = gmx_simd_set1(iz3);
+            ix4_S            = gmx_simd_set1(ix4);
+            iy4_S            = gmx_simd_set1(iy4);
+            iz4_S            = gmx_simd_set1(iz4);
+            vctot_S          = gmx_simd_setzero();
+            
+            for(k=nj0; (k<nj1); k+=GMX_SIMD_WIDTH)
+            {
+                nvalid           = gmx_simd_load_jindex(jjnr+k,nj1-k,jnr,j3,&mask_S);
+                gmx_simd_gather_rvec(pos+0,j3,&jx1_S,&jy1_S,&jz1_S);
+                dx21_S           = gmx_simd_sub(ix2_S,jx1_S);
+                dy21_S           = gmx_simd_sub(iy2_S,jy1_S);
+                dz21_S           = gmx_simd_sub(iz2_S,jz1_S);
+                rsq21_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx21_S,dx21_S),gmx_simd_mul(dy21_S,dy21_S)),gmx_simd_mul(dz21_S,dz21_S));
+                dx31_S           = gmx_simd_sub(ix3_S,jx1_S);
+                dy31_S           = gmx_simd_sub(iy3_S,jy1_S);
+                dz31_S           = gmx_simd_sub(iz3_S,jz1_S);
+                rsq31_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx31_S,dx31_S),gmx_simd_mul(dy31_S,dy31_S)),gmx_simd_mul(dz31_S,dz31_S));
+                dx41_S           = gmx_simd_sub(ix4_S,jx1_S);
+                dy41_S           = gmx_simd_sub(iy4_S,jy1_S);
+                dz41_S           = gmx_simd_sub(iz4_S,jz1_S);
+                rsq41_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx41_S,dx41_S),gmx_simd_mul(dy41_S,dy41_S)),gmx_simd_mul(dz41_S,dz41_S));
+                rinv21_S         = gmx_simd_invsqrt(rsq21_S);
+                rinv31_S         = gmx_simd_invsqrt(rsq31_S);
+                rinv41_S         = gmx_simd_invsqrt(rsq41_S);
+                jq_S             = gmx_simd_gather(charge+0,jnr);
+                qq_S             = gmx_simd_mul(qH_S,jq_S);
+                vcoul_S          = gmx_simd_mul(qq_S,rinv21_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                vcoul_S          = gmx_simd_mul(qq_S,rinv31_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                qq_S             = gmx_simd_mul(qM_S,jq_S);
+                vcoul_S          = gmx_simd_mul(qq_S,rinv41_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+            }
+            
+            vctot            = gmx_simd_reduce(vctot_S);
+            ggid             = gid[n];         
+            Vc[ggid]         = Vc[ggid] + vctot;
+            ninner           = ninner + nj1 - nj0;
+        }
+        
+        nouter           = nouter + nn1 - nn0;
+    }
+    while (nn1<nri);
+    
+    *outeriter       = nouter;         
+    *inneriter       = ninner;         
+}
+
+
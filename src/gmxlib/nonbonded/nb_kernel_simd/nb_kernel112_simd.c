@@ -0,0 +1,705 @@
+/*
+ * Copyright (c) Erik Lindahl, David van der Spoel 2003
+ * 
+ * This file is generated automatically at compile time
+ * by the program mknb in the Gromacs distribution.
+ *
+ * Options used when generation this file:
+ * Language:         c, SIMD (gmx_simd.h)
+ * Precision:        any
+ * Threads:          yes
+ * Software invsqrt: no
+ * PowerPC invsqrt:  no
+ * Prefetch forces:  no
+ * Comments:         no
+ */
+#ifdef HAVE_CONFIG_H
+#include<config.h>
+#endif
+#include<gmx_thread.h>
+#include<math.h>
+#include<types/simple.h>
+#include<gmx_simd.h>
+
+
+
+/*
+ * Gromacs nonbonded kernel GMX_SIMD_NAME(nb_kernel112)
+ * Coulomb interaction:     Normal Coulomb
+ * VdW interaction:         Lennard-Jones
+ * water optimization:      pairs of SPC/TIP3P interactions
+ * Calculate forces:        yes
+ */
+void GMX_SIMD_NAME(nb_kernel112)(
+                    int *           p_nri,
+                    int *           iinr,
+                    int *           jindex,
+                    int *           jjnr,
+                    int *           shift,
+                    real *          shiftvec,
+                    real *          fshift,
+                    int *           gid,
+                    real *          pos,
+                    real *          faction,
+                    real *          charge,
+                    real *          p_facel,
+                    real *          p_krf,
+                    real *          p_crf,
+                    real *          Vc,
+                    int *           type,
+                    int *           p_ntype,
+                    real *          vdwparam,
+                    real *          Vvdw,
+                    real *          p_tabscale,
+                    real *          VFtab,
+                    real *          enerd1,
+                    real *          enerd2,
+                    real *          enerd3,
+                    real *          enerd4,
+                    int *           start,
+                    int *           end,
+                    int *           homenr,
+                    int *           nbsum,
+                    real *          invsqrta,
+                    real *          dvda,
+                    real *          p_gbtabscale,
+                    real *          GBtab,
+                    int *           p_nthreads,
+                    int *           count,
+                    void *          mtx,
+                    int *           outeriter,
+                    int *           inneriter,
+                    real *          work)
+{
+    int           nri,ntype,nthreads;
+    real          facel,krf,crf,tabscale,gbtabscale;
+    int           n,ii,is3,ii3,k,nj0,nj1,ggid,nvalid;
+    int           jnr[GMX_SIMD_WIDTH],j3[GMX_SIMD_WIDTH];
+    int           nn0,nn1,nouter,ninner;
+    real          shX,shY,shZ;
+    gmx_simd_real_t mask_S;
+    gmx_simd_real_t fscal_S,tx_S,ty_S,tz_S;
+    gmx_simd_real_t rinvsq_S;
+    real          vctot;
+    real          qO,qH,qqOO,qqOH,qqHH;
+    gmx_simd_real_t qqOO_S,qqOH_S,qqHH_S;
+    gmx_simd_real_t qq_S,vcoul_S,vctot_S;
+    real          Vvdwtot;
+    int           tj;
+    real          c6,c12;
+    gmx_simd_real_t c6_S,c12_S,Vvdw12_S;
+    gmx_simd_real_t rinvsix_S;
+    gmx_simd_real_t Vvdw6_S,Vvdwtot_S;
+    real          ix1,iy1,iz1,fix1,fiy1,fiz1;
+    gmx_simd_real_t ix1_S,iy1_S,iz1_S,fix1_S,fiy1_S,fiz1_S;
+    real          ix2,iy2,iz2,fix2,fiy2,fiz2;
+    gmx_simd_real_t ix2_S,iy2_S,iz2_S,fix2_S,fiy2_S,fiz2_S;
+    real          ix3,iy3,iz3,fix3,fiy3,fiz3;
+    gmx_simd_real_t ix3_S,iy3_S,iz3_S,fix3_S,fiy3_S,fiz3_S;
+    gmx_simd_real_t jx1_S,jy1_S,jz1_S,fjx1_S,fjy1_S,fjz1_S;
+    gmx_simd_real_t jx2_S,jy2_S,jz2_S,fjx2_S,fjy2_S,fjz2_S;
+    gmx_simd_real_t jx3_S,jy3_S,jz3_S,fjx3_S,fjy3_S,fjz3_S;
+    gmx_simd_real_t dx11_S,dy11_S,dz11_S,rsq11_S,rinv11_S;
+    gmx_simd_real_t dx12_S,dy12_S,dz12_S,rsq12_S,rinv12_S;
+    gmx_simd_real_t dx13_S,dy13_S,dz13_S,rsq13_S,rinv13_S;
+    gmx_simd_real_t dx21_S,dy21_S,dz21_S,rsq21_S,rinv21_S;
+    gmx_simd_real_t dx22_S,dy22_S,dz22_S,rsq22_S,rinv22_S;
+    gmx_simd_real_t dx23_S,dy23_S,dz23_S,rsq23_S,rinv23_S;
+    gmx_simd_real_t dx31_S,dy31_S,dz31_S,rsq31_S,rinv31_S;
+    gmx_simd_real_t dx32_S,dy32_S,dz32_S,rsq32_S,rinv32_S;
+    gmx_simd_real_t dx33_S,dy33_S,dz33_S,rsq33_S,rinv33_S;
+
+    nri              = *p_nri;         
+    ntype            = *p_ntype;       
+    nthreads         = *p_nthreads;    
+    facel            = *p_facel;       
+    krf              = *p_krf;         
+    crf              = *p_crf;         
+    tabscale         = *p_tabscale;    
+    ii               = iinr[0];        
+    qO               = charge[ii];     
+    qH               = charge[ii+1];   
+    qqOO             = facel*qO*qO;    
+    qqOH             = facel*qO*qH;    
+    qqHH             = facel*qH*qH;    
+    tj               = 2*(ntype+1)*type[ii];
+    c6               = vdwparam[tj];   
+    c12              = vdwparam[tj+1]; 
+
+    qqOO_S           = gmx_simd_set1(qqOO);
+    qqOH_S           = gmx_simd_set1(qqOH);
+    qqHH_S           = gmx_simd_set1(qqHH);
+    c6_S             = gmx_simd_set1(c6);
+    c12_S            = gmx_simd_set1(c12);
+    nouter           = 0;              
+    ninner           = 0;              
+    
+    do
+    {
+#ifdef GMX_THREADS
+        gmx_thread_mutex_lock((gmx_thread_mutex_t *)mtx);
+        nn0              = *count;         
+        nn1              = nn0+(nri-nn0)/(2*nthreads)+10;
+        *count           = nn1;            
+        gmx_thread_mutex_unlock((gmx_thread_mutex_t *)mtx);
+        if(nn1>nri) nn1=nri;
+#else
+        nn0              = 0;              
+        nn1              = nri;            
+#endif
+        
+        for(n=nn0; (n<nn1); n++)
+        {
+            is3              = 3*shift[n];     
+            shX              = shiftvec[is3];  
+            shY              = shiftvec[is3+1];
+            shZ              = shiftvec[is3+2];
+            nj0              = jindex[n];      
+            nj1              = jindex[n+1];    
+            ii               = iinr[n];        
+            ii3              = 3*ii;           
+            ix1              = shX + pos[ii3+0];
+            iy1              = shY + pos[ii3+1];
+            iz1              = shZ + pos[ii3+2];
+            ix2              = shX + pos[ii3+3];
+            iy2              = shY + pos[ii3+4];
+            iz2              = shZ + pos[ii3+5];
+            ix3              = shX + pos[ii3+6];
+            iy3              = shY + pos[ii3+7];
+            iz3              = shZ + pos[ii3+8];
+            ix1_S            = gmx_simd_set1(ix1);
+            iy1_S            = gmx_simd_set1(iy1);
+            iz1_S            = gmx_simd_set1(iz1);
+            ix2_S            = gmx_simd_set1(ix2);
+            iy2_S            = gmx_simd_set1(iy2);
+            iz2_S            = gmx_simd_set1(iz2);
+            ix3_S            = gmx_simd_set1(ix3);
+            iy3_S            = gmx_simd_set1(iy3);
+            iz3_S            = gmx_simd_set1(iz3);
+            vctot_S          = gmx_simd_setzero();
+            Vvdwtot_S        = gmx_simd_setzero();
+            fix1_S           = gmx_simd_setzero();
+            fiy1_S           = gmx_simd_setzero();
+            fiz1_S           = gmx_simd_setzero();
+            fix2_S           = gmx_simd_setzero();
+            fiy2_S           = gmx_simd_setzero();
+            fiz2_S           = gmx_simd_setzero();
+            fix3_S           = gmx_simd_setzero();
+            fiy3_S           = gmx_simd_setzero();
+            fiz3_S           = gmx_simd_setzero();
+            
+            for(k=nj0; (k<nj1); k+=GMX_SIMD_WIDTH)
+            {
+                nvalid           = gmx_simd_load_jindex(jjnr+k,nj1-k,jnr,j3,&mask_S);
+                gmx_simd_gather_rvec(pos+0,j3,&jx1_S,&jy1_S,&jz1_S);
+                gmx_simd_gather_rvec(pos+3,j3,&jx2_S,&jy2_S,&jz2_S);
+                gmx_simd_gather_rvec(pos+6,j3,&jx3_S,&jy3_S,&jz3_S);
+                dx11_S           = gmx_simd_sub(ix1_S,jx1_S);
+                dy11_S           = gmx_simd_sub(iy1_S,jy1_S);
+                dz11_S           = gmx_simd_sub(iz1_S,jz1_S);
+                rsq11_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx11_S,dx11_S),gmx_simd_mul(dy11_S,dy11_S)),gmx_simd_mul(dz11_S,dz11_S));
+                dx12_S           = gmx_simd_sub(ix1_S,jx2_S);
+                dy12_S           = gmx_simd_sub(iy1_S,jy2_S);
+                dz12_S           = gmx_simd_sub(iz1_S,jz2_S);
+                rsq12_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx12_S,dx12_S),gmx_simd_mul(dy12_S,dy12_S)),gmx_simd_mul(dz12_S,dz12_S));
+                dx13_S           = gmx_simd_sub(ix1_S,jx3_S);
+                dy13_S           = gmx_simd_sub(iy1_S,jy3_S);
+                dz13_S           = gmx_simd_sub(iz1_S,jz3_S);
+                rsq13_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx13_S,dx13_S),gmx_simd_mul(dy13_S,dy13_S)),gmx_simd_mul(dz13_S,dz13_S));
+                dx21_S           = gmx_simd_sub(ix2_S,jx1_S);
+                dy21_S           = gmx_simd_sub(iy2_S,jy1_S);
+                dz21_S           = gmx_simd_sub(iz2_S,jz1_S);
+                rsq21_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx21_S,dx21_S),gmx_simd_mul(dy21_S,dy21_S)),gmx_simd_mul(dz21_S,dz21_S));
+                dx22_S           = gmx_simd_sub(ix2_S,jx2_S);
+                dy22_S           = gmx_simd_sub(iy2_S,jy2_S);
+                dz22_S           = gmx_simd_sub(iz2_S,jz2_S);
+                rsq22_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx22_S,dx22_S),gmx_simd_mul(dy22_S,dy22_S)),gmx_simd_mul(dz22_S,dz22_S));
+                dx23_S           = gmx_simd_sub(ix2_S,jx3_S);
+                dy23_S           = gmx_simd_sub(iy2_S,jy3_S);
+                dz23_S           = gmx_simd_sub(iz2_S,jz3_S);
+                rsq23_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx23_S,dx23_S),gmx_simd_mul(dy23_S,dy23_S)),gmx_simd_mul(dz23_S,dz23_S));
+                dx31_S           = gmx_simd_sub(ix3_S,jx1_S);
+                dy31_S           = gmx_simd_sub(iy3_S,jy1_S);
+                dz31_S           = gmx_simd_sub(iz3_S,jz1_S);
+                rsq31_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx31_S,dx31_S),gmx_simd_mul(dy31_S,dy31_S)),gmx_simd_mul(dz31_S,dz31_S));
+                dx32_S           = gmx_simd_sub(ix3_S,jx2_S);
+                dy32_S           = gmx_simd_sub(iy3_S,jy2_S);
+                dz32_S           = gmx_simd_sub(iz3_S,jz2_S);
+                rsq32_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx32_S,dx32_S),gmx_simd_mul(dy32_S,dy32_S)),gmx_simd_mul(dz32_S,dz32_S));
+                dx33_S           = gmx_simd_sub(ix3_S,jx3_S);
+                dy33_S           = gmx_simd_sub(iy3_S,jy3_S);
+                dz33_S           = gmx_simd_sub(iz3_S,jz3_S);
+                rsq33_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx33_S,dx33_S),gmx_simd_mul(dy33_S,dy33_S)),gmx_simd_mul(dz33_S,dz33_S));
+                rinv11_S         = gmx_simd_invsqrt(rsq11_S);
+                rinv12_S         = gmx_simd_invsqrt(rsq12_S);
+                rinv13_S         = gmx_simd_invsqrt(rsq13_S);
+                rinv21_S         = gmx_simd_invsqrt(rsq21_S);
+                rinv22_S         = gmx_simd_invsqrt(rsq22_S);
+                rinv23_S         = gmx_simd_invsqrt(rsq23_S);
+                rinv31_S         = gmx_simd_invsqrt(rsq31_S);
+                rinv32_S         = gmx_simd_invsqrt(rsq32_S);
+                rinv33_S         = gmx_simd_invsqrt(rsq33_S);
+                qq_S             = qqOO_S;         
+                rinvsq_S         = gmx_simd_mul(rinv11_S,rinv11_S);
+                vcoul_S          = gmx_simd_mul(qq_S,rinv11_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                rinvsix_S        = gmx_simd_mul(gmx_simd_mul(rinvsq_S,rinvsq_S),rinvsq_S);
+                Vvdw6_S          = gmx_simd_mul(c6_S,rinvsix_S);
+                Vvdw12_S         = gmx_simd_mul(gmx_simd_mul(c12_S,rinvsix_S),rinvsix_S);
+                Vvdw6_S          = gmx_simd_and(Vvdw6_S,mask_S);
+                Vvdw12_S         = gmx_simd_and(Vvdw12_S,mask_S);
+                Vvdwtot_S        = gmx_simd_sub(gmx_simd_add(Vvdwtot_S,Vvdw12_S),Vvdw6_S);
+                fscal_S          = gmx_simd_mul(gmx_simd_sub(gmx_simd_add(vcoul_S,gmx_simd_mul(gmx_simd_set1(12.0),Vvdw12_S)),gmx_simd_mul(gmx_simd_set1(6.0),Vvdw6_S)),rinvsq_S);
+                fscal_S          = gmx_simd_and(fscal_S,mask_S);
+                tx_S             = gmx_simd_mul(fscal_S,dx11_S);
+                ty_S             = gmx_simd_mul(fscal_S,dy11_S);
+                tz_S             = gmx_simd_mul(fscal_S,dz11_S);
+                fix1_S           = gmx_simd_add(fix1_S,tx_S);
+                fiy1_S           = gmx_simd_add(fiy1_S,ty_S);
+                fiz1_S           = gmx_simd_add(fiz1_S,tz_S);
+                fjx1_S           = tx_S;           
+                fjy1_S           = ty_S;           
+                fjz1_S           = tz_S;           
+                qq_S             = qqOH_S;         
+                rinvsq_S         = gmx_simd_mul(rinv12_S,rinv12_S);
+                vcoul_S          = gmx_simd_mul(qq_S,rinv12_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                fscal_S          = gmx_simd_mul(vcoul_S,rinvsq_S);
+                fscal_S          = gmx_simd_and(fscal_S,mask_S);
+                tx_S             = gmx_simd_mul(fscal_S,dx12_S);
+                ty_S             = gmx_simd_mul(fscal_S,dy12_S);
+                tz_S             = gmx_simd_mul(fscal_S,dz12_S);
+                fix1_S           = gmx_simd_add(fix1_S,tx_S);
+                fiy1_S           = gmx_simd_add(fiy1_S,ty_S);
+                fiz1_S           = gmx_simd_add(fiz1_S,tz_S);
+                fjx2_S           = tx_S;           
+                fjy2_S           = ty_S;           
+                fjz2_S           = tz_S;           
+                qq_S             = qqOH_S;         
+                rinvsq_S         = gmx_simd_mul(rinv13_S,rinv13_S);
+                vcoul_S          = gmx_simd_mul(qq_S,rinv13_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                fscal_S          = gmx_simd_mul(vcoul_S,rinvsq_S);
+                fscal_S          = gmx_simd_and(fscal_S,mask_S);
+                tx_S             = gmx_simd_mul(fscal_S,dx13_S);
+                ty_S             = gmx_simd_mul(fscal_S,dy13_S);
+                tz_S             = gmx_simd_mul(fscal_S,dz13_S);
+                fix1_S           = gmx_simd_add(fix1_S,tx_S);
+                fiy1_S           = gmx_simd_add(fiy1_S,ty_S);
+                fiz1_S           = gmx_simd_add(fiz1_S,tz_S);
+                fjx3_S           = tx_S;           
+                fjy3_S           = ty_S;           
+                fjz3_S           = tz_S;           
+                qq_S             = qqOH_S;         
+                rinvsq_S         = gmx_simd_mul(rinv21_S,rinv21_S);
+                vcoul_S          = gmx_simd_mul(qq_S,rinv21_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                fscal_S          = gmx_simd_mul(vcoul_S,rinvsq_S);
+                fscal_S          = gmx_simd_and(fscal_S,mask_S);
+                tx_S             = gmx_simd_mul(fscal_S,dx21_S);
+                ty_S             = gmx_simd_mul(fscal_S,dy21_S);
+                tz_S             = gmx_simd_mul(fscal_S,dz21_S);
+                fix2_S           = gmx_simd_add(fix2_S,tx_S);
+                fiy2_S           = gmx_simd_add(fiy2_S,ty_S);
+                fiz2_S           = gmx_simd_add(fiz2_S,tz_S);
+                fjx1_S           = gmx_simd_add(fjx1_S,tx_S);
+                fjy1_S           = gmx_simd_add(fjy1_S,ty_S);
+                fjz1_S           = gmx_simd_add(fjz1_S,tz_S);
+                qq_S             = qqHH_S;         
+                rinvsq_S         = gmx_simd_mul(rinv22_S,rinv22_S);
+                vcoul_S          = gmx_simd_mul(qq_S,rinv22_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                fscal_S          = gmx_simd_mul(vcoul_S,rinvsq_S);
+                fscal_S          = gmx_simd_and(fscal_S,mask_S);
+                tx_S             = gmx_simd_mul(fscal_S,dx22_S);
+                ty_S             = gmx_simd_mul(fscal_S,dy22_S);
+                tz_S             = gmx_simd_mul(fscal_S,dz22_S);
+                fix2_S           = gmx_simd_add(fix2_S,tx_S);
+                fiy2_S           = gmx_simd_add(fiy2_S,ty_S);
+                fiz2_S           = gmx_simd_add(fiz2_S,tz_S);
+                fjx2_S           = gmx_simd_add(fjx2_S,tx_S);
+                fjy2_S           = gmx_simd_add(fjy2_S,ty_S);
+                fjz2_S           = gmx_simd_add(fjz2_S,tz_S);
+                qq_S             = qqHH_S;         
+                rinvsq_S         = gmx_simd_mul(rinv23_S,rinv23_S);
+                vcoul_S          = gmx_simd_mul(qq_S,rinv23_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                fscal_S          = gmx_simd_mul(vcoul_S,rinvsq_S);
+                fscal_S          = gmx_simd_and(fscal_S,mask_S);
+                tx_S             = gmx_simd_mul(fscal_S,dx23_S);
+                ty_S             = gmx_simd_mul(fscal_S,dy23_S);
+                tz_S             = gmx_simd_mul(fscal_S,dz23_S);
+                fix2_S           = gmx_simd_add(fix2_S,tx_S);
+                fiy2_S           = gmx_simd_add(fiy2_S,ty_S);
+                fiz2_S           = gmx_simd_add(fiz2_S,tz_S);
+                fjx3_S           = gmx_simd_add(fjx3_S,tx_S);
+                fjy3_S           = gmx_simd_add(fjy3_S,ty_S);
+                fjz3_S           = gmx_simd_add(fjz3_S,tz_S);
+                qq_S             = qqOH_S;         
+                rinvsq_S         = gmx_simd_mul(rinv31_S,rinv31_S);
+                vcoul_S          = gmx_simd_mul(qq_S,rinv31_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                fscal_S          = gmx_simd_mul(vcoul_S,rinvsq_S);
+                fscal_S          = gmx_simd_and(fscal_S,mask_S);
+                tx_S             = gmx_simd_mul(fscal_S,dx31_S);
+                ty_S             = gmx_simd_mul(fscal_S,dy31_S);
+                tz_S             = gmx_simd_mul(fscal_S,dz31_S);
+                fix3_S           = gmx_simd_add(fix3_S,tx_S);
+                fiy3_S           = gmx_simd_add(fiy3_S,ty_S);
+                fiz3_S           = gmx_simd_add(fiz3_S,tz_S);
+                fjx1_S           = gmx_simd_add(fjx1_S,tx_S);
+                fjy1_S           = gmx_simd_add(fjy1_S,ty_S);
+                fjz1_S           = gmx_simd_add(fjz1_S,tz_S);
+                gmx_simd_decrement_rvec(faction+0,j3,nvalid,fjx1_S,fjy1_S,fjz1_S);
+                qq_S             = qqHH_S;         
+                rinvsq_S         = gmx_simd_mul(rinv32_S,rinv32_S);
+                vcoul_S          = gmx_simd_mul(qq_S,rinv32_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                fscal_S          = gmx_simd_mul(vcoul_S,rinvsq_S);
+                fscal_S          = gmx_simd_and(fscal_S,mask_S);
+                tx_S             = gmx_simd_mul(fscal_S,dx32_S);
+                ty_S             = gmx_simd_mul(fscal_S,dy32_S);
+                tz_S             = gmx_simd_mul(fscal_S,dz32_S);
+                fix3_S           = gmx_simd_add(fix3_S,tx_S);
+                fiy3_S           = gmx_simd_add(fiy3_S,ty_S);
+                fiz3_S           = gmx_simd_add(fiz3_S,tz_S);
+                fjx2_S           = gmx_simd_add(fjx2_S,tx_S);
+                fjy2_S           = gmx_simd_add(fjy2_S,ty_S);
+                fjz2_S           = gmx_simd_add(fjz2_S,tz_S);
+                gmx_simd_decrement_rvec(faction+3,j3,nvalid,fjx2_S,fjy2_S,fjz2_S);
+                qq_S             = qqHH_S;         
+                rinvsq_S         = gmx_simd_mul(rinv33_S,rinv33_S);
+                vcoul_S          = gmx_simd_mul(qq_S,rinv33_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                fscal_S          = gmx_simd_mul(vcoul_S,rinvsq_S);
+                fscal_S          = gmx_simd_and(fscal_S,mask_S);
+                tx_S             = gmx_simd_mul(fscal_S,dx33_S);
+                ty_S             = gmx_simd_mul(fscal_S,dy33_S);
+                tz_S             = gmx_simd_mul(fscal_S,dz33_S);
+                fix3_S           = gmx_simd_add(fix3_S,tx_S);
+                fiy3_S           = gmx_simd_add(fiy3_S,ty_S);
+                fiz3_S           = gmx_simd_add(fiz3_S,tz_S);
+                fjx3_S           = gmx_simd_add(fjx3_S,tx_S);
+                fjy3_S           = gmx_simd_add(fjy3_S,ty_S);
+                fjz3_S           = gmx_simd_add(fjz3_S,tz_S);
+                gmx_simd_decrement_rvec(faction+6,j3,nvalid,fjx3_S,fjy3_S,fjz3_S);
+            }
+            
+            fix1             = gmx_simd_reduce(fix1_S);
+            fiy1             = gmx_simd_reduce(fiy1_S);
+            fiz1             = gmx_simd_reduce(fiz1_S);
+            fix2             = gmx_simd_reduce(fix2_S);
+            fiy2             = gmx_simd_reduce(fiy2_S);
+            fiz2             = gmx_simd_reduce(fiz2_S);
+            fix3             = gmx_simd_reduce(fix3_S);
+            fiy3             = gmx_simd_reduce(fiy3_S);
+            fiz3             = gmx_simd_reduce(fiz3_S);
+            vctot            = gmx_simd_reduce(vctot_S);
+            Vvdwtot          = gmx_simd_reduce(Vvdwtot_S);
+            faction[ii3+0]   = faction[ii3+0] + fix1;
+            faction[ii3+1]   = faction[ii3+1] + fiy1;
+            faction[ii3+2]   = faction[ii3+2] + fiz1;
+            faction[ii3+3]   = faction[ii3+3] + fix2;
+            faction[ii3+4]   = faction[ii3+4] + fiy2;
+            faction[ii3+5]   = faction[ii3+5] + fiz2;
+            faction[ii3+6]   = faction[ii3+6] + fix3;
+            faction[ii3+7]   = faction[ii3+7] + fiy3;
+            faction[ii3+8]   = faction[ii3+8] + fiz3;
+            fshift[is3]      = fshift[is3]+fix1+fix2+fix3;
+            fshift[is3+1]    = fshift[is3+1]+fiy1+fiy2+fiy3;
+            fshift[is3+2]    = fshift[is3+2]+fiz1+fiz2+fiz3;
+            ggid             = gid[n];         
+            Vc[ggid]         = Vc[ggid] + vctot;
+            Vvdw[ggid]       = Vvdw[ggid] + Vvdwtot;
+            ninner           = ninner + nj1 - nj0;
+        }
+        
+        nouter           = nouter + nn1 - nn0;
+    }
+    while (nn1<nri);
+    
+    *outeriter       = nouter;         
+    *inneriter       = ninner;         
+}
+
+
+
+
+
+/*
+ * Gromacs nonbonded kernel GMX_SIMD_NAME(nb_kernel112nf)
+ * Coulomb interaction:     Normal Coulomb
+ * VdW interaction:         Lennard-Jones
+ * water optimization:      pairs of SPC/TIP3P interactions
+ * Calculate forces:        no
+ */
+void GMX_SIMD_NAME(nb_kernel112nf)(
+                    int *           p_nri,
+                    int *           iinr,
+                    int *           jindex,
+                    int *           jjnr,
+                    int *           shift,
+                    real *          shiftvec,
+                    real *          fshift,
+                    int *           gid,
+                    real *          pos,
+                    real *          faction,
+                    real *          charge,
+                    real *          p_facel,
+                    real *          p_krf,
+                    real *          p_crf,
+                    real *          Vc,
+                    int *           type,
+                    int *           p_ntype,
+                    real *          vdwparam,
+                    real *          Vvdw,
+                    real *          p_tabscale,
+                    real *          VFtab,
+                    real *          enerd1,
+                    real *          enerd2,
+                    real *          enerd3,
+                    real *          enerd4,
+                    int *           start,
+                    int *           end,
+                    int *           homenr,
+                    int *           nbsum,
+                    real *          invsqrta,
+                    real *          dvda,
+                    real *          p_gbtabscale,
+                    real *          GBtab,
+                    int *           p_nthreads,
+                    int *           count,
+                    void *          mtx,
+                    int *           outeriter,
+                    int *           inneriter,
+                    real *          work)
+{
+    int           nri,ntype,nthreads;
+    real          facel,krf,crf,tabscale,gbtabscale;
+    int           n,ii,is3,ii3,k,nj0,nj1,ggid,nvalid;
+    int           jnr[GMX_SIMD_WIDTH],j3[GMX_SIMD_WIDTH];
+    int           nn0,nn1,nouter,ninner;
+    real          shX,shY,shZ;
+    gmx_simd_real_t mask_S;
+    gmx_simd_real_t rinvsq_S;
+    real          vctot;
+    real          qO,qH,qqOO,qqOH,qqHH;
+    gmx_simd_real_t qqOO_S,qqOH_S,qqHH_S;
+    gmx_simd_real_t qq_S,vcoul_S,vctot_S;
+    real          Vvdwtot;
+    int           tj;
+    real          c6,c12;
+    gmx_simd_real_t c6_S,c12_S,Vvdw12_S;
+    gmx_simd_real_t rinvsix_S;
+    gmx_simd_real_t Vvdw6_S,Vvdwtot_S;
+    real          ix1,iy1,iz1;
+    gmx_simd_real_t ix1_S,iy1_S,iz1_S;
+    real          ix2,iy2,iz2;
+    gmx_simd_real_t ix2_S,iy2_S,iz2_S;
+    real          ix3,iy3,iz3;
+    gmx_simd_real_t ix3_S,iy3_S,iz3_S;
+    gmx_simd_real_t jx1_S,jy1_S,jz1_S;
+    gmx_simd_real_t jx2_S,jy2_S,jz2_S;
+    gmx_simd_real_t jx3_S,jy3_S,jz3_S;
+    gmx_simd_real_t dx11_S,dy11_S,dz11_S,rsq11_S,rinv11_S;
+    gmx_simd_real_t dx12_S,dy12_S,dz12_S,rsq12_S,rinv12_S;
+    gmx_simd_real_t dx13_S,dy13_S,dz13_S,rsq13_S,rinv13_S;
+    gmx_simd_real_t dx21_S,dy21_S,dz21_S,rsq21_S,rinv21_S;
+    gmx_simd_real_t dx22_S,dy22_S,dz22_S,rsq22_S,rinv22_S;
+    gmx_simd_real_t dx23_S,dy23_S,dz23_S,rsq23_S,rinv23_S;
+    gmx_simd_real_t dx31_S,dy31_S,dz31_S,rsq31_S,rinv31_S;
+    gmx_simd_real_t dx32_S,dy32_S,dz32_S,rsq32_S,rinv32_S;
+    gmx_simd_real_t dx33_S,dy33_S,dz33_S,rsq33_S,rinv33_S;
+
+    nri              = *p_nri;         
+    ntype            = *p_ntype;       
+    nthreads         = *p_nthreads;    
+    facel            = *p_facel;       
+    krf              = *p_krf;         
+    crf              = *p_crf;         
+    tabscale         = *p_tabscale;    
+    ii               = iinr[0];        
+    qO               = charge[ii];     
+    qH               = charge[ii+1];   
+    qqOO             = facel*qO*qO;    
+    qqOH             = facel*qO*qH;    
+    qqHH             = facel*qH*qH;    
+    tj               = 2*(ntype+1)*type[ii];
+    c6               = vdwparam[tj];   
+    c12              = vdwparam[tj+1]; 
+
+    qqOO_S           = gmx_simd_set1(qqOO);
+    qqOH_S           = gmx_simd_set1(qqOH);
+    qqHH_S           = gmx_simd_set1(qqHH);
+    c6_S             = gmx_simd_set1(c6);
+    c12_S            = gmx_simd_set1(c12);
+    nouter           = 0;              
+    ninner           = 0;              
+    
+    do
+    {
+#ifdef GMX_THREADS
+        gmx_thread_mutex_lock((gmx_thread_mutex_t *)mtx);
+        nn0              = *count;         
+        nn1              = nn0+(nri-nn0)/(2*nthreads)+10;
+        *count           = nn1;            
+        gmx_thread_mutex_unlock((gmx_thread_mutex_t *)mtx);
+        if(nn1>nri) nn1=nri;
+#else
+        nn0              = 0;              
+        nn1              = nri;            
+#endif
+        
+        for(n=nn0; (n<nn1); n++)
+        {
+            is3              = 3*shift[n];     
+            shX              = shiftvec[is3];  
+            shY              = shiftvec[is3+1];
+            shZ              = shiftvec[is3+2];
+            nj0              = jindex[n];      
+            nj1              = jindex[n+1];    
+            ii               = iinr[n];        
+            ii3              = 3*ii;           
+            ix1              = shX + pos[ii3+0];
+            iy1              = shY + pos[ii3+1];
+            iz1              = shZ + pos[ii3+2];
+            ix2              = shX + pos[ii3+3];
+            iy2              = shY + pos[ii3+4];
+            iz2              = shZ + pos[ii3+5];
+            ix3              = shX + pos[ii3+6];
+            iy3              = shY + pos[ii3+7];
+            iz3              = shZ + pos[ii3+8];
+            ix1_S            = gmx_simd_set1(ix1);
+            iy1_S            = gmx_simd_set1(iy1);
+            iz1_S            = gmx_simd_set1(iz1);
+            ix2_S            = gmx_simd_set1(ix2);
+            iy2_S            = gmx_simd_set1(iy2);
+            iz2_S            = gmx_simd_set1(iz2);
+            ix3_S            = gmx_simd_set1(ix3);
+            iy3_S            = gmx_simd_set1(iy3);
+            iz3_S            = gmx_simd_set1(iz3);
+            vctot_S          = gmx_simd_setzero();
+            Vvdwtot_S        = gmx_simd_setzero();
+            
+            for(k=nj0; (k<nj1); k+=GMX_SIMD_WIDTH)
+            {
+                nvalid           = gmx_simd_load_jindex(jjnr+k,nj1-k,jnr,j3,&mask_S);
+                gmx_simd_gather_rvec(pos+0,j3,&jx1_S,&jy1_S,&jz1_S);
+                gmx_simd_gather_rvec(pos+3,j3,&jx2_S,&jy2_S,&jz2_S);
+                gmx_simd_gather_rvec(pos+6,j3,&jx3_S,&jy3_S,&jz3_S);
+                dx11_S           = gmx_simd_sub(ix1_S,jx1_S);
+                dy11_S           = gmx_simd_sub(iy1_S,jy1_S);
+                dz11_S           = gmx_simd_sub(iz1_S,jz1_S);
+                rsq11_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx11_S,dx11_S),gmx_simd_mul(dy11_S,dy11_S)),gmx_simd_mul(dz11_S,dz11_S));
+                dx12_S           = gmx_simd_sub(ix1_S,jx2_S);
+                dy12_S           = gmx_simd_sub(iy1_S,jy2_S);
+                dz12_S           = gmx_simd_sub(iz1_S,jz2_S);
+                rsq12_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx12_S,dx12_S),gmx_simd_mul(dy12_S,dy12_S)),gmx_simd_mul(dz12_S,dz12_S));
+                dx13_S           = gmx_simd_sub(ix1_S,jx3_S);
+                dy13_S           = gmx_simd_sub(iy1_S,jy3_S);
+                dz13_S           = gmx_simd_sub(iz1_S,jz3_S);
+                rsq13_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx13_S,dx13_S),gmx_simd_mul(dy13_S,dy13_S)),gmx_simd_mul(dz13_S,dz13_S));
+                dx21_S           = gmx_simd_sub(ix2_S,jx1_S);
+                dy21_S           = gmx_simd_sub(iy2_S,jy1_S);
+                dz21_S           = gmx_simd_sub(iz2_S,jz1_S);
+                rsq21_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx21_S,dx21_S),gmx_simd_mul(dy21_S,dy21_S)),gmx_simd_mul(dz21_S,dz21_S));
+                dx22_S           = gmx_simd_sub(ix2_S,jx2_S);
+                dy22_S           = gmx_simd_sub(iy2_S,jy2_S);
+                dz22_S           = gmx_simd_sub(iz2_S,jz2_S);
+                rsq22_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx22_S,dx22_S),gmx_simd_mul(dy22_S,dy22_S)),gmx_simd_mul(dz22_S,dz22_S));
+                dx23_S           = gmx_simd_sub(ix2_S,jx3_S);
+                dy23_S           = gmx_simd_sub(iy2_S,jy3_S);
+                dz23_S           = gmx_simd_sub(iz2_S,jz3_S);
+                rsq23_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx23_S,dx23_S),gmx_simd_mul(dy23_S,dy23_S)),gmx_simd_mul(dz23_S,dz23_S));
+                dx31_S           = gmx_simd_sub(ix3_S,jx1_S);
+                dy31_S           = gmx_simd_sub(iy3_S,jy1_S);
+                dz31_S           = gmx_simd_sub(iz3_S,jz1_S);
+                rsq31_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx31_S,dx31_S),gmx_simd_mul(dy31_S,dy31_S)),gmx_simd_mul(dz31_S,dz31_S));
+                dx32_S           = gmx_simd_sub(ix3_S,jx2_S);
+                dy32_S           = gmx_simd_sub(iy3_S,jy2_S);
+                dz32_S           = gmx_simd_sub(iz3_S,jz2_S);
+                rsq32_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx32_S,dx32_S),gmx_simd_mul(dy32_S,dy32_S)),gmx_simd_mul(dz32_S,dz32_S));
+                dx33_S           = gmx_simd_sub(ix3_S,jx3_S);
+                dy33_S           = gmx_simd_sub(iy3_S,jy3_S);
+                dz33_S           = gmx_simd_sub(iz3_S,jz3_S);
+                rsq33_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx33_S,dx33_S),gmx_simd_mul(dy33_S,dy33_S)),gmx_simd_mul(dz33_S,dz33_S));
+                rinv11_S         = gmx_simd_invsqrt(rsq11_S);
+                rinv12_S         = gmx_simd_invsqrt(rsq12_S);
+                rinv13_S         = gmx_simd_invsqrt(rsq13_S);
+                rinv21_S         = gmx_simd_invsqrt(rsq21_S);
+                rinv22_S         = gmx_simd_invsqrt(rsq22_S);
+                rinv23_S         = gmx_simd_invsqrt(rsq23_S);
+                rinv31_S         = gmx_simd_invsqrt(rsq31_S);
+                rinv32_S         = gmx_simd_invsqrt(rsq32_S);
+                rinv33_S         = gmx_simd_invsqrt(rsq33_S);
+                qq_S             = qqOO_S;         
+                rinvsq_S         = gmx_simd_mul(rinv11_S,rinv11_S);
+                vcoul_S          = gmx_simd_mul(qq_S,rinv11_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                rinvsix_S        = gmx_simd_mul(gmx_simd_mul(rinvsq_S,rinvsq_S),rinvsq_S);
+                Vvdw6_S          = gmx_simd_mul(c6_S,rinvsix_S);
+                Vvdw12_S         = gmx_simd_mul(gmx_simd_mul(c12_S,rinvsix_S),rinvsix_S);
+                Vvdw6_S          = gmx_simd_and(Vvdw6_S,mask_S);
+                Vvdw12_S         = gmx_simd_and(Vvdw12_S,mask_S);
+                Vvdwtot_S        = gmx_simd_sub(gmx_simd_add(Vvdwtot_S,Vvdw12_S),Vvdw6_S);
+                qq_S             = qqOH_S;         
+                vcoul_S          = gmx_simd_mul(qq_S,rinv12_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                qq_S             = qqOH_S;         
+                vcoul_S          = gmx_simd_mul(qq_S,rinv13_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                qq_S             = qqOH_S;         
+                vcoul_S          = gmx_simd_mul(qq_S,rinv21_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                qq_S             = qqHH_S;         
+                vcoul_S          = gmx_simd_mul(qq_S,rinv22_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                qq_S             = qqHH_S;         
+                vcoul_S          = gmx_simd_mul(qq_S,rinv23_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                qq_S             = qqOH_S;         
+                vcoul_S          = gmx_simd_mul(qq_S,rinv31_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                qq_S             = qqHH_S;         
+                vcoul_S          = gmx_simd_mul(qq_S,rinv32_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                qq_S             = qqHH_S;         
+                vcoul_S          = gmx_simd_mul(qq_S,rinv33_S);
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+            }
+            
+            vctot            = gmx_simd_reduce(vctot_S);
+            Vvdwtot          = gmx_simd_reduce(Vvdwtot_S);
+            ggid             = gid[n];         
+            Vc[ggid]         = Vc[ggid] + vctot;
+            Vvdw[ggid]       = Vvdw[ggid] + Vvdwtot;
+            ninner           = ninner + nj1 - nj0;
+        }
+        
+        nouter           = nouter + nn1 - nn0;
+    }
+    while (nn1<nri);
+    
+    *outeriter       = nouter;         
+    *inneriter       = ninner;         
+}
+
+
@@ -0,0 +1,687 @@
+/*
+ * Copyright (c) Erik Lindahl, David van der Spoel 2003
+ * 
+ * This file is generated automatically at compile time
+ * by the program mknb in the Gromacs distribution.
+ *
+ * Options used when generation this file:
+ * Language:         c, SIMD (gmx_simd.h)
+ * Precision:        any
+ * Threads:          yes
+ * Software invsqrt: no
+ * PowerPC invsqrt:  no
+ * Prefetch forces:  no
+ * Comments:         no
+ */
+#ifdef HAVE_CONFIG_H
+#include<config.h>
+#endif
+#include<gmx_thread.h>
+#include<math.h>
+#include<types/simple.h>
+#include<gmx_simd.h>
+
+
+
+/*
+ * Gromacs nonbonded kernel GMX_SIMD_NAME(nb_kernel204)
+ * Coulomb interaction:     Reaction field
+ * VdW interaction:         Not calculated
+ * water optimization:      pairs of TIP4P interactions
+ * Calculate forces:        yes
+ */
+void GMX_SIMD_NAME(nb_kernel204)(
+                    int *           p_nri,
+                    int *           iinr,
+                    int *           jindex,
+                    int *           jjnr,
+                    int *           shift,
+                    real *          shiftvec,
+                    real *          fshift,
+                    int *           gid,
+                    real *          pos,
+                    real *          faction,
+                    real *          charge,
+                    real *          p_facel,
+                    real *          p_krf,
+                    real *          p_crf,
+                    real *          Vc,
+                    int *           type,
+                    int *           p_ntype,
+                    real *          vdwparam,
+                    real *          Vvdw,
+                    real *          p_tabscale,
+                    real *          VFtab,
+                    real *          enerd1,
+                    real *          enerd2,
+                    real *          enerd3,
+                    real *          enerd4,
+                    int *           start,
+                    int *           end,
+                    int *           homenr,
+                    int *           nbsum,
+                    real *          invsqrta,
+                    real *          dvda,
+                    real *          p_gbtabscale,
+                    real *          GBtab,
+                    int *           p_nthreads,
+                    int *           count,
+                    void *          mtx,
+                    int *           outeriter,
+                    int *           inneriter,
+                    real *          work)
+{
+    int           nri,ntype,nthreads;
+    real          facel,krf,crf,tabscale,gbtabscale;
+    int           n,ii,is3,ii3,k,nj0,nj1,ggid,nvalid;
+    int           jnr[GMX_SIMD_WIDTH],j3[GMX_SIMD_WIDTH];
+    int           nn0,nn1,nouter,ninner;
+    real          shX,shY,shZ;
+    gmx_simd_real_t mask_S;
+    gmx_simd_real_t fscal_S,tx_S,ty_S,tz_S;
+    gmx_simd_real_t rinvsq_S;
+    real          vctot;
+    real          qH,qM,qqMM,qqMH,qqHH;
+    gmx_simd_real_t qqMM_S,qqMH_S,qqHH_S;
+    gmx_simd_real_t qq_S,vcoul_S,vctot_S;
+    gmx_simd_real_t krf_S,crf_S,krsq_S;
+    real          ix2,iy2,iz2,fix2,fiy2,fiz2;
+    gmx_simd_real_t ix2_S,iy2_S,iz2_S,fix2_S,fiy2_S,fiz2_S;
+    real          ix3,iy3,iz3,fix3,fiy3,fiz3;
+    gmx_simd_real_t ix3_S,iy3_S,iz3_S,fix3_S,fiy3_S,fiz3_S;
+    real          ix4,iy4,iz4,fix4,fiy4,fiz4;
+    gmx_simd_real_t ix4_S,iy4_S,iz4_S,fix4_S,fiy4_S,fiz4_S;
+    gmx_simd_real_t jx2_S,jy2_S,jz2_S,fjx2_S,fjy2_S,fjz2_S;
+    gmx_simd_real_t jx3_S,jy3_S,jz3_S,fjx3_S,fjy3_S,fjz3_S;
+    gmx_simd_real_t jx4_S,jy4_S,jz4_S,fjx4_S,fjy4_S,fjz4_S;
+    gmx_simd_real_t dx22_S,dy22_S,dz22_S,rsq22_S,rinv22_S;
+    gmx_simd_real_t dx23_S,dy23_S,dz23_S,rsq23_S,rinv23_S;
+    gmx_simd_real_t dx24_S,dy24_S,dz24_S,rsq24_S,rinv24_S;
+    gmx_simd_real_t dx32_S,dy32_S,dz32_S,rsq32_S,rinv32_S;
+    gmx_simd_real_t dx33_S,dy33_S,dz33_S,rsq33_S,rinv33_S;
+    gmx_simd_real_t dx34_S,dy34_S,dz34_S,rsq34_S,rinv34_S;
+    gmx_simd_real_t dx42_S,dy42_S,dz42_S,rsq42_S,rinv42_S;
+    gmx_simd_real_t dx43_S,dy43_S,dz43_S,rsq43_S,rinv43_S;
+    gmx_simd_real_t dx44_S,dy44_S,dz44_S,rsq44_S,rinv44_S;
+
+    nri              = *p_nri;         
+    ntype            = *p_ntype;       
+    nthreads         = *p_nthreads;    
+    facel            = *p_facel;       
+    krf              = *p_krf;         
+    crf              = *p_crf;         
+    tabscale         = *p_tabscale;    
+    ii               = iinr[0];        
+    qH               = charge[ii+1];   
+    qM               = charge[ii+3];   
+    qqMM             = facel*qM*qM;    
+    qqMH             = facel*qM*qH;    
+    qqHH             = facel*qH*qH;    
+
+    krf_S            = gmx_simd_set1(krf);
+    crf_S            = gmx_simd_set1(crf);
+    qqMM_S           = gmx_simd_set1(qqMM);
+    qqMH_S           = gmx_simd_set1(qqMH);
+    qqHH_S           = gmx_simd_set1(qqHH);
+    nouter           = 0;              
+    ninner           = 0;              
+    
+    do
+    {
+#ifdef GMX_THREADS
+        gmx_thread_mutex_lock((gmx_thread_mutex_t *)mtx);
+        nn0              = *count;         
+        nn1              = nn0+(nri-nn0)/(2*nthreads)+10;
+        *count           = nn1;            
+        gmx_thread_mutex_unlock((gmx_thread_mutex_t *)mtx);
+        if(nn1>nri) nn1=nri;
+#else
+        nn0              = 0;              
+        nn1              = nri;            
+#endif
+        
+        for(n=nn0; (n<nn1); n++)
+        {
+            is3              = 3*shift[n];     
+            shX              = shiftvec[is3];  
+            shY              = shiftvec[is3+1];
+            shZ              = shiftvec[is3+2];
+            nj0              = jindex[n];      
+            nj1              = jindex[n+1];    
+            ii               = iinr[n];        
+            ii3              = 3*ii;           
+            ix2              = shX + pos[ii3+3];
+            iy2              = shY + pos[ii3+4];
+            iz2              = shZ + pos[ii3+5];
+            ix3              = shX + pos[ii3+6];
+            iy3              = shY + pos[ii3+7];
+            iz3              = shZ + pos[ii3+8];
+            ix4              = shX + pos[ii3+9];
+            iy4              = shY + pos[ii3+10];
+            iz4              = shZ + pos[ii3+11];
+            ix2_S            = gmx_simd_set1(ix2);
+            iy2_S            = gmx_simd_set1(iy2);
+            iz2_S            = gmx_simd_set1(iz2);
+            ix3_S            = gmx_simd_set1(ix3);
+            iy3_S            = gmx_simd_set1(iy3);
+            iz3_S            = gmx_simd_set1(iz3);
+            ix4_S            = gmx_simd_set1(ix4);
+            iy4_S            = gmx_simd_set1(iy4);
+            iz4_S            = gmx_simd_set1(iz4);
+            vctot_S          = gmx_simd_setzero();
+            fix2_S           = gmx_simd_setzero();
+            fiy2_S           = gmx_simd_setzero();
+            fiz2_S           = gmx_simd_setzero();
+            fix3_S           = gmx_simd_setzero();
+            fiy3_S           = gmx_simd_setzero();
+            fiz3_S           = gmx_simd_setzero();
+            fix4_S           = gmx_simd_setzero();
+            fiy4_S           = gmx_simd_setzero();
+            fiz4_S           = gmx_simd_setzero();
+            
+            for(k=nj0; (k<nj1); k+=GMX_SIMD_WIDTH)
+            {
+                nvalid           = gmx_simd_load_jindex(jjnr+k,nj1-k,jnr,j3,&mask_S);
+                gmx_simd_gather_rvec(pos+3,j3,&jx2_S,&jy2_S,&jz2_S);
+                gmx_simd_gather_rvec(pos+6,j3,&jx3_S,&jy3_S,&jz3_S);
+                gmx_simd_gather_rvec(pos+9,j3,&jx4_S,&jy4_S,&jz4_S);
+                dx22_S           = gmx_simd_sub(ix2_S,jx2_S);
+                dy22_S           = gmx_simd_sub(iy2_S,jy2_S);
+                dz22_S           = gmx_simd_sub(iz2_S,jz2_S);
+                rsq22_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx22_S,dx22_S),gmx_simd_mul(dy22_S,dy22_S)),gmx_simd_mul(dz22_S,dz22_S));
+                dx23_S           = gmx_simd_sub(ix2_S,jx3_S);
+                dy23_S           = gmx_simd_sub(iy2_S,jy3_S);
+                dz23_S           = gmx_simd_sub(iz2_S,jz3_S);
+                rsq23_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx23_S,dx23_S),gmx_simd_mul(dy23_S,dy23_S)),gmx_simd_mul(dz23_S,dz23_S));
+                dx24_S           = gmx_simd_sub(ix2_S,jx4_S);
+                dy24_S           = gmx_simd_sub(iy2_S,jy4_S);
+                dz24_S           = gmx_simd_sub(iz2_S,jz4_S);
+                rsq24_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx24_S,dx24_S),gmx_simd_mul(dy24_S,dy24_S)),gmx_simd_mul(dz24_S,dz24_S));
+                dx32_S           = gmx_simd_sub(ix3_S,jx2_S);
+                dy32_S           = gmx_simd_sub(iy3_S,jy2_S);
+                dz32_S           = gmx_simd_sub(iz3_S,jz2_S);
+                rsq32_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx32_S,dx32_S),gmx_simd_mul(dy32_S,dy32_S)),gmx_simd_mul(dz32_S,dz32_S));
+                dx33_S           = gmx_simd_sub(ix3_S,jx3_S);
+                dy33_S           = gmx_simd_sub(iy3_S,jy3_S);
+                dz33_S           = gmx_simd_sub(iz3_S,jz3_S);
+                rsq33_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx33_S,dx33_S),gmx_simd_mul(dy33_S,dy33_S)),gmx_simd_mul(dz33_S,dz33_S));
+                dx34_S           = gmx_simd_sub(ix3_S,jx4_S);
+                dy34_S           = gmx_simd_sub(iy3_S,jy4_S);
+                dz34_S           = gmx_simd_sub(iz3_S,jz4_S);
+                rsq34_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx34_S,dx34_S),gmx_simd_mul(dy34_S,dy34_S)),gmx_simd_mul(dz34_S,dz34_S));
+                dx42_S           = gmx_simd_sub(ix4_S,jx2_S);
+                dy42_S           = gmx_simd_sub(iy4_S,jy2_S);
+                dz42_S           = gmx_simd_sub(iz4_S,jz2_S);
+                rsq42_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx42_S,dx42_S),gmx_simd_mul(dy42_S,dy42_S)),gmx_simd_mul(dz42_S,dz42_S));
+                dx43_S           = gmx_simd_sub(ix4_S,jx3_S);
+                dy43_S           = gmx_simd_sub(iy4_S,jy3_S);
+                dz43_S           = gmx_simd_sub(iz4_S,jz3_S);
+                rsq43_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx43_S,dx43_S),gmx_simd_mul(dy43_S,dy43_S)),gmx_simd_mul(dz43_S,dz43_S));
+                dx44_S           = gmx_simd_sub(ix4_S,jx4_S);
+                dy44_S           = gmx_simd_sub(iy4_S,jy4_S);
+                dz44_S           = gmx_simd_sub(iz4_S,jz4_S);
+                rsq44_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx44_S,dx44_S),gmx_simd_mul(dy44_S,dy44_S)),gmx_simd_mul(dz44_S,dz44_S));
+                rinv22_S         = gmx_simd_invsqrt(rsq22_S);
+                rinv23_S         = gmx_simd_invsqrt(rsq23_S);
+                rinv24_S         = gmx_simd_invsqrt(rsq24_S);
+                rinv32_S         = gmx_simd_invsqrt(rsq32_S);
+                rinv33_S         = gmx_simd_invsqrt(rsq33_S);
+                rinv34_S         = gmx_simd_invsqrt(rsq34_S);
+                rinv42_S         = gmx_simd_invsqrt(rsq42_S);
+                rinv43_S         = gmx_simd_invsqrt(rsq43_S);
+                rinv44_S         = gmx_simd_invsqrt(rsq44_S);
+                qq_S             = qqHH_S;         
+                rinvsq_S         = gmx_simd_mul(rinv22_S,rinv22_S);
+                krsq_S           = gmx_simd_mul(krf_S,rsq22_S);
+                vcoul_S          = gmx_simd_mul(qq_S,gmx_simd_sub(gmx_simd_add(rinv22_S,krsq_S),crf_S));
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                fscal_S          = gmx_simd_mul(gmx_simd_mul(qq_S,gmx_simd_sub(rinv22_S,gmx_simd_mul(gmx_simd_set1(2.0),krsq_S))),rinvsq_S);
+                fscal_S          = gmx_simd_and(fscal_S,mask_S);
+                tx_S             = gmx_simd_mul(fscal_S,dx22_S);
+                ty_S             = gmx_simd_mul(fscal_S,dy22_S);
+                tz_S             = gmx_simd_mul(fscal_S,dz22_S);
+                fix2_S           = gmx_simd_add(fix2_S,tx_S);
+                fiy2_S           = gmx_simd_add(fiy2_S,ty_S);
+                fiz2_S           = gmx_simd_add(fiz2_S,tz_S);
+                fjx2_S           = tx_S;           
+                fjy2_S           = ty_S;           
+                fjz2_S           = tz_S;           
+                qq_S             = qqHH_S;         
+                rinvsq_S         = gmx_simd_mul(rinv23_S,rinv23_S);
+                krsq_S           = gmx_simd_mul(krf_S,rsq23_S);
+                vcoul_S          = gmx_simd_mul(qq_S,gmx_simd_sub(gmx_simd_add(rinv23_S,krsq_S),crf_S));
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                fscal_S          = gmx_simd_mul(gmx_simd_mul(qq_S,gmx_simd_sub(rinv23_S,gmx_simd_mul(gmx_simd_set1(2.0),krsq_S))),rinvsq_S);
+                fscal_S          = gmx_simd_and(fscal_S,mask_S);
+                tx_S             = gmx_simd_mul(fscal_S,dx23_S);
+                ty_S             = gmx_simd_mul(fscal_S,dy23_S);
+                tz_S             = gmx_simd_mul(fscal_S,dz23_S);
+                fix2_S           = gmx_simd_add(fix2_S,tx_S);
+                fiy2_S           = gmx_simd_add(fiy2_S,ty_S);
+                fiz2_S           = gmx_simd_add(fiz2_S,tz_S);
+                fjx3_S           = tx_S;           
+                fjy3_S           = ty_S;           
+                fjz3_S           = tz_S;           
+                qq_S             = qqMH_S;         
+                rinvsq_S         = gmx_simd_mul(rinv24_S,rinv24_S);
+                krsq_S           = gmx_simd_mul(krf_S,rsq24_S);
+                vcoul_S          = gmx_simd_mul(qq_S,gmx_simd_sub(gmx_simd_add(rinv24_S,krsq_S),crf_S));
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                fscal_S          = gmx_simd_mul(gmx_simd_mul(qq_S,gmx_simd_sub(rinv24_S,gmx_simd_mul(gmx_simd_set1(2.0),krsq_S))),rinvsq_S);
+                fscal_S          = gmx_simd_and(fscal_S,mask_S);
+                tx_S             = gmx_simd_mul(fscal_S,dx24_S);
+                ty_S             = gmx_simd_mul(fscal_S,dy24_S);
+                tz_S             = gmx_simd_mul(fscal_S,dz24_S);
+                fix2_S           = gmx_simd_add(fix2_S,tx_S);
+                fiy2_S           = gmx_simd_add(fiy2_S,ty_S);
+                fiz2_S           = gmx_simd_add(fiz2_S,tz_S);
+                fjx4_S           = tx_S;           
+                fjy4_S           = ty_S;           
+                fjz4_S           = tz_S;           
+                qq_S             = qqHH_S;         
+                rinvsq_S         = gmx_simd_mul(rinv32_S,rinv32_S);
+                krsq_S           = gmx_simd_mul(krf_S,rsq32_S);
+                vcoul_S          = gmx_simd_mul(qq_S,gmx_simd_sub(gmx_simd_add(rinv32_S,krsq_S),crf_S));
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                fscal_S          = gmx_simd_mul(gmx_simd_mul(qq_S,gmx_simd_sub(rinv32_S,gmx_simd_mul(gmx_simd_set1(2.0),krsq_S))),rinvsq_S);
+                fscal_S          = gmx_simd_and(fscal_S,mask_S);
+                tx_S             = gmx_simd_mul(fscal_S,dx32_S);
+                ty_S             = gmx_simd_mul(fscal_S,dy32_S);
+                tz_S             = gmx_simd_mul(fscal_S,dz32_S);
+                fix3_S           = gmx_simd_add(fix3_S,tx_S);
+                fiy3_S           = gmx_simd_add(fiy3_S,ty_S);
+                fiz3_S           = gmx_simd_add(fiz3_S,tz_S);
+                fjx2_S           = gmx_simd_add(fjx2_S,tx_S);
+                fjy2_S           = gmx_simd_add(fjy2_S,ty_S);
+                fjz2_S           = gmx_simd_add(fjz2_S,tz_S);
+                qq_S             = qqHH_S;         
+                rinvsq_S         = gmx_simd_mul(rinv33_S,rinv33_S);
+                krsq_S           = gmx_simd_mul(krf_S,rsq33_S);
+                vcoul_S          = gmx_simd_mul(qq_S,gmx_simd_sub(gmx_simd_add(rinv33_S,krsq_S),crf_S));
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                fscal_S          = gmx_simd_mul(gmx_simd_mul(qq_S,gmx_simd_sub(rinv33_S,gmx_simd_mul(gmx_simd_set1(2.0),krsq_S))),rinvsq_S);
+                fscal_S          = gmx_simd_and(fscal_S,mask_S);
+                tx_S             = gmx_simd_mul(fscal_S,dx33_S);
+                ty_S             = gmx_simd_mul(fscal_S,dy33_S);
+                tz_S             = gmx_simd_mul(fscal_S,dz33_S);
+                fix3_S           = gmx_simd_add(fix3_S,tx_S);
+                fiy3_S           = gmx_simd_add(fiy3_S,ty_S);
+                fiz3_S           = gmx_simd_add(fiz3_S,tz_S);
+                fjx3_S           = gmx_simd_add(fjx3_S,tx_S);
+                fjy3_S           = gmx_simd_add(fjy3_S,ty_S);
+                fjz3_S           = gmx_simd_add(fjz3_S,tz_S);
+                qq_S             = qqMH_S;         
+                rinvsq_S         = gmx_simd_mul(rinv34_S,rinv34_S);
+                krsq_S           = gmx_simd_mul(krf_S,rsq34_S);
+                vcoul_S          = gmx_simd_mul(qq_S,gmx_simd_sub(gmx_simd_add(rinv34_S,krsq_S),crf_S));
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                fscal_S          = gmx_simd_mul(gmx_simd_mul(qq_S,gmx_simd_sub(rinv34_S,gmx_simd_mul(gmx_simd_set1(2.0),krsq_S))),rinvsq_S);
+                fscal_S          = gmx_simd_and(fscal_S,mask_S);
+                tx_S             = gmx_simd_mul(fscal_S,dx34_S);
+                ty_S             = gmx_simd_mul(fscal_S,dy34_S);
+                tz_S             = gmx_simd_mul(fscal_S,dz34_S);
+                fix3_S           = gmx_simd_add(fix3_S,tx_S);
+                fiy3_S           = gmx_simd_add(fiy3_S,ty_S);
+                fiz3_S           = gmx_simd_add(fiz3_S,tz_S);
+                fjx4_S           = gmx_simd_add(fjx4_S,tx_S);
+                fjy4_S           = gmx_simd_add(fjy4_S,ty_S);
+                fjz4_S           = gmx_simd_add(fjz4_S,tz_S);
+                qq_S             = qqMH_S;         
+                rinvsq_S         = gmx_simd_mul(rinv42_S,rinv42_S);
+                krsq_S           = gmx_simd_mul(krf_S,rsq42_S);
+                vcoul_S          = gmx_simd_mul(qq_S,gmx_simd_sub(gmx_simd_add(rinv42_S,krsq_S),crf_S));
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                fscal_S          = gmx_simd_mul(gmx_simd_mul(qq_S,gmx_simd_sub(rinv42_S,gmx_simd_mul(gmx_simd_set1(2.0),krsq_S))),rinvsq_S);
+                fscal_S          = gmx_simd_and(fscal_S,mask_S);
+                tx_S             = gmx_simd_mul(fscal_S,dx42_S);
+                ty_S             = gmx_simd_mul(fscal_S,dy42_S);
+                tz_S             = gmx_simd_mul(fscal_S,dz42_S);
+                fix4_S           = gmx_simd_add(fix4_S,tx_S);
+                fiy4_S           = gmx_simd_add(fiy4_S,ty_S);
+                fiz4_S           = gmx_simd_add(fiz4_S,tz_S);
+                fjx2_S           = gmx_simd_add(fjx2_S,tx_S);
+                fjy2_S           = gmx_simd_add(fjy2_S,ty_S);
+                fjz2_S           = gmx_simd_add(fjz2_S,tz_S);
+                gmx_simd_decrement_rvec(faction+3,j3,nvalid,fjx2_S,fjy2_S,fjz2_S);
+                qq_S             = qqMH_S;         
+                rinvsq_S         = gmx_simd_mul(rinv43_S,rinv43_S);
+                krsq_S           = gmx_simd_mul(krf_S,rsq43_S);
+                vcoul_S          = gmx_simd_mul(qq_S,gmx_simd_sub(gmx_simd_add(rinv43_S,krsq_S),crf_S));
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                fscal_S          = gmx_simd_mul(gmx_simd_mul(qq_S,gmx_simd_sub(rinv43_S,gmx_simd_mul(gmx_simd_set1(2.0),krsq_S))),rinvsq_S);
+                fscal_S          = gmx_simd_and(fscal_S,mask_S);
+                tx_S             = gmx_simd_mul(fscal_S,dx43_S);
+                ty_S             = gmx_simd_mul(fscal_S,dy43_S);
+                tz_S             = gmx_simd_mul(fscal_S,dz43_S);
+                fix4_S           = gmx_simd_add(fix4_S,tx_S);
+                fiy4_S           = gmx_simd_add(fiy4_S,ty_S);
+                fiz4_S           = gmx_simd_add(fiz4_S,tz_S);
+                fjx3_S           = gmx_simd_add(fjx3_S,tx_S);
+                fjy3_S           = gmx_simd_add(fjy3_S,ty_S);
+                fjz3_S           = gmx_simd_add(fjz3_S,tz_S);
+                gmx_simd_decrement_rvec(faction+6,j3,nvalid,fjx3_S,fjy3_S,fjz3_S);
+                qq_S             = qqMM_S;         
+                rinvsq_S         = gmx_simd_mul(rinv44_S,rinv44_S);
+                krsq_S           = gmx_simd_mul(krf_S,rsq44_S);
+                vcoul_S          = gmx_simd_mul(qq_S,gmx_simd_sub(gmx_simd_add(rinv44_S,krsq_S),crf_S));
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                fscal_S          = gmx_simd_mul(gmx_simd_mul(qq_S,gmx_simd_sub(rinv44_S,gmx_simd_mul(gmx_simd_set1(2.0),krsq_S))),rinvsq_S);
+                fscal_S          = gmx_simd_and(fscal_S,mask_S);
+                tx_S             = gmx_simd_mul(fscal_S,dx44_S);
+                ty_S             = gmx_simd_mul(fscal_S,dy44_S);
+                tz_S             = gmx_simd_mul(fscal_S,dz44_S);
+                fix4_S           = gmx_simd_add(fix4_S,tx_S);
+                fiy4_S           = gmx_simd_add(fiy4_S,ty_S);
+                fiz4_S           = gmx_simd_add(fiz4_S,tz_S);
+                fjx4_S           = gmx_simd_add(fjx4_S,tx_S);
+                fjy4_S           = gmx_simd_add(fjy4_S,ty_S);
+                fjz4_S           = gmx_simd_add(fjz4_S,tz_S);
+                gmx_simd_decrement_rvec(faction+9,j3,nvalid,fjx4_S,fjy4_S,fjz4_S);
+            }
+            
+            fix2             = gmx_simd_reduce(fix2_S);
+            fiy2             = gmx_simd_reduce(fiy2_S);
+            fiz2             = gmx_simd_reduce(fiz2_S);
+            fix3             = gmx_simd_reduce(fix3_S);
+            fiy3             = gmx_simd_reduce(fiy3_S);
+            fiz3             = gmx_simd_reduce(fiz3_S);
+            fix4             = gmx_simd_reduce(fix4_S);
+            fiy4             = gmx_simd_reduce(fiy4_S);
+            fiz4             = gmx_simd_reduce(fiz4_S);
+            vctot            = gmx_simd_reduce(vctot_S);
+            faction[ii3+3]   = faction[ii3+3] + fix2;
+            faction[ii3+4]   = faction[ii3+4] + fiy2;
+            faction[ii3+5]   = faction[ii3+5] + fiz2;
+            faction[ii3+6]   = faction[ii3+6] + fix3;
+            faction[ii3+7]   = faction[ii3+7] + fiy3;
+            faction[ii3+8]   = faction[ii3+8] + fiz3;
+            faction[ii3+9]   = faction[ii3+9] + fix4;
+            faction[ii3+10]  = faction[ii3+10] + fiy4;
+            faction[ii3+11]  = faction[ii3+11] + fiz4;
+            fshift[is3]      = fshift[is3]+fix2+fix3+fix4;
+            fshift[is3+1]    = fshift[is3+1]+fiy2+fiy3+fiy4;
+            fshift[is3+2]    = fshift[is3+2]+fiz2+fiz3+fiz4;
+            ggid             = gid[n];         
+            Vc[ggid]         = Vc[ggid] + vctot;
+            ninner           = ninner + nj1 - nj0;
+        }
+        
+        nouter           = nouter + nn1 - nn0;
+    }
+    while (nn1<nri);
+    
+    *outeriter       = nouter;         
+    *inneriter       = ninner;         
+}
+
+
+
+
+
+/*
+ * Gromacs nonbonded kernel GMX_SIMD_NAME(nb_kernel204nf)
+ * Coulomb interaction:     Reaction field
+ * VdW interaction:         Not calculated
+ * water optimization:      pairs of TIP4P interactions
+ * Calculate forces:        no
+ */
+void GMX_SIMD_NAME(nb_kernel204nf)(
+                    int *           p_nri,
+                    int *           iinr,
+                    int *           jindex,
+                    int *           jjnr,
+                    int *           shift,
+                    real *          shiftvec,
+                    real *          fshift,
+                    int *           gid,
+                    real *          pos,
+                    real *          faction,
+                    real *          charge,
+                    real *          p_facel,
+                    real *          p_krf,
+                    real *          p_crf,
+                    real *          Vc,
+                    int *           type,
+                    int *           p_ntype,
+                    real *          vdwparam,
+                    real *          Vvdw,
+                    real *          p_tabscale,
+                    real *          VFtab,
+                    real *          enerd1,
+                    real *          enerd2,
+                    real *          enerd3,
+                    real *          enerd4,
+                    int *           start,
+                    int *           end,
+                    int *           homenr,
+                    int *           nbsum,
+                    real *          invsqrta,
+                    real *          dvda,
+                    real *          p_gbtabscale,
+                    real *          GBtab,
+                    int *           p_nthreads,
+                    int *           count,
+                    void *          mtx,
+                    int *           outeriter,
+                    int *           inneriter,
+                    real *          work)
+{
+    int           nri,ntype,nthreads;
+    real          facel,krf,crf,tabscale,gbtabscale;
+    int           n,ii,is3,ii3,k,nj0,nj1,ggid,nvalid;
+    int           jnr[GMX_SIMD_WIDTH],j3[GMX_SIMD_WIDTH];
+    int           nn0,nn1,nouter,ninner;
+    real          shX,shY,shZ;
+    gmx_simd_real_t mask_S;
+    real          vctot;
+    real          qH,qM,qqMM,qqMH,qqHH;
+    gmx_simd_real_t qqMM_S,qqMH_S,qqHH_S;
+    gmx_simd_real_t qq_S,vcoul_S,vctot_S;
+    gmx_simd_real_t krf_S,crf_S,krsq_S;
+    real          ix2,iy2,iz2;
+    gmx_simd_real_t ix2_S,iy2_S,iz2_S;
+    real          ix3,iy3,iz3;
+    gmx_simd_real_t ix3_S,iy3_S,iz3_S;
+    real          ix4,iy4,iz4;
+    gmx_simd_real_t ix4_S,iy4_S,iz4_S;
+    gmx_simd_real_t jx2_S,jy2_S,jz2_S;
+    gmx_simd_real_t jx3_S,jy3_S,jz3_S;
+    gmx_simd_real_t jx4_S,jy4_S,jz4_S;
+    gmx_simd_real_t dx22_S,dy22_S,dz22_S,rsq22_S,rinv22_S;
+    gmx_simd_real_t dx23_S,dy23_S,dz23_S,rsq23_S,rinv23_S;
+    gmx_simd_real_t dx24_S,dy24_S,dz24_S,rsq24_S,rinv24_S;
+    gmx_simd_real_t dx32_S,dy32_S,dz32_S,rsq32_S,rinv32_S;
+    gmx_simd_real_t dx33_S,dy33_S,dz33_S,rsq33_S,rinv33_S;
+    gmx_simd_real_t dx34_S,dy34_S,dz34_S,rsq34_S,rinv34_S;
+    gmx_simd_real_t dx42_S,dy42_S,dz42_S,rsq42_S,rinv42_S;
+    gmx_simd_real_t dx43_S,dy43_S,dz43_S,rsq43_S,rinv43_S;
+    gmx_simd_real_t dx44_S,dy44_S,dz44_S,rsq44_S,rinv44_S;
+
+    nri              = *p_nri;         
+    ntype            = *p_ntype;       
+    nthreads         = *p_nthreads;    
+    facel            = *p_facel;       
+    krf              = *p_krf;         
+    crf              = *p_crf;         
+    tabscale         = *p_tabscale;    
+    ii               = iinr[0];        
+    qH               = charge[ii+1];   
+    qM               = charge[ii+3];   
+    qqMM             = facel*qM*qM;    
+    qqMH             = facel*qM*qH;    
+    qqHH             = facel*qH*qH;    
+
+    krf_S            = gmx_simd_set1(krf);
+    crf_S            = gmx_simd_set1(crf);
+    qqMM_S           = gmx_simd_set1(qqMM);
+    qqMH_S           = gmx_simd_set1(qqMH);
+    qqHH_S           = gmx_simd_set1(qqHH);
+    nouter           = 0;              
+    ninner           = 0;              
+    
+    do
+    {
+#ifdef GMX_THREADS
+        gmx_thread_mutex_lock((gmx_thread_mutex_t *)mtx);
+        nn0              = *count;         
+        nn1              = nn0+(nri-nn0)/(2*nthreads)+10;
+        *count           = nn1;            
+        gmx_thread_mutex_unlock((gmx_thread_mutex_t *)mtx);
+        if(nn1>nri) nn1=nri;
+#else
+        nn0              = 0;              
+        nn1              = nri;            
+#endif
+        
+        for(n=nn0; (n<nn1); n++)
+        {
+            is3              = 3*shift[n];     
+            shX              = shiftvec[is3];  
+            shY              = shiftvec[is3+1];
+            shZ              = shiftvec[is3+2];
+            nj0              = jindex[n];      
+            nj1              = jindex[n+1];    
+            ii               = iinr[n];        
+            ii3              = 3*ii;           
+            ix2              = shX + pos[ii3+3];
+            iy2              = shY + pos[ii3+4];
+            iz2              = shZ + pos[ii3+5];
+            ix3              = shX + pos[ii3+6];
+            iy3              = shY + pos[ii3+7];
+            iz3              = shZ + pos[ii3+8];
+            ix4              = shX + pos[ii3+9];
+            iy4              = shY + pos[ii3+10];
+            iz4              = shZ + pos[ii3+11];
+            ix2_S            = gmx_simd_set1(ix2);
+            iy2_S            = gmx_simd_set1(iy2);
+            iz2_S            = gmx_simd_set1(iz2);
+            ix3_S            = gmx_simd_set1(ix3);
+            iy3_S            = gmx_simd_set1(iy3);
+            iz3_S            = gmx_simd_set1(iz3);
+            ix4_S            = gmx_simd_set1(ix4);
+            iy4_S            = gmx_simd_set1(iy4);
+            iz4_S            = gmx_simd_set1(iz4);
+            vctot_S          = gmx_simd_setzero();
+            
+            for(k=nj0; (k<nj1); k+=GMX_SIMD_WIDTH)
+            {
+                nvalid           = gmx_simd_load_jindex(jjnr+k,nj1-k,jnr,j3,&mask_S);
+                gmx_simd_gather_rvec(pos+3,j3,&jx2_S,&jy2_S,&jz2_S);
+                gmx_simd_gather_rvec(pos+6,j3,&jx3_S,&jy3_S,&jz3_S);
+                gmx_simd_gather_rvec(pos+9,j3,&jx4_S,&jy4_S,&jz4_S);
+                dx22_S           = gmx_simd_sub(ix2_S,jx2_S);
+                dy22_S           = gmx_simd_sub(iy2_S,jy2_S);
+                dz22_S           = gmx_simd_sub(iz2_S,jz2_S);
+                rsq22_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx22_S,dx22_S),gmx_simd_mul(dy22_S,dy22_S)),gmx_simd_mul(dz22_S,dz22_S));
+                dx23_S           = gmx_simd_sub(ix2_S,jx3_S);
+                dy23_S           = gmx_simd_sub(iy2_S,jy3_S);
+                dz23_S           = gmx_simd_sub(iz2_S,jz3_S);
+                rsq23_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx23_S,dx23_S),gmx_simd_mul(dy23_S,dy23_S)),gmx_simd_mul(dz23_S,dz23_S));
+                dx24_S           = gmx_simd_sub(ix2_S,jx4_S);
+                dy24_S           = gmx_simd_sub(iy2_S,jy4_S);
+                dz24_S           = gmx_simd_sub(iz2_S,jz4_S);
+                rsq24_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx24_S,dx24_S),gmx_simd_mul(dy24_S,dy24_S)),gmx_simd_mul(dz24_S,dz24_S));
+                dx32_S           = gmx_simd_sub(ix3_S,jx2_S);
+                dy32_S           = gmx_simd_sub(iy3_S,jy2_S);
+                dz32_S           = gmx_simd_sub(iz3_S,jz2_S);
+                rsq32_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx32_S,dx32_S),gmx_simd_mul(dy32_S,dy32_S)),gmx_simd_mul(dz32_S,dz32_S));
+                dx33_S           = gmx_simd_sub(ix3_S,jx3_S);
+                dy33_S           = gmx_simd_sub(iy3_S,jy3_S);
+                dz33_S           = gmx_simd_sub(iz3_S,jz3_S);
+                rsq33_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx33_S,dx33_S),gmx_simd_mul(dy33_S,dy33_S)),gmx_simd_mul(dz33_S,dz33_S));
+                dx34_S           = gmx_simd_sub(ix3_S,jx4_S);
+                dy34_S           = gmx_simd_sub(iy3_S,jy4_S);
+                dz34_S           = gmx_simd_sub(iz3_S,jz4_S);
+                rsq34_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx34_S,dx34_S),gmx_simd_mul(dy34_S,dy34_S)),gmx_simd_mul(dz34_S,dz34_S));
+                dx42_S           = gmx_simd_sub(ix4_S,jx2_S);
+                dy42_S           = gmx_simd_sub(iy4_S,jy2_S);
+                dz42_S           = gmx_simd_sub(iz4_S,jz2_S);
+                rsq42_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx42_S,dx42_S),gmx_simd_mul(dy42_S,dy42_S)),gmx_simd_mul(dz42_S,dz42_S));
+                dx43_S           = gmx_simd_sub(ix4_S,jx3_S);
+                dy43_S           = gmx_simd_sub(iy4_S,jy3_S);
+                dz43_S           = gmx_simd_sub(iz4_S,jz3_S);
+                rsq43_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx43_S,dx43_S),gmx_simd_mul(dy43_S,dy43_S)),gmx_simd_mul(dz43_S,dz43_S));
+                dx44_S           = gmx_simd_sub(ix4_S,jx4_S);
+                dy44_S           = gmx_simd_sub(iy4_S,jy4_S);
+                dz44_S           = gmx_simd_sub(iz4_S,jz4_S);
+                rsq44_S          = gmx_simd_add(gmx_simd_add(gmx_simd_mul(dx44_S,dx44_S),gmx_simd_mul(dy44_S,dy44_S)),gmx_simd_mul(dz44_S,dz44_S));
+                rinv22_S         = gmx_simd_invsqrt(rsq22_S);
+                rinv23_S         = gmx_simd_invsqrt(rsq23_S);
+                rinv24_S         = gmx_simd_invsqrt(rsq24_S);
+                rinv32_S         = gmx_simd_invsqrt(rsq32_S);
+                rinv33_S         = gmx_simd_invsqrt(rsq33_S);
+                rinv34_S         = gmx_simd_invsqrt(rsq34_S);
+                rinv42_S         = gmx_simd_invsqrt(rsq42_S);
+                rinv43_S         = gmx_simd_invsqrt(rsq43_S);
+                rinv44_S         = gmx_simd_invsqrt(rsq44_S);
+                qq_S             = qqHH_S;         
+                krsq_S           = gmx_simd_mul(krf_S,rsq22_S);
+                vcoul_S          = gmx_simd_mul(qq_S,gmx_simd_sub(gmx_simd_add(rinv22_S,krsq_S),crf_S));
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                qq_S             = qqHH_S;         
+                krsq_S           = gmx_simd_mul(krf_S,rsq23_S);
+                vcoul_S          = gmx_simd_mul(qq_S,gmx_simd_sub(gmx_simd_add(rinv23_S,krsq_S),crf_S));
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                qq_S             = qqMH_S;         
+                krsq_S           = gmx_simd_mul(krf_S,rsq24_S);
+                vcoul_S          = gmx_simd_mul(qq_S,gmx_simd_sub(gmx_simd_add(rinv24_S,krsq_S),crf_S));
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                qq_S             = qqHH_S;         
+                krsq_S           = gmx_simd_mul(krf_S,rsq32_S);
+                vcoul_S          = gmx_simd_mul(qq_S,gmx_simd_sub(gmx_simd_add(rinv32_S,krsq_S),crf_S));
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                qq_S             = qqHH_S;         
+                krsq_S           = gmx_simd_mul(krf_S,rsq33_S);
+                vcoul_S          = gmx_simd_mul(qq_S,gmx_simd_sub(gmx_simd_add(rinv33_S,krsq_S),crf_S));
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                qq_S             = qqMH_S;         
+                krsq_S           = gmx_simd_mul(krf_S,rsq34_S);
+                vcoul_S          = gmx_simd_mul(qq_S,gmx_simd_sub(gmx_simd_add(rinv34_S,krsq_S),crf_S));
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                qq_S             = qqMH_S;         
+                krsq_S           = gmx_simd_mul(krf_S,rsq42_S);
+                vcoul_S          = gmx_simd_mul(qq_S,gmx_simd_sub(gmx_simd_add(rinv42_S,krsq_S),crf_S));
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                qq_S             = qqMH_S;         
+                krsq_S           = gmx_simd_mul(krf_S,rsq43_S);
+                vcoul_S          = gmx_simd_mul(qq_S,gmx_simd_sub(gmx_simd_add(rinv43_S,krsq_S),crf_S));
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+                qq_S             = qqMM_S;         
+                krsq_S           = gmx_simd_mul(krf_S,rsq44_S);
+                vcoul_S          = gmx_simd_mul(qq_S,gmx_simd_sub(gmx_simd_add(rinv44_S,krsq_S),crf_S));
+                vcoul_S          = gmx_simd_and(vcoul_S,mask_S);
+                vctot_S          = gmx_simd_add(vctot_S,vcoul_S);
+            }
+            
+            vctot            = gmx_simd_reduce(vctot_S);
+            ggid             = gid[n];         
+            Vc[ggid]         = Vc[ggid] + vctot;
+            ninner           = ninner + nj1 - nj0;
+        }
+        
+        nouter           = nouter + nn1 - nn0;
+    }
+    while (nn1<nri);
+    
+    *outeriter       = nouter;         
+    *inneriter       = ninner;         
+}
+
+
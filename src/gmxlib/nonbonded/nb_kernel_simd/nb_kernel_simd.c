@@ -0,0 +1,364 @@
+/*
+ *                This source code is part of
+ *
+ *                 G   R   O   M   A   C   S
+ *
+ * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
+ * Copyright (c) 2001-2009, The GROMACS Development Team
+ *
+ * Gromacs is a library for molecular simulation and trajectory analysis,
+ * written by Erik Lindahl, David van der Spoel, Berk Hess, and others - for
+ * a full list of developers and information, check out http://www.gromacs.org
+ *
+ * This program is free software; you can redistribute it and/or modify it under 
+ * the terms of the GNU Lesser General Public License as published by the Free 
+ * Software Foundation; either version 2 of the License, or (at your option) any 
+ * later version.
+ * As a special exception, you may use this file as part of a free software
+ * library without restriction.  Specifically, if other files instantiate
+ * templates or use macros or inline functions from this file, or you compile
+ * this file and link it with other files to produce an executable, this
+ * file does not by itself cause the resulting executable to be covered by
+ * the GNU Lesser General Public License.  
+ *
+ * In plain-speak: do not worry about classes/macros/templates either - only
+ * changes to the library have to be LGPL, not an application linking with it.
+ *
+ * To help fund GROMACS development, we humbly ask that you cite
+ * the papers people have written on it - you can find them on the website!
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+
+#ifdef _MSC_VER
+/* MSVC definition for __cpuid() */
+#include <intrin.h>
+#endif
+
+#include "types/nrnb.h"
+#include "nb_kernel_simd.h"
+
+
+/* The kernels are in the same order as the C kernels in
+ * nb_kernel_c/nb_kernel_c.c. There are no SIMD versions of the
+ * generalized Born kernels, which accumulate the polarization energy
+ * through the work array, so these are left to the C or SSE2 kernels.
+ */
+static nb_kernel_t *
+kernellist_simd[eNR_NBKERNEL_NR] = 
+{
+    GMX_SIMD_NAME(nb_kernel010),
+    GMX_SIMD_NAME(nb_kernel020),
+    GMX_SIMD_NAME(nb_kernel030),
+    GMX_SIMD_NAME(nb_kernel100),
+    GMX_SIMD_NAME(nb_kernel101),
+    GMX_SIMD_NAME(nb_kernel102),
+    GMX_SIMD_NAME(nb_kernel103),
+    GMX_SIMD_NAME(nb_kernel104),
+    GMX_SIMD_NAME(nb_kernel110),
+    GMX_SIMD_NAME(nb_kernel111),
+    GMX_SIMD_NAME(nb_kernel112),
+    GMX_SIMD_NAME(nb_kernel113),
+    GMX_SIMD_NAME(nb_kernel114),
+    GMX_SIMD_NAME(nb_kernel120),
+    GMX_SIMD_NAME(nb_kernel121),
+    GMX_SIMD_NAME(nb_kernel122),
+    GMX_SIMD_NAME(nb_kernel123),
+    GMX_SIMD_NAME(nb_kernel124),
+    GMX_SIMD_NAME(nb_kernel130),
+    GMX_SIMD_NAME(nb_kernel131),
+    GMX_SIMD_NAME(nb_kernel132),
+    GMX_SIMD_NAME(nb_kernel133),
+    GMX_SIMD_NAME(nb_kernel134),
+    GMX_SIMD_NAME(nb_kernel200),
+    GMX_SIMD_NAME(nb_kernel201),
+    GMX_SIMD_NAME(nb_kernel202),
+    GMX_SIMD_NAME(nb_kernel203),
+    GMX_SIMD_NAME(nb_kernel204),
+    GMX_SIMD_NAME(nb_kernel210),
+    GMX_SIMD_NAME(nb_kernel211),
+    GMX_SIMD_NAME(nb_kernel212),
+    GMX_SIMD_NAME(nb_kernel213),
+    GMX_SIMD_NAME(nb_kernel214),
+    GMX_SIMD_NAME(nb_kernel220),
+    GMX_SIMD_NAME(nb_kernel221),
+    GMX_SIMD_NAME(nb_kernel222),
+    GMX_SIMD_NAME(nb_kernel223),
+    GMX_SIMD_NAME(nb_kernel224),
+    GMX_SIMD_NAME(nb_kernel230),
+    GMX_SIMD_NAME(nb_kernel231),
+    GMX_SIMD_NAME(nb_kernel232),
+    GMX_SIMD_NAME(nb_kernel233),
+    GMX_SIMD_NAME(nb_kernel234),
+    GMX_SIMD_NAME(nb_kernel300),
+    GMX_SIMD_NAME(nb_kernel301),
+    GMX_SIMD_NAME(nb_kernel302),
+    GMX_SIMD_NAME(nb_kernel303),
+    GMX_SIMD_NAME(nb_kernel304),
+    GMX_SIMD_NAME(nb_kernel310),
+    GMX_SIMD_NAME(nb_kernel311),
+    GMX_SIMD_NAME(nb_kernel312),
+    GMX_SIMD_NAME(nb_kernel313),
+    GMX_SIMD_NAME(nb_kernel314),
+    GMX_SIMD_NAME(nb_kernel320),
+    GMX_SIMD_NAME(nb_kernel321),
+    GMX_SIMD_NAME(nb_kernel322),
+    GMX_SIMD_NAME(nb_kernel323),
+    GMX_SIMD_NAME(nb_kernel324),
+    GMX_SIMD_NAME(nb_kernel330),
+    GMX_SIMD_NAME(nb_kernel331),
+    GMX_SIMD_NAME(nb_kernel332),
+    GMX_SIMD_NAME(nb_kernel333),
+    GMX_SIMD_NAME(nb_kernel334),
+    NULL,
+    NULL,
+    NULL,
+    GMX_SIMD_NAME(nb_kernel010nf),
+    GMX_SIMD_NAME(nb_kernel020nf),
+    GMX_SIMD_NAME(nb_kernel030nf),
+    GMX_SIMD_NAME(nb_kernel100nf),
+    GMX_SIMD_NAME(nb_kernel101nf),
+    GMX_SIMD_NAME(nb_kernel102nf),
+    GMX_SIMD_NAME(nb_kernel103nf),
+    GMX_SIMD_NAME(nb_kernel104nf),
+    GMX_SIMD_NAME(nb_kernel110nf),
+    GMX_SIMD_NAME(nb_kernel111nf),
+    GMX_SIMD_NAME(nb_kernel112nf),
+    GMX_SIMD_NAME(nb_kernel113nf),
+    GMX_SIMD_NAME(nb_kernel114nf),
+    GMX_SIMD_NAME(nb_kernel120nf),
+    GMX_SIMD_NAME(nb_kernel121nf),
+    GMX_SIMD_NAME(nb_kernel122nf),
+    GMX_SIMD_NAME(nb_kernel123nf),
+    GMX_SIMD_NAME(nb_kernel124nf),
+    GMX_SIMD_NAME(nb_kernel130nf),
+    GMX_SIMD_NAME(nb_kernel131nf),
+    GMX_SIMD_NAME(nb_kernel132nf),
+    GMX_SIMD_NAME(nb_kernel133nf),
+    GMX_SIMD_NAME(nb_kernel134nf),
+    GMX_SIMD_NAME(nb_kernel200nf),
+    GMX_SIMD_NAME(nb_kernel201nf),
+    GMX_SIMD_NAME(nb_kernel202nf),
+    GMX_SIMD_NAME(nb_kernel203nf),
+    GMX_SIMD_NAME(nb_kernel204nf),
+    GMX_SIMD_NAME(nb_kernel210nf),
+    GMX_SIMD_NAME(nb_kernel211nf),
+    GMX_SIMD_NAME(nb_kernel212nf),
+    GMX_SIMD_NAME(nb_kernel213nf),
+    GMX_SIMD_NAME(nb_kernel214nf),
+    GMX_SIMD_NAME(nb_kernel220nf),
+    GMX_SIMD_NAME(nb_kernel221nf),
+    GMX_SIMD_NAME(nb_kernel222nf),
+    GMX_SIMD_NAME(nb_kernel223nf),
+    GMX_SIMD_NAME(nb_kernel224nf),
+    GMX_SIMD_NAME(nb_kernel230nf),
+    GMX_SIMD_NAME(nb_kernel231nf),
+    GMX_SIMD_NAME(nb_kernel232nf),
+    GMX_SIMD_NAME(nb_kernel233nf),
+    GMX_SIMD_NAME(nb_kernel234nf),
+    GMX_SIMD_NAME(nb_kernel300nf),
+    GMX_SIMD_NAME(nb_kernel301nf),
+    GMX_SIMD_NAME(nb_kernel302nf),
+    GMX_SIMD_NAME(nb_kernel303nf),
+    GMX_SIMD_NAME(nb_kernel304nf),
+    GMX_SIMD_NAME(nb_kernel310nf),
+    GMX_SIMD_NAME(nb_kernel311nf),
+    GMX_SIMD_NAME(nb_kernel312nf),
+    GMX_SIMD_NAME(nb_kernel313nf),
+    GMX_SIMD_NAME(nb_kernel314nf),
+    GMX_SIMD_NAME(nb_kernel320nf),
+    GMX_SIMD_NAME(nb_kernel321nf),
+    GMX_SIMD_NAME(nb_kernel322nf),
+    GMX_SIMD_NAME(nb_kernel323nf),
+    GMX_SIMD_NAME(nb_kernel324nf),
+    GMX_SIMD_NAME(nb_kernel330nf),
+    GMX_SIMD_NAME(nb_kernel331nf),
+    GMX_SIMD_NAME(nb_kernel332nf),
+    GMX_SIMD_NAME(nb_kernel333nf),
+    GMX_SIMD_NAME(nb_kernel334nf),
+    NULL,
+    NULL,
+    NULL
+};
+
+
+/* The analytical Ewald kernels, in the order of the 300-334
+ * kernels with forces followed by those without.
+ */
+#define NB_KERNEL_SIMD_EWALD_NR 20
+
+static nb_kernel_t *
+kernellist_simd_ewald[2*NB_KERNEL_SIMD_EWALD_NR] =
+{
+    GMX_SIMD_NAME(nb_kernel500),
+    GMX_SIMD_NAME(nb_kernel501),
+    GMX_SIMD_NAME(nb_kernel502),
+    GMX_SIMD_NAME(nb_kernel503),
+    GMX_SIMD_NAME(nb_kernel504),
+    GMX_SIMD_NAME(nb_kernel510),
+    GMX_SIMD_NAME(nb_kernel511),
+    GMX_SIMD_NAME(nb_kernel512),
+    GMX_SIMD_NAME(nb_kernel513),
+    GMX_SIMD_NAME(nb_kernel514),
+    GMX_SIMD_NAME(nb_kernel520),
+    GMX_SIMD_NAME(nb_kernel521),
+    GMX_SIMD_NAME(nb_kernel522),
+    GMX_SIMD_NAME(nb_kernel523),
+    GMX_SIMD_NAME(nb_kernel524),
+    GMX_SIMD_NAME(nb_kernel530),
+    GMX_SIMD_NAME(nb_kernel531),
+    GMX_SIMD_NAME(nb_kernel532),
+    GMX_SIMD_NAME(nb_kernel533),
+    GMX_SIMD_NAME(nb_kernel534),
+    GMX_SIMD_NAME(nb_kernel500nf),
+    GMX_SIMD_NAME(nb_kernel501nf),
+    GMX_SIMD_NAME(nb_kernel502nf),
+    GMX_SIMD_NAME(nb_kernel503nf),
+    GMX_SIMD_NAME(nb_kernel504nf),
+    GMX_SIMD_NAME(nb_kernel510nf),
+    GMX_SIMD_NAME(nb_kernel511nf),
+    GMX_SIMD_NAME(nb_kernel512nf),
+    GMX_SIMD_NAME(nb_kernel513nf),
+    GMX_SIMD_NAME(nb_kernel514nf),
+    GMX_SIMD_NAME(nb_kernel520nf),
+    GMX_SIMD_NAME(nb_kernel521nf),
+    GMX_SIMD_NAME(nb_kernel522nf),
+    GMX_SIMD_NAME(nb_kernel523nf),
+    GMX_SIMD_NAME(nb_kernel524nf),
+    GMX_SIMD_NAME(nb_kernel530nf),
+    GMX_SIMD_NAME(nb_kernel531nf),
+    GMX_SIMD_NAME(nb_kernel532nf),
+    GMX_SIMD_NAME(nb_kernel533nf),
+    GMX_SIMD_NAME(nb_kernel534nf)
+};
+
+static void
+simd_cpuid(unsigned int level,unsigned int *eax,unsigned int *ebx,
+           unsigned int *ecx,unsigned int *edx)
+{
+#ifdef _MSC_VER
+	int CPUInfo[4];
+
+	__cpuid(CPUInfo,level);
+	*eax = CPUInfo[0];
+	*ebx = CPUInfo[1];
+	*ecx = CPUInfo[2];
+	*edx = CPUInfo[3];
+#elif defined(__x86_64__)
+	/* GCC 64-bit inline asm */
+	__asm__ ("push %%rbx\n\tcpuid\n\tpop %%rbx\n"                 \
+			 : "=a" (*eax), "=S" (*ebx), "=c" (*ecx), "=d" (*edx) \
+			 : "0" (level));
+#elif defined(__i386__)
+	__asm__ ("push %%ebx\n\tcpuid\n\tpop %%ebx\n"                 \
+			 : "=a" (*eax), "=S" (*ebx), "=c" (*ecx), "=d" (*edx) \
+			 : "0" (level));
+#else
+	*eax = *ebx = *ecx = *edx = 0;
+#endif
+}
+
+
+int 
+nb_kernel_simd_test(FILE *                log)
+{
+	unsigned int _eax,_ebx,_ecx,_edx;
+	int status;
+	
+#if (GMX_SIMD_WIDTH == 1)
+	/* The reference build of the layer runs anywhere */
+	return 1;
+#endif
+
+	simd_cpuid(1,&_eax,&_ebx,&_ecx,&_edx);
+
+	/* Features:
+	 *
+	 * SSE2     Bit 26 of edx should be set
+	 * OSXSAVE  Bit 27 of ecx should be set
+	 * AVX      Bit 28 of ecx should be set
+	 */
+#ifdef GMX_AVX
+	if(NULL != log)
+	{
+		fprintf(log,"Checking CPU AVX support... ");
+	}
+	status = (_ecx & (1 << 27)) && (_ecx & (1 << 28));
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	if(status)
+	{
+		/* The OS must also save the ymm registers on context switches */
+		__asm__ ("xgetbv" : "=a" (_eax), "=d" (_edx) : "c" (0));
+		status = ((_eax & 6) == 6);
+	}
+#endif
+#else
+	if(NULL != log)
+	{
+		fprintf(log,"Checking CPU SSE2 support... ");
+	}
+	status = (_edx & (1 << 26)) != 0;
+#endif
+
+	if(NULL != log)
+	{
+		fprintf(log,"%s present.\n", (status==0) ? "not" : "");
+	}
+	
+	return status;
+}
+
+
+void
+nb_kernel_setup_simd(FILE *log,nb_kernel_t **list)
+{
+    int i;
+    nb_kernel_t *p;
+    
+    if(nb_kernel_simd_test(log) == 0)
+    {
+		return;
+    }
+
+    if(NULL != log)
+    {
+        fprintf(log,"Configuring %d-wide SIMD nonbonded kernels...\n",
+                GMX_SIMD_WIDTH);
+    }
+	
+    for(i=0;i<eNR_NBKERNEL_NR;i++)
+    {
+        p = kernellist_simd[i];
+        if(p!=NULL)
+		{
+			list[i] = p; 
+		}
+    }
+}
+
+
+void
+nb_kernel_setup_simd_ewald(FILE *log,nb_kernel_t **list)
+{
+    int i;
+    
+    if(nb_kernel_simd_test(NULL) == 0)
+    {
+        return;
+    }
+
+    if(NULL != log)
+    {
+        fprintf(log,"Using analytical Ewald real-space kernels with %d-wide SIMD.\n",
+                GMX_SIMD_WIDTH);
+    }
+
+    for(i=0;i<NB_KERNEL_SIMD_EWALD_NR;i++)
+    {
+        list[eNR_NBKERNEL300+i]   = kernellist_simd_ewald[i];
+        list[eNR_NBKERNEL300NF+i] = kernellist_simd_ewald[NB_KERNEL_SIMD_EWALD_NR+i];
+    }
+}
@@ -0,0 +1,251 @@
+/*
+ *                This source code is part of
+ *
+ *                 G   R   O   M   A   C   S
+ *
+ * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
+ * Copyright (c) 2001-2009, The GROMACS Development Team
+ *
+ * Gromacs is a library for molecular simulation and trajectory analysis,
+ * written by Erik Lindahl, David van der Spoel, Berk Hess, and others - for
+ * a full list of developers and information, check out http://www.gromacs.org
+ *
+ * This program is free software; you can redistribute it and/or modify it under 
+ * the terms of the GNU Lesser General Public License as published by the Free 
+ * Software Foundation; either version 2 of the License, or (at your option) any 
+ * later version.
+ * As a special exception, you may use this file as part of a free software
+ * library without restriction.  Specifically, if other files instantiate
+ * templates or use macros or inline functions from this file, or you compile
+ * this file and link it with other files to produce an executable, this
+ * file does not by itself cause the resulting executable to be covered by
+ * the GNU Lesser General Public License.  
+ *
+ * In plain-speak: do not worry about classes/macros/templates either - only
+ * changes to the library have to be LGPL, not an application linking with it.
+ *
+ * To help fund GROMACS development, we humbly ask that you cite
+ * the papers people have written on it - you can find them on the website!
+ */
+#ifndef _NB_KERNEL_SIMD_H_
+#define _NB_KERNEL_SIMD_H_
+
+/** Nonbonded kernels written with the SIMD layer in gmx_simd.h.
+ *
+ *  \file  nb_kernel_simd.h
+ *
+ *  The kernels are generated by mknb -simd and compiled for the
+ *  SIMD width selected at configure time (SSE2 or AVX, single or double).
+ *  They have the same call sequence as the C kernels, but do not
+ *  update the Monte Carlo pair energies (enerd1..enerd4).
+ *  The 5xx kernels compute Ewald real-space Coulomb without tables.
+ *
+ *  \internal
+ */
+
+#include <stdio.h>
+
+#include <gmx_simd.h>
+#include "../nb_kerneltype.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+nb_kernel_t GMX_SIMD_NAME(nb_kernel010);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel010nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel020);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel020nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel030);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel030nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel100);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel100nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel101);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel101nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel102);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel102nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel103);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel103nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel104);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel104nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel110);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel110nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel111);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel111nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel112);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel112nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel113);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel113nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel114);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel114nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel120);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel120nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel121);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel121nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel122);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel122nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel123);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel123nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel124);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel124nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel130);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel130nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel131);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel131nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel132);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel132nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel133);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel133nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel134);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel134nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel200);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel200nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel201);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel201nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel202);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel202nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel203);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel203nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel204);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel204nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel210);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel210nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel211);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel211nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel212);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel212nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel213);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel213nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel214);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel214nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel220);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel220nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel221);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel221nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel222);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel222nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel223);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel223nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel224);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel224nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel230);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel230nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel231);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel231nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel232);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel232nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel233);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel233nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel234);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel234nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel300);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel300nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel301);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel301nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel302);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel302nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel303);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel303nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel304);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel304nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel310);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel310nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel311);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel311nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel312);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel312nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel313);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel313nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel314);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel314nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel320);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel320nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel321);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel321nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel322);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel322nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel323);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel323nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel324);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel324nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel330);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel330nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel331);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel331nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel332);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel332nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel333);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel333nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel334);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel334nf);
+
+/* Ewald real-space kernels with an analytical erfc instead of
+ * the Coulomb table, with the Ewald coefficient passed as krf.
+ * They replace the 3xx kernels, the VdW table of 53x is the
+ * separate VdW table with 8 floats per point.
+ */
+nb_kernel_t GMX_SIMD_NAME(nb_kernel500);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel500nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel501);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel501nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel502);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel502nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel503);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel503nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel504);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel504nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel510);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel510nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel511);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel511nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel512);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel512nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel513);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel513nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel514);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel514nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel520);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel520nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel521);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel521nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel522);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel522nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel523);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel523nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel524);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel524nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel530);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel530nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel531);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel531nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel532);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel532nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel533);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel533nf);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel534);
+nb_kernel_t GMX_SIMD_NAME(nb_kernel534nf);
+
+
+/* Returns non-zero if the CPU (and OS) support the instruction set
+ * the SIMD kernels were compiled for.
+ */
+int
+nb_kernel_simd_test(FILE *log);
+
+void
+nb_kernel_setup_simd(FILE *log,nb_kernel_t **list);
+
+/* Sets the entries for the tabulated Coulomb kernels in list
+ * to the analytical Ewald kernels.
+ */
+void
+nb_kernel_setup_simd_ewald(FILE *log,nb_kernel_t **list);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NB_KERNEL_SIMD_H_ */
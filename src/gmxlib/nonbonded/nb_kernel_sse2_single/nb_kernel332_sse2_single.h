@@ -1,92 +0,0 @@
-/* -*- mode: c; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4; c-file-style: "stroustrup"; -*- 
- * 
- * This file is part of Gromacs        Copyright (c) 1991-2004
- * David van der Spoel, Erik Lindahl, University of Groningen.
- *
- * This program is free software; you can redistribute it and/or
- * modify it under the terms of the GNU General Public License
- * as published by the Free Software Foundation; either version 2
- * of the License, or (at your option) any later version.
- *
- * To help us fund GROMACS development, we humbly ask that you cite
- * the research papers on the package. Check out http://www.gromacs.org
- * 
- * And Hey:
- * Gnomes, ROck Monsters And Chili Sauce
- */
-#ifndef _NB_KERNEL332_SSE2_SINGLE_H_
-#define _NB_KERNEL332_SSE2_SINGLE_H_
-
-
-/*! \file  nb_kernel332_sse.h
- *  \brief SSE-intrinsics ptimized versions of nonbonded kernel 332
- *
- *  \internal
- */
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-#if 0
-}
-#endif
-
-/*! \brief Nonbonded kernel 332 with forces, optimized for sse.
- *
- *  \internal
- *
- *  <b>Coulomb interaction:</b> Tabulated <br>
- *  <b>VdW interaction:</b> Tabulated <br>
- *  <b>Water optimization:</b> Pairs of SPC/TIP3P waters interaction <br>
- *  <b>Forces calculated:</b> Yes <br>
- *
- *  \note All level1 and level2 nonbonded kernels use the same
- *        call sequence. Parameters are documented in nb_kernel.h
- */
-void
-nb_kernel332_sse2_single  (int *   nri,        int     iinr[],   int     jindex[],
-                       int     jjnr[],     int     shift[],  float   shiftvec[],
-                       float   fshift[],   int     gid[],    float   pos[],
-                       float   faction[],  float   charge[], float * facel,
-                       float * krf,        float * crf,      float   Vc[],
-                       int     type[],     int *   ntype,    float   vdwparam[],
-                       float   Vvdw[],     float * tabscale, float   VFtab[],
-                       float   invsqrta[], float   dvda[],   float * gbtabscale,
-                       float   GBtab[],    int *   nthreads, int *   count,
-                       void *  mtx,        int *   outeriter,int *   inneriter,
-                       float * work);
-
-
-
-/*! \brief Nonbonded kernel 332 without forces, optimized for sse.
- *
- *  \internal
- *
- *  <b>Coulomb interaction:</b> Tabulated <br>
- *  <b>VdW interaction:</b> Tabulated <br>
- *  <b>Water optimization:</b> Pairs of SPC/TIP3P waters interaction <br>
- *  <b>Forces calculated:</b> No <br>
- *
- *  \note All level1 and level2 nonbonded kernels use the same
- *        call sequence. Parameters are documented in nb_kernel.h
- */
-void
-nb_kernel332nf_sse2_single(int *   nri,        int     iinr[],   int     jindex[],
-                       int     jjnr[],     int     shift[],  float   shiftvec[],
-                       float   fshift[],   int     gid[],    float   pos[],
-                       float   faction[],  float   charge[], float * facel,
-                       float * krf,        float * crf,      float   Vc[],
-                       int     type[],     int *   ntype,    float   vdwparam[],
-                       float   Vvdw[],     float * tabscale, float   VFtab[],
-                       float   invsqrta[], float   dvda[],   float * gbtabscale,
-                       float   GBtab[],    int *   nthreads, int *   count,
-                       void *  mtx,        int *   outeriter,int *   inneriter,
-                       float * work);
-
-
-#ifdef __cplusplus
-}
-#endif
-
-
-#endif /* _NB_KERNEL332_IA32_SSE_H_ */
@@ -40,7 +40,6 @@
 
 #include <gmx_thread.h>
 
-
 #include <stdio.h>
 #include <stdlib.h>
 #include "typedefs.h"
@@ -61,6 +60,7 @@
 #include "nrnb.h"
 #include "smalloc.h"
 #include "nonbonded.h"
+#include "gmx_thread_pool.h"
 
 #include "nb_kernel_c/nb_kernel_c.h"
 #include "nb_free_energy.h"
@@ -95,6 +95,7 @@
 #  else
 #    include "nb_kernel_sse2_single/nb_kernel_sse2_single.h"
 #  endif
+#  include "nb_kernel_simd/nb_kernel_simd.h"
 #endif
 
 #if defined(GMX_FORTRAN) && defined(GMX_DOUBLE)   
@@ -199,6 +200,18 @@ nb_kernel_table[eNR_NBKERNEL_NR] =
 static nb_kernel_t **
 nb_kernel_list = NULL;
 
+/* Plain C kernels only, for Monte Carlo moves, since only these
+ * accumulate the pair energies of the moved atoms.
+ */
+static nb_kernel_t **
+nb_kernel_list_c = NULL;
+
+/* The kernels with analytical Ewald instead of tabulated Coulomb,
+ * NULL when these are not available.
+ */
+static nb_kernel_t **
+nb_kernel_list_ewald = NULL;
+
 
 void
 gmx_setup_kernels(FILE *fplog)
@@ -206,6 +219,7 @@ gmx_setup_kernels(FILE *fplog)
     int i;
     
     snew(nb_kernel_list,eNR_NBKERNEL_NR);
+    snew(nb_kernel_list_c,eNR_NBKERNEL_NR);
     
     /* Note that later calls overwrite earlier, so the preferred (fastest)
      * version should be at the end. For instance, we call SSE after 3DNow.
@@ -214,6 +228,7 @@ gmx_setup_kernels(FILE *fplog)
     for(i=0; i<eNR_NBKERNEL_NR; i++)
     {
         nb_kernel_list[i] = NULL;
+        nb_kernel_list_c[i] = NULL;
     }
     
     if(getenv("GMX_NB_GENERIC") != NULL)
@@ -233,6 +248,7 @@ gmx_setup_kernels(FILE *fplog)
     }
 	
     nb_kernel_setup(fplog,nb_kernel_list);
+    nb_kernel_setup(NULL,nb_kernel_list_c);
     
     if(getenv("GMX_NOOPTIMIZEDKERNELS") != NULL)
     {
@@ -267,11 +283,28 @@ gmx_setup_kernels(FILE *fplog)
 #endif
 
 #if defined(GMX_SSE2) 
+    /* The generated SIMD kernels (SSE2 or AVX) cover all interactions
+     * except generalized Born, the hand-written SSE2 kernels below
+     * only generalized Born.
+     */
+    nb_kernel_setup_simd(fplog,nb_kernel_list);
 #  ifdef GMX_DOUBLE
 	nb_kernel_setup_sse2_double(fplog,nb_kernel_list);
 #  else
 	nb_kernel_setup_sse2_single(fplog,nb_kernel_list);
 #  endif
+    if (nb_kernel_simd_test(NULL))
+    {
+        /* The analytical Ewald kernels only replace the tabulated
+         * Coulomb kernels when requested, see gmx_nonbonded_setup_ewald.
+         */
+        snew(nb_kernel_list_ewald,eNR_NBKERNEL_NR);
+        for(i=0; i<eNR_NBKERNEL_NR; i++)
+        {
+            nb_kernel_list_ewald[i] = nb_kernel_list[i];
+        }
+        nb_kernel_setup_simd_ewald(NULL,nb_kernel_list_ewald);
+    }
 #endif
  
 #if defined(GMX_FORTRAN) && defined(GMX_DOUBLE)   
@@ -305,79 +338,468 @@ gmx_setup_kernels(FILE *fplog)
 	    fprintf(fplog,"\n\n");
     }
 }
-void do_mclist(gmx_mc_move *mc_move,t_nblist *nlist,t_nblists **nblists_mc,int ind1,int ind2,bool bLR)
+
+
+/* Atoms per block in the reduction of the thread force buffers,
+ * small enough for the blocks of all threads to stay in cache.
+ */
+#define NB_REDUCE_BLOCK 256
+
+/* A neighborlist that is processed by all threads */
+typedef struct
 {
- int n,nn0,nn1,nj0,nj1,ii,jnr,k,kk,jj,nri;
- t_nblists *nlists;
- t_nblist *nlist2;
-
-  /*srenew(nlist2,1);
-  srenew(jindex,nlist->nri+1);
-  nlist2->jindex = jindex;
-  srenew(iinr,nlist->nri);
-  nlist2->iinr = iinr;
-  nj1 = nlist->jindex[nlist->nri+1];    
-  srenew(jjnr,nj1);
-  nlist2->jjnr = jjnr;*/
-  nlists = &nblists_mc[mc_move->cgs][ind1];
-  if(bLR)
-  {
-   nlist2 = &nlists->nlist_lr[ind2];
-  }
-  else 
-  {
-   nlist2 = &nlists->nlist_sr[ind2];
-  }
-
-  if(mc_move->bNS[mc_move->cgs])
-  {
-   
-   nlist2->enlist = nlist->enlist;
-   nlist2->il_code = nlist->il_code;
-   nlist2->icoul = nlist->icoul;
-   nlist2->ivdw = nlist->ivdw;
-   nlist2->free_energy = nlist->free_energy;
-   nlist2->nri = nlist->nri;
-   nlist2->maxnri = nlist->maxnri;
-   nlist2->nrj = nlist->nrj;
-   nlist2->maxnrj = nlist2->maxnrj;  
-   nlist2->maxlen = nlist->maxlen;
-   nlist2->iinr_end = nlist->iinr_end;
-   nlist2->jjnr_end = nlist->jjnr_end;
-   nlist2->count = nlist->count;
-   nlist2->mtx = nlist->mtx;    
-   srenew(nlist2->jjnr,nlist->maxnrj);
- 
-        for(n=0; (n<nlist->nri); n++)
+    t_nblist *    nlist;
+    nb_kernel_t * kernelptr;
+    int           nrnb_ind;
+    real *        krf;
+    real *        tabscale;
+    real *        tabledata;
+} t_nb_thread_list;
+
+/* Output of one thread. Thread 0 writes forces, shift forces and energies
+ * directly to the output arrays, the other threads to these buffers,
+ * which are zero outside the reduction.
+ */
+typedef struct
+{
+    rvec *        f;
+    int           nalloc;
+    rvec          fshift[SHIFTS];
+    real *        egcoul;
+    real *        egnb;
+    t_nrnb        nrnb;
+    bool          bUsed;
+} t_nb_thread_out;
+
+struct gmx_nonbonded_threads
+{
+    int                 nthreads;
+    gmx_thread_pool_t   pool;
+    int                 nener;
+    t_nb_thread_out *   out;
+    
+    /* The lists queued by do_nonbonded */
+    int                 nlist;
+    int                 nlist_alloc;
+    t_nb_thread_list *  list;
+    
+    /* The arguments of the current do_nonbonded call */
+    t_forcerec *        fr;
+    t_mdatoms *         mdatoms;
+    rvec *              x;
+    rvec *              f;
+    real *              fshift;
+    real *              egcoul;
+    real *              egnb;
+    int                 natoms;
+};
+
+
+gmx_nonbonded_threads_t
+gmx_nonbonded_init_threads(FILE *fplog,int ngener)
+{
+    struct gmx_nonbonded_threads *nbth;
+    char *env;
+    int  nthreads,t;
+    
+    nthreads = 1;
+    if ((env = getenv("GMX_NB_NTHREADS")) != NULL)
+    {
+        nthreads = max(1,strtol(env,NULL,10));
+    }
+    if (nthreads == 1)
+    {
+        return NULL;
+    }
+    
+    snew(nbth,1);
+    nbth->pool     = gmx_thread_pool_init(nthreads);
+    nbth->nthreads = gmx_thread_pool_nthreads(nbth->pool);
+    if (nbth->nthreads == 1)
+    {
+        /* No thread support */
+        gmx_thread_pool_done(nbth->pool);
+        sfree(nbth);
+        
+        return NULL;
+    }
+    
+    nbth->nener = ngener*ngener;
+    snew(nbth->out,nbth->nthreads);
+    for(t=0; t<nbth->nthreads; t++)
+    {
+        snew(nbth->out[t].egcoul,nbth->nener);
+        snew(nbth->out[t].egnb,nbth->nener);
+        init_nrnb(&nbth->out[t].nrnb);
+    }
+    
+    if (fplog)
+    {
+        fprintf(fplog,"Running the nonbonded kernels on %d threads\n\n",
+                nbth->nthreads);
+    }
+    
+    return nbth;
+}
+
+
+/* Number of points per nm for the Ewald accuracy check, one more
+ * is added to sample all positions within the table intervals.
+ */
+#define EWALD_CHECK_NPOINTS_NM 1000
+
+void
+gmx_nonbonded_setup_ewald(FILE *fplog,t_forcerec *fr,t_nblists *nblists)
+{
+    real    *tab,scale,eps,eps2,Y,F,G,H;
+    double  beta,r,rmin,vex,fex,vtab,ftab,van,fan;
+    double  dvtab,dftab,dvan,dfan;
+    int     npoints,i,n;
+#ifdef GMX_SSE2
+    real    buf[GMX_SIMD_WIDTH];
+    gmx_simd_real_t br_S,ex_S;
+#endif
+    
+    fr->bEwaldAnalytical = FALSE;
+    
+    if (getenv("GMX_NB_EWALD_ANALYTICAL") == NULL ||
+        !(fr->eeltype == eelEWALD || fr->eeltype == eelPME))
+    {
+        return;
+    }
+    if (nb_kernel_list_ewald == NULL)
+    {
+        if (fplog)
         {
-            nlist2->iinr[n] = nlist->iinr[n];        
-            nlist2->jindex[n] = nlist->jindex[n];
-            nlist2->jindex[n+1] = nlist->jindex[n+1];
-            nlist2->gid[n] = nlist->gid[n];
-            nlist2->shift[n] = nlist->shift[n];
+            fprintf(fplog,"Found environment variable GMX_NB_EWALD_ANALYTICAL, but the analytical Ewald kernels are not available with these kernels and this CPU, using tables\n\n");
+        }
+        return;
+    }
+    
+    /* Compare the potential and force of the Coulomb table and the
+     * analytical erfc with the exact values. The errors are relative
+     * to plain Coulomb, i.e. of r*V and r^2*F.
+     */
+    tab     = nblists->tab.tab;
+    scale   = nblists->tab.scale;
+    beta    = fr->ewaldcoeff;
+    rmin    = 0.05;
+    npoints = (int)((fr->rcoulomb - rmin)*EWALD_CHECK_NPOINTS_NM) + 1;
+    dvtab   = dftab = dvan = dfan = 0;
+    for(i=0; i<npoints; i++)
+    {
+        r    = rmin + (i + 0.5)*(fr->rcoulomb - rmin)/npoints;
+        vex  = erfc(beta*r)/r;
+        fex  = (vex + 2*beta/sqrt(M_PI)*exp(-beta*beta*r*r))/r;
+        
+        eps  = r*scale;
+        n    = (int)eps;
+        eps  = eps - n;
+        eps2 = eps*eps;
+        Y    = tab[12*n];
+        F    = tab[12*n+1];
+        G    = tab[12*n+2];
+        H    = tab[12*n+3];
+        vtab = Y + eps*F + eps2*G + eps*eps2*H;
+        ftab = -(F + 2*eps*G + 3*eps2*H)*scale;
+        
+#ifdef GMX_SSE2
+        br_S = gmx_simd_set1(beta*r);
+        ex_S = gmx_simd_exp(gmx_simd_mul(gmx_simd_set1(-beta*r),br_S));
+        gmx_simd_storeu(buf,gmx_simd_mul(gmx_simd_erfcx(br_S),ex_S));
+        van  = buf[0]/r;
+        gmx_simd_storeu(buf,ex_S);
+        fan  = (van + 2*beta/sqrt(M_PI)*buf[0])/r;
+#else
+        van  = vex;
+        fan  = fex;
+#endif
+        dvtab = max(dvtab,fabs(vtab - vex)*r);
+        dftab = max(dftab,fabs(ftab - fex)*r*r);
+        dvan  = max(dvan,fabs(van - vex)*r);
+        dfan  = max(dfan,fabs(fan - fex)*r*r);
+    }
+    
+    if (fplog)
+    {
+        fprintf(fplog,
+                "Maximum relative errors of Ewald real-space Coulomb for %g < r < %g nm:\n"
+                "  table:      potential %.1e, force %.1e\n"
+                "  analytical: potential %.1e, force %.1e\n",
+                rmin,fr->rcoulomb,dvtab,dftab,dvan,dfan);
+    }
+    
+    /* The table errors are close to the precision, allow some more */
+    if (dvan > max(10*dvtab,100*GMX_REAL_EPS) ||
+        dfan > max(10*dftab,100*GMX_REAL_EPS))
+    {
+        if (fplog)
+        {
+            fprintf(fplog,"The analytical Ewald kernels are not accurate enough, using tables\n\n");
+        }
+        return;
+    }
+    
+    if (fplog)
+    {
+        fprintf(fplog,"Using analytical Ewald real-space kernels instead of tables\n\n");
+    }
+    fr->bEwaldAnalytical = TRUE;
+}
 
-            for(k=nlist->jindex[n]; (k<nlist->jindex[n+1]); k++)
-            {
 
-                nlist2->jjnr[k]  = nlist->jjnr[k]; 
-            }
+static int
+nblist_outer_fac(int enlist)
+{
+    int fac=0;
+    
+    switch (enlist) {
+    case enlistATOM_ATOM:   fac =  1; break;
+    case enlistSPC_ATOM:    fac =  3; break;
+    case enlistSPC_SPC:     fac =  9; break;
+    case enlistTIP4P_ATOM:  fac =  4; break;
+    case enlistTIP4P_TIP4P: fac = 16; break;
+    case enlistCG_CG:       fac =  1; break;
+    }
+    
+    return fac;
+}
+
+
+static void
+nb_threads_add_list(gmx_nonbonded_threads_t nbth,t_nblist *nlist,
+                    nb_kernel_t *kernelptr,int nrnb_ind,real *krf,
+                    real *tabscale,real *tabledata)
+{
+    t_nb_thread_list *l;
+    
+    if (nbth->nlist == nbth->nlist_alloc)
+    {
+        nbth->nlist_alloc = nbth->nlist_alloc*2 + 8;
+        srenew(nbth->list,nbth->nlist_alloc);
+    }
+    l = &nbth->list[nbth->nlist++];
+    l->nlist     = nlist;
+    l->kernelptr = kernelptr;
+    l->nrnb_ind  = nrnb_ind;
+    l->krf       = krf;
+    l->tabscale  = tabscale;
+    l->tabledata = tabledata;
+}
+
+
+/* Returns the first i-entry of nlist for thread t out of nthreads.
+ * The split points are fixed for a given list and divide the j-entries
+ * evenly over the threads, so each thread always computes the same
+ * entries and the force summation order does not depend on timing.
+ */
+static int
+nb_thread_split(t_nblist *nlist,int nthreads,int t)
+{
+    int nj,target,lo,hi,mid;
+    
+    if (t >= nthreads)
+    {
+        return nlist->nri;
+    }
+    nj     = nlist->jindex[nlist->nri];
+    target = (int)(((double)nj*t)/nthreads);
+    
+    /* Find the first entry with jindex >= target */
+    lo = 0;
+    hi = nlist->nri;
+    while (lo < hi)
+    {
+        mid = (lo + hi)/2;
+        if (nlist->jindex[mid] < target)
+        {
+            lo = mid + 1;
         }
-  }
-  else 
-  {
-   //nlist = nlist2;
-        for(n=0; (n<nlist->nri); n++)
-        {   
-            for(k=nlist->jindex[n]; (k<nlist->jindex[n+1]); k++)
+        else
+        {
+            hi = mid;
+        }
+    }
+    
+    return lo;
+}
+
+
+static void
+nb_thread_task(void *data,int task,int thread)
+{
+    struct gmx_nonbonded_threads *nbth=(struct gmx_nonbonded_threads *)data;
+    t_forcerec       *fr;
+    t_nb_thread_out  *out;
+    t_nb_thread_list *l;
+    t_nblist         *nlist;
+    real             *f,*fshift,*egcoul,*egnb;
+    int              i,nn0,nn1,nri,count,one=1,outeriter,inneriter;
+    
+    fr  = nbth->fr;
+    out = &nbth->out[thread];
+    if (thread == 0)
+    {
+        f      = nbth->f[0];
+        fshift = nbth->fshift;
+        egcoul = nbth->egcoul;
+        egnb   = nbth->egnb;
+    }
+    else
+    {
+        f      = out->f[0];
+        fshift = out->fshift[0];
+        egcoul = out->egcoul;
+        egnb   = out->egnb;
+    }
+    
+    for(i=0; i<nbth->nlist; i++)
+    {
+        l     = &nbth->list[i];
+        nlist = l->nlist;
+        nn0   = nb_thread_split(nlist,nbth->nthreads,task);
+        nn1   = nb_thread_split(nlist,nbth->nthreads,task+1);
+        if (nn1 > nn0)
+        {
+            /* Call the kernel for entries nn0 to nn1 only, with a private
+             * counter the kernel thread loop does not split this further.
+             */
+            nri        = nn1 - nn0;
+            count      = 0;
+            outeriter  = inneriter = 0;
+            out->bUsed = TRUE;
+            (*l->kernelptr)(&nri,
+                            nlist->iinr   + nn0,
+                            nlist->jindex + nn0,
+                            nlist->jjnr,
+                            nlist->shift  + nn0,
+                            fr->shift_vec[0],
+                            fshift,
+                            nlist->gid    + nn0,
+                            nbth->x[0],
+                            f,
+                            nbth->mdatoms->chargeA,
+                            &(fr->epsfac),
+                            l->krf,
+                            &(fr->c_rf),
+                            egcoul,
+                            nbth->mdatoms->typeA,
+                            &(fr->ntype),
+                            fr->nbfp,
+                            egnb,
+                            l->tabscale,
+                            l->tabledata,
+                            NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL,
+                            fr->invsqrta,
+                            fr->dvda,
+                            &(fr->gbtabscale),
+                            fr->gbtab.tab,
+                            &one,
+                            &count,
+                            nlist->mtx,
+                            &outeriter,
+                            &inneriter,
+                            NULL);
+            inc_nrnb(&out->nrnb,eNR_NBKERNEL_OUTER,
+                     nblist_outer_fac(nlist->enlist)*outeriter);
+            inc_nrnb(&out->nrnb,l->nrnb_ind,inneriter);
+        }
+    }
+}
+
+
+/* Adds the force buffers of threads 1 and up to the output forces
+ * for block task of NB_REDUCE_BLOCK atoms and clears them.
+ */
+static void
+nb_reduce_task(void *data,int task,int thread)
+{
+    struct gmx_nonbonded_threads *nbth=(struct gmx_nonbonded_threads *)data;
+    rvec *fo,*ft;
+    int  a0,a1,a,t;
+    
+    a0 = task*NB_REDUCE_BLOCK;
+    a1 = min(nbth->natoms,a0 + NB_REDUCE_BLOCK);
+    fo = nbth->f;
+    for(t=1; t<nbth->nthreads; t++)
+    {
+        if (nbth->out[t].bUsed)
+        {
+            ft = nbth->out[t].f;
+            for(a=a0; a<a1; a++)
             {
-            //if(mc_move->cgs == 20)
-             //printf("false %d %d %d %d\n",n,k,ind1,ind2);
+                rvec_inc(fo[a],ft[a]);
+                clear_rvec(ft[a]);
             }
         }
-  }
+    }
+}
 
- return;
+
+/* Runs the queued lists on all threads and reduces the thread output */
+static void
+nb_threads_run(gmx_nonbonded_threads_t nbth,t_forcerec *fr,
+               rvec x[],rvec f[],real *fshift,t_mdatoms *mdatoms,
+               real egcoul[],real egnb[],t_nrnb *nrnb)
+{
+    t_nb_thread_out *out;
+    int             t,s,e;
+    
+    nbth->fr      = fr;
+    nbth->mdatoms = mdatoms;
+    nbth->x       = x;
+    nbth->f       = f;
+    nbth->fshift  = fshift;
+    nbth->egcoul  = egcoul;
+    nbth->egnb    = egnb;
+    nbth->natoms  = fr->natoms_force;
+    
+    for(t=1; t<nbth->nthreads; t++)
+    {
+        out = &nbth->out[t];
+        if (out->nalloc < fr->nalloc_force)
+        {
+            /* The buffers are zero, except during the reduction */
+            sfree(out->f);
+            out->nalloc = fr->nalloc_force;
+            snew(out->f,out->nalloc);
+        }
+        out->bUsed = FALSE;
+    }
+    
+    gmx_thread_pool_run(nbth->pool,nbth->nthreads,nb_thread_task,nbth);
+    
+    gmx_thread_pool_run(nbth->pool,
+                        (nbth->natoms + NB_REDUCE_BLOCK - 1)/NB_REDUCE_BLOCK,
+                        nb_reduce_task,nbth);
+    
+    /* The shift forces and energy group terms are small, reduce serially */
+    for(t=0; t<nbth->nthreads; t++)
+    {
+        out = &nbth->out[t];
+        if (t > 0 && out->bUsed)
+        {
+            for(s=0; s<SHIFTS; s++)
+            {
+                rvec_inc(((rvec *)fshift)[s],out->fshift[s]);
+                clear_rvec(out->fshift[s]);
+            }
+            for(e=0; e<nbth->nener; e++)
+            {
+                egcoul[e]     += out->egcoul[e];
+                egnb[e]       += out->egnb[e];
+                out->egcoul[e] = 0;
+                out->egnb[e]   = 0;
+            }
+        }
+        add_nrnb(nrnb,nrnb,&out->nrnb);
+        init_nrnb(&out->nrnb);
+    }
+    
+    nbth->nlist = 0;
 }
+
+
 void do_nonbonded(t_commrec *cr,t_forcerec *fr,
                   rvec x[],rvec f[],t_mdatoms *mdatoms,
                   real egnb[],real egcoul[],real egpol[],rvec box_size,
@@ -385,12 +807,12 @@ void do_nonbonded(t_commrec *cr,t_forcerec *fr,
                   int nls,int eNL,int flags,gmx_mc_move *mc_move)
 {
     bool            bLR,bDoForces,bForeignLambda;
-	t_nblist *      nlist,*nlist2=NULL;
-	t_nblists *      nlists;
+	t_nblist *      nlist;
 	real *          fshift;
 	int             n,n0,n1,i,i0,i1,nrnb_ind,sz;
 	t_nblists       *nblists;
 	bool            bWater;
+    bool            bEwald;
 	nb_kernel_t *   kernelptr;
 	FILE *          fp;
 	int             fac=0;
@@ -399,8 +821,11 @@ void do_nonbonded(t_commrec *cr,t_forcerec *fr,
 	int             outeriter,inneriter;
         int             *jindex,nj1,nri,*iinr,*jjnr;
 	real *          tabledata = NULL;
+	real *          krf;
 	real *          enerd = NULL;
 	gmx_gbdata_t    gbdata;
+    gmx_nonbonded_threads_t nbth;
+    bool            bThreads;
 
     bLR            = (flags & GMX_DONB_LR);
     bDoForces      = (flags & GMX_DONB_FORCES);
@@ -408,6 +833,13 @@ void do_nonbonded(t_commrec *cr,t_forcerec *fr,
 
 	gbdata.gb_epsilon_solvent = fr->gb_epsilon_solvent;
 	gbdata.gpol               = egpol;
+
+    /* The Monte Carlo pair energies are only accumulated on one thread */
+    nbth     = fr->nbthreads;
+    bThreads = (nbth != NULL && mc_move == NULL);
+
+    /* The analytical Ewald kernels do not accumulate the MC pair energies */
+    bEwald   = (fr->bEwaldAnalytical && mc_move == NULL);
 	
     if (eNL >= 0) 
     {
@@ -458,6 +890,7 @@ void do_nonbonded(t_commrec *cr,t_forcerec *fr,
 			if (nlist->nri > 0) 
 			{
 				nrnb_ind = nlist->il_code;
+				krf      = &(fr->k_rf);
 				
 				if(nrnb_ind==eNR_NBKERNEL_FREE_ENERGY)
 				{
@@ -495,6 +928,18 @@ void do_nonbonded(t_commrec *cr,t_forcerec *fr,
 					{
 						tabledata = NULL;
 					}
+                    
+                    if (bEwald && n == 0 &&
+                        (tabletype == TABLE_COMBINED || tabletype == TABLE_COUL))
+                    {
+                        /* Only the normal list has an Ewald table.
+                         * The analytical kernels get the Ewald coefficient
+                         * as krf and only need a table for VdW.
+                         */
+                        krf       = &(fr->ewaldcoeff);
+                        tabledata = (tabletype == TABLE_COMBINED) ?
+                            nblists->vdwtab : NULL;
+                    }
 				}
 				
 				nlist->count = 0;
@@ -561,7 +1006,31 @@ void do_nonbonded(t_commrec *cr,t_forcerec *fr,
                 {
                     /* Not free energy */
 
-                    kernelptr = nb_kernel_list[nrnb_ind];
+                    if (mc_move)
+                    {
+                        kernelptr = nb_kernel_list_c[nrnb_ind];
+                    }
+                    else if (krf == &(fr->ewaldcoeff))
+                    {
+                        kernelptr = nb_kernel_list_ewald[nrnb_ind];
+                    }
+                    else
+                    {
+                        kernelptr = nb_kernel_list[nrnb_ind];
+                    }
+                    
+                    if (bThreads && kernelptr != NULL &&
+                        !(nlist->il_code >= eNR_NBKERNEL400 &&
+                          nlist->il_code <= eNR_NBKERNEL430))
+                    {
+                        /* Leave this list for all threads after the loop.
+                         * Generalized Born is excluded, since its kernels
+                         * also accumulate into dvda.
+                         */
+                        nb_threads_add_list(nbth,nlist,kernelptr,nrnb_ind,krf,
+                                            &(nblists->tab.scale),tabledata);
+                        continue;
+                    }
                     
                     if (kernelptr == NULL)
                     {
@@ -587,40 +1056,19 @@ void do_nonbonded(t_commrec *cr,t_forcerec *fr,
                     else
                     {
                         /* Call nonbonded kernel from function pointer */
-                      /*if(mc_move) 
-                      {
-                       if(mc_move->bNS[mc_move->cgs])
-                       {
-                        do_mclist(mc_move,nlist,fr->nblists_mc,n,i,bLR);
-                       }
-                       else if (1 == 2)
-                       {
-                        nlists = &fr->nblists_mc[mc_move->cgs][n];
-                        if(bLR)
-                        {
-                         nlist2 = &nlists->nlist_lr[i];
-                        }
-                        else 
-                        {
-                         nlist2 = &nlists->nlist_sr[i];
-                        }
-                       }
-                      }*/
-                         //mc_move=NULL;
-                         //printf("nrnb %d %d %d\n",nrnb_ind,mc_move->start,mc_move->end);
-                        (*kernelptr)( mc_move && nlist2 ? &(nlist2->nri) : &(nlist->nri),
-                                      mc_move && nlist2 ? nlist2->iinr : nlist->iinr,
-                                      mc_move && nlist2 ? nlist2->jindex : nlist->jindex,
-                                      mc_move && nlist2 ? nlist2->jjnr : nlist->jjnr,
-                                      mc_move && nlist2 ? nlist2->shift : nlist->shift,
+                        (*kernelptr)( &(nlist->nri),
+                                      nlist->iinr,
+                                      nlist->jindex,
+                                      nlist->jjnr,
+                                      nlist->shift,
                                       fr->shift_vec[0],
                                       fshift,
-                                      mc_move && nlist2 ? nlist2->gid : nlist->gid,
+                                      nlist->gid,
                                       x[0],
                                       f[0],
                                       mdatoms->chargeA,
                                       &(fr->epsfac),
-                                      &(fr->k_rf),
+                                      krf,
                                       &(fr->c_rf),
                                       egcoul,
                                       mdatoms->typeA,
@@ -653,14 +1101,7 @@ void do_nonbonded(t_commrec *cr,t_forcerec *fr,
                 /* Update flop accounting */
 				
 				/* Outer loop in kernel */
-                switch (nlist->enlist) {
-                case enlistATOM_ATOM:   fac =  1; break;
-                case enlistSPC_ATOM:    fac =  3; break;
-                case enlistSPC_SPC:     fac =  9; break;
-                case enlistTIP4P_ATOM:  fac =  4; break;
-                case enlistTIP4P_TIP4P: fac = 16; break;
-                case enlistCG_CG:       fac =  1; break;
-                }
+                fac = nblist_outer_fac(nlist->enlist);
                 inc_nrnb(nrnb,eNR_NBKERNEL_OUTER,fac*outeriter);
 
                 /* inner loop in kernel */
@@ -668,6 +1109,11 @@ void do_nonbonded(t_commrec *cr,t_forcerec *fr,
             }
         }
     }
+    
+    if (bThreads && nbth->nlist > 0)
+    {
+        nb_threads_run(nbth,fr,x,f,fshift,mdatoms,egcoul,egnb,nrnb);
+    }
 }
 
 
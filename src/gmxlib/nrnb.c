@@ -187,6 +187,9 @@ static const t_nrnb_data nbdata[eNRNB] = {
     { "GB Coulomb + VdW(T) NF",         49 }, /* nb_kernel430nf */
     { "Free energy innerloop",         150 }, /* free energy, estimate */  
     { "Outer nonbonded loop",           10 },
+    { "NxN RF Coul + LJ",               44 }, /* per atom pair */
+    { "NxN Coul(T) + LJ",               55 }, /* per atom pair */
+    { "NxN pair list pruning",         144 }, /* per cluster pair */
     { "1,4 nonbonded interactions",     90 },
     { "Calc Weights",                   36 },
     { "Spread Q",                        6 },
@@ -61,7 +61,7 @@
 #include "mtop_util.h"
 
 /* This number should be increased whenever the file format changes! */
-static const int tpx_version = 67;
+static const int tpx_version = 76;
 
 /* This number should only be increased when you edit the TOPOLOGY section
  * of the tpx format. This way we can maintain forward compatibility too
@@ -72,7 +72,7 @@ static const int tpx_version = 67;
  * to the end of the tpx file, so we can just skip it if we only
  * want the topology.
  */
-static const int tpx_generation = 20;
+static const int tpx_generation = 21;
 
 /* This number should be the most recent backwards incompatible version 
  * I.e., if this number is 9, we cannot read tpx version 9 with this code.
@@ -307,6 +307,18 @@ static void do_inputrec(t_inputrec *ir,bool bRead, int file_version,
 	}
       }
     }
+    if (file_version >= 75) {
+      do_int(ir->cutoff_scheme);
+    } else {
+      ir->cutoff_scheme = ecutsGROUP;
+    }
+    if (file_version >= 76) {
+      do_real(ir->verletbuf_drift);
+      do_int(ir->nstprune);
+    } else {
+      ir->verletbuf_drift = 0.005;
+      ir->nstprune        = 0;
+    }
     do_int(ir->ns_type);
     do_int(ir->nstlist);
     do_int(ir->ndelta);
@@ -362,6 +374,47 @@ static void do_inputrec(t_inputrec *ir,bool bRead, int file_version,
     do_real(ir->dihedral_rot);
     do_real(ir->bond_stretch);
     do_real(ir->angle_bend);
+    if (file_version >= 68) {
+      do_int(ir->mc_ntrial);
+    } else {
+      ir->mc_ntrial = 1;
+    }
+    if (file_version >= 69) {
+      do_int(ir->bMCCheckerboard);
+    } else {
+      ir->bMCCheckerboard = FALSE;
+    }
+    if (file_version >= 70) {
+      do_int(ir->mc_regrow_ntrial);
+    } else {
+      ir->mc_regrow_ntrial = 0;
+    }
+    if (file_version >= 71) {
+      do_int(ir->mc_adapt_steps);
+      do_int(ir->mc_adapt_nst);
+      do_real(ir->mc_accept_target);
+    } else {
+      ir->mc_adapt_steps   = 0;
+      ir->mc_adapt_nst     = 100;
+      ir->mc_accept_target = 0.4;
+    }
+    if (file_version >= 72) {
+      do_int(ir->bMCVolumeFast);
+    } else {
+      ir->bMCVolumeFast = FALSE;
+    }
+    if (file_version >= 73) {
+      do_int(ir->nstmc);
+      do_int(ir->mc_nmoves);
+    } else {
+      ir->nstmc     = 0;
+      ir->mc_nmoves = 0;
+    }
+    if (file_version >= 74) {
+      do_int(ir->hmc_nsteps);
+    } else {
+      ir->hmc_nsteps = 10;
+    }
     do_real(ir->xtcprec); 
     if (file_version < 19) {
       do_int(idum); 
@@ -1570,6 +1623,11 @@ static void do_moltype(gmx_moltype_t *molt,bool bRead,t_symtab *symtab,
     do_ilist(&molt->mc_angles,bRead,file_version,F_ANGLES);
     do_ilist(&molt->mc_dihedrals,bRead,file_version,F_PDIHS);
     do_ilist(&molt->mc_cra,bRead,file_version,F_PDIHS);
+    if (file_version >= 70) {
+      do_ilist(&molt->mc_regrow,bRead,file_version,F_PDIHS);
+    } else {
+      molt->mc_regrow.nr = 0;
+    }
     do_block(&molt->cgs,bRead,file_version);
     if (bRead && gmx_debug_at) {
       pr_block(debug,0,"cgs",&molt->cgs,TRUE);
@@ -518,6 +518,9 @@ void pr_inputrec(FILE *fp,int indent,const char *title,t_inputrec *ir,
     PSTEP("nsteps",ir->nsteps);
     PSTEP("init_step",ir->init_step);
     PI("nstcalcenergy",ir->nstcalcenergy);
+    PS("cutoff_scheme",ECUTSCHEME(ir->cutoff_scheme));
+    PR("verletbuf_drift",ir->verletbuf_drift);
+    PI("nstprune",ir->nstprune);
     PS("ns_type",ENS(ir->ns_type));
     PI("nstlist",ir->nstlist);
     PI("ndelta",ir->ndelta);
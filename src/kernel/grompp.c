@@ -73,6 +73,8 @@
 #include "add_par.h"
 #include "enxio.h"
 #include "perf_est.h"
+#include "calc_verletbuf.h"
+#include "pbc.h"
 #include "compute_io.h"
 #include "gpp_atomtype.h"
 #include "gpp_tomorse.h"
@@ -271,6 +273,7 @@ static void molinfo2mtop(int nmi,t_molinfo *mi,gmx_mtop_t *mtop)
     molt->mc_angles = mi[m].mc_angles;
     molt->mc_dihedrals = mi[m].mc_dihedrals;
     molt->mc_cra = mi[m].mc_cra;
+    molt->mc_regrow = mi[m].mc_regrow;
   }
 }
 
@@ -832,6 +835,37 @@ static int count_constraints(gmx_mtop_t *mtop,t_molinfo *mi)
   return count;
 }
 
+static void set_verlet_buffer(gmx_mtop_t *mtop,t_inputrec *ir,matrix box,
+			      char *mdparin)
+{
+  real rlist;
+
+  rlist = calc_verlet_buffer_size(mtop,det(box),ir,ir->nstlist,
+				  ir->verletbuf_drift);
+  set_warning_line(mdparin,-1);
+  if (rlist < 0) {
+    sprintf(warn_buf,"There is no reference temperature, can not set the Verlet buffer from verlet-buffer-drift, using rlist = %g",ir->rlist);
+    warning(NULL);
+    ir->nstprune = 0;
+    if (ir->rlist < ir->rcoulomb) {
+      sprintf(warn_buf,"With cutoff-scheme = %s and without a reference temperature, rlist (%g) should be >= rcoulomb (%g)",
+	      ecutscheme_names[ir->cutoff_scheme],ir->rlist,ir->rcoulomb);
+      warning_error(NULL);
+    }
+  } else {
+    printf("Set rlist to %g for a maximum energy drift of %g kJ/mol/ps per atom due to the Verlet buffer\n",
+	   rlist,ir->verletbuf_drift);
+    ir->rlist     = rlist;
+    ir->rlistlong = rlist;
+    /* double_check only saw the rlist from the mdp file */
+    if (sqr(ir->rlistlong) >= max_cutoff2(ir->ePBC,box)) {
+      sprintf(warn_buf,"The Verlet buffer sets rlist to %g, which is longer than half the shortest box vector or longer than the smallest box diagonal element. Increase the box size or verlet-buffer-drift.",
+	      ir->rlist);
+      warning_error(NULL);
+    }
+  }
+}
+
 int main (int argc, char *argv[])
 {
   static const char *desc[] = {
@@ -1208,6 +1242,24 @@ int main (int argc, char *argv[])
     fprintf(stderr,"Checking consistency between energy and charge groups...\n");
   check_eg_vs_cg(sys);
   
+  if (ftp2bSet(efTRN,NFILE,fnm)) {
+    if (bVerbose)
+      fprintf(stderr,"getting data from old trajectory ...\n");
+    cont_status(ftp2fn(efTRN,NFILE,fnm),ftp2fn_null(efEDR,NFILE,fnm),
+		bNeedVel,bGenVel,fr_time,ir,&state,sys);
+  }
+
+  if (ir->ePBC==epbcXY && ir->nwall!=2)
+    clear_rvec(state.box[ZZ]);
+  
+  /* The buffer needs ref_t and the final box and should be set
+   * before the cut-off checks below.
+   */
+  if (ir->cutoff_scheme == ecutsVERLET && ir->verletbuf_drift > 0) {
+    set_verlet_buffer(sys,ir,state.box,mdparin);
+    check_warning_error(FARGS);
+  }
+
   if (debug)
     pr_symtab(debug,0,"After index",&sys->symtab);
   triple_check(mdparin,ir,sys,&nerror);
@@ -1215,21 +1267,16 @@ int main (int argc, char *argv[])
   if (debug)
     pr_symtab(debug,0,"After close",&sys->symtab);
 
+  if (nerror) {
+    print_warn_num(FALSE);
+    gmx_fatal(FARGS,"There were %d error(s) processing your input",nerror);
+  }
+
   /* make exclusions between QM atoms */
   if (ir->bQMMM) {
     generate_qmexcl(sys,ir);
   }
 
-  if (ftp2bSet(efTRN,NFILE,fnm)) {
-    if (bVerbose)
-      fprintf(stderr,"getting data from old trajectory ...\n");
-    cont_status(ftp2fn(efTRN,NFILE,fnm),ftp2fn_null(efEDR,NFILE,fnm),
-		bNeedVel,bGenVel,fr_time,ir,&state,sys);
-  }
-
-  if (ir->ePBC==epbcXY && ir->nwall!=2)
-    clear_rvec(state.box[ZZ]);
-  
   if (EEL_FULL(ir->coulombtype)) {
     /* Calculate the optimal grid dimensions */
     copy_mat(state.box,box);
@@ -78,11 +78,15 @@
 #include "coulomb.h"
 #include "constr.h"
 #include "shellfc.h"
+#include "mctrial.h"
+#include "hmc.h"
+#include "mcadapt.h"
 #include "compute_io.h"
 #include "mvdata.h"
 #include "checkpoint.h"
 #include "mtop_util.h"
 #include "random.h"
+#include "atomsort.h"
 #include "bondf.h" ///retirar
 
 #ifdef GMX_LIB_MPI
@@ -120,7 +124,7 @@ typedef struct {
 } gmx_intp_t;
 
 /* The array should match the eI array in include/types/enums.h */
-const gmx_intp_t integrator[eiNR] = { {do_md}, {do_steep}, {do_cg}, {do_md}, {do_md}, {do_nm}, {do_lbfgs}, {do_tpi}, {do_tpi}, {do_md}, {do_md} };
+const gmx_intp_t integrator[eiNR] = { {do_md}, {do_steep}, {do_cg}, {do_md}, {do_md}, {do_nm}, {do_lbfgs}, {do_tpi}, {do_tpi}, {do_md}, {do_md}, {do_md} };
 
 /* Static variables for temporary use with the deform option */
 static int    init_step_tpx;
@@ -194,7 +198,10 @@ int mdrunner(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
         init_single(fplog,inputrec,ftp2fn(efTPX,nfile,fnm),mtop,state);
     }
     
-    if(inputrec->eI == eiMC) {
+    /* In parallel checkerboard MC sweeps run on domain decomposition,
+     * the other MC moves are evaluated with particle decomposition.
+     */
+    if(inputrec->eI == eiMC && !inputrec->bMCCheckerboard) {
      Flags = Flags | MD_PARTDEC;
     }
 
@@ -298,7 +305,7 @@ int mdrunner(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
         fprintf(stderr,"Loaded with Money\n\n");
     }
     
-    if (PAR(cr) && !((Flags & MD_PARTDEC) || EI_TPI(inputrec->eI) || EI_MC(inputrec->eI)))
+    if (PAR(cr) && !((Flags & MD_PARTDEC) || EI_TPI(inputrec->eI)))
     {
         cr->dd = init_domain_decomposition(fplog,cr,Flags,ddxyz,rdd,rconstr,
                                            dddlb_opt,dlb_scale,
@@ -872,12 +879,17 @@ static void set_nlistheuristics(gmx_nlheur_t *nlh,bool bReset,gmx_step_t step)
 bool accept_mc(real deltaH,real bolt,real t,gmx_mc_move *mc_move)
 {
  bool ok=FALSE;
- real prob=1;
- //if(mc_move->bias)
- //mc_move->bias=1;
- //prob = mc_move->bias*exp(-deltaH/(BOLTZ*t));
- prob = mc_move->bias;
- printf("prob %f bolt %f bias %f delta %f\n",prob,bolt,mc_move->bias,deltaH);
+ real prob=1,bias;
+ /* Moves without mc_move, such as hybrid MC trajectories, are symmetric */
+ bias = (mc_move ? mc_move->bias : 1);
+ if(bias == 0)
+ {
+  return FALSE;
+ }
+ /* Metropolis criterion, the bias corrects for non-symmetric moves
+  * and applies to downhill moves as well.
+  */
+ prob = min(1,bias*exp(-deltaH/(BOLTZ*t)));
  if(prob >= 1)
  {
   ok = TRUE;
@@ -888,6 +900,88 @@ bool accept_mc(real deltaH,real bolt,real t,gmx_mc_move *mc_move)
  }
  return ok;
 }
+
+static void mc_journal_init(gmx_mc_journal *jr,matrix box)
+{
+ jr->start = 0;
+ jr->end   = 0;
+ jr->bBox  = FALSE;
+ copy_mat(box,jr->box);
+ clear_mat(jr->vir);
+ jr->bShifted = FALSE;
+}
+
+/* Record that atoms start to end-1 (and optionally the box) of the trial
+ * state may differ from the last accepted state.
+ */
+static void mc_journal_touch(gmx_mc_journal *jr,int start,int end,bool bBox)
+{
+ if(jr->end <= jr->start)
+ {
+  jr->start = start;
+  jr->end   = end;
+ }
+ else
+ {
+  jr->start = min(jr->start,start);
+  jr->end   = max(jr->end,end);
+ }
+ jr->bBox = jr->bBox || bBox;
+}
+
+/* Make the trial state the accepted state, only the journaled part is copied */
+static void mc_journal_accept(gmx_mc_move *mc_move,t_state *state,
+                              gmx_enerdata_t *enerd,gmx_enerdata_t *enerd_acc,
+                              tensor vir,bool bVir)
+{
+ gmx_mc_journal *jr=&mc_move->journal;
+ int i;
+
+ for(i=jr->start; i<jr->end; i++)
+ {
+  copy_rvec(state->x[i],mc_move->xprev[i]);
+ }
+ if(jr->bBox)
+ {
+  copy_mat(state->box,jr->box);
+ }
+ copy_enerdata(enerd,enerd_acc);
+ if(bVir)
+ {
+  copy_mat(vir,jr->vir);
+ }
+ else
+ {
+  copy_mat(jr->vir,vir);
+ }
+ jr->start = jr->end = 0;
+ jr->bBox  = FALSE;
+}
+
+/* Roll the trial state back to the last accepted state */
+static void mc_journal_reject(gmx_mc_move *mc_move,t_state *state,
+                              gmx_enerdata_t *enerd,gmx_enerdata_t *enerd_acc,
+                              tensor vir)
+{
+ gmx_mc_journal *jr=&mc_move->journal;
+ int i;
+
+ reject_enerd_mc(mc_move);
+
+ for(i=jr->start; i<jr->end; i++)
+ {
+  copy_rvec(mc_move->xprev[i],state->x[i]);
+ }
+ if(jr->bBox)
+ {
+  copy_mat(jr->box,state->box);
+ }
+ copy_enerdata(enerd_acc,enerd);
+ copy_mat(jr->vir,vir);
+ jr->start = jr->end = 0;
+ jr->bBox  = FALSE;
+}
+
 double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
              bool bVerbose,bool bCompact,int nstglobalcomm,
              gmx_vsite_t *vsite,gmx_constr_t constr,
@@ -911,16 +1005,16 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
   double     t,t0,lam0;
   bool       bGStatEveryStep,bGStat,bNstEner,bCalcEner;
   bool       bNS,bNStList,bSimAnn,bStopCM,bRerunMD,bNotLastFrame=FALSE,
-             bFirstStep,bStateFromTPX,bLastStep,bBornRadii;
+             bFirstStep,bStateFromTPX,bLastStep,bBornRadii,bMCRestart=FALSE;
   bool       bDoDHDL=FALSE;
   bool       bNEMD,do_ene,do_log,do_vir,do_verbose,bRerunWarnNoV=TRUE,
 	         bForceUpdate=FALSE,bX,bV,bF,bXTC,bCPT;
   bool       bMasterState;
-  bool       bMC,ok;
+  bool       bMC,bMCIncr=FALSE,bMCVol=FALSE,bMCNS,ok;
   gmx_mc_move *mc_move;
   real       forcex=0,pos=0,pos0=0,forcey=0;  //apagar!
   int        force_flags;
-  tensor     force_vir,force_vircopy,shake_vir,total_vir,av_vir,pres,ekin;
+  tensor     force_vir,shake_vir,total_vir,av_vir,pres,ekin;
   int        i,m,status,nflex;
   rvec       mu_tot;
   t_vcm      *vcm;
@@ -937,7 +1031,7 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
   rvec       *f_global=NULL;
   int        n_xtc=-1;
   rvec       *x_xtc=NULL;
-  gmx_enerdata_t *enerd,*enerdcopy,*enerd2;
+  gmx_enerdata_t *enerd,*enerdcopy=NULL,*enerd2=NULL;
   rvec       *f;
   gmx_global_stat_t gstat;
   gmx_update_t upd=NULL;
@@ -967,13 +1061,23 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
   real        epot_delta=0,volume_delta,deltaH;
   bool        update_box=FALSE,bBOXok=TRUE;
   rvec        box_size;
-  int         seed,ai,aj,ak,a,b,c,d;
+  int         ai,aj,ak,a,b,c,d;
   int         jj;
   real        deltax;
-  gmx_rng_t   rng;
-  gmx_rng_t   rng2;
+  gmx_rng_cb_t rng,rng_accept;
+  gmx_mc_trials_t mc_trials=NULL;
+  gmx_mc_sweep_t  mc_sweep=NULL;
+  gmx_mc_regrow_t mc_regrow=NULL;
+  gmx_mc_adapt_t  mc_adapt=NULL;
+  bool        bMCSweep=FALSE,bMCSweepNext=FALSE,bMCNoMove=FALSE;
+  bool        bMCDD;
+  gmx_mc_dd_t mc_dd=NULL;
+  gmx_mc_hybrid_t mc_hybrid=NULL;
+  bool        bMCHybrid=FALSE;
+  gmx_hmc_t   hmc=NULL;
+  bool        bHMCAccept,bHMCReject=FALSE;
+  int         mc_ac0[MC_NR],mc_tot0[MC_NR];
   real        bolt;
-  real        deltadih; //teste
 #ifdef GMX_FAHCORE
   /* Temporary addition for FAHCORE checkpointing */
   int chkpt_ret;
@@ -986,16 +1090,16 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
     bFFscan  = (Flags & MD_FFSCAN);
     bAppend  = (Flags & MD_APPENDFILES);
 
-    bMC = (ir->eI == eiMC);
+    /* With domain decomposition MC only does checkerboard sweeps */
+    bMC   = (ir->eI == eiMC && !DOMAINDECOMP(cr));
+    bMCDD = (ir->eI == eiMC && DOMAINDECOMP(cr));
     if(bMC) 
     {
-     seed = make_seed();
-     //seed = 24030;  ///*******************
-     seed = 1226842470;
-     rng=gmx_rng_init(seed);
-     seed = make_seed();
-     //seed = 24030;  ///*******************
-     rng2=gmx_rng_init(seed);
+     /* The moves and their acceptance are keyed by the step,
+      * so a continuation does not need to restore a random state.
+      */
+     gmx_rng_cb_init(&rng,ir->ld_seed,erngcbMC);
+     gmx_rng_cb_init(&rng_accept,ir->ld_seed,erngcbMCACCEPT);
     } 
     if (bRerunMD)
     {
@@ -1043,7 +1147,7 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
     snew(enerd,1);
     init_enerdata(top_global->groups.grps[egcENER].nr,ir->n_flambda,enerd);
 
-    if(bMC)
+    if(bMC || bMCDD)
     {
      snew(enerdcopy,1);
      init_enerdata(top_global->groups.grps[egcENER].nr,ir->n_flambda,enerdcopy);
@@ -1111,8 +1215,45 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
       a1 = top_global->natoms;
     }
 
-    state = partdec_init_local_state(cr,state_global);
-    f_global = f;
+    if (Flags & MD_SORTATOMS)
+    {
+        if (PAR(cr) || bRerunMD || bIonize || bFFscan || repl_ex_nst > 0 ||
+            ed || shellfc || bMC || ir->nstmc > 0 ||
+            ftp2bSet(efGCT,nfile,fnm))
+        {
+            if (fplog)
+            {
+                fprintf(fplog,
+                        "\nNOTE: atom sorting is not supported with particle decomposition,\n"
+                        "      rerun, ionization, force field scanning, replica exchange,\n"
+                        "      essential dynamics, shells, Monte Carlo or GCT,\n"
+                        "      the atoms will not be sorted\n\n");
+            }
+        }
+        else
+        {
+            fr->atomsort = init_atomsort(fplog,ir,top_global,top,fr);
+        }
+    }
+
+    if (fr->atomsort)
+    {
+        /* The state and topology are in the sorted atom order */
+        top = atomsort_init_local_top(fr->atomsort);
+
+        snew(state,1);
+        atomsort_init_local_state(fr->atomsort,state_global,state);
+
+        if (ir->nstfout)
+        {
+            snew(f_global,state_global->natoms);
+        }
+    }
+    else
+    {
+        state = partdec_init_local_state(cr,state_global);
+        f_global = f;
+    }
 
     atoms2md(top_global,ir,0,NULL,a0,a1-a0,mdatoms);
 
@@ -1121,7 +1262,8 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
     }
 
 
-    if ((ir->ePBC != epbcNONE && !ir->bPeriodicMols) || bMC) {
+    if ((ir->ePBC != epbcNONE && !ir->bPeriodicMols) || bMC ||
+        ir->nstmc > 0) {
       graph = mk_graph(fplog,&(top->idef),0,top_global->natoms,FALSE,FALSE);
     }
 
@@ -1144,6 +1286,12 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
                             vsite,shellfc,constr,
                             nrnb,wcycle,FALSE);
     }
+    else if (fr->atomsort)
+    {
+        atomsort_partition_system(fplog,ir->init_step,fr->atomsort,
+                                  ir,top_global,state,fr,mdatoms,top,
+                                  vsite,constr,&graph);
+    }
 	
 	/* If not DD, copy gb data */
     if(ir->implicit_solvent && !DOMAINDECOMP(cr))
@@ -1255,6 +1403,7 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
   debug_gmx();
    
   /* Initiate data for the special cases */
+  copy_mat(state->box,boxcopy);
   if (bFFscan || bMC) {
     snew(xcopy,state->natoms);
     if(!bMC)
@@ -1268,20 +1417,22 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
        copy_rvec(state->v[ii],vcopy[ii]);
       }
     }
-    copy_mat(state->box,boxcopy);
   } 
 
   if(bMC) {
    snew(state->mc_move,1);
    mc_move = state->mc_move;
-   init_enerd_mc(mc_move,top,mdatoms->homenr);
    snew(mc_move->group,MC_NR);
    snew(mc_move->bNS,top->cgs.nr+1);
    snew(mc_move->xcm,top_global->mols.nr);
    mc_move->n_mc = FALSE;
    mc_move->cgsnr = top->cgs.nr;
    mc_move->homenr = mdatoms->homenr;
+   mc_move->nthreads = mc_nthreads(ir,cr);
    init_ns_mc(&fr->ns,top,mdatoms,mc_move);
+   init_enerd_mc(fplog,mc_move,ir,fr,top,mdatoms,state->box);
+   mc_trials = init_mc_trials(fplog,ir,mc_move);
+   mc_sweep = init_mc_sweep(fplog,ir,mc_move,&top_global->mols,NULL);
 
    for(ii=0;ii<top->cgs.nr;ii++)
     mc_move->bNS[ii]=TRUE;
@@ -1290,9 +1441,48 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
    mc_move->group[MC_ANGLES].ilist = &top_global->moltype[0].mc_angles;
    mc_move->group[MC_DIHEDRALS].ilist = &top_global->moltype[0].mc_dihedrals;
    mc_move->group[MC_CRA].ilist = &top_global->moltype[0].mc_cra;
+   mc_move->group[MC_REGROW].ilist = &top_global->moltype[0].mc_regrow;
+   mc_regrow = init_mc_regrow(fplog,ir,mc_move);
+   mc_adapt = init_mc_adapt(fplog,ir,state);
+   /* Continue with the accepted energies of a checkpointed run */
+   bMCRestart = ((Flags & MD_STARTFROMCPT) != 0);
   
    mc_move->xprev = xcopy;
+   mc_journal_init(&mc_move->journal,state->box);
    fr->n_mc = FALSE;
+  }
+  if (bMCDD)
+  {
+      if (vsite || shellfc)
+      {
+          gmx_fatal(FARGS,"Monte Carlo with domain decomposition does not support virtual sites or shells");
+      }
+      snew(mc_move,1);
+      mc_move->nthreads = mc_nthreads(ir,cr);
+      init_enerd_mc(fplog,mc_move,ir,fr,top,mdatoms,state->box);
+      mc_dd    = init_mc_dd(fplog,cr,ir,top_global,state->box);
+      mc_sweep = init_mc_sweep(fplog,ir,mc_move,&top_global->mols,mc_dd);
+  }
+  if (ir->nstmc > 0)
+  {
+      if (vsite || shellfc)
+      {
+          gmx_fatal(FARGS,"Hybrid MD/MC does not support virtual sites or shells");
+      }
+      if (DOMAINDECOMP(cr))
+      {
+          mc_dd = init_mc_dd(fplog,cr,ir,top_global,state->box);
+      }
+      mc_hybrid = init_mc_hybrid(fplog,cr,ir,fr,top_global,top,mdatoms,
+                                 state->box,constr != NULL,mc_dd);
+  }
+  if (ir->eI == eiHMC && !bRerunMD)
+  {
+      if (shellfc)
+      {
+          gmx_fatal(FARGS,"Hybrid Monte Carlo does not support shells");
+      }
+      hmc = init_hmc(fplog,cr,ir,top_global->natoms);
   }
     if (MASTER(cr))
     {
@@ -1409,12 +1599,6 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
     }
     bLastStep = (bRerunMD || step_rel > ir->nsteps);
 
-     real dih1,dih2;
-     rvec v1,v2,v3,v4,v5;
-     real f1,f2,f3;
-     int i1,i2,i3;
-     int hey1,hey2,hey3,hey4;
-
     while (!bLastStep || (bRerunMD && bNotLastFrame)) {
         
         wallcycle_start(wcycle,ewcSTEP);
@@ -1543,12 +1727,14 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
             }
             bNStList = (ir->nstlist > 0  && step % ir->nstlist == 0);
 
-            bNS = (bFirstStep || bExchanged || bNStList ||
+            bNS = (bFirstStep || bExchanged || bMCHybrid || bHMCReject ||
+                   bMCDD || bNStList ||
                    (ir->nstlist == -1 && nlh.nabnsb > 0));
             
             if (bNS && ir->nstlist == -1)
             {
-                set_nlistheuristics(&nlh,bFirstStep || bExchanged,step);
+                set_nlistheuristics(&nlh,bFirstStep || bExchanged ||
+                                    bMCHybrid || bHMCReject,step);
             }
         } 
         
@@ -1603,12 +1789,19 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
                                     nrnb,wcycle,do_verbose);
                 wallcycle_stop(wcycle,ewcDOMDEC);
             }
+            else if (fr->atomsort)
+            {
+                /* Sort the atoms on their ns grid cell */
+                atomsort_partition_system(fplog,step,fr->atomsort,
+                                          ir,top_global,state,fr,mdatoms,top,
+                                          vsite,constr,&graph);
+            }
         }
         
         if (MASTER(cr) && do_log && !bFFscan)
         {
             print_ebin_header(fplog,step,t,state->lambda);
-            if(bMC) {
+            if(bMC || bMCDD) {
              print_mc_ratio(fplog,state->step_ac,state->step_tot,state->vol_ac,state->vol_tot);
             }
         }
@@ -1686,7 +1879,11 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
         do_ene = (do_per_step(step,ir->nstenergy) || bLastStep);
 
         if(bMC) {
-         do_vir = (do_per_step(step,ir->nstvir) || bLastStep);
+         /* Checkpoint steps are evaluated as the last step of a run,
+          * the first step of the continuation then has the same virial.
+          */
+         do_vir = (do_per_step(step,ir->nstvir) || bLastStep || bCPT ||
+                   bFirstStep);
         }
         
         if (do_ene || do_log || do_vir)
@@ -1737,12 +1934,21 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
              * This is parallellized as well, and does communication too. 
              * Check comments in sim_util.c
              */
-     hey1=127;hey2=129;hey3=144;hey4=146;
-     dih1 = dih_angle(state->x[hey1],state->x[hey2],state->x[hey3],state->x[hey4],NULL,v1,v2,v3,v4,v5,&f1,&f2,&i1,&i2,&i3);
-     printf("\ndih1_0 %f\n\n",dih1*180/M_PI);
             if(bMC)
             {
-              if(step_rel && !update_box && !do_ene && !do_vir) {
+              /* Single molecule moves are evaluated locally when possible */
+              bMCIncr = (step_rel && !update_box && !do_ene && !do_vir &&
+                         enerd_mc_incremental(mc_move));
+              bMCVol  = (step_rel && update_box && bBOXok && !do_ene && !do_vir &&
+                         ir->bMCVolumeFast &&
+                         volume_enerd_mc_supported(mc_move,fr,state->box));
+              if(bMCIncr || bMCVol)
+              {
+               /* Nothing outside the moved molecule changes,
+                * volume moves only change intermolecular distances
+                */
+              }
+              else if(step_rel && !update_box && !do_ene && !do_vir) {
                set_bexclude_mc(top,mc_move,fr,FALSE);
               }
               else
@@ -1751,175 +1957,256 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
                mc_move->start = mdatoms->start;
                mc_move->end = mdatoms->homenr;
               }
-              if(!fr->n_mc || bNS)
+              if(!bMCIncr && !bMCVol && (!fr->n_mc || bNS))
               {
                for(ii=0;ii<top->cgs.nr+1;ii++)
                 mc_move->bNS[ii]=TRUE;
               }
-              
             }
-            //printf("step %d\n",(int)step_rel);
+            /* A sweep was chosen instead of a move at the previous update,
+             * when this step needs a full evaluation the unchanged
+             * configuration is evaluated instead.
+             */
+            bMCSweep     = (bMCSweepNext && bMCIncr);
+            bMCNoMove    = (bMCSweepNext && !bMCSweep);
+            bMCSweepNext = FALSE;
+            if(bMCSweep)
+            {
+              for(ii=0; ii<MC_NR; ii++)
+              {
+               mc_ac0[ii]  = state->step_ac[ii];
+               mc_tot0[ii] = state->step_tot[ii];
+              }
+              wallcycle_start(wcycle,ewcMC_SWEEP);
+              do_mc_sweep(mc_sweep,enerd,enerdcopy,mc_move,ir,fr,top,
+                          &top_global->mols,mdatoms,fcd,step,state->box,
+                          xcopy,state->x,state->lambda,
+                          state->step_ac,state->step_tot);
+              wallcycle_stop(wcycle,ewcMC_SWEEP);
+              for(ii=0; ii<MC_NR; ii++)
+              {
+               wallcycle_mc_count(wcycle,ii,state->step_ac[ii]-mc_ac0[ii],
+                                  state->step_tot[ii]-mc_tot0[ii]);
+              }
+            }
+            else if(bMCIncr && mc_regrow_applicable(mc_regrow,mc_move))
+            {
+              wallcycle_start(wcycle,ewcMC_ENER);
+              epot_delta = do_mc_regrow(mc_regrow,enerd,enerdcopy,mc_move,ir,
+                                        fr,top,mdatoms,fcd,graph,step,
+                                        state->box,xcopy,state->x,
+                                        state->lambda);
+              wallcycle_stop(wcycle,ewcMC_ENER);
+            }
+            else if(bMCIncr && mc_trials_applicable(mc_trials,mc_move))
+            {
+              wallcycle_start(wcycle,ewcMC_ENER);
+              epot_delta = do_mc_trials(mc_trials,enerd,enerdcopy,mc_move,ir,
+                                        fr,top,mdatoms,fcd,step,state->box,
+                                        xcopy,state->x,state->lambda);
+              wallcycle_stop(wcycle,ewcMC_ENER);
+            }
+            else if(bMCIncr)
+            {
+              wallcycle_start(wcycle,ewcMC_ENER);
+              epot_delta = delta_enerd_mc(enerd,enerdcopy,mc_move,fr,top,
+                                          mdatoms,fcd,state->box,
+                                          xcopy,state->x,state->lambda);
+              wallcycle_stop(wcycle,ewcMC_ENER);
+            }
+            else if(bMCVol)
+            {
+              wallcycle_start(wcycle,ewcMC_ENER);
+              epot_delta = delta_volume_enerd_mc(enerd,enerdcopy,mc_move,fr,top,
+                                                 mdatoms,&top_global->mols,
+                                                 mc_move->journal.box,
+                                                 state->box,state->x);
+              wallcycle_stop(wcycle,ewcMC_ENER);
+            }
+            else
+            {
+            /* With MC the pair list stays valid until an atom moved
+             * more than half the buffer since the search, volume moves
+             * change all distances and twin-range energies are only
+             * computed during the search.
+             */
+            bMCNS = (bMC && (update_box || fr->bTwinRange ||
+                             natoms_beyond_ns_buffer(ir,fr,&top->cgs,
+                                                     NULL,state->x) > 0));
             do_force(fplog,cr,ir,step,nrnb,wcycle,top,top_global,groups,
                      state->box,state->x,&state->hist,bMC ? mc_move : NULL,
                      f,force_vir,mdatoms,enerd,fcd,
                      state->lambda,graph,
                      fr,vsite,mu_tot,t,fp_field,ed,bBornRadii,
-                     (bNS ? GMX_FORCE_NS : 0) | force_flags);
-            if(bMC) {
+                     ((bNS || bMCNS) ? GMX_FORCE_NS : 0) | force_flags);
+            if(bMC && (bNS || bMCNS))
+            {
+             /* The search puts all atoms in the box. This does not change
+              * the Ewald structure factors, so do_force could still use
+              * the journal of the move for the reciprocal energy.
+              */
+             mc_journal_touch(&mc_move->journal,mdatoms->start,
+                              mdatoms->start+mdatoms->homenr,FALSE);
+            }
+            if(bMC && graph)
+            {
+             /* MC keeps x whole, update undoes the graph shifts */
+             mc_move->journal.bShifted = TRUE;
+            }
+            }
+            if(bMC && !bMCSweep) {
+             wallcycle_start(wcycle,ewcMC_ACCEPT);
              if(step_rel) {
-
-              //epot_delta = delta_enerd_mc(enerd,enerdcopy,top,mc_move,&top->idef,fr,mdatoms->homenr);
-
-              sub_enerdata(enerd,enerdcopy,enerd2);
-              epot_delta = enerd2->term[F_EPOT];
-              for(ii=0;ii<F_NRE;ii++) {
-               if(enerd->term[ii] && 1 == 2)
-               printf("enerdp %f  %f %d %d %d\n",enerd2->term[ii],enerdcopy->term[ii],ii,(int)step_rel,mc_move->mvgroup);
+              if(!bMCIncr && !bMCVol) {
+               sub_enerdata(enerd,enerdcopy,enerd2);
+               epot_delta = enerd2->term[F_EPOT];
               }
-            //printf("to aki %d %f\n",(int)step_rel,epot_delta);
-              //if(!update_box)
-               //sum_enerdata(enerd2,enerd,enerd);
-
-            //printf("enerd1 %f\n",enerd->term[F_EPOT]);
              }
              else 
              {
               copy_enerdata(enerd,enerdcopy);
-              //mc_move->bNS[mc_move->cgs] = FALSE;
+              if (bMCRestart)
+              {
+               /* Continue with the accepted energies of the checkpoint */
+               for(ii=0; ii<F_NRE; ii++)
+               {
+                enerdcopy->term[ii] = state->mc_ener[ii];
+               }
+              }
              }
 
              deltaH = epot_delta;
              if(update_box) {
-              volume_delta    = det(state->box) - det(boxcopy);
+              volume_delta    = det(state->box) - det(mc_move->journal.box);
               deltaH += ir->ref_p[XX][XX]*volume_delta/PRESFAC;
-              deltaH -= top_global->mols.nr*BOLTZ*ir->opts.ref_t[0]*log(det(state->box)/det(boxcopy));
+              deltaH -= top_global->mols.nr*BOLTZ*ir->opts.ref_t[0]*log(det(state->box)/det(mc_move->journal.box));
              }
 
-             bolt = gmx_rng_uniform_real(rng);
-             if(fr->bEwald && bMC && 1 == 2) 
-             {
-              if (step_rel && !update_box && 1 == 2 && !(deltaH <= 0 || (deltaH > 0 && exp(-deltaH/(BOLTZ*ir->opts.ref_t[0])) > 0.4*bolt)))
-              {
-               bolt = 2;  /* Preliminary energy check (without recip PME) */
-              }
-              else
-              {
-               do_recip_mc(fplog,step,fr,ir,&(top->idef),
-                      cr,nrnb,wcycle,mdatoms,&(ir->opts),
-                      state->x,&state->hist,f,enerd,fcd,fr->born,
-                      &(top->atomtypes),bBornRadii,state->box,
-                      state->lambda,graph,&(top->excls),fr->mu_tot,
-                      force_flags,NULL,mc_move);
-              
-        if (force_flags & GMX_FORCE_VIRIAL)
-        {
-            virial_mc(fr,mdatoms,f,force_vir);
-        }
-               deltaH += enerd->term[F_COUL_RECIP] - mc_move->enerd_prev[F_COUL_RECIP][0];
-               //deltaH += enerd->term[F_COUL_RECIP];
-               enerd->term[F_EPOT] += enerd->term[F_COUL_RECIP];
-              for(ii=0;ii<F_NRE;ii++) {
-               if(enerd->term[ii] && 1 == 2)
-               printf("enerd %f %f %d %d %d %f\n",enerd->term[ii],enerdcopy->term[ii],ii,mc_move->mvgroup,(int)step_rel,state->x[0][0]);
-              }
-              }
-             }
- printf("bias md %f\n",mc_move->bias);
+             /* The first step only evaluates the starting configuration */
+             gmx_rng_cb_restart(&rng_accept,step,0);
+             bolt = (step_rel ? gmx_rng_cb_uniform_real(&rng_accept) : 0);
              if(bBOXok) {
-              /*if (accept_mc(deltaH,bolt,ir->opts.ref_t[0],mc_move)) {
-                printf("\n\n\nto aki\n\n\n");
-                for(ii=mdatoms->start; ii<(mdatoms->start+mdatoms->homenr); ii++) {
-                 copy_rvec(xcopy[ii],state->x[ii]);
-                }
-                state->step_ac[mc_move->mvgroup]++;
-                copy_mat(boxcopy,state->box);
-                copy_enerdata(enerdcopy,enerd);
-                copy_mat(force_vircopy,force_vir);
-              }*/
               if (!step_rel || accept_mc(deltaH,bolt,ir->opts.ref_t[0],mc_move)) {
                mc_move->bNS[mc_move->cgs] = TRUE;
-     dih1 = dih_angle(xcopy[hey1],xcopy[hey2],xcopy[hey3],xcopy[hey4],NULL,v1,v2,v3,v4,v5,&f1,&f2,&i1,&i2,&i3);
-     dih2 = dih_angle(state->x[hey1],state->x[hey2],state->x[hey3],state->x[hey4],NULL,v1,v2,v3,v4,v5,&f1,&f2,&i1,&i2,&i3);
-     deltadih = dih2-dih1;
-     enerd->term[F_EPOT]=deltadih*180/M_PI;
-     enerd->term[F_BONDS]=mc_move->gauss;
-     enerd->term[F_ANGLES]=mc_move->d2;
-     printf("deltadih %f %f %f\n",deltadih,dih1,dih2);
-     if(dih2-dih1 < 0)
-     printf("\n\n\ntatatatata %f %f %f\n\n\n",(dih2-dih1),dih1,dih2);
-               if(update_box) {
-                state->vol_ac++;
-               }
-               else 
+               wallcycle_start(wcycle,ewcMC_NS);
+               if(bMCIncr)
                {
-                state->step_ac[mc_move->mvgroup]++;
-               }
-
-               for(ii=mdatoms->start; ii<(mdatoms->start+mdatoms->homenr); ii++) {
-                copy_rvec(state->x[ii],xcopy[ii]);
-               }
-               copy_mat(state->box,boxcopy);
-               /*if((!update_box && do_ene) || do_vir) {
-                do_force(fplog,cr,ir,step,nrnb,wcycle,top,top_global,groups,
-                     state->box,state->x,&state->hist,mc_move,
-                     f,force_vir,mdatoms,enerd,fcd,
-                     state->lambda,graph,
-                     fr,vsite,mu_tot,t,fp_field,ed,bBornRadii,
-                     (bNS ? GMX_FORCE_NS : 0) | force_flags);
-               }*/
-               copy_enerdata(enerd,enerdcopy);
-               //clean_enerd_mc(mc_move,top,fr,mdatoms->homenr,TRUE);
-               if(do_vir)
-               {
-                copy_mat(force_vir,force_vircopy);
+                commit_enerd_mc(mc_move,top);
                }
                else
                {
-                copy_mat(force_vircopy,force_vir);
+                reset_enerd_mc(mc_move,fr,top,mdatoms,state->box,state->x);
                }
+               wallcycle_stop(wcycle,ewcMC_NS);
+               if(step_rel && !bMCNoMove) {
+                if(update_box) {
+                 state->vol_ac++;
+                }
+                else 
+                {
+                 state->step_ac[mc_move->mvgroup]++;
+                }
+                wallcycle_mc_count(wcycle,update_box ? MC_NR : mc_move->mvgroup,
+                                   1,0);
+               }
+
+               mc_journal_accept(mc_move,state,enerd,enerdcopy,
+                                 force_vir,do_vir);
               }
               else {
-               //clean_enerd_mc(mc_move,top,fr,mdatoms->homenr,FALSE);
                if (DOMAINDECOMP(cr)) {
                }
                else {
-                for(ii=mdatoms->start; ii<(mdatoms->start+mdatoms->homenr); ii++) {
-                 copy_rvec(xcopy[ii],state->x[ii]);
-                }
-                copy_mat(boxcopy,state->box);
-                copy_enerdata(enerdcopy,enerd);
-                copy_mat(force_vircopy,force_vir);
+                mc_journal_reject(mc_move,state,enerd,enerdcopy,force_vir);
                }
               }
              }
              else
              {
-             // clean_enerd_mc(mc_move,top,fr,mdatoms->homenr,FALSE);
-                for(ii=mdatoms->start; ii<(mdatoms->start+mdatoms->homenr); ii++) {
-                 copy_rvec(xcopy[ii],state->x[ii]);
-                }
-                copy_mat(boxcopy,state->box);
-                copy_enerdata(enerdcopy,enerd);
-                copy_mat(force_vircopy,force_vir);
+              mc_journal_reject(mc_move,state,enerd,enerdcopy,force_vir);
              }
              if(PAR(cr))
              {
-              gmx_bcast(sizeof(boxcopy),boxcopy,cr);
+              gmx_bcast(sizeof(mc_move->journal.box),mc_move->journal.box,cr);
               gmx_bcast(sizeof(xcopy),xcopy,cr);
              }
             
-             if(update_box) {
-              state->vol_tot++;
+             if(step_rel && !bMCNoMove) {
+              if(update_box) {
+               state->vol_tot++;
+              }
+              else
+              {
+               state->step_tot[mc_move->mvgroup]++;
+              }
+              wallcycle_mc_count(wcycle,update_box ? MC_NR : mc_move->mvgroup,
+                                 0,1);
              }
-             else
+             if(bCPT && step_rel && fr->ePBC != epbcNONE)
              {
-              state->step_tot[mc_move->mvgroup]++;
+              /* Write the configuration as a continuation reads it,
+               * with the charge groups in the box, also after a rejection.
+               */
+              put_charge_groups_in_box(fplog,0,top->cgs.nr,fr->ePBC,
+                                       state->box,&top->cgs,state->x,
+                                       fr->cg_cm);
              }
+             wallcycle_stop(wcycle,ewcMC_ACCEPT);
+            }
+            if(bMC && mc_adapt && step_rel && !bMCNoMove)
+            {
+             mc_adapt_step(fplog,mc_adapt,ir,state,step,
+                           update_box ? MC_NR : mc_move->mvgroup);
+            }
+        }
+
+        if (hmc)
+        {
+            /* Hybrid MC: accept or reject the trajectory ending at this
+             * configuration and start the next one from the result.
+             */
+            bHMCReject = FALSE;
+            if (!bFirstStep && do_per_step(step,ir->hmc_nsteps))
+            {
+                wallcycle_start(wcycle,ewcMC_ACCEPT);
+                deltaH = hmc_end(hmc,cr,ir,step,mdatoms,constr,&top->idef,
+                                 state,f,enerd,nrnb,&bolt);
+                bHMCAccept = accept_mc(deltaH,bolt,ir->opts.ref_t[0],NULL);
+                hmc_finish(hmc,cr,bHMCAccept,mdatoms,state,f,enerd,force_vir,
+                           state_global);
+                bHMCReject = !bHMCAccept;
+                wallcycle_stop(wcycle,ewcMC_ACCEPT);
+                if (debug)
+                {
+                    fprintf(debug,"Hybrid MC trajectory at step %s: dH %g %s\n",
+                            gmx_step_str(step,sbuf),deltaH,
+                            bHMCAccept ? "accepted" : "rejected");
+                }
+                if (bHMCReject && DOMAINDECOMP(cr))
+                {
+                    /* The atoms moved between domains during the trajectory,
+                     * redistribute the start configuration and recompute
+                     * its forces.
+                     */
+                    dd_partition_system(fplog,step,cr,TRUE,1,
+                                        state_global,top_global,ir,
+                                        state,&f,mdatoms,top,fr,
+                                        vsite,shellfc,constr,
+                                        nrnb,wcycle,FALSE);
+                    do_force(fplog,cr,ir,step,nrnb,wcycle,top,top_global,
+                             groups,state->box,state->x,&state->hist,NULL,
+                             f,force_vir,mdatoms,enerd,fcd,
+                             state->lambda,graph,
+                             fr,vsite,mu_tot,t,fp_field,ed,bBornRadii,
+                             GMX_FORCE_NS | force_flags);
+                }
+            }
+            if (bFirstStep || do_per_step(step,ir->hmc_nsteps))
+            {
+                hmc_start(hmc,cr,ir,step,mdatoms,constr,&top->idef,
+                          state,f,enerd,force_vir,nrnb);
             }
         }
-              if(bMC && !update_box && !do_ene && !do_vir) {
-               set_bexclude_mc(top,mc_move,fr,FALSE);
-              }
         GMX_BARRIER(cr->mpi_comm_mygroup);
         
         if (bTCR)
@@ -1967,6 +2254,13 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
                 {
                     get_stochd_state(upd,state);
                 }
+                if (bMC)
+                {
+                    for(ii=0; ii<F_NRE; ii++)
+                    {
+                        state->mc_ener[ii] = enerdcopy->term[ii];
+                    }
+                }
                 if (MASTER(cr))
                 {
                     if (bSumEkinhOld)
@@ -1981,16 +2275,33 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
                     update_energyhistory(&state_global->enerhist,mdebin);
                 }
             }
-     rvec v1,v2,v3,v4,v5;
-     real f1,f2;
-     int i1,i2,i3;
-     real dih1;
-     dih1 = dih_angle(state->x[hey1],state->x[hey2],state->x[hey3],state->x[hey4],NULL,v1,v2,v3,v4,v5,&f1,&f2,&i1,&i2,&i3);
-     printf("\ndih1_2 %f\n\n",dih1*180/M_PI);
+            if (fr->atomsort)
+            {
+                /* Put the atoms back in the global order for output */
+                if (bCPT)
+                {
+                    atomsort_collect_state(fr->atomsort,state,state_global);
+                }
+                else
+                {
+                    if (bX || bXTC)
+                    {
+                        atomsort_collect_vec(fr->atomsort,state->x,
+                                             state_global->x);
+                    }
+                    if (bV)
+                    {
+                        atomsort_collect_vec(fr->atomsort,state->v,
+                                             state_global->v);
+                    }
+                }
+                if (bF)
+                {
+                    atomsort_collect_vec(fr->atomsort,f,f_global);
+                }
+            }
             write_traj(fplog,cr,fp_trn,bX,bV,bF,fp_xtc,bXTC,ir->xtcprec,fn_cpt,bCPT,
                        top_global,ir->eI,ir->simulation_part,step,t,state,state_global,f,f_global,&n_xtc,&x_xtc);
-     dih1 = dih_angle(state->x[4],state->x[19],state->x[17],state->x[18],NULL,v1,v2,v3,v4,v5,&f1,&f2,&i1,&i2,&i3);
-     //printf("dih1 %f\n",dih1*180/M_PI);
             debug_gmx();
             if (bLastStep && step_rel == ir->nsteps &&
                 (Flags & MD_CONFOUT) && MASTER(cr) &&
@@ -2013,6 +2324,25 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
             wallcycle_stop(wcycle,ewcTRAJ);
         }
         GMX_MPE_LOG(ev_output_finish);
+
+        if (bMC && (bCPT ? step_rel : !step_rel))
+        {
+            /* Continue after a checkpoint as a continuation does after
+             * its first force call: with the molecules shifted by the graph,
+             * the previous coordinates equal to the current ones
+             * and the incremental data based on them.
+             */
+            if (bCPT && graph)
+            {
+                mk_mshift(fplog,graph,fr->ePBC,state->box,state->x);
+                shift_self(graph,state->box,state->x);
+            }
+            for(ii=mdatoms->start; ii<mdatoms->start+mdatoms->homenr; ii++)
+            {
+                copy_rvec(state->x[ii],xcopy[ii]);
+            }
+            reset_enerd_mc(mc_move,fr,top,mdatoms,state->box,state->x);
+        }
         
         clear_mat(shake_vir);
         
@@ -2027,7 +2357,31 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
         /* This is also parallellized, but check code in update.c */
         /* bOK = update(nsb->natoms,START(nsb),HOMENR(nsb),step,state->lambda,&ener[F_DVDL], */
         bOK = TRUE;
-        if (!bRerunMD || rerun_fr.bV || bForceUpdate || bMC)
+        if (bMCDD)
+        {
+            /* A checkerboard sweep instead of the update, on a
+             * decomposition that is shifted randomly with respect
+             * to the molecules. The next step repartitions again.
+             */
+            mc_dd_shift(mc_dd,step,mdatoms->homenr,state->x);
+            wallcycle_start(wcycle,ewcDOMDEC);
+            dd_partition_system(fplog,step,cr,FALSE,1,
+                                state_global,top_global,ir,
+                                state,&f,mdatoms,top,fr,
+                                vsite,shellfc,constr,
+                                nrnb,wcycle,FALSE);
+            wallcycle_stop(wcycle,ewcDOMDEC);
+            wallcycle_start(wcycle,ewcMC_SWEEP);
+            dd_move_x(cr->dd,state->box,state->x);
+            mc_dd_set_local(mc_dd,mc_move,fr,top,mdatoms,state->box,state->x);
+            do_mc_sweep(mc_sweep,enerd,enerdcopy,mc_move,ir,fr,top,
+                        mc_dd_mols(mc_dd),mdatoms,fcd,step,state->box,
+                        mc_dd_xprev(mc_dd),state->x,state->lambda,
+                        state->step_ac,state->step_tot);
+            mc_dd_unshift(mc_dd,mdatoms->homenr,state->x);
+            wallcycle_stop(wcycle,ewcMC_SWEEP);
+        }
+        else if (!bRerunMD || rerun_fr.bV || bForceUpdate || bMC)
         {
             wallcycle_start(wcycle,ewcUPDATE);
             dvdl = 0;
@@ -2039,18 +2393,19 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
              */
             if(bMC) 
             {
-             do {
-              ii=(int)(gmx_rng_uniform_real(rng)*top_global->mols.nr);
-             } while(ii >= top_global->mols.nr);
+             wallcycle_start(wcycle,ewcMC_MOVE);
+             gmx_rng_cb_restart(&rng,step,0);
+             ii = gmx_rng_cb_uniform_int(&rng,top_global->mols.nr);
              mc_move->mol = ii;
              mc_move->start = top_global->mols.index[ii];
              mc_move->end = top_global->mols.index[ii+1];
              mc_move->nr = mc_move->end - mc_move->start;
 
 
-             if (ir->nst_p && step_rel && !(step_rel % ir->nst_p)) {
+             /* Use the absolute step, so continuations keep the schedule */
+             if (ir->nst_p && step && !(step % ir->nst_p)) {
               update_box = TRUE;
-              mc_move->delta_v = (2.0*gmx_rng_uniform_real(rng)-1.0)*ir->volume;
+              mc_move->delta_v = (2.0*gmx_rng_cb_uniform_real(&rng)-1.0)*ir->volume;
              }
              else
               update_box = FALSE;
@@ -2063,7 +2418,14 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
             {
              if(mc_move->nr > 1)
              {
-              mc_move->mvgroup = uniform_int(rng,MC_NR);
+              if(mc_adapt)
+              {
+               mc_move->mvgroup = mc_adapt_select(mc_adapt,state,&rng);
+              }
+              else
+              {
+               mc_move->mvgroup = gmx_rng_cb_uniform_int(&rng,MC_NR);
+              }
              }
              else
              {
@@ -2077,7 +2439,7 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
                if(ir->cm_translate)
                {
                 for (ii=0;ii<DIM;ii++) {
-                 mc_move->delta_x[ii] = (2.0*gmx_rng_uniform_real(rng)-1.0)*ir->cm_translate;
+                 mc_move->delta_x[ii] = (2.0*gmx_rng_cb_uniform_real(&rng)-1.0)*ir->cm_translate;
                 }
                 ok=TRUE;
                }
@@ -2085,7 +2447,7 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
               case MC_ROTATEX:
                if(ir->cm_rot)
                {
-                mc_move->delta_phi[XX] = M_PI*(2.0*gmx_rng_uniform_real(rng)-1.0)*ir->cm_rot/180.0;
+                mc_move->delta_phi[XX] = M_PI*(2.0*gmx_rng_cb_uniform_real(&rng)-1.0)*ir->cm_rot/180.0;
                 mc_move->delta_phi[YY] = 0.0;
                 mc_move->delta_phi[ZZ] = 0.0;
                 ok=TRUE;
@@ -2094,7 +2456,7 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
               case MC_ROTATEY:
                if(ir->cm_rot)
                {
-                mc_move->delta_phi[YY] = M_PI*(2.0*gmx_rng_uniform_real(rng)-1.0)*ir->cm_rot/180.0;
+                mc_move->delta_phi[YY] = M_PI*(2.0*gmx_rng_cb_uniform_real(&rng)-1.0)*ir->cm_rot/180.0;
                 mc_move->delta_phi[XX] = 0.0;
                 mc_move->delta_phi[ZZ] = 0.0;
                 ok=TRUE;
@@ -2103,7 +2465,7 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
               case MC_ROTATEZ:
                if(ir->cm_rot)
                {
-                mc_move->delta_phi[ZZ] = M_PI*(2.0*gmx_rng_uniform_real(rng)-1.0)*ir->cm_rot/180.0;
+                mc_move->delta_phi[ZZ] = M_PI*(2.0*gmx_rng_cb_uniform_real(&rng)-1.0)*ir->cm_rot/180.0;
                 mc_move->delta_phi[YY] = 0.0;
                 mc_move->delta_phi[XX] = 0.0;
                 ok=TRUE;
@@ -2112,29 +2474,28 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
               case MC_BONDS:
                if((mc_move->group[MC_BONDS].ilist)->nr > 0 && ir->bond_stretch)  
                {
-                jj = uniform_int(rng,(mc_move->group[MC_BONDS].ilist)->nr/2);
-                deltax=(2*gmx_rng_uniform_real(rng)-1.0)*ir->bond_stretch;
-                set_mcmove(&(mc_move->group[MC_BONDS]),rng,deltax,2,mc_move->start,jj);
+                jj = gmx_rng_cb_uniform_int(&rng,(mc_move->group[MC_BONDS].ilist)->nr/2);
+                deltax=(2*gmx_rng_cb_uniform_real(&rng)-1.0)*ir->bond_stretch;
+                set_mcmove(&(mc_move->group[MC_BONDS]),&rng,deltax,2,mc_move->start,jj);
                 ok=TRUE;
                }
                break;
               case MC_ANGLES:
                if((mc_move->group[MC_ANGLES].ilist)->nr > 0 && ir->angle_bend) 
                {
-                jj = uniform_int(rng,(mc_move->group[MC_ANGLES].ilist)->nr/3);
-                deltax=(2*gmx_rng_uniform_real(rng)-1.0)*ir->angle_bend*M_PI/180.0;
-                set_mcmove(&(mc_move->group[MC_ANGLES]),rng,deltax,3,mc_move->start,jj);
+                jj = gmx_rng_cb_uniform_int(&rng,(mc_move->group[MC_ANGLES].ilist)->nr/3);
+                deltax=(2*gmx_rng_cb_uniform_real(&rng)-1.0)*ir->angle_bend*M_PI/180.0;
+                set_mcmove(&(mc_move->group[MC_ANGLES]),&rng,deltax,3,mc_move->start,jj);
                 ok=TRUE;
                }
                break;
               case MC_DIHEDRALS:
                if((mc_move->group[MC_DIHEDRALS].ilist)->nr > 0 && ir->dihedral_rot) 
                {
-             printf("step2 %d\n",step_rel);
-                jj = uniform_int(rng,(mc_move->group[MC_DIHEDRALS].ilist)->nr/2);
-                deltax=(2*gmx_rng_uniform_real(rng)-1.0)*ir->dihedral_rot*M_PI/180.0;
+                jj = gmx_rng_cb_uniform_int(&rng,(mc_move->group[MC_DIHEDRALS].ilist)->nr/2);
+                deltax=(2*gmx_rng_cb_uniform_real(&rng)-1.0)*ir->dihedral_rot*M_PI/180.0;
                 //deltax=30*M_PI/180.0;
-                set_mcmove(&(mc_move->group[MC_DIHEDRALS]),rng,deltax,2,mc_move->start,jj);
+                set_mcmove(&(mc_move->group[MC_DIHEDRALS]),&rng,deltax,2,mc_move->start,jj);
                 ok=TRUE;
                }
                break;
@@ -2144,24 +2505,49 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
                 ok=TRUE;
                }
                break;
+              case MC_REGROW:
+               if(mc_regrow)
+               {
+                /* The torsions are generated when the move is evaluated */
+                jj = gmx_rng_cb_uniform_int(&rng,(mc_move->group[MC_REGROW].ilist)->nr/2);
+                set_mcmove(&(mc_move->group[MC_REGROW]),&rng,0,2,mc_move->start,jj);
+                ok=TRUE;
+               }
+               break;
             }
            } while(!ok);
+           /* Replace a rigid move by a sweep over all molecules before
+            * the move is made, so no move is generated and discarded.
+            */
+           bMCSweepNext = (!update_box &&
+                           mc_sweep_applicable(mc_sweep,mc_move));
+           wallcycle_mc_group(wcycle,bMCSweepNext ? -1 :
+                              (update_box ? MC_NR : mc_move->mvgroup));
+           }
+           if(bMC)
+           {
+            mc_move->bias = 1;
            }
-           mc_move->bias = 1;
+           if(!bMCSweepNext)
+           {
             update(fplog,step,&dvdl,ir,mdatoms,state,graph,
                    f,fr->bTwinRange && bNStList,fr->f_twin,fcd,
                    &top->idef,ekind,ir->nstlist==-1 ? &nlh.scale_tot : NULL,
                    cr,fr,nrnb,&top_global->mols,wcycle,upd,constr,bCalcEner,shake_vir,
-                   bNEMD,bFirstStep && bStateFromTPX,rng,rng2,mc_move);
+                   bNEMD,bFirstStep && bStateFromTPX,&rng,mc_move);
+           }
             //rvec_sub(state->x[73],state->x[75],v1);
             //printf("heyb %f\n",norm(v1));
-            if(mc_move->bias == 0)
+            if(bMC && bMCSweepNext)
             {
-             printf("step %d\n",step_rel);
+             wallcycle_stop(wcycle,ewcMC_MOVE);
             }
-             printf("step %d\n",step_rel);
-            if(bMC) 
+            else if(bMC) 
             {
+             mc_journal_touch(&mc_move->journal,
+                              update_box ? mdatoms->start : mc_move->start,
+                              update_box ? mdatoms->start+mdatoms->homenr : mc_move->end,
+                              update_box);
              if(update_box) {
               bBOXok=TRUE;
               for(m=0; (m<DIM); m++)
@@ -2181,12 +2567,10 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
                }
               }
               if (!bBOXok) {
-               for(ii=0; (ii<state->natoms); ii++) {
-                copy_rvec(xcopy[ii],state->x[ii]);
-               }
-               copy_mat(boxcopy,state->box);
+               mc_journal_reject(mc_move,state,enerd,enerdcopy,force_vir);
               }
              }
+             wallcycle_stop(wcycle,ewcMC_MOVE);
             }
             if (fr->bSepDVDL && fplog && do_log)
             {
@@ -2591,6 +2975,44 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
             print_time(stderr,runtime,step,ir);
         }
         
+        /* Hybrid MD/MC: an MC sweep on the configuration of the next step */
+        bMCHybrid = FALSE;
+        if (mc_hybrid && (step > 0) && !bLastStep &&
+            do_per_step(step,ir->nstmc))
+        {
+            if (mc_dd)
+            {
+                /* Shift the decomposition randomly with respect to
+                 * the molecules, as for checkerboard MC sweeps.
+                 */
+                mc_dd_shift(mc_dd,step,mdatoms->homenr,state->x);
+                wallcycle_start(wcycle,ewcDOMDEC);
+                dd_partition_system(fplog,step,cr,FALSE,1,
+                                    state_global,top_global,ir,
+                                    state,&f,mdatoms,top,fr,
+                                    vsite,shellfc,constr,
+                                    nrnb,wcycle,FALSE);
+                wallcycle_stop(wcycle,ewcDOMDEC);
+                dd_move_x(cr->dd,state->box,state->x);
+            }
+            wallcycle_start(wcycle,ewcMC_SWEEP);
+            epot_delta = do_mc_hybrid(mc_hybrid,fplog,ir,fr,top,
+                                      &top_global->mols,mdatoms,fcd,graph,
+                                      step,state->box,state->x,state->v,
+                                      state->lambda);
+            wallcycle_stop(wcycle,ewcMC_SWEEP);
+            if (mc_dd)
+            {
+                mc_dd_unshift(mc_dd,mdatoms->homenr,state->x);
+            }
+            if (debug)
+            {
+                fprintf(debug,"Hybrid MC sweep at step %s: dEpot %g\n",
+                        gmx_step_str(step,sbuf),epot_delta);
+            }
+            bMCHybrid = TRUE;
+        }
+
         /* Replica exchange */
         bExchanged = FALSE;
         if ((repl_ex_nst > 0) && (step > 0) && !bLastStep &&
@@ -2649,6 +3071,34 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
 
     /* Stop the time */
     runtime_end(runtime);
+    if (mc_trials)
+    {
+        done_mc_trials(mc_trials);
+    }
+    if (mc_regrow)
+    {
+        done_mc_regrow(mc_regrow);
+    }
+    if (mc_adapt)
+    {
+        done_mc_adapt(mc_adapt);
+    }
+    if (mc_sweep)
+    {
+        done_mc_sweep(mc_sweep);
+    }
+    if (mc_hybrid)
+    {
+        done_mc_hybrid(fplog,mc_hybrid);
+    }
+    if (mc_dd)
+    {
+        done_mc_dd(mc_dd);
+    }
+    if (hmc)
+    {
+        done_hmc(fplog,hmc);
+    }
     if (bRerunMD)
     {
         close_trj(status);
@@ -2695,7 +3145,7 @@ double do_md(FILE *fplog,t_commrec *cr,int nfile,t_filenm fnm[],
         fprintf(fplog,"Average number of force evaluations per MD step: %.2f\n\n",
                 tcount/step_rel);
     }
-        if(bMC) 
+        if(bMC || (bMCDD && MASTER(cr))) 
         {
          print_mc_ratio(stderr,state->step_ac,state->step_tot,state->vol_ac,state->vol_tot);
         }
@@ -290,6 +290,7 @@ int main(int argc,char *argv[])
   bool bIonize      = FALSE;
   bool bConfout     = TRUE;
   bool bReproducible = FALSE;
+  bool bSortAtoms   = FALSE;
     
   int  npme=-1;
   int  nmultisim=0;
@@ -350,6 +351,8 @@ int main(int argc,char *argv[])
       "Print all forces larger than this (kJ/mol nm)" },
     { "-reprod",  FALSE, etBOOL,{&bReproducible},  
       "Try to avoid optimizations that affect binary reproducibility" },
+    { "-sort",    FALSE, etBOOL,{&bSortAtoms},
+      "Sort the atoms spatially at neighbor search steps in runs without domain decomposition" },
     { "-cpt",     FALSE, etREAL, {&cpt_period},
       "Checkpoint interval (minutes)" },
     { "-append",  FALSE, etBOOL, {&bAppendFiles},
@@ -470,6 +473,7 @@ int main(int argc,char *argv[])
   Flags = Flags | (bConfout      ? MD_CONFOUT      : 0);
   Flags = Flags | (bRerunVSite   ? MD_RERUN_VSITE  : 0);
   Flags = Flags | (bReproducible ? MD_REPRODUCIBLE : 0);
+  Flags = Flags | (bSortAtoms    ? MD_SORTATOMS    : 0);
   Flags = Flags | (bAppendFiles  ? MD_APPENDFILES  : 0); 
   Flags = Flags | (sim_part>1    ? MD_STARTFROMCPT : 0); 
 
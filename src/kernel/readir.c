@@ -153,6 +153,50 @@ void check_ir(char *mdparin,t_inputrec *ir, t_gromppopts *opts,int *nerror)
     warning_error("Can not have nstlist<=0 with twin-range interactions");
   }
 
+  /* VERLET CUT-OFF SCHEME STUFF */
+  if (ir->cutoff_scheme == ecutsVERLET) {
+    sprintf(err_buf,"With cutoff-scheme = %s, pbc should be %s",
+	    ecutscheme_names[ir->cutoff_scheme],epbc_names[epbcXYZ]);
+    CHECK(ir->ePBC != epbcXYZ);
+    sprintf(err_buf,"With cutoff-scheme = %s, rvdw should be equal to rcoulomb",
+	    ecutscheme_names[ir->cutoff_scheme]);
+    CHECK(ir->rvdw != ir->rcoulomb);
+    if (ir->verletbuf_drift <= 0) {
+      sprintf(err_buf,"With cutoff-scheme = %s and verlet-buffer-drift <= 0, rlist should be >= rcoulomb",
+	      ecutscheme_names[ir->cutoff_scheme]);
+      CHECK(ir->rlist < ir->rcoulomb);
+    }
+    sprintf(err_buf,"With cutoff-scheme = %s, nstlist should be larger than zero",
+	    ecutscheme_names[ir->cutoff_scheme]);
+    CHECK(ir->nstlist <= 0);
+    sprintf(err_buf,"nstprune should be >= 0 and < nstlist");
+    CHECK(ir->nstprune < 0 || (ir->nstprune > 0 && ir->nstprune >= ir->nstlist));
+    sprintf(err_buf,"nstprune > 0 requires verlet-buffer-drift > 0");
+    CHECK(ir->nstprune > 0 && ir->verletbuf_drift <= 0);
+    sprintf(err_buf,"With cutoff-scheme = %s, only vdwtype = %s is supported",
+	    ecutscheme_names[ir->cutoff_scheme],evdw_names[evdwCUT]);
+    CHECK(ir->vdwtype != evdwCUT);
+    sprintf(err_buf,"With cutoff-scheme = %s, only coulombtype = %s, %s, %s, %s or %s is supported",
+	    ecutscheme_names[ir->cutoff_scheme],
+	    eel_names[eelCUT],eel_names[eelRF],eel_names[eelRF_NEC],
+	    eel_names[eelPME],eel_names[eelEWALD]);
+    CHECK(!(ir->coulombtype == eelCUT || ir->coulombtype == eelRF ||
+	    ir->coulombtype == eelRF_NEC || ir->coulombtype == eelPME ||
+	    ir->coulombtype == eelEWALD));
+    sprintf(err_buf,"With cutoff-scheme = %s, free energy is not supported",
+	    ecutscheme_names[ir->cutoff_scheme]);
+    CHECK(ir->efep != efepNO);
+    sprintf(err_buf,"With cutoff-scheme = %s, walls, implicit solvent, QM/MM, TPI and Monte Carlo are not supported",
+	    ecutscheme_names[ir->cutoff_scheme]);
+    CHECK(ir->nwall > 0 || ir->implicit_solvent != eisNO || ir->bQMMM ||
+	  EI_TPI(ir->eI) || ir->eI == eiMC || ir->nstmc > 0);
+    /* The atom based cut-off replaces the group based rlistlong */
+    ir->rlistlong = ir->rlist;
+  } else if (ir->nstprune != 0) {
+    warning_note("nstprune is only used with cutoff-scheme = Verlet, setting it to 0");
+    ir->nstprune = 0;
+  }
+
   /* GENERAL INTEGRATOR STUFF */
   if (ir->eI != eiMD) {
     ir->etc = etcNO;
@@ -202,6 +246,60 @@ void check_ir(char *mdparin,t_inputrec *ir, t_gromppopts *opts,int *nerror)
     CHECK(EEL_FULL(ir->coulombtype) && !EEL_PME(ir->coulombtype));
   }
 
+  /* MC STUFF */
+  if (EI_MC(ir->eI)) {
+    sprintf(err_buf,"mc_ntrial should be at least 1");
+    CHECK(ir->mc_ntrial < 1);
+    sprintf(err_buf,"mc_regrow_ntrial can not be negative");
+    CHECK(ir->mc_regrow_ntrial < 0);
+    if (ir->mc_adapt_steps > 0) {
+      sprintf(err_buf,"mc_adapt_nst should be at least 1");
+      CHECK(ir->mc_adapt_nst < 1);
+      sprintf(err_buf,"mc_accept_target should be between 0 and 1");
+      CHECK(ir->mc_accept_target <= 0 || ir->mc_accept_target >= 1);
+    }
+    if (ir->bMCCheckerboard) {
+      sprintf(err_buf,"mc_checkerboard can not be used with coulombtype = %s,"
+	      " since the reciprocal space couples all cells",
+	      eel_names[ir->coulombtype]);
+      CHECK(EEL_FULL(ir->coulombtype));
+      sprintf(err_buf,"mc_checkerboard requires pbc = %s",epbc_names[epbcXYZ]);
+      CHECK(ir->ePBC != epbcXYZ);
+    }
+    if (ir->bMCVolumeFast) {
+      sprintf(err_buf,"mc_volume_fast can not be used with coulombtype = %s,"
+	      " since the reciprocal space energy depends on the box",
+	      eel_names[ir->coulombtype]);
+      CHECK(EEL_FULL(ir->coulombtype));
+      sprintf(err_buf,"mc_volume_fast requires pbc = %s",epbc_names[epbcXYZ]);
+      CHECK(ir->ePBC != epbcXYZ);
+    }
+  }
+
+  /* HYBRID MD/MC STUFF */
+  if (ir->nstmc > 0) {
+    sprintf(err_buf,"nstmc can only be used with dynamical integrators, "
+	    "with integrator = %s all steps are MC steps",ei_names[eiMC]);
+    CHECK(!EI_DYNAMICS(ir->eI) || EI_MC(ir->eI) || ir->eI == eiHMC);
+    sprintf(err_buf,"mc_nmoves can not be negative");
+    CHECK(ir->mc_nmoves < 0);
+  }
+
+  /* HYBRID MONTE CARLO STUFF */
+  if (ir->eI == eiHMC) {
+    sprintf(err_buf,"hmc_nsteps should be at least 1");
+    CHECK(ir->hmc_nsteps < 1);
+    sprintf(err_buf,"integrator = %s samples at constant volume, "
+	    "use pcoupl = %s",ei_names[eiHMC],epcoupl_names[epcNO]);
+    CHECK(ir->epc != epcNO);
+    sprintf(err_buf,"integrator = %s requires constraint_algorithm = %s",
+	    ei_names[eiHMC],econstr_names[econtLINCS]);
+    CHECK(ir->eConstrAlg != econtLINCS);
+    sprintf(err_buf,"integrator = %s draws its own velocities at ref_t, "
+	    "use tcoupl = %s",ei_names[eiHMC],etcoupl_names[etcNO]);
+    CHECK(ir->etc != etcNO);
+  }
+
   /* SHAKE / LINCS */
   if ( (opts->nshake > 0) && (opts->bMorse) ) {
     sprintf(warn_buf,
@@ -279,7 +377,7 @@ void check_ir(char *mdparin,t_inputrec *ir, t_gromppopts *opts,int *nerror)
     }
   }
     
-  if (ir->eI == eiMD && ir->ePBC == epbcNONE && ir->comm_mode != ecmANGULAR) {
+  if ((ir->eI == eiMD || ir->eI == eiHMC) && ir->ePBC == epbcNONE && ir->comm_mode != ecmANGULAR) {
     warning_note("Tumbling and or flying ice-cubes: We are not removing rotation around center of mass in a non-periodic system. You should probably set comm_mode = ANGULAR.");
   }
   
@@ -394,13 +492,14 @@ void check_ir(char *mdparin,t_inputrec *ir, t_gromppopts *opts,int *nerror)
 	      eel_names[ir->coulombtype]);
       CHECK(ir->rcoulomb_switch >= ir->rcoulomb);
     }
-  } else if (ir->coulombtype == eelCUT || EEL_RF(ir->coulombtype)) {
+  } else if ((ir->coulombtype == eelCUT || EEL_RF(ir->coulombtype)) &&
+	     ir->cutoff_scheme == ecutsGROUP) {
     sprintf(err_buf,"With coulombtype = %s, rcoulomb must be >= rlist",
 	    eel_names[ir->coulombtype]);
     CHECK(ir->rlist > ir->rcoulomb);
   }
 
-  if (EEL_FULL(ir->coulombtype)) {
+  if (EEL_FULL(ir->coulombtype) && ir->cutoff_scheme == ecutsGROUP) {
     if (ir->coulombtype==eelPMESWITCH || ir->coulombtype==eelPMEUSER) {
       sprintf(err_buf,"With coulombtype = %s, rcoulomb must be <= rlist",
 	      eel_names[ir->coulombtype]);
@@ -441,7 +540,7 @@ void check_ir(char *mdparin,t_inputrec *ir, t_gromppopts *opts,int *nerror)
     sprintf(err_buf,"With vdwtype = %s rvdw_switch must be < rvdw",
 	    evdw_names[ir->vdwtype]);
     CHECK(ir->rvdw_switch >= ir->rvdw);
-  } else if (ir->vdwtype == evdwCUT) {
+  } else if (ir->vdwtype == evdwCUT && ir->cutoff_scheme == ecutsGROUP) {
     sprintf(err_buf,"With vdwtype = %s, rvdw must be >= rlist",evdw_names[ir->vdwtype]);
     CHECK(ir->rlist > ir->rvdw);
   }
@@ -492,7 +591,7 @@ void check_ir(char *mdparin,t_inputrec *ir, t_gromppopts *opts,int *nerror)
   }
 
   /* ENERGY CONSERVATION */
-  if (ir->eI == eiMD && ir->etc == etcNO) {
+  if ((ir->eI == eiMD || ir->eI == eiHMC) && ir->etc == etcNO) {
     if (!EVDW_ZERO_AT_CUTOFF(ir->vdwtype) && ir->rvdw > 0) {
       sprintf(warn_buf,"You are using a cut-off for VdW interactions with NVE, for good energy conservation use vdwtype = %s (possibly with DispCorr)",
 	      evdw_names[evdwSHIFT]);
@@ -710,6 +809,8 @@ void get_ir(char *mdparin,char *mdparout,
 
   /* Neighbor searching */  
   CCTYPE ("NEIGHBORSEARCHING PARAMETERS");
+  CTYPE ("cut-off scheme (group: using charge groups, Verlet: atom based)");
+  EETYPE("cutoff-scheme",     ir->cutoff_scheme,    ecutscheme_names, nerror, TRUE);
   CTYPE ("nblist update frequency");
   ITYPE ("nstlist",	ir->nstlist,	10);
   CTYPE ("ns algorithm (simple or grid)");
@@ -723,6 +824,11 @@ void get_ir(char *mdparin,char *mdparout,
   RTYPE ("rlist",	ir->rlist,	1.0);
   CTYPE ("long-range cut-off for switched potentials");
   RTYPE ("rlistlong",	ir->rlistlong,	-1);
+  CTYPE ("Allowed energy drift due to the Verlet buffer in kJ/mol/ps per atom,");
+  CTYPE ("rlist is set from this with the Verlet scheme, -1 means use rlist");
+  RTYPE ("verlet-buffer-drift",ir->verletbuf_drift,0.005);
+  CTYPE ("Verlet list pruning frequency, 0 is no pruning");
+  ITYPE ("nstprune",	ir->nstprune,	0);
 
   /* Electrostatics */
   CCTYPE ("OPTIONS FOR ELECTROSTATICS AND VDW");
@@ -792,6 +898,16 @@ void get_ir(char *mdparin,char *mdparout,
   RTYPE ("dihedral_rot", ir->dihedral_rot,0.0);
   RTYPE ("bond_stretch", ir->bond_stretch,0.0);
   RTYPE ("angle_bend", ir->angle_bend,0.0);
+  ITYPE ("mc_ntrial",	ir->mc_ntrial,	1);
+  EETYPE("mc_checkerboard", ir->bMCCheckerboard, yesno_names, nerror, TRUE);
+  ITYPE ("mc_regrow_ntrial", ir->mc_regrow_ntrial, 0);
+  ITYPE ("mc_adapt_steps", ir->mc_adapt_steps, 0);
+  ITYPE ("mc_adapt_nst", ir->mc_adapt_nst, 100);
+  RTYPE ("mc_accept_target", ir->mc_accept_target, 0.4);
+  EETYPE("mc_volume_fast", ir->bMCVolumeFast, yesno_names, nerror, TRUE);
+  ITYPE ("nstmc",	ir->nstmc,	0);
+  ITYPE ("mc_nmoves",	ir->mc_nmoves,	0);
+  ITYPE ("hmc_nsteps",	ir->hmc_nsteps,	10);
 
   /* Coupling stuff */
   CCTYPE ("OPTIONS FOR WEAK COUPLING ALGORITHMS");
@@ -1604,7 +1720,8 @@ void do_index(char* mdparin, char *ndx,
 		"%d tau_t values",ntcg,nref_t,ntau_t);
   }
 
-  bSetTCpar = (ir->etc || EI_SD(ir->eI) || ir->eI==eiBD || EI_TPI(ir->eI) || EI_MC(ir->eI));
+  bSetTCpar = (ir->etc || EI_SD(ir->eI) || ir->eI==eiBD || EI_TPI(ir->eI) || EI_MC(ir->eI) ||
+	       ir->eI==eiHMC);
   do_numbering(natoms,groups,ntcg,ptr3,grps,gnames,egcTC,
 	       restnm,bSetTCpar ? egrptpALL : egrptpALL_GENREST,bVerbose);
   nr = groups->grps[egcTC].nr;
@@ -2044,6 +2161,12 @@ void triple_check(char *mdparin,t_inputrec *ir,gmx_mtop_t *sys,int *nerror)
     }
   }
 
+  if (ir->cutoff_scheme == ecutsVERLET) {
+    sprintf(err_buf,"With cutoff-scheme = %s, only one energy group is supported",
+	    ecutscheme_names[ir->cutoff_scheme]);
+    CHECK(ir->opts.ngener > 1);
+  }
+
   /* Generalized reaction field */  
   if (ir->opts.ngtc == 0) {
     sprintf(err_buf,"No temperature coupling while using coulombtype %s",
@@ -2158,7 +2281,7 @@ void double_check(t_inputrec *ir,matrix box,bool bConstr,int *nerror)
 
   if( (ir->eConstrAlg == econtLINCS) && bConstr) {
     /* If we have Lincs constraints: */
-    if(ir->eI==eiMD && ir->etc==etcNO &&
+    if((ir->eI==eiMD || ir->eI==eiHMC) && ir->etc==etcNO &&
        ir->eConstrAlg==econtLINCS && ir->nLincsIter==1) {
       sprintf(warn_buf,"For energy conservation with LINCS, lincs_iter should be 2 or larger.\n");
       warning_note(NULL);
@@ -291,6 +291,7 @@ void DS_Init(DirStack **DS)
     set_nec(&(necessary[d_mcangles]), d_atoms, d_angles,d_none);
     set_nec(&(necessary[d_mcdihedrals]), d_atoms, d_dihedrals,d_none);
     set_nec(&(necessary[d_mccra]), d_atoms, d_dihedrals,d_none);
+    set_nec(&(necessary[d_mcregrow]), d_atoms, d_dihedrals,d_none);
 
     for(i=0; (i<d_maxdir); i++) {
       if (debug)
@@ -555,6 +555,10 @@ static char **read_topol(char *infile,char *outfile,
           case d_mccra:
            push_mcmove(d,pline,&(mi0->mc_cra),15);
            break;
+
+          case d_mcregrow:
+           push_mcmove(d,pline,&(mi0->mc_regrow),4);
+           break;
 			  
 	  case d_moleculetype: {
 	    if (!bReadMolType) {
@@ -591,6 +595,7 @@ static char **read_topol(char *infile,char *outfile,
             mi0->mc_angles.nr=0;
             mi0->mc_dihedrals.nr=0;
             mi0->mc_cra.nr=0;
+            mi0->mc_regrow.nr=0;
 	    break;
 	  }
 	  case d_atoms: 
@@ -152,6 +152,16 @@ void init_molinfo(t_molinfo *mol)
   init_block(&mol->mols);
   init_blocka(&mol->excls);
   init_atom(&mol->atoms);
+  mol->mc_bonds.nr      = 0;
+  mol->mc_bonds.iatoms  = NULL;
+  mol->mc_angles.nr     = 0;
+  mol->mc_angles.iatoms = NULL;
+  mol->mc_dihedrals.nr     = 0;
+  mol->mc_dihedrals.iatoms = NULL;
+  mol->mc_cra.nr        = 0;
+  mol->mc_cra.iatoms    = NULL;
+  mol->mc_regrow.nr     = 0;
+  mol->mc_regrow.iatoms = NULL;
 }
 
 /* FREEING MEMORY */
@@ -0,0 +1,532 @@
+/*
+ * 
+ *                This source code is part of
+ * 
+ *                 G   R   O   M   A   C   S
+ * 
+ *          GROningen MAchine for Chemical Simulations
+ * 
+ *                        VERSION 3.2.0
+ * Written by David van der Spoel, Erik Lindahl, Berk Hess, and others.
+ * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
+ * Copyright (c) 2001-2004, The GROMACS development team,
+ * check out http://www.gromacs.org for more information.
+
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * If you want to redistribute modifications, please consider that
+ * scientific software is very special. Version control is crucial -
+ * bugs must be traceable. We will be happy to consider code for
+ * inclusion in the official distribution, but derived work must not
+ * be called official GROMACS. Details are found in the README & COPYING
+ * files - if they are missing, get the official version at www.gromacs.org.
+ * 
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the papers on the package - you can find them in the top README file.
+ * 
+ * For more info, check our website at http://www.gromacs.org
+ * 
+ * And Hey:
+ * Gromacs Runs On Most of All Computer Systems
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "typedefs.h"
+#include "smalloc.h"
+#include "vec.h"
+#include "pbc.h"
+#include "nsgrid.h"
+#include "mshift.h"
+#include "mdatoms.h"
+#include "mtop_util.h"
+#include "gmx_fatal.h"
+#include "vsite.h"
+#include "constr.h"
+#include "atomsort.h"
+
+typedef struct {
+    int nsc;    /* The ns grid cell index          */
+    int ind_gl; /* The global charge group index   */
+    int ind;    /* The local charge group index    */
+} gmx_atomsort_cg_t;
+
+struct gmx_atomsort {
+    gmx_localtop_t *top_gl;   /* The topology in global atom order        */
+    int    ncg;               /* The number of charge groups              */
+    int    natoms;            /* The number of atoms                      */
+    int    *index_gl;         /* The global cg index for each local cg    */
+    int    *gatindex;         /* The global atom index for each local atom*/
+    int    *ga2la;            /* The local atom index for each global atom*/
+    t_grid *grid;             /* The ns grid used for the sort keys       */
+    rvec   *cgcm;             /* The charge group centers                 */
+    gmx_atomsort_cg_t *sort;  /* The sort keys                            */
+    int    *ibuf;             /* Integer buffer of size ncg+1             */
+    rvec   *vbuf;             /* Vector buffer of size natoms             */
+};
+
+gmx_atomsort_t init_atomsort(FILE *fplog,t_inputrec *ir,
+                             gmx_mtop_t *mtop,gmx_localtop_t *top_gl,
+                             t_forcerec *fr)
+{
+    gmx_atomsort_t as;
+    t_ilist *settle;
+    int  *cgindex,cg,i,ow;
+    char *reason;
+
+    /* These use atom indices in the global order in the local arrays */
+    reason = NULL;
+    if (ir->ePull != epullNO)
+    {
+        reason = "pulling";
+    }
+    else if (ir->bQMMM)
+    {
+        reason = "QM/MM";
+    }
+    else if (ir->implicit_solvent)
+    {
+        reason = "implicit solvent";
+    }
+    else if (ir->eI == eiHMC || ir->epc == epcMC)
+    {
+        reason = "Monte Carlo moves";
+    }
+    else if (gmx_mtop_ftype_count(mtop,F_ORIRES) > 0)
+    {
+        reason = "orientation restraints";
+    }
+    
+    /* SETTLE requires the atoms of a water molecule to be consecutive */
+    settle = &top_gl->idef.il[F_SETTLE];
+    cgindex = top_gl->cgs.index;
+    cg = 0;
+    for(i=0; i<settle->nr && reason == NULL; i+=2)
+    {
+        ow = settle->iatoms[i+1];
+        while (cgindex[cg+1] <= ow)
+        {
+            cg++;
+        }
+        if (ow + 2 >= cgindex[cg+1])
+        {
+            reason = "SETTLE waters that are not in one charge group";
+        }
+    }
+    
+    if (reason != NULL)
+    {
+        if (fplog)
+        {
+            fprintf(fplog,"\nNOTE: atom sorting is not supported with %s, "
+                    "the atoms will not be sorted\n\n",reason);
+        }
+        
+        return NULL;
+    }
+
+    snew(as,1);
+
+    as->top_gl = top_gl;
+    as->ncg    = top_gl->cgs.nr;
+    as->natoms = top_gl->cgs.index[top_gl->cgs.nr];
+
+    snew(as->index_gl,as->ncg);
+    for(cg=0; cg<as->ncg; cg++)
+    {
+        as->index_gl[cg] = cg;
+    }
+    snew(as->gatindex,as->natoms);
+    snew(as->ga2la,as->natoms);
+    for(i=0; i<as->natoms; i++)
+    {
+        as->gatindex[i] = i;
+        as->ga2la[i]    = i;
+    }
+    
+    as->grid = init_grid(NULL,fr);
+    snew(as->cgcm,as->ncg);
+    snew(as->sort,as->ncg);
+    snew(as->ibuf,as->ncg+1);
+    snew(as->vbuf,as->natoms);
+
+    if (fplog)
+    {
+        fprintf(fplog,
+                "Will sort the %d charge groups on their ns grid cell "
+                "at neighbor search steps\n",as->ncg);
+    }
+
+    return as;
+}
+
+static void make_local_top(gmx_atomsort_t as,gmx_localtop_t *top);
+
+gmx_localtop_t *atomsort_init_local_top(gmx_atomsort_t as)
+{
+    gmx_localtop_t *top_gl,*top;
+    int ftype;
+
+    top_gl = as->top_gl;
+
+    snew(top,1);
+
+    /* The parameters are shared, the atom indices are local */
+    *top = *top_gl;
+    for(ftype=0; ftype<F_NRE; ftype++)
+    {
+        top->idef.il[ftype].nalloc = top_gl->idef.il[ftype].nr;
+        snew(top->idef.il[ftype].iatoms,top->idef.il[ftype].nalloc);
+    }
+    top->cgs.nalloc_index = top_gl->cgs.nr + 1;
+    snew(top->cgs.index,top->cgs.nalloc_index);
+    top->excls.nalloc_index = top_gl->excls.nr + 1;
+    snew(top->excls.index,top->excls.nalloc_index);
+    top->excls.nalloc_a = top_gl->excls.nra;
+    snew(top->excls.a,top->excls.nalloc_a);
+
+    make_local_top(as,top);
+
+    return top;
+}
+
+void atomsort_init_local_state(gmx_atomsort_t as,
+                               t_state *state_global,t_state *state_local)
+{
+    int i;
+
+    *state_local = *state_global;
+    state_local->nalloc = state_global->natoms;
+
+    if (state_global->flags & (1<<estX))
+    {
+        snew(state_local->x,state_local->nalloc);
+    }
+    if (state_global->flags & (1<<estV))
+    {
+        snew(state_local->v,state_local->nalloc);
+    }
+    if (state_global->flags & (1<<estSDX))
+    {
+        snew(state_local->sd_X,state_local->nalloc);
+    }
+    if (state_global->flags & (1<<estCGP))
+    {
+        snew(state_local->cg_p,state_local->nalloc);
+    }
+    for(i=0; i<state_global->natoms; i++)
+    {
+        if (state_global->flags & (1<<estX))
+        {
+            copy_rvec(state_global->x[as->gatindex[i]],state_local->x[i]);
+        }
+        if (state_global->flags & (1<<estV))
+        {
+            copy_rvec(state_global->v[as->gatindex[i]],state_local->v[i]);
+        }
+        if (state_global->flags & (1<<estSDX))
+        {
+            copy_rvec(state_global->sd_X[as->gatindex[i]],
+                      state_local->sd_X[i]);
+        }
+        if (state_global->flags & (1<<estCGP))
+        {
+            copy_rvec(state_global->cg_p[as->gatindex[i]],
+                      state_local->cg_p[i]);
+        }
+    }
+}
+
+static int comp_cgsort(const void *a,const void *b)
+{
+    int comp;
+    
+    gmx_atomsort_cg_t *cga,*cgb;
+    cga = (gmx_atomsort_cg_t *)a;
+    cgb = (gmx_atomsort_cg_t *)b;
+    
+    comp = cga->nsc - cgb->nsc;
+    if (comp == 0)
+    {
+        comp = cga->ind_gl - cgb->ind_gl;
+    }
+    
+    return comp;
+}
+
+static void order_int_cg(int n,gmx_atomsort_cg_t *sort,
+                         int *a,int *buf)
+{
+    int i;
+    
+    for(i=0; i<n; i++)
+    {
+        buf[i] = a[sort[i].ind];
+    }
+    for(i=0; i<n; i++)
+    {
+        a[i] = buf[i];
+    }
+}
+
+static void order_vec_atom(int ncg,int *cgindex,gmx_atomsort_cg_t *sort,
+                           rvec *v,rvec *buf)
+{
+    int a,atot,cg,i;
+    
+    a = 0;
+    for(cg=0; cg<ncg; cg++)
+    {
+        for(i=cgindex[sort[cg].ind]; i<cgindex[sort[cg].ind+1]; i++)
+        {
+            copy_rvec(v[i],buf[a]);
+            a++;
+        }
+    }
+    atot = a;
+    
+    for(a=0; a<atot; a++)
+    {
+        copy_rvec(buf[a],v[a]);
+    }
+}
+
+static void sort_state(gmx_atomsort_t as,t_state *state,
+                       t_forcerec *fr,int *cgindex)
+{
+    gmx_atomsort_cg_t *sort;
+    int i;
+
+    sort = as->sort;
+    for(i=0; i<as->ncg; i++)
+    {
+        /* Sort on the ns grid cell indices and the global topology index */
+        sort[i].nsc    = as->grid->cell_index[i];
+        sort[i].ind_gl = as->index_gl[i];
+        sort[i].ind    = i;
+    }
+    qsort(sort,as->ncg,sizeof(sort[0]),comp_cgsort);
+
+    for(i=estX; i<estNR; i++)
+    {
+        if (state->flags & (1<<i))
+        {
+            switch (i)
+            {
+            case estX:
+                order_vec_atom(as->ncg,cgindex,sort,state->x,as->vbuf);
+                break;
+            case estV:
+                order_vec_atom(as->ncg,cgindex,sort,state->v,as->vbuf);
+                break;
+            case estSDX:
+                order_vec_atom(as->ncg,cgindex,sort,state->sd_X,as->vbuf);
+                break;
+            case estCGP:
+                order_vec_atom(as->ncg,cgindex,sort,state->cg_p,as->vbuf);
+                break;
+            default:
+                /* No ordering required */
+                break;
+            }
+        }
+    }
+
+    order_int_cg(as->ncg,sort,as->index_gl,as->ibuf);
+    order_int_cg(as->ncg,sort,fr->cginfo,as->ibuf);
+}
+
+static void make_local_indices(gmx_atomsort_t as)
+{
+    int *cgindex_gl,cg,cg_gl,a,a_gl;
+
+    cgindex_gl = as->top_gl->cgs.index;
+
+    a = 0;
+    for(cg=0; cg<as->ncg; cg++)
+    {
+        cg_gl = as->index_gl[cg];
+        for(a_gl=cgindex_gl[cg_gl]; a_gl<cgindex_gl[cg_gl+1]; a_gl++)
+        {
+            as->gatindex[a] = a_gl;
+            as->ga2la[a_gl] = a;
+            a++;
+        }
+    }
+}
+
+static void make_local_top(gmx_atomsort_t as,gmx_localtop_t *top)
+{
+    gmx_localtop_t *top_gl;
+    t_ilist *il_gl,*il;
+    int  ftype,nral1,i,j,cg,cg_gl,a,a_gl,n;
+
+    top_gl = as->top_gl;
+
+    /* The interactions keep their order, only the atom indices change,
+     * so the free-energy sorting and the position restraint parameters
+     * remain valid.
+     */
+    for(ftype=0; ftype<F_NRE; ftype++)
+    {
+        il_gl = &top_gl->idef.il[ftype];
+        il    = &top->idef.il[ftype];
+        nral1 = 1 + NRAL(ftype);
+        for(i=0; i<il_gl->nr; i+=nral1)
+        {
+            il->iatoms[i] = il_gl->iatoms[i];
+            for(j=1; j<nral1; j++)
+            {
+                il->iatoms[i+j] = as->ga2la[il_gl->iatoms[i+j]];
+            }
+        }
+        il->nr = il_gl->nr;
+    }
+
+    top->cgs.nr = as->ncg;
+    top->cgs.index[0] = 0;
+    for(cg=0; cg<as->ncg; cg++)
+    {
+        cg_gl = as->index_gl[cg];
+        top->cgs.index[cg+1] = top->cgs.index[cg] +
+            top_gl->cgs.index[cg_gl+1] - top_gl->cgs.index[cg_gl];
+    }
+
+    n = 0;
+    for(a=0; a<as->natoms; a++)
+    {
+        a_gl = as->gatindex[a];
+        top->excls.index[a] = n;
+        for(j=top_gl->excls.index[a_gl]; j<top_gl->excls.index[a_gl+1]; j++)
+        {
+            top->excls.a[n++] = as->ga2la[top_gl->excls.a[j]];
+        }
+    }
+    top->excls.index[as->natoms] = n;
+    top->excls.nr  = as->natoms;
+    top->excls.nra = n;
+}
+
+void atomsort_partition_system(FILE *fplog,gmx_step_t step,
+                               gmx_atomsort_t as,
+                               t_inputrec *ir,gmx_mtop_t *mtop,
+                               t_state *state,t_forcerec *fr,
+                               t_mdatoms *mdatoms,gmx_localtop_t *top,
+                               gmx_vsite_t *vsite,gmx_constr_t constr,
+                               t_graph **graph)
+{
+    rvec grid_x0,grid_x1;
+    real grid_density;
+    int  i;
+    char buf[22];
+
+    if (debug)
+    {
+        fprintf(debug,"Step %s, sorting the %d charge groups\n",
+                gmx_step_str(step,buf),as->ncg);
+    }
+
+    /* Put the charge groups in the box, as do_force does
+     * at search steps, and fill the ns grid with their centers.
+     */
+    if (fr->ePBC != epbcNONE)
+    {
+        put_charge_groups_in_box(fplog,0,as->ncg,fr->ePBC,state->box,
+                                 &top->cgs,state->x,as->cgcm);
+    }
+    else
+    {
+        calc_cgcm(fplog,0,as->ncg,&top->cgs,state->x,as->cgcm);
+    }
+    get_nsgrid_boundaries(as->grid,NULL,state->box,NULL,NULL,NULL,
+                          as->ncg,as->cgcm,grid_x0,grid_x1,&grid_density);
+    grid_first(NULL,as->grid,NULL,NULL,fr->ePBC,state->box,grid_x0,grid_x1,
+               max(fr->rlist,fr->rlistlong),grid_density);
+    fill_grid(NULL,NULL,as->grid,as->ncg,0,as->ncg,as->cgcm);
+
+    sort_state(as,state,fr,top->cgs.index);
+
+    make_local_indices(as);
+    make_local_top(as,top);
+
+    atoms2md(mtop,ir,as->natoms,as->gatindex,0,as->natoms,mdatoms);
+    update_mdatoms(mdatoms,state->lambda);
+
+    if (vsite)
+    {
+        if (vsite->n_intercg_vsite > 0 && vsite->vsite_pbc_loc)
+        {
+            for(i=0; i<F_VSITEN-F_VSITE2+1; i++)
+            {
+                sfree(vsite->vsite_pbc_loc[i]);
+            }
+            sfree(vsite->vsite_pbc_loc);
+        }
+        set_vsite_top(vsite,top,mdatoms,NULL);
+    }
+
+    if (constr)
+    {
+        set_constraints(constr,top,ir,mdatoms,NULL);
+    }
+
+    if (*graph)
+    {
+        done_graph(*graph);
+        sfree(*graph);
+        *graph = mk_graph(NULL,&top->idef,0,as->natoms,FALSE,FALSE);
+    }
+}
+
+int *atomsort_gatindex(gmx_atomsort_t as)
+{
+    return as->gatindex;
+}
+
+void atomsort_collect_vec(gmx_atomsort_t as,rvec *lv,rvec *v)
+{
+    int i;
+
+    for(i=0; i<as->natoms; i++)
+    {
+        copy_rvec(lv[i],v[as->gatindex[i]]);
+    }
+}
+
+void atomsort_collect_state(gmx_atomsort_t as,
+                            t_state *state_local,t_state *state)
+{
+    int est;
+
+    for(est=estX; est<estNR; est++)
+    {
+        if (state_local->flags & (1<<est))
+        {
+            switch (est)
+            {
+            case estX:
+                atomsort_collect_vec(as,state_local->x,state->x);
+                break;
+            case estV:
+                atomsort_collect_vec(as,state_local->v,state->v);
+                break;
+            case estSDX:
+                atomsort_collect_vec(as,state_local->sd_X,state->sd_X);
+                break;
+            case estCGP:
+                atomsort_collect_vec(as,state_local->cg_p,state->cg_p);
+                break;
+            default:
+                /* The other entries are shared or copied by write_traj */
+                break;
+            }
+        }
+    }
+}
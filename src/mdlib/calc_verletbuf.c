@@ -0,0 +1,237 @@
+/*
+ * 
+ *                This source code is part of
+ * 
+ *                 G   R   O   M   A   C   S
+ * 
+ *          GROningen MAchine for Chemical Simulations
+ * 
+ * Written by David van der Spoel, Erik Lindahl, Berk Hess, and others.
+ * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
+ * Copyright (c) 2001-2008, The GROMACS development team,
+ * check out http://www.gromacs.org for more information.
+ 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * If you want to redistribute modifications, please consider that
+ * scientific software is very special. Version control is crucial -
+ * bugs must be traceable. We will be happy to consider code for
+ * inclusion in the official distribution, but derived work must not
+ * be called official GROMACS. Details are found in the README & COPYING
+ * files - if they are missing, get the official version at www.gromacs.org.
+ * 
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the papers on the package - you can find them in the top README file.
+ * 
+ * For more info, check our website at http://www.gromacs.org
+ * 
+ * And Hey:
+ * Gromacs Runs On Most of All Computer Systems
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+
+#include "calc_verletbuf.h"
+#include "typedefs.h"
+#include "smalloc.h"
+#include "physics.h"
+#include "maths.h"
+#include "vec.h"
+#include "coulomb.h"
+#include "mtop_util.h"
+
+/* Atoms with equal mass, type and charge give the same buffer contribution */
+typedef struct {
+  real mass;
+  int  type;
+  real q;
+  int  n;
+} verletbuf_atomtype_t;
+
+static void add_atomtype(int *natt,int *natt_nalloc,verletbuf_atomtype_t **att,
+			 real mass,int type,real q,int n)
+{
+  int i;
+
+  for(i=0; i<*natt; i++) {
+    if ((*att)[i].mass == mass && (*att)[i].type == type &&
+	(*att)[i].q == q) {
+      (*att)[i].n += n;
+      return;
+    }
+  }
+  if (*natt + 1 > *natt_nalloc) {
+    *natt_nalloc = over_alloc_large(*natt + 1);
+    srenew(*att,*natt_nalloc);
+  }
+  (*att)[*natt].mass = mass;
+  (*att)[*natt].type = type;
+  (*att)[*natt].q    = q;
+  (*att)[*natt].n    = n;
+  (*natt)++;
+}
+
+/* Returns the upper tail of the standard normal distribution */
+static real norm_tail(real x)
+{
+  return 0.5*gmx_erfc(x/sqrt(2.0));
+}
+
+static real norm_pdf(real x)
+{
+  return exp(-0.5*x*x)/sqrt(2*M_PI);
+}
+
+/* Returns the energy error, summed over all atoms, for a buffer of size rb */
+static real energy_error(const gmx_mtop_t *mtop,real boxvol,
+			 int natt,const verletbuf_atomtype_t *att,
+			 const real *s2,real rc,real el_md1,real el_d2,real rb)
+{
+  const t_iparams *ip;
+  int  i,j,atnr;
+  real sc2,s,b,c6,c12,rinv6,md1,d2,pot1,pot2,err;
+
+  ip   = mtop->ffparams.iparams;
+  atnr = mtop->ffparams.atnr;
+
+  err = 0;
+  for(i=0; i<natt; i++) {
+    for(j=0; j<natt; j++) {
+      sc2 = s2[i] + s2[j];
+      if (sc2 == 0)
+	continue;
+      s = sqrt(sc2);
+      b = rb/s;
+
+      c6    = ip[att[i].type*atnr + att[j].type].lj.c6;
+      c12   = ip[att[i].type*atnr + att[j].type].lj.c12;
+      rinv6 = 1/(rc*rc*rc*rc*rc*rc);
+      /* The absolute first and second derivative of the potential at rc */
+      md1 = fabs((-12*c12*rinv6 + 6*c6)*rinv6/rc) +
+	fabs(att[i].q*att[j].q*el_md1);
+      d2  = fabs((156*c12*rinv6 - 42*c6)*rinv6/(rc*rc)) +
+	fabs(att[i].q*att[j].q*el_d2);
+
+      /* The first and second order terms of the potential, integrated
+       * over the Gaussian displacement of pairs beyond the buffer.
+       */
+      pot1 = md1*0.5*sc2*((1 + b*b)*norm_tail(b) - b*norm_pdf(b));
+      pot2 = d2/6*sc2*s*((b*b + 2)*norm_pdf(b) - b*(b*b + 3)*norm_tail(b));
+
+      /* Each pair is counted twice */
+      err += 0.5*att[i].n*att[j].n/boxvol*4*M_PI*rc*rc*(pot1 + pot2);
+    }
+  }
+
+  return err;
+}
+
+real calc_verlet_buffer_size(const gmx_mtop_t *mtop,real boxvol,
+			     const t_inputrec *ir,int nstlist,
+			     real drift_target)
+{
+  verletbuf_atomtype_t *att;
+  int  natt,natt_nalloc,mb,nmol,a,i;
+  const t_atom *atom;
+  real reference_temperature,mass_min,mass,t,kT,rc,epsfac,k_rf,beta,e;
+  real el_md1,el_d2,drift_fac,rb_lo,rb_hi,rb;
+  real *s2;
+
+  reference_temperature = 0;
+  for(i=0; i<ir->opts.ngtc; i++)
+    reference_temperature = max(reference_temperature,ir->opts.ref_t[i]);
+  if (reference_temperature <= 0)
+    return -1;
+
+  rc = max(ir->rvdw,ir->rcoulomb);
+  if (nstlist <= 1)
+    return rc;
+
+  natt        = 0;
+  natt_nalloc = 0;
+  att         = NULL;
+  mass_min    = 0;
+  for(mb=0; mb<mtop->nmolblock; mb++) {
+    nmol = mtop->molblock[mb].nmol;
+    atom = mtop->moltype[mtop->molblock[mb].type].atoms.atom;
+    for(a=0; a<mtop->moltype[mtop->molblock[mb].type].atoms.nr; a++) {
+      add_atomtype(&natt,&natt_nalloc,&att,
+		   atom[a].m,atom[a].type,atom[a].q,nmol);
+      if (atom[a].m > 0 && (mass_min == 0 || atom[a].m < mass_min))
+	mass_min = atom[a].m;
+    }
+  }
+
+  /* The displacement variance along one dimension over the list lifetime,
+   * massless particles move with their constructing atoms, for which
+   * we (conservatively) use the smallest mass in the system.
+   */
+  t  = (nstlist - 1)*ir->delta_t;
+  kT = BOLTZ*reference_temperature;
+  snew(s2,natt);
+  for(i=0; i<natt; i++) {
+    mass = (att[i].mass > 0 ? att[i].mass : mass_min);
+    if (mass == 0) {
+      s2[i] = 0;
+    } else if (ir->eI == eiBD) {
+      s2[i] = 2*kT*t/(ir->bd_fric > 0 ? ir->bd_fric : mass/ir->delta_t);
+    } else {
+      s2[i] = kT/mass*t*t;
+    }
+  }
+
+  /* The Coulomb derivatives at rc for unit charges */
+  epsfac = (ir->epsilon_r != 0 ? ONE_4PI_EPS0/ir->epsilon_r : 0);
+  if (EEL_RF(ir->coulombtype)) {
+    if (ir->epsilon_rf == 0)
+      k_rf = 1/(2*rc*rc*rc);
+    else
+      k_rf = (ir->epsilon_rf - ir->epsilon_r)/
+	((2*ir->epsilon_rf + ir->epsilon_r)*rc*rc*rc);
+    el_md1 = epsfac*(-1/(rc*rc) + 2*k_rf*rc);
+    el_d2  = epsfac*(2/(rc*rc*rc) + 2*k_rf);
+  } else if (EEL_FULL(ir->coulombtype)) {
+    beta   = calc_ewaldcoeff(ir->rcoulomb,ir->ewald_rtol);
+    e      = 2*beta/sqrt(M_PI)*exp(-beta*beta*rc*rc);
+    el_md1 = epsfac*(-gmx_erfc(beta*rc)/(rc*rc) - e/rc);
+    el_d2  = epsfac*(2*gmx_erfc(beta*rc)/(rc*rc*rc) + e*(2/(rc*rc) + 2*beta*beta));
+  } else {
+    el_md1 = -epsfac/(rc*rc);
+    el_d2  = 2*epsfac/(rc*rc*rc);
+  }
+
+  /* Convert the total error over the list lifetime to a drift per atom */
+  drift_fac = 1/(mtop->natoms*nstlist*ir->delta_t);
+
+  /* Find an upper bound for the buffer and bisect */
+  rb_lo = 0;
+  rb_hi = 0.1;
+  while (drift_fac*energy_error(mtop,boxvol,natt,att,s2,rc,el_md1,el_d2,rb_hi)
+	 > drift_target && rb_hi < rc) {
+    rb_lo  = rb_hi;
+    rb_hi *= 2;
+  }
+  while (rb_hi - rb_lo > 0.001) {
+    rb = 0.5*(rb_lo + rb_hi);
+    if (drift_fac*energy_error(mtop,boxvol,natt,att,s2,rc,el_md1,el_d2,rb)
+	> drift_target)
+      rb_lo = rb;
+    else
+      rb_hi = rb;
+  }
+
+  if (debug)
+    fprintf(debug,"Verlet buffer for nstlist %d: %d atom types, %.3f nm\n",
+	    nstlist,natt,rb_hi);
+
+  sfree(s2);
+  sfree(att);
+
+  return rc + rb_hi;
+}
@@ -388,14 +388,24 @@ void mc_pscale(t_inputrec *ir,matrix mu,
   ivec   *nFreeze=ir->opts.nFreeze;
   int    n,m,d,g=0,natoms;
   real  dv; 
-  rvec dxcm,dx,*xs;
+  rvec dxcm,dx;
+  static rvec *xs=NULL;
+  static int  xs_nalloc=0;
 
-  snew(xs,nr_atoms);
+  if (nr_atoms > xs_nalloc)
+  {
+   xs_nalloc = over_alloc_small(nr_atoms);
+   srenew(xs,xs_nalloc);
+  }
 
   for(n=start;n<nr_atoms;n++)
   {
    copy_rvec(x[n],xs[n]);
   }
+  /* Local MC moves do not update the graph, the molecules might
+   * have moved over the box boundaries since the last force call.
+   */
+  mk_mshift(NULL,graph,ir->ePBC,box,xs);
   shift_self(graph,box,xs);
 
   for (d=0; d<DIM; d++) {
@@ -405,9 +415,8 @@ void mc_pscale(t_inputrec *ir,matrix mu,
   }      
   preserve_box_shape(ir,box_rel,box);
 
-  /* Scale the positions */
+  /* Scale the positions, x is overwritten with the shifted xs */
 
-  shift_self(graph,box,x);
   for (n=0; n<mols->nr; n++) {
    clear_rvec(dxcm);
    natoms = mols->index[n+1]-mols->index[n];
@@ -437,8 +446,6 @@ void mc_pscale(t_inputrec *ir,matrix mu,
    * since the box vectors might have changed
    */
   inc_nrnb(nrnb,eNR_PCOUPL,nr_atoms);
-
-  sfree(xs);
 }
 void berendsen_pscale(t_inputrec *ir,matrix mu,
 		      matrix box,matrix box_rel,
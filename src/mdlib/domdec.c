@@ -208,6 +208,8 @@ typedef struct gmx_domdec_comm
 
     /* Should we sort the cgs */
     int  nstSortCG;
+    /* Sort the home cgs on global index instead of ns grid cell */
+    bool bSortCGGlobal;
     gmx_domdec_sort_t *sort;
     
     /* Are there bonded and multi-body interactions between charge groups? */
@@ -1443,6 +1445,16 @@ void dd_collect_state(gmx_domdec_t *dd,
             state->nosehoover_xi[i]  = state_local->nosehoover_xi[i];
             state->therm_integral[i] = state_local->therm_integral[i];
         }
+        for(i=0; i<=MC_NR; i++)
+        {
+            state->mc_delta[i] = state_local->mc_delta[i];
+        }
+        for(i=0; i<MC_NR; i++)
+        {
+            state->mc_prob[i]  = state_local->mc_prob[i];
+            state->step_ac[i]  = state_local->step_ac[i];
+            state->step_tot[i] = state_local->step_tot[i];
+        }
     }
     for(est=estX; est<estNR; est++)
     {
@@ -1496,6 +1508,13 @@ void dd_collect_state(gmx_domdec_t *dd,
             case estDISRE_RM3TAV:
             case estORIRE_INITF:
             case estORIRE_DTAV:
+            case estMC_DELTA:
+            case estMC_PROB:
+            case estMC_RNG:
+            case estMC_RNGI:
+            case estMC_RNGG:
+            case estMC_COUNTS:
+            case estMC_ENER:
                 break;
             default:
                 gmx_incons("Unknown state entry encountered in dd_collect_state");
@@ -1549,6 +1568,13 @@ static void dd_realloc_state(t_state *state,rvec **f,int nalloc)
             case estDISRE_RM3TAV:
             case estORIRE_INITF:
             case estORIRE_DTAV:
+            case estMC_DELTA:
+            case estMC_PROB:
+            case estMC_RNG:
+            case estMC_RNGI:
+            case estMC_RNGG:
+            case estMC_COUNTS:
+            case estMC_ENER:
                 /* No reallocation required */
                 break;
             default:
@@ -1684,8 +1710,22 @@ static void dd_distribute_state(gmx_domdec_t *dd,t_block *cgs,
             state_local->nosehoover_xi[i]  = state->nosehoover_xi[i];
             state_local->therm_integral[i] = state->therm_integral[i];
         }
+        for(i=0; i<=MC_NR; i++)
+        {
+            state_local->mc_delta[i] = state->mc_delta[i];
+        }
+        for(i=0; i<MC_NR; i++)
+        {
+            state_local->mc_prob[i]  = state->mc_prob[i];
+            state_local->step_ac[i]  = state->step_ac[i];
+            state_local->step_tot[i] = state->step_tot[i];
+        }
     }
     dd_bcast(dd,sizeof(real),&state_local->lambda);
+    dd_bcast(dd,sizeof(state_local->mc_delta),state_local->mc_delta);
+    dd_bcast(dd,sizeof(state_local->mc_prob),state_local->mc_prob);
+    dd_bcast(dd,sizeof(state_local->step_ac),state_local->step_ac);
+    dd_bcast(dd,sizeof(state_local->step_tot),state_local->step_tot);
     dd_bcast(dd,sizeof(state_local->box),state_local->box);
     dd_bcast(dd,sizeof(state_local->box_rel),state_local->box_rel);
     dd_bcast(dd,sizeof(state_local->boxv),state_local->boxv);
@@ -1743,6 +1783,13 @@ static void dd_distribute_state(gmx_domdec_t *dd,t_block *cgs,
             case estDISRE_RM3TAV:
             case estORIRE_INITF:
             case estORIRE_DTAV:
+            case estMC_DELTA:
+            case estMC_PROB:
+            case estMC_RNG:
+            case estMC_RNGI:
+            case estMC_RNGG:
+            case estMC_COUNTS:
+            case estMC_ENER:
                 /* Not implemented yet */
                 break;
             default:
@@ -1959,6 +2006,14 @@ real dd_cutoff_twobody(gmx_domdec_t *dd)
     return max(dd->comm->cutoff,r_mb);
 }
 
+void dd_get_cell_bounds(gmx_domdec_t *dd,rvec cell_x0,rvec cell_x1,
+                        rvec cellsize_min)
+{
+    copy_rvec(dd->comm->cell_x0,cell_x0);
+    copy_rvec(dd->comm->cell_x1,cell_x1);
+    copy_rvec(dd->comm->cellsize_min,cellsize_min);
+}
+
 
 static void dd_cart_coord2pmecoord(gmx_domdec_t *dd,ivec coord,ivec coord_pme)
 {
@@ -1995,6 +2050,11 @@ static int *dd_pmenodes(t_commrec *cr)
     int *pmenodes;
     int n,i,p0,p1;
     
+    /* Place each PME node after the last PP node it communicates with.
+     * As both the DD and PME indices are x-major, with a PME pencil
+     * decomposition the PME nodes of one DD x-slab, which form a
+     * y-communicator of the pencil FFT, are placed consecutively.
+     */
     snew(pmenodes,cr->npmenodes);
     n = 0;
     for(i=0; i<cr->dd->nnodes; i++) {
@@ -2669,7 +2729,7 @@ static void init_ddpme(gmx_domdec_t *dd,gmx_ddpme_t *ddpme,
         /* For y only use our y/z slab.
          * This assumes that the PME x grid size matches the DD grid size.
          */
-        if (dimind == 0 || xyz[YY] == dd->ci[YY]) {
+        if (dimind == 0 || xyz[XX] == dd->ci[XX]) {
             pmeindex = ddindex2pmeindex(dd,i);
             if (dimind == 0) {
                 slab = pmeindex/nso;
@@ -4062,6 +4122,13 @@ static void rotate_state_atom(t_state *state,int a)
             case estDISRE_RM3TAV:
             case estORIRE_INITF:
             case estORIRE_DTAV:
+            case estMC_DELTA:
+            case estMC_PROB:
+            case estMC_RNG:
+            case estMC_RNGI:
+            case estMC_RNGG:
+            case estMC_COUNTS:
+            case estMC_ENER:
                 /* These are distances, so not affected by rotation */
                 break;
             default:
@@ -4118,6 +4185,13 @@ static int dd_redistribute_cg(FILE *fplog,gmx_step_t step,
         case estDISRE_RM3TAV:
         case estORIRE_INITF:
         case estORIRE_DTAV:
+        case estMC_DELTA:
+        case estMC_PROB:
+        case estMC_RNG:
+        case estMC_RNGI:
+        case estMC_RNGG:
+        case estMC_COUNTS:
+        case estMC_ENER:
             /* No processing required */
             break;
         default:
@@ -6037,6 +6111,15 @@ gmx_domdec_t *init_domain_decomposition(FILE *fplog,t_commrec *cr,
     comm->nstDDDumpGrid = dd_nst_env(fplog,"GMX_DD_DUMP_GRID",0);
     comm->DD_debug      = dd_nst_env(fplog,"GMX_DD_DEBUG",0);
 
+    /* MC molecule moves require the atoms of the home molecules
+     * to be consecutive, so we sort the home cgs on global index.
+     */
+    comm->bSortCGGlobal = (EI_MC(ir->eI) || ir->nstmc > 0);
+    if (comm->bSortCGGlobal)
+    {
+        comm->nstSortCG = 1;
+    }
+
     if (dd->bSendRecv2 && fplog)
     {
         fprintf(fplog,"Will use two sequential MPI_Sendrecv calls instead of two simultaneous non-blocking MPI_Irecv and MPI_Isend pairs for constraint and vsite communication\n");
@@ -6072,7 +6155,11 @@ gmx_domdec_t *init_domain_decomposition(FILE *fplog,t_commrec *cr,
     {
         if (fplog)
         {
-            if (comm->nstSortCG == 1)
+            if (comm->bSortCGGlobal)
+            {
+                fprintf(fplog,"Will sort the charge groups on global index at every domain (re)decomposition\n");
+            }
+            else if (comm->nstSortCG == 1)
             {
                 fprintf(fplog,"Will sort the charge groups at every domain (re)decomposition\n");
             }
@@ -6302,10 +6389,24 @@ gmx_domdec_t *init_domain_decomposition(FILE *fplog,t_commrec *cr,
 
     if (EEL_PME(ir->coulombtype))
     {
-        if (FALSE && dd->nc[XX] > cr->npmenodes && cr->npmenodes % dd->nc[XX] == 0)
+        /* Use a pencil decomposition of the PME grid with the major
+         * dimension matching the DD x-dimension when slabs would be
+         * too thin for efficient grid overlap communication and FFTs.
+         */
+        if (dd->nc[XX] > 1 && comm->npmenodes > dd->nc[XX] &&
+            comm->npmenodes % dd->nc[XX] == 0 &&
+            pme_inconvenient_nnodes(ir->nkx,ir->nky,comm->npmenodes) > 0 &&
+            ir->nky > 2*ir->pme_order &&
+            getenv("GMX_PME_1D_DECOMPOSITION") == NULL)
         {
             comm->npmedecompdim   = 2;
             comm->npmenodes_major = dd->nc[XX];
+            if (fplog)
+            {
+                fprintf(fplog,"Using a PME pencil decomposition of %d x %d nodes\n",
+                        comm->npmenodes_major,
+                        comm->npmenodes/comm->npmenodes_major);
+            }
         }
         else
         {
@@ -7673,13 +7774,29 @@ static void ordered_sort(int nsort2,gmx_cgsort_t *sort2,
     }
 }
 
+/* Returns the sort key for home charge group i with ns grid cell
+ * cell_index: the cell index or, when sorting on global index,
+ * only whether the charge group is still at home.
+ */
+static int dd_cgsort_key(gmx_domdec_comm_t *comm,t_grid *grid,int cell_index)
+{
+    if (comm->bSortCGGlobal)
+    {
+        return (cell_index == 4*grid->ncells ? 1 : 0);
+    }
+    else
+    {
+        return cell_index;
+    }
+}
+
 static void dd_sort_state(gmx_domdec_t *dd,int ePBC,
                           rvec *cgcm,t_forcerec *fr,t_state *state,
                           int ncg_home_old)
 {
     gmx_domdec_sort_t *sort;
     gmx_cgsort_t *cgsort,*sort_i;
-    int  ncg_new,nsort2,nsort_new,i,cell_index,*ibuf,cgsize;
+    int  ncg_new,nsort2,nsort_new,i,cell_index,nsc,*ibuf,cgsize;
     rvec *vbuf;
     
     sort = dd->comm->sort;
@@ -7706,7 +7823,8 @@ static void dd_sort_state(gmx_domdec_t *dd,int ePBC,
             cell_index = fr->ns.grid->cell_index[i];
             if (cell_index !=  4*fr->ns.grid->ncells)
             {
-                if (i >= ncg_home_old || cell_index != sort->sort1[i].nsc)
+                nsc = dd_cgsort_key(dd->comm,fr->ns.grid,cell_index);
+                if (i >= ncg_home_old || nsc != sort->sort1[i].nsc)
                 {
                     /* This cg is new on this node or moved ns grid cell */
                     if (nsort_new >= sort->sort_new_nalloc)
@@ -7724,7 +7842,7 @@ static void dd_sort_state(gmx_domdec_t *dd,int ePBC,
                 /* Sort on the ns grid cell indices
                  * and the global topology index
                  */
-                sort_i->nsc    = cell_index;
+                sort_i->nsc    = nsc;
                 sort_i->ind_gl = dd->index_gl[i];
                 sort_i->ind    = i;
                 ncg_new++;
@@ -7747,10 +7865,11 @@ static void dd_sort_state(gmx_domdec_t *dd,int ePBC,
             /* Sort on the ns grid cell indices
              * and the global topology index
              */
-            cgsort[i].nsc    = fr->ns.grid->cell_index[i];
+            cell_index       = fr->ns.grid->cell_index[i];
+            cgsort[i].nsc    = dd_cgsort_key(dd->comm,fr->ns.grid,cell_index);
             cgsort[i].ind_gl = dd->index_gl[i];
             cgsort[i].ind    = i;
-            if (cgsort[i].nsc != 4*fr->ns.grid->ncells)
+            if (cell_index != 4*fr->ns.grid->ncells)
             {
                 ncg_new++;
             }
@@ -7796,6 +7915,13 @@ static void dd_sort_state(gmx_domdec_t *dd,int ePBC,
             case estDISRE_RM3TAV:
             case estORIRE_INITF:
             case estORIRE_DTAV:
+            case estMC_DELTA:
+            case estMC_PROB:
+            case estMC_RNG:
+            case estMC_RNGI:
+            case estMC_RNGG:
+            case estMC_COUNTS:
+            case estMC_ENER:
                 /* No ordering required */
                 break;
             default:
@@ -7832,9 +7958,16 @@ static void dd_sort_state(gmx_domdec_t *dd,int ePBC,
     dd->nat_home = dd->cgindex[dd->ncg_home];
     
     /* Copy the sorted ns cell indices back to the ns grid struct */
-    for(i=0; i<dd->ncg_home; i++)
+    if (dd->comm->bSortCGGlobal)
     {
-        fr->ns.grid->cell_index[i] = cgsort[i].nsc;
+        order_int_cg(dd->ncg_home,cgsort,fr->ns.grid->cell_index,ibuf);
+    }
+    else
+    {
+        for(i=0; i<dd->ncg_home; i++)
+        {
+            fr->ns.grid->cell_index[i] = cgsort[i].nsc;
+        }
     }
     fr->ns.grid->nr = dd->ncg_home;
 }
@@ -230,3 +230,234 @@ real do_ewald(FILE *log,       bool bVerbose,
   
   return energy;
 }
+
+/* Reciprocal space structure factors for MC moves.
+ * S(k) = sum_i q_i exp(i k.x_i) is stored for every k-vector of the
+ * half-space sum used by do_ewald within the cut-off, such that moving
+ * a few atoms only requires the contributions of these atoms to be updated.
+ */
+typedef struct {
+  double *re,*im;      /* S(k) of the trial configuration            */
+  double ener;         /* Reciprocal energy of the trial             */
+  int    nalloc;
+  cvec   **eir_old,**eir_new;
+} t_sfac_trial;
+
+/* The k-vectors depend on the box, they are stored with S(k) */
+typedef struct {
+  int    nk;           /* The number of k-vectors within the cut-off */
+  int    *kvec;        /* The indices ix,iy,iz for each k-vector     */
+  real   *ak;          /* exp(-k^2/(4 beta^2))/k^2 for each k-vector */
+  double *sre,*sim;    /* S(k) of the accepted configuration         */
+  real   fac;          /* 4 pi/V/(4 pi eps0 eps_r)                   */
+  rvec   lll;
+  double ener;         /* Reciprocal energy of the accepted state    */
+} t_sfac_state;
+
+typedef struct gmx_ewald_sfac {
+  int    nx,ny,nz,kmax;
+  int    nk_alloc;     /* The number of k-vectors without cut-off    */
+  real   factor;       /* -1/(4 beta^2)                              */
+  real   kcut2;        /* The squared cut-off for |k|                */
+  t_sfac_state acc;    /* The accepted state                         */
+  t_sfac_state save;   /* The state before the last reset            */
+  int    ntrial;       /* The number of trials that can be kept      */
+  t_sfac_trial *trial;
+} t_gmx_ewald_sfac;
+
+static void sfac_init_state(t_sfac_state *st,int nk_alloc)
+{
+  snew(st->kvec,3*nk_alloc);
+  snew(st->ak,nk_alloc);
+  snew(st->sre,nk_alloc);
+  snew(st->sim,nk_alloc);
+}
+
+gmx_ewald_sfac_t init_ewald_sfac(t_inputrec *ir,real ewaldcoeff,int ntrial)
+{
+  gmx_ewald_sfac_t sfac;
+  int  t;
+
+  snew(sfac,1);
+  if (EEL_PME(ir->coulombtype)) {
+    /* The PME grid does not resolve wave vectors beyond the Nyquist limit */
+    sfac->nx = ir->nkx/2 + 1;
+    sfac->ny = ir->nky/2 + 1;
+    sfac->nz = ir->nkz/2 + 1;
+  } else {
+    sfac->nx = ir->nkx + 1;
+    sfac->ny = ir->nky + 1;
+    sfac->nz = ir->nkz + 1;
+  }
+  sfac->kmax   = max(sfac->nx,max(sfac->ny,sfac->nz));
+  sfac->factor = -1.0/(4*ewaldcoeff*ewaldcoeff);
+  /* Terms with exp(-k^2/(4 beta^2)) < ewald_rtol are below the accuracy
+   * of the real space sum, which is cut off at erfc(beta rc) = ewald_rtol.
+   */
+  sfac->kcut2  = log(ir->ewald_rtol)/sfac->factor;
+
+  sfac->nk_alloc = sfac->nx*(2*sfac->ny - 1)*(2*sfac->nz - 1);
+  sfac_init_state(&sfac->acc,sfac->nk_alloc);
+  sfac_init_state(&sfac->save,sfac->nk_alloc);
+  sfac->ntrial = ntrial;
+  snew(sfac->trial,sfac->ntrial);
+  for(t=0; t<sfac->ntrial; t++) {
+    snew(sfac->trial[t].re,sfac->nk_alloc);
+    snew(sfac->trial[t].im,sfac->nk_alloc);
+    snew(sfac->trial[t].eir_old,sfac->kmax);
+    snew(sfac->trial[t].eir_new,sfac->kmax);
+  }
+
+  return sfac;
+}
+
+/* Selects the k-vectors within the cut-off for the current box */
+static void sfac_set_kvec(gmx_ewald_sfac_t sfac,t_sfac_state *st)
+{
+  int  ix,iy,iz,lowiy,lowiz;
+  real mx,my,mz,m2;
+
+  st->nk = 0;
+  lowiy = 0;
+  lowiz = 1;
+  for(ix=0; ix<sfac->nx; ix++) {
+    mx = ix*st->lll[XX];
+    for(iy=lowiy; iy<sfac->ny; iy++) {
+      my = iy*st->lll[YY];
+      for(iz=lowiz; iz<sfac->nz; iz++) {
+	mz = iz*st->lll[ZZ];
+	m2 = mx*mx + my*my + mz*mz;
+	if (m2 <= sfac->kcut2) {
+	  st->kvec[3*st->nk  ] = ix;
+	  st->kvec[3*st->nk+1] = iy;
+	  st->kvec[3*st->nk+2] = iz;
+	  st->ak[st->nk] = exp(m2*sfac->factor)/m2;
+	  st->nk++;
+	}
+      }
+      lowiz = 1 - sfac->nz;
+    }
+    lowiy = 1 - sfac->ny;
+  }
+}
+
+static void sfac_realloc(gmx_ewald_sfac_t sfac,t_sfac_trial *tr,int natoms)
+{
+  int n;
+
+  if (natoms > tr->nalloc) {
+    tr->nalloc = over_alloc_small(natoms);
+    for(n=0; n<sfac->kmax; n++) {
+      srenew(tr->eir_old[n],tr->nalloc);
+      srenew(tr->eir_new[n],tr->nalloc);
+    }
+  }
+}
+
+/* Returns exp(i k.x) of atom n for k-vector k */
+static inline t_complex sfac_eikx(const int *kvec,cvec **eir,int k,int n)
+{
+  int ix,iy,iz;
+  t_complex c;
+
+  ix = kvec[3*k];
+  iy = kvec[3*k+1];
+  iz = kvec[3*k+2];
+  if (iy >= 0)
+    c = cmul(eir[ix][n][XX],eir[iy][n][YY]);
+  else
+    c = conjmul(eir[ix][n][XX],eir[-iy][n][YY]);
+  if (iz >= 0)
+    c = cmul(c,eir[iz][n][ZZ]);
+  else
+    c = conjmul(c,eir[-iz][n][ZZ]);
+
+  return c;
+}
+
+real ewald_sfac_reset(gmx_ewald_sfac_t sfac,real epsilon_r,rvec box,
+		      int natoms,rvec x[],real charge[])
+{
+  t_sfac_trial *tr=&sfac->trial[0];
+  t_sfac_state tmp,*st;
+  int  k,n;
+  t_complex c;
+
+  /* Keep the current state for ewald_sfac_undo */
+  tmp = sfac->save; sfac->save = sfac->acc; sfac->acc = tmp;
+  st = &sfac->acc;
+
+  calc_lll(box,st->lll);
+  st->fac = 4.0*M_PI/(box[XX]*box[YY]*box[ZZ])*ONE_4PI_EPS0/epsilon_r;
+  sfac_set_kvec(sfac,st);
+  /* Trial 0 is used as scratch space */
+  sfac_realloc(sfac,tr,natoms);
+  tabulate_eir(natoms,x,sfac->kmax,tr->eir_old,st->lll);
+
+  st->ener = 0;
+  for(k=0; k<st->nk; k++) {
+    st->sre[k] = 0;
+    st->sim[k] = 0;
+    for(n=0; n<natoms; n++) {
+      c = sfac_eikx(st->kvec,tr->eir_old,k,n);
+      st->sre[k] += charge[n]*c.re;
+      st->sim[k] += charge[n]*c.im;
+    }
+    st->ener += st->ak[k]*(st->sre[k]*st->sre[k] + st->sim[k]*st->sim[k]);
+  }
+
+  return st->fac*st->ener;
+}
+
+void ewald_sfac_undo(gmx_ewald_sfac_t sfac)
+{
+  t_sfac_state tmp;
+
+  tmp = sfac->save; sfac->save = sfac->acc; sfac->acc = tmp;
+}
+
+real ewald_sfac_energy(gmx_ewald_sfac_t sfac)
+{
+  return sfac->acc.fac*sfac->acc.ener;
+}
+
+real ewald_sfac_delta(gmx_ewald_sfac_t sfac,int trial,int natoms,
+		      rvec xold[],rvec xnew[],real charge[])
+{
+  t_sfac_state *st=&sfac->acc;
+  t_sfac_trial *tr;
+  int  k,n;
+  t_complex cold,cnew;
+
+  if (trial < 0 || trial >= sfac->ntrial)
+    gmx_incons("Ewald structure factor trial out of range");
+  tr = &sfac->trial[trial];
+  sfac_realloc(sfac,tr,natoms);
+  tabulate_eir(natoms,xold,sfac->kmax,tr->eir_old,st->lll);
+  tabulate_eir(natoms,xnew,sfac->kmax,tr->eir_new,st->lll);
+
+  tr->ener = 0;
+  for(k=0; k<st->nk; k++) {
+    tr->re[k] = st->sre[k];
+    tr->im[k] = st->sim[k];
+    for(n=0; n<natoms; n++) {
+      cold = sfac_eikx(st->kvec,tr->eir_old,k,n);
+      cnew = sfac_eikx(st->kvec,tr->eir_new,k,n);
+      tr->re[k] += charge[n]*(cnew.re - cold.re);
+      tr->im[k] += charge[n]*(cnew.im - cold.im);
+    }
+    tr->ener += st->ak[k]*(tr->re[k]*tr->re[k] + tr->im[k]*tr->im[k]);
+  }
+
+  return st->fac*(tr->ener - st->ener);
+}
+
+void ewald_sfac_commit(gmx_ewald_sfac_t sfac,int trial)
+{
+  t_sfac_trial *tr=&sfac->trial[trial];
+  double *tmp;
+
+  tmp = sfac->acc.sre; sfac->acc.sre = tr->re; tr->re = tmp;
+  tmp = sfac->acc.sim; sfac->acc.sim = tr->im; tr->im = tmp;
+  sfac->acc.ener = tr->ener;
+}
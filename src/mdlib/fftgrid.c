@@ -61,6 +61,11 @@ static void print_parfft(FILE *fp,char *title,t_parfft *pfft)
 	  "   local_ny_after_transpose: %3d  local_y_start_after_transpose  %3d\n",
 	  pfft->local_nx,pfft->local_x_start,pfft->local_ny_after_transpose,
 	  pfft->local_y_start_after_transpose);
+  fprintf(fp,
+	  "   local_ny:                 %3d  local_y_start:                 %3d\n"
+	  "   local_nzc_after_transpose:%3d  local_zc_start_after_transpose %3d\n",
+	  pfft->local_ny,pfft->local_y_start,pfft->local_nzc_after_transpose,
+	  pfft->local_zc_start_after_transpose);
 }
 #endif
 
@@ -153,6 +158,11 @@ t_fftgrid *mk_fftgrid(int          nx,
                                   &(grid->pfft.local_nx),
                                   &(grid->pfft.local_y_start_after_transpose),
                                   &(grid->pfft.local_ny_after_transpose));
+        gmx_parallel_3dfft_limits_yz(grid->mpi_fft_setup,
+                                     &(grid->pfft.local_y_start),
+                                     &(grid->pfft.local_ny),
+                                     &(grid->pfft.local_zc_start_after_transpose),
+                                     &(grid->pfft.local_nzc_after_transpose));
 #else
         gmx_fatal(FARGS,"Parallel FFT supported with MPI only!");
 #endif
@@ -187,6 +197,71 @@ t_fftgrid *mk_fftgrid(int          nx,
     return grid;
 }
 
+#ifdef GMX_MPI
+t_fftgrid *mk_fftgrid_pencil(int          nx,
+                             int          ny,
+                             int          nz,
+                             int          *slab2grid_x,
+                             int          *slab2grid_y,
+                             MPI_Comm     comm_x,
+                             MPI_Comm     comm_y,
+                             bool         bReproducible)
+{
+    int           nnodes_x,nnodes_y;
+    int           x1,y1,maxlocalsize;
+    t_fftgrid *   grid;
+    
+    MPI_Comm_size(comm_x,&nnodes_x);
+    MPI_Comm_size(comm_y,&nnodes_y);
+    
+    snew(grid,1);
+    grid->nx   = nx;
+    grid->ny   = ny;
+    grid->nz   = nz;
+    grid->nxyz = nx*ny*nz;
+    grid->bParallel = TRUE;
+    
+    grid->la2r  = (nz/2+1)*2;
+    grid->la2c  = (nz/2+1);    
+    grid->la12r = ny*grid->la2r;
+    grid->la12c = nx*grid->la2c;
+    
+    x1 = (nx % nnodes_x == 0 ? 0 : 1);
+    y1 = (ny % nnodes_x == 0 && ny % nnodes_y == 0 ? 0 : 1);
+    
+    grid->nptr = (nx + x1)*(ny + y1)*grid->la2c*2;
+    
+    gmx_parallel_3dfft_init_pencil(&grid->mpi_fft_setup,nx,ny,nz,
+                                   slab2grid_x,slab2grid_y,comm_x,comm_y,
+                                   bReproducible);
+    
+    gmx_parallel_3dfft_limits(grid->mpi_fft_setup,
+                              &(grid->pfft.local_x_start),
+                              &(grid->pfft.local_nx),
+                              &(grid->pfft.local_y_start_after_transpose),
+                              &(grid->pfft.local_ny_after_transpose));
+    gmx_parallel_3dfft_limits_yz(grid->mpi_fft_setup,
+                                 &(grid->pfft.local_y_start),
+                                 &(grid->pfft.local_ny),
+                                 &(grid->pfft.local_zc_start_after_transpose),
+                                 &(grid->pfft.local_nzc_after_transpose));
+    
+    grid->ptr = (real *)gmx_alloc_aligned(grid->nptr*sizeof(*(grid->ptr)));
+    
+    if (debug) 
+    {
+        print_parfft(debug,"Plan", &grid->pfft);
+    }
+    
+    maxlocalsize = max((nx/nnodes_x + x1)*ny*grid->la2c*2,
+                       (ny/nnodes_x + y1)*nx*grid->la2c*2);
+    grid->workspace = (real *)
+        gmx_alloc_aligned(maxlocalsize*sizeof(*(grid->workspace)));
+    
+    return grid;
+}
+#endif
+
 void 
 pr_fftgrid(FILE *fp,char *title,t_fftgrid *grid)
 {
@@ -227,6 +302,33 @@ void done_fftgrid(t_fftgrid *grid)
 }
 
 
+void set_fftgrid_threads(t_fftgrid *grid,gmx_thread_pool_t pool,
+                         bool bReproducible)
+{
+    int nthreads;
+
+    nthreads = gmx_thread_pool_nthreads(pool);
+    if (grid->bParallel)
+    {
+#ifdef GMX_MPI
+        if (gmx_parallel_3dfft_init_threads(grid->mpi_fft_setup,pool,
+                                            bReproducible) != 0)
+        {
+            gmx_fatal(FARGS,"Could not set up the parallel FFT for %d threads",
+                      nthreads);
+        }
+#endif
+    }
+    else if (gmx_fft_init_threads(nthreads) > 1)
+    {
+        /* Replace the setup by one that uses threads within the transform */
+        gmx_fft_destroy(grid->fft_setup);
+        gmx_fft_init_3d_real(&grid->fft_setup,grid->nx,grid->ny,grid->nz,
+                             bReproducible ? GMX_FFT_FLAG_CONSERVATIVE : GMX_FFT_FLAG_NONE);
+        gmx_fft_init_threads(1);
+    }
+}
+
 void gmxfft3D(t_fftgrid *grid,enum gmx_fft_direction dir,t_commrec *cr)
 {
   real *tmp;
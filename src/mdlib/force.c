@@ -53,6 +53,8 @@
 #include "network.h"
 #include "pbc.h"
 #include "ns.h"
+#include "nbnxn.h"
+#include "nsgrid.h"
 #include "nrnb.h"
 #include "bondf.h"
 #include "mshift.h"
@@ -67,6 +69,8 @@
 #include "mpelogging.h"
 #include "copyrite.h"
 #include "mtop_util.h"
+#include "mctrial.h"
+#include "atomsort.h"
 
 t_forcerec *mk_forcerec(void)
 {
@@ -1166,321 +1170,1935 @@ static real cutoff_inf(real cutoff)
 
     return cutoff;
 }
-void init_enerd_mc(gmx_mc_move *mc_move,gmx_localtop_t *top,int homenr)
+/* Data for evaluating the energy change of an MC trial move locally.
+ * Only the interactions involving the atoms of the moved molecule are
+ * computed, both for the accepted and for the trial configuration.
+ * The charge-group centers and the atom offsets with respect to these
+ * centers are stored for the accepted configuration, such that the
+ * pair distances of the unmoved atoms never need to be recomputed and
+ * the result does not depend on how molecules are broken over the
+ * periodic boundaries.
+ */
+/* Work data for the batch kernel evaluation of a set of configurations */
+typedef struct {
+    int      nalloc;
+    rvec     **cm;         /* Charge-group centers of each configuration */
+    rvec     **off;        /* Atom offsets of each configuration       */
+    rvec     *dcg;         /* Cg center distance in each configuration */
+    int      *cls;         /* 0: short-range, 1: long-range, 2: beyond */
+    real     *sx,*sy,*sz;  /* i-atom positions, padded for the kernel  */
+    real     *vc,*vvdw;    /* Energies of a cg pair, padded            */
+    real     *rsq,*rinv,*eps;
+    int      *nnn;
+    real     *ener;        /* Coulomb SR, LR, VdW SR, LR per configuration */
+} t_mc_batch;
+
+/* Work data for the evaluation of one trial move,
+ * trials with different work data can be evaluated concurrently.
+ */
+typedef struct {
+    int      cg0,cg1;      /* The charge groups of the trial move      */
+    int      set_nalloc;
+    rvec     *set_cm;      /* Trial centers of the moved charge groups */
+    int      off_nalloc;
+    rvec     *set_off;     /* Trial offsets of the moved atoms         */
+    int      *excl_mark;   /* Exclusion marker, natoms                 */
+    int      excl_stamp;
+    int      *b_done[F_NRE]; /* Stamp per interaction, avoids doubles  */
+    int      b_stamp;
+    int      nbsel;        /* The bondeds involving the moved atoms    */
+    int      bsel_nalloc;
+    int      *bsel_ftype;
+    int      *bsel_ia;
+    rvec     *xb;          /* Bonded coordinates, made whole with PBC  */
+    rvec     *f;           /* Scratch forces for the bonded routines   */
+    rvec     fshift[SHIFTS];
+    gmx_enerdata_t enerd14; /* Scratch group energies for 1-4 pairs    */
+    int      jcg_nalloc;
+    int      *jcg;         /* Neighbor cg's of the moved cg            */
+    bool     bHalo;        /* Only consider the cg's in halo           */
+    int      nhalo;
+    int      *halo;        /* Set by the caller, not owned             */
+    real     dener[F_NRE]; /* The energy change of the trial           */
+    t_mc_batch batch;
+} t_mc_trial;
+
+/* The change of the structure factors by the last full evaluation */
+enum { esfacNONE, esfacTRIAL, esfacRESET };
+
+typedef struct gmx_mc_ener {
+    bool     bIncremental; /* Can trial moves be evaluated locally?    */
+    int      icoul;        /* Coulomb type, as for the nblists         */
+    int      ivdw;         /* VdW type, as for the nblists             */
+    bool     bEwald;       /* Ewald or PME reciprocal space            */
+    gmx_ewald_sfac_t sfac; /* Structure factors for Ewald and PME      */
+    bool     bSfac;        /* Do they belong to the accepted state?    */
+    int      sfac_pending; /* Not yet accepted change, esfac...        */
+    int      natoms;
+    int      ncg;
+    int      *a2cg;        /* The charge group of each atom            */
+    rvec     *cg_cm;       /* Charge-group centers, accepted state     */
+    rvec     *x_off;       /* Atom offsets from the cg center          */
+    int      *b_index;     /* Bondeds per atom, index in b_ftype/b_ia  */
+    int      *b_ftype;     /* Interaction type of each bonded entry    */
+    int      *b_ia;        /* Offset of the entry in the iatoms array  */
+    t_grid   *grid;        /* The ns grid, NULL with simple search     */
+    bool     bGrid;        /* Use the MC cell lists of grid            */
+    bool     bBatch;       /* Can multiple trials use the batch kernel? */
+    int      ntrial;       /* The number of trial work data sets       */
+    t_mc_trial *trial;
+    int      itrial;       /* The trial to commit                      */
+    int      *cg2mol;      /* Molecule of each cg, for volume moves    */
+    bool     *cg_single;   /* Is the cg a molecule of a single atom?   */
+    bool     bVolInterOnly; /* Are all intramolecular pairs excluded?  */
+    bool     bVolComp;     /* Are single-atom molecule pair energies
+                            * evaluated as r^-12, r^-6, r^-1 sums?     */
+    rvec     *vol_cm;      /* The cg centers after a volume move       */
+    rvec     *vol_off;     /* Atom offsets after a volume move         */
+    int      vol_npair;    /* Buffered intermolecular cg pair list
+                            * for volume moves, -1 when not built      */
+    int      vol_pair_nalloc;
+    int      *vol_pair;    /* The cg pairs, 2 per pair                 */
+    rvec     *vol_dref;    /* Pair distance vectors at the reference   */
+    rvec     *vol_cmref;   /* The cg centers at the reference          */
+    real     vol_boxref;   /* The box length at the reference          */
+    real     vol_rlist;    /* The list cut-off at the reference        */
+    rvec     *vol_dev[2];  /* Deviation of the cg centers from the
+                            * scaled reference, before and after      */
+} t_gmx_mc_ener;
+
+/* The relative buffer of the volume move pair list */
+#define MC_VOL_BUFFER 0.1
+
+static bool mc_bonded_ftype(int ftype)
+{
+    return ((ftype < F_GB12 || ftype > F_GB14) &&
+            (interaction_function[ftype].flags & IF_BOND) &&
+            !(ftype == F_CONNBONDS || ftype == F_POSRES));
+}
+
+static bool mc_incremental_supported(FILE *fplog,const t_inputrec *ir,
+                                     t_forcerec *fr,gmx_localtop_t *top,
+                                     t_mdatoms *md,matrix box)
+{
+    const char *reason=NULL;
+    t_idef *idef = &top->idef;
+
+    if (ir->efep != efepNO)
+    {
+        reason = "free-energy perturbation";
+    }
+    else if (fr->bGB || ir->implicit_solvent)
+    {
+        reason = "implicit solvent";
+    }
+    else if (fr->bQMMM)
+    {
+        reason = "QM/MM";
+    }
+    else if (ir->nwall > 0)
+    {
+        reason = "walls";
+    }
+    else if (fr->eeltype == eelPPPM || fr->eeltype == eelPOISSON)
+    {
+        reason = "this coulombtype";
+    }
+    else if (NEED_MUTOT(*ir))
+    {
+        reason = "Ewald dipole corrections";
+    }
+    else if (EEL_FULL(fr->eeltype) && TRICLINIC(box))
+    {
+        reason = "Ewald in a triclinic box";
+    }
+    else if (idef->il[F_POSRES].nr > 0 || idef->il[F_DISRES].nr > 0 ||
+             idef->il[F_ORIRES].nr > 0 || idef->il[F_CMAP].nr > 0)
+    {
+        reason = "position, distance or orientation restraints or CMAP";
+    }
+    else if (md->nr != md->homenr && !fr->bDomDec)
+    {
+        reason = "particle decomposition";
+    }
+    else if (fr->bDomDec && EEL_FULL(fr->eeltype))
+    {
+        /* The structure factors would need a global summation */
+        reason = "Ewald with domain decomposition";
+    }
+
+    if (reason != NULL && fplog)
+    {
+        fprintf(fplog,"\nMC trial moves are evaluated with full force calls, "
+                "incremental energies are not supported with %s\n",reason);
+    }
+
+    return (reason == NULL);
+}
+
+static void mc_make_bonded_index(t_gmx_mc_ener *mce,t_idef *idef)
 {
-  int nbonds,ftype,nra,i,s;
-  t_idef *idef = &top->idef;
-  t_block *cgs = &top->cgs;
+    int ftype,nral,i,j,a,n,*count;
 
-  snew(mc_move->enerd,F_NRE);
-  snew(mc_move->enerd_prev,F_NRE);
-  for(ftype=0; (ftype<F_NRE); ftype++) {
-	  if(ftype<F_GB12 || ftype>F_GB14) {
-    if (interaction_function[ftype].flags & IF_BOND &&
-	!(ftype == F_CONNBONDS || ftype == F_POSRES)) {
-      nra = NRAL(ftype);
-      nbonds=idef->il[ftype].nr/(nra+1);
-      if (nbonds > 0) {
-	if (ftype < F_LJ14 || ftype > F_LJC_PAIRS_NB) {
-         snew(mc_move->enerd[ftype],nbonds);
-         snew(mc_move->enerd_prev[ftype],nbonds);
+    snew(count,mce->natoms+1);
+    for(ftype=0; ftype<F_NRE; ftype++)
+    {
+        if (mc_bonded_ftype(ftype) && idef->il[ftype].nr > 0)
+        {
+            nral = NRAL(ftype);
+            for(i=0; i<idef->il[ftype].nr; i+=1+nral)
+            {
+                for(j=1; j<=nral; j++)
+                {
+                    count[idef->il[ftype].iatoms[i+j]]++;
+                }
+            }
         }
-       }
     }
-  }
- }
- snew(mc_move->enerd[F_COUL_SR],homenr*homenr);
- snew(mc_move->enerd_prev[F_COUL_SR],homenr*homenr);
- snew(mc_move->enerd[F_LJ],homenr*homenr);
- snew(mc_move->enerd_prev[F_LJ],homenr*homenr);
- snew(mc_move->enerd[F_LJ14],homenr*homenr);
- snew(mc_move->enerd_prev[F_LJ14],homenr*homenr);
- snew(mc_move->enerd[F_COUL14],homenr*homenr);
- snew(mc_move->enerd_prev[F_COUL14],homenr*homenr);
- snew(mc_move->enerd[F_COUL_RECIP],1);
- snew(mc_move->enerd_prev[F_COUL_RECIP],1);
- snew(mc_move->sum_index,cgs->nr);
- s=0;
- for(i=0;i<cgs->nr;i++)
- {
-  s+=i;
-  //s=0;
-  mc_move->sum_index[i] = s;
- }
-}
-void clean_enerd_mc(gmx_mc_move *mc_move,gmx_localtop_t *top,t_forcerec *fr,int homenr,bool copy)
-{
-  int nbonds,ftype,i,j,nra,k,l,ii,jj,s,index;
-  int ai,aj,ak,al;
-  real sum;
-  t_iatom *forceatoms;
-  t_nblists *nblists;
-  t_nblist *nlist;
-  t_idef *idef = &top->idef;
-  t_block *cgs = &top->cgs;
-  bool *done;
-
-  snew(done,homenr);
-
-  for(ftype=0; (ftype<F_NRE); ftype++) {
-	  if(ftype<F_GB12 || ftype>F_GB14) {
-    if (interaction_function[ftype].flags & IF_BOND &&
-	!(ftype == F_CONNBONDS || ftype == F_POSRES)) {
-      nbonds=idef->il[ftype].nr;
-      nra = NRAL(ftype);
-      forceatoms = idef->il[ftype].iatoms;
-      if (nbonds > 0) {
-	if (ftype < F_LJ14 || ftype > F_LJC_PAIRS_NB) {
-         for(i=0,k=0; (i<nbonds); k++) 
-         {
-          i++;
-          if(copy && (!mc_move->n_mc || mc_move->mvgroup >= MC_BONDS))
-          {
-           switch(nra)
-           {
-            case 2:
-            ai   = forceatoms[i++];
-            aj   = forceatoms[i++];
-           
-            if(WITHIN_MOVE(ai) || WITHIN_MOVE(aj))
-            {
-             mc_move->enerd_prev[ftype][k] = mc_move->enerd[ftype][k];
-            } 
+    snew(mce->b_index,mce->natoms+1);
+    for(a=0; a<mce->natoms; a++)
+    {
+        mce->b_index[a+1] = mce->b_index[a] + count[a];
+        count[a] = mce->b_index[a];
+    }
+    n = mce->b_index[mce->natoms];
+    snew(mce->b_ftype,n);
+    snew(mce->b_ia,n);
+    for(ftype=0; ftype<F_NRE; ftype++)
+    {
+        if (mc_bonded_ftype(ftype) && idef->il[ftype].nr > 0)
+        {
+            nral = NRAL(ftype);
+            for(i=0; i<idef->il[ftype].nr; i+=1+nral)
+            {
+                for(j=1; j<=nral; j++)
+                {
+                    a = idef->il[ftype].iatoms[i+j];
+                    mce->b_ftype[count[a]] = ftype;
+                    mce->b_ia[count[a]]    = i;
+                    count[a]++;
+                }
+            }
+        }
+    }
+    sfree(count);
+}
+
+/* (Re)allocates the topology dependent work data of a trial.
+ * The markers are compared with stamps that are never zero,
+ * so the cleared arrays do not need to match the old stamps.
+ */
+static void mc_set_trial_top(t_gmx_mc_ener *mce,t_mc_trial *tr,t_idef *idef)
+{
+    int ftype;
+
+    for(ftype=0; ftype<F_NRE; ftype++)
+    {
+        sfree(tr->b_done[ftype]);
+        tr->b_done[ftype] = NULL;
+        if (mc_bonded_ftype(ftype) && idef->il[ftype].nr > 0)
+        {
+            snew(tr->b_done[ftype],idef->il[ftype].nr/(1+NRAL(ftype)));
+        }
+    }
+    sfree(tr->excl_mark);
+    sfree(tr->xb);
+    sfree(tr->f);
+    snew(tr->excl_mark,mce->natoms);
+    snew(tr->xb,mce->natoms);
+    snew(tr->f,mce->natoms);
+}
+
+static void mc_init_trial(t_gmx_mc_ener *mce,t_mc_trial *tr,
+                          t_idef *idef,int ngener)
+{
+    mc_set_trial_top(mce,tr,idef);
+    init_enerdata(ngener,0,&tr->enerd14);
+}
+
+/* (Re)allocates the data that depends on the local topology */
+static void mc_set_top(t_gmx_mc_ener *mce,gmx_localtop_t *top,t_mdatoms *md)
+{
+    t_block *cgs = &top->cgs;
+    int     cg,a;
+
+    mce->natoms = md->nr;
+    mce->ncg    = cgs->nr;
+    sfree(mce->a2cg);
+    snew(mce->a2cg,mce->natoms);
+    for(cg=0; cg<cgs->nr; cg++)
+    {
+        for(a=cgs->index[cg]; a<cgs->index[cg+1]; a++)
+        {
+            mce->a2cg[a] = cg;
+        }
+    }
+    sfree(mce->cg_cm);
+    sfree(mce->x_off);
+    snew(mce->cg_cm,mce->ncg);
+    snew(mce->x_off,mce->natoms);
+
+    sfree(mce->b_index);
+    sfree(mce->b_ftype);
+    sfree(mce->b_ia);
+    mc_make_bonded_index(mce,&top->idef);
+}
+
+void init_enerd_mc(FILE *fplog,gmx_mc_move *mc_move,t_inputrec *ir,
+                   t_forcerec *fr,gmx_localtop_t *top,t_mdatoms *md,
+                   matrix box)
+{
+    t_gmx_mc_ener *mce;
+    int     t,k;
+
+    /* The per-interaction energy buffers of the kernels are not used,
+     * the kernels skip them when the entries are NULL.
+     */
+    snew(mc_move->enerd,F_NRE);
+    snew(mc_move->enerd_prev,F_NRE);
+
+    snew(mce,1);
+    mc_move->ener = mce;
+
+    mce->bIncremental = mc_incremental_supported(fplog,ir,fr,top,md,box);
+    if (!mce->bIncremental)
+    {
+        return;
+    }
+
+    /* Determine the interaction types the same way as for the nblists */
+    if (fr->bcoultab)
+    {
+        mce->icoul = 3;
+    }
+    else if (EEL_RF(fr->eeltype))
+    {
+        mce->icoul = 2;
+    }
+    else
+    {
+        mce->icoul = 1;
+    }
+    if (fr->bvdwtab)
+    {
+        mce->ivdw = 3;
+    }
+    else if (fr->bBHAM)
+    {
+        mce->ivdw = 2;
+    }
+    else
+    {
+        mce->ivdw = 1;
+    }
+
+    /* Multiple-trial moves and regrowth need work data for each trial,
+     * checkerboard sweeps for each thread.
+     */
+    mce->ntrial = max(1,max(ir->mc_ntrial,ir->mc_regrow_ntrial));
+    if (ir->bMCCheckerboard)
+    {
+        mce->ntrial = max(mce->ntrial,mc_move->nthreads);
+    }
+
+    mce->bEwald = EEL_FULL(fr->eeltype);
+    if (mce->bEwald)
+    {
+        mce->sfac = init_ewald_sfac(ir,fr->ewaldcoeff,mce->ntrial);
+    }
+
+    mc_set_top(mce,top,md);
+    snew(mce->trial,mce->ntrial);
+    for(t=0; t<mce->ntrial; t++)
+    {
+        mc_init_trial(mce,&mce->trial[t],&top->idef,ir->opts.ngener);
+    }
+
+    mce->grid = fr->bGrid ? fr->ns.grid : NULL;
+
+    /* The batch kernel uses the tables of the first list and does not
+     * check energy group exclusions.
+     */
+    mce->bBatch = (getenv("GMX_MC_NO_BATCH") == NULL && fr->nnblists == 1 &&
+                   !(fr->bBHAM && fr->bvdwtab));
+    for(k=0; k<md->nenergrp*md->nenergrp && mce->bBatch; k++)
+    {
+        if (fr->egp_flags && (fr->egp_flags[k] & EGP_EXCL))
+        {
+            mce->bBatch = FALSE;
+        }
+    }
+
+    if (fplog)
+    {
+        fprintf(fplog,"\nMC trial moves are evaluated incrementally, "
+                "only interactions of the moved molecule are computed\n");
+        if (mce->bEwald)
+        {
+            fprintf(fplog,"The reciprocal space energy of all MC "
+                    "configurations is computed with an Ewald sum\n");
+        }
+        if (mce->bBatch && (ir->mc_ntrial > 1 || ir->mc_regrow_ntrial > 0))
+        {
+            fprintf(fplog,"The non-bonded interactions of multiple trials "
+                    "are computed in one pass with the batch kernel\n");
+        }
+    }
+}
+
+bool enerd_mc_incremental(gmx_mc_move *mc_move)
+{
+    return (mc_move->ener != NULL && mc_move->ener->bIncremental);
+}
+
+void set_enerd_mc_top(gmx_mc_move *mc_move,t_forcerec *fr,
+                      gmx_localtop_t *top,t_mdatoms *md,
+                      matrix box,rvec x[])
+{
+    t_gmx_mc_ener *mce = mc_move->ener;
+    int t;
+
+    if (!enerd_mc_incremental(mc_move))
+    {
+        return;
+    }
+    mc_set_top(mce,top,md);
+    for(t=0; t<mce->ntrial; t++)
+    {
+        mc_set_trial_top(mce,&mce->trial[t],&top->idef);
+    }
+    /* The atom order changed, the structure factors are recomputed */
+    mce->sfac_pending = esfacNONE;
+    reset_enerd_mc(mc_move,fr,top,md,box,x);
+}
+
+/* Computes the center of the charge groups cg0 to cg1 and the offsets
+ * of their atoms with respect to these centers. The offsets are
+ * determined with PBC, such that charge groups do not need to be whole.
+ */
+static void mc_calc_cg_offsets(const t_block *cgs,const t_pbc *pbc,rvec x[],
+                               int cg0,int cg1,rvec *cm,rvec *off)
+{
+    int  cg,a,a0,a1,d;
+    rvec sum;
+    real inv;
+
+    for(cg=cg0; cg<cg1; cg++)
+    {
+        a0 = cgs->index[cg];
+        a1 = cgs->index[cg+1];
+        clear_rvec(sum);
+        for(a=a0; a<a1; a++)
+        {
+            if (pbc)
+            {
+                pbc_dx_aiuc(pbc,x[a],x[a0],off[a]);
+            }
+            else
+            {
+                rvec_sub(x[a],x[a0],off[a]);
+            }
+            rvec_inc(sum,off[a]);
+        }
+        inv = 1.0/(a1 - a0);
+        for(d=0; d<DIM; d++)
+        {
+            sum[d] *= inv;
+        }
+        rvec_add(x[a0],sum,cm[cg]);
+        for(a=a0; a<a1; a++)
+        {
+            rvec_dec(off[a],sum);
+        }
+    }
+}
+
+void reset_enerd_mc(gmx_mc_move *mc_move,t_forcerec *fr,gmx_localtop_t *top,
+                    t_mdatoms *md,matrix box,rvec x[])
+{
+    t_gmx_mc_ener *mce = mc_move->ener;
+    t_pbc pbc;
+    rvec  box_size;
+    int   d;
+
+    if (!enerd_mc_incremental(mc_move))
+    {
+        return;
+    }
+    set_pbc(&pbc,fr->ePBC,box);
+    mc_calc_cg_offsets(&top->cgs,fr->ePBC==epbcNONE ? NULL : &pbc,x,
+                       0,mce->ncg,mce->cg_cm,mce->x_off);
+
+    /* The cell lists are only updated for the moved charge groups,
+     * the full lists are rebuilt here after each full evaluation.
+     */
+    mce->bGrid = (mce->grid != NULL && fr->ePBC == epbcXYZ && !TRICLINIC(box));
+    if (mce->bGrid)
+    {
+        grid_mc_fill(mce->grid,box,mce->ncg,mce->cg_cm);
+    }
+    if (mce->bEwald)
+    {
+        /* The full evaluation already computed the structure factors
+         * of x, they are only recomputed when x was replaced.
+         */
+        if (mce->sfac_pending == esfacTRIAL)
+        {
+            ewald_sfac_commit(mce->sfac,0);
+        }
+        else if (mce->sfac_pending == esfacNONE)
+        {
+            for(d=0; d<DIM; d++)
+            {
+                box_size[d] = box[d][d];
+            }
+            ewald_sfac_reset(mce->sfac,fr->epsilon_r,box_size,
+                             md->nr,x,md->chargeA);
+        }
+        mce->sfac_pending = esfacNONE;
+        mce->bSfac        = TRUE;
+    }
+    /* Rebuild the volume move pair list, so the summation order only
+     * depends on the moves since the last full evaluation.
+     */
+    mce->vol_npair = -1;
+}
+
+/* The energy of one atom pair, the same as in gmx_nb_generic_kernel */
+static void mc_pair_energy(t_gmx_mc_ener *mce,t_forcerec *fr,t_mdatoms *md,
+                           t_nblists *nbl,int ai,int aj,real rsq,
+                           real *vcoul,real *vvdw)
+{
+    int  icoul,ivdw,tj,n0,nnn;
+    real qq,rinv,rinvsq,rinvsix,r,rt,eps,eps2,Y,F,Geps,Heps2,VV;
+    real *tab,c6,c12;
+
+    icoul  = mce->icoul;
+    ivdw   = mce->ivdw;
+    rinv   = invsqrt(rsq);
+    rinvsq = rinv*rinv;
+    tab    = nbl->tab.tab;
+    eps    = 0;
+    eps2   = 0;
+    nnn    = 0;
+    if (icoul == 3 || ivdw == 3)
+    {
+        r    = rsq*rinv;
+        rt   = r*nbl->tab.scale;
+        n0   = rt;
+        eps  = rt - n0;
+        eps2 = eps*eps;
+        nnn  = 12*n0;
+    }
+
+    qq = fr->epsfac*md->chargeA[ai]*md->chargeA[aj];
+    if (qq != 0)
+    {
+        switch (icoul)
+        {
+        case 1:
+            *vcoul += qq*rinv;
             break;
-            case 3:
-            ai   = forceatoms[i++];
-            aj   = forceatoms[i++];
-            ak   = forceatoms[i++];
-           
-            if(WITHIN_MOVE(ai) || WITHIN_MOVE(aj) || WITHIN_MOVE(ak))
-            {
-             mc_move->enerd_prev[ftype][k] = mc_move->enerd[ftype][k];
-            } 
+        case 2:
+            *vcoul += qq*(rinv + fr->k_rf*rsq - fr->c_rf);
             break;
-            case 4:
-            ai   = forceatoms[i++];
-            aj   = forceatoms[i++];
-            ak   = forceatoms[i++];
-            al   = forceatoms[i++];
-            
-            if(WITHIN_MOVE(ai) || WITHIN_MOVE(aj) || WITHIN_MOVE(ak) || WITHIN_MOVE(al))
-            {
-             mc_move->enerd_prev[ftype][k] = mc_move->enerd[ftype][k];
-            } 
+        case 3:
+            Y      = tab[nnn];
+            F      = tab[nnn+1];
+            Geps   = eps*tab[nnn+2];
+            Heps2  = eps2*tab[nnn+3];
+            VV     = Y + eps*(F + Geps + Heps2);
+            *vcoul += qq*VV;
             break;
-           }
-          }
-          else
-          {
-           i = i + nra;
-          }
-          mc_move->enerd[ftype][k] = 0;
         }
-       }
-     }
     }
-  }
- }
- sum=0;
-  for(ii=0;ii<cgs->nr;ii++)
-  {
-    if(done[ii] || cgs->index[ii] < mc_move->start || cgs->index[ii] >= mc_move->end)
+
+    if (fr->bBHAM)
     {
-     continue;
+        tj = 3*(fr->ntype*md->typeA[ai] + md->typeA[aj]);
+        if (ivdw == 3)
+        {
+            gmx_fatal(FARGS,"Tabulated Buckingham is not supported with MC");
+        }
+        rinvsix = rinvsq*rinvsq*rinvsq;
+        *vvdw  += fr->nbfp[tj+1]*exp(-fr->nbfp[tj+2]*rsq*rinv)
+            - fr->nbfp[tj]*rinvsix;
     }
-     for(jj=0;jj<cgs->nr;jj++)
-     {
-      if(done[jj] || jj == ii)
-      {
-       continue;
-      }
+    else
+    {
+        tj  = 2*(fr->ntype*md->typeA[ai] + md->typeA[aj]);
+        c6  = fr->nbfp[tj];
+        c12 = fr->nbfp[tj+1];
+        if (c6 != 0 || c12 != 0)
+        {
+            if (ivdw == 3)
+            {
+                nnn   += 4;
+                Y      = tab[nnn];
+                F      = tab[nnn+1];
+                Geps   = eps*tab[nnn+2];
+                Heps2  = eps2*tab[nnn+3];
+                VV     = Y + eps*(F + Geps + Heps2);
+                *vvdw += c6*VV;
+                nnn   += 4;
+                Y      = tab[nnn];
+                F      = tab[nnn+1];
+                Geps   = eps*tab[nnn+2];
+                Heps2  = eps2*tab[nnn+3];
+                VV     = Y + eps*(F + Geps + Heps2);
+                *vvdw += c12*VV;
+            }
+            else
+            {
+                rinvsix = rinvsq*rinvsq*rinvsq;
+                *vvdw  += (c12*rinvsix - c6)*rinvsix;
+            }
+        }
+    }
+}
 
-     index = ((ii < jj) ? ii*homenr-mc_move->sum_index[ii]+jj : jj*homenr - mc_move->sum_index[jj] + ii);
-     
-
-  //    sum+=mc_move->enerd[F_COUL_SR][index];
-     if(copy)
-     {
-      //printf("%d %d\n",ii,jj);
-      mc_move->enerd_prev[F_COUL_SR][index] = mc_move->enerd[F_COUL_SR][index];
-      mc_move->enerd_prev[F_LJ][index] = mc_move->enerd[F_LJ][index];
-     // mc_move->enerd_prev[F_LJ14][index] = mc_move->enerd[F_LJ14][index];
-     // mc_move->enerd_prev[F_COUL14][index] = mc_move->enerd[F_COUL14][index];
-     }
-      mc_move->enerd[F_COUL_SR][index] = 0;
-      mc_move->enerd[F_LJ][index] = 0;
-     // mc_move->enerd[F_LJ14][index] = 0;
-     // mc_move->enerd[F_COUL14][index] = 0;
-    }
-    done[ii]=TRUE;
-  }
-  sfree(done);
+/* Computes the interactions between the atoms of charge groups icg and jcg
+ * with centers cm_i and cm_j, the atom offsets are off_i and off_j.
+ * Excluded pairs are skipped, these are corrected by mc_calc_excl_corr.
+ */
+static void mc_cg_pair_energy(t_gmx_mc_ener *mce,t_mc_trial *tr,
+                              t_forcerec *fr,
+                              t_mdatoms *md,gmx_localtop_t *top,
+                              const t_pbc *pbc,int icg,int jcg,
+                              rvec cm_i,rvec *off_i,rvec cm_j,rvec *off_j,
+                              real vcoul[],real vvdw[])
+{
+    t_block  *cgs   = &top->cgs;
+    t_blocka *excls = &top->excls;
+    int      ai,aj,ai0,ai1,aj0,aj1,k,ngener,nbl_ind;
+    int      *excl_mark;
+    bool     bLR,bEgpExcl;
+    real     r2,rsq;
+    rvec     dcg,dx;
 
- if(copy)
- {
-  mc_move->enerd_prev[F_COUL_RECIP][0] = mc_move->enerd[F_COUL_RECIP][0];
- }
-  /*for(i=0;i<homenr;i++)
-  {
+    if (pbc)
+    {
+        pbc_dx(pbc,cm_i,cm_j,dcg);
+    }
+    else
+    {
+        rvec_sub(cm_i,cm_j,dcg);
+    }
+    r2 = norm2(dcg);
+    if (r2 >= sqr(max(fr->rlist,fr->rlistlong)))
+    {
+        return;
+    }
+    bLR       = (r2 >= sqr(fr->rlist));
+    ngener    = fr->nnblists > 1 || fr->egp_flags ? md->nenergrp : 0;
+    excl_mark = tr->excl_mark;
+    ai0       = cgs->index[icg];
+    ai1       = cgs->index[icg+1];
+    aj0       = cgs->index[jcg];
+    aj1       = cgs->index[jcg+1];
+    for(ai=ai0; ai<ai1; ai++)
+    {
+        tr->excl_stamp++;
+        for(k=excls->index[ai]; k<excls->index[ai+1]; k++)
+        {
+            excl_mark[excls->a[k]] = tr->excl_stamp;
+        }
+        for(aj=(jcg == icg ? ai+1 : aj0); aj<aj1; aj++)
+        {
+            rvec_add(dcg,off_i[ai],dx);
+            rvec_dec(dx,off_j[aj]);
+            rsq = norm2(dx);
+            if (excl_mark[aj] == tr->excl_stamp)
+            {
+                continue;
+            }
+            if (ngener > 0)
+            {
+                k = GID(md->cENER[ai],md->cENER[aj],ngener);
+                bEgpExcl = (fr->egp_flags[k] & EGP_EXCL);
+                nbl_ind  = fr->gid2nblists ? fr->gid2nblists[k] : 0;
+            }
+            else
+            {
+                bEgpExcl = FALSE;
+                nbl_ind  = 0;
+            }
+            if (!bEgpExcl)
+            {
+                mc_pair_energy(mce,fr,md,&fr->nblists[nbl_ind],
+                               ai,aj,rsq,&vcoul[bLR],&vvdw[bLR]);
+            }
+        }
+    }
+}
 
-   for(j=i+1;j<homenr;j++)
-   {
-     k=i*homenr-mc_move->sum_index[i]+j;
-
-     if(WITHIN_MOVE(i) || WITHIN_MOVE(j))
-     {
-      sum+=mc_move->enerd[F_COUL_SR][k];
-     }
-     if(copy && (WITHIN_MOVE(i) || WITHIN_MOVE(j)))
-     {
-            mc_move->enerd_prev[F_COUL_SR][k] = mc_move->enerd[F_COUL_SR][k];
-            mc_move->enerd_prev[F_LJ][k] = mc_move->enerd[F_LJ][k];
-     }
-
-     mc_move->enerd[F_COUL_SR][k] = 0;
-     mc_move->enerd[F_LJ][k] = 0;
-    //mc_move->enerd[F_COUL_SR][k] = 0;
-    //mc_move->enerd[F_LJ][k] = 0;
-   }
-  }*/
- /*for(i=0;i<homenr;i++)
- {
-  for(j=i+1;j<homenr;j++)
-  {
-   k=i*homenr-mc_move->sum_index[i]+j;
-   mc_move->enerd[F_COUL_SR][k] = 0;
-   mc_move->enerd[F_LJ][k] = 0;
-  }
- }*/
- //printf("sum %f\n",sum);
+/* Computes the reaction-field or Ewald corrections of all excluded pairs
+ * of the atoms of charge groups cg0 to cg1, with centers cm_set and atom
+ * offsets off_set. As in the full evaluation every excluded pair is
+ * corrected, independently of the cut-off. The partners outside the set
+ * are taken from the accepted state.
+ */
+static void mc_calc_excl_corr(t_gmx_mc_ener *mce,t_forcerec *fr,
+                              t_mdatoms *md,gmx_localtop_t *top,
+                              const t_pbc *pbc,int cg0,int cg1,
+                              rvec *cm_set,rvec *off_set,
+                              real *vrfexcl,real *vexcl)
+{
+    t_block  *cgs   = &top->cgs;
+    t_blocka *excls = &top->excls;
+    bool     bRF;
+    int      a0,a1,ai,aj,k;
+    real     *cm_j,rsq,qq,rinv;
+    rvec     *off_j,dcg,dx;
+
+    bRF = (EEL_RF(fr->eeltype) && fr->eeltype != eelRF_NEC);
+    if (!bRF && !mce->bEwald)
+    {
+        return;
+    }
+    a0 = cgs->index[cg0];
+    a1 = cgs->index[cg1];
+    for(ai=a0; ai<a1; ai++)
+    {
+        for(k=excls->index[ai]; k<excls->index[ai+1]; k++)
+        {
+            aj = excls->a[k];
+            /* Pairs within the set once, the self pair is constant */
+            if (aj == ai || (aj >= a0 && aj < a1 && aj < ai) ||
+                aj >= mce->natoms)
+            {
+                continue;
+            }
+            if (aj >= a0 && aj < a1)
+            {
+                cm_j  = cm_set[mce->a2cg[aj]-cg0];
+                off_j = off_set - a0;
+            }
+            else
+            {
+                cm_j  = mce->cg_cm[mce->a2cg[aj]];
+                off_j = mce->x_off;
+            }
+            if (pbc)
+            {
+                pbc_dx(pbc,cm_set[mce->a2cg[ai]-cg0],cm_j,dcg);
+            }
+            else
+            {
+                rvec_sub(cm_set[mce->a2cg[ai]-cg0],cm_j,dcg);
+            }
+            rvec_add(dcg,off_set[ai-a0],dx);
+            rvec_dec(dx,off_j[aj]);
+            rsq = norm2(dx);
+            qq  = md->chargeA[ai]*md->chargeA[aj];
+            if (bRF)
+            {
+                *vrfexcl += qq*(fr->epsfac*fr->k_rf*rsq -
+                                fr->epsfac*fr->c_rf);
+            }
+            else if (rsq > 0)
+            {
+                /* Remove the reciprocal space interaction */
+                rinv   = invsqrt(rsq);
+                *vexcl -= fr->epsfac*qq*gmx_erf(fr->ewaldcoeff*rsq*rinv)*rinv;
+            }
+        }
+    }
+}
+
+/* Computes the non-bonded energy of charge groups cg0 to cg1 with centers
+ * cm_set and atom offsets off_set with all charge groups. With the MC cell
+ * lists only the charge groups in the neighboring cells are considered,
+ * with a halo only the charge groups in the halo.
+ * With bEnv=FALSE only the pairs within the set are computed.
+ */
+static void mc_calc_nonbonded(t_gmx_mc_ener *mce,t_mc_trial *tr,
+                              t_forcerec *fr,
+                              t_mdatoms *md,gmx_localtop_t *top,
+                              const t_pbc *pbc,int cg0,int cg1,
+                              rvec *cm_set,rvec *off_set,bool bEnv,
+                              real *ener)
+{
+    t_block  *cgs   = &top->cgs;
+    int      icg,jcg,j,nj,a0;
+    real     vcoul[2],vvdw[2],vrfexcl,vexcl;
+    rvec     *off_i;
+
+    a0       = cgs->index[cg0];
+    off_i    = off_set - a0;
+
+    vcoul[0] = vcoul[1] = 0;
+    vvdw[0]  = vvdw[1]  = 0;
+    vrfexcl  = 0;
+    vexcl    = 0;
+
+    for(icg=cg0; icg<cg1; icg++)
+    {
+        /* Pairs within the moved set, each pair once */
+        for(jcg=icg; jcg<cg1; jcg++)
+        {
+            mc_cg_pair_energy(mce,tr,fr,md,top,pbc,icg,jcg,
+                              cm_set[icg-cg0],off_i,cm_set[jcg-cg0],off_i,
+                              vcoul,vvdw);
+        }
+        /* Pairs with the unmoved charge groups */
+        if (!bEnv)
+        {
+            nj = 0;
+        }
+        else if (tr->bHalo)
+        {
+            nj = tr->nhalo;
+        }
+        else if (mce->bGrid)
+        {
+            nj = grid_mc_neighbors(mce->grid,cm_set[icg-cg0],
+                                   max(fr->rlist,fr->rlistlong),
+                                   &tr->jcg_nalloc,&tr->jcg);
+        }
+        else
+        {
+            nj = mce->ncg;
+        }
+        for(j=0; j<nj; j++)
+        {
+            if (tr->bHalo)
+            {
+                jcg = tr->halo[j];
+            }
+            else
+            {
+                jcg = mce->bGrid ? tr->jcg[j] : j;
+            }
+            if (jcg >= cg0 && jcg < cg1)
+            {
+                continue;
+            }
+            mc_cg_pair_energy(mce,tr,fr,md,top,pbc,icg,jcg,
+                              cm_set[icg-cg0],off_i,
+                              mce->cg_cm[jcg],mce->x_off,
+                              vcoul,vvdw);
+        }
+    }
+    mc_calc_excl_corr(mce,fr,md,top,pbc,cg0,cg1,cm_set,off_set,
+                      &vrfexcl,&vexcl);
+
+    ener[F_COUL_SR] += vcoul[0];
+    ener[F_COUL_LR] += vcoul[1];
+    if (fr->bBHAM)
+    {
+        ener[F_BHAM]    += vvdw[0];
+        ener[F_BHAM_LR] += vvdw[1];
+    }
+    else
+    {
+        ener[F_LJ]    += vvdw[0];
+        ener[F_LJ_LR] += vvdw[1];
+    }
+    ener[F_RF_EXCL]    += vrfexcl;
+    ener[F_COUL_RECIP] += vexcl;
+}
+
+/* Selects the bonded interactions involving atoms start to end */
+static void mc_select_bondeds(t_gmx_mc_ener *mce,t_mc_trial *tr,
+                              int start,int end)
+{
+    int a,k,ftype,ia;
+
+    tr->b_stamp++;
+    tr->nbsel = 0;
+    for(a=start; a<end; a++)
+    {
+        for(k=mce->b_index[a]; k<mce->b_index[a+1]; k++)
+        {
+            ftype = mce->b_ftype[k];
+            ia    = mce->b_ia[k];
+            if (tr->b_done[ftype][ia/(1+NRAL(ftype))] != tr->b_stamp)
+            {
+                tr->b_done[ftype][ia/(1+NRAL(ftype))] = tr->b_stamp;
+                if (tr->nbsel >= tr->bsel_nalloc)
+                {
+                    tr->bsel_nalloc = over_alloc_small(tr->nbsel+1);
+                    srenew(tr->bsel_ftype,tr->bsel_nalloc);
+                    srenew(tr->bsel_ia,tr->bsel_nalloc);
+                }
+                tr->bsel_ftype[tr->nbsel] = ftype;
+                tr->bsel_ia[tr->nbsel]    = ia;
+                tr->nbsel++;
+            }
+        }
+    }
+}
+
+/* Computes the energies of the selected bonded interactions.
+ * The coordinates are not necessarily whole, so we make each
+ * interaction whole with respect to its first atom.
+ */
+static void mc_calc_bondeds(t_mc_trial *tr,t_forcerec *fr,t_mdatoms *md,
+                            t_fcdata *fcd,t_idef *idef,const t_pbc *pbc,
+                            rvec x[],real lambda,real *ener)
+{
+    gmx_grppairener_t *grpp = &tr->enerd14.grpp;
+    int  s,ftype,nral,i;
+    real dvdl;
+    rvec dx;
+    t_iatom *ia;
+
+    for(s=0; s<tr->nbsel; s++)
+    {
+        ftype = tr->bsel_ftype[s];
+        nral  = NRAL(ftype);
+        ia    = idef->il[ftype].iatoms + tr->bsel_ia[s];
+        copy_rvec(x[ia[1]],tr->xb[ia[1]]);
+        for(i=2; i<=nral; i++)
+        {
+            if (pbc)
+            {
+                pbc_dx_aiuc(pbc,x[ia[i]],x[ia[1]],dx);
+            }
+            else
+            {
+                rvec_sub(x[ia[i]],x[ia[1]],dx);
+            }
+            rvec_add(x[ia[1]],dx,tr->xb[ia[i]]);
+        }
+        dvdl = 0;
+        if (ftype >= F_LJ14 && ftype <= F_LJC_PAIRS_NB)
+        {
+            do_listed_vdw_q(ftype,1+nral,ia,idef->iparams,
+                            (const rvec*)tr->xb,tr->f,tr->fshift,
+                            pbc,NULL,lambda,&dvdl,md,fr,grpp,NULL,NULL);
+        }
+        else
+        {
+            ener[ftype] +=
+                interaction_function[ftype].ifunc(1+nral,ia,idef->iparams,
+                                                  (const rvec*)tr->xb,tr->f,
+                                                  tr->fshift,pbc,NULL,
+                                                  lambda,&dvdl,md,fcd,
+                                                  NULL,ftype,NULL);
+        }
+        /* We only need energies, clear the forces we generated */
+        for(i=1; i<=nral; i++)
+        {
+            clear_rvec(tr->f[ia[i]]);
+        }
+    }
+    for(i=0; i<grpp->nener; i++)
+    {
+        ener[F_LJ14]   += grpp->ener[egLJ14][i];
+        ener[F_COUL14] += grpp->ener[egCOUL14][i];
+        grpp->ener[egLJ14][i]   = 0;
+        grpp->ener[egCOUL14][i] = 0;
+    }
+}
+
+/* Sets the charge groups of the move and their trial centers and offsets */
+static void mc_trial_coords(t_gmx_mc_ener *mce,t_mc_trial *tr,
+                            gmx_mc_move *mc_move,t_block *cgs,
+                            const t_pbc *pbc,rvec x[])
+{
+    int a0,natoms_set;
+
+    /* The moved molecule always consists of complete charge groups */
+    tr->cg0 = mce->a2cg[mc_move->start];
+    tr->cg1 = mce->a2cg[mc_move->end-1] + 1;
+    a0 = cgs->index[tr->cg0];
+    natoms_set = cgs->index[tr->cg1] - a0;
+    if (tr->cg1 - tr->cg0 > tr->set_nalloc)
+    {
+        tr->set_nalloc = over_alloc_small(tr->cg1 - tr->cg0);
+        srenew(tr->set_cm,tr->set_nalloc);
+    }
+    if (natoms_set > tr->off_nalloc)
+    {
+        tr->off_nalloc = over_alloc_small(natoms_set);
+        srenew(tr->set_off,tr->off_nalloc);
+    }
+    mc_calc_cg_offsets(cgs,pbc,x,tr->cg0,tr->cg1,
+                       tr->set_cm-tr->cg0,tr->set_off-a0);
+}
+
+/* Computes the energy change of trial, for which mc_trial_coords should
+ * have been called. When denv!=NULL the non-bonded interactions with
+ * the unmoved charge groups are not computed, but taken from denv,
+ * which contains the changes in Coulomb and VdW SR and LR energy.
+ */
+static real mc_trial_epot(t_gmx_mc_ener *mce,t_mc_trial *tr,int trial,
+                          gmx_mc_move *mc_move,t_forcerec *fr,
+                          gmx_localtop_t *top,t_mdatoms *md,t_fcdata *fcd,
+                          const t_pbc *pbc,rvec xprev[],rvec x[],
+                          real lambda,const real *denv)
+{
+    int     i,a0;
+    real    ener_prev[F_NRE],ener[F_NRE],depot;
+
+    a0 = top->cgs.index[tr->cg0];
+
+    for(i=0; i<F_NRE; i++)
+    {
+        ener_prev[i] = 0;
+        ener[i]      = 0;
+    }
+
+    mc_calc_nonbonded(mce,tr,fr,md,top,pbc,tr->cg0,tr->cg1,
+                      mce->cg_cm+tr->cg0,mce->x_off+a0,denv==NULL,ener_prev);
+    mc_calc_nonbonded(mce,tr,fr,md,top,pbc,tr->cg0,tr->cg1,
+                      tr->set_cm,tr->set_off,denv==NULL,ener);
+    if (denv)
+    {
+        ener[F_COUL_SR] += denv[0];
+        ener[F_COUL_LR] += denv[1];
+        ener[fr->bBHAM ? F_BHAM : F_LJ]       += denv[2];
+        ener[fr->bBHAM ? F_BHAM_LR : F_LJ_LR] += denv[3];
+    }
+
+    mc_select_bondeds(mce,tr,mc_move->start,mc_move->end);
+    mc_calc_bondeds(tr,fr,md,fcd,&top->idef,pbc,xprev,lambda,ener_prev);
+    mc_calc_bondeds(tr,fr,md,fcd,&top->idef,pbc,x,lambda,ener);
+
+    if (mce->bEwald)
+    {
+        ener[F_COUL_RECIP] +=
+            ewald_sfac_delta(mce->sfac,trial,mc_move->end-mc_move->start,
+                             xprev+mc_move->start,x+mc_move->start,
+                             md->chargeA+mc_move->start);
+    }
+
+    depot = 0;
+    for(i=0; i<F_EPOT; i++)
+    {
+        tr->dener[i] = ener[i] - ener_prev[i];
+        if (i != F_DISRESVIOL && i != F_ORIRESDEV && i != F_DIHRESVIOL)
+        {
+            depot += tr->dener[i];
+        }
+    }
+
+    return depot;
+}
+
+static void mc_check_trial(t_gmx_mc_ener *mce,gmx_mc_move *mc_move,int trial)
+{
+    if (!enerd_mc_incremental(mc_move))
+    {
+        gmx_incons("trial_epot_mc called without incremental MC energies");
+    }
+    if (trial < 0 || trial >= mce->ntrial)
+    {
+        gmx_incons("MC trial index out of range");
+    }
+}
+
+real trial_epot_mc(gmx_mc_move *mc_move,int trial,t_forcerec *fr,
+                   gmx_localtop_t *top,t_mdatoms *md,t_fcdata *fcd,
+                   matrix box,rvec xprev[],rvec x[],real lambda)
+{
+    t_gmx_mc_ener *mce = mc_move->ener;
+    t_mc_trial *tr;
+    t_pbc   pbc,*pbc_null;
+
+    mc_check_trial(mce,mc_move,trial);
+    tr = &mce->trial[trial];
+
+    if (fr->ePBC != epbcNONE)
+    {
+        set_pbc(&pbc,fr->ePBC,box);
+        pbc_null = &pbc;
+    }
+    else
+    {
+        pbc_null = NULL;
+    }
+
+    mc_trial_coords(mce,tr,mc_move,&top->cgs,pbc_null,x);
+
+    return mc_trial_epot(mce,tr,trial,mc_move,fr,top,md,fcd,pbc_null,
+                         xprev,x,lambda,NULL);
+}
+
+static void mc_batch_realloc(t_mc_batch *bt,int nconf)
+{
+    int nbp;
+
+    if (nconf > bt->nalloc)
+    {
+        bt->nalloc = over_alloc_small(nconf);
+        nbp = nb_batch_padded(bt->nalloc);
+        srenew(bt->cm,bt->nalloc);
+        srenew(bt->off,bt->nalloc);
+        srenew(bt->dcg,bt->nalloc);
+        srenew(bt->cls,bt->nalloc);
+        srenew(bt->sx,nbp);
+        srenew(bt->sy,nbp);
+        srenew(bt->sz,nbp);
+        srenew(bt->vc,nbp);
+        srenew(bt->vvdw,nbp);
+        srenew(bt->rsq,bt->nalloc);
+        srenew(bt->rinv,bt->nalloc);
+        srenew(bt->eps,bt->nalloc);
+        srenew(bt->nnn,bt->nalloc);
+        srenew(bt->ener,4*bt->nalloc);
+    }
+}
+
+/* Computes the non-bonded energies of charge groups cg0 to cg1 with the
+ * unmoved charge groups for the nconf configurations with centers
+ * bt->cm[c] and atom offsets bt->off[c]. Each neighbor is loaded once
+ * and interacts with all configurations through the batch kernel.
+ * The cut-off is applied per configuration, so the energies are
+ * those of mc_calc_nonbonded. Returns the Coulomb SR, LR and VdW SR, LR
+ * energies of configuration c in bt->ener[4*c] to bt->ener[4*c+3].
+ */
+static void mc_batch_nonbonded(t_gmx_mc_ener *mce,t_mc_trial *tr,
+                               t_forcerec *fr,t_mdatoms *md,
+                               gmx_localtop_t *top,const t_pbc *pbc,
+                               int cg0,int cg1,int nconf)
+{
+    t_mc_batch *bt = &tr->batch;
+    t_block *cgs = &top->cgs;
+    int      nbp,icg,jcg,j,nj,c,e,ai,a0;
+    real     rc,rc2,rs2,dmax2;
+    rvec     dx;
+    bool     bIn;
+
+    nbp = nb_batch_padded(nconf);
+    rc  = max(fr->rlist,fr->rlistlong);
+    rc2 = sqr(rc);
+    rs2 = sqr(fr->rlist);
+    a0  = cgs->index[cg0];
+    for(c=0; c<4*nconf; c++)
+    {
+        bt->ener[c] = 0;
+    }
+
+    for(icg=cg0; icg<cg1; icg++)
+    {
+        if (tr->bHalo)
+        {
+            nj = tr->nhalo;
+        }
+        else if (mce->bGrid)
+        {
+            /* Search around the first configuration, far enough to find
+             * the neighbors of all configurations.
+             */
+            dmax2 = 0;
+            for(c=1; c<nconf; c++)
+            {
+                if (pbc)
+                {
+                    pbc_dx(pbc,bt->cm[c][icg-cg0],bt->cm[0][icg-cg0],dx);
+                }
+                else
+                {
+                    rvec_sub(bt->cm[c][icg-cg0],bt->cm[0][icg-cg0],dx);
+                }
+                dmax2 = max(dmax2,norm2(dx));
+            }
+            nj = grid_mc_neighbors(mce->grid,bt->cm[0][icg-cg0],
+                                   rc + sqrt(dmax2),
+                                   &tr->jcg_nalloc,&tr->jcg);
+        }
+        else
+        {
+            nj = mce->ncg;
+        }
+        for(j=0; j<nj; j++)
+        {
+            if (tr->bHalo)
+            {
+                jcg = tr->halo[j];
+            }
+            else
+            {
+                jcg = mce->bGrid ? tr->jcg[j] : j;
+            }
+            if (jcg >= cg0 && jcg < cg1)
+            {
+                continue;
+            }
+            bIn = FALSE;
+            for(c=0; c<nconf; c++)
+            {
+                if (pbc)
+                {
+                    pbc_dx(pbc,bt->cm[c][icg-cg0],mce->cg_cm[jcg],bt->dcg[c]);
+                }
+                else
+                {
+                    rvec_sub(bt->cm[c][icg-cg0],mce->cg_cm[jcg],bt->dcg[c]);
+                }
+                dmax2 = norm2(bt->dcg[c]);
+                bt->cls[c] = (dmax2 >= rc2 ? 2 : (dmax2 >= rs2 ? 1 : 0));
+                bIn = bIn || (bt->cls[c] < 2);
+            }
+            if (!bIn)
+            {
+                continue;
+            }
+
+            for(c=0; c<nbp; c++)
+            {
+                bt->vc[c]   = 0;
+                bt->vvdw[c] = 0;
+            }
+            for(ai=cgs->index[icg]; ai<cgs->index[icg+1]; ai++)
+            {
+                /* The positions relative to the center of jcg,
+                 * padded with copies of the first configuration.
+                 */
+                for(c=0; c<nbp; c++)
+                {
+                    e = (c < nconf ? c : 0);
+                    bt->sx[c] = bt->dcg[e][XX] + bt->off[e][ai-a0][XX];
+                    bt->sy[c] = bt->dcg[e][YY] + bt->off[e][ai-a0][YY];
+                    bt->sz[c] = bt->dcg[e][ZZ] + bt->off[e][ai-a0][ZZ];
+                }
+                do_nonbonded_batch_cg(fr,&fr->nblists[0],mce->icoul,mce->ivdw,
+                                      md,ai,cgs->index[jcg],
+                                      cgs->index[jcg+1]-cgs->index[jcg],
+                                      mce->x_off,nconf,bt->sx,bt->sy,bt->sz,
+                                      bt->rsq,bt->rinv,bt->eps,bt->nnn,
+                                      bt->vc,bt->vvdw);
+            }
+            for(c=0; c<nconf; c++)
+            {
+                if (bt->cls[c] < 2)
+                {
+                    bt->ener[4*c+bt->cls[c]]   += bt->vc[c];
+                    bt->ener[4*c+2+bt->cls[c]] += bt->vvdw[c];
+                }
+            }
+        }
+    }
+}
+
+/* Exclusions with other molecules are not handled by the batch */
+static bool mc_batch_supported(t_gmx_mc_ener *mce,gmx_localtop_t *top,
+                               gmx_mc_move *mc_move)
+{
+    t_blocka *excls = &top->excls;
+    int      a,k;
+
+    if (!mce->bBatch)
+    {
+        return FALSE;
+    }
+    for(a=mc_move->start; a<mc_move->end; a++)
+    {
+        for(k=excls->index[a]; k<excls->index[a+1]; k++)
+        {
+            if (excls->a[k] < mc_move->start || excls->a[k] >= mc_move->end)
+            {
+                return FALSE;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+void trial_epot_mc_batch(gmx_mc_move *mc_move,int k0,int k1,int skip,
+                         t_forcerec *fr,gmx_localtop_t *top,t_mdatoms *md,
+                         t_fcdata *fcd,matrix box,rvec xprev[],rvec *xt[],
+                         real lambda,double dU[])
+{
+    t_gmx_mc_ener *mce = mc_move->ener;
+    t_mc_trial *tr,*trb;
+    t_mc_batch *bt;
+    t_pbc   pbc,*pbc_null;
+    int     k,c,e,nconf;
+    real    denv[4];
+
+    for(k=k0; k<k1; k++)
+    {
+        mc_check_trial(mce,mc_move,k);
+    }
+
+    if (!mc_batch_supported(mce,top,mc_move) || k1 - k0 <= 1)
+    {
+        for(k=k0; k<k1; k++)
+        {
+            if (k != skip)
+            {
+                dU[k] = trial_epot_mc(mc_move,k,fr,top,md,fcd,box,xprev,
+                                      xt[k]-mc_move->start,lambda);
+            }
+        }
+        return;
+    }
+
+    if (fr->ePBC != epbcNONE)
+    {
+        set_pbc(&pbc,fr->ePBC,box);
+        pbc_null = &pbc;
+    }
+    else
+    {
+        pbc_null = NULL;
+    }
+
+    /* The work data of the first trial holds the batch,
+     * the accepted configuration is configuration 0.
+     */
+    trb = &mce->trial[k0 == skip ? k0 + 1 : k0];
+    bt  = &trb->batch;
+    mc_batch_realloc(bt,1+k1-k0);
+    nconf = 1;
+    for(k=k0; k<k1; k++)
+    {
+        if (k != skip)
+        {
+            tr = &mce->trial[k];
+            mc_trial_coords(mce,tr,mc_move,&top->cgs,pbc_null,
+                            xt[k]-mc_move->start);
+            bt->cm[nconf]  = tr->set_cm;
+            bt->off[nconf] = tr->set_off;
+            nconf++;
+        }
+    }
+    bt->cm[0]  = mce->cg_cm + trb->cg0;
+    bt->off[0] = mce->x_off + top->cgs.index[trb->cg0];
+
+    mc_batch_nonbonded(mce,trb,fr,md,top,pbc_null,trb->cg0,trb->cg1,nconf);
+
+    c = 1;
+    for(k=k0; k<k1; k++)
+    {
+        if (k != skip)
+        {
+            for(e=0; e<4; e++)
+            {
+                denv[e] = bt->ener[4*c+e] - bt->ener[e];
+            }
+            dU[k] = mc_trial_epot(mce,&mce->trial[k],k,mc_move,fr,top,md,fcd,
+                                  pbc_null,xprev,xt[k]-mc_move->start,lambda,
+                                  denv);
+            c++;
+        }
+    }
+}
+
+void set_enerd_mc(gmx_enerdata_t *enerd,gmx_enerdata_t *enerd_prev,
+                  gmx_mc_move *mc_move,int trial)
+{
+    t_gmx_mc_ener *mce = mc_move->ener;
+    int i;
+
+    enerd->term[F_EPOT] = 0;
+    for(i=0; i<F_EPOT; i++)
+    {
+        enerd->term[i] = enerd_prev->term[i] + mce->trial[trial].dener[i];
+        if (i != F_DISRESVIOL && i != F_ORIRESDEV && i != F_DIHRESVIOL)
+        {
+            enerd->term[F_EPOT] += enerd->term[i];
+        }
+    }
+    mce->itrial = trial;
+}
+
+real delta_enerd_mc(gmx_enerdata_t *enerd,gmx_enerdata_t *enerd_prev,
+                    gmx_mc_move *mc_move,t_forcerec *fr,gmx_localtop_t *top,
+                    t_mdatoms *md,t_fcdata *fcd,matrix box,
+                    rvec xprev[],rvec x[],real lambda)
+{
+    trial_epot_mc(mc_move,0,fr,top,md,fcd,box,xprev,x,lambda);
+    set_enerd_mc(enerd,enerd_prev,mc_move,0);
+
+    return enerd->term[F_EPOT] - enerd_prev->term[F_EPOT];
+}
+
+bool volume_enerd_mc_supported(gmx_mc_move *mc_move,t_forcerec *fr,
+                               matrix box)
+{
+    return (enerd_mc_incremental(mc_move) && !mc_move->ener->bEwald &&
+            !fr->bDomDec && fr->ePBC == epbcXYZ && !TRICLINIC(box));
+}
+
+static void mc_init_volume(t_gmx_mc_ener *mce,t_forcerec *fr,
+                           gmx_localtop_t *top,t_block *mols)
+{
+    t_block  *cgs   = &top->cgs;
+    t_blocka *excls = &top->excls;
+    int      m,a,a0,a1,k,n,cg,*a2mol;
+
+    snew(a2mol,mce->natoms);
+    mce->bVolInterOnly = TRUE;
+    for(m=0; m<mols->nr; m++)
+    {
+        a0 = mols->index[m];
+        a1 = mols->index[m+1];
+        for(a=a0; a<a1; a++)
+        {
+            a2mol[a] = m;
+            /* The exclusions are unique and include the atom itself */
+            n = 0;
+            for(k=excls->index[a]; k<excls->index[a+1]; k++)
+            {
+                if (excls->a[k] >= a0 && excls->a[k] < a1)
+                {
+                    n++;
+                }
+            }
+            mce->bVolInterOnly = mce->bVolInterOnly && (n == a1 - a0);
+        }
+    }
+    snew(mce->cg2mol,mce->ncg);
+    snew(mce->cg_single,mce->ncg);
+    for(cg=0; cg<mce->ncg; cg++)
+    {
+        m = a2mol[cgs->index[cg]];
+        mce->cg2mol[cg]    = m;
+        mce->cg_single[cg] = (mols->index[m+1] - mols->index[m] == 1);
+    }
+    sfree(a2mol);
+
+    /* Without tables and twin-range the single atom pair energies
+     * are sums of powers of r.
+     */
+    mce->bVolComp = (!mce->bVolInterOnly &&
+                     mce->ivdw == 1 && !fr->bBHAM && mce->icoul != 3 &&
+                     fr->rlistlong <= fr->rlist);
+
+    snew(mce->vol_cm,mce->ncg);
+    snew(mce->vol_off,mce->natoms);
+    snew(mce->vol_cmref,mce->ncg);
+    snew(mce->vol_dev[0],mce->ncg);
+    snew(mce->vol_dev[1],mce->ncg);
+    mce->vol_npair       = -1;
+    mce->vol_pair_nalloc = 0;
+}
+
+/* Adds the power components of the energy of a pair of single-atom
+ * molecules at distance^2 rsq to comp:
+ * c12 r^-12, c6 r^-6, qq r^-1, qq k_rf r^2 and -qq c_rf.
+ */
+static void mc_pair_comp(t_forcerec *fr,t_mdatoms *md,int ai,int aj,
+                         real rsq,double comp[])
+{
+    int  tj;
+    real qq,rinv,rinvsix;
+
+    rinv    = invsqrt(rsq);
+    rinvsix = rinv*rinv*rinv;
+    rinvsix = rinvsix*rinvsix;
+    tj      = 2*(fr->ntype*md->typeA[ai] + md->typeA[aj]);
+    comp[0] += fr->nbfp[tj+1]*rinvsix*rinvsix;
+    comp[1] += fr->nbfp[tj]*rinvsix;
+    qq = fr->epsfac*md->chargeA[ai]*md->chargeA[aj];
+    comp[2] += qq*rinv;
+    if (EEL_RF(fr->eeltype))
+    {
+        comp[3] += qq*fr->k_rf*rsq;
+        comp[4] -= qq*fr->c_rf;
+    }
+}
+
+/* The energy of two charge groups of different molecules at center
+ * distance vector dcg, these never have exclusions.
+ */
+static void mc_volume_cg_pair(t_gmx_mc_ener *mce,t_forcerec *fr,
+                              t_mdatoms *md,t_block *cgs,int icg,int jcg,
+                              rvec dcg,rvec *off,int nbl_ind,bool bLR,
+                              real vcoul[],real vvdw[])
+{
+    int  ai,aj,aj0,aj1;
+    real *nbfp,qi,k_rf,c_rf,rsq,rinv,rinvsix,vc,vv;
+    rvec dx,xi;
+
+    aj0 = cgs->index[jcg];
+    aj1 = cgs->index[jcg+1];
+    if (mce->ivdw != 1 || fr->bBHAM || mce->icoul == 3)
+    {
+        for(ai=cgs->index[icg]; ai<cgs->index[icg+1]; ai++)
+        {
+            for(aj=aj0; aj<aj1; aj++)
+            {
+                rvec_add(dcg,off[ai],dx);
+                rvec_dec(dx,off[aj]);
+                mc_pair_energy(mce,fr,md,&fr->nblists[nbl_ind],ai,aj,
+                               norm2(dx),&vcoul[bLR],&vvdw[bLR]);
+            }
+        }
+        return;
+    }
+
+    /* Plain or reaction-field Coulomb and plain LJ, as above */
+    k_rf = (mce->icoul == 2 ? fr->k_rf : 0);
+    c_rf = (mce->icoul == 2 ? fr->c_rf : 0);
+    vc   = 0;
+    vv   = 0;
+    for(ai=cgs->index[icg]; ai<cgs->index[icg+1]; ai++)
+    {
+        rvec_add(dcg,off[ai],xi);
+        qi   = fr->epsfac*md->chargeA[ai];
+        nbfp = fr->nbfp + 2*fr->ntype*md->typeA[ai];
+        for(aj=aj0; aj<aj1; aj++)
+        {
+            rvec_sub(xi,off[aj],dx);
+            rsq     = norm2(dx);
+            rinv    = invsqrt(rsq);
+            rinvsix = rinv*rinv*rinv;
+            rinvsix = rinvsix*rinvsix;
+            vc     += qi*md->chargeA[aj]*(rinv + k_rf*rsq - c_rf);
+            vv     += (nbfp[2*md->typeA[aj]+1]*rinvsix -
+                       nbfp[2*md->typeA[aj]])*rinvsix;
+        }
+    }
+    vcoul[bLR] += vc;
+    vvdw[bLR]  += vv;
+}
+
+/* Returns the maximum deviation dev of the cg centers cm in the box
+ * of pbc from the reference centers scaled by s.
+ */
+static real mc_volume_dev(t_gmx_mc_ener *mce,const t_pbc *pbc,rvec *cm,
+                          real s,rvec *dev)
+{
+    int  cg;
+    real dmax2;
+    rvec sx;
+
+    dmax2 = 0;
+    for(cg=0; cg<mce->ncg; cg++)
+    {
+        svmul(s,mce->vol_cmref[cg],sx);
+        pbc_dx(pbc,cm[cg],sx,dev[cg]);
+        dmax2 = max(dmax2,norm2(dev[cg]));
+    }
+
+    return sqrt(dmax2);
+}
+
+/* Makes the list of intermolecular cg pairs within rlist of the accepted
+ * centers, which become the reference, in the rectangular box.
+ */
+static void mc_volume_pairlist(t_gmx_mc_ener *mce,t_forcerec *fr,
+                               t_mdatoms *md,t_block *cgs,matrix box,
+                               real rlist)
+{
+    t_mc_trial *tr = &mce->trial[0];
+    int  icg,jcg,j,nj,m,ngener;
+    rvec hbox,d;
+    real rl2;
+    bool bGrid;
+
+    rl2    = sqr(rlist);
+    ngener = (md->nenergrp > 1 ? md->nenergrp : 0);
+    /* A grid query spanning the whole box is slower than a plain loop */
+    bGrid  = mce->bGrid;
+    for(m=0; m<DIM; m++)
+    {
+        hbox[m] = 0.5*box[m][m];
+        if (bGrid)
+        {
+            bGrid = (2*((int)(rlist*mce->grid->mc_inv_size[m]) + 1) + 1 <
+                     mce->grid->mc_n[m]);
+        }
+    }
+
+    mce->vol_npair = 0;
+    for(icg=0; icg<mce->ncg; icg++)
+    {
+        copy_rvec(mce->cg_cm[icg],mce->vol_cmref[icg]);
+        if (bGrid)
+        {
+            nj = grid_mc_neighbors(mce->grid,mce->cg_cm[icg],rlist,
+                                   &tr->jcg_nalloc,&tr->jcg);
+        }
+        else
+        {
+            nj = mce->ncg;
+        }
+        for(j=(bGrid ? 0 : icg+1); j<nj; j++)
+        {
+            jcg = bGrid ? tr->jcg[j] : j;
+            if (jcg <= icg || mce->cg2mol[jcg] == mce->cg2mol[icg])
+            {
+                continue;
+            }
+            /* Rectangular minimum image, as in pbc_dx,
+             * the centers can be more than a box apart.
+             */
+            for(m=0; m<DIM; m++)
+            {
+                d[m] = mce->cg_cm[icg][m] - mce->cg_cm[jcg][m];
+                while (d[m] > hbox[m])
+                {
+                    d[m] -= box[m][m];
+                }
+                while (d[m] <= -hbox[m])
+                {
+                    d[m] += box[m][m];
+                }
+            }
+            if (norm2(d) >= rl2 ||
+                (ngener > 0 &&
+                 (fr->egp_flags[GID(md->cENER[cgs->index[icg]],
+                                    md->cENER[cgs->index[jcg]],ngener)]
+                  & EGP_EXCL)))
+            {
+                continue;
+            }
+            if (mce->vol_npair >= mce->vol_pair_nalloc)
+            {
+                mce->vol_pair_nalloc = over_alloc_large(mce->vol_npair+1);
+                srenew(mce->vol_pair,2*mce->vol_pair_nalloc);
+                srenew(mce->vol_dref,mce->vol_pair_nalloc);
+            }
+            mce->vol_pair[2*mce->vol_npair]   = icg;
+            mce->vol_pair[2*mce->vol_npair+1] = jcg;
+            copy_rvec(d,mce->vol_dref[mce->vol_npair]);
+            mce->vol_npair++;
+        }
+    }
+    mce->vol_boxref = box[XX][XX];
+    mce->vol_rlist  = rlist;
+}
+
+real delta_volume_enerd_mc(gmx_enerdata_t *enerd,gmx_enerdata_t *enerd_prev,
+                           gmx_mc_move *mc_move,t_forcerec *fr,
+                           gmx_localtop_t *top,t_mdatoms *md,t_block *mols,
+                           matrix box_prev,matrix box,rvec x[])
+{
+    t_gmx_mc_ener *mce = mc_move->ener;
+    t_block *cgs = &top->cgs;
+    t_mc_trial *tr;
+    t_pbc   pbc,pbc_prev;
+    double  ener_prev[F_NRE],ener[F_NRE],comp[5];
+    real    s,s0,s1,rl2,rc,rc2,dmax0,dmax1,r2,r2n,depot;
+    real    vcoul[2][2],vvdw[2][2];
+    int     i,p,icg,jcg,ngener,k,m,nbl_ind;
+    rvec    *dev0,*dev1,*cm,d,dn,hbox[2];
+    bool    bSingle;
+
+    if (!volume_enerd_mc_supported(mc_move,fr,box))
+    {
+        gmx_incons("delta_volume_enerd_mc called for an unsupported system");
+    }
+    if (mce->cg2mol == NULL)
+    {
+        mc_init_volume(mce,fr,top,mols);
+    }
+    tr   = &mce->trial[0];
+    dev0 = mce->vol_dev[0];
+    dev1 = mce->vol_dev[1];
+    cm   = mce->vol_cm;
+
+    /* The volume moves scale isotropically */
+    s = box[XX][XX]/box_prev[XX][XX];
+    set_pbc(&pbc_prev,fr->ePBC,box_prev);
+    set_pbc(&pbc,fr->ePBC,box);
+    rl2 = sqr(fr->rlist);
+    rc2 = sqr(max(fr->rlist,fr->rlistlong));
+    rc  = sqrt(rc2);
+
+    /* The molecules are displaced rigidly, so all cg centers are the
+     * reference centers of the pair list scaled, up to small deviations.
+     * The list is valid while it contains all pairs within the cut-off
+     * before and after the move.
+     */
+    mc_calc_cg_offsets(cgs,&pbc,x,0,mce->ncg,cm,mce->vol_off);
+    dmax0 = dmax1 = 0;
+    s0    = s1    = 1;
+    if (mce->vol_npair >= 0)
+    {
+        s0    = box_prev[XX][XX]/mce->vol_boxref;
+        s1    = box[XX][XX]/mce->vol_boxref;
+        dmax0 = mc_volume_dev(mce,&pbc_prev,mce->cg_cm,s0,dev0);
+        dmax1 = mc_volume_dev(mce,&pbc,cm,s1,dev1);
+    }
+    if (mce->vol_npair < 0 ||
+        rc + 2*dmax0 > s0*mce->vol_rlist || rc + 2*dmax1 > s1*mce->vol_rlist)
+    {
+        s0 = 1;
+        s1 = s;
+        for(icg=0; icg<mce->ncg; icg++)
+        {
+            clear_rvec(dev0[icg]);
+            copy_rvec(mce->cg_cm[icg],mce->vol_cmref[icg]);
+        }
+        dmax1 = mc_volume_dev(mce,&pbc,cm,s1,dev1);
+        mc_volume_pairlist(mce,fr,md,cgs,box_prev,
+                           (1 + MC_VOL_BUFFER)*max(rc,(rc + 2*dmax1)/s));
+    }
+
+    for(i=0; i<F_NRE; i++)
+    {
+        ener_prev[i] = 0;
+        ener[i]      = 0;
+    }
+    for(i=0; i<5; i++)
+    {
+        comp[i] = 0;
+    }
+
+    for(m=0; m<DIM; m++)
+    {
+        hbox[0][m] = 0.5*box_prev[m][m];
+        hbox[1][m] = 0.5*box[m][m];
+    }
+    ngener  = (md->nenergrp > 1 ? md->nenergrp : 0);
+    nbl_ind = fr->gid2nblists ? fr->gid2nblists[0] : 0;
+    for(i=0; i<2; i++)
+    {
+        vcoul[i][0] = vcoul[i][1] = 0;
+        vvdw[i][0]  = vvdw[i][1]  = 0;
+    }
+    for(p=0; p<=mce->vol_npair; p++)
+    {
+        if (p == mce->vol_npair || (p > 0 && (p & 255) == 0))
+        {
+            /* Flush the partial sums to double precision */
+            ener_prev[F_COUL_SR] += vcoul[0][0];
+            ener_prev[F_COUL_LR] += vcoul[0][1];
+            ener[F_COUL_SR]      += vcoul[1][0];
+            ener[F_COUL_LR]      += vcoul[1][1];
+            ener_prev[fr->bBHAM ? F_BHAM    : F_LJ]    += vvdw[0][0];
+            ener_prev[fr->bBHAM ? F_BHAM_LR : F_LJ_LR] += vvdw[0][1];
+            ener[fr->bBHAM ? F_BHAM    : F_LJ]         += vvdw[1][0];
+            ener[fr->bBHAM ? F_BHAM_LR : F_LJ_LR]      += vvdw[1][1];
+            for(i=0; i<2; i++)
+            {
+                vcoul[i][0] = vcoul[i][1] = 0;
+                vvdw[i][0]  = vvdw[i][1]  = 0;
+            }
+            if (p == mce->vol_npair)
+            {
+                break;
+            }
+        }
+        icg = mce->vol_pair[2*p];
+        jcg = mce->vol_pair[2*p+1];
+        svmul(s0,mce->vol_dref[p],d);
+        rvec_inc(d,dev0[icg]);
+        rvec_dec(d,dev0[jcg]);
+        svmul(s1,mce->vol_dref[p],dn);
+        rvec_inc(dn,dev1[icg]);
+        rvec_dec(dn,dev1[jcg]);
+        /* The list cut-off can exceed half the box, so with the deviations
+         * a different image can become the closest.
+         */
+        for(m=0; m<DIM; m++)
+        {
+            if (d[m] > hbox[0][m])
+            {
+                d[m] -= box_prev[m][m];
+            }
+            else if (d[m] <= -hbox[0][m])
+            {
+                d[m] += box_prev[m][m];
+            }
+            if (dn[m] > hbox[1][m])
+            {
+                dn[m] -= box[m][m];
+            }
+            else if (dn[m] <= -hbox[1][m])
+            {
+                dn[m] += box[m][m];
+            }
+        }
+        r2  = norm2(d);
+        r2n = norm2(dn);
+        if (r2 >= rc2 && r2n >= rc2)
+        {
+            continue;
+        }
+        if (ngener > 0)
+        {
+            k = GID(md->cENER[cgs->index[icg]],md->cENER[cgs->index[jcg]],
+                    ngener);
+            nbl_ind = fr->gid2nblists ? fr->gid2nblists[k] : 0;
+        }
+        bSingle = (mce->cg_single[icg] && mce->cg_single[jcg]);
+        if (mce->bVolComp && bSingle && r2 < rc2 && s*s*r2 < rc2)
+        {
+            /* One evaluation gives the energy at both volumes */
+            mc_pair_comp(fr,md,cgs->index[icg],cgs->index[jcg],r2,comp);
+            continue;
+        }
+        if (!mce->bVolInterOnly && r2 < rc2)
+        {
+            mc_volume_cg_pair(mce,fr,md,cgs,icg,jcg,d,mce->x_off,
+                              nbl_ind,r2 >= rl2,vcoul[0],vvdw[0]);
+        }
+        if (r2n < rc2)
+        {
+            mc_volume_cg_pair(mce,fr,md,cgs,icg,jcg,dn,mce->vol_off,
+                              nbl_ind,r2n >= rl2,vcoul[1],vvdw[1]);
+        }
+    }
+
+    if (mce->bVolInterOnly)
+    {
+        /* All non-bonded pair energies are intermolecular */
+        ener_prev[F_COUL_SR] = enerd_prev->term[F_COUL_SR];
+        ener_prev[F_COUL_LR] = enerd_prev->term[F_COUL_LR];
+        ener_prev[F_LJ]      = enerd_prev->term[F_LJ];
+        ener_prev[F_LJ_LR]   = enerd_prev->term[F_LJ_LR];
+        ener_prev[F_BHAM]    = enerd_prev->term[F_BHAM];
+        ener_prev[F_BHAM_LR] = enerd_prev->term[F_BHAM_LR];
+    }
+    /* The unscaled and scaled power components */
+    ener_prev[F_LJ]      += comp[0] - comp[1];
+    ener_prev[F_COUL_SR] += comp[2] + comp[3] + comp[4];
+    ener[F_LJ]           += comp[0]/pow(s,12) - comp[1]/pow(s,6);
+    ener[F_COUL_SR]      += comp[2]/s + comp[3]*s*s + comp[4];
+
+    depot = 0;
+    for(i=0; i<F_EPOT; i++)
+    {
+        tr->dener[i] = ener[i] - ener_prev[i];
+        if (i != F_DISRESVIOL && i != F_ORIRESDEV && i != F_DIHRESVIOL)
+        {
+            depot += tr->dener[i];
+        }
+    }
+    set_enerd_mc(enerd,enerd_prev,mc_move,0);
+
+    return depot;
+}
+
+static void mc_commit_trial(t_gmx_mc_ener *mce,t_mc_trial *tr,
+                            gmx_localtop_t *top,bool bGrid)
+{
+    int  cg,a,a0;
+
+    a0 = top->cgs.index[tr->cg0];
+    for(cg=tr->cg0; cg<tr->cg1; cg++)
+    {
+        copy_rvec(tr->set_cm[cg-tr->cg0],mce->cg_cm[cg]);
+        if (bGrid)
+        {
+            grid_mc_move(mce->grid,cg,mce->cg_cm[cg]);
+        }
+    }
+    for(a=a0; a<top->cgs.index[tr->cg1]; a++)
+    {
+        copy_rvec(tr->set_off[a-a0],mce->x_off[a]);
+    }
+}
+
+void commit_enerd_mc(gmx_mc_move *mc_move,gmx_localtop_t *top)
+{
+    t_gmx_mc_ener *mce = mc_move->ener;
+
+    mc_commit_trial(mce,&mce->trial[mce->itrial],top,mce->bGrid);
+    if (mce->bEwald)
+    {
+        ewald_sfac_commit(mce->sfac,mce->itrial);
+    }
+}
+
+void reject_enerd_mc(gmx_mc_move *mc_move)
+{
+    t_gmx_mc_ener *mce = mc_move->ener;
+
+    if (!enerd_mc_incremental(mc_move) || !mce->bEwald)
+    {
+        return;
+    }
+    if (mce->sfac_pending == esfacRESET)
+    {
+        ewald_sfac_undo(mce->sfac);
+    }
+    mce->sfac_pending = esfacNONE;
+}
+
+/* Returns the reciprocal energy of a full evaluation of an MC
+ * configuration with the same Ewald sum as used for the trial moves,
+ * PME and Ewald differ by more than the typical energy change of a move.
+ * Only the atoms in the journal are updated when possible.
+ */
+static real mc_recip_energy(gmx_mc_move *mc_move,t_forcerec *fr,
+                            t_mdatoms *md,rvec box_size,rvec x[])
+{
+    t_gmx_mc_ener  *mce = mc_move->ener;
+    gmx_mc_journal *jr  = &mc_move->journal;
+    int a0,a1;
+
+    a0 = jr->start;
+    a1 = max(jr->start,jr->end);
+    if (mce->bSfac && !jr->bBox && 2*(a1 - a0) < md->nr)
+    {
+        mce->sfac_pending = esfacTRIAL;
+
+        return ewald_sfac_energy(mce->sfac) +
+            ewald_sfac_delta(mce->sfac,0,a1-a0,mc_move->xprev+a0,x+a0,
+                             md->chargeA+a0);
+    }
+    mce->sfac_pending = esfacRESET;
+
+    return ewald_sfac_reset(mce->sfac,fr->epsilon_r,box_size,
+                            md->nr,x,md->chargeA);
+}
+
+void set_trial_halo_mc(gmx_mc_move *mc_move,int trial,int nhalo,int *halo)
+{
+    t_gmx_mc_ener *mce = mc_move->ener;
+    t_mc_trial *tr = &mce->trial[trial];
+
+    if (halo != NULL && mce->bEwald)
+    {
+        gmx_incons("MC halos can not be used with Ewald summation");
+    }
+
+    tr->bHalo = (halo != NULL);
+    tr->nhalo = nhalo;
+    tr->halo  = halo;
+}
+
+rvec *get_cg_cm_mc(gmx_mc_move *mc_move,int *ncg)
+{
+    *ncg = mc_move->ener->ncg;
+
+    return mc_move->ener->cg_cm;
+}
+
+void commit_trial_mc(gmx_mc_move *mc_move,int trial,gmx_localtop_t *top,
+                     double dener[])
+{
+    t_gmx_mc_ener *mce = mc_move->ener;
+    t_mc_trial *tr = &mce->trial[trial];
+    int i;
+
+    if (mce->bEwald)
+    {
+        gmx_incons("commit_trial_mc can not be used with Ewald summation");
+    }
+    mc_commit_trial(mce,tr,top,FALSE);
+    for(i=0; i<F_EPOT; i++)
+    {
+        dener[i] += tr->dener[i];
+    }
 }
-real delta_enerd_mc(gmx_enerdata_t *enerd,gmx_enerdata_t *enerd_prev,gmx_localtop_t *top,gmx_mc_move *mc_move,t_idef *idef,t_forcerec *fr,int homenr)
+
+void add_enerd_mc(gmx_enerdata_t *enerd,double dener[])
 {
-  int nbonds,ftype,i,j,nra,k,l,ii,jj,s;
-  int ai,aj,ak,al,index,index2,inr,jnr;
-  real vtot = 0,sum=0,delta=0;
-  t_iatom *forceatoms;
-  t_nblists *nblists;
-  t_nblist *nlist;
-  t_block *cgs = &top->cgs;
-  bool *done,iswater;
+    int i;
 
-  if(mc_move->n_mc)
-  {
-   //if(mc_move->mvgroup >= MC_BONDS) 
-   //{
-    for(ftype=0; (ftype<F_NRE); ftype++) 
+    enerd->term[F_EPOT] = 0;
+    for(i=0; i<F_EPOT; i++)
     {
-     if(ftype<F_GB12 || ftype>F_GB14) 
-     {
-      if (interaction_function[ftype].flags & IF_BOND &&
-	!(ftype == F_CONNBONDS || ftype == F_POSRES)) 
-      {
-        nbonds=idef->il[ftype].nr;
-        nra = NRAL(ftype);
-        forceatoms = idef->il[ftype].iatoms;
-        if (nbonds > 0)
-        {
-         if (ftype < F_LJ14 || ftype > F_LJC_PAIRS_NB) 
-         {
-          enerd->term[ftype] = enerd_prev->term[ftype]; 
-          if(mc_move->mvgroup >= MC_BONDS) 
-          {
-           for(i=0,k=0; (i<nbonds); k++) 
-           {
-            i++;
-            switch(nra)
-            {
-             case 2:
-             ai   = forceatoms[i++];
-             aj   = forceatoms[i++];
-             if(WITHIN_MOVE(ai) || WITHIN_MOVE(aj))
-             {
-              enerd->term[ftype] -= mc_move->enerd_prev[ftype][k];
-              enerd->term[ftype] += mc_move->enerd[ftype][k];
-             } 
-             break;
-             case 3:
-             ai   = forceatoms[i++];
-             aj   = forceatoms[i++];
-             ak   = forceatoms[i++];
-            
-             if(WITHIN_MOVE(ai) || WITHIN_MOVE(aj) || WITHIN_MOVE(ak))
-             {
-              enerd->term[ftype] -= mc_move->enerd_prev[ftype][k];
-              enerd->term[ftype] += mc_move->enerd[ftype][k];
-             } 
-             break;
-             case 4:
-             ai   = forceatoms[i++];
-             aj   = forceatoms[i++];
-             ak   = forceatoms[i++];
-             al   = forceatoms[i++];
-             
-             if(WITHIN_MOVE(ai) || WITHIN_MOVE(aj) || WITHIN_MOVE(ak) || WITHIN_MOVE(al))
-             {
-              enerd->term[ftype] -= mc_move->enerd_prev[ftype][k];
-              enerd->term[ftype] += mc_move->enerd[ftype][k];
-             } 
-             break;
-            } 
-           }
-          }
-         }
+        enerd->term[i] += dener[i];
+        if (i != F_DISRESVIOL && i != F_ORIRESDEV && i != F_DIHRESVIOL)
+        {
+            enerd->term[F_EPOT] += enerd->term[i];
         }
-      }
-     }
     }
-   //}
-  enerd->term[F_COUL_SR] = enerd_prev->term[F_COUL_SR];
-  enerd->term[F_LJ] = enerd_prev->term[F_LJ];
-  if(!enerd->term[F_LJ14])
-  {
-   enerd->term[F_LJ14] = enerd_prev->term[F_LJ14];
-  }
-  if(!enerd->term[F_COUL14])
-  {
-   enerd->term[F_COUL14] = enerd_prev->term[F_COUL14];
-  }
+}
 
- snew(done,homenr);
-   for(ii=0;ii<cgs->nr;ii++)
-   {
-    if(done[ii] || cgs->index[ii] < mc_move->start || cgs->index[ii] >= mc_move->end )
+void reset_grid_mc(gmx_mc_move *mc_move,matrix box)
+{
+    t_gmx_mc_ener *mce = mc_move->ener;
+
+    if (mce->bGrid)
     {
-     continue;
+        grid_mc_fill(mce->grid,box,mce->ncg,mce->cg_cm);
     }
-     for(jj=0;jj<cgs->nr;jj++)
-     {
-      if(done[jj] || jj == ii)
-      {
-       continue;
-      }
-      index = (ii < jj) ? ii*homenr-mc_move->sum_index[ii]+jj : jj*homenr - mc_move->sum_index[jj] + ii;
-
-      
-       enerd->term[F_COUL_SR] -= mc_move->enerd_prev[F_COUL_SR][index];
-       enerd->term[F_LJ] -= mc_move->enerd_prev[F_LJ][index];
-       enerd->term[F_COUL_SR] += mc_move->enerd[F_COUL_SR][index];
-       enerd->term[F_LJ] += mc_move->enerd[F_LJ][index];
-
-     }
-     done[ii]=TRUE;
-    }
- sfree(done);
- }
-//printf("sum2 %f\n",sum);
- for(ftype=0; (ftype<F_EPOT); ftype++) {
-  vtot += enerd->term[ftype];
-  if(ftype != F_COUL_RECIP)
-  {
-   delta += (enerd->term[ftype]-enerd_prev->term[ftype]);
-  }
- }
- enerd->term[F_EPOT] = vtot;
-
- return delta;
 }
+
 void init_forcerec(FILE *fp,
                    t_forcerec *fr,
                    t_fcdata   *fcd,
@@ -1812,13 +3430,6 @@ void init_forcerec(FILE *fp,
             snew(fr->gid2nblists,ir->opts.ngener*ir->opts.ngener);
     }
     snew(fr->nblists,fr->nnblists);
-    if(EI_MC(ir->eI))
-    {
-     snew(fr->nblists_mc,cgs->nr);
-     for(i=0;i<cgs->nr;i++) {
-      snew(fr->nblists_mc[i],fr->nnblists);
-     }
-    }
     
     /* This code automatically gives table length tabext without cut-off's,
      * in that case grompp should already have checked that we do not need
@@ -1832,12 +3443,6 @@ void init_forcerec(FILE *fp,
             make_nbf_tables(fp,fr,rtab,cr,tabfn,NULL,NULL,&fr->nblists[0]);
             if (!bSep14tab)
                 fr->tab14 = fr->nblists[0].tab;
-            if(EI_MC(ir->eI))
-            {
-             for(i=0;i<cgs->nr;i++) {
-              make_nbf_tables(fp,fr,rtab,cr,tabfn,NULL,NULL,&fr->nblists_mc[i][0]);
-             }
-            }
             m = 1;
         } else {
             m = 0;
@@ -1858,15 +3463,6 @@ void init_forcerec(FILE *fp,
                                         *mtop->groups.grpname[nm_ind[egi]],
                                         *mtop->groups.grpname[nm_ind[egj]],
                                         &fr->nblists[m]);
-                         if(EI_MC(ir->eI))
-                         {
-                          for(i=0;i<cgs->nr;i++) {
-                           make_nbf_tables(fp,fr,rtab,cr,tabfn,
-                                        *mtop->groups.grpname[nm_ind[egi]],
-                                        *mtop->groups.grpname[nm_ind[egj]],
-                                        &fr->nblists_mc[i][m]);
-                          }
-                         }
                         m++;
                     } else if (fr->nnblists > 1) {
                         fr->gid2nblists[GID(egi,egj,ir->opts.ngener)] = 0;
@@ -1939,9 +3535,26 @@ void init_forcerec(FILE *fp,
     /* Initialize neighbor search */
     init_ns(fp,cr,&fr->ns,fr,mtop,box);
     
+    fr->cutoff_scheme = ir->cutoff_scheme;
+    fr->nbv           = NULL;
+    if (fr->cutoff_scheme == ecutsVERLET && (cr->duty & DUTY_PP))
+    {
+        fr->nbv = init_nbnxn(fp,cr,ir,fr,mtop,box);
+    }
     
     if (cr->duty & DUTY_PP)
+    {
         gmx_setup_kernels(fp);
+        if (fr->cutoff_scheme == ecutsGROUP)
+        {
+            fr->nbthreads =
+                gmx_nonbonded_init_threads(fp,mtop->groups.grps[egcENER].nr);
+            if (bTab && bNormalnblists && fr->bcoultab)
+            {
+                gmx_nonbonded_setup_ewald(fp,fr,&fr->nblists[0]);
+            }
+        }
+    }
 }
 
 #define pr_real(fp,r) fprintf(fp,"%s: %e\n",#r,r)
@@ -2003,7 +3616,6 @@ void ns(FILE *fp,
       nDNL=0;
     /* Allocate memory for the neighbor lists */
     init_neighbor_list(fp,fr,md->homenr);
-    init_neighbor_list_mc(fp,fr,md->homenr,top->cgs.nr+1);
       
     bFirst=FALSE;
   }
@@ -2068,203 +3680,6 @@ void sub_enerdata(gmx_enerdata_t *enerd1,gmx_enerdata_t *enerd2,gmx_enerdata_t *
     }
 }
 
-void do_recip_mc(FILE       *fplog,   gmx_step_t step,
-                       t_forcerec *fr,      t_inputrec *ir,
-                       t_idef     *idef,    t_commrec  *cr,
-                       t_nrnb     *nrnb,    gmx_wallcycle_t wcycle,
-                       t_mdatoms  *md,
-                       t_grpopts  *opts,
-                       rvec       x[],      history_t  *hist,
-                       rvec       f[],
-                       gmx_enerdata_t *enerd,
-                       t_fcdata   *fcd,
-                       gmx_genborn_t *born,
-                       t_atomtypes *atype,
-                       bool       bBornRadii,
-                       matrix     box,
-                       real       lambda,  
-                       t_graph    *graph,
-                       t_blocka   *excl,    
-                       rvec       mu_tot[],
-                       int        flags,
-                       float      *cycles_pme,
-                       gmx_mc_move *mc_move)
-{
-    int     i,status;
-    int     donb_flags;
-    bool    bDoEpot,bSepDVDL,bSB;
-    int     pme_flags;
-    matrix  boxs;
-    rvec    box_size;
-    real    dvdlambda,Vsr,Vlr,Vlr2,Vcorr=0,vdip,vcharge;
-    t_pbc   pbc;
-    real    dvdgb;
-    char    buf[22];
-    gmx_enerdata_t ed_lam;
-    double  lam_i;
-    real    dvdl_dum;
-    bool    n_mc;
-    int     ii;
-    rvec    x_mc[100];
-    real    charge_mc[100];
-
-#define PRINT_SEPDVDL(s,v,dvdl) if (bSepDVDL) fprintf(fplog,sepdvdlformat,s,v,dvdl);
-
-    if (EEL_FULL(fr->eeltype))
-    {
-        clear_mat(fr->vir_el_recip);	
-        
-        if (fr->bEwald)
-        {
-            if (fr->n_tpi == 0)// && !n_mc)
-            {
-                dvdlambda = 0;
-                Vcorr = ewald_LRcorrection(fplog,md->start,md->start+md->homenr,
-                                           cr,fr,
-                                           md->chargeA,
-                                           md->nChargePerturbed ? md->chargeB : NULL,
-                                           excl,x,bSB ? boxs : box,mu_tot,
-                                           ir->ewald_geometry,
-                                           ir->epsilon_surface,
-                                           lambda,&dvdlambda,&vdip,&vcharge,(flags & GMX_FORCE_FORCES) ? TRUE : FALSE,mc_move);
-                PRINT_SEPDVDL("Ewald excl./charge/dip. corr.",Vcorr,dvdlambda);
-                enerd->dvdl_lin += dvdlambda;
-            }
-            else
-            {
-                if (ir->ewald_geometry != eewg3D || ir->epsilon_surface != 0)
-                {
-                    gmx_fatal(FARGS,"TPI with PME currently only works in a 3D geometry with tin-foil boundary conditions");
-                }
-                /* The TPI molecule does not have exclusions with the rest
-                 * of the system and no intra-molecular PME grid contributions
-                 * will be calculated in gmx_pme_calc_energy.
-                 */
-                Vcorr = 0;
-            }
-        }
-        else
-        {
-            Vcorr = shift_LRcorrection(fplog,md->start,md->homenr,cr,fr,
-                                       md->chargeA,excl,x,TRUE,box,
-                                       fr->vir_el_recip);
-        }
-        
-        dvdlambda = 0;
-        status = 0;
-        switch (fr->eeltype)
-        {
-        case eelPPPM:
-            status = gmx_pppm_do(fplog,fr->pmedata,FALSE,x,fr->f_novirsum,
-                                 md->chargeA,
-                                 box_size,fr->phi,cr,md->start,md->homenr,
-                                 nrnb,ir->pme_order,&Vlr);
-            break;
-        case eelPME:
-        case eelPMESWITCH:
-        case eelPMEUSER:
-            if (cr->duty & DUTY_PME)
-            {
-                if (fr->n_tpi == 0 || (flags & GMX_FORCE_STATECHANGED))
-                {
-                 if(!n_mc || 1==1)
-                 {
-                    pme_flags = GMX_PME_SPREAD_Q | GMX_PME_SOLVE;
-                    if (flags & GMX_FORCE_FORCES)
-                    {
-                        pme_flags |= GMX_PME_CALC_F;
-                    }
-                    wallcycle_start(wcycle,ewcPMEMESH);
-                    status = gmx_pme_do(fr->pmedata,
-                                        md->start,md->homenr - fr->n_tpi,
-                                        x,fr->f_novirsum,
-                                        md->chargeA,md->chargeB,
-                                        bSB ? boxs : box,cr,
-                                        DOMAINDECOMP(cr) ? dd_pme_maxshift0(cr->dd) : 0,
-                                        DOMAINDECOMP(cr) ? dd_pme_maxshift1(cr->dd) : 0,
-                                        nrnb,
-                                        fr->vir_el_recip,fr->ewaldcoeff,
-                                        &Vlr,lambda,&dvdlambda,
-                                        pme_flags);
-                    //printf("Vlr %f %f\n",Vlr,Vcorr);
-                    //*cycles_pme = wallcycle_stop(wcycle,ewcPMEMESH);
-                    /* We should try to do as little computation after
-                     * this as possible, because parallel PME synchronizes
-                     * the nodes, so we want all load imbalance of the rest
-                     * of the force calculation to be before the PME call.
-                     * DD load balancing is done on the whole time of
-                     * the force call (without PME).
-                     */
-                 }
-                }
-                if (fr->n_tpi > 0)
-                {
-                    /* Determine the PME grid energy of the test molecule
-                     * with the PME grid potential of the other charges.
-                     */
-                    gmx_pme_calc_energy(fr->pmedata,fr->n_tpi,
-                                        x + md->homenr - fr->n_tpi,
-                                        md->chargeA + md->homenr - fr->n_tpi,
-                                        &Vlr);
-                }
-                if (n_mc && 1 == 2)
-                {
-                    /* Determine the PME grid energy of the test molecule
-                     * with the PME grid potential of the other charges.
-                     */
-                    gmx_pme_calc_energy(fr->pmedata,3,
-                                        mc_move->xprev + mc_move->start,
-                                        md->chargeA +  mc_move->start,
-                                        &Vlr2);
-                    gmx_pme_calc_energy(fr->pmedata,3,
-                                        x + mc_move->start,
-                                        md->chargeA + mc_move->start,
-                                        &Vlr);
-                    printf("Vlr %f %f %f\n",Vlr,Vlr2,mc_move->enerd_prev[F_COUL_RECIP][0]);
-                   Vlr -= Vlr2;
-                   Vlr = Vlr/2;
-                   Vlr += mc_move->enerd_prev[F_COUL_RECIP][0];
-                }
-                PRINT_SEPDVDL("PME mesh",Vlr,dvdlambda);
-            } 
-            else
-            {
-                /* Energies and virial are obtained later from the PME nodes */
-                /* but values have to be zeroed out here */
-                Vlr=0.0;
-            }
-            break;
-        case eelEWALD:
-            Vlr = do_ewald(fplog,FALSE,ir,n_mc ? x_mc : x,fr->f_novirsum,
-                           n_mc ? charge_mc : md->chargeA,md->chargeB,
-                           box_size,cr,n_mc ? mc_move->nr : md->homenr,
-                           fr->vir_el_recip,fr->ewaldcoeff,
-                           lambda,&dvdlambda);
-            PRINT_SEPDVDL("Ewald long-range",Vlr,dvdlambda);
-            break;
-        default:
-            Vlr = 0;
-            gmx_fatal(FARGS,"No such electrostatics method implemented %s",
-                      eel_names[fr->eeltype]);
-        }
-        if (status != 0)
-        {
-            gmx_fatal(FARGS,"Error %d in long range electrostatics routine %s",
-                      status,EELTYPE(fr->eeltype));
-		}
-        enerd->dvdl_lin += dvdlambda;
-        enerd->term[F_COUL_RECIP] = Vlr + Vcorr;
-        mc_move->enerd[F_COUL_RECIP][0] = Vlr + Vcorr;
-        if (debug)
-        {
-            fprintf(debug,"Vlr = %g, Vcorr = %g, Vlr_corr = %g\n",
-                    Vlr,Vcorr,enerd->term[F_COUL_RECIP]);
-            pr_rvecs(debug,0,"vir_el_recip after corr",fr->vir_el_recip,DIM);
-            pr_rvecs(debug,0,"fshift after LR Corrections",fr->fshift,SHIFTS);
-        }
-    }
-}
-
 void do_force_lowlevel(FILE       *fplog,   gmx_step_t step,
                        t_forcerec *fr,      t_inputrec *ir,
                        t_idef     *idef,    t_commrec  *cr,
@@ -2307,6 +3722,7 @@ void do_force_lowlevel(FILE       *fplog,   gmx_step_t step,
     rvec    x_mc[100];
     real    charge_mc[100];
     int     eeltype;
+    int     *gatindex;
 #ifdef GMX_MPI
     double  t0=0.0,t1,t2,t3; /* time measurement for coarse load balancing */
 #endif
@@ -2382,17 +3798,26 @@ void do_force_lowlevel(FILE       *fplog,   gmx_step_t step,
     {
         donb_flags |= GMX_DONB_FORCES;
     }
-    /*do_nonbonded(cr,fr,x,f,md,
-                 fr->bBHAM ?
-                 enerd->grpp.ener[egBHAMSR] :
-                 enerd->grpp.ener[egLJSR],
-                 enerd->grpp.ener[egCOULSR],
-				 enerd->grpp.ener[egGB],box_size,nrnb,
-                 lambda,&dvdlambda,-1,-1,donb_flags,mc_move);*/
+    if (fr->cutoff_scheme == ecutsVERLET)
+    {
+        nbnxn_do_nonbonded(fr->nbv,x,f,fr->fshift,fr->shift_vec,
+                           enerd->grpp.ener[egCOULSR],
+                           enerd->grpp.ener[egLJSR],nrnb);
+    }
+    else
+    {
+        do_nonbonded(cr,fr,x,f,md,
+                     fr->bBHAM ?
+                     enerd->grpp.ener[egBHAMSR] :
+                     enerd->grpp.ener[egLJSR],
+                     enerd->grpp.ener[egCOULSR],
+                     enerd->grpp.ener[egGB],box_size,nrnb,
+                     lambda,&dvdlambda,-1,-1,donb_flags,mc_move);
+    }
     /* If we do foreign lambda and we have soft-core interactions
      * we have to recalculate the (non-linear) energies contributions.
      */
-    if (ir->n_flambda > 0 && (flags & GMX_FORCE_DHDL) && ir->sc_alpha != 0)
+    if (fr->cutoff_scheme == ecutsGROUP && ir->n_flambda > 0 && (flags & GMX_FORCE_DHDL) && ir->sc_alpha != 0)
     {
         init_enerdata(mtop->groups.grps[egcENER].nr,ir->n_flambda,&ed_lam);
 
@@ -2496,12 +3921,25 @@ void do_force_lowlevel(FILE       *fplog,   gmx_step_t step,
     {
         GMX_MPE_LOG(ev_calc_bonds_start);
 
+        if (DOMAINDECOMP(cr))
+        {
+            gatindex = cr->dd->gatindex;
+        }
+        else if (fr->atomsort)
+        {
+            gatindex = atomsort_gatindex(fr->atomsort);
+        }
+        else
+        {
+            gatindex = NULL;
+        }
+
         if(!mc_move || !mc_move->n_mc || mc_move->mvgroup >= MC_BONDS)
         {
-         /*calc_bonds(fplog,cr->ms,
+         calc_bonds(fplog,cr->ms,
                    idef,x,hist,mc_move,f,fr,&pbc,graph,enerd,nrnb,lambda,md,fcd,
-                   DOMAINDECOMP(cr) ? cr->dd->gatindex : NULL, atype, born, &(mtop->cmap_grid),
-                   fr->bSepDVDL && do_per_step(step,ir->nstlog),step);*/
+                   gatindex, atype, born, &(mtop->cmap_grid),
+                   fr->bSepDVDL && do_per_step(step,ir->nstlog),step);
         }
         
         /* Check if we have to determine energy differences
@@ -2524,7 +3962,7 @@ void do_force_lowlevel(FILE       *fplog,   gmx_step_t step,
                 calc_bonds_lambda(fplog,
                                   idef,x,fr,&pbc,graph,&ed_lam,nrnb,lam_i,md,
                                   fcd,
-                                  DOMAINDECOMP(cr) ? cr->dd->gatindex : NULL);
+                                  gatindex);
                 sum_epot(&ir->opts,&ed_lam);
                 enerd->enerpart_lambda[i] += ed_lam.term[F_EPOT];
             }
@@ -2535,8 +3973,6 @@ void do_force_lowlevel(FILE       *fplog,   gmx_step_t step,
     }
     where();
     *cycles_pme = 0;
-    if(!mc_move)
-    {
     if (EEL_FULL(fr->eeltype))
     {
         bSB = (ir->nwall == 2);
@@ -2701,6 +4137,11 @@ void do_force_lowlevel(FILE       *fplog,   gmx_step_t step,
                       status,EELTYPE(fr->eeltype));
 		}
         enerd->dvdl_lin += dvdlambda;
+        if (mc_move != NULL && !n_mc && enerd_mc_incremental(mc_move) &&
+            mc_move->ener->bEwald)
+        {
+            Vlr = mc_recip_energy(mc_move,fr,md,box_size,x);
+        }
         enerd->term[F_COUL_RECIP] = Vlr + Vcorr;
         if (debug)
         {
@@ -2732,7 +4173,6 @@ void do_force_lowlevel(FILE       *fplog,   gmx_step_t step,
                           enerd->term[F_RF_EXCL],dvdlambda);
         }
     }
-   }
     where();
     debug_gmx();
 	
@@ -36,6 +36,16 @@
  * files like gmx_fft_fftw3.c or gmx_fft_intel_mkl.c for that.
  */
 
+#ifndef GMX_FFT_FFTW3
+int
+gmx_fft_init_threads(int                  nthreads)
+{
+    /* Only FFTW3 can use threads within a transform */
+    return 1;
+}
+#endif
+
+
 int
 gmx_fft_transpose_2d(t_complex *          in_data,
                      t_complex *          out_data,
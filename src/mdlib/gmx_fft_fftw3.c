@@ -858,6 +858,34 @@ gmx_fft_destroy(gmx_fft_t      fft)
 
 }
 
+
+int
+gmx_fft_init_threads(int      nthreads)
+{
+#ifdef GMX_FFT_FFTW3_THREADS
+    static int bThreadsInitialized = 0;
+    
+    if(!bThreadsInitialized)
+    {
+        if(FFTWPREFIX(init_threads)() == 0)
+        {
+            return 1;
+        }
+        bThreadsInitialized = 1;
+    }
+    if(nthreads < 1)
+    {
+        nthreads = 1;
+    }
+    /* Only affects plans created after this call */
+    FFTWPREFIX(plan_with_nthreads)(nthreads);
+    
+    return nthreads;
+#else
+    return 1;
+#endif
+}
+
 #else
 int
 gmx_fft_fftw2_empty;
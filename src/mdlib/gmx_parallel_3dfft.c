@@ -38,6 +38,14 @@
 #include "gmxcomplex.h"
 #include "gmx_fatal.h"
 
+/* The FFT setups of one thread for the local transforms */
+typedef struct {
+    gmx_fft_t       fft_yz;
+    gmx_fft_t       fft_x;
+    gmx_fft_t       fft_y;
+    gmx_fft_t       fft_z;
+} pfft_thread_t;
+
 typedef struct {
     int             *sdisps;
     int             *scounts;
@@ -64,8 +72,38 @@ struct gmx_parallel_3dfft
     int             *slab2grid_y;
     alltoallv_t     *aav;
     MPI_Comm        comm;
+    /* Pencil decomposition, only used when nnodes_y > 1 */
+    int             nnodes_y;
+    int             local_pencil;
+    int             *pencil2grid_y;
+    int             *pencil2grid_zc;
+    gmx_fft_t       fft_y;
+    gmx_fft_t       fft_z;
+    MPI_Comm        comm_y;
+    /* Threads for the local transforms, th[0] holds the setups above */
+    int               nthreads;
+    gmx_thread_pool_t pool;
+    pfft_thread_t     *th;
 };
 
+/* The kinds of local transforms that can be distributed over threads */
+enum { epfftX, epfftY, epfftZ, epfftYZ, epfftTRANSPOSE };
+
+typedef struct {
+    gmx_parallel_3dfft_t   p;
+    int                    kind;
+    enum gmx_fft_direction dir;
+    int                    n;          /* The number of transforms */
+    int                    ninner;     /* The length of the inner loop */
+    real *                 in;
+    int                    in_outer;   /* Strides in reals */
+    int                    in_inner;
+    real *                 out;
+    int                    out_outer;
+    int                    out_inner;
+    int                    tnx,tny;    /* Dimensions for epfftTRANSPOSE */
+} pfft_loop_t;
+
 static int *copy_int_array(int n,int *src)
 {
     int *dest,i;
@@ -90,6 +128,120 @@ static int *make_slab2grid(int nnodes,int ngrid)
     return s2g;
 }
 
+static void pfft_init_thread0(gmx_parallel_3dfft_t p)
+{
+    p->nthreads     = 1;
+    p->pool         = NULL;
+    p->th           = malloc(sizeof(pfft_thread_t));
+    p->th[0].fft_yz = p->fft_yz;
+    p->th[0].fft_x  = p->fft_x;
+    p->th[0].fft_y  = p->fft_y;
+    p->th[0].fft_z  = p->fft_z;
+}
+
+static void pfft_loop_task(void *data,int task,int thread)
+{
+    pfft_loop_t   *l;
+    pfft_thread_t *th;
+    int           i,i0,i1;
+    real          *in,*out;
+
+    l  = (pfft_loop_t *)data;
+    th = &l->p->th[thread];
+
+    /* There is one task per thread, each does a contiguous part */
+    i0 = ( task   *l->n)/l->p->nthreads;
+    i1 = ((task+1)*l->n)/l->p->nthreads;
+    for(i=i0; i<i1; i++)
+    {
+        in  = l->in  + (i/l->ninner)*l->in_outer  + (i%l->ninner)*l->in_inner;
+        out = l->out + (i/l->ninner)*l->out_outer + (i%l->ninner)*l->out_inner;
+        switch (l->kind)
+        {
+        case epfftX:
+            gmx_fft_1d(th->fft_x,l->dir,in,out);
+            break;
+        case epfftY:
+            gmx_fft_1d(th->fft_y,l->dir,in,out);
+            break;
+        case epfftZ:
+            gmx_fft_1d_real(th->fft_z,l->dir,in,out);
+            break;
+        case epfftYZ:
+            gmx_fft_2d_real(th->fft_yz,l->dir,in,out);
+            break;
+        case epfftTRANSPOSE:
+            gmx_fft_transpose_2d((t_complex *)in,(t_complex *)out,
+                                 l->tnx,l->tny);
+            break;
+        }
+    }
+}
+
+static void pfft_loop_run(pfft_loop_t *l)
+{
+    if (l->p->nthreads > 1)
+    {
+        gmx_thread_pool_run(l->p->pool,l->p->nthreads,pfft_loop_task,l);
+    }
+    else
+    {
+        pfft_loop_task(l,0,0);
+    }
+}
+
+/* Do n transforms of kind, the data of transform i starts at
+ * (i/ninner)*outer + (i%ninner)*inner reals from in and out.
+ */
+static void pfft_loop_ffts(gmx_parallel_3dfft_t p,int kind,
+                           enum gmx_fft_direction dir,int n,int ninner,
+                           void *in,int in_outer,int in_inner,
+                           void *out,int out_outer,int out_inner)
+{
+    pfft_loop_t l;
+
+    l.p         = p;
+    l.kind      = kind;
+    l.dir       = dir;
+    l.n         = n;
+    l.ninner    = ninner;
+    l.in        = (real *)in;
+    l.in_outer  = in_outer;
+    l.in_inner  = in_inner;
+    l.out       = (real *)out;
+    l.out_outer = out_outer;
+    l.out_inner = out_inner;
+    l.tnx       = 0;
+    l.tny       = 0;
+
+    pfft_loop_run(&l);
+}
+
+/* Do n out-of-place 2D transposes of nx*ny complex values,
+ * the matrices are stored consecutively.
+ */
+static void pfft_loop_transposes(gmx_parallel_3dfft_t p,int n,
+                                 t_complex *in,t_complex *out,int nx,int ny)
+{
+    pfft_loop_t l;
+
+    l.p         = p;
+    l.kind      = epfftTRANSPOSE;
+    l.dir       = GMX_FFT_FORWARD;
+    l.n         = n;
+    l.ninner    = 1;
+    l.in        = (real *)in;
+    l.in_outer  = 2*nx*ny;
+    l.in_inner  = 0;
+    l.out       = (real *)out;
+    l.out_outer = 2*nx*ny;
+    l.out_inner = 0;
+    l.tnx       = nx;
+    l.tny       = ny;
+
+    pfft_loop_run(&l);
+}
+
 int
 gmx_parallel_3dfft_init   (gmx_parallel_3dfft_t *    pfft_setup,
                            int                       ngridx,
@@ -141,6 +293,13 @@ gmx_parallel_3dfft_init   (gmx_parallel_3dfft_t *    pfft_setup,
         p->slab2grid_x = make_slab2grid(p->nnodes,p->nx);
     p->slab2grid_y     = make_slab2grid(p->nnodes,p->ny);
 
+    p->nnodes_y       = 1;
+    p->local_pencil   = 0;
+    p->pencil2grid_y  = NULL;
+    p->pencil2grid_zc = NULL;
+    p->fft_y          = NULL;
+    p->fft_z          = NULL;
+
     if (node2slab || p->nx % p->nnodes || p->ny % p->nnodes) {
         p->aav = malloc(sizeof(alltoallv_t));
         p->aav->sdisps  = malloc(p->nnodes*sizeof(int));
@@ -182,6 +341,8 @@ gmx_parallel_3dfft_init   (gmx_parallel_3dfft_t *    pfft_setup,
         return ENOMEM;
     }
 
+    pfft_init_thread0(p);
+
     *pfft_setup = p;
     
     return 0;
@@ -190,6 +351,162 @@ gmx_parallel_3dfft_init   (gmx_parallel_3dfft_t *    pfft_setup,
 
 
 
+int
+gmx_parallel_3dfft_init_pencil(gmx_parallel_3dfft_t *    pfft_setup,
+                               int                       ngridx,
+                               int                       ngridy,
+                               int                       ngridz,
+                               int                       *slab2grid_x,
+                               int                       *slab2grid_y,
+                               MPI_Comm                  comm_x,
+                               MPI_Comm                  comm_y,
+                               bool                      bReproducible)
+{
+    gmx_parallel_3dfft_t p;
+    int  mx,my,mky,mzc,nmax,nwork;
+    void *p0;
+    int  flags;
+    
+    flags = bReproducible ? GMX_FFT_FLAG_CONSERVATIVE : 0;
+    
+    p = malloc(sizeof(struct gmx_parallel_3dfft));
+    
+    if(p==NULL)
+        return ENOMEM;
+    
+    p->nx  = ngridx;
+    p->ny  = ngridy;
+    p->nz  = ngridz;
+    p->nzc = ngridz/2 + 1;
+
+    MPI_Comm_dup( comm_x , &(p->comm) );
+    MPI_Comm_size( p->comm , &p->nnodes );
+    MPI_Comm_rank( p->comm , &p->local_slab );
+
+    MPI_Comm_dup( comm_y , &(p->comm_y) );
+    MPI_Comm_size( p->comm_y , &p->nnodes_y );
+    MPI_Comm_rank( p->comm_y , &p->local_pencil );
+
+    p->node2slab = NULL;
+
+    /* Direct space x and reciprocal space y are distributed over comm_x,
+     * direct space y and reciprocal space z over comm_y.
+     */
+    if (slab2grid_x)
+        p->slab2grid_x = copy_int_array(p->nnodes+1,slab2grid_x);
+    else
+        p->slab2grid_x = make_slab2grid(p->nnodes,p->nx);
+    p->slab2grid_y     = make_slab2grid(p->nnodes,p->ny);
+    if (slab2grid_y)
+        p->pencil2grid_y = copy_int_array(p->nnodes_y+1,slab2grid_y);
+    else
+        p->pencil2grid_y = make_slab2grid(p->nnodes_y,p->ny);
+    p->pencil2grid_zc    = make_slab2grid(p->nnodes_y,p->nzc);
+
+    /* The pencil transposes always use all-to-all-v */
+    nmax = (p->nnodes > p->nnodes_y ? p->nnodes : p->nnodes_y);
+    p->aav = malloc(sizeof(alltoallv_t));
+    p->aav->sdisps  = malloc(nmax*sizeof(int));
+    p->aav->scounts = malloc(nmax*sizeof(int));
+    p->aav->rdisps  = malloc(nmax*sizeof(int));
+    p->aav->rcounts = malloc(nmax*sizeof(int));
+
+    /* initialize transforms */
+    p->fft_yz = NULL;
+    if ( ( gmx_fft_init_1d(&(p->fft_x),ngridx,flags) != 0 ) ||
+         ( gmx_fft_init_1d(&(p->fft_y),ngridy,flags) != 0 ) ||
+         ( gmx_fft_init_1d_real(&(p->fft_z),ngridz,flags) != 0))
+    {
+        free(p);
+        return -1;
+    }
+
+    /* The work arrays should hold the largest of the local z-, y- and
+     * x-pencils, round up.
+     */
+    mx    = (p->nx  + p->nnodes   - 1)/p->nnodes;
+    my    = (p->ny  + p->nnodes_y - 1)/p->nnodes_y;
+    mky   = (p->ny  + p->nnodes   - 1)/p->nnodes;
+    mzc   = (p->nzc + p->nnodes_y - 1)/p->nnodes_y;
+    nwork = mx*my*p->nzc;
+    if (mx*p->ny*mzc > nwork)
+        nwork = mx*p->ny*mzc;
+    if (p->nx*mky*mzc > nwork)
+        nwork = p->nx*mky*mzc;
+
+    p0               = malloc(sizeof(t_complex)*nwork + 32);
+    p->work_rawptr   = p0;
+    p->work          = (void *) (((size_t) p0 + 32) & (~((size_t) 31)));
+
+    p0               = malloc(sizeof(t_complex)*nwork + 32);
+    p->work2_rawptr  = p0;
+    p->work2         = (void *) (((size_t) p0 + 32) & (~((size_t) 31)));
+    
+    if(p->work_rawptr == NULL || p->work2_rawptr == NULL)
+    {
+        if(p->work_rawptr != NULL)
+            free(p->work_rawptr);
+        if(p->work2_rawptr != NULL)
+            free(p->work2_rawptr);
+        free(p);
+        return ENOMEM;
+    }
+
+    pfft_init_thread0(p);
+
+    *pfft_setup = p;
+    
+    return 0;
+}
+
+
+int
+gmx_parallel_3dfft_init_threads(gmx_parallel_3dfft_t    p,
+                                gmx_thread_pool_t       pool,
+                                bool                    bReproducible)
+{
+    pfft_thread_t *th;
+    int  nthreads,t;
+    int  flags;
+    
+    flags = bReproducible ? GMX_FFT_FLAG_CONSERVATIVE : 0;
+
+    nthreads = gmx_thread_pool_nthreads(pool);
+    if (nthreads <= p->nthreads)
+        return 0;
+
+    th = realloc(p->th,nthreads*sizeof(pfft_thread_t));
+    if (th == NULL)
+        return ENOMEM;
+    p->th = th;
+
+    /* Setups can not be shared between threads with all FFT libraries */
+    for(t=p->nthreads; t<nthreads; t++)
+    {
+        th[t].fft_yz = NULL;
+        th[t].fft_y  = NULL;
+        th[t].fft_z  = NULL;
+        if (gmx_fft_init_1d(&th[t].fft_x,p->nx,flags) != 0)
+            return -1;
+        if (p->nnodes_y > 1)
+        {
+            if (gmx_fft_init_1d(&th[t].fft_y,p->ny,flags) != 0 ||
+                gmx_fft_init_1d_real(&th[t].fft_z,p->nz,flags) != 0)
+                return -1;
+        }
+        else
+        {
+            if (gmx_fft_init_2d_real(&th[t].fft_yz,p->ny,p->nz,flags) != 0)
+                return -1;
+        }
+        p->nthreads = t + 1;
+    }
+    p->pool = pool;
+
+    return 0;
+}
+
+
 int
 gmx_parallel_3dfft_limits(gmx_parallel_3dfft_t      pfft_setup,
                           int *                     local_x_start,
@@ -211,6 +528,36 @@ gmx_parallel_3dfft_limits(gmx_parallel_3dfft_t      pfft_setup,
 }
 
 
+int
+gmx_parallel_3dfft_limits_yz(gmx_parallel_3dfft_t   pfft_setup,
+                             int *                  local_y_start,
+                             int *                  local_ny,
+                             int *                  local_zc_start,
+                             int *                  local_nzc)
+{
+    int pencil;
+
+    if (pfft_setup->nnodes_y == 1)
+    {
+        *local_y_start  = 0;
+        *local_ny       = pfft_setup->ny;
+        *local_zc_start = 0;
+        *local_nzc      = pfft_setup->nzc;
+    }
+    else
+    {
+        pencil = pfft_setup->local_pencil;
+
+        *local_y_start  = pfft_setup->pencil2grid_y[pencil];
+        *local_ny       = pfft_setup->pencil2grid_y[pencil+1]  - (*local_y_start);
+        *local_zc_start = pfft_setup->pencil2grid_zc[pencil];
+        *local_nzc      = pfft_setup->pencil2grid_zc[pencil+1] - (*local_zc_start);
+    }
+
+    return 0;
+}
+
+
                    
 int
 gmx_parallel_transpose_xy(t_complex *   data,
@@ -277,6 +624,279 @@ gmx_parallel_transpose_xy(t_complex *   data,
     return 0;
 }
 
+
+static int
+gmx_parallel_3dfft_pencil(gmx_parallel_3dfft_t    p,
+                          enum gmx_fft_direction  dir,
+                          void *                  in_data,
+                          void *                  out_data)
+{
+    int          d,n,x,y,k,xl,yl,kyl,kzl;
+    int          nx,ny,nz,nzc,nzr;
+    int          x0,lx,y0,ly,ky0,lky,kz0,lkz;
+    int          *s2x,*s2y,*s2ky,*s2kz;
+    alltoallv_t  *aav;
+    t_complex *  work;
+    t_complex *  work2;
+    real *       rdata;
+    t_complex *  cdata;
+
+    /* The direct space grid is distributed in x over comm and in y over
+     * comm_y, z is local. The reciprocal space grid is stored as YXZ
+     * with ky distributed over comm and kz over comm_y, x is local.
+     * As with the slab decomposition all data arrays are indexed with
+     * global grid indices.
+     */
+    nx  = p->nx;
+    ny  = p->ny;
+    nz  = p->nz;
+    nzc = p->nzc;
+    nzr = (in_data == out_data ? 2*nzc : nz);
+
+    s2x  = p->slab2grid_x;
+    s2ky = p->slab2grid_y;
+    s2y  = p->pencil2grid_y;
+    s2kz = p->pencil2grid_zc;
+
+    x0  = s2x [p->local_slab];
+    lx  = s2x [p->local_slab+1]   - x0;
+    ky0 = s2ky[p->local_slab];
+    lky = s2ky[p->local_slab+1]   - ky0;
+    y0  = s2y [p->local_pencil];
+    ly  = s2y [p->local_pencil+1] - y0;
+    kz0 = s2kz[p->local_pencil];
+    lkz = s2kz[p->local_pencil+1] - kz0;
+
+    aav   = p->aav;
+    work  = p->work;
+    work2 = p->work2;
+
+    if(dir == GMX_FFT_REAL_TO_COMPLEX)
+    {
+        rdata = (real *)in_data;
+        cdata = (t_complex *)out_data;
+
+        /* A: Real-to-complex FFTs of our lx*ly z-columns */
+        pfft_loop_ffts(p,epfftZ,GMX_FFT_REAL_TO_COMPLEX,lx*ly,ly,
+                       rdata + (x0*ny + y0)*nzr,ny*nzr,nzr,
+                       work,ly*2*nzc,2*nzc);
+
+        /* B: Transpose over comm_y: distribute kz, collect all of y */
+        n = 0;
+        for(d=0; d<p->nnodes_y; d++)
+        {
+            aav->sdisps [d] = 2*n;
+            for(xl=0; xl<lx; xl++)
+            {
+                for(yl=0; yl<ly; yl++)
+                {
+                    for(k=s2kz[d]; k<s2kz[d+1]; k++)
+                    {
+                        work2[n++] = work[(xl*ly + yl)*nzc + k];
+                    }
+                }
+            }
+            aav->scounts[d] = 2*n - aav->sdisps[d];
+            aav->rdisps [d] = 2*lx*               s2y[d] *lkz;
+            aav->rcounts[d] = 2*lx*(s2y[d+1] - s2y[d])*lkz;
+        }
+        MPI_Alltoallv(work2,aav->scounts,aav->sdisps,GMX_MPI_REAL,
+                      work ,aav->rcounts,aav->rdisps,GMX_MPI_REAL,
+                      p->comm_y);
+
+        /* Reorder the received blocks to y-pencils XZY */
+        n = 0;
+        for(d=0; d<p->nnodes_y; d++)
+        {
+            for(xl=0; xl<lx; xl++)
+            {
+                for(y=s2y[d]; y<s2y[d+1]; y++)
+                {
+                    for(kzl=0; kzl<lkz; kzl++)
+                    {
+                        work2[(xl*lkz + kzl)*ny + y] = work[n++];
+                    }
+                }
+            }
+        }
+
+        /* C: Complex FFTs along y */
+        pfft_loop_ffts(p,epfftY,GMX_FFT_FORWARD,lx*lkz,1,
+                       work2,2*ny,0,work,2*ny,0);
+
+        /* D: Transpose over comm: distribute ky, collect all of x */
+        n = 0;
+        for(d=0; d<p->nnodes; d++)
+        {
+            aav->sdisps [d] = 2*n;
+            for(xl=0; xl<lx; xl++)
+            {
+                for(kzl=0; kzl<lkz; kzl++)
+                {
+                    for(y=s2ky[d]; y<s2ky[d+1]; y++)
+                    {
+                        work2[n++] = work[(xl*lkz + kzl)*ny + y];
+                    }
+                }
+            }
+            aav->scounts[d] = 2*n - aav->sdisps[d];
+            aav->rdisps [d] = 2*               s2x[d] *lkz*lky;
+            aav->rcounts[d] = 2*(s2x[d+1] - s2x[d])*lkz*lky;
+        }
+        MPI_Alltoallv(work2,aav->scounts,aav->sdisps,GMX_MPI_REAL,
+                      work ,aav->rcounts,aav->rdisps,GMX_MPI_REAL,
+                      p->comm);
+
+        /* Reorder the received blocks to x-pencils YZX */
+        n = 0;
+        for(d=0; d<p->nnodes; d++)
+        {
+            for(x=s2x[d]; x<s2x[d+1]; x++)
+            {
+                for(kzl=0; kzl<lkz; kzl++)
+                {
+                    for(kyl=0; kyl<lky; kyl++)
+                    {
+                        work2[(kyl*lkz + kzl)*nx + x] = work[n++];
+                    }
+                }
+            }
+        }
+
+        /* E: Complex FFTs along x */
+        pfft_loop_ffts(p,epfftX,GMX_FFT_FORWARD,lky*lkz,1,
+                       work2,2*nx,0,work,2*nx,0);
+
+        /* Store our part of the output in YXZ order */
+        for(kyl=0; kyl<lky; kyl++)
+        {
+            for(x=0; x<nx; x++)
+            {
+                for(kzl=0; kzl<lkz; kzl++)
+                {
+                    cdata[((ky0 + kyl)*nx + x)*nzc + kz0 + kzl] =
+                        work[(kyl*lkz + kzl)*nx + x];
+                }
+            }
+        }
+    }
+    else if(dir == GMX_FFT_COMPLEX_TO_REAL)
+    {
+        cdata = (t_complex *)in_data;
+        rdata = (real *)out_data;
+
+        /* Extract our part of the input to x-pencils YZX */
+        for(kyl=0; kyl<lky; kyl++)
+        {
+            for(x=0; x<nx; x++)
+            {
+                for(kzl=0; kzl<lkz; kzl++)
+                {
+                    work[(kyl*lkz + kzl)*nx + x] =
+                        cdata[((ky0 + kyl)*nx + x)*nzc + kz0 + kzl];
+                }
+            }
+        }
+
+        /* E: Complex FFTs along x */
+        pfft_loop_ffts(p,epfftX,GMX_FFT_BACKWARD,lky*lkz,1,
+                       work,2*nx,0,work2,2*nx,0);
+
+        /* D: Transpose over comm: distribute x, collect all of ky */
+        n = 0;
+        for(d=0; d<p->nnodes; d++)
+        {
+            aav->sdisps [d] = 2*n;
+            for(x=s2x[d]; x<s2x[d+1]; x++)
+            {
+                for(kzl=0; kzl<lkz; kzl++)
+                {
+                    for(kyl=0; kyl<lky; kyl++)
+                    {
+                        work[n++] = work2[(kyl*lkz + kzl)*nx + x];
+                    }
+                }
+            }
+            aav->scounts[d] = 2*n - aav->sdisps[d];
+            aav->rdisps [d] = 2*lx*lkz*               s2ky[d];
+            aav->rcounts[d] = 2*lx*lkz*(s2ky[d+1] - s2ky[d]);
+        }
+        MPI_Alltoallv(work ,aav->scounts,aav->sdisps,GMX_MPI_REAL,
+                      work2,aav->rcounts,aav->rdisps,GMX_MPI_REAL,
+                      p->comm);
+
+        /* Reorder the received blocks to y-pencils XZY */
+        n = 0;
+        for(d=0; d<p->nnodes; d++)
+        {
+            for(xl=0; xl<lx; xl++)
+            {
+                for(kzl=0; kzl<lkz; kzl++)
+                {
+                    for(y=s2ky[d]; y<s2ky[d+1]; y++)
+                    {
+                        work[(xl*lkz + kzl)*ny + y] = work2[n++];
+                    }
+                }
+            }
+        }
+
+        /* C: Complex FFTs along y */
+        pfft_loop_ffts(p,epfftY,GMX_FFT_BACKWARD,lx*lkz,1,
+                       work,2*ny,0,work2,2*ny,0);
+
+        /* B: Transpose over comm_y: distribute y, collect all of kz */
+        n = 0;
+        for(d=0; d<p->nnodes_y; d++)
+        {
+            aav->sdisps [d] = 2*n;
+            for(xl=0; xl<lx; xl++)
+            {
+                for(y=s2y[d]; y<s2y[d+1]; y++)
+                {
+                    for(kzl=0; kzl<lkz; kzl++)
+                    {
+                        work[n++] = work2[(xl*lkz + kzl)*ny + y];
+                    }
+                }
+            }
+            aav->scounts[d] = 2*n - aav->sdisps[d];
+            aav->rdisps [d] = 2*lx*ly*               s2kz[d];
+            aav->rcounts[d] = 2*lx*ly*(s2kz[d+1] - s2kz[d]);
+        }
+        MPI_Alltoallv(work ,aav->scounts,aav->sdisps,GMX_MPI_REAL,
+                      work2,aav->rcounts,aav->rdisps,GMX_MPI_REAL,
+                      p->comm_y);
+
+        /* Reorder the received blocks to z-pencils XYZ */
+        n = 0;
+        for(d=0; d<p->nnodes_y; d++)
+        {
+            for(xl=0; xl<lx; xl++)
+            {
+                for(yl=0; yl<ly; yl++)
+                {
+                    for(k=s2kz[d]; k<s2kz[d+1]; k++)
+                    {
+                        work[(xl*ly + yl)*nzc + k] = work2[n++];
+                    }
+                }
+            }
+        }
+
+        /* A: Complex-to-real FFTs of our lx*ly z-columns */
+        pfft_loop_ffts(p,epfftZ,GMX_FFT_COMPLEX_TO_REAL,lx*ly,ly,
+                       work,ly*2*nzc,2*nzc,
+                       rdata + (x0*ny + y0)*nzr,ny*nzr,nzr);
+    }
+    else
+    {
+        gmx_fatal(FARGS,"Incorrect FFT direction.");
+    }
+
+    return 0;
+}
+
                        
 int
 gmx_parallel_3dfft(gmx_parallel_3dfft_t    pfft_setup,
@@ -284,7 +904,6 @@ gmx_parallel_3dfft(gmx_parallel_3dfft_t    pfft_setup,
                    void *                  in_data,
                    void *                  out_data)
 {
-    int          i,j,k;
     int          nx,ny,nz,nzc,nzr;
     int          local_x_start,local_nx;
     int          local_y_start,local_ny;    
@@ -293,6 +912,11 @@ gmx_parallel_3dfft(gmx_parallel_3dfft_t    pfft_setup,
     t_complex *  cdata;
     t_complex *  ctmp;
     
+    if (pfft_setup->nnodes_y > 1)
+    {
+        return gmx_parallel_3dfft_pencil(pfft_setup,dir,in_data,out_data);
+    }
+
     work    = pfft_setup->work;
     
     /* When we do in-place FFTs the data need to be embedded in the z-dimension,
@@ -336,13 +960,8 @@ gmx_parallel_3dfft(gmx_parallel_3dfft_t    pfft_setup,
          * 
          * Note that rdata==cdata when we work in-place. 
          */
-        for(i=0;i<local_nx;i++)
-        {
-            gmx_fft_2d_real(pfft_setup->fft_yz,
-                            GMX_FFT_REAL_TO_COMPLEX,
-                            rdata + i*ny*nzr,
-                            cdata + i*ny*nzc);
-        }
+        pfft_loop_ffts(pfft_setup,epfftYZ,GMX_FFT_REAL_TO_COMPLEX,local_nx,1,
+                       rdata,ny*nzr,0,cdata,2*ny*nzc,0);
         
         /* Transpose to temporary work array */
         gmx_parallel_transpose_xy(cdata,
@@ -363,31 +982,14 @@ gmx_parallel_3dfft(gmx_parallel_3dfft_t    pfft_setup,
          */ 
         /* output cdata changes when nx or ny not divisible by nnodes */
         cdata = (t_complex *)out_data + local_y_start*nx*nzc;
-        for(j=0;j<local_ny;j++)
-        {
-            gmx_fft_transpose_2d(work  + j*nzc*nx,
-                                 cdata + j*nzc*nx,
-                                 nx,
-                                 nzc);
-        }
+        pfft_loop_transposes(pfft_setup,local_ny,work,cdata,nx,nzc);
 
         /* Perform local_ny*nzc complex FFTs along the x dimension */
-        for(i=0;i<local_ny*nzc;i++)
-        {
-            gmx_fft_1d(pfft_setup->fft_x,
-                       GMX_FFT_FORWARD,
-                       cdata + i*nx,
-                       work  + i*nx);
-        }    
+        pfft_loop_ffts(pfft_setup,epfftX,GMX_FFT_FORWARD,local_ny*nzc,1,
+                       cdata,2*nx,0,work,2*nx,0);
     
         /* Transpose back from YZX to YXZ. */
-        for(j=0;j<local_ny;j++)
-        {
-            gmx_fft_transpose_2d(work  + j*nzc*nx,
-                                 cdata + j*nzc*nx,
-                                 nzc,
-                                 nx);
-        }
+        pfft_loop_transposes(pfft_setup,local_ny,work,cdata,nzc,nx);
     }
     else if(dir == GMX_FFT_COMPLEX_TO_REAL)
     {
@@ -407,31 +1009,14 @@ gmx_parallel_3dfft(gmx_parallel_3dfft_t    pfft_setup,
         }
                 
         /* Transpose from YXZ to YZX. */
-        for(j=0;j<local_ny;j++)
-        {
-            gmx_fft_transpose_2d(cdata + j*nzc*nx,
-                                 work  + j*nzc*nx,
-                                 nx,
-                                 nzc);
-        }
+        pfft_loop_transposes(pfft_setup,local_ny,cdata,work,nx,nzc);
         
         /* Perform local_ny*nzc complex FFTs along the x dimension */
-        for(i=0;i<local_ny*nzc;i++)
-        {
-            gmx_fft_1d(pfft_setup->fft_x,
-                       GMX_FFT_BACKWARD,
-                       work + i*nx,
-                       ctmp + i*nx);
-        }    
+        pfft_loop_ffts(pfft_setup,epfftX,GMX_FFT_BACKWARD,local_ny*nzc,1,
+                       work,2*nx,0,ctmp,2*nx,0);
         
         /* Transpose from YZX to YXZ. */
-        for(j=0;j<local_ny;j++)
-        {
-            gmx_fft_transpose_2d(ctmp + j*nzc*nx,
-                                 work + j*nzc*nx,
-                                 nzc,
-                                 nx);
-        }
+        pfft_loop_transposes(pfft_setup,local_ny,ctmp,work,nzc,nx);
         
         if(in_data == out_data)
         {
@@ -456,13 +1041,8 @@ gmx_parallel_3dfft(gmx_parallel_3dfft_t    pfft_setup,
          * The 3D FFT is done in-place, so we need to do this in-place too in order
          * to get the data organization right.
          */
-        for(i=0;i<local_nx;i++)
-        {
-            gmx_fft_2d_real(pfft_setup->fft_yz,
-                            GMX_FFT_COMPLEX_TO_REAL,
-                            ctmp  + i*ny*nzc,
-                            rdata + i*ny*nzr);
-        }
+        pfft_loop_ffts(pfft_setup,epfftYZ,GMX_FFT_COMPLEX_TO_REAL,local_nx,1,
+                       ctmp,2*ny*nzc,0,rdata,ny*nzr,0);
     }
     else
     {
@@ -510,8 +1090,35 @@ gmx_parallel_3dfft_complex2real(gmx_parallel_3dfft_t    pfft_setup,
 int
 gmx_parallel_3dfft_destroy(gmx_parallel_3dfft_t    pfft_setup)
 {
+    int t;
+
+    for(t=1; t<pfft_setup->nthreads; t++)
+    {
+        gmx_fft_destroy(pfft_setup->th[t].fft_x);
+        if (pfft_setup->nnodes_y > 1)
+        {
+            gmx_fft_destroy(pfft_setup->th[t].fft_y);
+            gmx_fft_destroy(pfft_setup->th[t].fft_z);
+        }
+        else
+        {
+            gmx_fft_destroy(pfft_setup->th[t].fft_yz);
+        }
+    }
+    free(pfft_setup->th);
+
     gmx_fft_destroy(pfft_setup->fft_x);
-    gmx_fft_destroy(pfft_setup->fft_yz);
+    if (pfft_setup->nnodes_y > 1)
+    {
+        gmx_fft_destroy(pfft_setup->fft_y);
+        gmx_fft_destroy(pfft_setup->fft_z);
+        free(pfft_setup->pencil2grid_y);
+        free(pfft_setup->pencil2grid_zc);
+    }
+    else
+    {
+        gmx_fft_destroy(pfft_setup->fft_yz);
+    }
 
     free(pfft_setup->slab2grid_x);
     free(pfft_setup->slab2grid_y);
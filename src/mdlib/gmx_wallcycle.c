@@ -68,6 +68,11 @@ typedef struct gmx_wallcycle
     int          ewc_prev;
     gmx_cycles_t cycle_prev;
     gmx_step_t   reset_counters;
+    /* MC accounting per move group, mc_cyc holds a copy of all counters */
+    int          mc_group;
+    gmx_cycles_t *mc_cyc;
+    int          mc_nac[MC_NR+1];
+    int          mc_ntot[MC_NR+1];
 #ifdef GMX_MPI
     MPI_Comm     mpi_comm_mygroup;
 #endif
@@ -75,7 +80,11 @@ typedef struct gmx_wallcycle
 
 /* Each name should not exceed 19 characters */
 static const char *wcn[ewcNR] =
-  { "Run", "Step", "PP during PME", "Domain decomp.", "DD comm. load", "DD comm. bounds", "Vsite constr.", "Send X to PME", "Comm. coord.", "Neighbor search", "Force", "Wait + Comm. F", "PME mesh", "PME mesh", "Wait + Comm. X/F", "Wait + Recv. PME F", "Vsite spread", "Write traj.", "Update", "Constraints", "Comm. energies", "Test", "Born radii" };
+  { "Run", "Step", "PP during PME", "Domain decomp.", "DD comm. load", "DD comm. bounds", "Vsite constr.", "Send X to PME", "Comm. coord.", "Neighbor search", "Force", "Wait + Comm. F", "PME mesh", "PME mesh", "Wait + Comm. X/F", "Wait + Recv. PME F", "Vsite spread", "Write traj.", "Update", "Constraints", "Comm. energies", "Test", "Born radii", "MC move gen.", "MC cell lists", "MC energy", "MC accept/reject", "MC sweeps" };
+
+/* MC move group names, the last entry is the volume move */
+static const char *mcgn[MC_NR+1] =
+  { "Translation", "Rotation X", "Rotation Y", "Rotation Z", "Bond stretch", "Angle bend", "Dihedral rot.", "CRA", "Regrowth", "Volume" };
 
 bool wallcycle_have_counter(void)
 {
@@ -99,6 +108,8 @@ gmx_wallcycle_t wallcycle_init(FILE *fplog,t_commrec *cr)
     wc->wcc_all    = NULL;
     wc->wc_depth   = 0;
     wc->ewc_prev   = -1;
+    wc->mc_group   = -1;
+    wc->mc_cyc     = NULL;
 
 #ifdef GMX_MPI
     if (PAR(cr) && getenv("GMX_CYCLE_BARRIER") != NULL)
@@ -147,6 +158,10 @@ void wallcycle_destroy(gmx_wallcycle_t wc)
     {
         sfree(wc->wcc_all);
     }
+    if (wc->mc_cyc != NULL)
+    {
+        sfree(wc->mc_cyc);
+    }
     sfree(wc);
 }
 
@@ -214,6 +229,10 @@ double wallcycle_stop(gmx_wallcycle_t wc, int ewc)
     last = cycle - wc->wcc[ewc].start;
     wc->wcc[ewc].c += last;
     wc->wcc[ewc].n++;
+    if (wc->mc_group >= 0)
+    {
+        wc->mc_cyc[wc->mc_group*ewcNR+ewc] += last;
+    }
     if (wc->wcc_all)
     {
         wc->wc_depth--;
@@ -246,6 +265,47 @@ void wallcycle_reset_all(gmx_wallcycle_t wc)
         wc->wcc[i].start = 0;
         wc->wcc[i].last = 0;
     }
+    if (wc->mc_cyc != NULL)
+    {
+        for(i=0; i<(MC_NR+1)*ewcNR; i++)
+        {
+            wc->mc_cyc[i] = 0;
+        }
+        for(i=0; i<=MC_NR; i++)
+        {
+            wc->mc_nac[i]  = 0;
+            wc->mc_ntot[i] = 0;
+        }
+    }
+}
+
+void wallcycle_mc_group(gmx_wallcycle_t wc, int mvgroup)
+{
+    if (wc == NULL)
+    {
+        return;
+    }
+
+    if (wc->mc_cyc == NULL && mvgroup >= 0)
+    {
+        snew(wc->mc_cyc,(MC_NR+1)*ewcNR);
+    }
+    wc->mc_group = mvgroup;
+}
+
+void wallcycle_mc_count(gmx_wallcycle_t wc, int mvgroup, int nac, int ntot)
+{
+    if (wc == NULL)
+    {
+        return;
+    }
+
+    if (wc->mc_cyc == NULL)
+    {
+        snew(wc->mc_cyc,(MC_NR+1)*ewcNR);
+    }
+    wc->mc_nac[mvgroup]  += nac;
+    wc->mc_ntot[mvgroup] += ntot;
 }
 
 void wallcycle_sum(t_commrec *cr, gmx_wallcycle_t wc,double cycles[])
@@ -297,6 +357,17 @@ void wallcycle_sum(t_commrec *cr, gmx_wallcycle_t wc,double cycles[])
         /* Remove the constraint part from the update count */
         cycles[ewcUPDATE] -= cycles[ewcCONSTR];
     }
+    if (wcc[ewcMC_MOVE].n > 0)
+    {
+        /* MC moves are generated in update, including the constraints */
+        cycles[ewcMC_MOVE] -= cycles[ewcCONSTR];
+        cycles[ewcUPDATE]  -= cycles[ewcMC_MOVE];
+    }
+    if (wcc[ewcMC_ACCEPT].n > 0)
+    {
+        /* The cell lists are updated on acceptance */
+        cycles[ewcMC_ACCEPT] -= cycles[ewcMC_NS];
+    }
     
 #ifdef GMX_MPI    
     if (cr->nnodes > 1)
@@ -343,6 +414,66 @@ static void print_cycles(FILE *fplog, double c2t, const char *name, int nnodes,
   }
 }
 
+static void print_mc_cycles(FILE *fplog, double realtime, gmx_wallcycle_t wc)
+{
+    double c2t,t[4],ttot[4],tg;
+    gmx_cycles_t *c;
+    int    g,i,nac,ntot;
+    const char *myline = "-----------------------------------------------------------------------------------------------";
+
+    if (wc->wcc[ewcRUN].c == 0)
+    {
+        return;
+    }
+    /* The MC moves are the same on all nodes, we report the local node */
+    c2t = realtime/(double)wc->wcc[ewcRUN].c;
+
+    fprintf(fplog,"\n     M C   M O V E   A C C O U N T I N G\n\n");
+    fprintf(fplog," Move group         Moves  Acc.ratio   Gen. (s)     NS (s)  Energy (s) Accept (s)  Acc. moves/s\n");
+    fprintf(fplog,"%s\n",myline);
+    nac  = 0;
+    ntot = 0;
+    for(i=0; i<4; i++)
+    {
+        ttot[i] = 0;
+    }
+    for(g=0; g<=MC_NR; g++)
+    {
+        if (wc->mc_ntot[g] == 0)
+        {
+            continue;
+        }
+        c = wc->mc_cyc + g*ewcNR;
+        t[0] = c2t*((double)c[ewcMC_MOVE] - (double)c[ewcCONSTR]);
+        t[1] = c2t*((double)c[ewcNS] + (double)c[ewcMC_NS]);
+        t[2] = c2t*((double)c[ewcFORCE] - (double)c[ewcPMEMESH] + (double)c[ewcMC_ENER]);
+        t[3] = c2t*((double)c[ewcMC_ACCEPT] - (double)c[ewcMC_NS]);
+        tg   = 0;
+        for(i=0; i<4; i++)
+        {
+            tg      += t[i];
+            ttot[i] += t[i];
+        }
+        fprintf(fplog," %-14s %9d  %9.4f %10.3f %10.3f %11.3f %10.3f  %12.1f\n",
+                mcgn[g],wc->mc_ntot[g],(double)wc->mc_nac[g]/wc->mc_ntot[g],
+                t[0],t[1],t[2],t[3],tg > 0 ? wc->mc_nac[g]/tg : 0);
+        nac  += wc->mc_nac[g];
+        ntot += wc->mc_ntot[g];
+    }
+    fprintf(fplog,"%s\n",myline);
+    if (ntot > 0)
+    {
+        fprintf(fplog," %-14s %9d  %9.4f %10.3f %10.3f %11.3f %10.3f  %12.1f\n",
+                "Total",ntot,(double)nac/ntot,
+                ttot[0],ttot[1],ttot[2],ttot[3],realtime > 0 ? nac/realtime : 0);
+        fprintf(fplog,"%s\n",myline);
+    }
+    if (wc->wcc[ewcMC_SWEEP].n > 0)
+    {
+        fprintf(fplog," Moves done in checkerboard sweeps are counted, their time is only in \"MC sweeps\"\n");
+    }
+}
+
 void wallcycle_print(FILE *fplog, int nnodes, int npme, double realtime,
 		     gmx_wallcycle_t wc, double cycles[])
 {
@@ -410,6 +541,11 @@ void wallcycle_print(FILE *fplog, int nnodes, int npme, double realtime,
     fprintf(fplog,"%s\n",myline);
     print_cycles(fplog,c2t,"Total",nnodes,0,tot,tot);
     fprintf(fplog,"%s\n",myline);
+
+    if (wc->mc_cyc != NULL)
+    {
+        print_mc_cycles(fplog,realtime,wc);
+    }
     
     if (cycles[ewcMoveE] > tot*0.05)
     {
@@ -0,0 +1,276 @@
+/*
+ * 
+ *                This source code is part of
+ * 
+ *                 G   R   O   M   A   C   S
+ * 
+ *          GROningen MAchine for Chemical Simulations
+ * 
+ *                        VERSION 3.2.0
+ * Written by David van der Spoel, Erik Lindahl, Berk Hess, and others.
+ * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
+ * Copyright (c) 2001-2004, The GROMACS development team,
+ * check out http://www.gromacs.org for more information.
+
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * If you want to redistribute modifications, please consider that
+ * scientific software is very special. Version control is crucial -
+ * bugs must be traceable. We will be happy to consider code for
+ * inclusion in the official distribution, but derived work must not
+ * be called official GROMACS. Details are found in the README & COPYING
+ * files - if they are missing, get the official version at www.gromacs.org.
+ * 
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the papers on the package - you can find them in the top README file.
+ * 
+ * For more info, check our website at http://www.gromacs.org
+ * 
+ * And Hey:
+ * Gromacs Runs On Most of All Computer Systems
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+
+#include "typedefs.h"
+#include "smalloc.h"
+#include "vec.h"
+#include "physics.h"
+#include "gmx_fatal.h"
+#include "gmx_random.h"
+#include "network.h"
+#include "domdec.h"
+#include "force.h"
+#include "constr.h"
+#include "hmc.h"
+
+struct gmx_hmc {
+  unsigned int   seed;
+  real           kT;
+  int            nalloc;
+  rvec           *v;            /* Full step velocities                   */
+  rvec           *x0;           /* Start coordinates, global with DD      */
+  rvec           *f0;           /* Start forces, not used with DD         */
+  gmx_enerdata_t *enerd0;
+  tensor         vir0;
+  double         H0;            /* Global total energy at the start       */
+  int            nac;
+  int            ntot;
+};
+
+gmx_hmc_t init_hmc(FILE *fplog,t_commrec *cr,t_inputrec *ir,int natoms)
+{
+  struct gmx_hmc *hmc;
+
+  if (ir->eI != eiHMC)
+    return NULL;
+  if (ir->opts.ngtc == 0 || ir->opts.ref_t[0] <= 0)
+    gmx_fatal(FARGS,"Hybrid Monte Carlo requires a reference temperature");
+
+  snew(hmc,1);
+  /* The random numbers are keyed by step and global atom index,
+   * so the trajectories do not depend on the decomposition
+   * and a continuation draws the same numbers as a single run.
+   */
+  hmc->seed = ir->ld_seed;
+  hmc->kT  = BOLTZ*ir->opts.ref_t[0];
+  if (DOMAINDECOMP(cr) && MASTER(cr))
+    snew(hmc->x0,natoms);
+  snew(hmc->enerd0,1);
+  init_enerdata(ir->opts.ngener,ir->n_flambda,hmc->enerd0);
+
+  if (fplog)
+    fprintf(fplog,"\nHybrid Monte Carlo with trajectories of %d steps "
+	    "at %g K\n",ir->hmc_nsteps,ir->opts.ref_t[0]);
+
+  return hmc;
+}
+
+static void hmc_realloc(gmx_hmc_t hmc,t_commrec *cr,int nalloc)
+{
+  if (nalloc > hmc->nalloc) {
+    hmc->nalloc = nalloc;
+    srenew(hmc->v,hmc->nalloc);
+    if (!DOMAINDECOMP(cr)) {
+      srenew(hmc->x0,hmc->nalloc);
+      srenew(hmc->f0,hmc->nalloc);
+    }
+  }
+}
+
+static bool hmc_free_dim(t_inputrec *ir,t_mdatoms *md,int i,int d)
+{
+  return (md->invmass[i] > 0 &&
+	  !(md->cFREEZE && ir->opts.nFreeze[md->cFREEZE[i]][d]));
+}
+
+static void hmc_constrain_v(t_commrec *cr,t_inputrec *ir,gmx_step_t step,
+			    t_mdatoms *md,gmx_constr_t constr,t_idef *idef,
+			    t_state *state,rvec v[],t_nrnb *nrnb)
+{
+  real dvdl;
+
+  if (constr) {
+    /* Remove the velocity components along the constraints */
+    dvdl = 0;
+    constrain(NULL,FALSE,FALSE,constr,idef,ir,cr,step,0,md,
+	      state->x,v,v,state->box,state->lambda,&dvdl,
+	      NULL,NULL,nrnb,econqDeriv);
+  }
+}
+
+/* Returns the global sum of the local potential and kinetic energy */
+static double hmc_total_energy(t_commrec *cr,t_mdatoms *md,rvec v[],
+			       gmx_enerdata_t *enerd)
+{
+  double H;
+  int    i;
+
+  H = 0;
+  for(i=md->start; i<md->start+md->homenr; i++)
+    H += 0.5*md->massT[i]*norm2(v[i]);
+  H += enerd->term[F_EPOT];
+  if (PAR(cr))
+    gmx_sumd(1,&H,cr);
+
+  return H;
+}
+
+void hmc_start(gmx_hmc_t hmc,t_commrec *cr,t_inputrec *ir,
+	       gmx_step_t step,t_mdatoms *md,gmx_constr_t constr,
+	       t_idef *idef,t_state *state,rvec f[],
+	       gmx_enerdata_t *enerd,tensor force_vir,t_nrnb *nrnb)
+{
+  gmx_rng_cb_t rng;
+  int    start,end,i,d;
+  double vcm[2*DIM];
+  real   hdt;
+
+  start = md->start;
+  end   = md->start + md->homenr;
+  hmc_realloc(hmc,cr,state->nalloc);
+
+  gmx_rng_cb_init(&rng,hmc->seed,erngcbHMC);
+  for(d=0; d<2*DIM; d++)
+    vcm[d] = 0;
+  for(i=start; i<end; i++) {
+    gmx_rng_cb_restart(&rng,step,DOMAINDECOMP(cr) ? cr->dd->gatindex[i] : i);
+    for(d=0; d<DIM; d++) {
+      if (hmc_free_dim(ir,md,i,d)) {
+	hmc->v[i][d] = sqrt(hmc->kT*md->invmass[i])*gmx_rng_cb_gaussian_real(&rng);
+	vcm[d]     += md->massT[i]*hmc->v[i][d];
+	vcm[DIM+d] += md->massT[i];
+      } else {
+	hmc->v[i][d] = 0;
+      }
+    }
+  }
+  if (ir->comm_mode != ecmNO) {
+    /* Draw the velocities with the center of mass at rest,
+     * otherwise the COM motion removal changes the total energy.
+     */
+    if (PAR(cr))
+      gmx_sumd(2*DIM,vcm,cr);
+    for(i=start; i<end; i++)
+      for(d=0; d<DIM; d++)
+	if (hmc_free_dim(ir,md,i,d))
+	  hmc->v[i][d] -= vcm[d]/vcm[DIM+d];
+  }
+  hmc_constrain_v(cr,ir,step,md,constr,idef,state,hmc->v,nrnb);
+
+  hmc->H0 = hmc_total_energy(cr,md,hmc->v,enerd);
+
+  if (DOMAINDECOMP(cr)) {
+    dd_collect_vec(cr->dd,state,state->x,hmc->x0);
+  } else {
+    for(i=start; i<end; i++) {
+      copy_rvec(state->x[i],hmc->x0[i]);
+      copy_rvec(f[i],hmc->f0[i]);
+    }
+  }
+  copy_enerdata(enerd,hmc->enerd0);
+  copy_mat(force_vir,hmc->vir0);
+
+  /* v(-dt/2), such that the update gives v(dt/2) = v(0) + dt/2 f(0)/m */
+  hdt = 0.5*ir->delta_t;
+  for(i=start; i<end; i++)
+    for(d=0; d<DIM; d++)
+      state->v[i][d] = hmc->v[i][d] - (hmc_free_dim(ir,md,i,d) ?
+				       hdt*md->invmass[i]*f[i][d] : 0);
+}
+
+real hmc_end(gmx_hmc_t hmc,t_commrec *cr,t_inputrec *ir,
+	     gmx_step_t step,t_mdatoms *md,gmx_constr_t constr,
+	     t_idef *idef,t_state *state,rvec f[],
+	     gmx_enerdata_t *enerd,t_nrnb *nrnb,real *bolt)
+{
+  gmx_rng_cb_t rng;
+  int    i,d;
+  real   hdt;
+  double H1;
+
+  hmc_realloc(hmc,cr,state->nalloc);
+
+  /* Complete the velocity Verlet step: v(t) = v(t-dt/2) + dt/2 f(t)/m */
+  hdt = 0.5*ir->delta_t;
+  for(i=md->start; i<md->start+md->homenr; i++)
+    for(d=0; d<DIM; d++)
+      hmc->v[i][d] = (hmc_free_dim(ir,md,i,d) ?
+		      state->v[i][d] + hdt*md->invmass[i]*f[i][d] : 0);
+  hmc_constrain_v(cr,ir,step,md,constr,idef,state,hmc->v,nrnb);
+
+  H1 = hmc_total_energy(cr,md,hmc->v,enerd);
+
+  gmx_rng_cb_init(&rng,hmc->seed,erngcbHMCACCEPT);
+  gmx_rng_cb_restart(&rng,step,0);
+  *bolt = gmx_rng_cb_uniform_real(&rng);
+
+  return H1 - hmc->H0;
+}
+
+void hmc_finish(gmx_hmc_t hmc,t_commrec *cr,bool bAccept,
+		t_mdatoms *md,t_state *state,rvec f[],
+		gmx_enerdata_t *enerd,tensor force_vir,
+		t_state *state_global)
+{
+  int i;
+
+  hmc->ntot++;
+  if (bAccept) {
+    hmc->nac++;
+    return;
+  }
+
+  if (DOMAINDECOMP(cr)) {
+    if (MASTER(cr))
+      for(i=0; i<state_global->natoms; i++)
+	copy_rvec(hmc->x0[i],state_global->x[i]);
+  } else {
+    for(i=md->start; i<md->start+md->homenr; i++) {
+      copy_rvec(hmc->x0[i],state->x[i]);
+      copy_rvec(hmc->f0[i],f[i]);
+    }
+  }
+  copy_enerdata(hmc->enerd0,enerd);
+  copy_mat(hmc->vir0,force_vir);
+}
+
+void done_hmc(FILE *fplog,gmx_hmc_t hmc)
+{
+  if (fplog)
+    fprintf(fplog,"\nHybrid Monte Carlo: %d of %d trajectories accepted "
+	    "(%.1f%%)\n",hmc->nac,hmc->ntot,
+	    hmc->ntot > 0 ? 100.0*hmc->nac/hmc->ntot : 0.0);
+  sfree(hmc->v);
+  sfree(hmc->x0);
+  sfree(hmc->f0);
+  destroy_enerdata(hmc->enerd0);
+  sfree(hmc->enerd0);
+  sfree(hmc);
+}
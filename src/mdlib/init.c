@@ -54,6 +54,7 @@
 #include "gmx_random.h"
 #include "update.h"
 #include "mdebin.h"
+#include "mcadapt.h"
 
 #define BUFSIZE	256
 
@@ -125,6 +126,11 @@ static void set_state_entries(t_state *state,t_inputrec *ir,int nnodes)
   if (ir->etc == etcNOSEHOOVER || ir->etc == etcVRESCALE) {
     state->flags |= (1<<estTC_INT);
   }
+  if (EI_MC(ir->eI)) {
+    state->flags |= ((1<<estMC_DELTA) | (1<<estMC_PROB) |
+                     (1<<estMC_COUNTS) | (1<<estMC_ENER));
+    init_mc_adapt_state(state,ir);
+  }
 
   init_ekinstate(&state->ekinstate,ir);
 
@@ -159,10 +165,9 @@ void init_parallel(FILE *log,char *tpxfile,t_commrec *cr,
   }
   bcast_ir_mtop(cr,inputrec,mtop);
 
-  if (inputrec->eI == eiBD || EI_SD(inputrec->eI)) {
-    /* Make sure the random seeds are different on each node */
-    inputrec->ld_seed += cr->nodeid;
-  }
+  /* The SD and BD noise is keyed by the global atom index,
+   * so all nodes should use the same seed.
+   */
   
   /* Printing */
   if (list!=0 && log!=NULL) 
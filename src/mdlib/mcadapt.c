@@ -0,0 +1,296 @@
+/*
+ * 
+ *                This source code is part of
+ * 
+ *                 G   R   O   M   A   C   S
+ * 
+ *          GROningen MAchine for Chemical Simulations
+ * 
+ *                        VERSION 3.2.0
+ * Written by David van der Spoel, Erik Lindahl, Berk Hess, and others.
+ * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
+ * Copyright (c) 2001-2004, The GROMACS development team,
+ * check out http://www.gromacs.org for more information.
+
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * If you want to redistribute modifications, please consider that
+ * scientific software is very special. Version control is crucial -
+ * bugs must be traceable. We will be happy to consider code for
+ * inclusion in the official distribution, but derived work must not
+ * be called official GROMACS. Details are found in the README & COPYING
+ * files - if they are missing, get the official version at www.gromacs.org.
+ * 
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the papers on the package - you can find them in the top README file.
+ * 
+ * For more info, check our website at http://www.gromacs.org
+ * 
+ * And Hey:
+ * Gromacs Runs On Most of All Computer Systems
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+
+#include "typedefs.h"
+#include "smalloc.h"
+#include "macros.h"
+#include "vec.h"
+#include "gmx_cyclecounter.h"
+#include "mcadapt.h"
+
+/* The minimum number of moves in a tuning window to adjust a step size */
+#define MC_ADAPT_MIN_MOVES 10
+/* The minimum selection probability, relative to uniform selection */
+#define MC_ADAPT_MIN_PROB  0.2
+
+struct gmx_mc_adapt {
+  int          ac0[MC_NR+1];    /* Accepted moves at the window start   */
+  int          tot0[MC_NR+1];   /* Total moves at the window start      */
+  int          ac_start[MC_NR+1];  /* Accepted moves at the tuning start */
+  int          tot_start[MC_NR+1]; /* Total moves at the tuning start   */
+  double       cycles[MC_NR+1]; /* Cycles spent per move group          */
+  gmx_cycles_t cycles_prev;
+  bool         bProbChanged;    /* Did the tuning change mc_prob?       */
+  bool         bDone;
+};
+
+/* Returns the inputrec step size used for move group g, NULL when
+ * the group does not have a step size.
+ */
+static real *mc_ir_delta(t_inputrec *ir,int g)
+{
+  switch (g) {
+  case MC_TRANSLATE: return &ir->cm_translate;
+  case MC_ROTATEX:
+  case MC_ROTATEY:
+  case MC_ROTATEZ:   return &ir->cm_rot;
+  case MC_BONDS:     return &ir->bond_stretch;
+  case MC_ANGLES:    return &ir->angle_bend;
+  case MC_DIHEDRALS: return &ir->dihedral_rot;
+  case MC_NR:        return &ir->volume;
+  }
+
+  return NULL;
+}
+
+/* Returns the upper limit of the step size of group g */
+static real mc_delta_max(int g,matrix box)
+{
+  switch (g) {
+  case MC_TRANSLATE: return 0.5*min(box[XX][XX],min(box[YY][YY],box[ZZ][ZZ]));
+  case MC_NR:        return 0.5*det(box);
+  case MC_BONDS:     return GMX_REAL_MAX;
+  }
+
+  /* Angles in degrees */
+  return 180;
+}
+
+static void mc_get_counts(t_state *state,int ac[],int tot[])
+{
+  int g;
+
+  for(g=0; g<MC_NR; g++) {
+    ac[g]  = state->step_ac[g];
+    tot[g] = state->step_tot[g];
+  }
+  ac[MC_NR]  = state->vol_ac;
+  tot[MC_NR] = state->vol_tot;
+}
+
+void init_mc_adapt_state(t_state *state,t_inputrec *ir)
+{
+  real *d;
+  int  g;
+
+  for(g=0; g<=MC_NR; g++) {
+    d = mc_ir_delta(ir,g);
+    state->mc_delta[g] = (d ? *d : 0);
+  }
+  for(g=0; g<MC_NR; g++)
+    state->mc_prob[g] = 1.0/MC_NR;
+}
+
+gmx_mc_adapt_t init_mc_adapt(FILE *fplog,t_inputrec *ir,t_state *state)
+{
+  struct gmx_mc_adapt *adapt;
+  real *d;
+  int  g;
+
+  if (ir->mc_adapt_steps <= 0)
+    return NULL;
+
+  snew(adapt,1);
+  for(g=0; g<=MC_NR; g++) {
+    d = mc_ir_delta(ir,g);
+    if (d)
+      *d = state->mc_delta[g];
+  }
+  mc_get_counts(state,adapt->ac0,adapt->tot0);
+  for(g=0; g<=MC_NR; g++) {
+    adapt->ac_start[g]  = adapt->ac0[g];
+    adapt->tot_start[g] = adapt->tot0[g];
+  }
+  adapt->cycles_prev = gmx_cycles_read();
+  /* A continuation after the tuning period keeps the tuned values */
+  adapt->bDone = (ir->init_step >= ir->mc_adapt_steps);
+
+  if (fplog && !adapt->bDone)
+    fprintf(fplog,"\nMC step sizes and move probabilities are tuned every %d "
+	    "steps up to step %d,\ntarget acceptance ratio %g\n",
+	    ir->mc_adapt_nst,ir->mc_adapt_steps,ir->mc_accept_target);
+
+  return adapt;
+}
+
+int mc_adapt_select(gmx_mc_adapt_t adapt,t_state *state,gmx_rng_cb_t *rng)
+{
+  real sum,r;
+  int  g;
+
+  sum = 0;
+  for(g=0; g<MC_NR; g++)
+    sum += state->mc_prob[g];
+  r = gmx_rng_cb_uniform_real(rng)*sum;
+  g = 0;
+  sum = state->mc_prob[0];
+  while (g < MC_NR-1 && r >= sum) {
+    g++;
+    sum += state->mc_prob[g];
+  }
+
+  return g;
+}
+
+/* Scales the step sizes with the acceptance ratio of the last window */
+static void mc_adapt_delta(gmx_mc_adapt_t adapt,t_inputrec *ir,
+			   t_state *state,int ac[],int tot[])
+{
+  int  g,g1,h,nac,ntot;
+  real fac;
+
+  for(g=0; g<=MC_NR; g++) {
+    if (mc_ir_delta(ir,g) == NULL || g == MC_ROTATEY || g == MC_ROTATEZ)
+      continue;
+    /* The rotations share one step size */
+    g1 = (g == MC_ROTATEX ? MC_ROTATEZ : g);
+    nac  = 0;
+    ntot = 0;
+    for(h=g; h<=g1; h++) {
+      nac  += ac[h]  - adapt->ac0[h];
+      ntot += tot[h] - adapt->tot0[h];
+    }
+    if (ntot < MC_ADAPT_MIN_MOVES || state->mc_delta[g] <= 0)
+      continue;
+    fac = ((real)nac/ntot)/ir->mc_accept_target;
+    fac = max(0.5,min(2.0,fac));
+    for(h=g; h<=g1; h++)
+      state->mc_delta[h] = min(fac*state->mc_delta[h],
+			       mc_delta_max(h,state->box));
+    *mc_ir_delta(ir,g) = state->mc_delta[g];
+  }
+}
+
+/* Divides the probability of the groups with timed moves over these
+ * groups proportionally to the acceptance ratio divided by the cost
+ * per move, i.e. to the accepted moves per cycle.
+ * Groups without timed moves keep their probability.
+ */
+static void mc_adapt_prob(gmx_mc_adapt_t adapt,t_state *state,
+			  int ac[],int tot[])
+{
+  double w[MC_NR],wsum,pmeas;
+  bool   bMeas[MC_NR];
+  int    g,n,nmeas;
+  real   p;
+
+  wsum  = 0;
+  pmeas = 0;
+  nmeas = 0;
+  for(g=0; g<MC_NR; g++) {
+    n = tot[g] - adapt->tot_start[g];
+    bMeas[g] = (n > 0 && adapt->cycles[g] > 0);
+    if (bMeas[g]) {
+      w[g]   = (ac[g] - adapt->ac_start[g])/adapt->cycles[g];
+      wsum  += w[g];
+      pmeas += state->mc_prob[g];
+      nmeas++;
+    } else {
+      w[g] = 0;
+    }
+  }
+  if (nmeas == 0 || pmeas <= 0)
+    return;
+
+  /* Groups that do not accept any moves keep a minimum probability */
+  for(g=0; g<MC_NR; g++)
+    if (bMeas[g])
+      w[g] = max(wsum > 0 ? w[g]/wsum : 0,MC_ADAPT_MIN_PROB/nmeas);
+  wsum = 0;
+  for(g=0; g<MC_NR; g++)
+    wsum += w[g];
+  for(g=0; g<MC_NR; g++) {
+    if (bMeas[g]) {
+      p = pmeas*w[g]/wsum;
+      if (p != state->mc_prob[g])
+	adapt->bProbChanged = TRUE;
+      state->mc_prob[g] = p;
+    }
+  }
+}
+
+void mc_adapt_step(FILE *fplog,gmx_mc_adapt_t adapt,t_inputrec *ir,
+		   t_state *state,gmx_step_t step,int mvgroup)
+{
+  int  ac[MC_NR+1],tot[MC_NR+1],g;
+  gmx_cycles_t cycles;
+  char buf[22];
+
+  if (adapt->bDone)
+    return;
+
+  cycles = gmx_cycles_read();
+  adapt->cycles[mvgroup] += (double)(cycles - adapt->cycles_prev);
+  adapt->cycles_prev = cycles;
+
+  if (step == 0 || step % ir->mc_adapt_nst != 0)
+    return;
+
+  mc_get_counts(state,ac,tot);
+  mc_adapt_delta(adapt,ir,state,ac,tot);
+  mc_adapt_prob(adapt,state,ac,tot);
+  for(g=0; g<=MC_NR; g++) {
+    adapt->ac0[g]  = ac[g];
+    adapt->tot0[g] = tot[g];
+  }
+
+  if (step >= ir->mc_adapt_steps) {
+    adapt->bDone = TRUE;
+    if (fplog) {
+      fprintf(fplog,"\nMC tuning finished at step %s\n",gmx_step_str(step,buf));
+      fprintf(fplog,"  translation %g nm, rotation %g deg, bond %g nm, "
+	      "angle %g deg, dihedral %g deg, volume %g nm^3\n",
+	      ir->cm_translate,ir->cm_rot,ir->bond_stretch,
+	      ir->angle_bend,ir->dihedral_rot,ir->volume);
+      fprintf(fplog,"  move probabilities:");
+      for(g=0; g<MC_NR; g++)
+	fprintf(fplog," %.3f",state->mc_prob[g]);
+      fprintf(fplog,"\n");
+      if (!adapt->bProbChanged)
+	fprintf(fplog,"  NOTE: the tuning did not change the move "
+		"probabilities, fewer than two move groups were used\n");
+    }
+  }
+}
+
+void done_mc_adapt(gmx_mc_adapt_t adapt)
+{
+  sfree(adapt);
+}
@@ -0,0 +1,1692 @@
+/*
+ * 
+ *                This source code is part of
+ * 
+ *                 G   R   O   M   A   C   S
+ * 
+ *          GROningen MAchine for Chemical Simulations
+ * 
+ *                        VERSION 3.2.0
+ * Written by David van der Spoel, Erik Lindahl, Berk Hess, and others.
+ * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
+ * Copyright (c) 2001-2004, The GROMACS development team,
+ * check out http://www.gromacs.org for more information.
+
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * If you want to redistribute modifications, please consider that
+ * scientific software is very special. Version control is crucial -
+ * bugs must be traceable. We will be happy to consider code for
+ * inclusion in the official distribution, but derived work must not
+ * be called official GROMACS. Details are found in the README & COPYING
+ * files - if they are missing, get the official version at www.gromacs.org.
+ * 
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the papers on the package - you can find them in the top README file.
+ * 
+ * For more info, check our website at http://www.gromacs.org
+ * 
+ * And Hey:
+ * Gromacs Runs On Most of All Computer Systems
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+#include <stdlib.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "typedefs.h"
+#include "smalloc.h"
+#include "macros.h"
+#include "vec.h"
+#include "physics.h"
+#include "names.h"
+#include "gmx_fatal.h"
+#include "gmx_thread_pool.h"
+#include "network.h"
+#include "pbc.h"
+#include "domdec.h"
+#include "force.h"
+#include "update.h"
+#include "mshift.h"
+#include "mdebin.h"
+#include "mctrial.h"
+
+/* Upper limit for the default number of threads */
+#define GMX_MC_MAX_THREADS 64
+
+struct gmx_mc_trials {
+  int               ntrial;
+  gmx_thread_pool_t pool;
+  gmx_rng_cb_t      rng;     /* For generating the trials               */
+  gmx_rng_cb_t      srng;    /* For selecting a trial                   */
+  real              *u;      /* DIM uniform numbers per trial           */
+  int               nalloc;
+  rvec              **xt;    /* Coordinates of the moved molecule       */
+  double            *dU_y;   /* Energy changes of the trials            */
+  double            *dU_z;   /* Energy changes of the reference set     */
+  int               nblock;  /* The number of blocks of trials evaluated */
+
+  /* The arguments of the current call, used by the thread tasks */
+  bool              bRef;
+  int               jsel;
+  gmx_mc_move       *mc_move;
+  t_inputrec        *ir;
+  t_forcerec        *fr;
+  gmx_localtop_t    *top;
+  t_mdatoms         *md;
+  t_fcdata          *fcd;
+  rvec              *box;
+  rvec              *xprev;
+  rvec              *x;
+  real              lambda;
+};
+
+int mc_nthreads(t_inputrec *ir,const t_commrec *cr)
+{
+  char *env;
+  int  nthreads,nranks;
+
+  nthreads = ir->bMCCheckerboard ? GMX_MC_MAX_THREADS :
+    max(1,max(ir->mc_ntrial,ir->mc_regrow_ntrial));
+  /* Collective call, also when the environment sets the count */
+  nranks = gmx_node_nranks(cr);
+#if defined HAVE_UNISTD_H && defined _SC_NPROCESSORS_ONLN
+  /* The CPUs of a node are shared by the processes running on it */
+  nthreads = min(nthreads,max(1,sysconf(_SC_NPROCESSORS_ONLN)/nranks));
+#else
+  if (ir->bMCCheckerboard || nranks > 1)
+    nthreads = 1;
+#endif
+  if ((env = getenv("GMX_MC_NTHREADS")) != NULL)
+    nthreads = max(1,strtol(env,NULL,10));
+
+  return nthreads;
+}
+
+/* Returns the range k0 to k1 of block b when n trials are divided
+ * over nb blocks.
+ */
+static void mc_trial_block(int n,int nb,int b,int *k0,int *k1)
+{
+  *k0 = (b*n)/nb;
+  *k1 = ((b + 1)*n)/nb;
+}
+
+static bool mc_rigid_group(int mvgroup)
+{
+  return (mvgroup == MC_TRANSLATE || mvgroup == MC_ROTATEX ||
+	  mvgroup == MC_ROTATEY   || mvgroup == MC_ROTATEZ);
+}
+
+gmx_mc_trials_t init_mc_trials(FILE *fplog,t_inputrec *ir,
+			       gmx_mc_move *mc_move)
+{
+  struct gmx_mc_trials *trials;
+
+  if (ir->mc_ntrial <= 1 || !enerd_mc_incremental(mc_move))
+    return NULL;
+
+  snew(trials,1);
+  trials->ntrial = ir->mc_ntrial;
+
+  trials->pool = gmx_thread_pool_init(mc_move->nthreads);
+
+  gmx_rng_cb_init(&trials->rng,ir->ld_seed,erngcbMCTRIAL);
+  gmx_rng_cb_init(&trials->srng,ir->ld_seed,erngcbMCACCEPT);
+  snew(trials->u,trials->ntrial*DIM);
+  snew(trials->xt,trials->ntrial);
+  snew(trials->dU_y,trials->ntrial);
+  snew(trials->dU_z,trials->ntrial);
+  trials->nblock = min(trials->ntrial,gmx_thread_pool_nthreads(trials->pool));
+
+  if (fplog)
+    fprintf(fplog,"\nRigid MC molecule moves use %d trials, "
+	    "evaluated with %d threads\n",
+	    trials->ntrial,gmx_thread_pool_nthreads(trials->pool));
+
+  return trials;
+}
+
+bool mc_trials_applicable(gmx_mc_trials_t trials,gmx_mc_move *mc_move)
+{
+  return (trials != NULL && mc_rigid_group(mc_move->mvgroup));
+}
+
+/* Sets a random move of the same type and distribution as in do_md
+ * from the DIM uniform numbers u.
+ */
+static void mc_trial_delta(t_inputrec *ir,int mvgroup,const real u[],
+			   rvec delta_x,rvec delta_phi)
+{
+  int d;
+
+  clear_rvec(delta_x);
+  clear_rvec(delta_phi);
+  switch (mvgroup) {
+  case MC_TRANSLATE:
+    for(d=0; d<DIM; d++)
+      delta_x[d] = (2.0*u[d]-1.0)*ir->cm_translate;
+    break;
+  case MC_ROTATEX:
+  case MC_ROTATEY:
+  case MC_ROTATEZ:
+    d = mvgroup - MC_ROTATEX;
+    delta_phi[d] = M_PI*(2.0*u[0]-1.0)*ir->cm_rot/180.0;
+    break;
+  default:
+    gmx_incons("MC trials are only supported for rigid moves");
+  }
+}
+
+/* Thread task: generates trial k */
+static void mc_trial_task(void *data,int k,int thread)
+{
+  struct gmx_mc_trials *trials=(struct gmx_mc_trials *)data;
+  gmx_mc_move *mc_move=trials->mc_move;
+  int    start,nr,i;
+  rvec   *xsrc,delta_x,delta_phi;
+
+  if (trials->bRef && k == trials->jsel)
+    return;
+
+  start = mc_move->start;
+  nr    = mc_move->end - mc_move->start;
+  if (!trials->bRef && k == 0) {
+    /* The first trial has been generated by update */
+    xsrc = trials->x + start;
+  } else {
+    /* Trials start from the old configuration, the reference set
+     * from the selected trial.
+     */
+    xsrc = trials->bRef ? trials->xt[trials->jsel] : trials->xprev + start;
+  }
+  for(i=0; i<nr; i++)
+    copy_rvec(xsrc[i],trials->xt[k][i]);
+  if (trials->bRef || k > 0) {
+    mc_trial_delta(trials->ir,mc_move->mvgroup,trials->u+k*DIM,
+		   delta_x,delta_phi);
+    update_mc_rigid(nr,trials->xt[k],trials->md->massA+start,
+		    mc_move->mvgroup,delta_x,delta_phi);
+  }
+}
+
+/* Thread task: evaluates block b of the trials, the interactions with
+ * the rest of the system are computed for the whole block at once.
+ */
+static void mc_trial_eval_task(void *data,int b,int thread)
+{
+  struct gmx_mc_trials *trials=(struct gmx_mc_trials *)data;
+  int k0,k1;
+
+  mc_trial_block(trials->ntrial,trials->nblock,b,&k0,&k1);
+  trial_epot_mc_batch(trials->mc_move,k0,k1,
+		      trials->bRef ? trials->jsel : -1,
+		      trials->fr,trials->top,trials->md,trials->fcd,
+		      trials->box,trials->xprev,trials->xt,trials->lambda,
+		      trials->bRef ? trials->dU_z : trials->dU_y);
+}
+
+/* Returns log(sum_k exp(-beta*dU[k])) over the n values in dU,
+ * skipping index skip, plus the term for dU=0 when bZero is set.
+ */
+static double mc_log_sum_weights(int n,double dU[],int skip,bool bZero,
+				 double beta)
+{
+  double umin,sum;
+  int    k;
+
+  umin = bZero ? 0 : GMX_DOUBLE_MAX;
+  for(k=0; k<n; k++)
+    if (k != skip)
+      umin = min(umin,dU[k]);
+  sum = bZero ? exp(beta*umin) : 0;
+  for(k=0; k<n; k++)
+    if (k != skip)
+      sum += exp(-beta*(dU[k] - umin));
+
+  return log(sum) - beta*umin;
+}
+
+real do_mc_trials(gmx_mc_trials_t trials,
+		  gmx_enerdata_t *enerd,gmx_enerdata_t *enerd_prev,
+		  gmx_mc_move *mc_move,t_inputrec *ir,t_forcerec *fr,
+		  gmx_localtop_t *top,t_mdatoms *md,t_fcdata *fcd,
+		  gmx_step_t step,matrix box,rvec xprev[],rvec x[],
+		  real lambda)
+{
+  double kT,beta,umin,sum,r,lw_y,lw_z;
+  int    nr,k,i,j;
+
+  nr = mc_move->end - mc_move->start;
+  if (nr > trials->nalloc) {
+    trials->nalloc = over_alloc_small(nr);
+    for(k=0; k<trials->ntrial; k++)
+      srenew(trials->xt[k],trials->nalloc);
+  }
+  trials->mc_move = mc_move;
+  trials->ir      = ir;
+  trials->fr      = fr;
+  trials->top     = top;
+  trials->md      = md;
+  trials->fcd     = fcd;
+  trials->box     = box;
+  trials->xprev   = xprev;
+  trials->x       = x;
+  trials->lambda  = lambda;
+
+  kT   = BOLTZ*ir->opts.ref_t[0];
+  beta = 1.0/kT;
+
+  /* Generate and evaluate the trials, the numbers of trial k are keyed
+   * by k and those of the reference set by ntrial+k.
+   */
+  trials->bRef = FALSE;
+  gmx_rng_cb_uniform_real_batch(&trials->rng,step,trials->ntrial,NULL,0,
+				DIM,trials->u);
+  gmx_thread_pool_run(trials->pool,trials->ntrial,mc_trial_task,trials);
+  gmx_thread_pool_run(trials->pool,trials->nblock,mc_trial_eval_task,trials);
+
+  /* Select a trial with probability proportional to its Boltzmann weight */
+  umin = trials->dU_y[0];
+  for(k=1; k<trials->ntrial; k++)
+    umin = min(umin,trials->dU_y[k]);
+  sum = 0;
+  for(k=0; k<trials->ntrial; k++)
+    sum += exp(-beta*(trials->dU_y[k] - umin));
+  gmx_rng_cb_restart(&trials->srng,step,1);
+  r = gmx_rng_cb_uniform_real(&trials->srng)*sum;
+  j = 0;
+  sum = exp(-beta*(trials->dU_y[0] - umin));
+  while (j < trials->ntrial-1 && r >= sum) {
+    j++;
+    sum += exp(-beta*(trials->dU_y[j] - umin));
+  }
+  trials->jsel = j;
+
+  /* Generate and evaluate the reference set around the selected trial,
+   * the old configuration completes the set.
+   */
+  trials->bRef = TRUE;
+  gmx_rng_cb_uniform_real_batch(&trials->rng,step,trials->ntrial,NULL,
+				trials->ntrial,DIM,trials->u);
+  gmx_thread_pool_run(trials->pool,trials->ntrial,mc_trial_task,trials);
+  gmx_thread_pool_run(trials->pool,trials->nblock,mc_trial_eval_task,trials);
+
+  for(i=0; i<nr; i++)
+    copy_rvec(trials->xt[j][i],x[mc_move->start+i]);
+  set_enerd_mc(enerd,enerd_prev,mc_move,j);
+
+  lw_y = mc_log_sum_weights(trials->ntrial,trials->dU_y,-1,FALSE,beta);
+  lw_z = mc_log_sum_weights(trials->ntrial,trials->dU_z,j,TRUE,beta);
+
+  /* accept_mc with this energy change accepts with probability
+   * min(1,W(trials)/W(reference set))
+   */
+  return kT*(lw_z - lw_y);
+}
+
+void done_mc_trials(gmx_mc_trials_t trials)
+{
+  int k;
+
+  gmx_thread_pool_done(trials->pool);
+  for(k=0; k<trials->ntrial; k++)
+    sfree(trials->xt[k]);
+  sfree(trials->u);
+  sfree(trials->xt);
+  sfree(trials->dU_y);
+  sfree(trials->dU_z);
+  sfree(trials);
+}
+
+static void mc_com(int nr,rvec x[],real mass[],rvec com)
+{
+  int  i;
+  real mtot;
+
+  clear_rvec(com);
+  mtot = 0;
+  for(i=0; i<nr; i++) {
+    com[XX] += mass[i]*x[i][XX];
+    com[YY] += mass[i]*x[i][YY];
+    com[ZZ] += mass[i]*x[i][ZZ];
+    mtot    += mass[i];
+  }
+  svmul(1/mtot,com,com);
+}
+
+/* MC moves with domain decomposition.
+ * Only the molecules with all their atoms at home are moved, and only
+ * when their center of mass lies at least the cut-off plus the largest
+ * molecule radius above the lower and the radius below the upper cell
+ * boundary along the decomposed dimensions. All interaction partners
+ * of these molecules are then present on the node, since the halo
+ * contains the charge groups up to the cut-off above the cell, and
+ * molecules moved on different nodes do not interact. So all nodes
+ * move their molecules simultaneously without communication.
+ * The system is shifted by a random vector, the same on all nodes,
+ * before each repartitioning, such that the boundary layers of
+ * molecules that are not moved differ between sweeps.
+ */
+struct gmx_mc_dd {
+  t_commrec *cr;
+  gmx_rng_cb_t rng;      /* For the shifts, the same on all nodes    */
+  t_block   *mols_gl;
+  int       *a2mol;      /* The molecule of each global atom         */
+  ivec      bDecomp;     /* Is a dimension decomposed                */
+  rvec      shift;
+  int       mol_nalloc;
+  t_block   mols;        /* The complete home molecules, local atoms */
+  int       *mol_gl;     /* The global index of these molecules      */
+  real      rmol;        /* The largest atom distance to a com       */
+  rvec      r0,r1;       /* The region of the movable molecule coms  */
+  int       x_nalloc;
+  rvec      *xprev;
+};
+
+gmx_mc_dd_t init_mc_dd(FILE *fplog,t_commrec *cr,t_inputrec *ir,
+		       gmx_mtop_t *mtop,matrix box)
+{
+  struct gmx_mc_dd *mdd;
+  int  m,a,d;
+
+  if (!DOMAINDECOMP(cr))
+    return NULL;
+  if (ir->ePBC != epbcXYZ || TRICLINIC(box))
+    gmx_fatal(FARGS,"MC moves with domain decomposition require pbc = %s "
+	      "and a rectangular box",epbc_names[epbcXYZ]);
+
+  snew(mdd,1);
+  mdd->cr = cr;
+  gmx_rng_cb_init(&mdd->rng,ir->ld_seed,erngcbMCGRID);
+  mdd->mols_gl = &mtop->mols;
+  snew(mdd->a2mol,mtop->natoms);
+  for(m=0; m<mtop->mols.nr; m++)
+    for(a=mtop->mols.index[m]; a<mtop->mols.index[m+1]; a++)
+      mdd->a2mol[a] = m;
+  for(d=0; d<DIM; d++)
+    mdd->bDecomp[d] = (cr->dd->nc[d] > 1);
+
+  if (fplog)
+    fprintf(fplog,"\nMC moves are done on all %d domains simultaneously, "
+	    "molecules near the domain boundaries are not moved\n",
+	    cr->dd->nnodes);
+
+  return mdd;
+}
+
+void mc_dd_shift(gmx_mc_dd_t mdd,gmx_step_t step,int homenr,rvec x[])
+{
+  rvec cell_x0,cell_x1,size_min;
+  int  d,i;
+
+  /* The minimum cell size is the same on all nodes. Repartitioning
+   * allows atoms to move one minimum cell size beyond their old cell,
+   * the shift and the shift back after the sweep stay within that.
+   */
+  dd_get_cell_bounds(mdd->cr->dd,cell_x0,cell_x1,size_min);
+  gmx_rng_cb_restart(&mdd->rng,step,0);
+  for(d=0; d<DIM; d++) {
+    mdd->shift[d] = (2*gmx_rng_cb_uniform_real(&mdd->rng) - 1)*0.4*size_min[d];
+    if (!mdd->bDecomp[d])
+      mdd->shift[d] = 0;
+  }
+  for(i=0; i<homenr; i++)
+    rvec_inc(x[i],mdd->shift);
+}
+
+void mc_dd_unshift(gmx_mc_dd_t mdd,int homenr,rvec x[])
+{
+  int i;
+
+  for(i=0; i<homenr; i++)
+    rvec_dec(x[i],mdd->shift);
+}
+
+void mc_dd_set_local(gmx_mc_dd_t mdd,gmx_mc_move *mc_move,t_forcerec *fr,
+		     gmx_localtop_t *top,t_mdatoms *md,matrix box,rvec x[])
+{
+  gmx_domdec_t *dd=mdd->cr->dd;
+  t_block *mols=&mdd->mols;
+  t_pbc pbc;
+  rvec cell_x0,cell_x1,size_min,dx,com;
+  real rc,r2,rmol2;
+  int  cg,cg1,m,a,a0,a1,d;
+
+  /* The home charge groups are sorted on global index,
+   * so the atoms of each molecule are consecutive.
+   */
+  set_pbc(&pbc,fr->ePBC,box);
+  mols->nr = 0;
+  rmol2    = 0;
+  for(cg=0; cg<dd->ncg_home; cg=cg1) {
+    a0 = dd->cgindex[cg];
+    m  = mdd->a2mol[dd->gatindex[a0]];
+    for(cg1=cg+1; (cg1 < dd->ncg_home &&
+		   mdd->a2mol[dd->gatindex[dd->cgindex[cg1]]] == m); cg1++) ;
+    a1 = dd->cgindex[cg1];
+    if (a1 - a0 < mdd->mols_gl->index[m+1] - mdd->mols_gl->index[m])
+      continue;
+
+    if (mols->nr+1 >= mdd->mol_nalloc) {
+      mdd->mol_nalloc = over_alloc_dd(mols->nr+2);
+      srenew(mols->index,mdd->mol_nalloc);
+      srenew(mdd->mol_gl,mdd->mol_nalloc);
+    }
+    mols->index[mols->nr]  = a0;
+    mdd->mol_gl[mols->nr]  = m;
+    mols->nr++;
+    mols->index[mols->nr]  = a1;
+
+    /* Make the molecule whole */
+    for(a=a0+1; a<a1; a++) {
+      pbc_dx_aiuc(&pbc,x[a],x[a0],dx);
+      rvec_add(x[a0],dx,x[a]);
+    }
+    mc_com(a1-a0,x+a0,md->massT+a0,com);
+    for(a=a0; a<a1; a++) {
+      r2 = distance2(x[a],com);
+      rmol2 = max(rmol2,r2);
+    }
+  }
+  mdd->rmol = sqrt(rmol2);
+
+  rc = max(fr->rlist,fr->rlistlong);
+  dd_get_cell_bounds(dd,cell_x0,cell_x1,size_min);
+  for(d=0; d<DIM; d++) {
+    if (mdd->bDecomp[d]) {
+      mdd->r0[d] = cell_x0[d] + rc + mdd->rmol;
+      mdd->r1[d] = cell_x1[d] - mdd->rmol;
+    } else {
+      mdd->r0[d] = 0;
+      mdd->r1[d] = box[d][d];
+    }
+  }
+
+  if (md->nr > mdd->x_nalloc) {
+    mdd->x_nalloc = over_alloc_dd(md->nr);
+    srenew(mdd->xprev,mdd->x_nalloc);
+  }
+  for(a=0; a<md->nr; a++)
+    copy_rvec(x[a],mdd->xprev[a]);
+
+  set_enerd_mc_top(mc_move,fr,top,md,box,x);
+}
+
+t_block *mc_dd_mols(gmx_mc_dd_t mdd)
+{
+  return &mdd->mols;
+}
+
+rvec *mc_dd_xprev(gmx_mc_dd_t mdd)
+{
+  return mdd->xprev;
+}
+
+/* Returns if a molecule with center of mass com can be moved */
+static bool mc_dd_movable(gmx_mc_dd_t mdd,rvec com)
+{
+  int d;
+
+  for(d=0; d<DIM; d++)
+    if (mdd->bDecomp[d] && (com[d] < mdd->r0[d] || com[d] >= mdd->r1[d]))
+      return FALSE;
+
+  return TRUE;
+}
+
+void done_mc_dd(gmx_mc_dd_t mdd)
+{
+  sfree(mdd->a2mol);
+  sfree(mdd->mols.index);
+  sfree(mdd->mol_gl);
+  sfree(mdd->xprev);
+  sfree(mdd);
+}
+
+/* Checkerboard sweeps.
+ * The box is divided in cells of at least the cut-off plus twice the
+ * largest molecule radius, with an even number of cells along each
+ * divided dimension. Molecules with their center of mass in cells of
+ * the same color (parity of the cell index along each dimension) do not
+ * interact, so these cells can be swept simultaneously. Each cell acts
+ * as a domain: its molecules are only moved within the cell and their
+ * energies are computed with a halo of charge groups around it.
+ * The halos of a color are built from a cell list of the charge groups
+ * before its cells are swept, since accepted moves change the centers.
+ * The cell grid is shifted randomly for each sweep for ergodicity.
+ * Each molecule in a cell gets one move per sweep, in order, its random
+ * numbers are keyed by the step and the global molecule index.
+ * With domain decomposition each node sweeps the region of its home
+ * cell where molecules can be moved (see gmx_mc_dd), the cells along
+ * the decomposed dimensions then divide this region without periodicity.
+ */
+
+/* The random numbers per molecule: the group, the move and the acceptance */
+#define MC_SWEEP_NU (2+DIM)
+
+struct gmx_mc_sweep {
+  gmx_thread_pool_t pool;
+  gmx_rng_cb_t      rng;       /* For the molecule moves             */
+  gmx_rng_cb_t      grng;      /* For the grid shift and color order */
+  gmx_mc_dd_t       dd;        /* Domain decomposition, or NULL      */
+  ivec              bBounded;  /* Are the cells bounded by the region */
+  int               u_nalloc;
+  real              *u;        /* MC_SWEEP_NU numbers per molecule   */
+  int               ngroup;
+  int               group[MC_NR]; /* The rigid move groups in use    */
+  int               nmol;
+  rvec              *com;
+  int               *mol_cell;
+  ivec              nc;        /* The number of cells along each dim */
+  rvec              cw;        /* The cell size                      */
+  rvec              offset;    /* The shift of the cell grid         */
+  int               ncell;
+  int               cell_nalloc;
+  int               *cell_index; /* Molecules of each cell in cell_mol */
+  int               *cell_mol;
+  int               ntask;
+  int               *task_cell;  /* The cells of the current color     */
+  int               cg_nalloc;
+  int               *cg_cell;    /* The cell of each charge group      */
+  int               *cell_cgi;   /* Cgs of each cell in cell_cg        */
+  int               *cell_cg;
+  int               *halo_index; /* Halo of each task in halo          */
+  int               halo_nalloc;
+  int               *halo;
+  double            *dener;      /* Energy changes of each cell, F_NRE */
+  int               *nac;        /* Accepted moves per cell and group  */
+  int               *ntot;       /* Tried moves per cell and group     */
+  real              margin;      /* Halo size                          */
+
+  /* The arguments of the current call, used by the thread tasks */
+  gmx_mc_move       *mc_move;
+  t_inputrec        *ir;
+  t_forcerec        *fr;
+  gmx_localtop_t    *top;
+  t_block           *mols;
+  t_mdatoms         *md;
+  t_fcdata          *fcd;
+  rvec              *box;
+  rvec              *xprev;
+  rvec              *x;
+  real              lambda;
+};
+
+gmx_mc_sweep_t init_mc_sweep(FILE *fplog,t_inputrec *ir,gmx_mc_move *mc_move,
+			     t_block *mols,gmx_mc_dd_t mdd)
+{
+  struct gmx_mc_sweep *sweep;
+  int  nthreads;
+
+  if (!ir->bMCCheckerboard)
+    return NULL;
+  if (!enerd_mc_incremental(mc_move))
+    gmx_fatal(FARGS,"mc_checkerboard requires incremental MC energies, "
+	      "see the log file for why these are not used");
+
+  snew(sweep,1);
+  nthreads = mc_move->nthreads;
+  sweep->pool = gmx_thread_pool_init(nthreads);
+  gmx_rng_cb_init(&sweep->rng,ir->ld_seed,erngcbMCSWEEP);
+  gmx_rng_cb_init(&sweep->grng,ir->ld_seed,erngcbMCGRID);
+  sweep->dd   = mdd;
+  if (ir->cm_translate > 0)
+    sweep->group[sweep->ngroup++] = MC_TRANSLATE;
+  if (ir->cm_rot > 0) {
+    sweep->group[sweep->ngroup++] = MC_ROTATEX;
+    sweep->group[sweep->ngroup++] = MC_ROTATEY;
+    sweep->group[sweep->ngroup++] = MC_ROTATEZ;
+  }
+  /* With domain decomposition only the home molecules are swept */
+  sweep->nmol = mols->nr;
+  snew(sweep->com,sweep->nmol);
+  snew(sweep->mol_cell,sweep->nmol);
+  snew(sweep->cell_mol,sweep->nmol);
+
+  if (fplog)
+    fprintf(fplog,"\nRigid MC molecule moves are done in checkerboard sweeps "
+	    "with %d threads\n",gmx_thread_pool_nthreads(sweep->pool));
+
+  return sweep;
+}
+
+bool mc_sweep_applicable(gmx_mc_sweep_t sweep,gmx_mc_move *mc_move)
+{
+  return (sweep != NULL && sweep->ngroup > 0 &&
+	  mc_rigid_group(mc_move->mvgroup));
+}
+
+/* Returns the cell index along d of position x, along bounded
+ * dimensions the index is outside 0 to nc[d] when x is outside the region.
+ */
+static int mc_sweep_ci(gmx_mc_sweep_t sweep,matrix box,rvec x,int d)
+{
+  real dx;
+  int  ci;
+
+  dx  = x[d] - sweep->offset[d];
+  if (sweep->bBounded[d]) {
+    if (dx < 0 || sweep->cw[d] <= 0)
+      return -1;
+    return (int)(dx/sweep->cw[d]);
+  }
+  dx -= box[d][d]*floor(dx/box[d][d]);
+  ci  = (int)(dx/sweep->cw[d]);
+
+  return min(ci,sweep->nc[d]-1);
+}
+
+/* Returns the cell of position x. Outside the region -1 is returned,
+ * or with bClamp the nearest cell.
+ */
+static int mc_sweep_cell(gmx_mc_sweep_t sweep,matrix box,rvec x,bool bClamp)
+{
+  ivec ci;
+  int  d;
+
+  for(d=0; d<DIM; d++) {
+    ci[d] = mc_sweep_ci(sweep,box,x,d);
+    if (ci[d] < 0 || ci[d] >= sweep->nc[d]) {
+      if (!bClamp)
+	return -1;
+      ci[d] = (ci[d] < 0 ? 0 : sweep->nc[d] - 1);
+    }
+  }
+
+  return (ci[XX]*sweep->nc[YY] + ci[YY])*sweep->nc[ZZ] + ci[ZZ];
+}
+
+/* Sets the cell indices along each dimension of cell c */
+static void mc_sweep_cell_ci(gmx_mc_sweep_t sweep,int c,ivec ci)
+{
+  ci[XX] = c/(sweep->nc[YY]*sweep->nc[ZZ]);
+  ci[YY] = (c/sweep->nc[ZZ]) % sweep->nc[YY];
+  ci[ZZ] = c % sweep->nc[ZZ];
+}
+
+/* Builds the halos of the cells in task_cell: the charge groups with
+ * centers within margin of the cell. Since the margin is smaller than
+ * the cell size, these lie in the cell and its direct neighbors.
+ * Charge groups outside the region are put in the nearest cell.
+ */
+static void mc_sweep_halos(gmx_mc_sweep_t sweep,matrix box)
+{
+  rvec *cg_cm;
+  ivec ci,nb;
+  int  b[DIM][3];
+  rvec x0,x1;
+  real dx;
+  int  ncg,cg,c,t,d,o,j,k,ix,iy,iz,nh;
+  bool bIn;
+
+  cg_cm = get_cg_cm_mc(sweep->mc_move,&ncg);
+  if (ncg > sweep->cg_nalloc) {
+    sweep->cg_nalloc = over_alloc_large(ncg);
+    srenew(sweep->cg_cell,sweep->cg_nalloc);
+    srenew(sweep->cell_cg,sweep->cg_nalloc);
+  }
+
+  /* Sort the charge groups on cell */
+  for(c=0; c<=sweep->ncell; c++)
+    sweep->cell_cgi[c] = 0;
+  for(cg=0; cg<ncg; cg++) {
+    sweep->cg_cell[cg] = mc_sweep_cell(sweep,box,cg_cm[cg],TRUE);
+    sweep->cell_cgi[sweep->cg_cell[cg]+1]++;
+  }
+  for(c=0; c<sweep->ncell; c++)
+    sweep->cell_cgi[c+1] += sweep->cell_cgi[c];
+  for(cg=0; cg<ncg; cg++)
+    sweep->cell_cg[sweep->cell_cgi[sweep->cg_cell[cg]]++] = cg;
+  for(c=sweep->ncell; c>0; c--)
+    sweep->cell_cgi[c] = sweep->cell_cgi[c-1];
+  sweep->cell_cgi[0] = 0;
+
+  nh = 0;
+  for(t=0; t<sweep->ntask; t++) {
+    sweep->halo_index[t] = nh;
+    c = sweep->task_cell[t];
+    mc_sweep_cell_ci(sweep,c,ci);
+    for(d=0; d<DIM; d++) {
+      x0[d] = sweep->offset[d] + ci[d]*sweep->cw[d];
+      x1[d] = x0[d] + sweep->cw[d];
+      /* The distinct neighboring cells, with less than 3 cells
+       * the neighbors below and above coincide.
+       */
+      nb[d] = 0;
+      for(o=-1; o<=1; o++) {
+	j = ci[d] + o;
+	if (sweep->bBounded[d] && (j < 0 || j >= sweep->nc[d]))
+	  continue;
+	j = (j + sweep->nc[d]) % sweep->nc[d];
+	for(k=0; k<nb[d] && b[d][k]!=j; k++) ;
+	if (k == nb[d])
+	  b[d][nb[d]++] = j;
+      }
+    }
+    for(ix=0; ix<nb[XX]; ix++)
+      for(iy=0; iy<nb[YY]; iy++)
+	for(iz=0; iz<nb[ZZ]; iz++) {
+	  c = (b[XX][ix]*sweep->nc[YY] + b[YY][iy])*sweep->nc[ZZ] + b[ZZ][iz];
+	  for(k=sweep->cell_cgi[c]; k<sweep->cell_cgi[c+1]; k++) {
+	    cg  = sweep->cell_cg[k];
+	    bIn = TRUE;
+	    for(d=0; d<DIM && bIn; d++) {
+	      dx  = cg_cm[cg][d] - x0[d];
+	      if (sweep->bBounded[d]) {
+		bIn = (dx >= -sweep->margin &&
+		       dx < x1[d] - x0[d] + sweep->margin);
+	      } else {
+		/* The distance above x0 along d, in [0,box) */
+		dx -= box[d][d]*floor(dx/box[d][d]);
+		bIn = (dx < x1[d] - x0[d] + sweep->margin ||
+		       dx >= box[d][d] - sweep->margin);
+	      }
+	    }
+	    if (bIn) {
+	      if (nh >= sweep->halo_nalloc) {
+		sweep->halo_nalloc = over_alloc_large(nh+1);
+		srenew(sweep->halo,sweep->halo_nalloc);
+	      }
+	      sweep->halo[nh++] = cg;
+	    }
+	  }
+	}
+  }
+  sweep->halo_index[sweep->ntask] = nh;
+}
+
+/* Thread task: sweeps the molecules in cell task_cell[t] */
+static void mc_sweep_task(void *data,int t,int thread)
+{
+  struct gmx_mc_sweep *sweep=(struct gmx_mc_sweep *)data;
+  gmx_mc_move mv;
+  real   *mass=sweep->md->massA,*u;
+  rvec   *x=sweep->x,*xprev=sweep->xprev;
+  rvec   delta_x,delta_phi,com;
+  double beta,*dener,dU;
+  int    c,nm,n,m,g,grp,nr,i;
+  bool   bAccept;
+
+  c = sweep->task_cell[t];
+  set_trial_halo_mc(sweep->mc_move,thread,
+		    sweep->halo_index[t+1]-sweep->halo_index[t],
+		    sweep->halo+sweep->halo_index[t]);
+
+  dener = sweep->dener + c*F_NRE;
+  beta  = 1.0/(BOLTZ*sweep->ir->opts.ref_t[0]);
+  mv    = *sweep->mc_move;
+  nm    = sweep->cell_index[c+1] - sweep->cell_index[c];
+  for(n=0; n<nm; n++) {
+    m = sweep->cell_mol[sweep->cell_index[c] + n];
+    u = sweep->u + m*MC_SWEEP_NU;
+    mv.start = sweep->mols->index[m];
+    mv.end   = sweep->mols->index[m+1];
+    nr       = mv.end - mv.start;
+    g = min(sweep->ngroup-1,(int)(u[0]*sweep->ngroup));
+    grp = (nr > 1 ? sweep->group[g] : MC_TRANSLATE);
+    if (grp == MC_TRANSLATE && sweep->ir->cm_translate == 0)
+      continue;
+    mv.mvgroup = grp;
+
+    mc_trial_delta(sweep->ir,grp,u+1,delta_x,delta_phi);
+    update_mc_rigid(nr,x+mv.start,mass+mv.start,grp,delta_x,delta_phi);
+
+    /* Molecules can not leave their cell during a sweep */
+    mc_com(nr,x+mv.start,mass+mv.start,com);
+    bAccept = (mc_sweep_cell(sweep,sweep->box,com,FALSE) == c);
+    if (bAccept) {
+      dU = trial_epot_mc(&mv,thread,sweep->fr,sweep->top,sweep->md,
+			 sweep->fcd,sweep->box,xprev,x,sweep->lambda);
+      bAccept = (dU <= 0 || u[1+DIM] < exp(-beta*dU));
+    }
+    if (bAccept) {
+      commit_trial_mc(&mv,thread,sweep->top,dener);
+      for(i=mv.start; i<mv.end; i++)
+	copy_rvec(x[i],xprev[i]);
+      sweep->nac[c*MC_NR+grp]++;
+    } else {
+      for(i=mv.start; i<mv.end; i++)
+	copy_rvec(xprev[i],x[i]);
+    }
+    sweep->ntot[c*MC_NR+grp]++;
+  }
+
+  set_trial_halo_mc(sweep->mc_move,thread,0,NULL);
+}
+
+/* Sets up the cells and assigns the molecules to them,
+ * the grid shift is drawn from sweep->grng.
+ */
+static void mc_sweep_cells(gmx_mc_sweep_t sweep,t_block *mols,
+			   real mass[],matrix box,rvec x[],real rc)
+{
+  real r2,rmol2,wmin,width;
+  int  m,i,d,c;
+
+  rmol2 = 0;
+  for(m=0; m<mols->nr; m++) {
+    mc_com(mols->index[m+1]-mols->index[m],x+mols->index[m],
+	   mass+mols->index[m],sweep->com[m]);
+    for(i=mols->index[m]; i<mols->index[m+1]; i++) {
+      r2 = distance2(x[i],sweep->com[m]);
+      rmol2 = max(rmol2,r2);
+    }
+  }
+  /* Charge groups of molecules in same-color cells should be beyond
+   * the cut-off, including after rotation.
+   */
+  wmin = rc + 2*sqrt(rmol2);
+  sweep->margin = rc + sqrt(rmol2);
+  sweep->ncell = 1;
+  for(d=0; d<DIM; d++) {
+    sweep->bBounded[d] = (sweep->dd != NULL && sweep->dd->bDecomp[d]);
+    if (sweep->bBounded[d]) {
+      /* No periodicity, so no even number of cells is required */
+      width = sweep->dd->r1[d] - sweep->dd->r0[d];
+      sweep->nc[d]     = max(1,(int)(width/wmin));
+      sweep->cw[d]     = max(0,width)/sweep->nc[d];
+      sweep->offset[d] = sweep->dd->r0[d];
+    } else {
+      sweep->nc[d] = (int)(box[d][d]/wmin);
+      if (sweep->nc[d] > 1 && sweep->nc[d] % 2 == 1)
+	sweep->nc[d]--;
+      sweep->nc[d]     = max(1,sweep->nc[d]);
+      sweep->cw[d]     = box[d][d]/sweep->nc[d];
+      sweep->offset[d] = gmx_rng_cb_uniform_real(&sweep->grng)*sweep->cw[d];
+    }
+    sweep->ncell    *= sweep->nc[d];
+  }
+
+  if (sweep->ncell > sweep->cell_nalloc) {
+    sweep->cell_nalloc = over_alloc_small(sweep->ncell);
+    srenew(sweep->cell_index,sweep->cell_nalloc+1);
+    srenew(sweep->task_cell,sweep->cell_nalloc);
+    srenew(sweep->cell_cgi,sweep->cell_nalloc+1);
+    srenew(sweep->halo_index,sweep->cell_nalloc+1);
+    srenew(sweep->dener,sweep->cell_nalloc*F_NRE);
+    srenew(sweep->nac,sweep->cell_nalloc*MC_NR);
+    srenew(sweep->ntot,sweep->cell_nalloc*MC_NR);
+  }
+  for(c=0; c<=sweep->ncell; c++)
+    sweep->cell_index[c] = 0;
+  /* Molecules outside the region are not assigned to a cell */
+  for(m=0; m<mols->nr; m++) {
+    sweep->mol_cell[m] = mc_sweep_cell(sweep,box,sweep->com[m],FALSE);
+    if (sweep->mol_cell[m] >= 0)
+      sweep->cell_index[sweep->mol_cell[m]+1]++;
+  }
+  for(c=0; c<sweep->ncell; c++)
+    sweep->cell_index[c+1] += sweep->cell_index[c];
+  for(m=0; m<mols->nr; m++)
+    if (sweep->mol_cell[m] >= 0)
+      sweep->cell_mol[sweep->cell_index[sweep->mol_cell[m]]++] = m;
+  for(c=sweep->ncell; c>0; c--)
+    sweep->cell_index[c] = sweep->cell_index[c-1];
+  sweep->cell_index[0] = 0;
+}
+
+void do_mc_sweep(gmx_mc_sweep_t sweep,
+		 gmx_enerdata_t *enerd,gmx_enerdata_t *enerd_prev,
+		 gmx_mc_move *mc_move,t_inputrec *ir,t_forcerec *fr,
+		 gmx_localtop_t *top,t_block *mols,t_mdatoms *md,
+		 t_fcdata *fcd,gmx_step_t step,matrix box,
+		 rvec xprev[],rvec x[],real lambda,
+		 int step_ac[],int step_tot[])
+{
+  double dener[F_NRE];
+  int    nac[MC_NR],ntot[MC_NR];
+  int    ncolor,col,col0,c,ci,d,i,bit;
+  bool   bColor;
+
+  sweep->mc_move = mc_move;
+  sweep->ir      = ir;
+  sweep->fr      = fr;
+  sweep->top     = top;
+  sweep->mols    = mols;
+  sweep->md      = md;
+  sweep->fcd     = fcd;
+  sweep->box     = box;
+  sweep->xprev   = xprev;
+  sweep->x       = x;
+  sweep->lambda  = lambda;
+
+  /* The grid stream is the same on all nodes, index 0 is used
+   * by the shift of mc_dd_shift.
+   */
+  gmx_rng_cb_restart(&sweep->grng,step,1);
+  mc_sweep_cells(sweep,mols,md->massA,box,x,max(fr->rlist,fr->rlistlong));
+  if (mols->nr > sweep->u_nalloc) {
+    sweep->u_nalloc = over_alloc_large(mols->nr);
+    srenew(sweep->u,sweep->u_nalloc*MC_SWEEP_NU);
+  }
+  gmx_rng_cb_uniform_real_batch(&sweep->rng,step,mols->nr,
+				sweep->dd ? sweep->dd->mol_gl : NULL,0,
+				MC_SWEEP_NU,sweep->u);
+  for(i=0; i<sweep->ncell*F_NRE; i++)
+    sweep->dener[i] = 0;
+  for(i=0; i<sweep->ncell*MC_NR; i++) {
+    sweep->nac[i]  = 0;
+    sweep->ntot[i] = 0;
+  }
+
+  /* Sweep the colors in turn, starting at a random one */
+  ncolor = 1;
+  for(d=0; d<DIM; d++)
+    if (sweep->nc[d] > 1)
+      ncolor *= 2;
+  col0 = min(ncolor-1,(int)(gmx_rng_cb_uniform_real(&sweep->grng)*ncolor));
+  for(col=col0; col<col0+ncolor; col++) {
+    sweep->ntask = 0;
+    for(c=0; c<sweep->ncell; c++) {
+      bColor = TRUE;
+      bit    = 0;
+      for(d=DIM-1; d>=0; d--) {
+	ci = (d == XX ? c/(sweep->nc[YY]*sweep->nc[ZZ]) :
+	      d == YY ? (c/sweep->nc[ZZ]) % sweep->nc[YY] : c % sweep->nc[ZZ]);
+	if (sweep->nc[d] > 1) {
+	  bColor = bColor && (ci % 2 == ((col % ncolor) >> bit) % 2);
+	  bit++;
+	}
+      }
+      if (bColor)
+	sweep->task_cell[sweep->ntask++] = c;
+    }
+    /* The halos are built before the cells are swept, as the tasks
+     * move the charge groups of their cells.
+     */
+    mc_sweep_halos(sweep,box);
+    gmx_thread_pool_run(sweep->pool,sweep->ntask,mc_sweep_task,sweep);
+  }
+
+  /* Reduce in cell order, so the result does not depend on the threads */
+  for(i=0; i<F_NRE; i++)
+    dener[i] = 0;
+  for(i=0; i<MC_NR; i++) {
+    nac[i]  = 0;
+    ntot[i] = 0;
+  }
+  for(c=0; c<sweep->ncell; c++) {
+    for(i=0; i<F_EPOT; i++)
+      dener[i] += sweep->dener[c*F_NRE+i];
+    for(i=0; i<MC_NR; i++) {
+      nac[i]  += sweep->nac[c*MC_NR+i];
+      ntot[i] += sweep->ntot[c*MC_NR+i];
+    }
+  }
+  if (sweep->dd) {
+    gmx_sumd(F_NRE,dener,sweep->dd->cr);
+    gmx_sumi(MC_NR,nac,sweep->dd->cr);
+    gmx_sumi(MC_NR,ntot,sweep->dd->cr);
+  }
+  for(i=0; i<MC_NR; i++) {
+    step_ac[i]  += nac[i];
+    step_tot[i] += ntot[i];
+  }
+  add_enerd_mc(enerd,dener);
+  add_enerd_mc(enerd_prev,dener);
+  reset_grid_mc(mc_move,box);
+}
+
+void done_mc_sweep(gmx_mc_sweep_t sweep)
+{
+  gmx_thread_pool_done(sweep->pool);
+  sfree(sweep->u);
+  sfree(sweep->com);
+  sfree(sweep->mol_cell);
+  sfree(sweep->cell_mol);
+  sfree(sweep->cell_index);
+  sfree(sweep->task_cell);
+  sfree(sweep->cg_cell);
+  sfree(sweep->cell_cgi);
+  sfree(sweep->cell_cg);
+  sfree(sweep->halo_index);
+  sfree(sweep->halo);
+  sfree(sweep->dener);
+  sfree(sweep->nac);
+  sfree(sweep->ntot);
+  sfree(sweep);
+}
+
+/* Configurational-bias regrowth.
+ * An MC_regrow entry is a rotatable bond ai-aj, the atoms on the aj side
+ * form the tail. A move starts at a random entry and regrows the tail
+ * bond by bond along the following entries, as long as these lie in the
+ * tail of the previous bond. For each bond mc_regrow_ntrial random
+ * torsions of the tail are evaluated with the incremental MC energies
+ * and one is selected by Boltzmann weight. The Rosenbluth weight of the
+ * old configuration is computed by retracing it from the new one.
+ * Since the tail is rotated as a whole, and not removed and grown atom
+ * by atom, the energy increments are those of the whole molecule.
+ */
+struct gmx_mc_regrow {
+  int               ntrial;
+  gmx_thread_pool_t pool;
+  gmx_rng_cb_t      rng;     /* For generating the trial torsions       */
+  gmx_rng_cb_t      srng;    /* For selecting a trial                   */
+  real              *u;      /* A uniform number per trial              */
+  int               nalloc;
+  rvec              **xt;    /* Coordinates of the moved molecule       */
+  rvec              *xcur;   /* The configuration grown up to now       */
+  rvec              *xnew;   /* The selected new configuration          */
+  double            *dU;     /* Energy changes of the trials            */
+  double            *phi;    /* Torsion changes of the trials           */
+  int               seg_nalloc;
+  int               nseg;
+  int               *seg_a;  /* The bond atoms of each segment, local  */
+  int               *tail_index;
+  int               tail_nalloc;
+  int               *tail;   /* The tail atoms of each segment, local  */
+  double            *dphi;   /* The selected torsion change per segment */
+  int               nblock;  /* The number of blocks of trials evaluated */
+
+  /* The arguments of the current call, used by the thread tasks */
+  bool              bOld;
+  int               seg;
+  gmx_step_t        step;
+  gmx_mc_move       *mc_move;
+  t_forcerec        *fr;
+  gmx_localtop_t    *top;
+  t_mdatoms         *md;
+  t_fcdata          *fcd;
+  rvec              *box;
+  rvec              *xprev;
+  real              lambda;
+};
+
+gmx_mc_regrow_t init_mc_regrow(FILE *fplog,t_inputrec *ir,
+			       gmx_mc_move *mc_move)
+{
+  struct gmx_mc_regrow *regrow;
+
+  if (ir->mc_regrow_ntrial <= 0 ||
+      mc_move->group[MC_REGROW].ilist->nr == 0)
+    return NULL;
+  if (!enerd_mc_incremental(mc_move)) {
+    if (fplog)
+      fprintf(fplog,"\nNOTE: MC regrowth moves require incremental MC "
+	      "energies, the regrowth entries are ignored\n");
+    return NULL;
+  }
+
+  snew(regrow,1);
+  regrow->ntrial = ir->mc_regrow_ntrial;
+
+  regrow->pool = gmx_thread_pool_init(min(regrow->ntrial,mc_move->nthreads));
+
+  gmx_rng_cb_init(&regrow->rng,ir->ld_seed,erngcbMCTRIAL);
+  gmx_rng_cb_init(&regrow->srng,ir->ld_seed,erngcbMCACCEPT);
+  snew(regrow->u,regrow->ntrial);
+  snew(regrow->xt,regrow->ntrial);
+  snew(regrow->dU,regrow->ntrial);
+  snew(regrow->phi,regrow->ntrial);
+  regrow->nblock = min(regrow->ntrial,gmx_thread_pool_nthreads(regrow->pool));
+
+  if (fplog)
+    fprintf(fplog,"\nMC regrowth moves use %d trial torsions per bond, "
+	    "evaluated with %d threads\n",
+	    regrow->ntrial,gmx_thread_pool_nthreads(regrow->pool));
+
+  return regrow;
+}
+
+bool mc_regrow_applicable(gmx_mc_regrow_t regrow,gmx_mc_move *mc_move)
+{
+  return (regrow != NULL && mc_move->mvgroup == MC_REGROW);
+}
+
+/* Rotates the atoms tail[0..ntail) of x by phi around the bond ai-aj */
+static void mc_rotate_tail(rvec x[],int ai,int aj,int ntail,int tail[],
+			   real phi)
+{
+  rvec   u,v,uxv;
+  real   c,s,uv;
+  int    t,d;
+
+  rvec_sub(x[aj],x[ai],u);
+  unitv(u,u);
+  c = cos(phi);
+  s = sin(phi);
+  for(t=0; t<ntail; t++) {
+    rvec_sub(x[tail[t]],x[aj],v);
+    cprod(u,v,uxv);
+    uv = iprod(u,v);
+    for(d=0; d<DIM; d++)
+      x[tail[t]][d] = x[aj][d] + c*v[d] + s*uxv[d] + (1 - c)*uv*u[d];
+  }
+}
+
+/* Sets up the segments of the move starting at the entry in mc_move,
+ * returns FALSE when the entries do not fit in the moved molecule.
+ */
+static bool mc_regrow_segments(gmx_mc_regrow_t regrow,
+			       gmx_mc_move *mc_move,t_graph *graph)
+{
+  t_ilist *il=mc_move->group[MC_REGROW].ilist;
+  int  start,nr,e0,e,ai,aj,ntail,nt,t;
+  bool bChain;
+
+  start = mc_move->start;
+  nr    = mc_move->end - mc_move->start;
+
+  /* Find the selected entry */
+  ai = mc_move->group[MC_REGROW].ai - start;
+  aj = mc_move->group[MC_REGROW].aj - start;
+  for(e0=0; e0<il->nr; e0+=2)
+    if (il->iatoms[e0] == ai && il->iatoms[e0+1] == aj)
+      break;
+
+  regrow->nseg = 0;
+  ntail = 0;
+  for(e=e0; e<il->nr; e+=2) {
+    ai = il->iatoms[e];
+    aj = il->iatoms[e+1];
+    if (ai >= nr || aj >= nr)
+      return FALSE;
+    if (regrow->nseg > 0) {
+      /* The bond should lie in the tail of the previous bond */
+      bChain = FALSE;
+      for(t=regrow->tail_index[regrow->nseg-1]; t<ntail; t++)
+	if (regrow->tail[t] == aj)
+	  bChain = TRUE;
+      if (!bChain)
+	break;
+    }
+    if (regrow->nseg + 1 >= regrow->seg_nalloc) {
+      regrow->seg_nalloc = over_alloc_small(regrow->nseg + 2);
+      srenew(regrow->seg_a,2*regrow->seg_nalloc);
+      srenew(regrow->tail_index,regrow->seg_nalloc+1);
+      srenew(regrow->dphi,regrow->seg_nalloc);
+    }
+    if (ntail + nr > regrow->tail_nalloc) {
+      regrow->tail_nalloc = over_alloc_small(ntail + nr);
+      srenew(regrow->tail,regrow->tail_nalloc);
+    }
+    regrow->seg_a[2*regrow->nseg]   = ai;
+    regrow->seg_a[2*regrow->nseg+1] = aj;
+    regrow->tail_index[regrow->nseg] = ntail;
+    nt = 0;
+    bond_rot(graph,start+ai,start+aj,regrow->tail+ntail,&nt,-1);
+    for(t=ntail; t<ntail+nt; t++) {
+      regrow->tail[t] -= start;
+      if (regrow->tail[t] == ai || regrow->tail[t] < 0 ||
+	  regrow->tail[t] >= nr)
+	gmx_fatal(FARGS,"MC regrowth bond %d-%d is part of a ring or "
+		  "connects molecules",ai+1,aj+1);
+    }
+    ntail += nt;
+    regrow->nseg++;
+    regrow->tail_index[regrow->nseg] = ntail;
+  }
+
+  return (regrow->nseg > 0);
+}
+
+/* Thread task: generates trial torsion k of the segment */
+static void mc_regrow_task(void *data,int k,int thread)
+{
+  struct gmx_mc_regrow *regrow=(struct gmx_mc_regrow *)data;
+  gmx_mc_move *mc_move=regrow->mc_move;
+  int  s,nr,i,t0;
+
+  s  = regrow->seg;
+  nr = mc_move->end - mc_move->start;
+  for(i=0; i<nr; i++)
+    copy_rvec(regrow->xcur[i],regrow->xt[k][i]);
+  if (regrow->bOld && k == 0) {
+    /* Back to the torsion of the old configuration */
+    regrow->phi[k] = -regrow->dphi[s];
+  } else {
+    regrow->phi[k] = M_PI*(2.0*regrow->u[k] - 1.0);
+  }
+  t0 = regrow->tail_index[s];
+  mc_rotate_tail(regrow->xt[k],regrow->seg_a[2*s],regrow->seg_a[2*s+1],
+		 regrow->tail_index[s+1]-t0,regrow->tail+t0,regrow->phi[k]);
+}
+
+/* Thread task: evaluates block b of the trial torsions */
+static void mc_regrow_eval_task(void *data,int b,int thread)
+{
+  struct gmx_mc_regrow *regrow=(struct gmx_mc_regrow *)data;
+  int k0,k1;
+
+  mc_trial_block(regrow->ntrial,regrow->nblock,b,&k0,&k1);
+  trial_epot_mc_batch(regrow->mc_move,k0,k1,-1,
+		      regrow->fr,regrow->top,regrow->md,regrow->fcd,
+		      regrow->box,regrow->xprev,regrow->xt,regrow->lambda,
+		      regrow->dU);
+}
+
+/* Grows all segments starting from xcur, with the old torsions as
+ * the first trials when bOld is set. Returns the log of the Rosenbluth
+ * weight, the energy change of the final configuration is set in U.
+ */
+static double mc_regrow_grow(gmx_mc_regrow_t regrow,bool bOld,
+			     double beta,double *U)
+{
+  double lw,umin,sum,r;
+  int    nr,s,k,j,i;
+
+  nr = regrow->mc_move->end - regrow->mc_move->start;
+  regrow->bOld = bOld;
+  lw = 0;
+  for(s=0; s<regrow->nseg; s++) {
+    regrow->seg = s;
+    /* The torsions are keyed by the segment and the trial,
+     * the retrace uses the keys after those of the growth.
+     */
+    gmx_rng_cb_uniform_real_batch(&regrow->rng,regrow->step,regrow->ntrial,
+				  NULL,((bOld ? regrow->nseg : 0) + s)*
+				  regrow->ntrial,1,regrow->u);
+    gmx_thread_pool_run(regrow->pool,regrow->ntrial,mc_regrow_task,regrow);
+    gmx_thread_pool_run(regrow->pool,regrow->nblock,mc_regrow_eval_task,
+			regrow);
+
+    /* The weights are relative to the configuration grown up to now */
+    for(k=0; k<regrow->ntrial; k++)
+      regrow->dU[k] -= *U;
+    lw += mc_log_sum_weights(regrow->ntrial,regrow->dU,-1,FALSE,beta);
+
+    if (bOld) {
+      j = 0;
+    } else {
+      umin = regrow->dU[0];
+      for(k=1; k<regrow->ntrial; k++)
+	umin = min(umin,regrow->dU[k]);
+      sum = 0;
+      for(k=0; k<regrow->ntrial; k++)
+	sum += exp(-beta*(regrow->dU[k] - umin));
+      r = gmx_rng_cb_uniform_real(&regrow->srng)*sum;
+      j = 0;
+      sum = exp(-beta*(regrow->dU[0] - umin));
+      while (j < regrow->ntrial-1 && r >= sum) {
+	j++;
+	sum += exp(-beta*(regrow->dU[j] - umin));
+      }
+      regrow->dphi[s] = regrow->phi[j];
+    }
+    *U += regrow->dU[j];
+    for(i=0; i<nr; i++)
+      copy_rvec(regrow->xt[j][i],regrow->xcur[i]);
+  }
+
+  return lw;
+}
+
+real do_mc_regrow(gmx_mc_regrow_t regrow,
+		  gmx_enerdata_t *enerd,gmx_enerdata_t *enerd_prev,
+		  gmx_mc_move *mc_move,t_inputrec *ir,t_forcerec *fr,
+		  gmx_localtop_t *top,t_mdatoms *md,t_fcdata *fcd,
+		  t_graph *graph,gmx_step_t step,matrix box,
+		  rvec xprev[],rvec x[],real lambda)
+{
+  double kT,beta,U,lw_new,lw_old,dU;
+  int    nr,k,i;
+
+  if (!mc_regrow_segments(regrow,mc_move,graph)) {
+    /* The selected molecule does not have the regrowth entries */
+    mc_move->bias = 0;
+    return 0;
+  }
+
+  nr = mc_move->end - mc_move->start;
+  if (nr > regrow->nalloc) {
+    regrow->nalloc = over_alloc_small(nr);
+    for(k=0; k<regrow->ntrial; k++)
+      srenew(regrow->xt[k],regrow->nalloc);
+    srenew(regrow->xcur,regrow->nalloc);
+    srenew(regrow->xnew,regrow->nalloc);
+  }
+  regrow->step    = step;
+  regrow->mc_move = mc_move;
+  regrow->fr      = fr;
+  regrow->top     = top;
+  regrow->md      = md;
+  regrow->fcd     = fcd;
+  regrow->box     = box;
+  regrow->xprev   = xprev;
+  regrow->lambda  = lambda;
+
+  kT   = BOLTZ*ir->opts.ref_t[0];
+  beta = 1.0/kT;
+
+  /* Grow the new configuration from the old one */
+  gmx_rng_cb_restart(&regrow->srng,step,1);
+  for(i=0; i<nr; i++)
+    copy_rvec(xprev[mc_move->start+i],regrow->xcur[i]);
+  U = 0;
+  lw_new = mc_regrow_grow(regrow,FALSE,beta,&U);
+  for(i=0; i<nr; i++)
+    copy_rvec(regrow->xcur[i],regrow->xnew[i]);
+
+  /* Retrace the old configuration from the new one */
+  lw_old = mc_regrow_grow(regrow,TRUE,beta,&U);
+
+  for(i=0; i<nr; i++)
+    copy_rvec(regrow->xnew[i],x[mc_move->start+i]);
+  dU = trial_epot_mc(mc_move,0,fr,top,md,fcd,box,xprev,x,lambda);
+  set_enerd_mc(enerd,enerd_prev,mc_move,0);
+
+  /* accept_mc with this energy change accepts with probability
+   * min(1,exp(beta*dU)*W(new)/W(old)), the weights contain the
+   * Boltzmann factors of the energy increments.
+   */
+  return kT*(lw_old - lw_new) - dU;
+}
+
+void done_mc_regrow(gmx_mc_regrow_t regrow)
+{
+  int k;
+
+  gmx_thread_pool_done(regrow->pool);
+  for(k=0; k<regrow->ntrial; k++)
+    sfree(regrow->xt[k]);
+  sfree(regrow->u);
+  sfree(regrow->xt);
+  sfree(regrow->xcur);
+  sfree(regrow->xnew);
+  sfree(regrow->dU);
+  sfree(regrow->phi);
+  sfree(regrow->seg_a);
+  sfree(regrow->tail_index);
+  sfree(regrow->tail);
+  sfree(regrow->dphi);
+  sfree(regrow);
+}
+
+/* Hybrid MD/MC.
+ * Every ir->nstmc MD steps a sweep of single molecule moves is done on
+ * the current MD configuration with the incremental MC energies, which
+ * use the interaction settings of the MD force record. The velocities
+ * of rigidly rotated molecules are rotated around their center of mass
+ * velocity, which conserves the kinetic energy, so the acceptance only
+ * depends on the potential energy change.
+ * With domain decomposition each node moves its home molecules that
+ * are movable according to gmx_mc_dd, with rigid moves only, since
+ * the internal moves need the molecular graph.
+ */
+struct gmx_mc_hybrid {
+  gmx_mc_move    mc_move;
+  gmx_rng_cb_t   rng;           /* Restarted for each molecule            */
+  gmx_mc_dd_t    dd;            /* Domain decomposition, or NULL          */
+  int            nmol;          /* The total number of molecules          */
+  int            ngroup;
+  int            group[MC_NR];  /* The move groups in use                 */
+  int            nmoves;        /* Moves per sweep                        */
+  bool           *bInternal;    /* Internal moves apply to the molecule   */
+  rvec           *xprev;
+  gmx_enerdata_t *enerd;
+  gmx_enerdata_t *enerd_prev;
+  int            nac[MC_NR];
+  int            ntot[MC_NR];
+};
+
+gmx_mc_hybrid_t init_mc_hybrid(FILE *fplog,t_commrec *cr,t_inputrec *ir,
+			       t_forcerec *fr,gmx_mtop_t *mtop,
+			       gmx_localtop_t *top,t_mdatoms *md,matrix box,
+			       bool bConstr,gmx_mc_dd_t mdd)
+{
+  struct gmx_mc_hybrid *hyb;
+  gmx_mc_move *mv;
+  int  mb,m,i;
+
+  if (ir->nstmc <= 0)
+    return NULL;
+  if (PAR(cr) && !DOMAINDECOMP(cr))
+    gmx_fatal(FARGS,"Hybrid MD/MC in parallel requires domain decomposition");
+  if (ir->opts.ngtc == 0 || ir->opts.ref_t[0] <= 0)
+    gmx_fatal(FARGS,"Hybrid MD/MC requires a reference temperature");
+
+  snew(hyb,1);
+  hyb->dd   = mdd;
+  hyb->nmol = mtop->mols.nr;
+  mv = &hyb->mc_move;
+  snew(mv->group,MC_NR);
+  snew(mv->bNS,top->cgs.nr+1);
+  snew(mv->xcm,mtop->mols.nr);
+  mv->cgsnr  = top->cgs.nr;
+  mv->homenr = md->homenr;
+  mv->nthreads = mc_nthreads(ir,cr);
+  mv->group[MC_BONDS].ilist     = &mtop->moltype[0].mc_bonds;
+  mv->group[MC_ANGLES].ilist    = &mtop->moltype[0].mc_angles;
+  mv->group[MC_DIHEDRALS].ilist = &mtop->moltype[0].mc_dihedrals;
+  mv->group[MC_CRA].ilist       = &mtop->moltype[0].mc_cra;
+  mv->group[MC_REGROW].ilist    = &mtop->moltype[0].mc_regrow;
+  init_enerd_mc(fplog,mv,ir,fr,top,md,box);
+  if (!enerd_mc_incremental(mv))
+    gmx_fatal(FARGS,"Hybrid MD/MC requires incremental MC energies, "
+	      "see the log file for why these are not used");
+
+  if (ir->cm_translate > 0)
+    hyb->group[hyb->ngroup++] = MC_TRANSLATE;
+  if (ir->cm_rot > 0) {
+    hyb->group[hyb->ngroup++] = MC_ROTATEX;
+    hyb->group[hyb->ngroup++] = MC_ROTATEY;
+    hyb->group[hyb->ngroup++] = MC_ROTATEZ;
+  }
+  if (mdd) {
+    if (fplog)
+      fprintf(fplog,"\nWith domain decomposition hybrid MD/MC only does "
+	      "rigid molecule moves\n");
+  } else {
+    if (ir->dihedral_rot > 0 && mv->group[MC_DIHEDRALS].ilist->nr > 0)
+      hyb->group[hyb->ngroup++] = MC_DIHEDRALS;
+    if (mv->group[MC_CRA].ilist->nr > 0)
+      hyb->group[hyb->ngroup++] = MC_CRA;
+    /* Bond and angle moves would violate the constraints */
+    if (!bConstr) {
+      if (ir->bond_stretch > 0 && mv->group[MC_BONDS].ilist->nr > 0)
+	hyb->group[hyb->ngroup++] = MC_BONDS;
+      if (ir->angle_bend > 0 && mv->group[MC_ANGLES].ilist->nr > 0)
+	hyb->group[hyb->ngroup++] = MC_ANGLES;
+    }
+  }
+  if (hyb->ngroup == 0)
+    gmx_fatal(FARGS,"Hybrid MD/MC has no moves, set cm_translate, cm_rot "
+	      "or dihedral_rot or add MC move entries to the topology");
+
+  /* The internal move entries are those of the first molecule type */
+  snew(hyb->bInternal,mtop->mols.nr);
+  m = 0;
+  for(mb=0; mb<mtop->nmolblock; mb++)
+    for(i=0; i<mtop->molblock[mb].nmol; i++)
+      hyb->bInternal[m++] = (mtop->molblock[mb].type == 0);
+
+  hyb->nmoves = (ir->mc_nmoves > 0 ? ir->mc_nmoves : mtop->mols.nr);
+  gmx_rng_cb_init(&hyb->rng,ir->ld_seed,erngcbMCHYBRID);
+  /* With domain decomposition the buffer of mdd is used */
+  if (mdd == NULL)
+    snew(hyb->xprev,md->nr);
+  snew(hyb->enerd,1);
+  init_enerdata(mtop->groups.grps[egcENER].nr,ir->n_flambda,hyb->enerd);
+  snew(hyb->enerd_prev,1);
+  init_enerdata(mtop->groups.grps[egcENER].nr,ir->n_flambda,hyb->enerd_prev);
+
+  if (fplog)
+    fprintf(fplog,"\nHybrid MD/MC: a sweep of %d MC moves every %d steps\n",
+	    hyb->nmoves,ir->nstmc);
+
+  return hyb;
+}
+
+/* Sets up a random move of group grp for molecule m in mc_move,
+ * returns FALSE when the move does not apply to the molecule.
+ */
+static bool mc_hybrid_move(gmx_mc_hybrid_t hyb,t_inputrec *ir,
+			   t_block *mols,int m,int grp)
+{
+  gmx_mc_move  *mv=&hyb->mc_move;
+  gmx_rng_cb_t *rng=&hyb->rng;
+  t_ilist      *il;
+  real u[DIM];
+  int  j,d;
+
+  mv->mol     = m;
+  mv->start   = mols->index[m];
+  mv->end     = mols->index[m+1];
+  mv->nr      = mv->end - mv->start;
+  mv->mvgroup = grp;
+  mv->bias    = 1;
+  clear_rvec(mv->delta_x);
+  clear_rvec(mv->delta_phi);
+  if (mc_rigid_group(grp)) {
+    if (mv->nr == 1 && grp != MC_TRANSLATE)
+      return FALSE;
+    for(d=0; d<DIM; d++)
+      u[d] = gmx_rng_cb_uniform_real(rng);
+    mc_trial_delta(ir,grp,u,mv->delta_x,mv->delta_phi);
+    return TRUE;
+  }
+  if (mv->nr == 1 || !hyb->bInternal[m])
+    return FALSE;
+
+  /* The same distributions as in do_md */
+  il = mv->group[grp].ilist;
+  switch (grp) {
+  case MC_BONDS:
+    j = gmx_rng_cb_uniform_int(rng,il->nr/2);
+    set_mcmove(&mv->group[grp],rng,
+	       (2*gmx_rng_cb_uniform_real(rng)-1.0)*ir->bond_stretch,
+	       2,mv->start,j);
+    break;
+  case MC_ANGLES:
+    j = gmx_rng_cb_uniform_int(rng,il->nr/3);
+    set_mcmove(&mv->group[grp],rng,
+	       (2*gmx_rng_cb_uniform_real(rng)-1.0)*ir->angle_bend*M_PI/180.0,
+	       3,mv->start,j);
+    break;
+  case MC_DIHEDRALS:
+    j = gmx_rng_cb_uniform_int(rng,il->nr/2);
+    set_mcmove(&mv->group[grp],rng,
+	       (2*gmx_rng_cb_uniform_real(rng)-1.0)*ir->dihedral_rot*M_PI/180.0,
+	       2,mv->start,j);
+    break;
+  default:
+    break;
+  }
+
+  return TRUE;
+}
+
+real do_mc_hybrid(gmx_mc_hybrid_t hyb,FILE *fplog,t_inputrec *ir,
+		  t_forcerec *fr,gmx_localtop_t *top,t_block *mols,
+		  t_mdatoms *md,t_fcdata *fcd,t_graph *graph,gmx_step_t step,
+		  matrix box,rvec x[],rvec v[],real lambda)
+{
+  gmx_mc_move    *mv=&hyb->mc_move;
+  gmx_enerdata_t *enerd;
+  rvec   *xprev,dx0,com;
+  double beta,dU,prob,dUsum,nper;
+  int    nm,n,m,grp,i;
+  bool   bAccept;
+
+  beta = 1.0/(BOLTZ*ir->opts.ref_t[0]);
+  clear_rvec(dx0);
+
+  if (hyb->dd) {
+    /* The home molecules are made whole by mc_dd_set_local */
+    mc_dd_set_local(hyb->dd,mv,fr,top,md,box,x);
+    mols  = mc_dd_mols(hyb->dd);
+    xprev = mc_dd_xprev(hyb->dd);
+  } else {
+    /* The internal moves need whole molecules */
+    if (graph) {
+      mk_mshift(fplog,graph,fr->ePBC,box,x);
+      shift_self(graph,box,x);
+    }
+    xprev = hyb->xprev;
+    for(i=0; i<md->nr; i++)
+      copy_rvec(x[i],xprev[i]);
+    reset_enerd_mc(mv,fr,top,md,box,x);
+  }
+
+  /* Each molecule gets nmoves/nmol moves on average. The numbers of
+   * a molecule are drawn from a stream keyed by the step and its global
+   * index, so they do not depend on the decomposition or on the moves
+   * of other molecules.
+   */
+  nper  = (double)hyb->nmoves/hyb->nmol;
+  dUsum = 0;
+  for(m=0; m<mols->nr; m++) {
+    gmx_rng_cb_restart(&hyb->rng,step,hyb->dd ? hyb->dd->mol_gl[m] : m);
+    nm = (int)(nper + gmx_rng_cb_uniform_real(&hyb->rng));
+    if (nm > 0 && hyb->dd) {
+      mc_com(mols->index[m+1]-mols->index[m],x+mols->index[m],
+	     md->massT+mols->index[m],com);
+      if (!mc_dd_movable(hyb->dd,com))
+	continue;
+    }
+    for(n=0; n<nm; n++) {
+      grp = hyb->group[min(hyb->ngroup-1,
+			   (int)(gmx_rng_cb_uniform_real(&hyb->rng)*
+				 hyb->ngroup))];
+      if (!mc_hybrid_move(hyb,ir,mols,m,grp))
+	continue;
+
+      update_mc_move(x,box,md->massT,mv,graph,&hyb->rng,md->homenr);
+      bAccept = TRUE;
+      if (hyb->dd) {
+	/* The molecule should stay in the region of movable molecules */
+	mc_com(mv->nr,x+mv->start,md->massT+mv->start,com);
+	bAccept = mc_dd_movable(hyb->dd,com);
+      }
+      if (bAccept) {
+	dU = delta_enerd_mc(hyb->enerd,hyb->enerd_prev,mv,fr,top,md,fcd,box,
+			    xprev,x,lambda);
+	/* As in accept_mc, the bias applies to downhill moves as well */
+	prob    = (mv->bias == 0 ? 0 : min(1,mv->bias*exp(-beta*dU)));
+	bAccept = (prob >= 1 || gmx_rng_cb_uniform_real(&hyb->rng) < prob);
+      }
+      if (bAccept) {
+	commit_enerd_mc(mv,top);
+	enerd           = hyb->enerd_prev;
+	hyb->enerd_prev = hyb->enerd;
+	hyb->enerd      = enerd;
+	if (v && grp != MC_TRANSLATE && mc_rigid_group(grp))
+	  update_mc_rigid(mv->nr,v+mv->start,md->massT+mv->start,grp,
+			  dx0,mv->delta_phi);
+	for(i=mv->start; i<mv->end; i++)
+	  copy_rvec(x[i],xprev[i]);
+	dUsum += dU;
+	hyb->nac[grp]++;
+      } else {
+	for(i=mv->start; i<mv->end; i++)
+	  copy_rvec(xprev[i],x[i]);
+      }
+      hyb->ntot[grp]++;
+    }
+  }
+
+  if (hyb->dd)
+    gmx_sumd(1,&dUsum,hyb->dd->cr);
+  else if (graph)
+    unshift_self(graph,box,x);
+
+  return dUsum;
+}
+
+void done_mc_hybrid(FILE *fplog,gmx_mc_hybrid_t hyb)
+{
+  if (hyb->dd) {
+    gmx_sumi(MC_NR,hyb->nac,hyb->dd->cr);
+    gmx_sumi(MC_NR,hyb->ntot,hyb->dd->cr);
+  }
+  if (fplog) {
+    fprintf(fplog,"\nHybrid MD/MC moves:\n");
+    print_mc_ratio(fplog,hyb->nac,hyb->ntot,0,0);
+  }
+  sfree(hyb->mc_move.group);
+  sfree(hyb->mc_move.bNS);
+  sfree(hyb->mc_move.xcm);
+  sfree(hyb->bInternal);
+  sfree(hyb->xprev);
+  sfree(hyb);
+}
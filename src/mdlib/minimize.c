@@ -81,6 +81,7 @@
 #include "mtop_util.h"
 #include "gmxfio.h"
 #include "pme.h"
+#include "nonbonded.h"
 
 typedef struct {
   t_state s;
@@ -2421,6 +2422,55 @@ static void global_max(t_commrec *cr,int *n)
   sfree(sum);
 }
 
+static void insert_tpi_conf(gmx_rng_t rng,rvec x_init,real drmax,
+                            bool bDisplace,int nat,rvec *x_mol,
+                            rvec *x,rvec x_tp)
+{
+    rvec dx;
+    int  i;
+
+    if (bDisplace)
+    {
+        /* Generate coordinates within |dx|=drmax of x_init */
+        do
+        {
+            dx[XX] = (2*gmx_rng_uniform_real(rng) - 1)*drmax;
+            dx[YY] = (2*gmx_rng_uniform_real(rng) - 1)*drmax;
+            dx[ZZ] = (2*gmx_rng_uniform_real(rng) - 1)*drmax;
+        }
+        while (norm2(dx) > drmax*drmax);
+        rvec_add(x_init,dx,x_tp);
+    }
+    else
+    {
+        copy_rvec(x_init,x_tp);
+    }
+
+    if (nat == 1)
+    {
+        /* Insert a single atom, just copy the insertion location */
+        copy_rvec(x_tp,x[0]);
+    }
+    else
+    {
+        /* Copy the coordinates from the top file */
+        for(i=0; i<nat; i++)
+        {
+            copy_rvec(x_mol[i],x[i]);
+        }
+        /* Rotate the molecule randomly */
+        rotate_conf(nat,x,NULL,
+                    2*M_PI*gmx_rng_uniform_real(rng),
+                    2*M_PI*gmx_rng_uniform_real(rng),
+                    2*M_PI*gmx_rng_uniform_real(rng));
+        /* Shift to the insertion location */
+        for(i=0; i<nat; i++)
+        {
+            rvec_inc(x[i],x_tp);
+        }
+    }
+}
+
 static void realloc_bins(double **bin,int *nbin,int nbin_new)
 {
   int i;
@@ -2463,7 +2513,7 @@ double do_tpi(FILE *fplog,t_commrec *cr,
   tensor force_vir,shake_vir,vir,pres;
   int    cg_tp,a_tp0,a_tp1,ngid,gid_tp,nener,e;
   rvec   *x_mol;
-  rvec   mu_tot,x_init,dx,x_tp;
+  rvec   mu_tot,x_init,x_tp;
   int    nnodes,frame,nsteps,step;
   int    i,start,end;
   gmx_rng_t tpi_rand;
@@ -2476,6 +2526,12 @@ double do_tpi(FILE *fplog,t_commrec *cr,
   int    nbin;
   double invbinw,*bin,refvolshift,logV,bUlogV;
   const char *tpid_leg[2]={"direct","reweighted"};
+  bool   bBatch,bBatchNL=FALSE,bBatchStep;
+  int    nbatch=0,b;
+  rvec   *x_batch=NULL,*xtp_batch=NULL;
+  real   *Vc_batch=NULL,*Vvdw_batch=NULL,*egc_batch=NULL,*egnb_batch=NULL;
+  real   term_batch[F_NRE],dvc,dvnb,vrecip;
+  int    egnb;
 
   /* Since numerical problems can lead to extreme negative energies
    * when atoms overlap, we need to set a lower limit for beta*U.
@@ -2634,6 +2690,33 @@ double do_tpi(FILE *fplog,t_commrec *cr,
 
   ngid = groups->grps[egcENER].nr;
   gid_tp = GET_CGINFO_GID(fr->cginfo[cg_tp]);
+  egnb = (fr->bBHAM ? egBHAMSR : egLJSR);
+
+    /* With a re-used neighborlist the energies of all insertions
+     * in a sphere can be computed in one pass by the batch kernel.
+     * With PME the mesh energy of each insertion is computed
+     * separately with the grid potential of the frame.
+     */
+    bBatch = (!bCavity && inputrec->nstlist > 1 &&
+              (!EEL_FULL(fr->eeltype) || EEL_PME(fr->eeltype)) &&
+              inputrec->efep == efepNO &&
+              inputrec->implicit_solvent == eisNO &&
+              inputrec->rlist >= inputrec->rcoulomb &&
+              inputrec->rlist >= inputrec->rvdw &&
+              getenv("GMX_TPI_NO_BATCH") == NULL);
+    if (bBatch)
+    {
+        if (fplog)
+        {
+            fprintf(fplog,"Will compute the energies of the insertions with the same neighborlist in batches\n");
+        }
+        snew(x_batch,inputrec->nstlist*(a_tp1-a_tp0));
+        snew(xtp_batch,inputrec->nstlist);
+        snew(Vc_batch,inputrec->nstlist*enerd->grpp.nener);
+        snew(Vvdw_batch,inputrec->nstlist*enerd->grpp.nener);
+        snew(egc_batch,ngid);
+        snew(egnb_batch,ngid);
+    }
   nener = 1 + ngid;
   if (bDispCorr)
     nener += 1;
@@ -2755,21 +2838,32 @@ double do_tpi(FILE *fplog,t_commrec *cr,
                     x_init[YY] = gmx_rng_uniform_real(tpi_rand)*state->box[YY][YY];
                     x_init[ZZ] = gmx_rng_uniform_real(tpi_rand)*state->box[ZZ][ZZ];
                 }
-                if (inputrec->nstlist == 1)
+                if (bBatch)
                 {
-                    copy_rvec(x_init,x_tp);
+                    if (bNS)
+                    {
+                        /* Generate all insertions for this neighborlist */
+                        nbatch = min(inputrec->nstlist,nsteps - step);
+                        for(b=0; b<nbatch; b++)
+                        {
+                            insert_tpi_conf(tpi_rand,x_init,drmax,TRUE,
+                                            a_tp1-a_tp0,x_mol,
+                                            x_batch+b*(a_tp1-a_tp0),
+                                            xtp_batch[b]);
+                        }
+                    }
+                    b = step % inputrec->nstlist;
+                    for(i=a_tp0; i<a_tp1; i++)
+                    {
+                        copy_rvec(x_batch[b*(a_tp1-a_tp0)+i-a_tp0],state->x[i]);
+                    }
+                    copy_rvec(xtp_batch[b],x_tp);
                 }
                 else
                 {
-                    /* Generate coordinates within |dx|=drmax of x_init */
-                    do
-                    {
-                        dx[XX] = (2*gmx_rng_uniform_real(tpi_rand) - 1)*drmax;
-                        dx[YY] = (2*gmx_rng_uniform_real(tpi_rand) - 1)*drmax;
-                        dx[ZZ] = (2*gmx_rng_uniform_real(tpi_rand) - 1)*drmax;
-                    }
-                    while (norm2(dx) > drmax*drmax);
-                    rvec_add(x_init,dx,x_tp);
+                    insert_tpi_conf(tpi_rand,x_init,drmax,
+                                    inputrec->nstlist > 1,
+                                    a_tp1-a_tp0,x_mol,state->x+a_tp0,x_tp);
                 }
             }
             else
@@ -2804,39 +2898,8 @@ double do_tpi(FILE *fplog,t_commrec *cr,
                         }
                     }
                 }
-                /* Generate coordinates within |dx|=drmax of x_init */
-                do
-                {
-                    dx[XX] = (2*gmx_rng_uniform_real(tpi_rand) - 1)*drmax;
-                    dx[YY] = (2*gmx_rng_uniform_real(tpi_rand) - 1)*drmax;
-                    dx[ZZ] = (2*gmx_rng_uniform_real(tpi_rand) - 1)*drmax;
-                }
-                while (norm2(dx) > drmax*drmax);
-                rvec_add(x_init,dx,x_tp);
-            }
-            
-            if (a_tp1 - a_tp0 == 1)
-            {
-                /* Insert a single atom, just copy the insertion location */
-	copy_rvec(x_tp,state->x[a_tp0]);
-            }
-            else
-            {
-                /* Copy the coordinates from the top file */
-                for(i=a_tp0; i<a_tp1; i++)
-                {
-                    copy_rvec(x_mol[i-a_tp0],state->x[i]);
-                }
-                /* Rotate the molecule randomly */
-                rotate_conf(a_tp1-a_tp0,state->x+a_tp0,NULL,
-                            2*M_PI*gmx_rng_uniform_real(tpi_rand),
-                            2*M_PI*gmx_rng_uniform_real(tpi_rand),
-                            2*M_PI*gmx_rng_uniform_real(tpi_rand));
-                /* Shift to the insertion location */
-                for(i=a_tp0; i<a_tp1; i++)
-                {
-                    rvec_inc(state->x[i],x_tp);
-                }
+                insert_tpi_conf(tpi_rand,x_init,drmax,TRUE,
+                                a_tp1-a_tp0,x_mol,state->x+a_tp0,x_tp);
             }
             
             /* Check if this insertion belongs to this node */
@@ -2877,19 +2940,75 @@ double do_tpi(FILE *fplog,t_commrec *cr,
                  * twin-range interactions together with nstlist > 1,
                  * therefore we do not need to remember the LR energies.
                  */
-                /* Make do_force do a single node force calculation */
-                cr->nnodes = 1;
-                do_force(fplog,cr,inputrec,
-                         step,nrnb,wcycle,top,top_global,&top_global->groups,
-                         rerun_fr.box,state->x,&state->hist,NULL,
-                         f,force_vir,mdatoms,enerd,fcd,
-                         lambda,NULL,fr,NULL,mu_tot,t,NULL,NULL,FALSE,
-                         GMX_FORCE_NONBONDED |
-                         (bNS ? GMX_FORCE_NS | GMX_FORCE_DOLR : 0) |
-                         (bStateChanged ? GMX_FORCE_STATECHANGED : 0)); 
-                cr->nnodes = nnodes;
-                bStateChanged = FALSE;
-                bNS = FALSE;
+                bBatchStep = (bBatch && bBatchNL && !bNS);
+                if (bBatchStep)
+                {
+                    /* Correct the energies of the first insertion
+                     * with the batch kernel energy differences.
+                     */
+                    b = step % inputrec->nstlist;
+                    for(e=0; e<F_NRE; e++)
+                    {
+                        enerd->term[e] = term_batch[e];
+                    }
+                    for(i=0; i<ngid; i++)
+                    {
+                        e    = GID(i,gid_tp,ngid);
+                        dvc  = Vc_batch[b*enerd->grpp.nener+e]   - Vc_batch[e];
+                        dvnb = Vvdw_batch[b*enerd->grpp.nener+e] - Vvdw_batch[e];
+                        enerd->grpp.ener[egCOULSR][e] = egc_batch[i]  + dvc;
+                        enerd->grpp.ener[egnb][e]     = egnb_batch[i] + dvnb;
+                        enerd->term[F_COUL_SR] += dvc;
+                        enerd->term[fr->bBHAM ? F_BHAM : F_LJ] += dvnb;
+                        enerd->term[F_EPOT]    += dvc + dvnb;
+                    }
+                    if (EEL_PME(fr->eeltype))
+                    {
+                        gmx_pme_calc_energy(fr->pmedata,a_tp1-a_tp0,
+                                            state->x+a_tp0,
+                                            mdatoms->chargeA+a_tp0,&vrecip);
+                        enerd->term[F_EPOT] +=
+                            vrecip - enerd->term[F_COUL_RECIP];
+                        enerd->term[F_COUL_RECIP] = vrecip;
+                    }
+                }
+                else
+                {
+                    /* Make do_force do a single node force calculation */
+                    cr->nnodes = 1;
+                    do_force(fplog,cr,inputrec,
+                             step,nrnb,wcycle,top,top_global,&top_global->groups,
+                             rerun_fr.box,state->x,&state->hist,NULL,
+                             f,force_vir,mdatoms,enerd,fcd,
+                             lambda,NULL,fr,NULL,mu_tot,t,NULL,NULL,FALSE,
+                             GMX_FORCE_NONBONDED |
+                             (bNS ? GMX_FORCE_NS | GMX_FORCE_DOLR : 0) |
+                             (bStateChanged ? GMX_FORCE_STATECHANGED : 0)); 
+                    cr->nnodes = nnodes;
+                    bStateChanged = FALSE;
+
+                    if (bBatch && bNS)
+                    {
+                        /* Compute the energies of all insertions
+                         * with this neighborlist in one pass.
+                         */
+                        bBatchNL = do_nonbonded_batch(fr,state->x,mdatoms,
+                                                      a_tp0,a_tp1-a_tp0,
+                                                      nbatch,x_batch,
+                                                      enerd->grpp.nener,
+                                                      Vc_batch,Vvdw_batch);
+                        for(e=0; e<F_NRE; e++)
+                        {
+                            term_batch[e] = enerd->term[e];
+                        }
+                        for(i=0; i<ngid; i++)
+                        {
+                            egc_batch[i]  = enerd->grpp.ener[egCOULSR][GID(i,gid_tp,ngid)];
+                            egnb_batch[i] = enerd->grpp.ener[egnb][GID(i,gid_tp,ngid)];
+                        }
+                    }
+                    bNS = FALSE;
+                }
                 
                 /* Calculate long range corrections to pressure and energy */
                 calc_dispcorr(fplog,inputrec,fr,step,mdatoms->nr,rerun_fr.box,
@@ -3065,6 +3184,15 @@ double do_tpi(FILE *fplog,t_commrec *cr,
   sfree(bin);
 
   sfree(sum_UgembU);
+  if (bBatch)
+  {
+      sfree(x_batch);
+      sfree(xtp_batch);
+      sfree(Vc_batch);
+      sfree(Vvdw_batch);
+      sfree(egc_batch);
+      sfree(egnb_batch);
+  }
 
   runtime->nsteps_done = frame*inputrec->nsteps;
   
@@ -0,0 +1,174 @@
+/*
+ * 
+ *                This source code is part of
+ * 
+ *                 G   R   O   M   A   C   S
+ * 
+ *          GROningen MAchine for Chemical Simulations
+ * 
+ *                        VERSION 3.2.0
+ * Written by David van der Spoel, Erik Lindahl, Berk Hess, and others.
+ * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
+ * Copyright (c) 2001-2004, The GROMACS development team,
+ * check out http://www.gromacs.org for more information.
+
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * If you want to redistribute modifications, please consider that
+ * scientific software is very special. Version control is crucial -
+ * bugs must be traceable. We will be happy to consider code for
+ * inclusion in the official distribution, but derived work must not
+ * be called official GROMACS. Details are found in the README & COPYING
+ * files - if they are missing, get the official version at www.gromacs.org.
+ * 
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the papers on the package - you can find them in the top README file.
+ * 
+ * For more info, check our website at http://www.gromacs.org
+ * 
+ * And Hey:
+ * Gromacs Runs On Most of All Computer Systems
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+
+#include "typedefs.h"
+#include "vec.h"
+#include "nbnxn.h"
+
+#define CS NBNXN_CLUSTER_SIZE
+
+/* The plain C reference kernel for the cluster-pair lists,
+ * computes all atom pairs of each cluster pair one by one.
+ */
+void nbnxn_kernel_ref(const nbnxn_pairlist_t *nbl,
+		      nbnxn_atomdata_t *nbat,const nbnxn_param_t *p,
+		      rvec *shift_vec,rvec fshift[],
+		      real *Vc,real *Vvdw)
+{
+  const nbnxn_ci_t *ciEntry;
+  const real *xq,*xj,*nbfp,*nbfp_i;
+  const int  *type;
+  real *f,*fj;
+  unsigned int excl;
+  int  n,k,i,j,ci,cj,ish,ntype,n0,nnn;
+  real xi[CS],yi[CS],zi[CS],qi[CS],fix[CS],fiy[CS],fiz[CS];
+  real dx,dy,dz,rsq,rinv,rinvsq,rinvsix,qq,c6,c12;
+  real vcoul,fcoul,Vvdw6,Vvdw12,fscal,tx,ty,tz;
+  real r,rt,eps,eps2,Y,F,Geps,Heps2,Fp,VV,FF;
+  real vctot,Vvdwtot,vci,Vvdwci;
+
+  xq    = nbat->xq;
+  f     = nbat->f;
+  type  = nbat->type;
+  nbfp  = nbat->nbfp;
+  ntype = nbat->ntype;
+
+  vctot   = 0;
+  Vvdwtot = 0;
+
+  for(n=0; n<nbl->nci; n++) {
+    ciEntry = &nbl->ci[n];
+    ci      = ciEntry->ci;
+    ish     = ciEntry->shift;
+    for(i=0; i<CS; i++) {
+      xi[i]  = xq[ci*4*CS +      i] + shift_vec[ish][XX];
+      yi[i]  = xq[ci*4*CS +   CS+i] + shift_vec[ish][YY];
+      zi[i]  = xq[ci*4*CS + 2*CS+i] + shift_vec[ish][ZZ];
+      qi[i]  = p->epsfac*xq[ci*4*CS + 3*CS+i];
+      fix[i] = 0;
+      fiy[i] = 0;
+      fiz[i] = 0;
+    }
+    /* Sum the energies per i-entry to limit the round-off */
+    vci    = 0;
+    Vvdwci = 0;
+
+    for(k=ciEntry->cj_ind_start; k<ciEntry->cj_ind_end; k++) {
+      cj   = nbl->cj[k].cj;
+      excl = nbl->cj[k].excl;
+      xj   = xq + cj*4*CS;
+      fj   = f  + cj*DIM*CS;
+
+      for(i=0; i<CS; i++) {
+	nbfp_i = nbfp + 2*ntype*type[ci*CS+i];
+	for(j=0; j<CS; j++) {
+	  if (!(excl & (1U << (i*CS + j))))
+	    continue;
+
+	  dx  = xi[i] - xj[     j];
+	  dy  = yi[i] - xj[  CS+j];
+	  dz  = zi[i] - xj[2*CS+j];
+	  rsq = dx*dx + dy*dy + dz*dz;
+	  if (rsq >= p->rcut2)
+	    continue;
+
+	  rinv   = invsqrt(rsq);
+	  rinvsq = rinv*rinv;
+	  qq     = qi[i]*xj[3*CS+j];
+
+	  if (p->eeltype == enbnxnelTAB) {
+	    r      = rsq*rinv;
+	    rt     = r*p->tabscale;
+	    n0     = rt;
+	    eps    = rt - n0;
+	    eps2   = eps*eps;
+	    nnn    = 4*n0;
+	    Y      = p->tab[nnn];
+	    F      = p->tab[nnn+1];
+	    Geps   = eps*p->tab[nnn+2];
+	    Heps2  = eps2*p->tab[nnn+3];
+	    Fp     = F + Geps + Heps2;
+	    VV     = Y + eps*Fp;
+	    FF     = Fp + Geps + 2.0*Heps2;
+	    vcoul  = qq*VV;
+	    fcoul  = -qq*FF*p->tabscale*rinv;
+	  } else {
+	    vcoul  = qq*(rinv + p->k_rf*rsq - p->c_rf);
+	    fcoul  = qq*(rinv - 2.0*p->k_rf*rsq)*rinvsq;
+	  }
+
+	  c6      = nbfp_i[2*type[cj*CS+j]];
+	  c12     = nbfp_i[2*type[cj*CS+j]+1];
+	  rinvsix = rinvsq*rinvsq*rinvsq;
+	  Vvdw6   = c6*rinvsix;
+	  Vvdw12  = c12*rinvsix*rinvsix;
+
+	  vci     += vcoul;
+	  Vvdwci  += Vvdw12 - Vvdw6;
+	  fscal    = (12.0*Vvdw12 - 6.0*Vvdw6)*rinvsq + fcoul;
+
+	  tx      = fscal*dx;
+	  ty      = fscal*dy;
+	  tz      = fscal*dz;
+	  fix[i] += tx;
+	  fiy[i] += ty;
+	  fiz[i] += tz;
+	  fj[     j] -= tx;
+	  fj[  CS+j] -= ty;
+	  fj[2*CS+j] -= tz;
+	}
+      }
+    }
+
+    for(i=0; i<CS; i++) {
+      f[ci*DIM*CS +      i] += fix[i];
+      f[ci*DIM*CS +   CS+i] += fiy[i];
+      f[ci*DIM*CS + 2*CS+i] += fiz[i];
+      fshift[ish][XX] += fix[i];
+      fshift[ish][YY] += fiy[i];
+      fshift[ish][ZZ] += fiz[i];
+    }
+    vctot   += vci;
+    Vvdwtot += Vvdwci;
+  }
+
+  *Vc   += vctot;
+  *Vvdw += Vvdwtot;
+}
@@ -0,0 +1,248 @@
+/*
+ * 
+ *                This source code is part of
+ * 
+ *                 G   R   O   M   A   C   S
+ * 
+ *          GROningen MAchine for Chemical Simulations
+ * 
+ *                        VERSION 3.2.0
+ * Written by David van der Spoel, Erik Lindahl, Berk Hess, and others.
+ * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
+ * Copyright (c) 2001-2004, The GROMACS development team,
+ * check out http://www.gromacs.org for more information.
+
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * If you want to redistribute modifications, please consider that
+ * scientific software is very special. Version control is crucial -
+ * bugs must be traceable. We will be happy to consider code for
+ * inclusion in the official distribution, but derived work must not
+ * be called official GROMACS. Details are found in the README & COPYING
+ * files - if they are missing, get the official version at www.gromacs.org.
+ * 
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the papers on the package - you can find them in the top README file.
+ * 
+ * For more info, check our website at http://www.gromacs.org
+ * 
+ * And Hey:
+ * Gromacs Runs On Most of All Computer Systems
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "typedefs.h"
+#include "nbnxn.h"
+
+#if (defined(GMX_SSE2) && !defined(GMX_DOUBLE))
+
+#include <emmintrin.h>
+
+#define CS NBNXN_CLUSTER_SIZE
+
+static inline float hsum_ps(__m128 x)
+{
+  x = _mm_add_ps(x,_mm_movehl_ps(x,x));
+  x = _mm_add_ss(x,_mm_shuffle_ps(x,x,_MM_SHUFFLE(1,1,1,1)));
+
+  return _mm_cvtss_f32(x);
+}
+
+/* The SSE2 kernel for the cluster-pair lists. The four atoms of
+ * a j-cluster are stored contiguously, so they are loaded as one
+ * vector without gather. Each i-atom is broadcast and interacts with
+ * the four j-atoms at once. The cut-off and exclusions are applied
+ * with masks, masked pairs have rinv = 0.
+ */
+void nbnxn_kernel_sse2(const nbnxn_pairlist_t *nbl,
+		       nbnxn_atomdata_t *nbat,const nbnxn_param_t *p,
+		       rvec *shift_vec,rvec fshift[],
+		       real *Vc,real *Vvdw)
+{
+  const nbnxn_ci_t *ciEntry;
+  const float *xq,*xj,*nbfp,*nbfp_i[CS];
+  const int   *type,*tj;
+  float *f,*fj;
+  unsigned int excl,excl_i;
+  int    n,k,i,m,ci,cj,ish,ntype;
+  int    idx[4];
+  __m128 mask_tab[16];
+  __m128 ix[CS],iy[CS],iz[CS],iq[CS],fix[CS],fiy[CS],fiz[CS];
+  __m128 jx,jy,jz,jq,fjx,fjy,fjz;
+  __m128 dx,dy,dz,rsq,wco,rinv,rinvsq,rinvsix,qq,vcoul,fcoul;
+  __m128 c6,c12,Vvdw6,Vvdw12,fscal;
+  __m128 r,rt,eps,eps2,Y,F,G,H,Geps,Heps2,Fp,VV,FF;
+  __m128 rc2,k_rf,c_rf,two_k_rf,tabscale,half,three,six,twelve;
+  __m128 vci,Vvdwci,fsx,fsy,fsz;
+  float  vctot,Vvdwtot;
+  __m128i n0;
+
+  xq    = nbat->xq;
+  f     = nbat->f;
+  type  = nbat->type;
+  nbfp  = nbat->nbfp;
+  ntype = nbat->ntype;
+
+  /* Lane j of mask_tab[m] is set when bit j of m is set */
+  for(m=0; m<16; m++) {
+    mask_tab[m] = _mm_castsi128_ps(_mm_set_epi32((m & 8) ? -1 : 0,
+						 (m & 4) ? -1 : 0,
+						 (m & 2) ? -1 : 0,
+						 (m & 1) ? -1 : 0));
+  }
+
+  rc2      = _mm_set1_ps(p->rcut2);
+  k_rf     = _mm_set1_ps(p->k_rf);
+  c_rf     = _mm_set1_ps(p->c_rf);
+  two_k_rf = _mm_set1_ps(2*p->k_rf);
+  tabscale = _mm_set1_ps(p->tabscale);
+  half     = _mm_set1_ps(0.5);
+  three    = _mm_set1_ps(3.0);
+  six      = _mm_set1_ps(6.0);
+  twelve   = _mm_set1_ps(12.0);
+
+  vctot    = 0;
+  Vvdwtot  = 0;
+
+  for(n=0; n<nbl->nci; n++) {
+    ciEntry = &nbl->ci[n];
+    ci      = ciEntry->ci;
+    ish     = ciEntry->shift;
+    for(i=0; i<CS; i++) {
+      ix[i]     = _mm_set1_ps(xq[ci*4*CS +      i] + shift_vec[ish][XX]);
+      iy[i]     = _mm_set1_ps(xq[ci*4*CS +   CS+i] + shift_vec[ish][YY]);
+      iz[i]     = _mm_set1_ps(xq[ci*4*CS + 2*CS+i] + shift_vec[ish][ZZ]);
+      iq[i]     = _mm_set1_ps(p->epsfac*xq[ci*4*CS + 3*CS+i]);
+      nbfp_i[i] = nbfp + 2*ntype*type[ci*CS+i];
+      fix[i]    = _mm_setzero_ps();
+      fiy[i]    = _mm_setzero_ps();
+      fiz[i]    = _mm_setzero_ps();
+    }
+    vci    = _mm_setzero_ps();
+    Vvdwci = _mm_setzero_ps();
+
+    for(k=ciEntry->cj_ind_start; k<ciEntry->cj_ind_end; k++) {
+      cj   = nbl->cj[k].cj;
+      excl = nbl->cj[k].excl;
+      xj   = xq + cj*4*CS;
+      fj   = f  + cj*DIM*CS;
+      tj   = type + cj*CS;
+
+      jx   = _mm_load_ps(xj);
+      jy   = _mm_load_ps(xj +   CS);
+      jz   = _mm_load_ps(xj + 2*CS);
+      jq   = _mm_load_ps(xj + 3*CS);
+      fjx  = _mm_setzero_ps();
+      fjy  = _mm_setzero_ps();
+      fjz  = _mm_setzero_ps();
+
+      for(i=0; i<CS; i++) {
+	excl_i = (excl >> (i*CS)) & 0xF;
+	if (excl_i == 0)
+	  continue;
+
+	dx     = _mm_sub_ps(ix[i],jx);
+	dy     = _mm_sub_ps(iy[i],jy);
+	dz     = _mm_sub_ps(iz[i],jz);
+	rsq    = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx,dx),_mm_mul_ps(dy,dy)),
+			    _mm_mul_ps(dz,dz));
+	wco    = _mm_and_ps(mask_tab[excl_i],_mm_cmplt_ps(rsq,rc2));
+
+	/* 1/sqrt with one Newton-Raphson iteration */
+	rinv   = _mm_rsqrt_ps(rsq);
+	rinv   = _mm_mul_ps(_mm_mul_ps(half,rinv),
+			    _mm_sub_ps(three,_mm_mul_ps(_mm_mul_ps(rsq,rinv),rinv)));
+	rinv   = _mm_and_ps(wco,rinv);
+	rinvsq = _mm_mul_ps(rinv,rinv);
+	qq     = _mm_mul_ps(iq[i],jq);
+
+	if (p->eeltype == enbnxnelTAB) {
+	  r     = _mm_mul_ps(rsq,rinv);
+	  rt    = _mm_mul_ps(r,tabscale);
+	  n0    = _mm_cvttps_epi32(rt);
+	  eps   = _mm_sub_ps(rt,_mm_cvtepi32_ps(n0));
+	  eps2  = _mm_mul_ps(eps,eps);
+	  _mm_storeu_si128((__m128i *)idx,_mm_slli_epi32(n0,2));
+	  Y     = _mm_load_ps(p->tab + idx[0]);
+	  F     = _mm_load_ps(p->tab + idx[1]);
+	  G     = _mm_load_ps(p->tab + idx[2]);
+	  H     = _mm_load_ps(p->tab + idx[3]);
+	  _MM_TRANSPOSE4_PS(Y,F,G,H);
+	  Geps  = _mm_mul_ps(eps,G);
+	  Heps2 = _mm_mul_ps(eps2,H);
+	  Fp    = _mm_add_ps(_mm_add_ps(F,Geps),Heps2);
+	  VV    = _mm_add_ps(Y,_mm_mul_ps(eps,Fp));
+	  FF    = _mm_add_ps(_mm_add_ps(Fp,Geps),_mm_add_ps(Heps2,Heps2));
+	  vcoul = _mm_and_ps(wco,_mm_mul_ps(qq,VV));
+	  fcoul = _mm_mul_ps(_mm_mul_ps(qq,FF),_mm_mul_ps(tabscale,rinv));
+	  fcoul = _mm_sub_ps(_mm_setzero_ps(),fcoul);
+	} else {
+	  vcoul = _mm_add_ps(rinv,
+			     _mm_and_ps(wco,_mm_sub_ps(_mm_mul_ps(k_rf,rsq),c_rf)));
+	  vcoul = _mm_mul_ps(qq,vcoul);
+	  fcoul = _mm_sub_ps(rinv,_mm_mul_ps(two_k_rf,rsq));
+	  fcoul = _mm_mul_ps(_mm_mul_ps(qq,fcoul),rinvsq);
+	}
+
+	c6      = _mm_setr_ps(nbfp_i[i][2*tj[0]],nbfp_i[i][2*tj[1]],
+			      nbfp_i[i][2*tj[2]],nbfp_i[i][2*tj[3]]);
+	c12     = _mm_setr_ps(nbfp_i[i][2*tj[0]+1],nbfp_i[i][2*tj[1]+1],
+			      nbfp_i[i][2*tj[2]+1],nbfp_i[i][2*tj[3]+1]);
+	rinvsix = _mm_mul_ps(_mm_mul_ps(rinvsq,rinvsq),rinvsq);
+	Vvdw6   = _mm_mul_ps(c6,rinvsix);
+	Vvdw12  = _mm_mul_ps(c12,_mm_mul_ps(rinvsix,rinvsix));
+
+	vci     = _mm_add_ps(vci,vcoul);
+	Vvdwci  = _mm_add_ps(Vvdwci,_mm_sub_ps(Vvdw12,Vvdw6));
+	fscal   = _mm_sub_ps(_mm_mul_ps(twelve,Vvdw12),_mm_mul_ps(six,Vvdw6));
+	fscal   = _mm_add_ps(_mm_mul_ps(fscal,rinvsq),fcoul);
+
+	dx      = _mm_mul_ps(fscal,dx);
+	dy      = _mm_mul_ps(fscal,dy);
+	dz      = _mm_mul_ps(fscal,dz);
+	fix[i]  = _mm_add_ps(fix[i],dx);
+	fiy[i]  = _mm_add_ps(fiy[i],dy);
+	fiz[i]  = _mm_add_ps(fiz[i],dz);
+	fjx     = _mm_add_ps(fjx,dx);
+	fjy     = _mm_add_ps(fjy,dy);
+	fjz     = _mm_add_ps(fjz,dz);
+      }
+
+      _mm_store_ps(fj,       _mm_sub_ps(_mm_load_ps(fj),       fjx));
+      _mm_store_ps(fj +   CS,_mm_sub_ps(_mm_load_ps(fj +   CS),fjy));
+      _mm_store_ps(fj + 2*CS,_mm_sub_ps(_mm_load_ps(fj + 2*CS),fjz));
+    }
+
+    /* Transpose and sum, lane i then holds the force on i-atom i */
+    _MM_TRANSPOSE4_PS(fix[0],fix[1],fix[2],fix[3]);
+    _MM_TRANSPOSE4_PS(fiy[0],fiy[1],fiy[2],fiy[3]);
+    _MM_TRANSPOSE4_PS(fiz[0],fiz[1],fiz[2],fiz[3]);
+    fsx = _mm_add_ps(_mm_add_ps(fix[0],fix[1]),_mm_add_ps(fix[2],fix[3]));
+    fsy = _mm_add_ps(_mm_add_ps(fiy[0],fiy[1]),_mm_add_ps(fiy[2],fiy[3]));
+    fsz = _mm_add_ps(_mm_add_ps(fiz[0],fiz[1]),_mm_add_ps(fiz[2],fiz[3]));
+    fj  = f + ci*DIM*CS;
+    _mm_store_ps(fj,       _mm_add_ps(_mm_load_ps(fj),       fsx));
+    _mm_store_ps(fj +   CS,_mm_add_ps(_mm_load_ps(fj +   CS),fsy));
+    _mm_store_ps(fj + 2*CS,_mm_add_ps(_mm_load_ps(fj + 2*CS),fsz));
+    fshift[ish][XX] += hsum_ps(fsx);
+    fshift[ish][YY] += hsum_ps(fsy);
+    fshift[ish][ZZ] += hsum_ps(fsz);
+    vctot   += hsum_ps(vci);
+    Vvdwtot += hsum_ps(Vvdwci);
+  }
+
+  *Vc   += vctot;
+  *Vvdw += Vvdwtot;
+}
+
+#else
+
+/* Avoid an empty translation unit */
+int nbnxn_kernel_sse2_dummy;
+
+#endif
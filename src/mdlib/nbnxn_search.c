@@ -0,0 +1,649 @@
+/*
+ * 
+ *                This source code is part of
+ * 
+ *                 G   R   O   M   A   C   S
+ * 
+ *          GROningen MAchine for Chemical Simulations
+ * 
+ *                        VERSION 3.2.0
+ * Written by David van der Spoel, Erik Lindahl, Berk Hess, and others.
+ * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
+ * Copyright (c) 2001-2004, The GROMACS development team,
+ * check out http://www.gromacs.org for more information.
+
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * If you want to redistribute modifications, please consider that
+ * scientific software is very special. Version control is crucial -
+ * bugs must be traceable. We will be happy to consider code for
+ * inclusion in the official distribution, but derived work must not
+ * be called official GROMACS. Details are found in the README & COPYING
+ * files - if they are missing, get the official version at www.gromacs.org.
+ * 
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the papers on the package - you can find them in the top README file.
+ * 
+ * For more info, check our website at http://www.gromacs.org
+ * 
+ * And Hey:
+ * Gromacs Runs On Most of All Computer Systems
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "typedefs.h"
+#include "smalloc.h"
+#include "vec.h"
+#include "names.h"
+#include "nrnb.h"
+#include "gmx_fatal.h"
+#include "calc_verletbuf.h"
+#include "nbnxn.h"
+
+#define CS NBNXN_CLUSTER_SIZE
+
+/* The xq and f strides of a cluster in nbnxn_atomdata_t */
+#define XQ_STRIDE (4*CS)
+#define F_STRIDE  (DIM*CS)
+
+/* Filler atoms are put far away from all real atoms */
+#define NBNXN_FILLER_COORD -1e5
+
+struct gmx_nbnxn {
+  int              kernel_type;   /* enbnxnkREF or enbnxnkSSE2           */
+  nbnxn_param_t    param;
+  nbnxn_grid_t     grid;
+  nbnxn_pairlist_t nbl;           /* The list used by the kernels         */
+  nbnxn_pairlist_t nbl_outer;     /* With pruning, the list built at search */
+  int              nstprune;      /* Pruning frequency, 0 is no pruning  */
+  int              nstep_search;  /* Force calls since the last search   */
+  nbnxn_atomdata_t nbat;
+  int              nshift;        /* The shifts to search, CENTRAL first */
+  int              shift[SHIFTS];
+  int              *cj_mark;      /* For each cluster the last j-entry   */
+  int              cj_mark_nalloc;
+  int              *cj_next;      /* The previous j-entry of the same cj */
+};
+
+static const char *nbnxn_kernel_name[enbnxnkNR] = { "plain C", "SSE2" };
+
+gmx_nbnxn_t init_nbnxn(FILE *fplog,const t_commrec *cr,
+		       const t_inputrec *ir,const t_forcerec *fr,
+		       const gmx_mtop_t *mtop,matrix box)
+{
+  struct gmx_nbnxn *nbv;
+  nbnxn_atomdata_t *nbat;
+  int  i,j;
+
+  if (PAR(cr))
+    gmx_fatal(FARGS,"The %s cut-off scheme is not supported in parallel",
+	      ecutscheme_names[ecutsVERLET]);
+
+  snew(nbv,1);
+
+  nbv->kernel_type = enbnxnkREF;
+#if (defined(GMX_SSE2) && !defined(GMX_DOUBLE))
+  if (getenv("GMX_NBNXN_NOSSE") == NULL)
+    nbv->kernel_type = enbnxnkSSE2;
+#endif
+
+  if (EEL_FULL(fr->eeltype)) {
+    nbv->param.eeltype  = enbnxnelTAB;
+    nbv->param.tabscale = fr->nblists[0].tab.scale;
+    nbv->param.tab      = fr->nblists[0].coultab;
+  } else {
+    nbv->param.eeltype  = enbnxnelRF;
+    if (EEL_RF(fr->eeltype)) {
+      nbv->param.k_rf   = fr->k_rf;
+      nbv->param.c_rf   = fr->c_rf;
+    }
+  }
+  nbv->param.rcut2  = sqr(fr->rcoulomb);
+  nbv->param.epsfac = fr->epsfac;
+
+  nbv->nbl.rlist = fr->rlist;
+  nbv->nstprune  = 0;
+  if (ir->nstprune > 0) {
+    /* The pruned list only needs a buffer for nstprune steps */
+    nbv->nstprune        = ir->nstprune;
+    nbv->nbl_outer.rlist = fr->rlist;
+    nbv->nbl.rlist = calc_verlet_buffer_size(mtop,det(box),ir,ir->nstprune,
+					     ir->verletbuf_drift);
+    if (nbv->nbl.rlist < 0 || nbv->nbl.rlist >= fr->rlist) {
+      nbv->nstprune  = 0;
+      nbv->nbl.rlist = fr->rlist;
+    }
+  }
+
+  /* Add a filler type without interactions */
+  nbat = &nbv->nbat;
+  nbat->ntype = fr->ntype + 1;
+  snew(nbat->nbfp,2*nbat->ntype*nbat->ntype);
+  for(i=0; i<fr->ntype; i++) {
+    for(j=0; j<fr->ntype; j++) {
+      C6(nbat->nbfp,nbat->ntype,i,j)  = C6(fr->nbfp,fr->ntype,i,j);
+      C12(nbat->nbfp,nbat->ntype,i,j) = C12(fr->nbfp,fr->ntype,i,j);
+    }
+  }
+
+  if (fplog) {
+    fprintf(fplog,"\nUsing the %s cut-off scheme with %dx%d cluster-pair lists\n"
+	    "and %s kernels, rlist = %g, cut-off = %g\n",
+	    ecutscheme_names[ecutsVERLET],CS,CS,
+	    nbnxn_kernel_name[nbv->kernel_type],
+	    fr->rlist,fr->rcoulomb);
+    if (nbv->nstprune > 0)
+      fprintf(fplog,"Pruning the list every %d steps from rlist = %g to %g\n",
+	      nbv->nstprune,nbv->nbl_outer.rlist,nbv->nbl.rlist);
+  }
+
+  return nbv;
+}
+
+static real *alloc_aligned_real(int n,void **p_alloc)
+{
+  char *p;
+
+  sfree(*p_alloc);
+  snew(p,n*sizeof(real)+16);
+  *p_alloc = p;
+
+  /* align it - size_t has the same size as a pointer */
+  return (real *)(((size_t)p + 16) & (~((size_t)15)));
+}
+
+/* Puts the atoms on a grid of columns, sorts the columns along z
+ * and sets the cluster bounding boxes.
+ */
+static void nbnxn_put_on_grid(nbnxn_grid_t *grid,int natoms,rvec x[])
+{
+  rvec size;
+  real vol,csize;
+  int  ncol,nc_col,i,c,cx,cy,k,a,a0,a1,d;
+  real *bb;
+
+  copy_rvec(x[0],grid->c0);
+  copy_rvec(x[0],grid->c1);
+  for(i=1; i<natoms; i++) {
+    for(d=0; d<DIM; d++) {
+      grid->c0[d] = min(grid->c0[d],x[i][d]);
+      grid->c1[d] = max(grid->c1[d],x[i][d]);
+    }
+  }
+  rvec_sub(grid->c1,grid->c0,size);
+
+  /* Choose the column size such that the clusters are roughly cubic */
+  vol = 1;
+  for(d=0; d<DIM; d++)
+    vol *= max(size[d],1e-3);
+  csize = pow(CS*vol/natoms,1.0/3.0);
+  grid->ncx = max(1,(int)(size[XX]/csize + 0.5));
+  grid->ncy = max(1,(int)(size[YY]/csize + 0.5));
+  grid->sx  = size[XX]/grid->ncx;
+  grid->sy  = size[YY]/grid->ncy;
+  grid->inv_sx = (grid->sx > 0 ? 1/grid->sx : 0);
+  grid->inv_sy = (grid->sy > 0 ? 1/grid->sy : 0);
+
+  ncol = grid->ncx*grid->ncy;
+  if (ncol+1 > grid->cxy_nalloc) {
+    grid->cxy_nalloc = over_alloc_large(ncol+1);
+    srenew(grid->cxy_na,grid->cxy_nalloc);
+    srenew(grid->cxy_ind,grid->cxy_nalloc);
+  }
+  if (natoms > grid->cell_nalloc) {
+    grid->cell_nalloc = over_alloc_large(natoms);
+    srenew(grid->cell,grid->cell_nalloc);
+  }
+
+  /* Determine the column of each atom, temporarily stored in cell */
+  for(c=0; c<ncol; c++)
+    grid->cxy_na[c] = 0;
+  for(i=0; i<natoms; i++) {
+    cx = (int)((x[i][XX] - grid->c0[XX])*grid->inv_sx);
+    cy = (int)((x[i][YY] - grid->c0[YY])*grid->inv_sy);
+    cx = min(cx,grid->ncx-1);
+    cy = min(cy,grid->ncy-1);
+    grid->cell[i] = cx*grid->ncy + cy;
+    grid->cxy_na[grid->cell[i]]++;
+  }
+
+  /* Each column starts at a new cluster */
+  grid->cxy_ind[0] = 0;
+  for(c=0; c<ncol; c++)
+    grid->cxy_ind[c+1] = grid->cxy_ind[c] + (grid->cxy_na[c] + CS - 1)/CS;
+  grid->nc = grid->cxy_ind[ncol];
+  if (grid->nc > grid->nc_nalloc) {
+    grid->nc_nalloc = over_alloc_large(grid->nc);
+    srenew(grid->a,grid->nc_nalloc*CS);
+    srenew(grid->bb,grid->nc_nalloc*2*DIM);
+  }
+  for(i=0; i<grid->nc*CS; i++)
+    grid->a[i] = -1;
+
+  /* Fill the columns and sort them along z with insertion sort */
+  for(c=0; c<ncol; c++)
+    grid->cxy_na[c] = 0;
+  for(i=0; i<natoms; i++) {
+    c = grid->cell[i];
+    grid->a[grid->cxy_ind[c]*CS + grid->cxy_na[c]++] = i;
+  }
+  for(c=0; c<ncol; c++) {
+    a0 = grid->cxy_ind[c]*CS;
+    a1 = a0 + grid->cxy_na[c];
+    for(i=a0+1; i<a1; i++) {
+      a = grid->a[i];
+      for(k=i; k>a0 && x[grid->a[k-1]][ZZ] > x[a][ZZ]; k--)
+	grid->a[k] = grid->a[k-1];
+      grid->a[k] = a;
+    }
+  }
+
+  for(i=0; i<grid->nc*CS; i++) {
+    if (grid->a[i] >= 0)
+      grid->cell[grid->a[i]] = i;
+  }
+
+  /* The bounding boxes of the real atoms, each cluster has at least one */
+  for(c=0; c<grid->nc; c++) {
+    bb = grid->bb + c*2*DIM;
+    for(d=0; d<DIM; d++) {
+      bb[d]     = x[grid->a[c*CS]][d];
+      bb[DIM+d] = x[grid->a[c*CS]][d];
+    }
+    for(i=1; i<CS && grid->a[c*CS+i] >= 0; i++) {
+      for(d=0; d<DIM; d++) {
+	bb[d]     = min(bb[d],    x[grid->a[c*CS+i]][d]);
+	bb[DIM+d] = max(bb[DIM+d],x[grid->a[c*CS+i]][d]);
+      }
+    }
+  }
+
+  if (debug)
+    fprintf(debug,"nbnxn grid: %d x %d columns, %d clusters, %.1f%% fillers\n",
+	    grid->ncx,grid->ncy,grid->nc,
+	    100.0*(grid->nc*CS - natoms)/(grid->nc*CS));
+}
+
+/* Copies the atom coordinates to the cluster layout */
+static void nbnxn_copy_x(const nbnxn_grid_t *grid,nbnxn_atomdata_t *nbat,
+			 rvec x[])
+{
+  int  c,i,a;
+  real *xq;
+
+  for(c=0; c<grid->nc; c++) {
+    xq = nbat->xq + c*XQ_STRIDE;
+    for(i=0; i<CS; i++) {
+      a = grid->a[c*CS+i];
+      if (a >= 0) {
+	xq[     i] = x[a][XX];
+	xq[  CS+i] = x[a][YY];
+	xq[2*CS+i] = x[a][ZZ];
+      }
+    }
+  }
+}
+
+/* Sets the static atom data and the filler coordinates */
+static void nbnxn_set_atomdata(const nbnxn_grid_t *grid,
+			       nbnxn_atomdata_t *nbat,const t_mdatoms *md)
+{
+  int  c,i,a,d;
+  real *xq;
+
+  if (grid->nc > nbat->nalloc) {
+    nbat->nalloc = over_alloc_large(grid->nc);
+    nbat->xq = alloc_aligned_real(nbat->nalloc*XQ_STRIDE,&nbat->xq_alloc);
+    nbat->f  = alloc_aligned_real(nbat->nalloc*F_STRIDE,&nbat->f_alloc);
+    srenew(nbat->type,nbat->nalloc*CS);
+  }
+  for(c=0; c<grid->nc; c++) {
+    xq = nbat->xq + c*XQ_STRIDE;
+    for(i=0; i<CS; i++) {
+      a = grid->a[c*CS+i];
+      if (a >= 0) {
+	nbat->type[c*CS+i] = md->typeA[a];
+	xq[3*CS+i]         = md->chargeA[a];
+      } else {
+	nbat->type[c*CS+i] = nbat->ntype - 1;
+	for(d=0; d<DIM; d++)
+	  xq[d*CS+i] = NBNXN_FILLER_COORD;
+	xq[3*CS+i]         = 0;
+      }
+    }
+  }
+}
+
+/* Selects the shifts for which images of the grid are within rlist,
+ * of each pair of opposite shifts only the one with index > CENTRAL.
+ */
+static void nbnxn_set_shifts(gmx_nbnxn_t nbv,rvec *shift_vec,real rlist)
+{
+  nbnxn_grid_t *grid;
+  real rl2,d2,s;
+  int  is,d;
+
+  grid = &nbv->grid;
+  rl2  = sqr(rlist);
+
+  nbv->nshift = 0;
+  nbv->shift[nbv->nshift++] = CENTRAL;
+  for(is=CENTRAL+1; is<SHIFTS; is++) {
+    d2 = 0;
+    for(d=0; d<DIM; d++) {
+      s = shift_vec[is][d];
+      if (grid->c0[d] + s > grid->c1[d])
+	d2 += sqr(grid->c0[d] + s - grid->c1[d]);
+      else if (grid->c1[d] + s < grid->c0[d])
+	d2 += sqr(grid->c0[d] - grid->c1[d] - s);
+    }
+    if (d2 < rl2)
+      nbv->shift[nbv->nshift++] = is;
+  }
+}
+
+/* Returns the squared distance between two bounding boxes */
+static real bb_dist2(const real *bbi,const real *bbj)
+{
+  real d2,d;
+  int  m;
+
+  d2 = 0;
+  for(m=0; m<DIM; m++) {
+    d = bbj[m] - bbi[DIM+m];
+    if (d > 0) {
+      d2 += d*d;
+    } else {
+      d = bbi[m] - bbj[DIM+m];
+      if (d > 0)
+	d2 += d*d;
+    }
+  }
+
+  return d2;
+}
+
+/* Returns if any atom pair of clusters ci, shifted by sv, and cj
+ * is within sqrt(rl2).
+ */
+static bool cluster_pair_in_range(const real *xq,int ci,int cj,
+				  const rvec sv,real rl2)
+{
+  const real *xi,*xj;
+  real ix,iy,iz;
+  int  i,j;
+
+  xi = xq + ci*XQ_STRIDE;
+  xj = xq + cj*XQ_STRIDE;
+  for(i=0; i<CS; i++) {
+    ix = xi[     i] + sv[XX];
+    iy = xi[  CS+i] + sv[YY];
+    iz = xi[2*CS+i] + sv[ZZ];
+    for(j=0; j<CS; j++) {
+      if (sqr(ix - xj[j]) + sqr(iy - xj[CS+j]) + sqr(iz - xj[2*CS+j]) < rl2)
+	return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+static void add_cj(gmx_nbnxn_t nbv,nbnxn_pairlist_t *nbl,
+		   int ci,int cj,bool bDiag)
+{
+  const int *a;
+  unsigned int excl;
+  int i,j;
+
+  if (nbl->ncj + 1 > nbl->cj_nalloc) {
+    nbl->cj_nalloc = over_alloc_large(nbl->ncj + 1);
+    srenew(nbl->cj,nbl->cj_nalloc);
+    srenew(nbv->cj_next,nbl->cj_nalloc);
+  }
+
+  a    = nbv->grid.a;
+  excl = NBNXN_INT_MASK_ALL;
+  for(i=0; i<CS; i++) {
+    for(j=0; j<CS; j++) {
+      if ((bDiag && j <= i) || a[ci*CS+i] < 0 || a[cj*CS+j] < 0)
+	excl &= ~(1U << (i*CS + j));
+    }
+  }
+  nbl->cj[nbl->ncj].cj   = cj;
+  nbl->cj[nbl->ncj].excl = excl;
+  nbl->ncj++;
+}
+
+/* Removes the excluded atom pairs from the j-entries of i-cluster ci,
+ * which start at i-entry ci_ind0.
+ */
+static void set_exclusions(gmx_nbnxn_t nbv,nbnxn_pairlist_t *nbl,
+			   int ci,int ci_ind0,const t_blocka *excl)
+{
+  const nbnxn_grid_t *grid;
+  int n,k,i,e,ai,sj,cj;
+
+  grid = &nbv->grid;
+
+  for(n=ci_ind0; n<nbl->nci; n++) {
+    for(k=nbl->ci[n].cj_ind_start; k<nbl->ci[n].cj_ind_end; k++) {
+      cj = nbl->cj[k].cj;
+      nbv->cj_next[k]  = nbv->cj_mark[cj];
+      nbv->cj_mark[cj] = k;
+    }
+  }
+
+  for(i=0; i<CS; i++) {
+    ai = grid->a[ci*CS+i];
+    if (ai >= 0) {
+      for(e=excl->index[ai]; e<excl->index[ai+1]; e++) {
+	sj = grid->cell[excl->a[e]];
+	for(k=nbv->cj_mark[sj/CS]; k>=0; k=nbv->cj_next[k])
+	  nbl->cj[k].excl &= ~(1U << (i*CS + sj % CS));
+      }
+    }
+  }
+
+  for(n=ci_ind0; n<nbl->nci; n++) {
+    for(k=nbl->ci[n].cj_ind_start; k<nbl->ci[n].cj_ind_end; k++)
+      nbv->cj_mark[nbl->cj[k].cj] = -1;
+  }
+}
+
+static void nbnxn_make_pairlist(gmx_nbnxn_t nbv,nbnxn_pairlist_t *nbl,
+				rvec *shift_vec,const t_blocka *excl)
+{
+  nbnxn_grid_t *grid;
+  real rl,rl2,bbi[2*DIM],*bbj,dx,dy;
+  int  ci,cj,ci_ind0,cj_ind0,s,is,d,cx,cy,cx0,cx1,cy0,cy1,col;
+
+  grid = &nbv->grid;
+  rl   = nbl->rlist;
+  rl2  = rl*rl;
+
+  if (grid->nc > nbv->cj_mark_nalloc) {
+    nbv->cj_mark_nalloc = over_alloc_large(grid->nc);
+    srenew(nbv->cj_mark,nbv->cj_mark_nalloc);
+  }
+  for(cj=0; cj<grid->nc; cj++)
+    nbv->cj_mark[cj] = -1;
+
+  nbl->nci = 0;
+  nbl->ncj = 0;
+  for(ci=0; ci<grid->nc; ci++) {
+    ci_ind0 = nbl->nci;
+    for(s=0; s<nbv->nshift; s++) {
+      is = nbv->shift[s];
+      for(d=0; d<2*DIM; d++)
+	bbi[d] = grid->bb[ci*2*DIM+d] + shift_vec[is][d % DIM];
+
+      cx0 = max((int)floor((bbi[XX] - rl - grid->c0[XX])*grid->inv_sx),0);
+      cx1 = min((int)floor((bbi[DIM+XX] + rl - grid->c0[XX])*grid->inv_sx),
+		grid->ncx-1);
+      cy0 = max((int)floor((bbi[YY] - rl - grid->c0[YY])*grid->inv_sy),0);
+      cy1 = min((int)floor((bbi[DIM+YY] + rl - grid->c0[YY])*grid->inv_sy),
+		grid->ncy-1);
+
+      cj_ind0 = nbl->ncj;
+      for(cx=cx0; cx<=cx1; cx++) {
+	dx = max(0,max(grid->c0[XX] + cx*grid->sx - bbi[DIM+XX],
+		       bbi[XX] - grid->c0[XX] - (cx + 1)*grid->sx));
+	for(cy=cy0; cy<=cy1; cy++) {
+	  dy = max(0,max(grid->c0[YY] + cy*grid->sy - bbi[DIM+YY],
+			 bbi[YY] - grid->c0[YY] - (cy + 1)*grid->sy));
+	  if (dx*dx + dy*dy >= rl2)
+	    continue;
+	  col = cx*grid->ncy + cy;
+	  for(cj=grid->cxy_ind[col]; cj<grid->cxy_ind[col+1]; cj++) {
+	    bbj = grid->bb + cj*2*DIM;
+	    /* The clusters in a column are sorted along z */
+	    if (bbj[ZZ] > bbi[DIM+ZZ] + rl)
+	      break;
+	    if ((is == CENTRAL && cj < ci) ||
+		bb_dist2(bbi,bbj) >= rl2 ||
+		!cluster_pair_in_range(nbv->nbat.xq,ci,cj,shift_vec[is],rl2))
+	      continue;
+	    add_cj(nbv,nbl,ci,cj,is == CENTRAL && cj == ci);
+	  }
+	}
+      }
+
+      if (nbl->ncj > cj_ind0) {
+	if (nbl->nci + 1 > nbl->ci_nalloc) {
+	  nbl->ci_nalloc = over_alloc_large(nbl->nci + 1);
+	  srenew(nbl->ci,nbl->ci_nalloc);
+	}
+	nbl->ci[nbl->nci].ci           = ci;
+	nbl->ci[nbl->nci].shift        = is;
+	nbl->ci[nbl->nci].cj_ind_start = cj_ind0;
+	nbl->ci[nbl->nci].cj_ind_end   = nbl->ncj;
+	nbl->nci++;
+      }
+    }
+    set_exclusions(nbv,nbl,ci,ci_ind0,excl);
+  }
+
+  if (debug)
+    fprintf(debug,"nbnxn list: %d i-entries, %d cluster pairs, %.1f pairs per i-entry\n",
+	    nbl->nci,nbl->ncj,nbl->nci > 0 ? (real)nbl->ncj/nbl->nci : 0);
+}
+
+/* Copies the cluster pairs of nbl_outer that are within the cut-off
+ * of nbl with the current coordinates to nbl.
+ */
+static void nbnxn_prune_pairlist(const nbnxn_pairlist_t *nbl_outer,
+				 nbnxn_pairlist_t *nbl,const real *xq,
+				 rvec *shift_vec)
+{
+  const nbnxn_ci_t *ciEntry;
+  real rl2;
+  int  n,k,cj_ind0;
+
+  rl2 = sqr(nbl->rlist);
+
+  if (nbl_outer->ncj > nbl->cj_nalloc) {
+    nbl->cj_nalloc = nbl_outer->cj_nalloc;
+    srenew(nbl->cj,nbl->cj_nalloc);
+  }
+  if (nbl_outer->nci > nbl->ci_nalloc) {
+    nbl->ci_nalloc = nbl_outer->ci_nalloc;
+    srenew(nbl->ci,nbl->ci_nalloc);
+  }
+
+  nbl->nci = 0;
+  nbl->ncj = 0;
+  for(n=0; n<nbl_outer->nci; n++) {
+    ciEntry = &nbl_outer->ci[n];
+    cj_ind0 = nbl->ncj;
+    for(k=ciEntry->cj_ind_start; k<ciEntry->cj_ind_end; k++) {
+      if (cluster_pair_in_range(xq,ciEntry->ci,nbl_outer->cj[k].cj,
+				shift_vec[ciEntry->shift],rl2))
+	nbl->cj[nbl->ncj++] = nbl_outer->cj[k];
+    }
+    if (nbl->ncj > cj_ind0) {
+      nbl->ci[nbl->nci]              = *ciEntry;
+      nbl->ci[nbl->nci].cj_ind_start = cj_ind0;
+      nbl->ci[nbl->nci].cj_ind_end   = nbl->ncj;
+      nbl->nci++;
+    }
+  }
+}
+
+void nbnxn_search(gmx_nbnxn_t nbv,rvec *shift_vec,
+		  int natoms,rvec x[],const t_mdatoms *md,
+		  const t_blocka *excl,t_nrnb *nrnb)
+{
+  nbnxn_put_on_grid(&nbv->grid,natoms,x);
+  nbnxn_set_atomdata(&nbv->grid,&nbv->nbat,md);
+  nbnxn_copy_x(&nbv->grid,&nbv->nbat,x);
+  if (nbv->nstprune > 0) {
+    nbnxn_set_shifts(nbv,shift_vec,nbv->nbl_outer.rlist);
+    nbnxn_make_pairlist(nbv,&nbv->nbl_outer,shift_vec,excl);
+    inc_nrnb(nrnb,eNR_NS,nbv->nbl_outer.ncj);
+  } else {
+    nbnxn_set_shifts(nbv,shift_vec,nbv->nbl.rlist);
+    nbnxn_make_pairlist(nbv,&nbv->nbl,shift_vec,excl);
+    inc_nrnb(nrnb,eNR_NS,nbv->nbl.ncj);
+  }
+  /* The list is pruned at the first force call */
+  nbv->nstep_search = 0;
+}
+
+void nbnxn_do_nonbonded(gmx_nbnxn_t nbv,rvec x[],rvec f[],
+			rvec fshift[],rvec *shift_vec,
+			real *Vc,real *Vvdw,t_nrnb *nrnb)
+{
+  const nbnxn_grid_t *grid;
+  nbnxn_atomdata_t *nbat;
+  int  c,i,a,d;
+  real *fc;
+
+  grid = &nbv->grid;
+  nbat = &nbv->nbat;
+
+  nbnxn_copy_x(grid,nbat,x);
+  if (nbv->nstprune > 0 && nbv->nstep_search % nbv->nstprune == 0) {
+    nbnxn_prune_pairlist(&nbv->nbl_outer,&nbv->nbl,nbat->xq,shift_vec);
+    inc_nrnb(nrnb,eNR_NBNXN_PRUNE,nbv->nbl_outer.ncj);
+  }
+  nbv->nstep_search++;
+
+  for(i=0; i<grid->nc*F_STRIDE; i++)
+    nbat->f[i] = 0;
+
+  switch (nbv->kernel_type) {
+  case enbnxnkREF:
+    nbnxn_kernel_ref(&nbv->nbl,nbat,&nbv->param,shift_vec,fshift,Vc,Vvdw);
+    break;
+#if (defined(GMX_SSE2) && !defined(GMX_DOUBLE))
+  case enbnxnkSSE2:
+    nbnxn_kernel_sse2(&nbv->nbl,nbat,&nbv->param,shift_vec,fshift,Vc,Vvdw);
+    break;
+#endif
+  default:
+    gmx_incons("Unknown nbnxn kernel type");
+  }
+
+  for(c=0; c<grid->nc; c++) {
+    fc = nbat->f + c*F_STRIDE;
+    for(i=0; i<CS; i++) {
+      a = grid->a[c*CS+i];
+      if (a >= 0) {
+	for(d=0; d<DIM; d++)
+	  f[a][d] += fc[d*CS+i];
+      }
+    }
+  }
+
+  inc_nrnb(nrnb,
+	   nbv->param.eeltype == enbnxnelTAB ? eNR_NBNXN_TAB : eNR_NBNXN_RF,
+	   nbv->nbl.ncj*CS*CS);
+}
@@ -37,7 +37,7 @@
 #include <config.h>
 #endif
 
-#ifdef GMX_THREADS
+#if defined GMX_THREADS || defined GMX_THREAD_PTHREADS
 #include <pthread.h> 
 #endif
 
@@ -145,6 +145,9 @@ static void init_nblist(t_nblist *nl_sr,t_nblist *nl_lr,
     t_nblist *nl;
     int      homenr;
     int      i,nn;
+#ifdef GMX_THREAD_PTHREADS
+    pthread_mutex_t *mtx;
+#endif
     
     int inloop[20] =
     { 
@@ -235,10 +238,15 @@ static void init_nblist(t_nblist *nl_sr,t_nblist *nl_lr,
         nl->jindex      = NULL;
         reallocate_nblist(nl);
         nl->jindex[0] = 0;
-#ifdef GMX_THREADS
-        nl->counter = 0;
-        snew(nl->mtx,1);
-        pthread_mutex_init(nl->mtx,NULL);
+#ifdef GMX_THREAD_PTHREADS
+        /* Protects count when the list is processed by several threads */
+        nl->count = 0;
+        if (nl->mtx == NULL)
+        {
+            snew(mtx,1);
+            pthread_mutex_init(mtx,NULL);
+            nl->mtx = mtx;
+        }
 #endif
     }
 }
@@ -366,123 +374,6 @@ void init_neighbor_list(FILE *log,t_forcerec *fr,int homenr)
 
 }
 
-void init_neighbor_list_mc(FILE *log,t_forcerec *fr,int homenr,int cgsnr)
-{
-   int maxsr,maxsr_wat,maxlr,maxlr_wat;
-   int icoul,icoulf,ivdw;
-   int solvent;
-   int enlist_w,enlist_ww;
-   int i,j;
-   t_nblists *nbl;
-
-   maxsr     = homenr;
-
-   if (maxsr < 0)
-   {
-     gmx_fatal(FARGS,"%s, %d: Negative number of short range atoms.\n"
-		 "Call your Gromacs dealer for assistance.",__FILE__,__LINE__);
-   }
-   maxsr_wat = min(fr->nWatMol,(homenr+2)/3); 
-   if (fr->bTwinRange) 
-   {
-       maxlr     = 50;
-       maxlr_wat = min(maxsr_wat,maxlr);
-   }
-   else
-   {
-     maxlr = maxlr_wat = 0;
-   }  
-
-   if(fr->bGB)
-   {
-       icoul=4;
-   }
-   else if (fr->bcoultab)
-   {
-       icoul = 3;
-   }
-   else if (EEL_RF(fr->eeltype))
-   {
-       icoul = 2;
-   }
-   else 
-   {
-       icoul = 1;
-   }
-   
-   if (fr->bvdwtab)
-   {
-       ivdw = 3;
-   }
-   else if (fr->bBHAM)
-   {
-       ivdw = 2;
-   }
-   else 
-   {
-       ivdw = 1;
-   }
-   
-   if (fr->solvent_opt == esolTIP4P) {
-       enlist_w  = enlistTIP4P_ATOM;
-       enlist_ww = enlistTIP4P_TIP4P;
-   } else {
-       enlist_w  = enlistSPC_ATOM;
-       enlist_ww = enlistSPC_SPC;
-   }
-   snew(fr->nblists_mc,cgsnr);
-   for(i=0; i<fr->nnblists; i++) 
-   {
-       for(j=0;j<cgsnr;j++) {
-
-        if(i==0)
-        {
-         snew(fr->nblists_mc[j],fr->nnblists);          
-        }
-
-        nbl = &(fr->nblists_mc[j][i]);
-        init_nblist(&nbl->nlist_sr[eNL_VDWQQ],&nbl->nlist_lr[eNL_VDWQQ],
-                    maxsr,maxlr,ivdw,icoul,FALSE,enlistATOM_ATOM);
-        init_nblist(&nbl->nlist_sr[eNL_VDW],&nbl->nlist_lr[eNL_VDW],
-                   maxsr,maxlr,ivdw,0,FALSE,enlistATOM_ATOM);
-        init_nblist(&nbl->nlist_sr[eNL_QQ],&nbl->nlist_lr[eNL_QQ],
-                   maxsr,maxlr,0,icoul,FALSE,enlistATOM_ATOM);
-        init_nblist(&nbl->nlist_sr[eNL_VDWQQ_WATER],&nbl->nlist_lr[eNL_VDWQQ_WATER],
-                   maxsr_wat,maxlr_wat,ivdw,icoul, FALSE,enlist_w);
-        init_nblist(&nbl->nlist_sr[eNL_QQ_WATER],&nbl->nlist_lr[eNL_QQ_WATER],
-                   maxsr_wat,maxlr_wat,0,icoul, FALSE,enlist_w);
-        init_nblist(&nbl->nlist_sr[eNL_VDWQQ_WATERWATER],&nbl->nlist_lr[eNL_VDWQQ_WATERWATER],
-                   maxsr_wat,maxlr_wat,ivdw,icoul, FALSE,enlist_ww);
-        init_nblist(&nbl->nlist_sr[eNL_QQ_WATERWATER],&nbl->nlist_lr[eNL_QQ_WATERWATER],
-                   maxsr_wat,maxlr_wat,0,icoul, FALSE,enlist_ww);
-       }
-
-       if (fr->efep != efepNO) 
-       {
-           if (fr->bEwald)
-           {
-               icoulf = 5;
-           }
-           else
-           {
-               icoulf = icoul;
-           }
-
-           init_nblist(&nbl->nlist_sr[eNL_VDWQQ_FREE],&nbl->nlist_lr[eNL_VDWQQ_FREE],
-                       maxsr,maxlr,ivdw,icoulf,TRUE,enlistATOM_ATOM);
-           init_nblist(&nbl->nlist_sr[eNL_VDW_FREE],&nbl->nlist_lr[eNL_VDW_FREE],
-                       maxsr,maxlr,ivdw,0,TRUE,enlistATOM_ATOM);
-           init_nblist(&nbl->nlist_sr[eNL_QQ_FREE],&nbl->nlist_lr[eNL_QQ_FREE],
-                       maxsr,maxlr,0,icoulf,TRUE,enlistATOM_ATOM);
-       }  
-   }
-   if (fr->bQMMM && fr->qr->QMMMscheme != eQMMMschemeoniom)
-   {
-       init_nblist(&fr->QMMMlist_sr,&fr->QMMMlist_lr,
-                   maxsr,maxlr,0,icoul,FALSE,enlistATOM_ATOM);
-   }
-
-}
  static void reset_nblist(t_nblist *nl)
  {
      nl->nri       = -1;
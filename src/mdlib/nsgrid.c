@@ -420,6 +420,11 @@ void done_grid(t_grid *grid)
   sfree(grid->dcy2);
   sfree(grid->dcz2);
   grid->dc_nalloc = 0;
+  sfree(grid->mc_head);
+  grid->mc_cells_nalloc = 0;
+  sfree(grid->mc_cell);
+  sfree(grid->mc_next);
+  grid->mc_nalloc = 0;
 
   if (debug) 
     fprintf(debug,"Succesfully freed memory for grid pointers.");
@@ -864,3 +869,111 @@ void mv_grid(t_commrec *cr,t_grid *grid)
   }
 }
 
+static int grid_mc_ci(t_grid *grid,rvec x)
+{
+  int  d,c[DIM];
+  real xd;
+
+  for(d=0; d<DIM; d++) {
+    /* The cg centers are not necessarily in the box */
+    xd = x[d] - grid->mc_box[d]*floor(x[d]/grid->mc_box[d]);
+    c[d] = (int)(xd*grid->mc_inv_size[d]);
+    if (c[d] >= grid->mc_n[d])
+      c[d] = grid->mc_n[d] - 1;
+    else if (c[d] < 0)
+      c[d] = 0;
+  }
+
+  return xyz2ci(grid->mc_n[YY],grid->mc_n[ZZ],c[XX],c[YY],c[ZZ]);
+}
+
+void grid_mc_fill(t_grid *grid,matrix box,int ncg,rvec cg_cm[])
+{
+  int d,ncells,ci,cg;
+
+  for(d=0; d<DIM; d++) {
+    grid->mc_n[d] = max(grid->n[d],1);
+    grid->mc_box[d] = box[d][d];
+    grid->mc_inv_size[d] = grid->mc_n[d]/box[d][d];
+  }
+  ncells = grid->mc_n[XX]*grid->mc_n[YY]*grid->mc_n[ZZ];
+  if (ncells > grid->mc_cells_nalloc) {
+    grid->mc_cells_nalloc = over_alloc_small(ncells);
+    srenew(grid->mc_head,grid->mc_cells_nalloc);
+  }
+  if (ncg > grid->mc_nalloc) {
+    grid->mc_nalloc = over_alloc_small(ncg);
+    srenew(grid->mc_cell,grid->mc_nalloc);
+    srenew(grid->mc_next,grid->mc_nalloc);
+  }
+  for(ci=0; ci<ncells; ci++)
+    grid->mc_head[ci] = -1;
+  for(cg=ncg-1; cg>=0; cg--) {
+    ci = grid_mc_ci(grid,cg_cm[cg]);
+    grid->mc_cell[cg] = ci;
+    grid->mc_next[cg] = grid->mc_head[ci];
+    grid->mc_head[ci] = cg;
+  }
+}
+
+void grid_mc_move(t_grid *grid,int cg,rvec cg_cm)
+{
+  int ci_old,ci,*p;
+
+  ci_old = grid->mc_cell[cg];
+  ci     = grid_mc_ci(grid,cg_cm);
+  if (ci == ci_old)
+    return;
+
+  /* Unlink cg from its old cell, the cells are short */
+  for(p=&grid->mc_head[ci_old]; *p!=cg; p=&grid->mc_next[*p])
+    if (*p < 0)
+      gmx_incons("Charge group not found in its MC grid cell");
+  *p = grid->mc_next[cg];
+
+  grid->mc_cell[cg] = ci;
+  grid->mc_next[cg] = grid->mc_head[ci];
+  grid->mc_head[ci] = cg;
+}
+
+int grid_mc_neighbors(t_grid *grid,rvec x,real rc,int *nalloc,int **jcg)
+{
+  int  d,nc,c[DIM],c0[DIM],c1[DIM],ci,ix,iy,iz,jx,jy,jz,cg,nj;
+
+  ci = grid_mc_ci(grid,x);
+  c[XX] = ci/(grid->mc_n[YY]*grid->mc_n[ZZ]);
+  c[YY] = (ci/grid->mc_n[ZZ]) % grid->mc_n[YY];
+  c[ZZ] = ci % grid->mc_n[ZZ];
+  for(d=0; d<DIM; d++) {
+    /* Any point within rc of x lies within nc cells of the cell of x */
+    nc = (int)(rc*grid->mc_inv_size[d]) + 1;
+    if (2*nc + 1 >= grid->mc_n[d]) {
+      c0[d] = 0;
+      c1[d] = grid->mc_n[d] - 1;
+    } else {
+      c0[d] = c[d] - nc;
+      c1[d] = c[d] + nc;
+    }
+  }
+
+  nj = 0;
+  for(ix=c0[XX]; ix<=c1[XX]; ix++) {
+    jx = (ix + grid->mc_n[XX]) % grid->mc_n[XX];
+    for(iy=c0[YY]; iy<=c1[YY]; iy++) {
+      jy = (iy + grid->mc_n[YY]) % grid->mc_n[YY];
+      for(iz=c0[ZZ]; iz<=c1[ZZ]; iz++) {
+        jz = (iz + grid->mc_n[ZZ]) % grid->mc_n[ZZ];
+        ci = xyz2ci(grid->mc_n[YY],grid->mc_n[ZZ],jx,jy,jz);
+        for(cg=grid->mc_head[ci]; cg>=0; cg=grid->mc_next[cg]) {
+          if (nj >= *nalloc) {
+            *nalloc = over_alloc_small(nj+1);
+            srenew(*jcg,*nalloc);
+          }
+          (*jcg)[nj++] = cg;
+        }
+      }
+    }
+  }
+
+  return nj;
+}
@@ -62,6 +62,7 @@
 
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include "typedefs.h"
@@ -79,6 +80,7 @@
 #include "nrnb.h"
 #include "copyrite.h"
 #include "gmx_wallcycle.h"
+#include "gmx_thread_pool.h"
 
 #ifdef GMX_LIB_MPI
 #include <mpi.h>
@@ -117,11 +119,17 @@ typedef struct {
 #ifdef GMX_MPI
     MPI_Comm mpi_comm;
 #endif
+    int  dimind;              /* The index of the dimension, 0=x, 1=y */
     int  nslab;
     int  *s2g;
     int  nleftbnd,nrightbnd;  /* The number of nodes to communicate with */
     int  nodeid,*leftid,*rightid;
     pme_grid_comm_t *leftc,*rightc;
+    int  nseg;                /* The grid line segments we spread on: */
+    int  *seg0,*segn;         /* our slab and the neighbor boundaries  */
+    int  buf_nalloc;          /* Pack buffers, only used with pencils */
+    real *sendbuf;
+    real *recvbuf;
 } pme_overlap_t;
 
 typedef struct {
@@ -158,6 +166,50 @@ typedef struct {
                               */
 } pme_atomcomm_t;
 
+/* Charges are spread and forces are gathered in blocks of grid cells
+ * along x and y, each block covering full z-lines. The atoms are sorted
+ * on the grid cell where their spline starts. The charges of a block
+ * are spread on a small dense sub-grid which fits in cache. The interior
+ * of the sub-grid is stored directly in the FFT grid, such that the grid
+ * never needs to be cleared, the halo of order-1 cells is added after all
+ * blocks have been stored.
+ */
+
+/* The target number of reals in a sub-grid, sized for the L2 cache */
+#define PME_SUBGRID_SIZE 32768
+
+/* With threads, blocks are made smaller until there are at least
+ * this many blocks per thread, for load balancing.
+ */
+#define PME_BLOCKS_PER_THREAD 4
+
+typedef struct {
+    bool bPeriodic;         /* The region is the whole periodic dimension */
+    int  r0;                /* Grid index of the region start, can be < 0 */
+    int  rn;                /* The size of the region */
+    int  bs;                /* The block size, the last block can be larger */
+    int  nb;                /* The number of blocks */
+} pme_blockdim_t;
+
+typedef struct {
+    pme_blockdim_t bd[2];   /* The blocking along x and y */
+    int  nblock;            /* The number of blocks, bd[0].nb*bd[1].nb */
+    int  la2s;              /* The z-line length of a sub-grid */
+    int  nkey_block;        /* The number of sort keys per block */
+    int  nalloc;
+    ivec *u;                /* The spline start of each atom in the region */
+    int  *key;              /* The sort key: block and x-line in the block */
+    int  *order;            /* The atom indices sorted on key */
+    int  key_nalloc;
+    int  *key_start;        /* The start index in order for each key */
+    int  block_nalloc;
+    int  *halo_ind;         /* The start index in halo for each block */
+    int  halo_nalloc;
+    real *halo;             /* The x and y halo of the block sub-grids */
+    int  sub_nalloc;        /* The size of the sub-grid of one thread */
+    real *subgrid;          /* The sub-grid buffers of all threads */
+} pme_spread_t;
+
 typedef struct gmx_pme {
     int  ndecompdim;         /* The number of decomposition dimensions */
     int  nodeid;             /* Our nodeid in mpi->mpi_comm */
@@ -181,6 +233,11 @@ typedef struct gmx_pme {
     
     pme_overlap_t overlap[2];
 
+    pme_spread_t spread;     /* Atom ordering and buffers for spreading */
+
+    int  nthread;            /* The number of threads, >1 only on PME nodes */
+    gmx_thread_pool_t pool;  /* The thread pool, NULL with one thread */
+
     pme_atomcomm_t atc_energy; /* Only for gmx_pme_calc_energy */
     
     rvec *bufv;             /* Communication buffer */
@@ -194,6 +251,8 @@ typedef struct gmx_pme {
 	real *   work_denom;
 	real *   work_tmp1;
 	real *   work_m2inv;
+	real *   work_energy;       /* The energy of each thread */
+	matrix * work_vir;          /* The virial of each thread */
 } t_gmx_pme;
 
 /* The following stuff is needed for signal handling on the PME nodes. 
@@ -246,7 +305,25 @@ static void calc_recipbox(matrix box,matrix recipbox)
   recipbox[ZZ][ZZ]=box[XX][XX]*box[YY][YY]*tmp;
 }
 
-static void calc_idx(gmx_pme_t pme,pme_atomcomm_t *atc)
+static void pme_run_tasks(gmx_pme_t pme,int ntask,
+                          gmx_thread_pool_func_t func,void *data)
+{
+    int t;
+
+    if (pme->pool)
+    {
+        gmx_thread_pool_run(pme->pool,ntask,func,data);
+    }
+    else
+    {
+        for(t=0; t<ntask; t++)
+        {
+            func(data,t,0);
+        }
+    }
+}
+
+static void calc_idx(gmx_pme_t pme,pme_atomcomm_t *atc,int start,int end)
 {
     int  i;
     int  *idxptr,tix,tiy,tiz;
@@ -274,7 +351,7 @@ static void calc_idx(gmx_pme_t pme,pme_atomcomm_t *atc)
     rzy = pme->recipbox[ZZ][YY];
     rzz = pme->recipbox[ZZ][ZZ];
     
-    for(i=0; (i<atc->n); i++) {
+    for(i=start; (i<end); i++) {
         xptr   = atc->x[i];
         idxptr = atc->idx[i];
         fptr   = atc->fractx[i];
@@ -788,6 +865,173 @@ static void gmx_sum_qgrid_dd(pme_overlap_t *ol,t_fftgrid *grid,int direction)
     GMX_MPE_LOG(ev_sum_qgrid_finish);
 }
 
+static int pme_pack_overlap(t_fftgrid *grid,int dimind,int a0,int na,
+                            int nseg,int *seg0,int *segn,
+                            real *buf,int action)
+{
+    int  s,i,j,k,n,nz;
+    real *ptr;
+
+    /* Copy grid lines a0 to a0+na along dimind for the segments
+     * along the other decomposition dimension.
+     * action 0: grid to buf, 1: buf to grid, 2: add buf to grid.
+     */
+    nz = grid->nz;
+    n  = 0;
+    for(s=0; s<nseg; s++) {
+        for(i=seg0[s]; i<seg0[s]+segn[s]; i++) {
+            for(j=a0; j<a0+na; j++) {
+                if (dimind == 0) {
+                    ptr = grid->ptr + j*grid->la12r + i*grid->la2r;
+                } else {
+                    ptr = grid->ptr + i*grid->la12r + j*grid->la2r;
+                }
+                switch (action) {
+                case 0:
+                    for(k=0; k<nz; k++) {
+                        buf[n+k] = ptr[k];
+                    }
+                    break;
+                case 1:
+                    for(k=0; k<nz; k++) {
+                        ptr[k] = buf[n+k];
+                    }
+                    break;
+                default:
+                    for(k=0; k<nz; k++) {
+                        ptr[k] += buf[n+k];
+                    }
+                }
+                n += nz;
+            }
+        }
+    }
+
+    return n;
+}
+
+static void pme_sum_overlap_dim(pme_overlap_t *ol,t_fftgrid *grid,
+                                int nseg,int *seg0,int *segn,int direction)
+{
+    int b,s,n,nsegtot,nalloc;
+    pme_grid_comm_t *pgc;
+#ifdef GMX_MPI
+    MPI_Status stat;
+#endif
+
+    nsegtot = 0;
+    for(s=0; s<nseg; s++) {
+        nsegtot += segn[s];
+    }
+    nalloc = 0;
+    for(b=0; b<ol->nleftbnd; b++) {
+        nalloc = max(nalloc,max(ol->leftc[b].snds,ol->leftc[b].rcvs));
+    }
+    for(b=0; b<ol->nrightbnd; b++) {
+        nalloc = max(nalloc,max(ol->rightc[b].snds,ol->rightc[b].rcvs));
+    }
+    nalloc *= nsegtot*grid->nz;
+    if (nalloc > ol->buf_nalloc) {
+        ol->buf_nalloc = nalloc;
+        srenew(ol->sendbuf,ol->buf_nalloc);
+        srenew(ol->recvbuf,ol->buf_nalloc);
+    }
+
+#ifdef GMX_MPI
+    if (direction == GMX_SUM_QGRID_FORWARD) { 
+        /* Send left boundaries */
+        for(b=0; b<ol->nleftbnd; b++) {
+            pgc = &ol->leftc[b];
+            n = pme_pack_overlap(grid,ol->dimind,pgc->snd0,pgc->snds,
+                                 nseg,seg0,segn,ol->sendbuf,0);
+            MPI_Sendrecv(ol->sendbuf,n,mpi_type,
+                         ol->leftid[b], ol->nodeid,
+                         ol->recvbuf,pgc->rcvs*nsegtot*grid->nz,mpi_type,
+                         ol->rightid[b],ol->rightid[b],
+                         ol->mpi_comm,&stat);
+            pme_pack_overlap(grid,ol->dimind,pgc->rcv0,pgc->rcvs,
+                             nseg,seg0,segn,ol->recvbuf,2);
+        }
+        /* Send right boundaries */
+        for(b=0; b<ol->nrightbnd; b++) {
+            pgc = &ol->rightc[b];
+            n = pme_pack_overlap(grid,ol->dimind,pgc->snd0,pgc->snds,
+                                 nseg,seg0,segn,ol->sendbuf,0);
+            MPI_Sendrecv(ol->sendbuf,n,mpi_type,
+                         ol->rightid[b],ol->nodeid,
+                         ol->recvbuf,pgc->rcvs*nsegtot*grid->nz,mpi_type,
+                         ol->leftid[b], ol->leftid[b],
+                         ol->mpi_comm,&stat);
+            pme_pack_overlap(grid,ol->dimind,pgc->rcv0,pgc->rcvs,
+                             nseg,seg0,segn,ol->recvbuf,2);
+        }
+    } else {
+        /* Send right boundaries */
+        for(b=0; b<ol->nrightbnd; b++) {
+            pgc = &ol->rightc[b];
+            n = pme_pack_overlap(grid,ol->dimind,pgc->rcv0,pgc->rcvs,
+                                 nseg,seg0,segn,ol->sendbuf,0);
+            MPI_Sendrecv(ol->sendbuf,n,mpi_type,
+                         ol->leftid[b], ol->nodeid,
+                         ol->recvbuf,pgc->snds*nsegtot*grid->nz,mpi_type,
+                         ol->rightid[b],ol->rightid[b],
+                         ol->mpi_comm,&stat);
+            pme_pack_overlap(grid,ol->dimind,pgc->snd0,pgc->snds,
+                             nseg,seg0,segn,ol->recvbuf,1);
+        }
+        /* Send left boundaries */
+        for(b=0; b<ol->nleftbnd; b++) {
+            pgc = &ol->leftc[b];
+            n = pme_pack_overlap(grid,ol->dimind,pgc->rcv0,pgc->rcvs,
+                                 nseg,seg0,segn,ol->sendbuf,0);
+            MPI_Sendrecv(ol->sendbuf,n,mpi_type,
+                         ol->rightid[b],ol->nodeid,
+                         ol->recvbuf,pgc->snds*nsegtot*grid->nz,mpi_type,
+                         ol->leftid[b], ol->leftid[b],
+                         ol->mpi_comm,&stat);
+            pme_pack_overlap(grid,ol->dimind,pgc->snd0,pgc->snds,
+                             nseg,seg0,segn,ol->recvbuf,1);
+        }
+    }
+#endif
+}
+
+static void gmx_sum_qgrid_pencil(gmx_pme_t pme,t_fftgrid *grid,int direction)
+{
+    pme_overlap_t *olx;
+    int yseg0,ysegn;
+
+    GMX_MPE_LOG(ev_sum_qgrid_start);
+
+    if (direction != GMX_SUM_QGRID_FORWARD &&
+        direction != GMX_SUM_QGRID_BACKWARD) {
+        gmx_fatal(FARGS,"Invalid direction %d for summing qgrid",direction);
+    }
+
+    /* With pencil decomposition the y-boundaries are communicated
+     * for all x-lines we spread on, including the x-boundaries,
+     * the x-boundaries only for our own y-lines. This takes care of
+     * the corners without diagonal communication.
+     */
+    olx   = &pme->overlap[0];
+    yseg0 = pme->overlap[1].s2g[pme->overlap[1].nodeid];
+    ysegn = pme->overlap[1].s2g[pme->overlap[1].nodeid+1] - yseg0;
+
+    if (direction == GMX_SUM_QGRID_FORWARD) {
+        pme_sum_overlap_dim(&pme->overlap[1],grid,olx->nseg,olx->seg0,olx->segn,
+                            direction);
+        pme_sum_overlap_dim(&pme->overlap[0],grid,1,&yseg0,&ysegn,
+                            direction);
+    } else {
+        pme_sum_overlap_dim(&pme->overlap[0],grid,1,&yseg0,&ysegn,
+                            direction);
+        pme_sum_overlap_dim(&pme->overlap[1],grid,olx->nseg,olx->seg0,olx->segn,
+                            direction);
+    }
+
+    GMX_MPE_LOG(ev_sum_qgrid_finish);
+}
+
 void gmx_sum_qgrid(gmx_pme_t gmx,t_commrec *cr,t_fftgrid *grid,int direction)
 {
     static bool bFirst=TRUE;
@@ -845,148 +1089,446 @@ void gmx_sum_qgrid(gmx_pme_t gmx,t_commrec *cr,t_fftgrid *grid,int direction)
 #endif
 }
 
-/* This has to be a macro to enable full compiler optimization with xlC (and probably others too) */
-#define DO_BSPLINE(order)                            \
-for(ithx=0; (ithx<order); ithx++)                    \
-{                                                    \
-    index_x = la12*i0[ithx];                         \
-    valx    = qn*thx[ithx];                          \
-                                                     \
-    for(ithy=0; (ithy<order); ithy++)                \
-    {                                                \
-        valxy    = valx*thy[ithy];                   \
-        index_xy = index_x+la2*j0[ithy];             \
-                                                     \
-        for(ithz=0; (ithz<order); ithz++)            \
-        {                                            \
-            index_xyz       = index_xy+k0[ithz];     \
-            ptr[index_xyz] += valxy*thz[ithz];       \
-        }                                            \
-    }                                                \
+static int pme_mod(int i,int n)
+{
+    i = i % n;
+
+    return (i < 0 ? i + n : i);
 }
 
+static void pme_block_range(pme_blockdim_t *bd,int b,int *b0,int *bn)
+{
+    *b0 = b*bd->bs;
+    *bn = (b < bd->nb - 1 ? bd->bs : bd->rn - b*bd->bs);
+}
 
+static void pme_spread_region(gmx_pme_t pme,pme_spread_t *sp,
+                              pme_atomcomm_t *atc,int d,int nk)
+{
+    pme_blockdim_t *bd;
+    pme_overlap_t  *ol;
+    bool bPeriodic;
+    int  order,a,lo,hi,b,i,s;
 
-static void spread_q_bsplines(gmx_pme_t pme, pme_atomcomm_t *atc, 
-                              t_fftgrid *grid)
+    bd    = &sp->bd[d];
+    order = pme->pme_order;
+
+    /* Dimensions which are not decomposed are periodic and complete */
+    bPeriodic = (d >= pme->ndecompdim);
+    if (!bPeriodic)
+    {
+        /* The region is at least our slab plus the boundaries we send,
+         * extended when atoms spread outside of it.
+         */
+        ol = &pme->overlap[d];
+        a  = ol->s2g[ol->nodeid];
+        lo = 0;
+        hi = ol->s2g[ol->nodeid+1] - a;
+        for(b=0; b<ol->nleftbnd; b++)
+        {
+            lo -= ol->leftc[b].snds;
+        }
+        for(b=0; b<ol->nrightbnd; b++)
+        {
+            hi += ol->rightc[b].snds;
+        }
+        for(i=0; i<atc->n; i++)
+        {
+            /* The spline start relative to our slab in [-nk/2,nk-nk/2) */
+            s = pme_mod(atc->idx[i][d] + 1 - order/2 - a + nk/2,nk) - nk/2;
+            sp->u[i][d] = s;
+            lo = min(lo,s);
+            hi = max(hi,s + order);
+        }
+        if (hi - lo >= nk)
+        {
+            bPeriodic = TRUE;
+        }
+        else
+        {
+            bd->r0 = a + lo;
+            bd->rn = hi - lo;
+            for(i=0; i<atc->n; i++)
+            {
+                sp->u[i][d] -= lo;
+            }
+        }
+    }
+    if (bPeriodic)
+    {
+        bd->r0 = 0;
+        bd->rn = nk;
+        for(i=0; i<atc->n; i++)
+        {
+            s = atc->idx[i][d] + 1 - order/2;
+            sp->u[i][d] = (s < 0 ? s + nk : s);
+        }
+    }
+    bd->bPeriodic = bPeriodic;
+}
+
+static void pme_block_dim(pme_blockdim_t *bd,int bs)
+{
+    bd->bs = min(bs,bd->rn);
+    bd->nb = bd->rn/bd->bs;
+}
+
+static void pme_spread_setup(gmx_pme_t pme,pme_atomcomm_t *atc,
+                             t_fftgrid *grid)
+{
+    pme_spread_t *sp;
+    int  order,nhalo,bs,bsmin,i,s,b,bx,by,x0,y0,nxb,nyb,nkey,ind,nsub;
+
+    sp    = &pme->spread;
+    order = pme->pme_order;
+    nhalo = order - 1;
+
+    if (atc->n > sp->nalloc)
+    {
+        sp->nalloc = over_alloc_dd(atc->n);
+        srenew(sp->u,sp->nalloc);
+        srenew(sp->key,sp->nalloc);
+        srenew(sp->order,sp->nalloc);
+    }
+
+    /* Choose square blocks such that a sub-grid with full z-lines
+     * and the halo fits in PME_SUBGRID_SIZE reals.
+     */
+    sp->la2s = grid->nz + nhalo;
+    bs = (int)sqrt(PME_SUBGRID_SIZE/sp->la2s) - nhalo;
+    /* The halo should not extend beyond the next block */
+    bsmin = max(nhalo,1);
+    bs = max(bs,bsmin);
+
+    pme_spread_region(pme,sp,atc,XX,grid->nx);
+    pme_spread_region(pme,sp,atc,YY,grid->ny);
+    pme_block_dim(&sp->bd[XX],bs);
+    pme_block_dim(&sp->bd[YY],bs);
+    while (sp->bd[XX].nb*sp->bd[YY].nb < PME_BLOCKS_PER_THREAD*pme->nthread &&
+           bs > bsmin)
+    {
+        bs--;
+        pme_block_dim(&sp->bd[XX],bs);
+        pme_block_dim(&sp->bd[YY],bs);
+    }
+    for(i=0; i<atc->n; i++)
+    {
+        s = atc->idx[i][ZZ] + 1 - order/2;
+        sp->u[i][ZZ] = (s < 0 ? s + grid->nz : s);
+    }
+
+    sp->nblock = sp->bd[XX].nb*sp->bd[YY].nb;
+    /* The last block along x is the largest */
+    sp->nkey_block = sp->bd[XX].rn - (sp->bd[XX].nb - 1)*sp->bd[XX].bs;
+    nkey = sp->nblock*sp->nkey_block;
+    if (nkey + 1 > sp->key_nalloc)
+    {
+        sp->key_nalloc = over_alloc_large(nkey + 1);
+        srenew(sp->key_start,sp->key_nalloc);
+    }
+
+    /* Counting sort of the atoms on block and x-line within the block */
+    for(i=0; i<=nkey; i++)
+    {
+        sp->key_start[i] = 0;
+    }
+    for(i=0; i<atc->n; i++)
+    {
+        bx = min(sp->u[i][XX]/sp->bd[XX].bs,sp->bd[XX].nb - 1);
+        by = min(sp->u[i][YY]/sp->bd[YY].bs,sp->bd[YY].nb - 1);
+        sp->key[i] = (bx*sp->bd[YY].nb + by)*sp->nkey_block
+            + sp->u[i][XX] - bx*sp->bd[XX].bs;
+        sp->key_start[sp->key[i]+1]++;
+    }
+    for(i=0; i<nkey; i++)
+    {
+        sp->key_start[i+1] += sp->key_start[i];
+    }
+    for(i=0; i<atc->n; i++)
+    {
+        sp->order[sp->key_start[sp->key[i]]++] = i;
+    }
+    /* Shift the start indices back */
+    for(i=nkey; i>0; i--)
+    {
+        sp->key_start[i] = sp->key_start[i-1];
+    }
+    sp->key_start[0] = 0;
+
+    /* Set the halo storage, x-halo followed by y-halo for each block */
+    if (sp->nblock + 1 > sp->block_nalloc)
+    {
+        sp->block_nalloc = over_alloc_large(sp->nblock + 1);
+        srenew(sp->halo_ind,sp->block_nalloc);
+    }
+    ind  = 0;
+    nsub = 0;
+    for(bx=0; bx<sp->bd[XX].nb; bx++)
+    {
+        pme_block_range(&sp->bd[XX],bx,&x0,&nxb);
+        for(by=0; by<sp->bd[YY].nb; by++)
+        {
+            pme_block_range(&sp->bd[YY],by,&y0,&nyb);
+            b = bx*sp->bd[YY].nb + by;
+            sp->halo_ind[b] = ind;
+            ind += (nhalo*(nyb + nhalo) + nxb*nhalo)*sp->la2s;
+            nsub = max(nsub,(nxb + nhalo)*(nyb + nhalo)*sp->la2s);
+        }
+    }
+    sp->halo_ind[sp->nblock] = ind;
+    if (ind > sp->halo_nalloc)
+    {
+        sp->halo_nalloc = over_alloc_large(ind);
+        srenew(sp->halo,sp->halo_nalloc);
+    }
+    if (nsub > sp->sub_nalloc)
+    {
+        sp->sub_nalloc = nsub;
+        srenew(sp->subgrid,pme->nthread*sp->sub_nalloc);
+    }
+}
+
+static void pme_add_zline(real *dst,real *src,int nz,int nhalo,bool bAdd)
 {
-  /* spread charges from home atoms to local grid */
-    real     *ptr;
-    pme_overlap_t *ol;
-    int      b,i,nn,n,*i0,*j0,*k0,*ii0,*jj0,*kk0,ithx,ithy,ithz;
-    int      nx,ny,nz,nx2,ny2,nz2,la2,la12;
-    int      order,norder,*idxptr,index_x,index_xy,index_xyz;
+    int k;
+
+    if (bAdd)
+    {
+        for(k=0; k<nz; k++)
+        {
+            dst[k] += src[k];
+        }
+    }
+    else
+    {
+        for(k=0; k<nz; k++)
+        {
+            dst[k]  = src[k];
+        }
+    }
+    /* The periodic z-halo */
+    for(k=0; k<nhalo; k++)
+    {
+        dst[k] += src[nz+k];
+    }
+}
+
+typedef struct {
+    gmx_pme_t      pme;
+    pme_atomcomm_t *atc;
+    t_fftgrid      *grid;
+    bool           bClearF; /* Only for gathering */
+    real           scale;   /* Only for gathering */
+} pme_task_t;
+
+static void spread_block_task(void *data,int b,int thread)
+{
+    /* spread the charges of the atoms of block b and store the block */
+    pme_task_t     *task;
+    gmx_pme_t      pme;
+    pme_atomcomm_t *atc;
+    pme_spread_t   *sp;
+    pme_blockdim_t *bdx,*bdy;
+    real     *ptr,*sub,*hal;
+    int      nx,ny,nz,nx2,ny2,nz2,la2,la12,la2s,la12s;
+    int      order,nhalo,norder,bx,by,x,y,x0,y0,nxb,nyb,ns;
+    int      a,n,*u,ithx,ithy,ithz,index_x,index_xy;
     real     valx,valxy,qn;
     real     *thx,*thy,*thz;
-    int localsize, bndsize;
-  
-    if (pme->ndecompdim == 0) {
-        clear_fftgrid(grid); 
-#ifdef GMX_MPI
-    } else {
-        localsize = grid->la12r*grid->pfft.local_nx;
-        ptr = grid->ptr + grid->la12r*grid->pfft.local_x_start;
-        for (i=0; (i<localsize); i++) {
-            ptr[i] = 0;
+
+    task  = (pme_task_t *)data;
+    pme   = task->pme;
+    atc   = task->atc;
+    unpack_fftgrid(task->grid,&nx,&ny,&nz,&nx2,&ny2,&nz2,&la2,&la12,TRUE,&ptr);
+    order = pme->pme_order;
+    nhalo = order - 1;
+
+    sp    = &pme->spread;
+    bdx   = &sp->bd[XX];
+    bdy   = &sp->bd[YY];
+    la2s  = sp->la2s;
+    sub   = sp->subgrid + thread*sp->sub_nalloc;
+
+    bx    = b/bdy->nb;
+    by    = b - bx*bdy->nb;
+    pme_block_range(bdx,bx,&x0,&nxb);
+    pme_block_range(bdy,by,&y0,&nyb);
+    la12s = (nyb + nhalo)*la2s;
+    ns    = (nxb + nhalo)*la12s;
+    for(x=0; x<ns; x++)
+    {
+        sub[x] = 0;
+    }
+
+    for(a=sp->key_start[b*sp->nkey_block];
+        a<sp->key_start[(b+1)*sp->nkey_block]; a++)
+    {
+        n  = sp->order[a];
+        qn = atc->q[n];
+        if (qn != 0)
+        {
+            u      = sp->u[n];
+            norder = n*order;
+            thx    = atc->theta[XX] + norder;
+            thy    = atc->theta[YY] + norder;
+            thz    = atc->theta[ZZ] + norder;
+
+            index_x = (u[XX] - x0)*la12s + (u[YY] - y0)*la2s + u[ZZ];
+            for(ithx=0; (ithx<order); ithx++)
+            {
+                valx     = qn*thx[ithx];
+                index_xy = index_x;
+                for(ithy=0; (ithy<order); ithy++)
+                {
+                    valxy = valx*thy[ithy];
+                    for(ithz=0; (ithz<order); ithz++)
+                    {
+                        sub[index_xy+ithz] += valxy*thz[ithz];
+                    }
+                    index_xy += la2s;
+                }
+                index_x += la12s;
+            }
         }
-        ol = &pme->overlap[0];
-        /* clear left boundary area */
-        for(b=0; b<ol->nleftbnd; b++) {
-            ptr     = grid->ptr + ol->leftc[b].snd0*grid->la12r;
-            bndsize =             ol->leftc[b].snds*grid->la12r;
-            for (i=0; (i<bndsize); i++) {
-                ptr[i] = 0;
+    }
+
+    /* Store the interior in the grid, this also clears the grid */
+    for(x=0; x<nxb; x++)
+    {
+        for(y=0; y<nyb; y++)
+        {
+            pme_add_zline(ptr + pme_mod(bdx->r0 + x0 + x,nx)*la12
+                              + pme_mod(bdy->r0 + y0 + y,ny)*la2,
+                          sub + x*la12s + y*la2s,nz,nhalo,FALSE);
+        }
+    }
+    /* Save the x-halo and y-halo, the grid cells they belong to
+     * can be stored later by another block.
+     */
+    hal = sp->halo + sp->halo_ind[b];
+    memcpy(hal,sub + nxb*la12s,nhalo*la12s*sizeof(real));
+    hal += nhalo*la12s;
+    for(x=0; x<nxb; x++)
+    {
+        memcpy(hal + x*nhalo*la2s,sub + x*la12s + nyb*la2s,
+               nhalo*la2s*sizeof(real));
+    }
+}
+
+static void spread_halo_task(void *data,int b,int thread)
+{
+    /* add the halos of the preceding blocks to block b,
+     * only the grid cells of block b are modified.
+     */
+    pme_task_t     *task;
+    pme_spread_t   *sp;
+    pme_blockdim_t *bdx,*bdy;
+    real     *ptr,*hal;
+    int      nx,ny,nz,nx2,ny2,nz2,la2,la12,la2s,la12h;
+    int      nhalo,bs,bx,by,bxs,bys,x,y,x0,y0,nxb,nyb,nys;
+
+    task  = (pme_task_t *)data;
+    unpack_fftgrid(task->grid,&nx,&ny,&nz,&nx2,&ny2,&nz2,&la2,&la12,TRUE,&ptr);
+    nhalo = task->pme->pme_order - 1;
+
+    sp    = &task->pme->spread;
+    bdx   = &sp->bd[XX];
+    bdy   = &sp->bd[YY];
+    la2s  = sp->la2s;
+
+    bx    = b/bdy->nb;
+    by    = b - bx*bdy->nb;
+    pme_block_range(bdx,bx,&x0,&nxb);
+    pme_block_range(bdy,by,&y0,&nyb);
+    bxs = (bx > 0 ? bx - 1 : (bdx->bPeriodic ? bdx->nb - 1 : -1));
+    bys = (by > 0 ? by - 1 : (bdy->bPeriodic ? bdy->nb - 1 : -1));
+    if (bxs >= 0)
+    {
+        /* The x-halo of the block below along x */
+        bs    = bxs*bdy->nb + by;
+        la12h = (nyb + nhalo)*la2s;
+        hal   = sp->halo + sp->halo_ind[bs];
+        for(x=0; x<nhalo; x++)
+        {
+            for(y=0; y<nyb; y++)
+            {
+                pme_add_zline(ptr + pme_mod(bdx->r0 + x0 + x,nx)*la12
+                                  + pme_mod(bdy->r0 + y0 + y,ny)*la2,
+                              hal + x*la12h + y*la2s,nz,nhalo,TRUE);
             }
         }
-        /* clear right boundary area */
-        for(b=0; b<ol->nrightbnd; b++) {
-            ptr     = grid->ptr + ol->rightc[b].snd0*grid->la12r;
-            bndsize =             ol->rightc[b].snds*grid->la12r;
-            for (i=0; (i<bndsize); i++) {
-                ptr[i] = 0;
+    }
+    if (bys >= 0)
+    {
+        /* The y-halo of the block below along y */
+        bs  = bx*bdy->nb + bys;
+        pme_block_range(bdy,bys,&y,&nys);
+        hal = sp->halo + sp->halo_ind[bs] + nhalo*(nys + nhalo)*la2s;
+        for(x=0; x<nxb; x++)
+        {
+            for(y=0; y<nhalo; y++)
+            {
+                pme_add_zline(ptr + pme_mod(bdx->r0 + x0 + x,nx)*la12
+                                  + pme_mod(bdy->r0 + y0 + y,ny)*la2,
+                              hal + (x*nhalo + y)*la2s,nz,nhalo,TRUE);
             }
         }
-#endif
     }
+    if (bxs >= 0 && bys >= 0)
+    {
+        /* The corner of the x-halo of the block below along x and y */
+        bs    = bxs*bdy->nb + bys;
+        pme_block_range(bdy,bys,&y,&nys);
+        la12h = (nys + nhalo)*la2s;
+        hal   = sp->halo + sp->halo_ind[bs];
+        for(x=0; x<nhalo; x++)
+        {
+            for(y=0; y<nhalo; y++)
+            {
+                pme_add_zline(ptr + pme_mod(bdx->r0 + x0 + x,nx)*la12
+                                  + pme_mod(bdy->r0 + y0 + y,ny)*la2,
+                              hal + x*la12h + (nys + y)*la2s,
+                              nz,nhalo,TRUE);
+            }
+        }
+    }
+}
 
-    unpack_fftgrid(grid,&nx,&ny,&nz,&nx2,&ny2,&nz2,&la2,&la12,TRUE,&ptr);
-    order = pme->pme_order;
+static void spread_q_bsplines(gmx_pme_t pme, pme_atomcomm_t *atc, 
+                              t_fftgrid *grid)
+{
+    /* spread charges from home atoms to local grid */
+    pme_task_t task;
 
-    ii0   = pme->nnx + nx2 + 1 - order/2;
-    jj0   = pme->nny + ny2 + 1 - order/2;
-    kk0   = pme->nnz + nz2 + 1 - order/2;
-    
-    switch (order) 
-	{
-		case 4:
-			for(nn=0; (nn<atc->n);nn++) 
-			{
-				n      = nn;
-				qn     = atc->q[n];
-				idxptr = atc->idx[n];
-
-				if(qn != 0) 
-				{
-					norder = n*4;
-					
-					/* Pointer arithmetic alert, next six statements */
-					i0  = ii0 + idxptr[XX]; 
-					j0  = jj0 + idxptr[YY];
-					k0  = kk0 + idxptr[ZZ];
-					thx = atc->theta[XX] + norder;
-					thy = atc->theta[YY] + norder;
-					thz = atc->theta[ZZ] + norder;
-					
-#if ((defined __IBMC__ || defined __IBMCPP__) && defined _IBMSMP)
-					/* Magic optimization pragma proposed by Mathias Puetz */
-#pragma ibm independent_loop
-#endif
-					DO_BSPLINE(4);
-				}
-			}
-			break;
-			
-		default:
-			for(nn=0; (nn<atc->n); nn++) 
-			{
-				n = nn;
-				qn     = atc->q[n];
-				idxptr = atc->idx[n];
-				
-				if (qn != 0) 
-				{
-					norder  = n*order;
-					
-					/* Pointer arithmetic alert, next six statements */
-					i0  = ii0 + idxptr[XX]; 
-					j0  = jj0 + idxptr[YY];
-					k0  = kk0 + idxptr[ZZ];
-					thx = atc->theta[XX] + norder;
-					thy = atc->theta[YY] + norder;
-					thz = atc->theta[ZZ] + norder;
-			
-#if ((defined __IBMC__ || defined __IBMCPP__) && defined _IBMSMP)
-					/* Magic optimization pragma proposed by Mathias Puetz */
-#pragma ibm independent_loop
-#endif
-					DO_BSPLINE(order);
-				}
-			}
-			break;
-			
-    }
-	
+    task.pme  = pme;
+    task.atc  = atc;
+    task.grid = grid;
+
+    /* All blocks need to be stored before the halos can be added */
+    pme_run_tasks(pme,pme->spread.nblock,spread_block_task,&task);
+    pme_run_tasks(pme,pme->spread.nblock,spread_halo_task,&task);
 }
 
-real solve_pme(gmx_pme_t pme,t_fftgrid *grid,
-               real ewaldcoeff,real vol,matrix vir,t_commrec *cr)
+typedef struct {
+    gmx_pme_t pme;
+    t_fftgrid *grid;
+    real      ewaldcoeff;
+    real      vol;
+    int       kystart,kyend;     /* The local ky range */
+    int       kzlocal0,kzlocal1; /* The local kz range */
+} pme_solve_task_t;
+
+static void solve_pme_task(void *data,int task_ind,int thread)
 {
-    /* do recip sum over local cells in grid */
+    /* do recip sum over the local cells of a part of the ky range */
+    pme_solve_task_t *task;
+    gmx_pme_t pme;
     t_complex *ptr,*p0;
     int     nx,ny,nz,nx2,ny2,nz2,la2,la12;
-    int     kx,ky,kz,maxkx,maxky,maxkz,kystart=0,kyend=0,kzstart;
+    int     kx,ky,kz,maxkx,maxky,maxkz,kystart,kyend,kzstart;
+    int     kzlocal0,kzlocal1;
     real    mx,my,mz;
-    real    factor=M_PI*M_PI/(ewaldcoeff*ewaldcoeff);
+    real    factor;
     real    ets2,struct2,vfactor,ets2vf;
     real    eterm,d1,d2,energy=0;
     real    bx,by;
@@ -1000,8 +1542,11 @@ real solve_pme(gmx_pme_t pme,t_fftgrid *grid,
 #pragma disjoint(*mhz,*m2,*denom,*tmp1,*m2inv,*p0)
 #endif
 	
-    unpack_fftgrid(grid,&nx,&ny,&nz,
+    task = (pme_solve_task_t *)data;
+    pme  = task->pme;
+    unpack_fftgrid(task->grid,&nx,&ny,&nz,
                    &nx2,&ny2,&nz2,&la2,&la12,FALSE,(real **)&ptr);
+    factor = M_PI*M_PI/(task->ewaldcoeff*task->ewaldcoeff);
     rxx = pme->recipbox[XX][XX];
     ryx = pme->recipbox[YY][XX];
     ryy = pme->recipbox[YY][YY];
@@ -1013,38 +1558,19 @@ real solve_pme(gmx_pme_t pme,t_fftgrid *grid,
     maxky = (ny+1)/2;
     maxkz = nz/2+1;
 
-	if(maxkz > pme->maxkz)
-	{
-		/* At the moment the dimensions are actually fixed, but this is for the future... */
-		srenew(pme->work_mhz,maxkz);
-		srenew(pme->work_m2,maxkz);
-		srenew(pme->work_denom,maxkz);
-		srenew(pme->work_tmp1,maxkz);
-		srenew(pme->work_m2inv,maxkz);
-		pme->maxkz=maxkz;
-	}
-	
-	mhz   = pme->work_mhz;
-	m2    = pme->work_m2;
-	denom = pme->work_denom;
-	tmp1  = pme->work_tmp1;
-	m2inv = pme->work_m2inv;	
-	
-    if (pme->ndecompdim > 0) { 
-        /* transpose X & Y and only sum local cells */
-#ifdef GMX_MPI
-        kystart = grid->pfft.local_y_start_after_transpose;
-        kyend   = kystart+grid->pfft.local_ny_after_transpose;
-        if (debug)
-            fprintf(debug,"solve_pme: kystart = %d, kyend=%d\n",kystart,kyend);
-#else
-        gmx_fatal(FARGS,"Parallel PME attempted without MPI and FFTW");
-#endif /* end of parallel case loop */
-    }
-    else {
-        kystart = 0;
-        kyend   = ny;
-    }
+	/* Each thread uses its own part of the work arrays */
+	mhz   = pme->work_mhz   + thread*pme->maxkz;
+	m2    = pme->work_m2    + thread*pme->maxkz;
+	denom = pme->work_denom + thread*pme->maxkz;
+	tmp1  = pme->work_tmp1  + thread*pme->maxkz;
+	m2inv = pme->work_m2inv + thread*pme->maxkz;
+
+    kystart  = task->kystart +
+        ((task->kyend - task->kystart)*task_ind)/pme->nthread;
+    kyend    = task->kystart +
+        ((task->kyend - task->kystart)*(task_ind + 1))/pme->nthread;
+    kzlocal0 = task->kzlocal0;
+    kzlocal1 = task->kzlocal1;
     
     for(ky=kystart; (ky<kyend); ky++) {  /* our local cells */
         
@@ -1053,7 +1579,7 @@ real solve_pme(gmx_pme_t pme,t_fftgrid *grid,
         } else {
             my = (ky-ny);
         }
-        by = M_PI*vol*pme->bsp_mod[YY][ky];
+        by = M_PI*task->vol*pme->bsp_mod[YY][ky];
         
         for(kx=0; (kx<nx); kx++) {    
             if(kx < maxkx) {
@@ -1067,31 +1593,30 @@ real solve_pme(gmx_pme_t pme,t_fftgrid *grid,
             
             bx = pme->bsp_mod[XX][kx];
             
-            if (pme->nnodes > 1) {
-                p0 = ptr + INDEX(ky,kx,0); /* Pointer Arithmetic */
+            if ((kx>0) || (ky>0) || kzlocal0 > 0) {
+                kzstart = kzlocal0;
             } else {
-                p0 = ptr + INDEX(kx,ky,0); /* Pointer Arithmetic */
+                kzstart = 1;
             }
             
-            if ((kx>0) || (ky>0)) {
-                kzstart = 0;
+            if (pme->nnodes > 1) {
+                p0 = ptr + INDEX(ky,kx,kzstart); /* Pointer Arithmetic */
             } else {
-                kzstart = 1;
-                p0++;
+                p0 = ptr + INDEX(kx,ky,kzstart); /* Pointer Arithmetic */
             }
 			
-            for(kz=kzstart,mz=kzstart; (kz<maxkz); kz++,mz+=1.0)  {
+            for(kz=kzstart,mz=kzstart; (kz<kzlocal1); kz++,mz+=1.0)  {
                 mhz[kz]   = mx * rzx + my * rzy + mz * rzz;
                 m2[kz]    = mhx*mhx+mhy*mhy+mhz[kz]*mhz[kz];
                 denom[kz] = m2[kz]*bx*by*pme->bsp_mod[ZZ][kz];
                 tmp1[kz]  = -factor*m2[kz];
             }
 			
-            for(kz=kzstart; (kz<maxkz); kz++) m2inv[kz] = 1.0/m2[kz];
-            for(kz=kzstart; (kz<maxkz); kz++) denom[kz] = 1.0/denom[kz];
-            for(kz=kzstart; (kz<maxkz); kz++) tmp1[kz]  = exp(tmp1[kz]);
+            for(kz=kzstart; (kz<kzlocal1); kz++) m2inv[kz] = 1.0/m2[kz];
+            for(kz=kzstart; (kz<kzlocal1); kz++) denom[kz] = 1.0/denom[kz];
+            for(kz=kzstart; (kz<kzlocal1); kz++) tmp1[kz]  = exp(tmp1[kz]);
 			
-            for(kz=kzstart; (kz<maxkz); kz++,p0++)  {
+            for(kz=kzstart; (kz<kzlocal1); kz++,p0++)  {
                 d1      = p0->re;
                 d2      = p0->im;
                
@@ -1109,10 +1634,11 @@ real solve_pme(gmx_pme_t pme,t_fftgrid *grid,
             if (kzstart == 0)
                 tmp1[0] *= 0.5;
 			
-            if (((nz+1)/2) < maxkz)
+            if (((nz+1)/2) < maxkz &&
+                ((nz+1)/2) >= kzstart && ((nz+1)/2) < kzlocal1)
                 tmp1[((nz+1)/2)] *= 0.5;
 			
-            for(kz=kzstart; (kz<maxkz); kz++)  {
+            for(kz=kzstart; (kz<kzlocal1); kz++)  {
                 ets2     = tmp1[kz];
                 vfactor  = (factor*m2[kz]+1.0)*2.0*m2inv[kz];
                 energy  += ets2;
@@ -1128,6 +1654,81 @@ real solve_pme(gmx_pme_t pme,t_fftgrid *grid,
         }
     }
     
+    pme->work_energy[task_ind]        = energy;
+    pme->work_vir[task_ind][XX][XX]   = virxx;
+    pme->work_vir[task_ind][YY][YY]   = viryy;
+    pme->work_vir[task_ind][ZZ][ZZ]   = virzz;
+    pme->work_vir[task_ind][XX][YY]   = virxy;
+    pme->work_vir[task_ind][XX][ZZ]   = virxz;
+    pme->work_vir[task_ind][YY][ZZ]   = viryz;
+}
+
+real solve_pme(gmx_pme_t pme,t_fftgrid *grid,
+               real ewaldcoeff,real vol,matrix vir,t_commrec *cr)
+{
+    /* do recip sum over local cells in grid */
+    pme_solve_task_t task;
+    int     nx,ny,nz,nx2,ny2,nz2,la2,la12,maxkz,t;
+    real    energy=0;
+    real    virxx=0,virxy=0,virxz=0,viryy=0,viryz=0,virzz=0;
+    real    *ptr;
+	
+    unpack_fftgrid(grid,&nx,&ny,&nz,
+                   &nx2,&ny2,&nz2,&la2,&la12,FALSE,&ptr);
+    
+    maxkz = nz/2+1;
+
+	if(maxkz > pme->maxkz)
+	{
+		/* At the moment the dimensions are actually fixed, but this is for the future... */
+		srenew(pme->work_mhz,maxkz*pme->nthread);
+		srenew(pme->work_m2,maxkz*pme->nthread);
+		srenew(pme->work_denom,maxkz*pme->nthread);
+		srenew(pme->work_tmp1,maxkz*pme->nthread);
+		srenew(pme->work_m2inv,maxkz*pme->nthread);
+		pme->maxkz=maxkz;
+	}
+	
+    task.pme        = pme;
+    task.grid       = grid;
+    task.ewaldcoeff = ewaldcoeff;
+    task.vol        = vol;
+    if (pme->ndecompdim > 0) { 
+        /* transpose X & Y and only sum local cells */
+#ifdef GMX_MPI
+        task.kystart  = grid->pfft.local_y_start_after_transpose;
+        task.kyend    = task.kystart+grid->pfft.local_ny_after_transpose;
+        /* With pencil decomposition kz is also distributed */
+        task.kzlocal0 = grid->pfft.local_zc_start_after_transpose;
+        task.kzlocal1 = task.kzlocal0+grid->pfft.local_nzc_after_transpose;
+        if (debug)
+            fprintf(debug,"solve_pme: kystart = %d, kyend=%d, kzstart = %d, kzend = %d\n",task.kystart,task.kyend,task.kzlocal0,task.kzlocal1);
+#else
+        gmx_fatal(FARGS,"Parallel PME attempted without MPI and FFTW");
+#endif /* end of parallel case loop */
+    }
+    else {
+        task.kystart  = 0;
+        task.kyend    = ny;
+        task.kzlocal0 = 0;
+        task.kzlocal1 = maxkz;
+    }
+
+    /* Divide the ky range over the threads */
+    pme_run_tasks(pme,pme->nthread,solve_pme_task,&task);
+
+    /* Sum in a fixed order for reproducibility */
+    for(t=0; t<pme->nthread; t++)
+    {
+        energy += pme->work_energy[t];
+        virxx  += pme->work_vir[t][XX][XX];
+        viryy  += pme->work_vir[t][YY][YY];
+        virzz  += pme->work_vir[t][ZZ][ZZ];
+        virxy  += pme->work_vir[t][XX][YY];
+        virxz  += pme->work_vir[t][XX][ZZ];
+        viryz  += pme->work_vir[t][YY][ZZ];
+    }
+    
     /* Update virial with local values. The virial is symmetric by definition.
      * this virial seems ok for isotropic scaling, but I'm
      * experiencing problems on semiisotropic membranes.
@@ -1144,59 +1745,33 @@ real solve_pme(gmx_pme_t pme,t_fftgrid *grid,
     return(0.5*energy);
 }
 
-#define DO_FSPLINE(order)                      \
-for(ithx=0; (ithx<order); ithx++)              \
-{           								   \
-    index_x = la12*i0[ithx];                   \
-    tx      = thx[ithx];                       \
-    dx      = dthx[ithx];                      \
-											   \
-    for(ithy=0; (ithy<order); ithy++)          \
-	{										   \
-        index_xy = index_x+la2*j0[ithy];       \
-        ty       = thy[ithy];                  \
-        dy       = dthy[ithy];                 \
-        fxy1     = fz1 = 0;                    \
-                                               \
-        for(ithz=0; (ithz<order); ithz++)      \
-		{     								   \
-		gval  = ptr[index_xy+k0[ithz]];        \
-		fxy1 += thz[ithz]*gval;                \
-		fz1  += dthz[ithz]*gval;               \
-		}                                      \
-		fx += dx*ty*fxy1;                      \
-		fy += tx*dy*fxy1;                      \
-		fz += tx*ty*fz1;                       \
-	}                                          \
-}
-
-
-void gather_f_bsplines(gmx_pme_t pme,t_fftgrid *grid,
-                       bool bClearF,pme_atomcomm_t *atc,real scale)
+static void gather_block_task(void *data,int b,int thread)
 {
-    /* sum forces for local particles */  
-    int     nn,n,*i0,*j0,*k0,*ii0,*jj0,*kk0,ithx,ithy,ithz;
-    int     nx,ny,nz,nx2,ny2,nz2,la2,la12,index_x,index_xy;
+    /* sum forces for the particles of block b */  
+    pme_task_t     *task;
+    gmx_pme_t      pme;
+    pme_atomcomm_t *atc;
+    pme_spread_t   *sp;
+    pme_blockdim_t *bdx,*bdy;
+    int     a,n,*u,ithx,ithy,ithz,k;
+    int     nx,ny,nz,nx2,ny2,nz2,la2,la12,la2s,la12s,index_x,index_xy;
+    int     bx,by,x,y,x0,y0,nxb,nyb,nhalo;
     real *  ptr;
+    real    *sub,*src,*dst;
     real    tx,ty,dx,dy,qn;
     real    fx,fy,fz,gval;
     real    fxy1,fz1;
     real    *thx,*thy,*thz,*dthx,*dthy,*dthz;
-    int     norder,*idxptr;
+    int     norder;
     real    rxx,ryx,ryy,rzx,rzy,rzz;
     int     order;
     
-    unpack_fftgrid(grid,&nx,&ny,&nz,&nx2,&ny2,&nz2,&la2,&la12,TRUE,&ptr);
+    task  = (pme_task_t *)data;
+    pme   = task->pme;
+    atc   = task->atc;
+    unpack_fftgrid(task->grid,&nx,&ny,&nz,&nx2,&ny2,&nz2,&la2,&la12,TRUE,&ptr);
     order = pme->pme_order;
-    thx   = atc->theta[XX];
-    thy   = atc->theta[YY];
-    thz   = atc->theta[ZZ];
-    dthx  = atc->dtheta[XX];
-    dthy  = atc->dtheta[YY];
-    dthz  = atc->dtheta[ZZ];
-    ii0   = pme->nnx + nx2 + 1 - order/2;
-    jj0   = pme->nny + ny2 + 1 - order/2;
-    kk0   = pme->nnz + nz2 + 1 - order/2;
+    nhalo = order - 1;
     
     rxx   = pme->recipbox[XX][XX];
     ryx   = pme->recipbox[YY][XX];
@@ -1205,11 +1780,50 @@ void gather_f_bsplines(gmx_pme_t pme,t_fftgrid *grid,
     rzy   = pme->recipbox[ZZ][YY];
     rzz   = pme->recipbox[ZZ][ZZ];
 
-    for(nn=0; (nn<atc->n); nn++) {
-        n = nn;
-        qn      = scale*atc->q[n];
-        
-        if (bClearF) {
+    sp    = &pme->spread;
+    bdx   = &sp->bd[XX];
+    bdy   = &sp->bd[YY];
+    la2s  = sp->la2s;
+    sub   = sp->subgrid + thread*sp->sub_nalloc;
+
+    bx    = b/bdy->nb;
+    by    = b - bx*bdy->nb;
+    pme_block_range(bdx,bx,&x0,&nxb);
+    pme_block_range(bdy,by,&y0,&nyb);
+    la12s = (nyb + nhalo)*la2s;
+
+    if (sp->key_start[b*sp->nkey_block] ==
+        sp->key_start[(b+1)*sp->nkey_block])
+    {
+        return;
+    }
+
+    /* Copy the block with its halo from the grid */
+    for(x=0; x<nxb+nhalo; x++)
+    {
+        for(y=0; y<nyb+nhalo; y++)
+        {
+            src = ptr + pme_mod(bdx->r0 + x0 + x,nx)*la12
+                      + pme_mod(bdy->r0 + y0 + y,ny)*la2;
+            dst = sub + x*la12s + y*la2s;
+            for(k=0; k<nz; k++)
+            {
+                dst[k] = src[k];
+            }
+            for(k=0; k<nhalo; k++)
+            {
+                dst[nz+k] = src[k];
+            }
+        }
+    }
+
+    for(a=sp->key_start[b*sp->nkey_block];
+        a<sp->key_start[(b+1)*sp->nkey_block]; a++)
+    {
+        n  = sp->order[a];
+        qn = task->scale*atc->q[n];
+
+        if (task->bClearF) {
             atc->f[n][XX] = 0;
             atc->f[n][YY] = 0;
             atc->f[n][ZZ] = 0;
@@ -1218,35 +1832,62 @@ void gather_f_bsplines(gmx_pme_t pme,t_fftgrid *grid,
             fx     = 0;
             fy     = 0;
             fz     = 0;
-            idxptr = atc->idx[n];
+            u      = sp->u[n];
             norder = n*order;
-            
-            /* Pointer arithmetic alert, next nine statements */
-            i0   = ii0 + idxptr[XX]; 
-            j0   = jj0 + idxptr[YY];
-            k0   = kk0 + idxptr[ZZ];
-            thx  = atc->theta[XX] + norder;
-            thy  = atc->theta[YY] + norder;
-            thz  = atc->theta[ZZ] + norder;
-            dthx = atc->dtheta[XX] + norder;
-            dthy = atc->dtheta[YY] + norder;
-            dthz = atc->dtheta[ZZ] + norder;
-            
-            switch(order)
-			{
-				case 4 :
-					DO_FSPLINE(4);
-					break;
-				default:
-					DO_FSPLINE(order);
-					break;
+            thx    = atc->theta[XX] + norder;
+            thy    = atc->theta[YY] + norder;
+            thz    = atc->theta[ZZ] + norder;
+            dthx   = atc->dtheta[XX] + norder;
+            dthy   = atc->dtheta[YY] + norder;
+            dthz   = atc->dtheta[ZZ] + norder;
+
+            index_x = (u[XX] - x0)*la12s + (u[YY] - y0)*la2s + u[ZZ];
+            for(ithx=0; (ithx<order); ithx++)
+            {
+                tx       = thx[ithx];
+                dx       = dthx[ithx];
+                index_xy = index_x;
+                for(ithy=0; (ithy<order); ithy++)
+                {
+                    ty   = thy[ithy];
+                    dy   = dthy[ithy];
+                    fxy1 = fz1 = 0;
+                    for(ithz=0; (ithz<order); ithz++)
+                    {
+                        gval  = sub[index_xy+ithz];
+                        fxy1 += thz[ithz]*gval;
+                        fz1  += dthz[ithz]*gval;
+                    }
+                    fx += dx*ty*fxy1;
+                    fy += tx*dy*fxy1;
+                    fz += tx*ty*fz1;
+                    index_xy += la2s;
+                }
+                index_x += la12s;
             }
-			
+
             atc->f[n][XX] += -qn*( fx*nx*rxx );
             atc->f[n][YY] += -qn*( fx*nx*ryx + fy*ny*ryy );
             atc->f[n][ZZ] += -qn*( fx*nx*rzx + fy*ny*rzy + fz*nz*rzz );
         }
     }
+}
+
+void gather_f_bsplines(gmx_pme_t pme,t_fftgrid *grid,
+                       bool bClearF,pme_atomcomm_t *atc,real scale)
+{
+    /* sum forces for local particles */  
+    pme_task_t task;
+
+    task.pme     = pme;
+    task.atc     = atc;
+    task.grid    = grid;
+    task.bClearF = bClearF;
+    task.scale   = scale;
+
+    /* Use the blocks and atom order of the last spread */
+    pme_run_tasks(pme,pme->spread.nblock,gather_block_task,&task);
+
     /* Since the energy and not forces are interpolated
      * the net force might not be exactly zero.
      * This can be solved by also interpolating F, but
@@ -1487,6 +2128,21 @@ int gmx_pme_destroy(FILE *log,gmx_pme_t *pmedata)
     sfree((*pmedata)->work_denom);
     sfree((*pmedata)->work_tmp1);
     sfree((*pmedata)->work_m2inv);
+    sfree((*pmedata)->work_energy);
+    sfree((*pmedata)->work_vir);
+
+    sfree((*pmedata)->spread.u);
+    sfree((*pmedata)->spread.key);
+    sfree((*pmedata)->spread.order);
+    sfree((*pmedata)->spread.key_start);
+    sfree((*pmedata)->spread.halo_ind);
+    sfree((*pmedata)->spread.halo);
+    sfree((*pmedata)->spread.subgrid);
+
+    if ((*pmedata)->pool)
+    {
+        gmx_thread_pool_done((*pmedata)->pool);
+    }
 	
     sfree(*pmedata);
     *pmedata = NULL;
@@ -1575,20 +2231,26 @@ static void init_atomcomm(gmx_pme_t pme,pme_atomcomm_t *atc,
     }
 }
 
-static void init_overlap_comm(gmx_pme_t pme,pme_overlap_t *ol)
+static void init_overlap_comm(gmx_pme_t pme,pme_overlap_t *ol,int dimind)
 {
     int lbnd,rbnd,maxlr,b,i;
     int nn,nk;
     pme_grid_comm_t *pgc;
 
+    ol->dimind = dimind;
+    ol->nslab  = 1;
+    ol->nodeid = 0;
 #ifdef GMX_MPI
-    ol->mpi_comm = pme->mpi_comm;
+    ol->mpi_comm = pme->mpi_comm_d[dimind];
+    MPI_Comm_size(ol->mpi_comm,&ol->nslab);
+    MPI_Comm_rank(ol->mpi_comm,&ol->nodeid);
 #endif
-
-    ol->nodeid = pme->nodeid;
+    ol->buf_nalloc = 0;
+    ol->sendbuf    = NULL;
+    ol->recvbuf    = NULL;
     
-    nn = pme->nnodes;
-    nk = pme->nkx;
+    nn = ol->nslab;
+    nk = (dimind == 0 ? pme->nkx : pme->nky);
 
     /* Determine the grid boundary communication sizes and nodes */
     if (nk % nn == 0) {
@@ -1620,7 +2282,7 @@ static void init_overlap_comm(gmx_pme_t pme,pme_overlap_t *ol)
         /* Send */
         i = ol->s2g[ol->nodeid];
         if (ol->leftid[b] > ol->nodeid) {
-            i += pme->nkx;
+            i += nk;
         }
         pgc->snd0 = max(i - lbnd,ol->s2g[ol->leftid[b]]);
         pgc->snds = min(i       ,ol->s2g[ol->leftid[b]+1]) - pgc->snd0;
@@ -1628,7 +2290,7 @@ static void init_overlap_comm(gmx_pme_t pme,pme_overlap_t *ol)
         /* Receive */
         i = ol->s2g[ol->rightid[b]];
         if (ol->rightid[b] < ol->nodeid)
-            i += pme->nkx;
+            i += nk;
         pgc->rcv0 = max(i - lbnd,ol->s2g[ol->nodeid]);
         pgc->rcvs = min(i       ,ol->s2g[ol->nodeid+1]) - pgc->rcv0;
         pgc->rcvs = max(pgc->rcvs,0);
@@ -1647,11 +2309,25 @@ static void init_overlap_comm(gmx_pme_t pme,pme_overlap_t *ol)
         /* Receive */
         i = ol->s2g[ol->leftid[b]+1];
         if (ol->leftid[b] > ol->nodeid)
-            i -= pme->nkx;
+            i -= nk;
         pgc->rcv0 = max(i       ,ol->s2g[ol->nodeid]);
         pgc->rcvs = min(i + rbnd,ol->s2g[ol->nodeid+1]) - pgc->rcv0;
         pgc->rcvs = max(pgc->rcvs,0);
     }
+    /* The grid lines we spread on */
+    ol->nseg = 1 + ol->nleftbnd + ol->nrightbnd;
+    snew(ol->seg0,ol->nseg);
+    snew(ol->segn,ol->nseg);
+    ol->seg0[0] = ol->s2g[ol->nodeid];
+    ol->segn[0] = ol->s2g[ol->nodeid+1] - ol->seg0[0];
+    for(b=0; b<ol->nleftbnd; b++) {
+        ol->seg0[1+b] = ol->leftc[b].snd0;
+        ol->segn[1+b] = ol->leftc[b].snds;
+    }
+    for(b=0; b<ol->nrightbnd; b++) {
+        ol->seg0[1+ol->nleftbnd+b] = ol->rightc[b].snd0;
+        ol->segn[1+ol->nleftbnd+b] = ol->rightc[b].snds;
+    }
 }
 
 int gmx_pme_init(gmx_pme_t *pmedata,t_commrec *cr,int nnodes_major,
@@ -1663,6 +2339,7 @@ int gmx_pme_init(gmx_pme_t *pmedata,t_commrec *cr,int nnodes_major,
     
     pme_atomcomm_t *atc;
     int nminor,b,d,i,lbnd,rbnd,maxlr;
+    char *env;
     
     if (debug)
         fprintf(debug,"Creating PME data structures.\n");
@@ -1729,9 +2406,9 @@ int gmx_pme_init(gmx_pme_t *pmedata,t_commrec *cr,int nnodes_major,
     }
     
     if (pme->nkx <= pme->pme_order*(pme->nnodes > 1 ? 2 : 1) ||
-        pme->nky <= pme->pme_order ||
+        pme->nky <= pme->pme_order*(pme->ndecompdim >= 2 ? 2 : 1) ||
         pme->nkz <= pme->pme_order)
-        gmx_fatal(FARGS,"The pme grid dimensions need to be larger than pme_order (%d) and in parallel larger than 2*pme_order for x",pme->pme_order);
+        gmx_fatal(FARGS,"The pme grid dimensions need to be larger than pme_order (%d) and in parallel larger than 2*pme_order for x%s",pme->pme_order,pme->ndecompdim >= 2 ? " and y" : "");
     
     if (pme->nnodes > 1) {
 #ifdef GMX_MPI
@@ -1745,7 +2422,8 @@ int gmx_pme_init(gmx_pme_t *pmedata,t_commrec *cr,int nnodes_major,
          * (unless the charge distribution is inhomogeneous).
          */
         
-        if (pme_inconvenient_nnodes(pme->nkx,pme->nky,pme->nnodes) &&
+        if (pme->ndecompdim == 1 &&
+            pme_inconvenient_nnodes(pme->nkx,pme->nky,pme->nnodes) &&
             pme->nodeid == 0) {
             fprintf(stderr,
                     "\n"
@@ -1762,11 +2440,44 @@ int gmx_pme_init(gmx_pme_t *pmedata,t_commrec *cr,int nnodes_major,
                 fprintf(debug,"Warning: For load balance, fourier_nx should be divisible by the number of PME nodes\n");
         }
 
-        init_overlap_comm(pme,&pme->overlap[0]);
+        init_overlap_comm(pme,&pme->overlap[0],0);
+        if (pme->ndecompdim >= 2)
+        {
+            init_overlap_comm(pme,&pme->overlap[1],1);
+            if (debug)
+            {
+                fprintf(debug,"PME pencil decomposition: %d x %d nodes\n",
+                        pme->overlap[0].nslab,pme->overlap[1].nslab);
+            }
+        }
     } else {
         pme->overlap[0].s2g = NULL;
     }
     
+    /* Nodes which only do PME can use threads for all PME tasks */
+    pme->nthread = 1;
+    pme->pool    = NULL;
+    if (!(cr->duty & DUTY_PP) && (env = getenv("GMX_PME_NTHREADS")) != NULL)
+    {
+        pme->nthread = max(1,strtol(env,NULL,10));
+        if (pme->nthread > 1)
+        {
+            pme->pool    = gmx_thread_pool_init(pme->nthread);
+            pme->nthread = gmx_thread_pool_nthreads(pme->pool);
+            if (pme->nthread == 1)
+            {
+                /* No thread support */
+                gmx_thread_pool_done(pme->pool);
+                pme->pool = NULL;
+            }
+        }
+        if (pme->nodeid == 0)
+        {
+            fprintf(stderr,"Using %d thread%s per PME node\n",
+                    pme->nthread,pme->nthread > 1 ? "s" : "");
+        }
+    }
+
     /* With domain decomposition we need nnx on the PP only nodes */
     snew(pme->nnx,5*pme->nkx);
     snew(pme->nny,5*pme->nky);
@@ -1785,17 +2496,48 @@ int gmx_pme_init(gmx_pme_t *pmedata,t_commrec *cr,int nnodes_major,
     snew(pme->bsp_mod[YY],pme->nky);
     snew(pme->bsp_mod[ZZ],pme->nkz);
     
-    pme->gridA = mk_fftgrid(pme->nkx,pme->nky,pme->nkz,
-                            NULL,pme->overlap[0].s2g,cr,
-                            bReproducible);
-    if (bFreeEnergy) {
-        pme->gridB = mk_fftgrid(pme->nkx,pme->nky,pme->nkz,
+    if (pme->ndecompdim >= 2)
+    {
+#ifdef GMX_MPI
+        pme->gridA = mk_fftgrid_pencil(pme->nkx,pme->nky,pme->nkz,
+                                       pme->overlap[0].s2g,pme->overlap[1].s2g,
+                                       pme->mpi_comm_d[0],pme->mpi_comm_d[1],
+                                       bReproducible);
+        if (bFreeEnergy) {
+            pme->gridB = mk_fftgrid_pencil(pme->nkx,pme->nky,pme->nkz,
+                                           pme->overlap[0].s2g,
+                                           pme->overlap[1].s2g,
+                                           pme->mpi_comm_d[0],
+                                           pme->mpi_comm_d[1],
+                                           bReproducible);
+        } else {
+            pme->gridB = NULL;
+        }
+#endif
+    }
+    else
+    {
+        pme->gridA = mk_fftgrid(pme->nkx,pme->nky,pme->nkz,
                                 NULL,pme->overlap[0].s2g,cr,
                                 bReproducible);
-    } else {
-        pme->gridB = NULL;
+        if (bFreeEnergy) {
+            pme->gridB = mk_fftgrid(pme->nkx,pme->nky,pme->nkz,
+                                    NULL,pme->overlap[0].s2g,cr,
+                                    bReproducible);
+        } else {
+            pme->gridB = NULL;
+        }
     }
     
+    if (pme->pool)
+    {
+        set_fftgrid_threads(pme->gridA,pme->pool,bReproducible);
+        if (pme->gridB)
+        {
+            set_fftgrid_threads(pme->gridB,pme->pool,bReproducible);
+        }
+    }
+
     make_bspline_moduli(pme->bsp_mod,pme->nkx,pme->nky,pme->nkz,pme->pme_order);
     
     if (pme->nnodes == 1) {
@@ -1804,41 +2546,75 @@ int gmx_pme_init(gmx_pme_t *pmedata,t_commrec *cr,int nnodes_major,
     }
     
 	pme->maxkz = pme->nkz/2+1;
-	snew(pme->work_mhz,pme->maxkz);
-	snew(pme->work_m2,pme->maxkz);
-	snew(pme->work_denom,pme->maxkz);
-	snew(pme->work_tmp1,pme->maxkz);
-	snew(pme->work_m2inv,pme->maxkz);
+	snew(pme->work_mhz,pme->maxkz*pme->nthread);
+	snew(pme->work_m2,pme->maxkz*pme->nthread);
+	snew(pme->work_denom,pme->maxkz*pme->nthread);
+	snew(pme->work_tmp1,pme->maxkz*pme->nthread);
+	snew(pme->work_m2inv,pme->maxkz*pme->nthread);
+	snew(pme->work_energy,pme->nthread);
+	snew(pme->work_vir,pme->nthread);
 
     *pmedata = pme;
     
     return 0;
 }
 
+static void spline_task(void *data,int task_ind,int thread)
+{
+    pme_task_t     *task;
+    pme_atomcomm_t *atc;
+    int  nx,ny,nz,nx2,ny2,nz2,la2,la12,order,start,end,d;
+    real *ptr;
+    splinevec theta,dtheta;
+
+    task  = (pme_task_t *)data;
+    atc   = task->atc;
+    order = task->pme->pme_order;
+
+    /* Unpack structure */
+    unpack_fftgrid(task->grid,&nx,&ny,&nz,&nx2,&ny2,&nz2,&la2,&la12,TRUE,&ptr);
+
+    start = (atc->n*task_ind)/task->pme->nthread;
+    end   = (atc->n*(task_ind + 1))/task->pme->nthread;
+
+    /* Compute fftgrid index for all atoms,
+     * with help of some extra variables.
+     */
+    calc_idx(task->pme,atc,start,end);
+
+    /* make local bsplines  */
+    for(d=0; d<DIM; d++)
+    {
+        theta[d]  = atc->theta[d]  + start*order;
+        dtheta[d] = atc->dtheta[d] + start*order;
+    }
+    make_bsplines(theta,dtheta,order,nx,ny,nz,
+                  atc->fractx+start,end-start,atc->q+start,task->pme->bFEP);
+}
+
 static void spread_on_grid(gmx_pme_t pme,
                            pme_atomcomm_t *atc,t_fftgrid *grid,
                            bool bCalcSplines,bool bSpread)
 { 
-    int nx,ny,nz,nx2,ny2,nz2,la2,la12;
-    real *ptr;
+    pme_task_t task;
     
     if (bCalcSplines)
     {
-        /* Unpack structure */
-        unpack_fftgrid(grid,&nx,&ny,&nz,&nx2,&ny2,&nz2,&la2,&la12,TRUE,&ptr);
-    
-        /* Compute fftgrid index for all atoms,
-         * with help of some extra variables.
-         */
-        calc_idx(pme,atc);
-        
-        /* make local bsplines  */
-        make_bsplines(atc->theta,atc->dtheta,pme->pme_order,nx,ny,nz,
-                      atc->fractx,atc->n,atc->q,pme->bFEP);
+        task.pme  = pme;
+        task.atc  = atc;
+        task.grid = grid;
+        /* Divide the atoms over the threads */
+        pme_run_tasks(pme,pme->nthread,spline_task,&task);
     }    
     
     if (bSpread)
     {
+        if (bCalcSplines)
+        {
+            /* Sort the atoms into blocks, also used for gathering */
+            pme_spread_setup(pme,atc,grid);
+        }
+
         /* put local atoms on grid. */
         spread_q_bsplines(pme,atc,grid);
         /*    pr_grid_dist(logfile,"spread",grid); */
@@ -1976,7 +2752,7 @@ int gmx_pme_do(gmx_pme_t pme,
 {
     int     q,d,i,j,ntot,npme;
     int     nx,ny,nz,nx2,ny2,nz2,la12,la2;
-    int     n_d,local_ny;
+    int     n_d,local_ny,local_nzc;
     pme_atomcomm_t *atc=NULL;
     t_fftgrid *grid=NULL;
     real    *ptr;
@@ -2016,12 +2792,15 @@ int gmx_pme_do(gmx_pme_t pme,
         unpack_fftgrid(grid,&nx,&ny,&nz,&nx2,&ny2,&nz2,&la2,&la12,TRUE,&ptr);
 #ifdef GMX_MPI
         if (pme->nnodes > 1) {
-            local_ny = grid->pfft.local_ny_after_transpose;
+            local_ny  = grid->pfft.local_ny_after_transpose;
+            local_nzc = grid->pfft.local_nzc_after_transpose;
         } else {
-            local_ny = ny;
+            local_ny  = ny;
+            local_nzc = nz/2 + 1;
         }
 #else
-        local_ny = ny;
+        local_ny  = ny;
+        local_nzc = nz/2 + 1;
 #endif
         where();
         
@@ -2097,7 +2876,12 @@ int gmx_pme_do(gmx_pme_t pme,
                     pr_fftgrid(debug,"qgrid before dd sum",grid);
 #endif
                 GMX_BARRIER(cr->mpi_comm_mygroup);
-                gmx_sum_qgrid_dd(&pme->overlap[0],grid,GMX_SUM_QGRID_FORWARD);
+                if (pme->ndecompdim >= 2) {
+                    gmx_sum_qgrid_pencil(pme,grid,GMX_SUM_QGRID_FORWARD);
+                } else {
+                    gmx_sum_qgrid_dd(&pme->overlap[0],grid,
+                                     GMX_SUM_QGRID_FORWARD);
+                }
                 where();
             }
 #ifdef DEBUG
@@ -2122,7 +2906,7 @@ int gmx_pme_do(gmx_pme_t pme,
             energy_AB[q]=solve_pme(pme,grid,ewaldcoeff,vol,vir_AB[q],cr);
             where();
             GMX_MPE_LOG(ev_solve_pme_finish);
-            inc_nrnb(nrnb,eNR_SOLVEPME,nx*local_ny*(nz/2+1));
+            inc_nrnb(nrnb,eNR_SOLVEPME,nx*local_ny*local_nzc);
             
             /* do 3d-invfft */
             GMX_BARRIER(cr->mpi_comm_mygroup);
@@ -2135,7 +2919,12 @@ int gmx_pme_do(gmx_pme_t pme,
             /* distribute local grid to all nodes */
             if (pme->nnodes > 1) {
                 GMX_BARRIER(cr->mpi_comm_mygroup);
-                gmx_sum_qgrid_dd(&pme->overlap[0],grid,GMX_SUM_QGRID_BACKWARD);
+                if (pme->ndecompdim >= 2) {
+                    gmx_sum_qgrid_pencil(pme,grid,GMX_SUM_QGRID_BACKWARD);
+                } else {
+                    gmx_sum_qgrid_dd(&pme->overlap[0],grid,
+                                     GMX_SUM_QGRID_BACKWARD);
+                }
             }
             where();
 #ifdef DEBUG
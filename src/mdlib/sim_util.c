@@ -57,6 +57,7 @@
 #include "mvdata.h"
 #include "txtdump.h"
 #include "pbc.h"
+#include "nbnxn.h"
 #include "vec.h"
 #include "time.h"
 #include "nrnb.h"
@@ -466,7 +467,14 @@ void do_force(FILE *fplog,t_commrec *cr,
     if (DYNAMIC_BOX(*inputrec) && bStateChanged)
       calc_shifts(box,fr->shift_vec);
     
-    if (bCalcCGCM) { 
+    if (bCalcCGCM && fr->cutoff_scheme == ecutsVERLET) {
+      /* The atom based cut-off scheme puts atoms in the box */
+      put_atoms_in_box(box,homenr,x);
+      calc_cgcm(fplog,cg0,cg1,&(top->cgs),x,fr->cg_cm);
+      inc_nrnb(nrnb,eNR_CGCM,homenr);
+      inc_nrnb(nrnb,eNR_RESETX,homenr);
+    }
+    else if (bCalcCGCM) { 
       put_charge_groups_in_box(fplog,cg0,cg1,fr->ePBC,box,
 			       &(top->cgs),x,fr->cg_cm);
       inc_nrnb(nrnb,eNR_CGCM,homenr);
@@ -580,10 +588,18 @@ void do_force(FILE *fplog,t_commrec *cr,
          * also do the calculation of long range forces and energies.
          */
         dvdl = 0;
-         ns(fplog,fr,x,box,
-           groups,&(inputrec->opts),top,mdatoms,
-           cr,nrnb,lambda,&dvdl,&enerd->grpp,bFillGrid,
-           bDoLongRange,bDoForces,bSepLRF ? fr->f_twin : f);
+        if (fr->cutoff_scheme == ecutsVERLET)
+        {
+            nbnxn_search(fr->nbv,fr->shift_vec,mdatoms->homenr,x,mdatoms,
+                         &top->excls,nrnb);
+        }
+        else
+        {
+            ns(fplog,fr,x,box,
+               groups,&(inputrec->opts),top,mdatoms,
+               cr,nrnb,lambda,&dvdl,&enerd->grpp,bFillGrid,
+               bDoLongRange,bDoForces,bSepLRF ? fr->f_twin : f);
+        }
         if (bSepDVDL)
         {
             fprintf(fplog,sepdvdlformat,"LR non-bonded",0.0,dvdl);
@@ -348,6 +348,22 @@ void write_traj(FILE *fplog,t_commrec *cr,
             copy_mat(state_local->box,state_global->box);
             copy_mat(state_local->boxv,state_global->boxv);
             copy_mat(state_local->pres_prev,state_global->pres_prev);
+            for(i=0; i<=MC_NR; i++)
+            {
+                state_global->mc_delta[i] = state_local->mc_delta[i];
+            }
+            for(i=0; i<MC_NR; i++)
+            {
+                state_global->mc_prob[i]  = state_local->mc_prob[i];
+                state_global->step_ac[i]  = state_local->step_ac[i];
+                state_global->step_tot[i] = state_local->step_tot[i];
+            }
+            state_global->vol_ac  = state_local->vol_ac;
+            state_global->vol_tot = state_local->vol_tot;
+            for(i=0; i<F_NRE; i++)
+            {
+                state_global->mc_ener[i] = state_local->mc_ener[i];
+            }
         }
         if (cr->nnodes > 1)
         {
@@ -68,6 +68,7 @@
 #include "gmx_wallcycle.h"
 #include "3dview.h"
 #include "bondf.h"
+#include "atomsort.h"
 
 #define DIFFERENT(a,b) ((a >= 0 && b < 0) || ( a <= 0 && b > 0))
 
@@ -91,8 +92,10 @@ typedef struct {
 } gmx_sd_sigma_t;
 
 typedef struct {
-  /* The random state */
+  /* The random state, for velocity rescaling */
   gmx_rng_t gaussrand;
+  /* The seed of the counter-based random numbers of SD and BD */
+  unsigned int seed;
   /* BD stuff */
   real *bd_rf;
   /* SD stuff */
@@ -100,6 +103,9 @@ typedef struct {
   gmx_sd_sigma_t *sdsig;
   rvec *sd_V;
   int  sd_V_nalloc;
+  /* Buffer for the gaussian random numbers of the home atoms */
+  real *gauss;
+  int  gauss_nalloc;
 } gmx_stochd_t;
 
 typedef struct gmx_update
@@ -327,7 +333,7 @@ void mk_cra_angle_list(int *angle_i,int *angle_j,int *angle_k,gmx_mc_move *mc_mo
      angle_j[9] = (mc_move->group[MC_CRA].ilist)->iatoms[jj+10];
      angle_k[9] = (mc_move->group[MC_CRA].ilist)->iatoms[jj+11];*/
 }
-void  chi_to_psi(real ** matrix_lt,gmx_rng_t rng,real *delta_chi,real *delta_psi,int nn)
+void  chi_to_psi(real ** matrix_lt,gmx_rng_cb_t *rng,real *delta_chi,real *delta_psi,int nn)
 {
  int i,j;
  real gauss,sum;
@@ -335,7 +341,7 @@ void  chi_to_psi(real ** matrix_lt,gmx_rng_t rng,real *delta_chi,real *delta_psi
  for(i=nn-1;i>=0;i--)
  {
   sum=0;
-  gauss = gmx_rng_gaussian_real(rng);
+  gauss = gmx_rng_cb_gaussian_real(rng);
   gauss *= M_PI/180; /* So we have a distribution with av=0 and std = 1 degree */
   delta_chi[i] = gauss;
   for(j=i+1;j<nn;j++)
@@ -1097,7 +1103,7 @@ static int pbc_rvec_sub(const t_pbc *pbc,const rvec xi,const rvec xj,rvec dx)
     return CENTRAL;
   }
 }
-void do_cra(rvec *x,gmx_mc_move *mc_move,t_graph *graph,gmx_rng_t rng,int homenr,const t_pbc *pbc)
+void do_cra(rvec *x,gmx_mc_move *mc_move,t_graph *graph,gmx_rng_cb_t *rng,int homenr,const t_pbc *pbc)
 {
   int    n,i,k,start,end;
   int    ah,ai,aj,ak,nr,*list_r,jj,ii,aa,bb,kk,cc,dd;
@@ -1171,7 +1177,7 @@ void do_cra(rvec *x,gmx_mc_move *mc_move,t_graph *graph,gmx_rng_t rng,int homenr
    snew(matrix_ltinv[ii],coord_nr);
   }
 
-     jj = uniform_int(rng,(mc_move->group[MC_CRA].ilist)->nr/15);
+     jj = gmx_rng_cb_uniform_int(rng,(mc_move->group[MC_CRA].ilist)->nr/15);
      jj *= 15;
 
      /* PREROTATION */
@@ -1746,7 +1752,7 @@ void bend_angles(rvec *x,gmx_mc_move *mc_move,t_graph *graph)
       rvec_add(x[aj],r2,x[al]);
      }
 }
-void set_mcmove(gmx_mc_movegroup *group,gmx_rng_t rng,real fac,int delta,int start,int i)
+void set_mcmove(gmx_mc_movegroup *group,gmx_rng_cb_t *rng,real fac,int delta,int start,int i)
 {
  int a;
  group->value = fac;
@@ -1756,7 +1762,7 @@ void set_mcmove(gmx_mc_movegroup *group,gmx_rng_t rng,real fac,int delta,int sta
 
  if(delta == 3) {
   group->ak = start + (group->ilist)->iatoms[delta*i+2];
-  if(uniform_int(rng,2))
+  if(gmx_rng_cb_uniform_int(rng,2))
   {
   /* a = group->ai;
    group->ai = group->ak;
@@ -1765,7 +1771,7 @@ void set_mcmove(gmx_mc_movegroup *group,gmx_rng_t rng,real fac,int delta,int sta
  }
  else 
  {
-  if(uniform_int(rng,2))
+  if(gmx_rng_cb_uniform_int(rng,2))
   {
   /* a = group->ai;
    group->ai = group->aj;
@@ -1773,15 +1779,47 @@ void set_mcmove(gmx_mc_movegroup *group,gmx_rng_t rng,real fac,int delta,int sta
   }
  }
 }
-static void do_update_mc(rvec *x,matrix box,real *massA,gmx_mc_move *mc_move,t_graph *graph,gmx_rng_t rng,gmx_rng_t rng2,int homenr,t_forcerec *fr,t_commrec *cr)
+void update_mc_rigid(int nr,rvec x[],real mass[],int mvgroup,
+                     rvec delta_x,rvec delta_phi)
 {
-  int    n,i,k,start,end;
-  int    ai,aj,ak;
-  rvec   r_ij,r_kj,r1,r2,u1,u2,u3;
+  int    n,k;
   bool   b_translate,b_rotate;
-  vec4 xrot;
-  rvec xcm;
-  real mass;
+  vec4   xrot;
+  rvec   xcm,r1;
+  real   mtot;
+
+  b_translate = (mvgroup == MC_TRANSLATE);
+  b_rotate = (mvgroup == MC_ROTATEX || mvgroup == MC_ROTATEY || mvgroup == MC_ROTATEZ);
+  if(b_rotate) 
+  {
+   clear_rvec(xcm);
+   mtot=0;
+   for(k=0;k<nr;k++) {
+    svmul(mass[k],x[k],r1);
+    rvec_add(r1,xcm,xcm);
+    mtot += mass[k];
+   } 
+   svmul(1.0/mtot,xcm,xcm);
+  }
+  for(n=0;n<nr;n++) {
+   if(b_rotate) 
+   { 
+    rand_rot_mc(x[n],xrot,delta_phi,xcm);
+    for(k=0;k<DIM;k++)
+    {
+     x[n][k]=xrot[k];
+    }
+   }
+   if(b_translate)
+   {
+    rvec_add(x[n],delta_x,x[n]);
+   }
+  }
+}
+
+static void do_update_mc(rvec *x,matrix box,real *massA,gmx_mc_move *mc_move,t_graph *graph,gmx_rng_cb_t *rng,int homenr,t_forcerec *fr,t_commrec *cr)
+{
+  int    start,end;
   t_pbc pbc;
   start = mc_move->start;
   end = mc_move->end;
@@ -1791,33 +1829,8 @@ static void do_update_mc(rvec *x,matrix box,real *massA,gmx_mc_move *mc_move,t_g
          */
         //set_pbc_dd(&pbc,fr->ePBC,cr->dd,TRUE,box);
  
-  b_translate = (mc_move->mvgroup == MC_TRANSLATE);
-  b_rotate = (mc_move->mvgroup == MC_ROTATEX || mc_move->mvgroup == MC_ROTATEY || mc_move->mvgroup == MC_ROTATEZ);
-   if(b_rotate) 
-   {
-    clear_rvec(xcm);
-    mass=0;
-    for(k=start;k<end;k++) {
-     svmul(massA[k],x[k],r1);
-     rvec_add(r1,xcm,xcm);
-     mass += massA[k];
-    } 
-    svmul(1.0/mass,xcm,xcm);
-   }
-    for(n=start;n<end;n++) {
-     if(b_rotate) 
-     { 
-      rand_rot_mc(x[n],xrot,mc_move->delta_phi,xcm);
-      for(k=0;k<DIM;k++)
-      {
-       x[n][k]=xrot[k];
-      }
-     }
-     if(b_translate)
-     {
-      rvec_add(x[n],mc_move->delta_x,x[n]);
-     }
-    }
+    update_mc_rigid(end-start,x+start,massA+start,mc_move->mvgroup,
+                    mc_move->delta_x,mc_move->delta_phi);
   
     /* INTERNAL COORDINATES */
     if(mc_move->mvgroup == MC_DIHEDRALS) 
@@ -1843,6 +1856,12 @@ static void do_update_mc(rvec *x,matrix box,real *massA,gmx_mc_move *mc_move,t_g
   //sfree(list_r);
   //sfree(list_l);
 }
+void update_mc_move(rvec x[],matrix box,real mass[],gmx_mc_move *mc_move,
+                    t_graph *graph,gmx_rng_cb_t *rng,int homenr)
+{
+  do_update_mc(x,box,mass,mc_move,graph,rng,homenr,NULL,NULL);
+}
+
 static void do_update_md(int start,int homenr,double dt,
                          t_grp_tcstat *tcstat,t_grp_acc *gstat,real nh_xi[],
                          rvec accel[],ivec nFreeze[],real invmass[],
@@ -2049,6 +2068,7 @@ static gmx_stochd_t *init_stochd(FILE *fplog,t_inputrec *ir)
    * for BD, SD or velocity rescaling temperature coupling.
    */
   sd->gaussrand = gmx_rng_init(ir->ld_seed);
+  sd->seed      = ir->ld_seed;
 
   ngtc = ir->opts.ngtc;
 
@@ -2112,7 +2132,28 @@ gmx_update_t init_update(FILE *fplog,t_inputrec *ir)
     return upd;
 }
 
-static void do_update_sd1(gmx_stochd_t *sd,
+/* Generates nper gaussian random numbers for each home atom in one batch,
+ * element k of atom n is sd->gauss[(n-start)*nper+k].
+ * The numbers of an atom only depend on the step and its global index.
+ */
+static real *sd_gaussians(gmx_stochd_t *sd,int domain,gmx_step_t step,
+                          int *gatindex,int start,int homenr,int nper)
+{
+  gmx_rng_cb_t rng;
+
+  if (homenr*nper > sd->gauss_nalloc) {
+    sd->gauss_nalloc = over_alloc_dd(homenr*nper);
+    srenew(sd->gauss,sd->gauss_nalloc);
+  }
+  gmx_rng_cb_init(&rng,sd->seed,domain);
+  gmx_rng_cb_gaussian_table_batch(&rng,step,homenr,
+                                  gatindex ? gatindex+start : NULL,start,
+                                  nper,sd->gauss);
+
+  return sd->gauss;
+}
+
+static void do_update_sd1(gmx_stochd_t *sd,gmx_step_t step,int *gatindex,
                           int start,int homenr,double dt,
                           rvec accel[],ivec nFreeze[],
                           real invmass[],unsigned short ptype[],
@@ -2124,7 +2165,7 @@ static void do_update_sd1(gmx_stochd_t *sd,
 {
   gmx_sd_const_t *sdc;
   gmx_sd_sigma_t *sig;
-  gmx_rng_t gaussrand;
+  real   *gauss;
   real   kT;
   int    gf=0,ga=0,gt=0;
   real   ism,sd_V;
@@ -2136,7 +2177,7 @@ static void do_update_sd1(gmx_stochd_t *sd,
     sd->sd_V_nalloc = over_alloc_dd(homenr);
     srenew(sd->sd_V,sd->sd_V_nalloc);
   }
-  gaussrand = sd->gaussrand;
+  gauss = sd_gaussians(sd,erngcbSD,step,gatindex,start,homenr,DIM);
   
   for(n=0; n<ngtc; n++) {
     kT = BOLTZ*ref_t[n];
@@ -2155,7 +2196,7 @@ static void do_update_sd1(gmx_stochd_t *sd,
 
     for(d=0; d<DIM; d++) {
       if((ptype[n] != eptVSite) && (ptype[n] != eptShell) && !nFreeze[gf][d]) {
-	sd_V = ism*sig[gt].V*gmx_rng_gaussian_table(gaussrand);
+	sd_V = ism*sig[gt].V*gauss[(n-start)*DIM+d];
 	
 	v[n][d] = v[n][d]*sdc[gt].em 
 	  + (invmass[n]*f[n][d] + accel[ga][d])*tau_t[gt]*(1 - sdc[gt].em)
@@ -2170,8 +2211,8 @@ static void do_update_sd1(gmx_stochd_t *sd,
   }
 }
 
-static void do_update_sd2(gmx_stochd_t *sd,bool bInitStep,
-                          int start,int homenr,
+static void do_update_sd2(gmx_stochd_t *sd,gmx_step_t step,int *gatindex,
+                          bool bInitStep,int start,int homenr,
                           rvec accel[],ivec nFreeze[],
                           real invmass[],unsigned short ptype[],
                           unsigned short cFREEZE[],unsigned short cACC[],
@@ -2187,7 +2228,8 @@ static void do_update_sd2(gmx_stochd_t *sd,bool bInitStep,
    * half of the update, needs to be remembered for the second half.
    */
   rvec *sd_V;
-  gmx_rng_t gaussrand;
+  real   *gauss;
+  int    nper;
   real   kT;
   int    gf=0,ga=0,gt=0;
   real   vn=0,Vmh,Xmh;
@@ -2201,7 +2243,17 @@ static void do_update_sd2(gmx_stochd_t *sd,bool bInitStep,
     srenew(sd->sd_V,sd->sd_V_nalloc);
   }
   sd_V = sd->sd_V;
-  gaussrand = sd->gaussrand;
+  /* The two halves draw from different domains.
+   * Per atom the first half uses Yv, V and, at the initial step, X,
+   * the second half Yx and X, each as DIM consecutive numbers.
+   */
+  if (bFirstHalf) {
+    nper = (bInitStep ? 3 : 2)*DIM;
+  } else {
+    nper = 2*DIM;
+  }
+  gauss = sd_gaussians(sd,bFirstHalf ? erngcbSD : erngcbSD2,step,gatindex,
+                       start,homenr,nper);
 
   if(bFirstHalf) {
     for(n=0; n<ngtc; n++) {
@@ -2231,11 +2283,11 @@ static void do_update_sd2(gmx_stochd_t *sd,bool bInitStep,
         if (bFirstHalf) {
 
           if (bInitStep)
-            sd_X[n][d] = ism*sig[gt].X*gmx_rng_gaussian_table(gaussrand);
+            sd_X[n][d] = ism*sig[gt].X*gauss[(n-start)*nper+2*DIM+d];
 
           Vmh = sd_X[n][d]*sdc[gt].d/(tau_t[gt]*sdc[gt].c) 
-                + ism*sig[gt].Yv*gmx_rng_gaussian_table(gaussrand);
-          sd_V[n-start][d] = ism*sig[gt].V*gmx_rng_gaussian_table(gaussrand);
+                + ism*sig[gt].Yv*gauss[(n-start)*nper+d];
+          sd_V[n-start][d] = ism*sig[gt].V*gauss[(n-start)*nper+DIM+d];
 
           v[n][d] = vn*sdc[gt].em 
                     + (invmass[n]*f[n][d] + accel[ga][d])*tau_t[gt]*(1 - sdc[gt].em)
@@ -2253,8 +2305,8 @@ static void do_update_sd2(gmx_stochd_t *sd,bool bInitStep,
           (xprime[n][d] - x[n][d])/(tau_t[gt]*(sdc[gt].eph - sdc[gt].emh));  
 
           Xmh = sd_V[n-start][d]*tau_t[gt]*sdc[gt].d/(sdc[gt].em-1) 
-                + ism*sig[gt].Yx*gmx_rng_gaussian_table(gaussrand);
-          sd_X[n][d] = ism*sig[gt].X*gmx_rng_gaussian_table(gaussrand);
+                + ism*sig[gt].Yx*gauss[(n-start)*nper+d];
+          sd_X[n][d] = ism*sig[gt].X*gauss[(n-start)*nper+DIM+d];
 
           xprime[n][d] += sd_X[n][d] - Xmh;
 
@@ -2269,20 +2321,25 @@ static void do_update_sd2(gmx_stochd_t *sd,bool bInitStep,
   }
 }
 
-static void do_update_bd(int start,int homenr,double dt,
+static void do_update_bd(gmx_stochd_t *sd,gmx_step_t step,int *gatindex,
+                         int start,int homenr,double dt,
                          ivec nFreeze[],
                          real invmass[],unsigned short ptype[],
                          unsigned short cFREEZE[],unsigned short cTC[],
                          rvec x[],rvec xprime[],rvec v[],
                          rvec f[],real friction_coefficient,
-                         int ngtc,real tau_t[],real ref_t[],
-			 real *rf,gmx_rng_t gaussrand)
+                         int ngtc,real tau_t[],real ref_t[])
 {
+  real   *gauss;
+  real   *rf;
   int    gf=0,gt=0;
   real   vn;
   real   invfr=0;
   int    n,d;
 
+  rf = sd->bd_rf;
+  gauss = sd_gaussians(sd,erngcbBD,step,gatindex,start,homenr,DIM);
+
   if (friction_coefficient != 0) {
     invfr = 1.0/friction_coefficient;
     for(n=0; n<ngtc; n++)
@@ -2299,11 +2356,11 @@ static void do_update_bd(int start,int homenr,double dt,
     for(d=0; (d<DIM); d++) {
       if((ptype[n]!=eptVSite) && (ptype[n]!=eptShell) && !nFreeze[gf][d]) {
         if (friction_coefficient != 0)
-          vn = invfr*f[n][d] + rf[gt]*gmx_rng_gaussian_table(gaussrand);
+          vn = invfr*f[n][d] + rf[gt]*gauss[(n-start)*DIM+d];
         else
           /* NOTE: invmass = 1/(mass*friction_constant*dt) */
           vn = invmass[n]*f[n][d]*dt 
-	    + sqrt(invmass[n])*rf[gt]*gmx_rng_gaussian_table(gaussrand);
+	    + sqrt(invmass[n])*rf[gt]*gauss[(n-start)*DIM+d];
 
         v[n][d]      = vn;
         xprime[n][d] = x[n][d]+vn*dt;
@@ -2615,8 +2672,7 @@ void update(FILE         *fplog,
             tensor       vir_part,
             bool         bNEMD,
             bool         bInitStep,
-            gmx_rng_t    rng,
-            gmx_rng_t    rng2,
+            gmx_rng_cb_t *rng,
             gmx_mc_move  *mc_move)
 {
     bool             bCouple,bNH,bPR,bLastStep,bLog=FALSE,bEner=FALSE;
@@ -2629,10 +2685,25 @@ void update(FILE         *fplog,
     rvec             *xprime;
     real             vnew,vfrac;
     rvec             v1;
+    int              *gatindex;
 
     
     start  = md->start;
     homenr = md->homenr;
+
+    /* The random numbers are keyed by the global atom index */
+    if (DOMAINDECOMP(cr))
+    {
+        gatindex = cr->dd->gatindex;
+    }
+    else if (fr->atomsort)
+    {
+        gatindex = atomsort_gatindex(fr->atomsort);
+    }
+    else
+    {
+        gatindex = NULL;
+    }
     
     if (state->nalloc > upd->xp_nalloc)
     {
@@ -2739,7 +2810,7 @@ void update(FILE         *fplog,
     dump_it_all(fplog,"Before update",
                 state->natoms,state->x,xprime,state->v,force);
 
-  if (inputrec->eI == eiMD) {
+  if (inputrec->eI == eiMD || inputrec->eI == eiHMC) {
     if (ekind->cosacc.cos_accel == 0) {
       /* use normal version of update */
       do_update_md(start,homenr,dt,
@@ -2756,7 +2827,8 @@ void update(FILE         *fplog,
 		     bNH,bPR);
     }
   } else if (inputrec->eI == eiSD1) {
-    do_update_sd1(upd->sd,start,homenr,dt,
+    do_update_sd1(upd->sd,step,gatindex,
+                  start,homenr,dt,
 		  inputrec->opts.acc,inputrec->opts.nFreeze,
 		  md->invmass,md->ptype,
 		  md->cFREEZE,md->cACC,md->cTC,
@@ -2766,7 +2838,8 @@ void update(FILE         *fplog,
     /* The SD update is done in 2 parts, because an extra constraint step
      * is needed 
      */
-    do_update_sd2(upd->sd,bInitStep,start,homenr,
+    do_update_sd2(upd->sd,step,gatindex,
+                  bInitStep,start,homenr,
 		  inputrec->opts.acc,inputrec->opts.nFreeze,
 		  md->invmass,md->ptype,
 		  md->cFREEZE,md->cACC,md->cTC,
@@ -2774,16 +2847,23 @@ void update(FILE         *fplog,
 		  inputrec->opts.ngtc,inputrec->opts.tau_t,inputrec->opts.ref_t,
 		  TRUE);
   } else if (inputrec->eI == eiBD) {
-    do_update_bd(start,homenr,dt,
+    do_update_bd(upd->sd,step,gatindex,
+                 start,homenr,dt,
 		 inputrec->opts.nFreeze,md->invmass,md->ptype,
 		 md->cFREEZE,md->cTC,
 		 state->x,xprime,state->v,force,
 		 inputrec->bd_fric,
-		 inputrec->opts.ngtc,inputrec->opts.tau_t,inputrec->opts.ref_t,
-		 upd->sd->bd_rf,upd->sd->gaussrand);
+		 inputrec->opts.ngtc,inputrec->opts.tau_t,inputrec->opts.ref_t);
   } else if (inputrec->eI == eiMC) {
-     for(i=0;i<state->natoms;i++)
-      copy_rvec(state->x[i],xprime[i]);
+     if (mc_move->update_box) {
+      for(i=0;i<state->natoms;i++)
+       copy_rvec(state->x[i],xprime[i]);
+     }
+     else {
+      /* Only the moved molecule changes */
+      for(i=mc_move->start;i<mc_move->end;i++)
+       copy_rvec(state->x[i],xprime[i]);
+     }
 
      if (!(mc_move->update_box)) {
       if(PAR(cr)) { 
@@ -2798,7 +2878,7 @@ void update(FILE         *fplog,
       }
      }
      else {
-      do_update_mc(xprime,state->box,md->massA,mc_move,graph,rng,rng2,md->homenr,fr,cr);
+      do_update_mc(xprime,state->box,md->massA,mc_move,graph,rng,md->homenr,fr,cr);
      }
     }
   } else {
@@ -2869,7 +2949,8 @@ void update(FILE         *fplog,
     if (inputrec->eI == eiSD2)
     {
         /* The second part of the SD integration */
-        do_update_sd2(upd->sd,FALSE,start,homenr,
+        do_update_sd2(upd->sd,step,gatindex,
+                      FALSE,start,homenr,
                       inputrec->opts.acc,inputrec->opts.nFreeze,
                       md->invmass,md->ptype,
                       md->cFREEZE,md->cACC,md->cTC,
@@ -2893,7 +2974,25 @@ void update(FILE         *fplog,
   /* We must always unshift here, also if we did not shake
    * x was shifted in do_force */
   
-  if (graph && (graph->nnodes > 0)) { 
+  if (inputrec->eI == eiMC && !mc_move->update_box) {
+    /* MC moves keep the molecule whole, the other atoms did not change */
+    for(n=mc_move->start; (n<mc_move->end); n++)
+      copy_rvec(xprime[n],state->x[n]);
+    if (mc_move->journal.bShifted && graph && (graph->nnodes > 0)) {
+      /* The moves need whole molecules, so instead of unshifting x
+       * we reset the graph shifts to those of the whole molecules.
+       * Otherwise a later shift_self, e.g. for the virtual sites,
+       * would shift x a second time.
+       */
+      mk_mshift(NULL,graph,inputrec->ePBC,state->box,state->x);
+    }
+    mc_move->journal.bShifted = FALSE;
+  } else if (inputrec->eI == eiMC) {
+    /* mc_pscale makes the molecules whole itself and updates the graph */
+    for(n=start; (n<start+homenr); n++)
+      copy_rvec(xprime[n],state->x[n]);
+    mc_move->journal.bShifted = FALSE;
+  } else if (graph && (graph->nnodes > 0)) { 
     unshift_x(graph,state->box,state->x,xprime);
     if (TRICLINIC(state->box))
       inc_nrnb(nrnb,eNR_SHIFTX,2*graph->nnodes);